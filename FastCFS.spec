@@ -101,6 +101,7 @@ mkdir -p /opt/fastcfs/fuse
 %files -n %{FastCFSAPI}
 %defattr(-,root,root,-)
 /usr/lib64/libfcfsapi.so*
+/usr/lib64/libfcfspreload.so*
 
 %files -n %{FastCFSDevel}
 %defattr(-,root,root,-)
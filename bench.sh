@@ -0,0 +1,122 @@
+#!/bin/bash
+#
+# Run the load generators against a local multi-process cluster.
+#
+# The fastDIR and faststore clusters are configured by "fastcfs.sh init"
+# from the template/ configs with all instances on 127.0.0.1 (the ports
+# are increased by the instance index), started by the generated cluster
+# shells, and stopped after the benchmarks done.
+#
+# The programs fdir_serverd, fs_serverd, fdir_bench and fs_bench must be
+# installed by "fastcfs.sh makeinstall" first.
+#
+# Usage: ./bench.sh [--prefix=/usr/local/fastcfs-bench] [--server-count=3]
+#          [--dir-args="fdir_bench options"] [--store-args="fs_bench options"]
+#          [--skip-dir] [--skip-store] [--keep]
+#
+
+BENCH_BASE=/usr/local/fastcfs-bench
+SERVER_COUNT=3
+DIR_ARGS=''
+STORE_ARGS=''
+SKIP_DIR=false
+SKIP_STORE=false
+KEEP_RUNNING=false
+HOST=127.0.0.1
+BUILD_SHELL_PATH=build/shell
+
+for arg do
+  case "$arg" in
+    --prefix=*)
+      BENCH_BASE=${arg#--prefix=}
+    ;;
+    --server-count=*)
+      SERVER_COUNT=${arg#--server-count=}
+    ;;
+    --dir-args=*)
+      DIR_ARGS=${arg#--dir-args=}
+    ;;
+    --store-args=*)
+      STORE_ARGS=${arg#--store-args=}
+    ;;
+    --skip-dir)
+      SKIP_DIR=true
+    ;;
+    --skip-store)
+      SKIP_STORE=true
+    ;;
+    --keep)
+      KEEP_RUNNING=true
+    ;;
+    *)
+      echo "Usage: $0 [--prefix=$BENCH_BASE] [--server-count=$SERVER_COUNT]" \
+        "[--dir-args=\"fdir_bench options\"]" \
+        "[--store-args=\"fs_bench options\"]" \
+        "[--skip-dir] [--skip-store] [--keep]"
+      exit 1
+    ;;
+  esac
+done
+
+for program in fdir_serverd fs_serverd fdir_bench fs_bench; do
+  if ! which $program >/dev/null 2>&1; then
+    echo "ERROR:Program $program not found, please run ./fastcfs.sh makeinstall first!"
+    exit 1
+  fi
+done
+
+# the conf path of the first instance, same as fastcfs.sh init
+instance_conf_path() {
+  if [ $SERVER_COUNT -gt 1 ]; then
+    echo "$1/server-1/conf"
+  else
+    echo "$1/conf"
+  fi
+}
+
+DIR_CONF_PATH=$(instance_conf_path $BENCH_BASE/fastdir)
+STORE_CONF_PATH=$(instance_conf_path $BENCH_BASE/faststore)
+
+# the existed confs are skipped by fastcfs.sh init
+mkdir -p $BUILD_SHELL_PATH || exit
+./fastcfs.sh init \
+  --dir-path=$BENCH_BASE/fastdir \
+  --dir-server-count=$SERVER_COUNT \
+  --dir-host=$HOST \
+  --store-path=$BENCH_BASE/faststore \
+  --store-server-count=$SERVER_COUNT \
+  --store-host=$HOST \
+  --fuse-path=$BENCH_BASE/fuse \
+  --fuse-mount-point=$BENCH_BASE/fuse/fuse1 || exit
+
+if [ ! -f $DIR_CONF_PATH/client.conf ] || [ ! -f $STORE_CONF_PATH/client.conf ]; then
+  echo "ERROR:The client configs under $BENCH_BASE not exist!"
+  exit 1
+fi
+
+stop_cluster() {
+  if [ $KEEP_RUNNING = false ]; then
+    $BUILD_SHELL_PATH/faststore-cluster.sh stop
+    $BUILD_SHELL_PATH/fastdir-cluster.sh stop
+  fi
+}
+
+$BUILD_SHELL_PATH/fastdir-cluster.sh restart
+$BUILD_SHELL_PATH/faststore-cluster.sh restart
+trap stop_cluster EXIT
+
+# wait for the leader / master election
+echo "INFO:Waiting for the clusters ready..."
+sleep 5
+
+if [ $SKIP_DIR = false ]; then
+  echo ''
+  echo "========== fdir_bench $DIR_ARGS =========="
+  fdir_bench -c $DIR_CONF_PATH/client.conf $DIR_ARGS
+fi
+
+if [ $SKIP_STORE = false ]; then
+  echo ''
+  echo "========== fs_bench $STORE_ARGS =========="
+  fs_bench -c $STORE_CONF_PATH/client.conf $STORE_ARGS
+fi
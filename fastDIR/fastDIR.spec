@@ -111,6 +111,7 @@ mkdir -p /opt/fastcfs/fdir
 /usr/bin/fdir_rename
 /usr/bin/fdir_service_stat
 /usr/bin/fdir_stat
+/usr/bin/fdir_subtree
 
 %files -n %{FastDIRDevel}
 %defattr(-,root,root,-)
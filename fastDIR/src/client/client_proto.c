@@ -36,6 +36,7 @@ int fdir_client_dentry_array_init(FDIRClientDentryArray *array)
     array->entries = NULL;
     init_client_buffer(&array->buffer);
     array->name_allocator.used = array->name_allocator.inited = false;
+    array->with_usage = false;
     return 0;
 }
 
@@ -157,21 +158,72 @@ static inline void proto_unpack_dentry(FDIRProtoStatDEntryResp *proto_stat,
     fdir_proto_unpack_dentry_stat(&proto_stat->stat, &dentry->stat);
 }
 
+static inline void client_update_data_version(FDIRClientContext *client_ctx,
+        const FDIRProtoDataVersionTail *tail)
+{
+    int64_t data_version;
+    int64_t old_version;
+
+    data_version = buff2long(tail->data_version);
+    while ((old_version=__sync_add_and_fetch(&client_ctx->
+                    data_version, 0)) < data_version)
+    {
+        if (__sync_bool_compare_and_swap(&client_ctx->data_version,
+                    old_version, data_version))
+        {
+            break;
+        }
+    }
+}
+
+/* append the data version of the last update to the query request
+ * so the slave answers after it applied (read-your-writes),
+ * the out_buff MUST have the space of FDIRProtoDataVersionTail,
+ * the flags are set to the request header too,
+ * return the new package length */
+static int client_set_min_data_version_ex(FDIRClientContext *client_ctx,
+        char *out_buff, const int out_bytes, const int flags)
+{
+    FDIRProtoHeader *header;
+    FDIRProtoDataVersionTail *tail;
+    int64_t data_version;
+
+    header = (FDIRProtoHeader *)out_buff;
+    if (client_ctx->read_rule == sf_data_read_rule_master_only ||
+            (data_version=__sync_add_and_fetch(&client_ctx->
+                    data_version, 0)) <= 0)
+    {
+        short2buff(flags, header->flags);
+        return out_bytes;
+    }
+
+    tail = (FDIRProtoDataVersionTail *)(out_buff + out_bytes);
+    long2buff(data_version, tail->data_version);
+    short2buff(FDIR_PROTO_FLAGS_MIN_DATA_VERSION | flags, header->flags);
+    int2buff(out_bytes + sizeof(FDIRProtoDataVersionTail) -
+            sizeof(FDIRProtoHeader), header->body_len);
+    return out_bytes + sizeof(FDIRProtoDataVersionTail);
+}
+
+#define client_set_min_data_version(client_ctx, out_buff, out_bytes) \
+    client_set_min_data_version_ex(client_ctx, out_buff, out_bytes, 0)
+
 static inline int do_update_dentry(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, char *out_buff, const int out_bytes,
         const int expect_cmd, FDIRDEntryInfo *dentry)
 {
     SFResponseInfo response;
-    FDIRProtoStatDEntryResp proto_stat;
+    FDIRProtoUpdateDEntryResp proto_resp;
     int result;
 
     response.error.length = 0;
     if ((result=sf_send_and_recv_response(conn, out_buff, out_bytes,
                     &response, client_ctx->network_timeout,
-                    expect_cmd, (char *)&proto_stat,
-                    sizeof(proto_stat))) == 0)
+                    expect_cmd, (char *)&proto_resp,
+                    sizeof(proto_resp))) == 0)
     {
-        proto_unpack_dentry(&proto_stat, dentry);
+        proto_unpack_dentry(&proto_resp.dentry, dentry);
+        client_update_data_version(client_ctx, &proto_resp.tail);
     } else {
         sf_log_network_error_for_update(&response, conn, result);
     }
@@ -362,27 +414,59 @@ int fdir_client_proto_link_dentry_by_pname(FDIRClientContext *client_ctx,
             FDIR_SERVICE_PROTO_HDLINK_BY_PNAME_RESP, dentry);
 }
 
+int fdir_client_proto_clone_dentry(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id, const int64_t src_inode,
+        const int inode_align, const FDIRDEntryFullName *fullname,
+        const FDIRClientOwnerModePair *omp, FDIRDEntryInfo *dentry)
+{
+    FDIRProtoHeader *header;
+    FDIRProtoCloneDEntry *req;
+    char out_buff[sizeof(FDIRProtoHeader) +
+        sizeof(SFProtoIdempotencyAdditionalHeader) +
+        sizeof(FDIRProtoCloneDEntry) + NAME_MAX + PATH_MAX];
+    int out_bytes;
+    int result;
+
+    CLIENT_PROTO_SET_REQ(out_buff, header, req, req_id, out_bytes);
+    if ((result=client_check_set_proto_dentry(fullname, &req->dest)) != 0) {
+        return result;
+    }
+
+    CLIENT_PROTO_SET_OMP(omp, req->front.common);
+    int2buff(inode_align, req->front.inode_align);
+    long2buff(src_inode, req->front.src_inode);
+    out_bytes += fullname->ns.len + fullname->path.len;
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_CLONE_DENTRY_REQ,
+            out_bytes - sizeof(FDIRProtoHeader));
+
+    return do_update_dentry(client_ctx, conn, out_buff, out_bytes,
+            FDIR_SERVICE_PROTO_CLONE_DENTRY_RESP, dentry);
+}
+
 static int do_rename_dentry(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, char *out_buff, const int out_bytes,
         const int expect_cmd, FDIRDEntryInfo **dentry)
 {
     SFResponseInfo response;
-    FDIRProtoStatDEntryResp proto_stat;
+    FDIRProtoUpdateDEntryResp proto_resp;
     int expect_body_lens[2];
     int body_len;
     int result;
 
-    expect_body_lens[0] = 0;
-    expect_body_lens[1] = sizeof(proto_stat);
+    expect_body_lens[0] = sizeof(FDIRProtoDataVersionTail);
+    expect_body_lens[1] = sizeof(proto_resp);
     response.error.length = 0;
     if ((result=sf_send_and_recv_response_ex(conn, out_buff, out_bytes,
                     &response, client_ctx->network_timeout, expect_cmd,
-                    (char *)&proto_stat, expect_body_lens, 2, &body_len)) == 0)
+                    (char *)&proto_resp, expect_body_lens, 2, &body_len)) == 0)
     {
-        if (body_len == (int)sizeof(proto_stat)) {
-            proto_unpack_dentry(&proto_stat, *dentry);
+        if (body_len == (int)sizeof(proto_resp)) {
+            proto_unpack_dentry(&proto_resp.dentry, *dentry);
+            client_update_data_version(client_ctx, &proto_resp.tail);
         } else {
             *dentry = NULL;
+            client_update_data_version(client_ctx,
+                    (FDIRProtoDataVersionTail *)&proto_resp);
         }
     } else {
         sf_log_network_error_for_update(&response, conn, result);
@@ -517,7 +601,7 @@ static int query_by_dentry_fullname(FDIRClientContext *client_ctx,
         const int in_len, const int enoent_log_level)
 {
     char out_buff[sizeof(FDIRProtoHeader) + sizeof(FDIRProtoDEntryInfo)
-        + NAME_MAX + PATH_MAX];
+        + NAME_MAX + PATH_MAX + sizeof(FDIRProtoDataVersionTail)];
     SFResponseInfo response;
     int out_bytes;
     int result;
@@ -529,6 +613,7 @@ static int query_by_dentry_fullname(FDIRClientContext *client_ctx,
         return result;
     }
 
+    out_bytes = client_set_min_data_version(client_ctx, out_buff, out_bytes);
     response.error.length = 0;
     if ((result=sf_send_and_recv_response(conn, out_buff, out_bytes,
                     &response, client_ctx->network_timeout,
@@ -567,7 +652,8 @@ int fdir_client_proto_lookup_inode_by_pname(FDIRClientContext *client_ctx,
         const int enoent_log_level, int64_t *inode)
 {
     char out_buff[sizeof(FDIRProtoHeader) + sizeof(
-            FDIRProtoStatDEntryByPNameReq) + NAME_MAX];
+            FDIRProtoStatDEntryByPNameReq) + NAME_MAX +
+        sizeof(FDIRProtoDataVersionTail)];
     int out_bytes;
     int result;
     SFResponseInfo response;
@@ -582,6 +668,7 @@ int fdir_client_proto_lookup_inode_by_pname(FDIRClientContext *client_ctx,
         return result;
     }
 
+    out_bytes = client_set_min_data_version(client_ctx, out_buff, out_bytes);
     response.error.length = 0;
     if ((result=sf_send_and_recv_response(conn, out_buff, out_bytes,
                     &response, client_ctx->network_timeout,
@@ -618,12 +705,13 @@ int fdir_client_proto_stat_dentry_by_path(FDIRClientContext *client_ctx,
 }
 
 static int do_readlink(FDIRClientContext *client_ctx,
-        ConnectionInfo *conn, char *out_buff, const int out_bytes,
+        ConnectionInfo *conn, char *out_buff, int out_bytes,
         const int expect_cmd, string_t *link, const int size)
 {
     SFResponseInfo response;
     int result;
 
+    out_bytes = client_set_min_data_version(client_ctx, out_buff, out_bytes);
     response.error.length = 0;
     if ((result=sf_send_and_check_response_header(conn, out_buff,
                     out_bytes, &response, client_ctx->network_timeout,
@@ -655,7 +743,7 @@ int fdir_client_proto_readlink_by_path(FDIRClientContext *client_ctx,
         string_t *link, const int size)
 {
     char out_buff[sizeof(FDIRProtoHeader) + sizeof(FDIRProtoDEntryInfo)
-        + NAME_MAX + PATH_MAX];
+        + NAME_MAX + PATH_MAX + sizeof(FDIRProtoDataVersionTail)];
     int out_bytes;
     int result;
 
@@ -675,7 +763,8 @@ int fdir_client_proto_readlink_by_pname(FDIRClientContext *client_ctx,
         string_t *link, const int size)
 {
     char out_buff[sizeof(FDIRProtoHeader) +
-        sizeof(FDIRProtoStatDEntryByPNameReq) + NAME_MAX];
+        sizeof(FDIRProtoStatDEntryByPNameReq) + NAME_MAX +
+        sizeof(FDIRProtoDataVersionTail)];
     int out_bytes;
     int result;
 
@@ -705,8 +794,8 @@ int fdir_client_proto_readlink_by_inode(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const int64_t inode, string_t *link,
         const int size)
 {
-    char out_buff[sizeof(FDIRProtoHeader) +
-        sizeof(FDIRProtoStatDEntryByPNameReq) + NAME_MAX];
+    char out_buff[sizeof(FDIRProtoHeader) + 8 +
+        sizeof(FDIRProtoDataVersionTail)];
     int out_bytes;
 
     setup_req_by_dentry_inode(inode, FDIR_SERVICE_PROTO_READLINK_BY_INODE_REQ,
@@ -716,7 +805,7 @@ int fdir_client_proto_readlink_by_inode(FDIRClientContext *client_ctx,
 }
 
 static inline int do_stat_dentry(FDIRClientContext *client_ctx,
-        ConnectionInfo *conn, char *out_buff, const int out_bytes,
+        ConnectionInfo *conn, char *out_buff, int out_bytes,
         const int expect_cmd, FDIRDEntryInfo *dentry,
         const int enoent_log_level)
 {
@@ -725,6 +814,7 @@ static inline int do_stat_dentry(FDIRClientContext *client_ctx,
     int result;
     int log_level;
 
+    out_bytes = client_set_min_data_version(client_ctx, out_buff, out_bytes);
     response.error.length = 0;
     if ((result=sf_send_and_recv_response(conn, out_buff, out_bytes,
                     &response, client_ctx->network_timeout,
@@ -742,7 +832,8 @@ static inline int do_stat_dentry(FDIRClientContext *client_ctx,
 int fdir_client_proto_stat_dentry_by_inode(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const int64_t inode, FDIRDEntryInfo *dentry)
 {
-    char out_buff[sizeof(FDIRProtoHeader) + 8];
+    char out_buff[sizeof(FDIRProtoHeader) + 8 +
+        sizeof(FDIRProtoDataVersionTail)];
     int out_bytes;
 
     setup_req_by_dentry_inode(inode, FDIR_SERVICE_PROTO_STAT_BY_INODE_REQ,
@@ -751,12 +842,75 @@ int fdir_client_proto_stat_dentry_by_inode(FDIRClientContext *client_ctx,
             FDIR_SERVICE_PROTO_STAT_BY_INODE_RESP, dentry, LOG_ERR);
 }
 
+static int do_stat_dentry_usage(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, char *out_buff, int out_bytes,
+        const int expect_cmd, FDIRDEntryInfo *dentry,
+        FDIRSubtreeSummary *usage)
+{
+    SFResponseInfo response;
+    struct {
+        FDIRProtoStatDEntryResp stat;
+        FDIRProtoSubtreeSummary usage;
+    } proto_resp;
+    int result;
+
+    out_bytes = client_set_min_data_version_ex(client_ctx, out_buff,
+            out_bytes, FDIR_PROTO_FLAGS_WITH_USAGE);
+    response.error.length = 0;
+    if ((result=sf_send_and_recv_response(conn, out_buff, out_bytes,
+                    &response, client_ctx->network_timeout, expect_cmd,
+                    (char *)&proto_resp, sizeof(proto_resp))) == 0)
+    {
+        proto_unpack_dentry(&proto_resp.stat, dentry);
+        fdir_proto_unpack_subtree_summary(&proto_resp.usage, usage);
+    } else {
+        sf_log_network_error(&response, conn, result);
+    }
+
+    return result;
+}
+
+int fdir_client_proto_stat_dentry_usage_by_path(FDIRClientContext
+        *client_ctx, ConnectionInfo *conn, const FDIRDEntryFullName
+        *fullname, FDIRDEntryInfo *dentry, FDIRSubtreeSummary *usage)
+{
+    char out_buff[sizeof(FDIRProtoHeader) + sizeof(FDIRProtoDEntryInfo)
+        + NAME_MAX + PATH_MAX + sizeof(FDIRProtoDataVersionTail)];
+    int out_bytes;
+    int result;
+
+    if ((result=setup_req_by_dentry_fullname(fullname,
+                    FDIR_SERVICE_PROTO_STAT_BY_PATH_REQ,
+                    out_buff, &out_bytes)) != 0)
+    {
+        return result;
+    }
+
+    return do_stat_dentry_usage(client_ctx, conn, out_buff, out_bytes,
+            FDIR_SERVICE_PROTO_STAT_BY_PATH_RESP, dentry, usage);
+}
+
+int fdir_client_proto_stat_dentry_usage_by_inode(FDIRClientContext
+        *client_ctx, ConnectionInfo *conn, const int64_t inode,
+        FDIRDEntryInfo *dentry, FDIRSubtreeSummary *usage)
+{
+    char out_buff[sizeof(FDIRProtoHeader) + 8 +
+        sizeof(FDIRProtoDataVersionTail)];
+    int out_bytes;
+
+    setup_req_by_dentry_inode(inode, FDIR_SERVICE_PROTO_STAT_BY_INODE_REQ,
+            out_buff, &out_bytes);
+    return do_stat_dentry_usage(client_ctx, conn, out_buff, out_bytes,
+            FDIR_SERVICE_PROTO_STAT_BY_INODE_RESP, dentry, usage);
+}
+
 int fdir_client_proto_stat_dentry_by_pname(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const FDIRDEntryPName *pname,
         const int enoent_log_level, FDIRDEntryInfo *dentry)
 {
     char out_buff[sizeof(FDIRProtoHeader) + sizeof(
-            FDIRProtoStatDEntryByPNameReq) + NAME_MAX];
+            FDIRProtoStatDEntryByPNameReq) + NAME_MAX +
+        sizeof(FDIRProtoDataVersionTail)];
     int out_bytes;
     int result;
 
@@ -901,6 +1055,37 @@ int fdir_client_proto_set_dentry_size(FDIRClientContext *client_ctx,
             FDIR_SERVICE_PROTO_SET_DENTRY_SIZE_RESP, dentry);
 }
 
+int fdir_client_proto_reserve_append(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id, const string_t *ns,
+        const int64_t inode, const int64_t length, FDIRDEntryInfo *dentry)
+{
+    FDIRProtoHeader *header;
+    FDIRProtoReserveAppendReq *req;
+    char out_buff[sizeof(FDIRProtoHeader) +
+        sizeof(SFProtoIdempotencyAdditionalHeader) +
+        sizeof(FDIRProtoReserveAppendReq) + NAME_MAX];
+    int out_bytes;
+
+    if (ns->len <= 0 || ns->len > NAME_MAX) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid namespace length: %d, which <= 0 or > %d",
+                __LINE__, ns->len, NAME_MAX);
+        return EINVAL;
+    }
+
+    CLIENT_PROTO_SET_REQ(out_buff, header, req, req_id, out_bytes);
+    long2buff(inode, req->inode);
+    long2buff(length, req->length);
+    req->ns_len = ns->len;
+    memcpy(req + 1, ns->str, ns->len);
+    out_bytes += ns->len;
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_RESERVE_APPEND_REQ,
+            out_bytes - sizeof(FDIRProtoHeader));
+
+    return do_update_dentry(client_ctx, conn, out_buff, out_bytes,
+            FDIR_SERVICE_PROTO_RESERVE_APPEND_RESP, dentry);
+}
+
 int fdir_client_proto_batch_set_dentry_size(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const uint64_t req_id, const string_t *ns,
         const FDIRSetDEntrySizeInfo *dsizes, const int count)
@@ -916,6 +1101,7 @@ int fdir_client_proto_batch_set_dentry_size(FDIRClientContext *client_ctx,
         FDIR_BATCH_SET_MAX_DENTRY_COUNT *
         sizeof(FDIRProtoBatchSetDentrySizeReqBody)];
     SFResponseInfo response;
+    FDIRProtoDataVersionTail tail;
     int out_bytes;
     int result;
 
@@ -947,16 +1133,424 @@ int fdir_client_proto_batch_set_dentry_size(FDIRClientContext *client_ctx,
     SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_REQ,
             out_bytes - sizeof(FDIRProtoHeader));
     response.error.length = 0;
-    if ((result=sf_send_and_recv_none_body_response(conn, out_buff,
-                    out_bytes, &response, client_ctx->network_timeout,
-                    FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_RESP)) != 0)
+    if ((result=sf_send_and_recv_response(conn, out_buff, out_bytes,
+                    &response, client_ctx->network_timeout,
+                    FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_RESP,
+                    (char *)&tail, sizeof(tail))) == 0)
+    {
+        client_update_data_version(client_ctx, &tail);
+    } else {
+        sf_log_network_error_for_update(&response, conn, result);
+    }
+
+    return result;
+}
+
+static int batch_dentry_ops_pack(const string_t *ns,
+        const FDIRClientBatchDEntryOp *ops, const int count,
+        char *buff, int *out_bytes)
+{
+    FDIRProtoBatchDEntryOpsReqHeader *rheader;
+    FDIRProtoBatchDEntryOpsReqBody *rbody;
+    const FDIRClientBatchDEntryOp *op;
+    const FDIRClientBatchDEntryOp *end;
+    char *p;
+
+    rheader = (FDIRProtoBatchDEntryOpsReqHeader *)buff;
+    int2buff(count, rheader->count);
+    rheader->ns_len = ns->len;
+    memcpy(rheader->ns_str, ns->str, ns->len);
+    p = rheader->ns_str + ns->len;
+
+    end = ops + count;
+    for (op=ops; op<end; op++) {
+        rbody = (FDIRProtoBatchDEntryOpsReqBody *)p;
+        memset(rbody, 0, sizeof(FDIRProtoBatchDEntryOpsReqBody));
+        rbody->op_type = op->op_type;
+        if (op->op_type == FDIR_BATCH_DENTRY_OP_MODIFY_STAT) {
+            long2buff(op->inode, rbody->inode);
+            long2buff(op->flags, rbody->mflags);
+            fdir_proto_pack_dentry_stat(&op->stat, &rbody->stat);
+            rbody->name_len = 0;
+        } else {
+            if (op->pname.name.len <= 0 || op->pname.name.len > NAME_MAX) {
+                logError("file: "__FILE__", line: %d, "
+                        "invalid name length: %d, which <= 0 or > %d",
+                        __LINE__, op->pname.name.len, NAME_MAX);
+                return EINVAL;
+            }
+
+            long2buff(op->pname.parent_inode, rbody->inode);
+            if (op->op_type == FDIR_BATCH_DENTRY_OP_CREATE) {
+                int2buff(op->stat.mode, rbody->stat.mode);
+                int2buff(op->stat.uid, rbody->stat.uid);
+                int2buff(op->stat.gid, rbody->stat.gid);
+            }
+            rbody->name_len = op->pname.name.len;
+            memcpy(rbody->name_str, op->pname.name.str, op->pname.name.len);
+        }
+        p += sizeof(FDIRProtoBatchDEntryOpsReqBody) + rbody->name_len;
+    }
+
+    *out_bytes = p - buff;
+    return 0;
+}
+
+static int batch_dentry_ops_unpack(ConnectionInfo *conn,
+        const char *in_buff, const int body_len,
+        FDIRClientBatchDEntryOp *ops, const int count)
+{
+    FDIRProtoBatchDEntryOpsRespHeader *rheader;
+    FDIRProtoBatchDEntryOpsRespBody *rbody;
+    FDIRClientBatchDEntryOp *op;
+    FDIRClientBatchDEntryOp *end;
+    int expect_blen;
+    int resp_count;
+
+    end = ops + count;
+    if (body_len == 0) {
+        if (count == 0) {
+            return 0;
+        }
+
+        /* such as the retried request which already done, the details
+         * of the operations are lost, so the caller MUST NOT take them
+         * as successful */
+        logError("file: "__FILE__", line: %d, "
+                "server %s:%u, empty response body, expected "
+                "operation count: %d", __LINE__, conn->ip_addr,
+                conn->port, count);
+        return EINVAL;
+    }
+
+    rheader = (FDIRProtoBatchDEntryOpsRespHeader *)in_buff;
+    resp_count = buff2int(rheader->count);
+    expect_blen = sizeof(FDIRProtoBatchDEntryOpsRespHeader) +
+        sizeof(FDIRProtoBatchDEntryOpsRespBody) * count;
+    if (resp_count != count || body_len != expect_blen) {
+        logError("file: "__FILE__", line: %d, "
+                "server %s:%u, response count: %d != expected: %d, "
+                "or body length: %d != expected: %d", __LINE__,
+                conn->ip_addr, conn->port, resp_count, count,
+                body_len, expect_blen);
+        return EINVAL;
+    }
+
+    rbody = (FDIRProtoBatchDEntryOpsRespBody *)(rheader + 1);
+    for (op=ops; op<end; op++, rbody++) {
+        op->result = buff2short(rbody->errno_);
+        op->dentry.inode = buff2long(rbody->inode);
+        fdir_proto_unpack_dentry_stat(&rbody->stat, &op->dentry.stat);
+    }
+
+    return 0;
+}
+
+int fdir_client_proto_batch_dentry_ops(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id, const string_t *ns,
+        FDIRClientBatchDEntryOp *ops, const int count)
+{
+    FDIRProtoHeader *header;
+    FDIRProtoBatchDEntryOpsReqHeader *rheader;
+    char *buff;
+    SFResponseInfo response;
+    int out_bytes;
+    int body_len;
+    int buff_size;
+    int result;
+
+    if (ns->len <= 0 || ns->len > NAME_MAX) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid namespace length: %d, which <= 0 or > %d",
+                __LINE__, ns->len, NAME_MAX);
+        return EINVAL;
+    }
+    if (count <= 0 || count > FDIR_BATCH_DENTRY_OPS_MAX_COUNT) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid count: %d, which <= 0 or > %d", __LINE__,
+                count, FDIR_BATCH_DENTRY_OPS_MAX_COUNT);
+        return EINVAL;
+    }
+
+    buff_size = sizeof(FDIRProtoHeader) +
+        sizeof(SFProtoIdempotencyAdditionalHeader) +
+        sizeof(FDIRProtoBatchDEntryOpsReqHeader) + NAME_MAX + count *
+        (sizeof(FDIRProtoBatchDEntryOpsReqBody) + NAME_MAX);
+    if ((buff=(char *)fc_malloc(buff_size)) == NULL) {
+        return ENOMEM;
+    }
+
+    CLIENT_PROTO_SET_REQ(buff, header, rheader, req_id, out_bytes);
+    if ((result=batch_dentry_ops_pack(ns, ops, count,
+                    (char *)rheader, &body_len)) != 0)
     {
+        free(buff);
+        return result;
+    }
+
+    out_bytes = ((char *)rheader - buff) + body_len;
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_BATCH_DENTRY_OPS_REQ,
+            out_bytes - sizeof(FDIRProtoHeader));
+    response.error.length = 0;
+    if ((result=sf_send_and_recv_response_ex1(conn, buff, out_bytes,
+                    &response, client_ctx->network_timeout,
+                    FDIR_SERVICE_PROTO_BATCH_DENTRY_OPS_RESP,
+                    buff, buff_size, &body_len)) == 0)
+    {
+        if (body_len < (int)sizeof(FDIRProtoDataVersionTail)) {
+            logError("file: "__FILE__", line: %d, "
+                    "server %s:%u, response body length: %d is too small",
+                    __LINE__, conn->ip_addr, conn->port, body_len);
+            result = EINVAL;
+        } else {
+            body_len -= sizeof(FDIRProtoDataVersionTail);
+            client_update_data_version(client_ctx,
+                    (FDIRProtoDataVersionTail *)(buff + body_len));
+            result = batch_dentry_ops_unpack(conn, buff,
+                    body_len, ops, count);
+        }
+    } else {
         sf_log_network_error_for_update(&response, conn, result);
     }
 
+    free(buff);
     return result;
 }
 
+static int subtree_ops_unpack(ConnectionInfo *conn, char *body,
+        const int body_len, FDIRClientSubtreeOp *op)
+{
+    FDIRProtoSubtreeOpsResp *resp;
+    int expect_len;
+
+    if (body_len < (int)sizeof(FDIRProtoSubtreeOpsResp)) {
+        logError("file: "__FILE__", line: %d, "
+                "server %s:%u, response body length: %d is too small",
+                __LINE__, conn->ip_addr, conn->port, body_len);
+        return EINVAL;
+    }
+
+    resp = (FDIRProtoSubtreeOpsResp *)body;
+    op->count = buff2int(resp->count);
+    op->file_count = buff2int(resp->file_count);
+    op->cursor_len = buff2short(resp->cursor_len);
+    op->finished = resp->finished;
+    expect_len = sizeof(FDIRProtoSubtreeOpsResp) + op->cursor_len;
+    if (op->file_count < 0 || op->file_count > op->limit ||
+            op->cursor_len < 0 || op->cursor_len >= PATH_MAX ||
+            body_len != expect_len)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "server %s:%u, response body length: %d != expect: %d, "
+                "file count: %d, cursor length: %d", __LINE__,
+                conn->ip_addr, conn->port, body_len, expect_len,
+                op->file_count, op->cursor_len);
+        op->cursor_len = 0;
+        return EINVAL;
+    }
+
+    fdir_proto_unpack_subtree_summary(&resp->summary, &op->summary);
+    memcpy(op->cursor, resp + 1, op->cursor_len);
+    return 0;
+}
+
+/* the summary is a query without the request id and the data version tail
+ * of the response, the others are the updates */
+static int do_subtree_ops(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id, const string_t *ns,
+        FDIRClientSubtreeOp *op)
+{
+    bool is_query;
+    FDIRProtoHeader *header;
+    FDIRProtoSubtreeOpsReq *req;
+    char *buff;
+    SFResponseInfo response;
+    int out_bytes;
+    int body_len;
+    int buff_size;
+    int result;
+
+    if (ns->len <= 0 || ns->len > NAME_MAX) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid namespace length: %d, which <= 0 or > %d",
+                __LINE__, ns->len, NAME_MAX);
+        return EINVAL;
+    }
+    if (op->limit <= 0 || op->limit > FDIR_SUBTREE_OPS_MAX_LIMIT) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid limit: %d, which <= 0 or > %d", __LINE__,
+                op->limit, FDIR_SUBTREE_OPS_MAX_LIMIT);
+        return EINVAL;
+    }
+
+    buff_size = sizeof(FDIRProtoHeader) +
+        sizeof(SFProtoIdempotencyAdditionalHeader) +
+        sizeof(FDIRProtoSubtreeOpsReq) + NAME_MAX + PATH_MAX +
+        sizeof(FDIRProtoDataVersionTail);
+    buff_size += sizeof(FDIRProtoSubtreeOpsResp) +
+        sizeof(FDIRProtoDataVersionTail);
+    if ((buff=(char *)fc_malloc(buff_size)) == NULL) {
+        return ENOMEM;
+    }
+
+    CLIENT_PROTO_SET_REQ(buff, header, req, req_id, out_bytes);
+    long2buff(op->inode, req->inode);
+    long2buff(op->flags, req->mflags);
+    fdir_proto_pack_dentry_stat(&op->stat, &req->stat);
+    int2buff(op->limit, req->limit);
+    short2buff(op->cursor_len, req->cursor_len);
+    req->op_type = op->op_type;
+    req->ns_len = ns->len;
+    memcpy(req->ns_str, ns->str, ns->len);
+    memcpy(req->ns_str + ns->len, op->cursor, op->cursor_len);
+    out_bytes += ns->len + op->cursor_len;
+    is_query = (op->op_type == FDIR_SUBTREE_OP_SUMMARY);
+    if (is_query) {
+        SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_SUBTREE_SUMMARY_REQ,
+                out_bytes - sizeof(FDIRProtoHeader));
+        out_bytes = client_set_min_data_version(client_ctx,
+                buff, out_bytes);
+    } else {
+        SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_SUBTREE_OPS_REQ,
+                out_bytes - sizeof(FDIRProtoHeader));
+    }
+
+    response.error.length = 0;
+    if ((result=sf_send_and_recv_response_ex1(conn, buff, out_bytes,
+                    &response, client_ctx->network_timeout, is_query ?
+                    FDIR_SERVICE_PROTO_SUBTREE_SUMMARY_RESP :
+                    FDIR_SERVICE_PROTO_SUBTREE_OPS_RESP,
+                    buff, buff_size, &body_len)) == 0)
+    {
+        if (is_query) {
+            result = subtree_ops_unpack(conn, buff, body_len, op);
+        } else if (body_len < (int)sizeof(FDIRProtoDataVersionTail)) {
+            logError("file: "__FILE__", line: %d, "
+                    "server %s:%u, response body length: %d is too small",
+                    __LINE__, conn->ip_addr, conn->port, body_len);
+            result = EINVAL;
+        } else {
+            body_len -= sizeof(FDIRProtoDataVersionTail);
+            client_update_data_version(client_ctx,
+                    (FDIRProtoDataVersionTail *)(buff + body_len));
+            result = subtree_ops_unpack(conn, buff, body_len, op);
+        }
+    } else if (is_query) {
+        sf_log_network_error(&response, conn, result);
+    } else {
+        sf_log_network_error_for_update(&response, conn, result);
+    }
+
+    free(buff);
+    return result;
+}
+
+int fdir_client_proto_subtree_ops(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id, const string_t *ns,
+        FDIRClientSubtreeOp *op)
+{
+    if (op->op_type == FDIR_SUBTREE_OP_SUMMARY) {
+        logError("file: "__FILE__", line: %d, "
+                "the summary is a query, please use "
+                "fdir_client_proto_subtree_summary", __LINE__);
+        return EINVAL;
+    }
+    return do_subtree_ops(client_ctx, conn, req_id, ns, op);
+}
+
+int fdir_client_proto_subtree_summary(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const string_t *ns, FDIRClientSubtreeOp *op)
+{
+    if (op->op_type != FDIR_SUBTREE_OP_SUMMARY) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid operation type: %d for the summary",
+                __LINE__, op->op_type);
+        return EINVAL;
+    }
+    return do_subtree_ops(client_ctx, conn, 0, ns, op);
+}
+
+int fdir_client_proto_drain_trash(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const string_t *ns,
+        const int64_t purge_version, FDIRSubtreeFile *files,
+        int *count, int64_t *last_version)
+{
+    FDIRProtoHeader *header;
+    FDIRProtoDrainTrashReq *req;
+    FDIRProtoDrainTrashResp *resp;
+    FDIRProtoTrashFile *pf;
+    FDIRSubtreeFile *file;
+    FDIRSubtreeFile *end;
+    char *buff;
+    SFResponseInfo response;
+    int out_bytes;
+    int body_len;
+    int buff_size;
+    int result;
+
+    if (ns->len <= 0 || ns->len > NAME_MAX) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid namespace length: %d, which <= 0 or > %d",
+                __LINE__, ns->len, NAME_MAX);
+        return EINVAL;
+    }
+
+    buff_size = sizeof(FDIRProtoDrainTrashResp) +
+        sizeof(FDIRProtoTrashFile) * FDIR_DRAIN_TRASH_MAX_COUNT;
+    if ((buff=(char *)fc_malloc(buff_size)) == NULL) {
+        return ENOMEM;
+    }
+
+    header = (FDIRProtoHeader *)buff;
+    req = (FDIRProtoDrainTrashReq *)(header + 1);
+    long2buff(purge_version, req->purge_version);
+    memset(req->padding, 0, sizeof(req->padding));
+    req->ns_len = ns->len;
+    memcpy(req->ns_str, ns->str, ns->len);
+    out_bytes = sizeof(FDIRProtoHeader) +
+        sizeof(FDIRProtoDrainTrashReq) + ns->len;
+    SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_DRAIN_TRASH_REQ,
+            out_bytes - sizeof(FDIRProtoHeader));
+
+    response.error.length = 0;
+    if ((result=sf_send_and_recv_response_ex1(conn, buff, out_bytes,
+                    &response, client_ctx->network_timeout,
+                    FDIR_SERVICE_PROTO_DRAIN_TRASH_RESP,
+                    buff, buff_size, &body_len)) != 0)
+    {
+        sf_log_network_error(&response, conn, result);
+        free(buff);
+        return result;
+    }
+
+    resp = (FDIRProtoDrainTrashResp *)buff;
+    *count = (body_len >= (int)sizeof(FDIRProtoDrainTrashResp) ?
+            buff2int(resp->count) : -1);
+    if (*count < 0 || *count > FDIR_DRAIN_TRASH_MAX_COUNT ||
+            body_len != sizeof(FDIRProtoDrainTrashResp) +
+            sizeof(FDIRProtoTrashFile) * (*count))
+    {
+        logError("file: "__FILE__", line: %d, "
+                "server %s:%u, invalid response body length: %d, "
+                "file count: %d", __LINE__, conn->ip_addr,
+                conn->port, body_len, *count);
+        *count = 0;
+        free(buff);
+        return EINVAL;
+    }
+
+    *last_version = buff2long(resp->last_version);
+    pf = (FDIRProtoTrashFile *)(resp + 1);
+    end = files + *count;
+    for (file=files; file<end; file++, pf++) {
+        file->inode = buff2long(pf->inode);
+        file->size = buff2long(pf->size);
+    }
+
+    free(buff);
+    return 0;
+}
+
 int fdir_client_proto_modify_dentry_stat(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const uint64_t req_id,
         const string_t *ns, const int64_t inode, const int64_t flags,
@@ -1323,6 +1917,9 @@ static int parse_list_dentry_response_body(ConnectionInfo *conn,
     for (cd=start; cd<end; cd++) {
         part = (FDIRProtoListDEntryRespBodyPart *)p;
         entry_len = sizeof(FDIRProtoListDEntryRespBodyPart) + part->name_len;
+        if (array->with_usage) {
+            entry_len += sizeof(FDIRProtoSubtreeSummary);
+        }
         if ((p - array->buffer.buff) + entry_len > response->header.body_len) {
             response->error.length = snprintf(response->error.message,
                     sizeof(response->error.message),
@@ -1333,6 +1930,10 @@ static int parse_list_dentry_response_body(ConnectionInfo *conn,
 
         cd->dentry.inode = buff2long(part->inode);
         fdir_proto_unpack_dentry_stat(&part->stat, &cd->dentry.stat);
+        if (array->with_usage) {  //follows the name
+            fdir_proto_unpack_subtree_summary((FDIRProtoSubtreeSummary *)
+                    (part->name_str + part->name_len), &cd->usage);
+        }
         if (body_header->is_last) {
             FC_SET_STRING_EX(cd->name, part->name_str, part->name_len);
         } else if ((result=fast_mpool_alloc_string_ex(&array->name_allocator.mpool,
@@ -1402,6 +2003,9 @@ static int do_list_dentry_next(FDIRClientContext *client_ctx,
         sizeof(FDIRProtoListDEntryNextBody);
     SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_LIST_DENTRY_NEXT_REQ,
             out_bytes - sizeof(FDIRProtoHeader));
+    if (array->with_usage) {
+        short2buff(FDIR_PROTO_FLAGS_WITH_USAGE, header->flags);
+    }
     memcpy(entry_body->token, next_token->str, next_token->len);
     int2buff(array->count, entry_body->offset);
     if ((result=sf_send_and_check_response_header(conn, out_buff,
@@ -1440,7 +2044,7 @@ static int deal_list_dentry_response(FDIRClientContext *client_ctx,
 }
 
 static int list_dentry(FDIRClientContext *client_ctx, ConnectionInfo *conn,
-        char *out_buff, const int out_bytes, FDIRClientDentryArray *array)
+        char *out_buff, int out_bytes, FDIRClientDentryArray *array)
 {
     SFResponseInfo response;
     int result;
@@ -1450,6 +2054,8 @@ static int list_dentry(FDIRClientContext *client_ctx, ConnectionInfo *conn,
         fast_mpool_reset(&array->name_allocator.mpool);  //buffer recycle
         array->name_allocator.used = false;
     }
+    out_bytes = client_set_min_data_version_ex(client_ctx, out_buff,
+            out_bytes, array->with_usage ? FDIR_PROTO_FLAGS_WITH_USAGE : 0);
     response.error.length = 0;
     if ((result=sf_send_and_check_response_header(conn, out_buff,
                     out_bytes, &response, client_ctx->network_timeout,
@@ -1472,7 +2078,7 @@ int fdir_client_proto_list_dentry_by_path(FDIRClientContext *client_ctx,
     FDIRProtoHeader *header;
     FDIRProtoListDEntryByPathBody *entry_body;
     char out_buff[sizeof(FDIRProtoHeader) + sizeof(FDIRProtoListDEntryByPathBody)
-        + NAME_MAX + PATH_MAX];
+        + NAME_MAX + PATH_MAX + sizeof(FDIRProtoDataVersionTail)];
     int out_bytes;
     int result;
 
@@ -1497,12 +2103,13 @@ int fdir_client_proto_list_dentry_by_inode(FDIRClientContext *client_ctx,
         FDIRClientDentryArray *array)
 {
     FDIRProtoHeader *header;
-    char out_buff[sizeof(FDIRProtoHeader) + 8];
+    char out_buff[sizeof(FDIRProtoHeader) + 8 +
+        sizeof(FDIRProtoDataVersionTail)];
     int out_bytes;
 
     header = (FDIRProtoHeader *)out_buff;
     long2buff(inode, out_buff + sizeof(FDIRProtoHeader));
-    out_bytes = sizeof(out_buff);
+    out_bytes = sizeof(FDIRProtoHeader) + 8;
     SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_LIST_DENTRY_BY_INODE_REQ,
             out_bytes - sizeof(FDIRProtoHeader));
     return  list_dentry(client_ctx, conn, out_buff, out_bytes, array);
@@ -1555,10 +2162,33 @@ int fdir_client_service_stat(FDIRClientContext *client_ctx,
     stat->dentry.counters.ns = buff2long(stat_resp.dentry.counters.ns);
     stat->dentry.counters.dir = buff2long(stat_resp.dentry.counters.dir);
     stat->dentry.counters.file = buff2long(stat_resp.dentry.counters.file);
+    stat->memory.dentry = buff2long(stat_resp.memory.dentry);
+    stat->memory.name = buff2long(stat_resp.memory.name);
+    stat->memory.children = buff2long(stat_resp.memory.children);
+    stat->memory.inode_index = buff2long(stat_resp.memory.inode_index);
 
     return 0;
 }
 
+int fdir_client_get_metrics(FDIRClientContext *client_ctx,
+        const ConnectionInfo *spec_conn, SFMetricsItemInfo *items,
+        const int size, int *count)
+{
+    ConnectionInfo *conn;
+    int result;
+
+    if ((conn=client_ctx->conn_manager.get_spec_connection(
+                    client_ctx, spec_conn, &result)) == NULL)
+    {
+        return result;
+    }
+
+    result = sf_proto_get_metrics(conn, client_ctx->network_timeout,
+            items, size, count);
+    SF_CLIENT_RELEASE_CONNECTION(client_ctx, conn, result);
+    return result;
+}
+
 int fdir_client_cluster_stat(FDIRClientContext *client_ctx,
         FDIRClientClusterStatEntry *stats, const int size, int *count)
 {
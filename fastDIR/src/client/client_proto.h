@@ -17,6 +17,7 @@
 #ifndef _FDIR_CLIENT_PROTO_H
 #define _FDIR_CLIENT_PROTO_H
 
+#include <limits.h>
 #include "fastcommon/fast_mpool.h"
 #include "fdir_types.h"
 #include "client_types.h"
@@ -27,9 +28,38 @@ typedef struct fdir_client_owner_mode_pair {
     mode_t mode;
 } FDIRClientOwnerModePair;
 
+typedef struct fdir_client_batch_dentry_op {
+    int op_type;            //FDIR_BATCH_DENTRY_OP_xxx
+    FDIRDEntryPName pname;  //for create, stat and remove
+    int64_t inode;          //for modify stat
+    int64_t flags;          //modify flags for modify stat
+    FDIRDEntryStatus stat;  //mode, uid and gid for create
+    int result;             //output: errno of this operation
+    FDIRDEntryInfo dentry;  //output
+} FDIRClientBatchDEntryOp;
+
+typedef struct fdir_client_subtree_op {
+    int op_type;            //FDIR_SUBTREE_OP_xxx
+    int limit;              //the max entries of one batch
+    int64_t inode;          //the root inode of the subtree
+    int64_t flags;          //modify flags for modify stat
+    FDIRDEntryStatus stat;  //mode, uid and gid for modify stat
+
+    /* the cursor is passed to the next batch, empty for the first */
+    int cursor_len;
+    char cursor[PATH_MAX];
+
+    /* output of the batch */
+    int count;
+    int file_count;
+    bool finished;
+    FDIRSubtreeSummary summary;
+} FDIRClientSubtreeOp;
+
 typedef struct fdir_client_dentry {
     FDIRDEntryInfo dentry;
     string_t name;
+    FDIRSubtreeSummary usage;  //when with_usage of the array is true
 } FDIRClientDentry;
 
 typedef struct fdir_client_buffer {
@@ -41,6 +71,7 @@ typedef struct fdir_client_buffer {
 typedef struct fdir_client_dentry_array {
     int alloc;
     int count;
+    bool with_usage;  //list with the recursive usage of the directories
     FDIRClientDentry *entries;
     FDIRClientBuffer buffer;
     struct {
@@ -69,6 +100,13 @@ typedef struct fdir_client_service_stat {
             int64_t file;
         } counters;
     } dentry;
+
+    struct {  //allocated bytes
+        int64_t dentry;
+        int64_t name;
+        int64_t children;
+        int64_t inode_index;
+    } memory;
 } FDIRClientServiceStat;
 
 typedef struct fdir_client_cluster_stat_entry {
@@ -124,6 +162,11 @@ int fdir_client_proto_link_dentry_by_pname(FDIRClientContext *client_ctx,
         const string_t *ns, const FDIRDEntryPName *pname,
         const FDIRClientOwnerModePair *omp, FDIRDEntryInfo *dentry);
 
+int fdir_client_proto_clone_dentry(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id, const int64_t src_inode,
+        const int inode_align, const FDIRDEntryFullName *fullname,
+        const FDIRClientOwnerModePair *omp, FDIRDEntryInfo *dentry);
+
 int fdir_client_proto_remove_dentry_ex(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const uint64_t req_id,
         const FDIRDEntryFullName *fullname, FDIRDEntryInfo *dentry);
@@ -159,6 +202,14 @@ int fdir_client_proto_stat_dentry_by_path(FDIRClientContext *client_ctx,
 int fdir_client_proto_stat_dentry_by_inode(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const int64_t inode, FDIRDEntryInfo *dentry);
 
+int fdir_client_proto_stat_dentry_usage_by_path(FDIRClientContext
+        *client_ctx, ConnectionInfo *conn, const FDIRDEntryFullName
+        *fullname, FDIRDEntryInfo *dentry, FDIRSubtreeSummary *usage);
+
+int fdir_client_proto_stat_dentry_usage_by_inode(FDIRClientContext
+        *client_ctx, ConnectionInfo *conn, const int64_t inode,
+        FDIRDEntryInfo *dentry, FDIRSubtreeSummary *usage);
+
 int fdir_client_proto_stat_dentry_by_pname(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const FDIRDEntryPName *pname,
         const int enoent_log_level, FDIRDEntryInfo *dentry);
@@ -180,10 +231,30 @@ int fdir_client_proto_set_dentry_size(FDIRClientContext *client_ctx,
         const string_t *ns, const FDIRSetDEntrySizeInfo *dsize,
         FDIRDEntryInfo *dentry);
 
+int fdir_client_proto_reserve_append(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id, const string_t *ns,
+        const int64_t inode, const int64_t length, FDIRDEntryInfo *dentry);
+
 int fdir_client_proto_batch_set_dentry_size(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const uint64_t req_id, const string_t *ns,
         const FDIRSetDEntrySizeInfo *dsizes, const int count);
 
+int fdir_client_proto_batch_dentry_ops(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id, const string_t *ns,
+        FDIRClientBatchDEntryOp *ops, const int count);
+
+int fdir_client_proto_subtree_ops(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id, const string_t *ns,
+        FDIRClientSubtreeOp *op);
+
+int fdir_client_proto_subtree_summary(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const string_t *ns, FDIRClientSubtreeOp *op);
+
+int fdir_client_proto_drain_trash(FDIRClientContext *client_ctx,
+        ConnectionInfo *conn, const string_t *ns,
+        const int64_t purge_version, FDIRSubtreeFile *files,
+        int *count, int64_t *last_version);
+
 int fdir_client_proto_modify_dentry_stat(FDIRClientContext *client_ctx,
         ConnectionInfo *conn, const uint64_t req_id,
         const string_t *ns, const int64_t inode, const int64_t flags,
@@ -246,6 +317,10 @@ void fdir_client_dentry_array_free(FDIRClientDentryArray *array);
 int fdir_client_service_stat(FDIRClientContext *client_ctx,
         const ConnectionInfo *spec_conn, FDIRClientServiceStat *stat);
 
+int fdir_client_get_metrics(FDIRClientContext *client_ctx,
+        const ConnectionInfo *spec_conn, SFMetricsItemInfo *items,
+        const int size, int *count);
+
 int fdir_client_cluster_stat(FDIRClientContext *client_ctx,
         FDIRClientClusterStatEntry *stats, const int size, int *count);
 
@@ -108,6 +108,7 @@ typedef struct fdir_client_context {
     int connect_timeout;
     int network_timeout;
     SFNetRetryConfig net_retry_cfg;
+    volatile int64_t data_version;  //the data version of the last update
 } FDIRClientContext;
 
 #endif
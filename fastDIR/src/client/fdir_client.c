@@ -93,6 +93,18 @@ int fdir_client_link_dentry_by_pname(FDIRClientContext *client_ctx,
             pname, omp, dentry);
 }
 
+int fdir_client_clone_dentry(FDIRClientContext *client_ctx,
+        const int64_t src_inode, const int inode_align,
+        const FDIRDEntryFullName *fullname,
+        const FDIRClientOwnerModePair *omp, FDIRDEntryInfo *dentry)
+{
+    const FDIRConnectionParameters *connection_params;
+
+    SF_CLIENT_IDEMPOTENCY_UPDATE_WRAPPER(client_ctx, GET_MASTER_CONNECTION,
+            NULL, fdir_client_proto_clone_dentry, src_inode, inode_align,
+            fullname, omp, dentry);
+}
+
 int fdir_client_remove_dentry_ex(FDIRClientContext *client_ctx,
         const FDIRDEntryFullName *fullname, FDIRDEntryInfo *dentry)
 {
@@ -146,6 +158,16 @@ int fdir_client_set_dentry_size(FDIRClientContext *client_ctx,
             NULL, fdir_client_proto_set_dentry_size, ns, dsize, dentry);
 }
 
+int fdir_client_reserve_append_ex(FDIRClientContext *client_ctx,
+        const string_t *ns, const int64_t inode, const int64_t length,
+        FDIRDEntryInfo *dentry)
+{
+    const FDIRConnectionParameters *connection_params;
+
+    SF_CLIENT_IDEMPOTENCY_UPDATE_WRAPPER(client_ctx, GET_MASTER_CONNECTION,
+            NULL, fdir_client_proto_reserve_append, ns, inode, length, dentry);
+}
+
 int fdir_client_batch_set_dentry_size(FDIRClientContext *client_ctx,
         const string_t *ns, const FDIRSetDEntrySizeInfo *dsizes,
         const int count)
@@ -156,6 +178,96 @@ int fdir_client_batch_set_dentry_size(FDIRClientContext *client_ctx,
             NULL, fdir_client_proto_batch_set_dentry_size, ns, dsizes, count);
 }
 
+int fdir_client_batch_dentry_ops(FDIRClientContext *client_ctx,
+        const string_t *ns, FDIRClientBatchDEntryOp *ops, const int count)
+{
+    const FDIRConnectionParameters *connection_params;
+
+    SF_CLIENT_IDEMPOTENCY_UPDATE_WRAPPER(client_ctx, GET_MASTER_CONNECTION,
+            NULL, fdir_client_proto_batch_dentry_ops, ns, ops, count);
+}
+
+static int subtree_summary(FDIRClientContext *client_ctx,
+        const string_t *ns, FDIRClientSubtreeOp *op)
+{
+    SF_CLIENT_IDEMPOTENCY_QUERY_WRAPPER(client_ctx, GET_READABLE_CONNECTION,
+            NULL, fdir_client_proto_subtree_summary, ns, op);
+}
+
+int fdir_client_subtree_ops(FDIRClientContext *client_ctx,
+        const string_t *ns, FDIRClientSubtreeOp *op)
+{
+    const FDIRConnectionParameters *connection_params;
+
+    if (op->op_type == FDIR_SUBTREE_OP_SUMMARY) {
+        return subtree_summary(client_ctx, ns, op);
+    }
+
+    SF_CLIENT_IDEMPOTENCY_UPDATE_WRAPPER(client_ctx, GET_MASTER_CONNECTION,
+            NULL, fdir_client_proto_subtree_ops, ns, op);
+}
+
+int fdir_client_drain_trash(FDIRClientContext *client_ctx,
+        const string_t *ns, const int64_t purge_version,
+        FDIRSubtreeFile *files, int *count, int64_t *last_version)
+{
+    SF_CLIENT_IDEMPOTENCY_QUERY_WRAPPER(client_ctx, GET_MASTER_CONNECTION,
+            NULL, fdir_client_proto_drain_trash, ns, purge_version,
+            files, count, last_version);
+}
+
+int fdir_client_batch_create_dentry_by_pname(FDIRClientContext *client_ctx,
+        const string_t *ns, const FDIRDEntryPName *pnames,
+        const FDIRClientOwnerModePair *omps, const int count,
+        FDIRDEntryInfo *dentries, int *results)
+{
+    FDIRClientBatchDEntryOp *ops;
+    FDIRClientBatchDEntryOp *op;
+    FDIRClientBatchDEntryOp *end;
+    int result;
+    int start;
+    int batch;
+    int i;
+
+    if (count <= 0) {
+        return 0;
+    }
+
+    batch = FC_MIN(count, FDIR_BATCH_DENTRY_OPS_MAX_COUNT);
+    ops = (FDIRClientBatchDEntryOp *)fc_malloc(
+            sizeof(FDIRClientBatchDEntryOp) * batch);
+    if (ops == NULL) {
+        return ENOMEM;
+    }
+
+    result = 0;
+    for (start=0; start<count; start+=batch) {
+        batch = FC_MIN(count - start, FDIR_BATCH_DENTRY_OPS_MAX_COUNT);
+        end = ops + batch;
+        for (op=ops, i=start; op<end; op++, i++) {
+            op->op_type = FDIR_BATCH_DENTRY_OP_CREATE;
+            op->pname = pnames[i];
+            op->stat.mode = omps[i].mode;
+            op->stat.uid = omps[i].uid;
+            op->stat.gid = omps[i].gid;
+        }
+
+        if ((result=fdir_client_batch_dentry_ops(client_ctx,
+                        ns, ops, batch)) != 0)
+        {
+            break;
+        }
+
+        for (op=ops, i=start; op<end; op++, i++) {
+            results[i] = op->result;
+            dentries[i] = op->dentry;
+        }
+    }
+
+    free(ops);
+    return result;
+}
+
 int fdir_client_modify_dentry_stat(FDIRClientContext *client_ctx,
         const string_t *ns, const int64_t inode, const int64_t flags,
         const FDIRDEntryStatus *stat, FDIRDEntryInfo *dentry)
@@ -219,6 +331,24 @@ int fdir_client_stat_dentry_by_pname_ex(FDIRClientContext *client_ctx,
             enoent_log_level, dentry);
 }
 
+int fdir_client_stat_dentry_usage_by_path(FDIRClientContext *client_ctx,
+        const FDIRDEntryFullName *fullname, FDIRDEntryInfo *dentry,
+        FDIRSubtreeSummary *usage)
+{
+    SF_CLIENT_IDEMPOTENCY_QUERY_WRAPPER(client_ctx, GET_READABLE_CONNECTION,
+            NULL, fdir_client_proto_stat_dentry_usage_by_path, fullname,
+            dentry, usage);
+}
+
+int fdir_client_stat_dentry_usage_by_inode(FDIRClientContext *client_ctx,
+        const int64_t inode, FDIRDEntryInfo *dentry,
+        FDIRSubtreeSummary *usage)
+{
+    SF_CLIENT_IDEMPOTENCY_QUERY_WRAPPER(client_ctx, GET_READABLE_CONNECTION,
+            NULL, fdir_client_proto_stat_dentry_usage_by_inode, inode,
+            dentry, usage);
+}
+
 int fdir_client_readlink_by_path(FDIRClientContext *client_ctx,
         const FDIRDEntryFullName *fullname, string_t *link, const int size)
 {
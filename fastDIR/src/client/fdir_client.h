@@ -54,6 +54,13 @@ int fdir_client_link_dentry_by_pname(FDIRClientContext *client_ctx,
         const FDIRDEntryPName *pname, const FDIRClientOwnerModePair *omp,
         FDIRDEntryInfo *dentry);
 
+/* create a regular file which inode % inode_align == src_inode % inode_align,
+ * the data of the source file is not touched */
+int fdir_client_clone_dentry(FDIRClientContext *client_ctx,
+        const int64_t src_inode, const int inode_align,
+        const FDIRDEntryFullName *fullname,
+        const FDIRClientOwnerModePair *omp, FDIRDEntryInfo *dentry);
+
 int fdir_client_remove_dentry_ex(FDIRClientContext *client_ctx,
         const FDIRDEntryFullName *fullname, FDIRDEntryInfo *dentry);
 
@@ -117,6 +124,53 @@ int fdir_client_batch_set_dentry_size(FDIRClientContext *client_ctx,
         const string_t *ns, const FDIRSetDEntrySizeInfo *dsizes,
         const int count);
 
+/* reserve the append range and increase the file size atomically,
+ * the reserved range is [dentry->stat.size - length, dentry->stat.size) */
+int fdir_client_reserve_append_ex(FDIRClientContext *client_ctx,
+        const string_t *ns, const int64_t inode, const int64_t length,
+        FDIRDEntryInfo *dentry);
+
+static inline int fdir_client_reserve_append(FDIRClientContext *client_ctx,
+        const string_t *ns, const int64_t inode, const int64_t length,
+        int64_t *offset)
+{
+    FDIRDEntryInfo dentry;
+    int result;
+
+    if ((result=fdir_client_reserve_append_ex(client_ctx, ns,
+                    inode, length, &dentry)) == 0)
+    {
+        *offset = dentry.stat.size - length;
+    }
+    return result;
+}
+
+/* do create / stat / modify stat / remove operations in one request,
+ * the result and dentry of each operation are set to ops */
+int fdir_client_batch_dentry_ops(FDIRClientContext *client_ctx,
+        const string_t *ns, FDIRClientBatchDEntryOp *ops, const int count);
+
+/* create dentries by pname in batch, the count can be larger than
+ * FDIR_BATCH_DENTRY_OPS_MAX_COUNT
+ * return errno of the request, the errno of each dentry set to results */
+int fdir_client_batch_create_dentry_by_pname(FDIRClientContext *client_ctx,
+        const string_t *ns, const FDIRDEntryPName *pnames,
+        const FDIRClientOwnerModePair *omps, const int count,
+        FDIRDEntryInfo *dentries, int *results);
+
+/* deal one batch of the subtree operation by the server, the cursor
+ * of op is set for the next batch until op->finished is true */
+int fdir_client_subtree_ops(FDIRClientContext *client_ctx,
+        const string_t *ns, FDIRClientSubtreeOp *op);
+
+/* purge the freed files of the namespace trash not greater than the purge
+ * version which data deleted, then list the files from the beginning.
+ * the files array MUST hold FDIR_DRAIN_TRASH_MAX_COUNT entries, the
+ * last version is the purge version of the next drain */
+int fdir_client_drain_trash(FDIRClientContext *client_ctx,
+        const string_t *ns, const int64_t purge_version,
+        FDIRSubtreeFile *files, int *count, int64_t *last_version);
+
 int fdir_client_modify_dentry_stat(FDIRClientContext *client_ctx,
         const string_t *ns, const int64_t inode, const int64_t flags,
         const FDIRDEntryStatus *stat, FDIRDEntryInfo *dentry);
@@ -157,6 +211,16 @@ int fdir_client_stat_dentry_by_pname_ex(FDIRClientContext *client_ctx,
 int fdir_client_stat_dentry_by_inode(FDIRClientContext *client_ctx,
         const int64_t inode, FDIRDEntryInfo *dentry);
 
+/* the stat and the recursive usage of the directory
+ * (files, dirs, bytes and alloc), maintained by the server */
+int fdir_client_stat_dentry_usage_by_path(FDIRClientContext *client_ctx,
+        const FDIRDEntryFullName *fullname, FDIRDEntryInfo *dentry,
+        FDIRSubtreeSummary *usage);
+
+int fdir_client_stat_dentry_usage_by_inode(FDIRClientContext *client_ctx,
+        const int64_t inode, FDIRDEntryInfo *dentry,
+        FDIRSubtreeSummary *usage);
+
 int fdir_client_readlink_by_path(FDIRClientContext *client_ctx,
         const FDIRDEntryFullName *fullname, string_t *link, const int size);
 
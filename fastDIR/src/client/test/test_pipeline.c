@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/sockopt.h"
+#include "sf/sf_proto.h"
+#include "fastdir/client/fdir_client.h"
+
+#define MAX_REQUEST_COUNT  (64 * 1024)
+#define REQUEST_SIZE  (sizeof(FDIRProtoHeader) + 8)
+
+static void usage(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [-c config_filename = "
+            "/etc/fastcfs/fdir/client.conf] [-t thread count = 8] "
+            "[-C request count per thread = 1024] <-n namespace> <path>\n\n"
+            "send the stat requests of the path with the request tags "
+            "in a batch per connection,\nthen check every tag is "
+            "answered once\n", argv[0]);
+}
+
+static ConnectionInfo server;
+static int64_t inode;
+static int request_count = 1024;
+static int connect_timeout;
+static int network_timeout;
+static volatile int fail_count = 0;
+static volatile int64_t out_of_order_count = 0;
+
+static int check_responses(ConnectionInfo *conn, char *seen)
+{
+    FDIRProtoHeader header;
+    char body[1024];
+    int64_t out_of_order;
+    int last_tag;
+    int tag;
+    int body_len;
+    int status;
+    int result;
+    int i;
+
+    out_of_order = 0;
+    last_tag = -1;
+    for (i=0; i<request_count; i++) {
+        if ((result=tcprecvdata_nb(conn->sock, &header, sizeof(header),
+                        network_timeout)) != 0)
+        {
+            fprintf(stderr, "recv header fail, errno: %d, "
+                    "error info: %s\n", result, STRERROR(result));
+            return result;
+        }
+
+        body_len = buff2int(header.body_len);
+        if (body_len < 0 || body_len > (int)sizeof(body)) {
+            fprintf(stderr, "invalid body length: %d\n", body_len);
+            return EINVAL;
+        }
+        if (body_len > 0 && (result=tcprecvdata_nb(conn->sock, body,
+                        body_len, network_timeout)) != 0)
+        {
+            fprintf(stderr, "recv body fail, errno: %d, "
+                    "error info: %s\n", result, STRERROR(result));
+            return result;
+        }
+
+        status = buff2short(header.status);
+        tag = SF_PROTO_GET_TAG(&header);
+        if (header.cmd != FDIR_SERVICE_PROTO_STAT_BY_INODE_RESP ||
+                status != 0 || tag >= request_count || seen[tag])
+        {
+            fprintf(stderr, "invalid response, cmd: %d, status: %d, "
+                    "tag: %d, answered: %d\n", header.cmd, status,
+                    tag, tag < request_count ? seen[tag] : 0);
+            return EINVAL;
+        }
+
+        seen[tag] = 1;
+        if (tag < last_tag) {
+            out_of_order++;
+        }
+        last_tag = tag;
+    }
+
+    __sync_add_and_fetch(&out_of_order_count, out_of_order);
+
+    //the server MUST close the connection without any more response
+    shutdown(conn->sock, SHUT_WR);
+    if ((result=tcprecvdata_nb(conn->sock, &header, 1,
+                    network_timeout)) == 0)
+    {
+        fprintf(stderr, "unexpected response after all answered\n");
+        return EINVAL;
+    }
+    return 0;
+}
+
+static void *thread_func(void *args)
+{
+    ConnectionInfo conn;
+    FDIRProtoHeader *header;
+    char *buff;
+    char *seen;
+    char *p;
+    int result;
+    int i;
+
+    conn = server;
+    conn.sock = -1;
+    buff = (char *)fc_calloc(request_count, REQUEST_SIZE);
+    seen = (char *)fc_calloc(1, request_count);
+    do {
+        if (buff == NULL || seen == NULL) {
+            result = ENOMEM;
+            break;
+        }
+
+        if ((result=conn_pool_connect_server(&conn,
+                        connect_timeout)) != 0)
+        {
+            break;
+        }
+
+        p = buff;
+        for (i=0; i<request_count; i++) {
+            header = (FDIRProtoHeader *)p;
+            SF_PROTO_SET_HEADER(header, FDIR_SERVICE_PROTO_STAT_BY_INODE_REQ, 8);
+            SF_PROTO_SET_TAG(header, i);
+            long2buff(inode, p + sizeof(FDIRProtoHeader));
+            p += REQUEST_SIZE;
+        }
+
+        if ((result=tcpsenddata_nb(conn.sock, buff, p - buff,
+                        network_timeout)) != 0)
+        {
+            fprintf(stderr, "send fail, errno: %d, error info: %s\n",
+                    result, STRERROR(result));
+            break;
+        }
+
+        result = check_responses(&conn, seen);
+    } while (0);
+
+    if (conn.sock >= 0) {
+        conn_pool_disconnect_server(&conn);
+    }
+    if (result != 0) {
+        __sync_add_and_fetch(&fail_count, 1);
+    }
+    free(buff);
+    free(seen);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *config_filename = "/etc/fastcfs/fdir/client.conf";
+    FDIRDEntryFullName fullname;
+    ConnectionInfo *conn;
+    pthread_t *tids;
+    char *ns = NULL;
+    int threads = 8;
+    int64_t start_time;
+    int ch;
+    int i;
+    int result;
+
+    if (argc < 2) {
+        usage(argv);
+        return 1;
+    }
+
+    while ((ch=getopt(argc, argv, "hc:n:t:C:")) != -1) {
+        switch (ch) {
+            case 'h':
+                usage(argv);
+                return 0;
+            case 'c':
+                config_filename = optarg;
+                break;
+            case 'n':
+                ns = optarg;
+                break;
+            case 't':
+                threads = strtol(optarg, NULL, 10);
+                break;
+            case 'C':
+                request_count = strtol(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv);
+                return 1;
+        }
+    }
+
+    if (ns == NULL || optind >= argc || threads <= 0 ||
+            request_count <= 0 || request_count > MAX_REQUEST_COUNT)
+    {
+        usage(argv);
+        return 1;
+    }
+
+    log_init();
+    if ((result=fdir_client_simple_init(config_filename)) != 0) {
+        return result;
+    }
+
+    FC_SET_STRING(fullname.ns, ns);
+    FC_SET_STRING(fullname.path, argv[optind]);
+    if ((result=fdir_client_lookup_inode_by_path(&g_fdir_client_vars.
+                    client_ctx, &fullname, &inode)) != 0)
+    {
+        return result;
+    }
+
+    //the pipelined requests are answered by the master too
+    if ((conn=g_fdir_client_vars.client_ctx.conn_manager.
+                get_master_connection(&g_fdir_client_vars.
+                    client_ctx, &result)) == NULL)
+    {
+        return result;
+    }
+    server = *conn;
+    connect_timeout = g_fdir_client_vars.client_ctx.connect_timeout;
+    network_timeout = g_fdir_client_vars.client_ctx.network_timeout;
+
+    tids = (pthread_t *)fc_malloc(sizeof(pthread_t) * threads);
+    if (tids == NULL) {
+        return ENOMEM;
+    }
+
+    start_time = get_current_time_ms();
+    for (i=0; i<threads; i++) {
+        if ((result=pthread_create(tids + i, NULL,
+                        thread_func, NULL)) != 0)
+        {
+            fprintf(stderr, "create thread fail, errno: %d, "
+                    "error info: %s\n", result, STRERROR(result));
+            return result;
+        }
+    }
+    for (i=0; i<threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    printf("threads: %d, requests per thread: %d, fail threads: %d, "
+            "out of order responses: %"PRId64", time used: %"PRId64" ms\n",
+            threads, request_count, fail_count, out_of_order_count,
+            get_current_time_ms() - start_time);
+    return fail_count == 0 ? 0 : EIO;
+}
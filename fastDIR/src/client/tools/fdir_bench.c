@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//fdir_bench.c
+
+/* the metadata (create / stat / list / rename) load generator.
+ *
+ * every thread works in its own directory /bench-${pid}/t${index} of the
+ * namespace. the modes are same as fs_bench: closed-loop by default and
+ * open-loop with -R rate > 0 which measures the latency from the
+ * scheduled time */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/fc_memory.h"
+#include "sf/sf_metrics.h"
+#include "fastdir/client/fdir_client.h"
+
+#define FDIR_BENCH_OP_CREATE   0
+#define FDIR_BENCH_OP_STAT     1
+#define FDIR_BENCH_OP_LIST     2
+#define FDIR_BENCH_OP_RENAME   3
+#define FDIR_BENCH_OP_COUNT    4
+
+typedef struct {
+    int index;
+    unsigned int seed;
+    pthread_t tid;
+    int64_t op_count;   //the max op count, 0 for by duration
+    int64_t errors[FDIR_BENCH_OP_COUNT];
+    int file_count;     //the created file count
+    char *renamed;      //the file name is r${i} when renamed[i] is set
+    SFHistogram *histograms;
+    FDIRClientDentryArray array;
+    char dir[64];
+} FDIRBenchThread;
+
+static struct {
+    int thread_count;
+    int percents[FDIR_BENCH_OP_COUNT];
+    int64_t total_ops;
+    int duration;
+    int64_t rate;  //the total request rate per second, 0 for closed-loop
+    int max_files; //per thread
+    string_t ns;
+    FDIRClientOwnerModePair omp;
+    int64_t start_time_us;
+    int64_t end_time_us;
+    FDIRBenchThread *threads;
+} bench_ctx;
+
+static const char *op_captions[FDIR_BENCH_OP_COUNT] = {
+    "create", "stat", "list", "rename"
+};
+
+static void usage(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [-c config_filename] [-n namespace=bench] "
+            "[-t threads=16] [-m create:stat:list:rename percents="
+            "30:50:10:10] [-N total_ops] [-d duration_seconds=10] "
+            "[-R total_rate=0 for closed-loop] "
+            "[-F max_files_per_thread=100000]\n", argv[0]);
+}
+
+static int parse_percents(const char *str)
+{
+    char *parts[FDIR_BENCH_OP_COUNT];
+    char buff[64];
+    int count;
+    int total;
+    int i;
+
+    snprintf(buff, sizeof(buff), "%s", str);
+    count = splitEx(buff, ':', parts, FDIR_BENCH_OP_COUNT);
+    if (count != FDIR_BENCH_OP_COUNT) {
+        fprintf(stderr, "expect %d percents, but %d given\n",
+                FDIR_BENCH_OP_COUNT, count);
+        return EINVAL;
+    }
+
+    total = 0;
+    for (i=0; i<FDIR_BENCH_OP_COUNT; i++) {
+        bench_ctx.percents[i] = strtol(parts[i], NULL, 10);
+        if (bench_ctx.percents[i] < 0) {
+            return EINVAL;
+        }
+        total += bench_ctx.percents[i];
+    }
+    if (total != 100) {
+        fprintf(stderr, "the sum of the percents: %d != 100\n", total);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+static int select_op(FDIRBenchThread *thread)
+{
+    int value;
+    int op;
+
+    value = rand_r(&thread->seed) % 100;
+    for (op=0; op<FDIR_BENCH_OP_COUNT - 1; op++) {
+        if (value < bench_ctx.percents[op]) {
+            break;
+        }
+        value -= bench_ctx.percents[op];
+    }
+
+    if (op == FDIR_BENCH_OP_CREATE) {
+        if (thread->file_count >= bench_ctx.max_files) {
+            op = FDIR_BENCH_OP_STAT;
+        }
+    } else if (op != FDIR_BENCH_OP_LIST && thread->file_count == 0) {
+        op = FDIR_BENCH_OP_CREATE;
+    }
+    return op;
+}
+
+static inline void set_file_path(FDIRBenchThread *thread,
+        const int index, const bool renamed, FDIRDEntryFullName *fullname,
+        char *buff, const int size)
+{
+    fullname->ns = bench_ctx.ns;
+    fullname->path.str = buff;
+    fullname->path.len = snprintf(buff, size, "%s/%c%d",
+            thread->dir, renamed ? 'r' : 'f', index);
+}
+
+static int bench_do_op(FDIRBenchThread *thread, const int op)
+{
+    FDIRDEntryFullName fullname;
+    FDIRDEntryFullName dest;
+    FDIRDEntryInfo dentry;
+    char path[128];
+    char dest_path[128];
+    int index;
+    int result;
+
+    switch (op) {
+        case FDIR_BENCH_OP_CREATE:
+            index = thread->file_count;
+            set_file_path(thread, index, false, &fullname,
+                    path, sizeof(path));
+            if ((result=fdir_client_create_dentry(&g_fdir_client_vars.
+                            client_ctx, &fullname, &bench_ctx.omp,
+                            &dentry)) == 0)
+            {
+                thread->file_count++;
+            }
+            return result;
+        case FDIR_BENCH_OP_STAT:
+            index = rand_r(&thread->seed) % thread->file_count;
+            set_file_path(thread, index, thread->renamed[index],
+                    &fullname, path, sizeof(path));
+            return fdir_client_stat_dentry_by_path(&g_fdir_client_vars.
+                    client_ctx, &fullname, &dentry);
+        case FDIR_BENCH_OP_LIST:
+            fullname.ns = bench_ctx.ns;
+            FC_SET_STRING(fullname.path, thread->dir);
+            return fdir_client_list_dentry_by_path(&g_fdir_client_vars.
+                    client_ctx, &fullname, &thread->array);
+        default:
+            index = rand_r(&thread->seed) % thread->file_count;
+            set_file_path(thread, index, thread->renamed[index],
+                    &fullname, path, sizeof(path));
+            set_file_path(thread, index, !thread->renamed[index],
+                    &dest, dest_path, sizeof(dest_path));
+            if ((result=fdir_client_rename_dentry(&g_fdir_client_vars.
+                            client_ctx, &fullname, &dest, 0)) == 0)
+            {
+                thread->renamed[index] = !thread->renamed[index];
+            }
+            return result;
+    }
+}
+
+static void *bench_thread_func(void *arg)
+{
+    FDIRBenchThread *thread;
+    int64_t interval_us;
+    int64_t scheduled_time_us;
+    int64_t begin_time_us;
+    int64_t current_time_us;
+    int64_t count;
+    int op;
+
+    thread = (FDIRBenchThread *)arg;
+    if (bench_ctx.rate > 0) {
+        interval_us = (1000000LL * bench_ctx.thread_count) / bench_ctx.rate;
+    } else {
+        interval_us = 0;
+    }
+
+    //spread the first requests of the threads in the open-loop mode
+    scheduled_time_us = bench_ctx.start_time_us + (interval_us *
+            thread->index) / bench_ctx.thread_count;
+    for (count=0; thread->op_count == 0 || count < thread->op_count;
+            count++)
+    {
+        current_time_us = get_current_time_us();
+        if (thread->op_count == 0 && current_time_us >=
+                bench_ctx.end_time_us)
+        {
+            break;
+        }
+
+        if (interval_us > 0) {
+            if (scheduled_time_us > current_time_us) {
+                usleep(scheduled_time_us - current_time_us);
+            }
+            begin_time_us = scheduled_time_us;
+            scheduled_time_us += interval_us;
+        } else {
+            begin_time_us = current_time_us;
+        }
+
+        op = select_op(thread);
+        if (bench_do_op(thread, op) != 0) {
+            thread->errors[op]++;
+            continue;
+        }
+        sf_histogram_add(thread->histograms + op,
+                get_current_time_us() - begin_time_us);
+    }
+
+    return NULL;
+}
+
+static int bench_mkdir(const char *path)
+{
+    FDIRDEntryFullName fullname;
+    FDIRClientOwnerModePair omp;
+    FDIRDEntryInfo dentry;
+    int result;
+
+    omp.mode = 0755 | S_IFDIR;
+    omp.uid = bench_ctx.omp.uid;
+    omp.gid = bench_ctx.omp.gid;
+    fullname.ns = bench_ctx.ns;
+    FC_SET_STRING(fullname.path, (char *)path);
+    if (fdir_client_stat_dentry_by_path_ex(&g_fdir_client_vars.client_ctx,
+                &fullname, LOG_DEBUG, &dentry) == 0)
+    {
+        return 0;
+    }
+
+    result = fdir_client_create_dentry(&g_fdir_client_vars.client_ctx,
+            &fullname, &omp, &dentry);
+    return (result == EEXIST) ? 0 : result;
+}
+
+static int bench_init_threads()
+{
+    FDIRBenchThread *thread;
+    FDIRBenchThread *end;
+    char root[32];
+    int bytes;
+    int result;
+
+    //the root dentry of the new namespace should be created first
+    if ((result=bench_mkdir("/")) != 0) {
+        return result;
+    }
+    sprintf(root, "/bench-%d", (int)getpid());
+    if ((result=bench_mkdir(root)) != 0) {
+        return result;
+    }
+
+    bytes = sizeof(FDIRBenchThread) * bench_ctx.thread_count;
+    if ((bench_ctx.threads=(FDIRBenchThread *)fc_malloc(bytes)) == NULL) {
+        return ENOMEM;
+    }
+    memset(bench_ctx.threads, 0, bytes);
+
+    end = bench_ctx.threads + bench_ctx.thread_count;
+    for (thread=bench_ctx.threads; thread<end; thread++) {
+        thread->index = thread - bench_ctx.threads;
+        thread->seed = getpid() ^ (thread->index * 7919) ^ time(NULL);
+        if (bench_ctx.total_ops > 0) {
+            thread->op_count = bench_ctx.total_ops / bench_ctx.thread_count;
+            if (thread->index < bench_ctx.total_ops %
+                    bench_ctx.thread_count)
+            {
+                thread->op_count++;
+            }
+            if (thread->op_count == 0) {
+                thread->op_count = -1;  //nothing to do
+            }
+        }
+
+        thread->histograms = (SFHistogram *)fc_calloc(
+                FDIR_BENCH_OP_COUNT, sizeof(SFHistogram));
+        if (thread->histograms == NULL) {
+            return ENOMEM;
+        }
+        if ((thread->renamed=(char *)fc_calloc(1,
+                        bench_ctx.max_files)) == NULL)
+        {
+            return ENOMEM;
+        }
+        if ((result=fdir_client_dentry_array_init(&thread->array)) != 0) {
+            return result;
+        }
+
+        snprintf(thread->dir, sizeof(thread->dir), "%s/t%d",
+                root, thread->index);
+        if ((result=bench_mkdir(thread->dir)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static int bench_run_threads()
+{
+    FDIRBenchThread *thread;
+    FDIRBenchThread *end;
+    int result;
+
+    end = bench_ctx.threads + bench_ctx.thread_count;
+    for (thread=bench_ctx.threads; thread<end; thread++) {
+        if ((result=pthread_create(&thread->tid, NULL,
+                        bench_thread_func, thread)) != 0)
+        {
+            logError("file: "__FILE__", line: %d, "
+                    "create thread fail, errno: %d, error info: %s",
+                    __LINE__, result, STRERROR(result));
+            bench_ctx.thread_count = thread - bench_ctx.threads;
+            end = thread;
+            break;
+        }
+    }
+
+    for (thread=bench_ctx.threads; thread<end; thread++) {
+        pthread_join(thread->tid, NULL);
+    }
+    return (end == bench_ctx.threads) ? EAGAIN : 0;
+}
+
+static void bench_output(const int64_t time_used_us)
+{
+    SFHistogram *histogram;
+    SFMetricsSummary summary;
+    FDIRBenchThread *thread;
+    FDIRBenchThread *end;
+    int64_t errors;
+    double seconds;
+    int op;
+
+    if ((histogram=(SFHistogram *)fc_malloc(sizeof(SFHistogram))) == NULL) {
+        return;
+    }
+
+    seconds = time_used_us > 0 ? time_used_us / 1000000.00 : 1.00;
+    printf("mode: %s, threads: %d, percents: %d:%d:%d:%d, "
+            "time used: %.3f s\n\n", bench_ctx.rate > 0 ? "open-loop" :
+            "closed-loop", bench_ctx.thread_count, bench_ctx.percents[0],
+            bench_ctx.percents[1], bench_ctx.percents[2],
+            bench_ctx.percents[3], seconds);
+    printf("%-6s %10s %10s %10s %10s %10s %10s %10s %8s\n",
+            "op", "count", "ops/s", "avg(us)", "p50(us)",
+            "p99(us)", "p999(us)", "max(us)", "errors");
+
+    end = bench_ctx.threads + bench_ctx.thread_count;
+    for (op=0; op<FDIR_BENCH_OP_COUNT; op++) {
+        memset(histogram, 0, sizeof(SFHistogram));
+        errors = 0;
+        for (thread=bench_ctx.threads; thread<end; thread++) {
+            sf_histogram_merge(histogram, thread->histograms + op);
+            errors += thread->errors[op];
+        }
+
+        sf_histogram_summary(histogram, &summary);
+        printf("%-6s %10"PRId64" %10.0f %10"PRId64" %10"PRId64
+                " %10"PRId64" %10"PRId64" %10"PRId64" %8"PRId64"\n",
+                op_captions[op], summary.count, summary.count / seconds,
+                summary.count > 0 ? summary.sum / summary.count : 0,
+                summary.p50, summary.p99, summary.p999,
+                summary.max, errors);
+    }
+
+    free(histogram);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *config_filename = "/etc/fastcfs/fdir/client.conf";
+    const int max_idle_time = 3600;
+    char *ns;
+    int ch;
+    int result;
+    int64_t time_used_us;
+    char *endptr;
+
+    ns = "bench";
+    bench_ctx.thread_count = 16;
+    bench_ctx.total_ops = 0;
+    bench_ctx.duration = 10;
+    bench_ctx.rate = 0;
+    bench_ctx.max_files = 100000;
+    parse_percents("30:50:10:10");
+    while ((ch=getopt(argc, argv, "hc:n:t:m:N:d:R:F:")) != -1) {
+        switch (ch) {
+            case 'h':
+                usage(argv);
+                return 0;
+            case 'c':
+                config_filename = optarg;
+                break;
+            case 'n':
+                ns = optarg;
+                break;
+            case 't':
+                bench_ctx.thread_count = strtol(optarg, &endptr, 10);
+                break;
+            case 'm':
+                if (parse_percents(optarg) != 0) {
+                    usage(argv);
+                    return EINVAL;
+                }
+                break;
+            case 'N':
+                bench_ctx.total_ops = strtoll(optarg, &endptr, 10);
+                break;
+            case 'd':
+                bench_ctx.duration = strtol(optarg, &endptr, 10);
+                break;
+            case 'R':
+                bench_ctx.rate = strtoll(optarg, &endptr, 10);
+                break;
+            case 'F':
+                bench_ctx.max_files = strtol(optarg, &endptr, 10);
+                break;
+            default:
+                usage(argv);
+                return EINVAL;
+        }
+    }
+
+    if (bench_ctx.thread_count <= 0 || bench_ctx.duration <= 0 ||
+            bench_ctx.rate < 0 || bench_ctx.max_files <= 0)
+    {
+        usage(argv);
+        return EINVAL;
+    }
+
+    FC_SET_STRING(bench_ctx.ns, ns);
+    bench_ctx.omp.mode = 0644 | S_IFREG;
+    bench_ctx.omp.uid = geteuid();
+    bench_ctx.omp.gid = getegid();
+
+    log_init();
+    if ((result=fdir_client_pooled_init(config_filename,
+                    bench_ctx.thread_count, max_idle_time)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=bench_init_threads()) != 0) {
+        return result;
+    }
+
+    bench_ctx.start_time_us = get_current_time_us();
+    bench_ctx.end_time_us = bench_ctx.start_time_us +
+        bench_ctx.duration * 1000000LL;
+    if ((result=bench_run_threads()) != 0) {
+        return result;
+    }
+    time_used_us = get_current_time_us() - bench_ctx.start_time_us;
+
+    bench_output(time_used_us);
+    return 0;
+}
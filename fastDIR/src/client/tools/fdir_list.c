@@ -26,8 +26,10 @@
 
 static void usage(char *argv[])
 {
-    fprintf(stderr, "Usage: %s [-c config_filename] "
-            "<-n namespace> <path>\n", argv[0]);
+    fprintf(stderr, "Usage: %s [-c config_filename] [-u] "
+            "<-n namespace> <path>\n"
+            "\t-u: output the recursive usage of the entries\n",
+            argv[0]);
 }
 
 static void output_dentry_array(FDIRClientDentryArray *array)
@@ -38,7 +40,15 @@ static void output_dentry_array(FDIRClientDentryArray *array)
     printf("count: %d\n", array->count);
     end = array->entries + array->count;
     for (dentry=array->entries; dentry<end; dentry++) {
-        printf("%.*s\n", dentry->name.len, dentry->name.str);
+        if (array->with_usage) {
+            printf("%.*s files: %"PRId64", dirs: %"PRId64", "
+                    "bytes: %"PRId64", alloc: %"PRId64"\n",
+                    dentry->name.len, dentry->name.str, dentry->usage.files,
+                    dentry->usage.dirs, dentry->usage.bytes,
+                    dentry->usage.alloc);
+        } else {
+            printf("%.*s\n", dentry->name.len, dentry->name.str);
+        }
     }
 }
 
@@ -50,6 +60,7 @@ int main(int argc, char *argv[])
     char *path;
     FDIRDEntryFullName entry_info;
     FDIRClientDentryArray array;
+    bool with_usage;
 	int result;
 
     if (argc < 2) {
@@ -58,7 +69,8 @@ int main(int argc, char *argv[])
     }
 
     ns = NULL;
-    while ((ch=getopt(argc, argv, "hc:n:")) != -1) {
+    with_usage = false;
+    while ((ch=getopt(argc, argv, "hc:n:u")) != -1) {
         switch (ch) {
             case 'h':
                 usage(argv);
@@ -69,6 +81,9 @@ int main(int argc, char *argv[])
             case 'c':
                 config_filename = optarg;
                 break;
+            case 'u':
+                with_usage = true;
+                break;
             default:
                 usage(argv);
                 return 1;
@@ -94,6 +109,7 @@ int main(int argc, char *argv[])
     if ((result=fdir_client_dentry_array_init(&array)) != 0) {
         return result;
     }
+    array.with_usage = with_usage;
 
     if ((result=fdir_client_list_dentry_by_path(&g_fdir_client_vars.client_ctx,
                     &entry_info, &array)) != 0)
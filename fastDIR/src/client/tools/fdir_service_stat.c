@@ -22,16 +22,23 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include "fastcommon/logger.h"
+#include "sf/sf_metrics.h"
 #include "fastdir/client/fdir_client.h"
 
 static void usage(char *argv[])
 {
     fprintf(stderr, "Usage: %s [-c config_filename] "
-            "host[:port]\n", argv[0]);
+            "[-m for latency metrics] host[:port]\n", argv[0]);
 }
 
 static void output(FDIRClientServiceStat *stat)
 {
+    int64_t inode_count;
+    int64_t total_bytes;
+
+    inode_count = stat->dentry.counters.dir + stat->dentry.counters.file;
+    total_bytes = stat->memory.dentry + stat->memory.name +
+        stat->memory.children + stat->memory.inode_index;
     printf( "\tserver_id: %d\n"
             "\tstatus: %d (%s)\n"
             "\tis_master: %s\n"
@@ -40,7 +47,13 @@ static void output(FDIRClientServiceStat *stat)
             "current_inode_sn: %"PRId64", "
             "ns_count: %"PRId64", "
             "dir_count: %"PRId64", "
-            "file_count: %"PRId64"}\n\n",
+            "file_count: %"PRId64"}\n"
+            "\tmemory : {total: %"PRId64", "
+            "dentry: %"PRId64", "
+            "name: %"PRId64", "
+            "children: %"PRId64", "
+            "inode_index: %"PRId64", "
+            "bytes_per_inode: %"PRId64"}\n\n",
             stat->server_id, stat->status,
             fdir_get_server_status_caption(stat->status),
             stat->is_master ? "true" : "false",
@@ -50,17 +63,45 @@ static void output(FDIRClientServiceStat *stat)
             stat->dentry.current_inode_sn,
             stat->dentry.counters.ns,
             stat->dentry.counters.dir,
-            stat->dentry.counters.file
+            stat->dentry.counters.file,
+            total_bytes, stat->memory.dentry,
+            stat->memory.name, stat->memory.children,
+            stat->memory.inode_index, inode_count > 0 ?
+            total_bytes / inode_count : 0
           );
 }
 
+static void output_metrics(const SFMetricsItemInfo *items, const int count)
+{
+    const SFMetricsItemInfo *item;
+    const SFMetricsItemInfo *end;
+
+    printf("\t%-5s %-32s %12s %10s %10s %10s %10s %10s\n",
+            "type", "name", "count", "avg(us)", "p50(us)",
+            "p99(us)", "p999(us)", "max(us)");
+    end = items + count;
+    for (item=items; item<end; item++) {
+        printf("\t%-5s %-32s %12"PRId64" %10"PRId64" %10"PRId64
+                " %10"PRId64" %10"PRId64" %10"PRId64"\n",
+                item->type == SF_METRICS_TYPE_CMD ? "cmd" : "stage",
+                item->name, item->summary.count, item->summary.count > 0 ?
+                item->summary.sum / item->summary.count : 0,
+                item->summary.p50, item->summary.p99,
+                item->summary.p999, item->summary.max);
+    }
+    printf("\n");
+}
+
 int main(int argc, char *argv[])
 {
     const char *config_filename = "/etc/fastcfs/fdir/client.conf";
 	int ch;
+    bool show_metrics;
     char *host;
     ConnectionInfo conn;
     FDIRClientServiceStat stat;
+    SFMetricsItemInfo items[SF_METRICS_MAX_ITEMS];
+    int count;
 	int result;
 
     if (argc < 2) {
@@ -68,7 +109,8 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    while ((ch=getopt(argc, argv, "hc:")) != -1) {
+    show_metrics = false;
+    while ((ch=getopt(argc, argv, "hc:m")) != -1) {
         switch (ch) {
             case 'h':
                 usage(argv);
@@ -76,6 +118,9 @@ int main(int argc, char *argv[])
             case 'c':
                 config_filename = optarg;
                 break;
+            case 'm':
+                show_metrics = true;
+                break;
             default:
                 usage(argv);
                 return 1;
@@ -102,6 +147,16 @@ int main(int argc, char *argv[])
         return result;
     }
 
+    if (show_metrics) {
+        if ((result=fdir_client_get_metrics(&g_fdir_client_vars.client_ctx,
+                        &conn, items, SF_METRICS_MAX_ITEMS, &count)) != 0)
+        {
+            return result;
+        }
+        output_metrics(items, count);
+        return 0;
+    }
+
     if ((result=fdir_client_service_stat(&g_fdir_client_vars.
                     client_ctx, &conn, &stat)) != 0)
     {
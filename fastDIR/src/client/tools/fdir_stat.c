@@ -26,8 +26,10 @@
 
 static void usage(char *argv[])
 {
-    fprintf(stderr, "Usage: %s [-c config_filename] "
-            "<-n namespace> <path>\n", argv[0]);
+    fprintf(stderr, "Usage: %s [-c config_filename] [-u] "
+            "<-n namespace> <path>\n"
+            "\t-u: output the recursive usage of the directory\n",
+            argv[0]);
 }
 
 static void output_dentry_stat(FDIRDEntryInfo *dentry)
@@ -78,6 +80,8 @@ int main(int argc, char *argv[])
     char *path;
     FDIRDEntryFullName fullname;
     FDIRDEntryInfo dentry;
+    FDIRSubtreeSummary du;
+    bool with_usage;
 	int result;
 
     if (argc < 2) {
@@ -86,7 +90,8 @@ int main(int argc, char *argv[])
     }
 
     ns = NULL;
-    while ((ch=getopt(argc, argv, "hc:n:")) != -1) {
+    with_usage = false;
+    while ((ch=getopt(argc, argv, "hc:n:u")) != -1) {
         switch (ch) {
             case 'h':
                 usage(argv);
@@ -97,6 +102,9 @@ int main(int argc, char *argv[])
             case 'c':
                 config_filename = optarg;
                 break;
+            case 'u':
+                with_usage = true;
+                break;
             default:
                 usage(argv);
                 return 1;
@@ -118,11 +126,21 @@ int main(int argc, char *argv[])
 
     FC_SET_STRING(fullname.ns, ns);
     FC_SET_STRING(fullname.path, path);
-    if ((result=fdir_client_stat_dentry_by_path(&g_fdir_client_vars.client_ctx,
-                    &fullname, &dentry)) != 0)
-    {
+    if (with_usage) {
+        result = fdir_client_stat_dentry_usage_by_path(&g_fdir_client_vars.
+                client_ctx, &fullname, &dentry, &du);
+    } else {
+        result = fdir_client_stat_dentry_by_path(&g_fdir_client_vars.
+                client_ctx, &fullname, &dentry);
+    }
+    if (result != 0) {
         return result;
     }
+
     output_dentry_stat(&dentry);
+    if (with_usage) {
+        printf("usage files: %"PRId64", dirs: %"PRId64", bytes: %"PRId64", "
+                "alloc: %"PRId64"\n", du.files, du.dirs, du.bytes, du.alloc);
+    }
     return 0;
 }
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "fastcommon/logger.h"
+#include "fastdir/client/fdir_client.h"
+
+static void usage(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [-c config_filename] [-b batch_size] "
+            "<-n namespace> <-o du | rm | chmod -m mode | "
+            "chown [-u uid] [-g gid]> <path>\n"
+            "\tthe files freed by rm are moved to the namespace trash,\n"
+            "\tthe fcfs client drains the trash and deletes their data\n",
+            argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+	int ch;
+    const char *config_filename = "/etc/fastcfs/fdir/client.conf";
+    char *ns;
+    char *path;
+    char *op_name;
+    char *endptr;
+    FDIRDEntryFullName fullname;
+    FDIRStatModifyFlags mflags;
+    FDIRClientSubtreeOp op;
+    FDIRSubtreeSummary total;
+    int64_t total_count;
+    int64_t total_files;
+    int64_t start_time;
+	int result;
+
+    if (argc < 2) {
+        usage(argv);
+        return 1;
+    }
+
+    ns = NULL;
+    op_name = NULL;
+    memset(&op, 0, sizeof(op));
+    op.limit = FDIR_SUBTREE_OPS_DEFAULT_LIMIT;
+    mflags.flags = 0;
+    while ((ch=getopt(argc, argv, "hc:n:o:b:m:u:g:")) != -1) {
+        switch (ch) {
+            case 'h':
+                usage(argv);
+                return 0;
+            case 'n':
+                ns = optarg;
+                break;
+            case 'c':
+                config_filename = optarg;
+                break;
+            case 'o':
+                op_name = optarg;
+                break;
+            case 'b':
+                op.limit = strtol(optarg, NULL, 10);
+                break;
+            case 'm':
+                op.stat.mode = strtol(optarg, &endptr, 8);
+                if (*endptr != '\0') {
+                    fprintf(stderr, "invalid mode: %s\n", optarg);
+                    return EINVAL;
+                }
+                mflags.mode = 1;
+                break;
+            case 'u':
+                op.stat.uid = strtol(optarg, NULL, 10);
+                mflags.uid = 1;
+                break;
+            case 'g':
+                op.stat.gid = strtol(optarg, NULL, 10);
+                mflags.gid = 1;
+                break;
+            default:
+                usage(argv);
+                return 1;
+        }
+    }
+
+    if (ns == NULL || op_name == NULL || optind >= argc) {
+        usage(argv);
+        return 1;
+    }
+
+    if (strcmp(op_name, "du") == 0) {
+        op.op_type = FDIR_SUBTREE_OP_SUMMARY;
+    } else if (strcmp(op_name, "rm") == 0) {
+        op.op_type = FDIR_SUBTREE_OP_REMOVE;
+    } else if (strcmp(op_name, "chmod") == 0 && mflags.mode) {
+        op.op_type = FDIR_SUBTREE_OP_MODIFY_STAT;
+        mflags.uid = mflags.gid = 0;
+    } else if (strcmp(op_name, "chown") == 0 &&
+            (mflags.uid || mflags.gid))
+    {
+        op.op_type = FDIR_SUBTREE_OP_MODIFY_STAT;
+        mflags.mode = 0;
+    } else {
+        usage(argv);
+        return 1;
+    }
+
+    log_init();
+    //g_log_context.log_level = LOG_DEBUG;
+
+    path = argv[optind];
+    if ((result=fdir_client_simple_init(config_filename)) != 0) {
+        return result;
+    }
+
+    FC_SET_STRING(fullname.ns, ns);
+    FC_SET_STRING(fullname.path, path);
+    if ((result=fdir_client_lookup_inode_by_path(&g_fdir_client_vars.
+                    client_ctx, &fullname, &op.inode)) != 0)
+    {
+        return result;
+    }
+
+    if (op.op_type == FDIR_SUBTREE_OP_MODIFY_STAT) {
+        mflags.ctime = 1;
+        op.stat.ctime = time(NULL);
+        op.flags = mflags.flags;
+    }
+
+    memset(&total, 0, sizeof(total));
+    total_count = total_files = 0;
+    start_time = get_current_time_ms();
+    do {
+        if ((result=fdir_client_subtree_ops(&g_fdir_client_vars.
+                        client_ctx, &fullname.ns, &op)) != 0)
+        {
+            break;
+        }
+
+        total_count += op.count;
+        total_files += op.file_count;
+        total.files += op.summary.files;
+        total.dirs += op.summary.dirs;
+        total.bytes += op.summary.bytes;
+        total.alloc += op.summary.alloc;
+        fprintf(stderr, "\rdealt entries: %"PRId64, total_count);
+    } while (!op.finished);
+    fprintf(stderr, "\n");
+
+    if (result != 0) {
+        fprintf(stderr, "%s %s fail, errno: %d, error info: %s\n",
+                op_name, path, result, STRERROR(result));
+        return result;
+    }
+
+    if (op.op_type == FDIR_SUBTREE_OP_SUMMARY) {
+        printf("files: %"PRId64", dirs: %"PRId64", bytes: %"PRId64", "
+                "alloc: %"PRId64"\n", total.files, total.dirs,
+                total.bytes, total.alloc);
+    } else if (op.op_type == FDIR_SUBTREE_OP_REMOVE) {
+        printf("removed entries: %"PRId64", freed files moved to "
+                "the trash: %"PRId64"\n", total_count, total_files);
+    } else {
+        printf("modified entries: %"PRId64"\n", total_count);
+    }
+    printf("time used: %"PRId64" ms\n", get_current_time_ms() - start_time);
+    return 0;
+}
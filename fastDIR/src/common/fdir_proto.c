@@ -104,6 +104,14 @@ const char *fdir_get_cmd_caption(const int cmd)
             return "RENAME_BY_PNAME_REQ";
         case FDIR_SERVICE_PROTO_RENAME_BY_PNAME_RESP:
             return "RENAME_BY_PNAME_RESP";
+        case FDIR_SERVICE_PROTO_SUBTREE_OPS_REQ:
+            return "SUBTREE_OPS_REQ";
+        case FDIR_SERVICE_PROTO_SUBTREE_OPS_RESP:
+            return "SUBTREE_OPS_RESP";
+        case FDIR_SERVICE_PROTO_SUBTREE_SUMMARY_REQ:
+            return "SUBTREE_SUMMARY_REQ";
+        case FDIR_SERVICE_PROTO_SUBTREE_SUMMARY_RESP:
+            return "SUBTREE_SUMMARY_RESP";
         case FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PATH_REQ:
             return "LOOKUP_INODE_BY_PATH_REQ";
         case FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PATH_RESP:
@@ -184,6 +192,22 @@ const char *fdir_get_cmd_caption(const int cmd)
             return "GET_READABLE_SERVER_REQ";
         case FDIR_SERVICE_PROTO_GET_READABLE_SERVER_RESP:
             return "GET_READABLE_SERVER_RESP";
+        case FDIR_SERVICE_PROTO_BATCH_DENTRY_OPS_REQ:
+            return "BATCH_DENTRY_OPS_REQ";
+        case FDIR_SERVICE_PROTO_BATCH_DENTRY_OPS_RESP:
+            return "BATCH_DENTRY_OPS_RESP";
+        case FDIR_SERVICE_PROTO_RESERVE_APPEND_REQ:
+            return "RESERVE_APPEND_REQ";
+        case FDIR_SERVICE_PROTO_RESERVE_APPEND_RESP:
+            return "RESERVE_APPEND_RESP";
+        case FDIR_SERVICE_PROTO_CLONE_DENTRY_REQ:
+            return "CLONE_DENTRY_REQ";
+        case FDIR_SERVICE_PROTO_CLONE_DENTRY_RESP:
+            return "CLONE_DENTRY_RESP";
+        case FDIR_SERVICE_PROTO_DRAIN_TRASH_REQ:
+            return "DRAIN_TRASH_REQ";
+        case FDIR_SERVICE_PROTO_DRAIN_TRASH_RESP:
+            return "DRAIN_TRASH_RESP";
         case FDIR_CLUSTER_PROTO_GET_SERVER_STATUS_REQ:
             return "GET_SERVER_STATUS_REQ";
         case FDIR_CLUSTER_PROTO_GET_SERVER_STATUS_RESP:
@@ -49,6 +49,13 @@
 #define FDIR_SERVICE_PROTO_RENAME_BY_PNAME_REQ      33
 #define FDIR_SERVICE_PROTO_RENAME_BY_PNAME_RESP     34
 
+/* summary / remove / modify stat of the subtree by the server in batches,
+ * the summary is a query which any readable server answers */
+#define FDIR_SERVICE_PROTO_SUBTREE_OPS_REQ          35
+#define FDIR_SERVICE_PROTO_SUBTREE_OPS_RESP         36
+#define FDIR_SERVICE_PROTO_SUBTREE_SUMMARY_REQ      37
+#define FDIR_SERVICE_PROTO_SUBTREE_SUMMARY_RESP     38
+
 #define FDIR_SERVICE_PROTO_LIST_DENTRY_BY_PATH_REQ    39
 #define FDIR_SERVICE_PROTO_LIST_DENTRY_BY_INODE_REQ   40
 #define FDIR_SERVICE_PROTO_LIST_DENTRY_NEXT_REQ       41
@@ -102,6 +109,23 @@
 #define FDIR_SERVICE_PROTO_GET_READABLE_SERVER_REQ  83
 #define FDIR_SERVICE_PROTO_GET_READABLE_SERVER_RESP 84
 
+/* create / stat / modify stat / remove dentries in one request */
+#define FDIR_SERVICE_PROTO_BATCH_DENTRY_OPS_REQ     85
+#define FDIR_SERVICE_PROTO_BATCH_DENTRY_OPS_RESP    86
+
+/* reserve the append range and increase the file size atomically */
+#define FDIR_SERVICE_PROTO_RESERVE_APPEND_REQ       87
+#define FDIR_SERVICE_PROTO_RESERVE_APPEND_RESP      88
+
+/* create a regular file which inode is aligned with the source file */
+#define FDIR_SERVICE_PROTO_CLONE_DENTRY_REQ         89
+#define FDIR_SERVICE_PROTO_CLONE_DENTRY_RESP        90
+
+/* purge the files of the namespace trash which data deleted by the client,
+ * then list the files of the trash from the beginning */
+#define FDIR_SERVICE_PROTO_DRAIN_TRASH_REQ          99
+#define FDIR_SERVICE_PROTO_DRAIN_TRASH_RESP        100
+
 //cluster commands
 #define FDIR_CLUSTER_PROTO_GET_SERVER_STATUS_REQ    91
 #define FDIR_CLUSTER_PROTO_GET_SERVER_STATUS_RESP   92
@@ -120,6 +144,22 @@
 
 typedef SFCommonProtoHeader  FDIRProtoHeader;
 
+/* the flag of the request header for read-your-writes, the query request
+ * with this flag carries the data version of the client's last update at
+ * the end of the body, the slave responds after this version applied */
+#define FDIR_PROTO_FLAGS_MIN_DATA_VERSION  1
+
+/* the flag of the stat and list request header, the response carries
+ * the recursive usage (FDIRProtoSubtreeSummary) of the directory
+ * after the stat of each dentry */
+#define FDIR_PROTO_FLAGS_WITH_USAGE        2
+
+/* at the end of the successful update response body (the data version
+ * of the update) and the query request body with the above flag */
+typedef struct fdir_proto_data_version_tail {
+    char data_version[8];
+} FDIRProtoDataVersionTail;
+
 typedef struct fdir_proto_client_join_req {
     char flags[4];
     struct {
@@ -199,6 +239,17 @@ typedef struct fdir_proto_hdlink_dentry_by_pname {
     FDIRProtoDEntryByPName dest;
 } FDIRProtoHDLinkDEntryByPName;
 
+typedef struct fdir_proto_clone_dentry_front {
+    FDIRProtoCreateDEntryFront common;
+    char inode_align[4];  //new inode % align == src inode % align
+    char src_inode[8];
+} FDIRProtoCloneDEntryFront;
+
+typedef struct fdir_proto_clone_dentry {
+    FDIRProtoCloneDEntryFront front;
+    FDIRProtoDEntryInfo dest;
+} FDIRProtoCloneDEntry;  //response: FDIRProtoStatDEntryResp
+
 typedef struct fdir_proto_remove_dentry {
     FDIRProtoDEntryInfo dentry;
 } FDIRProtoRemoveDEntry;
@@ -233,6 +284,14 @@ typedef struct fdir_proto_set_dentry_size_req {
     char ns_str[0];       //namespace for hash code
 } FDIRProtoSetDentrySizeReq;
 
+typedef struct fdir_proto_reserve_append_req {
+    char inode[8];
+    char length[8];       //the bytes to append
+    unsigned char ns_len; //namespace length
+    char ns_str[0];       //namespace for hash code
+} FDIRProtoReserveAppendReq;  //response: FDIRProtoStatDEntryResp
+                              //the size is the end of the reserved range
+
 typedef struct fdir_proto_batch_set_dentry_size_req_header {
     char count[4];        //dentry count
     unsigned char ns_len; //namespace length
@@ -269,6 +328,81 @@ typedef struct fdir_proto_modify_dentry_stat_req {
     char ns_str[0];       //namespace for hash code
 } FDIRProtoModifyDentryStatReq;
 
+typedef struct fdir_proto_batch_dentry_ops_req_header {
+    char count[4];        //operation count
+    unsigned char ns_len; //namespace length
+    char ns_str[0];       //namespace for hash code
+} FDIRProtoBatchDEntryOpsReqHeader;
+
+typedef struct fdir_proto_batch_dentry_ops_req_body {
+    char inode[8];   //parent inode for create, stat and remove
+    char mflags[8];  //modify flags for modify stat
+    FDIRProtoDEntryStat stat;  //mode, uid and gid for create
+    unsigned char op_type;
+    unsigned char name_len;    //0 for modify stat
+    char padding[6];
+    char name_str[0];
+} FDIRProtoBatchDEntryOpsReqBody;
+
+typedef struct fdir_proto_batch_dentry_ops_resp_header {
+    char count[4];
+    char success_count[4];
+} FDIRProtoBatchDEntryOpsRespHeader;
+
+typedef struct fdir_proto_batch_dentry_ops_resp_body {
+    char errno_[2];
+    char padding[6];
+    char inode[8];
+    FDIRProtoDEntryStat stat;
+} FDIRProtoBatchDEntryOpsRespBody;
+
+typedef struct fdir_proto_subtree_ops_req {
+    char inode[8];        //the root inode of the subtree
+    char mflags[8];       //modify flags for modify stat
+    FDIRProtoDEntryStat stat;  //mode, uid and gid for modify stat
+    char limit[4];        //the max entries of this batch
+    char cursor_len[2];   //the relative path of the last visited entry
+    unsigned char op_type;
+    unsigned char ns_len; //namespace length
+    char ns_str[0];       //namespace then cursor
+} FDIRProtoSubtreeOpsReq;
+
+typedef struct fdir_proto_subtree_summary {
+    char files[8];
+    char dirs[8];
+    char bytes[8];   //the logical bytes of the regular files
+    char alloc[8];   //the alloc space of the regular files
+} FDIRProtoSubtreeSummary;
+
+typedef struct fdir_proto_subtree_ops_resp {
+    char count[4];        //the entries dealt by this batch
+    char file_count[4];   //the freed files moved to the trash
+    char cursor_len[2];
+    char finished;
+    char padding[5];
+    FDIRProtoSubtreeSummary summary;
+    /* followed by the cursor */
+} FDIRProtoSubtreeOpsResp;
+
+typedef struct fdir_proto_drain_trash_req {
+    char purge_version[8];  //purge the files not greater than it, 0 for none
+    char padding[7];
+    unsigned char ns_len;   //namespace length
+    char ns_str[0];
+} FDIRProtoDrainTrashReq;
+
+typedef struct fdir_proto_drain_trash_resp {
+    char last_version[8];   //the data version of the last listed file
+    char count[4];
+    char padding[4];
+    /* followed by count * FDIRProtoTrashFile */
+} FDIRProtoDrainTrashResp;
+
+typedef struct fdir_proto_trash_file {
+    char inode[8];
+    char size[8];
+} FDIRProtoTrashFile;
+
 typedef struct fdir_proto_lookup_inode_resp {
     char inode[8];
 } FDIRProtoLookupInodeResp;
@@ -286,6 +420,11 @@ typedef struct fdir_proto_stat_dentry_resp {
     FDIRProtoDEntryStat stat;
 } FDIRProtoStatDEntryResp;
 
+typedef struct fdir_proto_update_dentry_resp {
+    FDIRProtoStatDEntryResp dentry;
+    FDIRProtoDataVersionTail tail;
+} FDIRProtoUpdateDEntryResp;
+
 typedef struct fdir_proto_flock_dentry_req {
     char inode[8];
     char offset[8];  /* lock region offset */
@@ -383,6 +522,13 @@ typedef struct fdir_proto_service_stat_resp {
             char file[8];
         } counters;
     } dentry;
+
+    struct {
+        char dentry[8];
+        char name[8];
+        char children[8];
+        char inode_index[8];
+    } memory;
 } FDIRProtoServiceStatResp;
 
 typedef struct fdir_proto_cluster_stat_resp_body_header {
@@ -547,6 +693,24 @@ static inline void fdir_proto_unpack_dentry_stat(const FDIRProtoDEntryStat *
     stat->space_end = buff2long(proto->space_end);
 }
 
+static inline void fdir_proto_pack_subtree_summary(const FDIRSubtreeSummary
+        *summary, FDIRProtoSubtreeSummary *proto)
+{
+    long2buff(summary->files, proto->files);
+    long2buff(summary->dirs, proto->dirs);
+    long2buff(summary->bytes, proto->bytes);
+    long2buff(summary->alloc, proto->alloc);
+}
+
+static inline void fdir_proto_unpack_subtree_summary(
+        const FDIRProtoSubtreeSummary *proto, FDIRSubtreeSummary *summary)
+{
+    summary->files = buff2long(proto->files);
+    summary->dirs = buff2long(proto->dirs);
+    summary->bytes = buff2long(proto->bytes);
+    summary->alloc = buff2long(proto->alloc);
+}
+
 const char *fdir_get_server_status_caption(const int status);
 
 const char *fdir_get_cmd_caption(const int cmd);
@@ -33,6 +33,22 @@
 
 #define FDIR_MAX_PATH_COUNT             128
 #define FDIR_BATCH_SET_MAX_DENTRY_COUNT 256
+#define FDIR_BATCH_DENTRY_OPS_MAX_COUNT 256
+
+#define FDIR_BATCH_DENTRY_OP_CREATE       1  //create by pname
+#define FDIR_BATCH_DENTRY_OP_STAT         2  //stat by pname
+#define FDIR_BATCH_DENTRY_OP_MODIFY_STAT  3  //modify stat by inode
+#define FDIR_BATCH_DENTRY_OP_REMOVE       4  //remove by pname
+
+#define FDIR_SUBTREE_OPS_DEFAULT_LIMIT 1024
+#define FDIR_SUBTREE_OPS_MAX_LIMIT     4096
+
+//the max freed files listed by one drain of the namespace trash
+#define FDIR_DRAIN_TRASH_MAX_COUNT  FDIR_SUBTREE_OPS_MAX_LIMIT
+
+#define FDIR_SUBTREE_OP_SUMMARY      's'  //count files, dirs and bytes
+#define FDIR_SUBTREE_OP_REMOVE       'r'  //remove the children first
+#define FDIR_SUBTREE_OP_MODIFY_STAT  'm'  //modify mode, uid and gid
 
 #define FDIR_SERVER_STATUS_INIT       0
 #define FDIR_SERVER_STATUS_BUILDING  10
@@ -130,6 +146,18 @@ typedef union {
     };
 } FDIRStatModifyFlags;
 
+typedef struct fdir_subtree_summary {
+    int64_t files;   //the entries except directories
+    int64_t dirs;
+    int64_t bytes;   //the logical bytes of the regular files
+    int64_t alloc;   //the alloc space of the regular files
+} FDIRSubtreeSummary;
+
+typedef struct fdir_subtree_file {
+    int64_t inode;
+    int64_t size;
+} FDIRSubtreeFile;  //the freed file in the trash which data should be deleted
+
 typedef struct fdir_set_dentry_size_info {
     uint64_t inode;
     int64_t file_size;
@@ -68,6 +68,10 @@
 #define BINLOG_RECORD_FIELD_NAME_HASH_CODE     "hc"
 #define BINLOG_RECORD_FIELD_NAME_INC_ALLOC     "ia"
 #define BINLOG_RECORD_FIELD_NAME_SRC_INODE     "si"
+#define BINLOG_RECORD_FIELD_NAME_SUBTREE_OP    "so"  //subtree op type
+#define BINLOG_RECORD_FIELD_NAME_LIMIT         "lm"  //entries of the subtree
+#define BINLOG_RECORD_FIELD_NAME_CURSOR        "cs"  //start of the subtree
+#define BINLOG_RECORD_FIELD_NAME_TRASH_VERSION "tv"  //for purge trash
 
 #define BINLOG_RECORD_FIELD_NAME_DEST_PARENT   BINLOG_RECORD_FIELD_NAME_PARENT
 #define BINLOG_RECORD_FIELD_NAME_DEST_SUBNAME  BINLOG_RECORD_FIELD_NAME_SUBNAME
@@ -95,6 +99,10 @@
 #define BINLOG_RECORD_FIELD_INDEX_HASH_CODE     ('h' * 256 + 'c')
 #define BINLOG_RECORD_FIELD_INDEX_INC_ALLOC     ('i' * 256 + 'a')
 #define BINLOG_RECORD_FIELD_INDEX_SRC_INODE     ('s' * 256 + 'i')
+#define BINLOG_RECORD_FIELD_INDEX_SUBTREE_OP    ('s' * 256 + 'o')
+#define BINLOG_RECORD_FIELD_INDEX_LIMIT         ('l' * 256 + 'm')
+#define BINLOG_RECORD_FIELD_INDEX_CURSOR        ('c' * 256 + 's')
+#define BINLOG_RECORD_FIELD_INDEX_TRASH_VERSION ('t' * 256 + 'v')
 
 #define BINLOG_FIELD_TYPE_INTEGER   'i'
 #define BINLOG_FIELD_TYPE_STRING    's'
@@ -147,6 +155,10 @@ static inline const char *get_operation_label(const int operation)
             return BINLOG_OP_RENAME_DENTRY_STR;
         case BINLOG_OP_UPDATE_DENTRY_INT:
             return BINLOG_OP_UPDATE_DENTRY_STR;
+        case BINLOG_OP_SUBTREE_DENTRY_INT:
+            return BINLOG_OP_SUBTREE_DENTRY_STR;
+        case BINLOG_OP_PURGE_TRASH_INT:
+            return BINLOG_OP_PURGE_TRASH_STR;
         default:
             return BINLOG_OP_NONE_STR;
     }
@@ -170,6 +182,14 @@ static inline int get_operation_integer(const string_t *operation)
                 BINLOG_OP_RENAME_DENTRY_LEN))
     {
         return BINLOG_OP_RENAME_DENTRY_INT;
+    } else if (fc_string_equal2(operation, BINLOG_OP_SUBTREE_DENTRY_STR,
+                BINLOG_OP_SUBTREE_DENTRY_LEN))
+    {
+        return BINLOG_OP_SUBTREE_DENTRY_INT;
+    } else if (fc_string_equal2(operation, BINLOG_OP_PURGE_TRASH_STR,
+                BINLOG_OP_PURGE_TRASH_LEN))
+    {
+        return BINLOG_OP_PURGE_TRASH_INT;
     } else {
         return BINLOG_OP_NONE_INT;
     }
@@ -227,6 +247,11 @@ int binlog_pack_record(const FDIRBinlogRecord *record, FastBuffer *buffer)
     if (record->options.link) {
         expect_len += record->link.len;
     }
+    if (record->operation == BINLOG_OP_SUBTREE_DENTRY_INT) {
+        expect_len += record->ns.len + record->subtree.start.len;
+    } else if (record->operation == BINLOG_OP_PURGE_TRASH_INT) {
+        expect_len += record->ns.len;
+    }
     expect_len *= 2;
     if ((result=fast_buffer_check_capacity(buffer, expect_len)) != 0) {
         return result;
@@ -272,6 +297,11 @@ int binlog_pack_record(const FDIRBinlogRecord *record, FastBuffer *buffer)
 
         BINLOG_PACK_STRING(buffer, BINLOG_RECORD_FIELD_NAME_SUBNAME,
                 record->me.pname.name);
+    } else if (record->operation == BINLOG_OP_SUBTREE_DENTRY_INT ||
+            record->operation == BINLOG_OP_PURGE_TRASH_INT)
+    {
+        BINLOG_PACK_STRING(buffer, BINLOG_RECORD_FIELD_NAME_NAMESPACE,
+                record->ns);
     }
 
     fast_buffer_append(buffer, " %s=%u",
@@ -348,6 +378,22 @@ int binlog_pack_record(const FDIRBinlogRecord *record, FastBuffer *buffer)
 
         fast_buffer_append(buffer, " %s=%d",
                 BINLOG_RECORD_FIELD_NAME_FLAGS, record->rename.flags);
+    } else if (record->operation == BINLOG_OP_SUBTREE_DENTRY_INT) {
+        fast_buffer_append(buffer, " %s=%d",
+                BINLOG_RECORD_FIELD_NAME_SUBTREE_OP,
+                record->subtree.op_type);
+
+        fast_buffer_append(buffer, " %s=%d",
+                BINLOG_RECORD_FIELD_NAME_LIMIT, record->subtree.limit);
+
+        if (record->subtree.start.len > 0) {
+            BINLOG_PACK_STRING(buffer, BINLOG_RECORD_FIELD_NAME_CURSOR,
+                    record->subtree.start);
+        }
+    } else if (record->operation == BINLOG_OP_PURGE_TRASH_INT) {
+        fast_buffer_append(buffer, " %s=%"PRId64,
+                BINLOG_RECORD_FIELD_NAME_TRASH_VERSION,
+                record->trash.version);
     }
 
     fast_buffer_append_buff(buffer, BINLOG_RECORD_END_TAG_STR,
@@ -616,6 +662,30 @@ static int binlog_set_field_value(FieldParserContext *pcontext,
                 record->options.src_inode = 1;
             }
             break;
+        case BINLOG_RECORD_FIELD_INDEX_SUBTREE_OP:
+            expect_type = BINLOG_FIELD_TYPE_INTEGER;
+            if (pcontext->fv.type == expect_type) {
+                record->subtree.op_type = pcontext->fv.value.n;
+            }
+            break;
+        case BINLOG_RECORD_FIELD_INDEX_LIMIT:
+            expect_type = BINLOG_FIELD_TYPE_INTEGER;
+            if (pcontext->fv.type == expect_type) {
+                record->subtree.limit = pcontext->fv.value.n;
+            }
+            break;
+        case BINLOG_RECORD_FIELD_INDEX_CURSOR:
+            expect_type = BINLOG_FIELD_TYPE_STRING;
+            if (pcontext->fv.type == expect_type) {
+                record->subtree.start = pcontext->fv.value.s;
+            }
+            break;
+        case BINLOG_RECORD_FIELD_INDEX_TRASH_VERSION:
+            expect_type = BINLOG_FIELD_TYPE_INTEGER;
+            if (pcontext->fv.type == expect_type) {
+                record->trash.version = pcontext->fv.value.n;
+            }
+            break;
         default:
             sprintf(pcontext->error_info, "unkown field name: %.*s",
                     BINLOG_RECORD_FIELD_NAME_LENGTH, pcontext->fv.name);
@@ -633,10 +703,47 @@ static int binlog_set_field_value(FieldParserContext *pcontext,
     return 0;
 }
  
+//for the subtree and the purge trash operations
+static int binlog_check_subtree_fields(FieldParserContext *pcontext,
+        FDIRBinlogRecord *record)
+{
+    if (record->options.path_info.ns == 0) {
+        sprintf(pcontext->error_info, "expect namespace field: %s",
+                BINLOG_RECORD_FIELD_NAME_NAMESPACE);
+        return ENOENT;
+    }
+
+    if (record->operation == BINLOG_OP_PURGE_TRASH_INT) {
+        if (record->trash.version <= 0) {
+            sprintf(pcontext->error_info, "expect trash version field: %s",
+                    BINLOG_RECORD_FIELD_NAME_TRASH_VERSION);
+            return ENOENT;
+        }
+        return 0;
+    }
+
+    if (!(record->subtree.op_type == FDIR_SUBTREE_OP_REMOVE ||
+                record->subtree.op_type == FDIR_SUBTREE_OP_MODIFY_STAT))
+    {
+        sprintf(pcontext->error_info, "expect subtree operation field: %s",
+                BINLOG_RECORD_FIELD_NAME_SUBTREE_OP);
+        return ENOENT;
+    }
+    if (record->subtree.limit <= 0) {
+        sprintf(pcontext->error_info, "expect limit field: %s",
+                BINLOG_RECORD_FIELD_NAME_LIMIT);
+        return ENOENT;
+    }
+
+    return 0;
+}
+
 static int binlog_check_required_fields(FieldParserContext *pcontext,
         FDIRBinlogRecord *record)
 {
-    if (record->inode <= 0) {
+    if (record->inode <= 0 && record->operation !=
+            BINLOG_OP_PURGE_TRASH_INT)
+    {
         sprintf(pcontext->error_info, "expect inode field: %s",
                 BINLOG_RECORD_FIELD_NAME_INODE);
         return ENOENT;
@@ -666,6 +773,13 @@ static int binlog_check_required_fields(FieldParserContext *pcontext,
         return ENOENT;
     }
 
+    //the fields of these operations share the memory of the parent
+    if (record->operation == BINLOG_OP_SUBTREE_DENTRY_INT ||
+            record->operation == BINLOG_OP_PURGE_TRASH_INT)
+    {
+        return binlog_check_subtree_fields(pcontext, record);
+    }
+
     if (record->options.path_info.flags != 0 ||
             record->me.pname.parent_inode != 0)
     {
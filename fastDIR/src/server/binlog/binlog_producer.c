@@ -181,6 +181,8 @@ ServerBinlogRecordBuffer *server_binlog_alloc_hold_rbuffer()
     }
 
     rbuffer->reffer_count = 1;
+    rbuffer->trace.trace_id = 0;
+    rbuffer->trace.flags = 0;
     return rbuffer;
 }
 
@@ -798,6 +798,31 @@ static inline int compare_rename_operation(
     return 0;
 }
 
+static inline int compare_subtree_operation(
+        const FDIRBinlogRecord *r1,
+        const FDIRBinlogRecord *r2)
+{
+    int sub;
+
+    if (r1->operation == BINLOG_OP_SUBTREE_DENTRY_INT) {
+        if ((sub=(int)r1->subtree.op_type -
+                    (int)r2->subtree.op_type) != 0)
+        {
+            return sub;
+        }
+
+        if ((sub=r1->subtree.limit - r2->subtree.limit) != 0) {
+            return sub;
+        }
+
+        return compare_string(&r1->subtree.start, &r2->subtree.start);
+    } else if (r1->operation == BINLOG_OP_PURGE_TRASH_INT) {
+        return fc_compare_int64(r1->trash.version, r2->trash.version);
+    }
+
+    return 0;
+}
+
 static int compare_record(const FDIRBinlogRecord *r1,
         const FDIRBinlogRecord *r2)
 {
@@ -849,6 +874,9 @@ static int compare_record(const FDIRBinlogRecord *r1,
     if ((sub=compare_rename_operation(r1, r2)) != 0) {
         return sub;
     }
+    if ((sub=compare_subtree_operation(r1, r2)) != 0) {
+        return sub;
+    }
 
     return memcmp(&r1->stat, &r2->stat, sizeof(FDIRDEntryStatus));
 }
@@ -170,7 +170,11 @@ int binlog_replay_deal_buffer(BinlogReplayContext *replay_ctx,
             p = rend;
 
             replay_ctx->record_count++;
-            if (record->data_version <= replay_ctx->data_current_version) {
+            if (record->data_version <= replay_ctx->data_current_version ||
+                    record->data_version <= get_data_thread_context(
+                        record->hash_code)->store_context.
+                    checkpoint.data_version)  //covered by the checkpoint
+            {
                 replay_ctx->skip_count++;
                 if (replay_ctx->notify.func != NULL) {
                     replay_ctx->notify.func(0, record, replay_ctx->notify.args);
@@ -532,6 +532,7 @@ static int sync_binlog_from_queue(FDIRSlaveReplication *replication)
     struct fast_task_info *waiting_task;
     FDIRProtoPushBinlogReqBodyHeader *body_header;
     SFVersionRange data_version;
+    SFTraceContext trace;
     int body_len;
     int result;
 
@@ -547,6 +548,8 @@ static int sync_binlog_from_queue(FDIRSlaveReplication *replication)
         return 0;
     }
 
+    trace.trace_id = 0;
+    trace.flags = 0;
     data_version.first = head->data_version.first;
     data_version.last = head->data_version.last;
     replication->task->length = sizeof(FDIRProtoHeader) +
@@ -567,6 +570,9 @@ static int sync_binlog_from_queue(FDIRSlaveReplication *replication)
         memcpy(replication->task->data + replication->task->length,
                 rb->buffer.data, rb->buffer.length);
         replication->task->length += rb->buffer.length;
+        if (!SF_TRACE_SAMPLED(&trace) && SF_TRACE_SAMPLED(&rb->trace)) {
+            trace = rb->trace;  //the push carries the first sampled trace
+        }
 
         if ((result=push_result_ring_add(&replication->context.
                         push_result_ctx, &rb->data_version,
@@ -590,6 +596,11 @@ static int sync_binlog_from_queue(FDIRSlaveReplication *replication)
 
     SF_PROTO_SET_HEADER((FDIRProtoHeader *)replication->task->data,
             FDIR_REPLICA_PROTO_PUSH_BINLOG_REQ, body_len);
+    if (SF_TRACE_SAMPLED(&trace)) {
+        //the push goes untraced when no room for the trace extension
+        sf_proto_insert_trace_ext(replication->task->data, &replication->
+                task->length, replication->task->size, &trace);
+    }
     sf_send_add_event(replication->task);
 
     if (head != NULL) {
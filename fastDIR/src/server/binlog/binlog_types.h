@@ -32,16 +32,36 @@
 #define BINLOG_OP_RENAME_DENTRY_INT  3
 #define BINLOG_OP_UPDATE_DENTRY_INT  4
 
+//one batch of the subtree remove or modify stat, the data thread walks the
+//subtree again when replay, so the entries are not written one by one
+#define BINLOG_OP_SUBTREE_DENTRY_INT 5
+
+//purge the freed files of the namespace trash after their data deleted
+#define BINLOG_OP_PURGE_TRASH_INT    6
+
+//for data thread only, wake up to sync the usage of the resized files
+#define BINLOG_OP_SYNC_USAGE_INT     96
+
+//for data thread only, load the cold directory from the dentry store
+#define BINLOG_OP_LOAD_DENTRY_INT    98
+
+//for data thread only, the sub records are written to binlog one by one
+#define BINLOG_OP_BATCH_DENTRY_INT   99
+
 #define BINLOG_OP_NONE_STR           ""
 #define BINLOG_OP_CREATE_DENTRY_STR  "cr"
 #define BINLOG_OP_REMOVE_DENTRY_STR  "rm"
 #define BINLOG_OP_RENAME_DENTRY_STR  "rn"
 #define BINLOG_OP_UPDATE_DENTRY_STR  "up"
+#define BINLOG_OP_SUBTREE_DENTRY_STR "st"
+#define BINLOG_OP_PURGE_TRASH_STR    "pt"
 
 #define BINLOG_OP_CREATE_DENTRY_LEN  (sizeof(BINLOG_OP_CREATE_DENTRY_STR) - 1)
 #define BINLOG_OP_REMOVE_DENTRY_LEN  (sizeof(BINLOG_OP_REMOVE_DENTRY_STR) - 1)
 #define BINLOG_OP_RENAME_DENTRY_LEN  (sizeof(BINLOG_OP_RENAME_DENTRY_STR) - 1)
 #define BINLOG_OP_UPDATE_DENTRY_LEN  (sizeof(BINLOG_OP_UPDATE_DENTRY_STR) - 1)
+#define BINLOG_OP_SUBTREE_DENTRY_LEN (sizeof(BINLOG_OP_SUBTREE_DENTRY_STR) - 1)
+#define BINLOG_OP_PURGE_TRASH_LEN    (sizeof(BINLOG_OP_PURGE_TRASH_STR) - 1)
 
 #define BINLOG_OPTIONS_PATH_ENABLED  (1 | (1 << 1))
 
@@ -63,6 +83,15 @@ typedef struct {
     FDIRServerDentry *dentry;
 } FDIRRecordDEntry;
 
+//the output of one subtree batch
+typedef struct fdir_subtree_op_context {
+    bool finished;
+    int count;           //the entries dealt by this batch
+    int file_count;      //the freed files moved to the trash
+    FDIRSubtreeSummary summary;
+    BufferInfo cursor;   //the relative path of the last visited entry
+} FDIRSubtreeOpContext;
+
 typedef struct fdir_binlog_record {
     uint64_t data_version;
     int64_t inode;
@@ -87,6 +116,26 @@ typedef struct fdir_binlog_record {
         } hdlink;
 
         FDIRRecordDEntry me;  //for create and remove
+
+        struct {
+            struct fdir_binlog_record **records;
+            short *results;       //errno of each record
+            int count;
+            int success_count;    //records which need write to binlog
+        } batch;
+
+        /* the inode is the root of the subtree, the options and
+         * the stat are the fields to modify */
+        struct {
+            char op_type;
+            int limit;       //the max entries of this batch
+            string_t start;  //the cursor of this batch
+            FDIRSubtreeOpContext *context;  //NULL for binlog replay
+        } subtree;
+
+        struct {
+            int64_t version;  //purge the files not greater than it
+        } trash;
     };
 
     FDIRDEntryStatus stat;
@@ -98,12 +147,16 @@ typedef struct fdir_binlog_record {
         void *args;    //for thread continue deal
     } notify;
 
+    int64_t push_time_us; //for the queue wait time of the data thread
+    SFTraceContext trace; //the trace of the pushing thread
     struct fdir_binlog_record *next; //for data thread queue
 } FDIRBinlogRecord;
 
 typedef struct server_binlog_record_buffer {
     SFVersionRange data_version; //for binlog writer and idempotency (slave only)
     volatile int reffer_count;
+    int64_t push_time_us;   //for the replica ack time
+    SFTraceContext trace;   //the trace of the request (master only)
     void *args;  //for notify & release 
     release_binlog_rbuffer_func release_func;
     FastBuffer buffer;
@@ -126,6 +179,16 @@ static inline const char *get_operation_caption(const int operation)
             return "RENAME";
         case BINLOG_OP_UPDATE_DENTRY_INT:
             return "UPDATE";
+        case BINLOG_OP_SUBTREE_DENTRY_INT:
+            return "SUBTREE";
+        case BINLOG_OP_PURGE_TRASH_INT:
+            return "PURGE_TRASH";
+        case BINLOG_OP_SYNC_USAGE_INT:
+            return "SYNC_USAGE";
+        case BINLOG_OP_LOAD_DENTRY_INT:
+            return "LOAD";
+        case BINLOG_OP_BATCH_DENTRY_INT:
+            return "BATCH";
         default:
             return "UNKOWN";
     }
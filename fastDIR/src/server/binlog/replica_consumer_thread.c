@@ -34,6 +34,7 @@
 #include "sf/sf_nio.h"
 #include "common/fdir_proto.h"
 #include "../server_global.h"
+#include "../version_waiter.h"
 #include "binlog_func.h"
 #include "binlog_reader.h"
 #include "binlog_producer.h"
@@ -396,6 +397,8 @@ static void *deal_binlog_thread_func(void *arg)
             if (binlog_replay_deal_buffer(&ctx->replay_ctx,
                     rb->buffer.data, rb->buffer.length, NULL) == 0)
             {
+                version_waiter_set_applied(ctx->
+                        replay_ctx.data_current_version);
                 if (push_to_binlog_write_queue(rb) != 0) {
                     logCrit("file: "__FILE__", line: %d, "
                             "push_to_binlog_write_queue fail, "
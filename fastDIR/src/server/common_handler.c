@@ -35,6 +35,8 @@
 #include "sf/sf_nio.h"
 #include "sf/sf_global.h"
 #include "sf/sf_util.h"
+#include "sf/sf_metrics.h"
+#include "sf/sf_trace.h"
 #include "common/fdir_proto.h"
 #include "server_global.h"
 #include "common_handler.h"
@@ -111,6 +113,10 @@ int handler_deal_task_done(struct fast_task_info *task)
 
     r = sf_send_add_event(task);
     time_used = get_current_time_us() - TASK_ARG->req_start_time;
+    sf_metrics_record_cmd(REQUEST.header.cmd, time_used);
+    sf_trace_add_span_ex(&REQUEST.header.trace,
+            fdir_get_cmd_caption(REQUEST.header.cmd),
+            TASK_ARG->req_start_time, time_used);
     if (SLOW_LOG_CFG.enabled && time_used >
             SLOW_LOG_CFG.log_slower_than_ms * 1000)
     {
@@ -44,6 +44,8 @@ static inline void handler_init_task_context(struct fast_task_info *task)
     REQUEST.header.cmd = ((FDIRProtoHeader *)task->data)->cmd;
     REQUEST.header.body_len = task->length - sizeof(FDIRProtoHeader);
     REQUEST.header.status = buff2short(((FDIRProtoHeader *)task->data)->status);
+    REQUEST.header.flags = buff2short(((FDIRProtoHeader *)task->data)->flags);
+    REQUEST.header.trace = g_sf_trace_current;  //set by sf_deal_request
     REQUEST.body = task->data + sizeof(FDIRProtoHeader);
 }
 
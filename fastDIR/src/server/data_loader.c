@@ -33,13 +33,46 @@
 #include "server_global.h"
 #include "server_binlog.h"
 #include "data_thread.h"
+#include "dentry_store.h"
+#include "version_waiter.h"
 #include "data_loader.h"
 
+/* start from the record next to the min data version of the checkpoints,
+ * search from the last binlog file which first record is covered */
+static void get_replay_start_position(const int64_t min_version,
+        SFBinlogFilePosition *hint_pos, int64_t *last_data_version)
+{
+    int64_t first_version;
+    int index;
+
+    hint_pos->index = 0;
+    hint_pos->offset = 0;
+    *last_data_version = 0;
+    if (min_version == 0) {
+        return;
+    }
+
+    for (index=binlog_get_current_write_index(); index>=0; index--) {
+        if (binlog_get_first_record_version(index, &first_version) == 0 &&
+                first_version <= min_version)
+        {
+            hint_pos->index = index;
+            *last_data_version = min_version;
+            return;
+        }
+    }
+}
+
 int server_load_data()
 {
     BinlogReplayContext replay_ctx;
     BinlogReadThreadContext reader_ctx;
     BinlogReadThreadResult *r;
+    SFBinlogFilePosition hint_pos;
+    int64_t min_version;
+    int64_t max_version;
+    int64_t last_data_version;
+    int64_t old_version;
     int64_t start_time;
     int64_t end_time;
     char time_buff[32];
@@ -47,8 +80,13 @@ int server_load_data()
 
     start_time = get_current_time_ms();
 
-    if ((result=binlog_read_thread_init(&reader_ctx, NULL, 0,
-                    BINLOG_BUFFER_SIZE)) != 0)
+    if ((result=dentry_store_restore(&min_version, &max_version)) != 0) {
+        return result;
+    }
+
+    get_replay_start_position(min_version, &hint_pos, &last_data_version);
+    if ((result=binlog_read_thread_init(&reader_ctx, &hint_pos,
+                    last_data_version, BINLOG_BUFFER_SIZE)) != 0)
     {
         return result;
     }
@@ -88,6 +126,15 @@ int server_load_data()
     binlog_read_thread_terminate(&reader_ctx);
 
     if (result == 0) {
+        /* the records covered by the checkpoints are skipped */
+        old_version = __sync_add_and_fetch(&DATA_CURRENT_VERSION, 0);
+        if (max_version > old_version) {
+            __sync_bool_compare_and_swap(&DATA_CURRENT_VERSION,
+                    old_version, max_version);
+        }
+
+        version_waiter_set_applied(__sync_add_and_fetch(
+                    &DATA_CURRENT_VERSION, 0));
         end_time = get_current_time_ms();
         logInfo("file: "__FILE__", line: %d, "
                 "load data done. record count: %"PRId64", "
@@ -31,9 +31,14 @@
 #include "fastcommon/sched_thread.h"
 #include "fastcommon/pthread_func.h"
 #include "sf/sf_global.h"
+#include "sf/sf_metrics.h"
 #include "server_global.h"
 #include "dentry.h"
 #include "inode_index.h"
+#include "dentry_store.h"
+#include "dentry_usage.h"
+#include "dentry_trash.h"
+#include "subtree_ops.h"
 #include "data_thread.h"
 
 #define DATA_THREAD_RUNNING_COUNT g_data_thread_vars.running_count
@@ -60,6 +65,41 @@ void data_thread_sum_counters(FDIRDentryCounters *counters)
     }
 }
 
+#define MBLOCK_ALLOC_BYTES(mblock) \
+    ((mblock)->info.element_total_count * GET_BLOCK_SIZE((mblock)->info))
+
+void data_thread_sum_memory_stat(FDIRDentryMemoryStat *mstat)
+{
+    FDIRDataThreadContext *context;
+    FDIRDataThreadContext *end;
+    UniqSkiplistFactory *factory;
+    int i;
+
+    mstat->dentry = 0;
+    mstat->name = 0;
+    mstat->children = 0;
+    end = g_data_thread_vars.thread_array.contexts +
+        g_data_thread_vars.thread_array.count;
+    for (context=g_data_thread_vars.thread_array.contexts;
+            context<end; context++)
+    {
+        mstat->dentry += MBLOCK_ALLOC_BYTES(&context->
+                dentry_context.dentry_allocator) + MBLOCK_ALLOC_BYTES(
+                        &context->usage_context.allocator) +
+            MBLOCK_ALLOC_BYTES(&context->trash_allocator);
+        mstat->name += context->dentry_context.name_acontext.alloc_bytes;
+
+        factory = &context->dentry_context.factory;
+        mstat->children += MBLOCK_ALLOC_BYTES(&factory->skiplist_allocator);
+        for (i=0; i<factory->max_level_count; i++) {
+            mstat->children += MBLOCK_ALLOC_BYTES(
+                    factory->node_allocators + i);
+        }
+    }
+
+    mstat->inode_index = inode_index_memory_bytes();
+}
+
 static inline void add_to_delay_free_queue(ServerDelayFreeContext *pContext,
         ServerDelayFreeNode *node, void *ptr, const int delay_seconds)
 {
@@ -156,6 +196,18 @@ static int init_thread_ctx(FDIRDataThreadContext *context)
         return result;
     }
 
+    if ((result=dentry_store_init_context(context)) != 0) {
+        return result;
+    }
+
+    if ((result=dentry_usage_init_context(context)) != 0) {
+        return result;
+    }
+
+    if ((result=dentry_trash_init_context(context)) != 0) {
+        return result;
+    }
+
     if ((result=fast_mblock_init_ex1(&context->delay_free_context.allocator,
                     "delay_free_node", sizeof(ServerDelayFreeNode), 16 * 1024,
                     0, NULL, NULL, true)) != 0)
@@ -163,7 +215,7 @@ static int init_thread_ctx(FDIRDataThreadContext *context)
         return result;
     }
 
-    if ((result=fc_queue_init(&context->queue, (long)
+    if ((result=fc_mpsc_queue_init(&context->queue, (long)
                     (&((FDIRBinlogRecord *)NULL)->next))) != 0)
     {
         return result;
@@ -190,6 +242,7 @@ static int init_data_thread_array()
     for (context=g_data_thread_vars.thread_array.contexts;
             context<end; context++)
     {
+        context->index = context - g_data_thread_vars.thread_array.contexts;
         if ((result=init_thread_ctx(context)) != 0) {
             return result;
         }
@@ -235,7 +288,7 @@ void data_thread_destroy()
         for (context=g_data_thread_vars.thread_array.contexts;
                 context<end; context++)
         {
-            fc_queue_destroy(&context->queue);
+            fc_mpsc_queue_destroy(&context->queue);
         }
         free(g_data_thread_vars.thread_array.contexts);
         g_data_thread_vars.thread_array.contexts = NULL;
@@ -253,7 +306,7 @@ void data_thread_terminate()
     for (context=g_data_thread_vars.thread_array.contexts;
             context<end; context++)
     {
-        fc_queue_terminate(&context->queue);
+        fc_mpsc_queue_terminate(&context->queue);
     }
 
     count = 0;
@@ -272,11 +325,30 @@ static inline int check_parent(FDIRBinlogRecord *record)
 
     record->me.parent = inode_index_get_dentry(record->
             me.pname.parent_inode);
-    return record->me.parent != NULL ? 0 : ENOENT;
+    if (record->me.parent == NULL) {
+        return ENOENT;
+    }
+
+    /* the parent inode comes from the client, the children of
+     * the dentry are valid for the directory only */
+    if (!S_ISDIR(record->me.parent->stat.mode)) {
+        record->me.parent = NULL;
+        return ENOTDIR;
+    }
+    return 0;
 }
 
-static inline int set_hdlink_src_dentry(FDIRBinlogRecord *record)
+static inline int set_hdlink_src_dentry(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
 {
+    int result;
+
+    if ((result=dentry_store_load_inode(thread_ctx,
+                    record->hdlink.src_inode)) != 0)
+    {
+        return result;
+    }
+
     if ((record->hdlink.src_dentry=inode_index_get_dentry(
                     record->hdlink.src_inode)) == NULL)
     {
@@ -310,54 +382,160 @@ static inline int deal_record_rename_op(FDIRDataThreadContext *thread_ctx,
     return dentry_rename(thread_ctx, record);
 }
 
-static int deal_binlog_one_record(FDIRDataThreadContext *thread_ctx,
-        FDIRBinlogRecord *record)
+//return ENOENT when nothing purged, so no binlog is written
+static int purge_trash(FDIRBinlogRecord *record)
+{
+    FDIRNamespaceEntry *ns_entry;
+
+    if ((ns_entry=dentry_find_namespace(&record->ns)) == NULL) {
+        return ENOENT;
+    }
+    return dentry_trash_purge(ns_entry, record->trash.version) > 0 ?
+        0 : ENOENT;
+}
+
+static int deal_record_operation(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record, int *ignore_errno)
 {
     int result;
-    int ignore_errno;
-    bool set_data_verson;
-    bool is_error;
 
     switch (record->operation) {
         case BINLOG_OP_CREATE_DENTRY_INT:
         case BINLOG_OP_REMOVE_DENTRY_INT:
             if ((result=check_parent(record)) != 0) {
-                ignore_errno = 0;
+                *ignore_errno = 0;
                 break;
             }
             if (record->operation == BINLOG_OP_CREATE_DENTRY_INT) {
                 if (FDIR_IS_DENTRY_HARD_LINK(record->stat.mode)) {
-                    if ((result=set_hdlink_src_dentry(record)) != 0) {
-                        ignore_errno = 0;
+                    if ((result=set_hdlink_src_dentry(
+                                    thread_ctx, record)) != 0)
+                    {
+                        *ignore_errno = 0;
                         break;
                     }
                 }
                 result = dentry_create(thread_ctx, record);
-                ignore_errno = EEXIST;
+                *ignore_errno = EEXIST;
             } else {
                 result = dentry_remove(thread_ctx, record);
-                ignore_errno = ENOENT;
+                *ignore_errno = ENOENT;
             }
             break;
         case BINLOG_OP_RENAME_DENTRY_INT:
-            ignore_errno = 0;
+            *ignore_errno = 0;
             result = deal_record_rename_op(thread_ctx, record);
             break;
         case BINLOG_OP_UPDATE_DENTRY_INT:
+            *ignore_errno = 0;
+            if ((result=dentry_store_load_inode(thread_ctx,
+                            record->inode)) != 0)
+            {
+                break;
+            }
             record->me.dentry = inode_index_update_dentry(record);
             result = (record->me.dentry != NULL) ? 0 : ENOENT;
-            ignore_errno = 0;
+            break;
+        case BINLOG_OP_PURGE_TRASH_INT:
+            *ignore_errno = ENOENT;
+            result = purge_trash(record);
             break;
         default:
-            ignore_errno = 0;
+            *ignore_errno = 0;
             result = 0;
             break;
     }
 
+    return result;
+}
+
+static int get_dentry_by_pname(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
+{
+    int result;
+
+    result = inode_index_get_dentry_by_pname(record->me.pname.parent_inode,
+            &record->me.pname.name, &record->me.dentry);
+    if (result == TASK_STATUS_DENTRY_COLD) {
+        if ((result=dentry_store_load(thread_ctx,
+                        record->me.dentry)) != 0)
+        {
+            record->me.dentry = NULL;
+            return result;
+        }
+        result = inode_index_get_dentry_by_pname(record->me.pname.
+                parent_inode, &record->me.pname.name, &record->me.dentry);
+    }
+
+    return result;
+}
+
+/* the sub records of the batch are dealt in order and the successful
+ * update records are assigned a contiguous data version range, so the
+ * batch can be written to the binlog as one record buffer */
+static void deal_batch_sub_records(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *batch)
+{
+    FDIRBinlogRecord **record;
+    FDIRBinlogRecord **end;
+    short *result;
+    uint64_t data_version;
+    int ignore_errno;
+
+    batch->batch.success_count = 0;
+    end = batch->batch.records + batch->batch.count;
+    for (record=batch->batch.records, result=batch->batch.results;
+            record<end; record++, result++)
+    {
+        if ((*record)->operation == BINLOG_OP_NONE_INT) {  //query only
+            *result = get_dentry_by_pname(thread_ctx, *record);
+            continue;
+        }
+
+        *result = deal_record_operation(thread_ctx, *record, &ignore_errno);
+        if (*result == 0) {
+            batch->batch.success_count++;
+        }
+    }
+
+    if (batch->batch.success_count > 0) {
+        data_version = __sync_add_and_fetch(&DATA_CURRENT_VERSION,
+                batch->batch.success_count) - batch->batch.success_count;
+        for (record=batch->batch.records, result=batch->batch.results;
+                record<end; record++, result++)
+        {
+            if (*result == 0 && (*record)->operation != BINLOG_OP_NONE_INT) {
+                (*record)->data_version = ++data_version;
+            }
+        }
+        thread_ctx->applied_version = data_version;
+    }
+}
+
+static void deal_binlog_batch_records(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *batch)
+{
+    deal_batch_sub_records(thread_ctx, batch);
+    if (batch->notify.func != NULL) {
+        batch->notify.func(batch, 0, false);
+    }
+}
+
+/* assign the data version for the master, or raise the current data
+ * version for the binlog replay, return if the result is an error */
+static bool check_data_version(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record, const int result,
+        const int ignore_errno, const bool need_version)
+{
+    bool set_data_verson;
+    bool is_error;
+
     if (result == 0) {
         if (record->data_version == 0) {
-            record->data_version = __sync_add_and_fetch(
-                    &DATA_CURRENT_VERSION, 1);
+            if (need_version) {
+                record->data_version = __sync_add_and_fetch(
+                        &DATA_CURRENT_VERSION, 1);
+            }
             set_data_verson = false;
         } else {
             set_data_verson = true;
@@ -369,6 +547,10 @@ static int deal_binlog_one_record(FDIRDataThreadContext *thread_ctx,
                 (g_data_thread_vars.error_mode == FDIR_DATA_ERROR_MODE_LOOSE));
     }
 
+    if (record->data_version > thread_ctx->applied_version) {
+        thread_ctx->applied_version = record->data_version;
+    }
+
     if (set_data_verson && !is_error) {
         int64_t old_version;
         old_version = __sync_add_and_fetch(&DATA_CURRENT_VERSION, 0);
@@ -378,6 +560,90 @@ static int deal_binlog_one_record(FDIRDataThreadContext *thread_ctx,
         }
     }
 
+    return is_error;
+}
+
+/* one batch of the subtree is one binlog record with one data version,
+ * the master assigns the version only when some entries changed */
+static void deal_subtree_record(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
+{
+    FDIRBinlogRecord *sub;
+    FDIRBinlogRecord *end;
+    int success_count;
+    int ignore_errno;
+    int result;
+    bool is_error;
+
+    result = subtree_ops_collect(thread_ctx, record);
+    if (record->subtree.op_type == FDIR_SUBTREE_OP_SUMMARY) {
+        record->notify.func(record, result, result != 0);
+        return;
+    }
+
+    success_count = 0;
+    if (result == 0) {
+        end = thread_ctx->subtree_context.records +
+            record->subtree.context->count;
+        for (sub=thread_ctx->subtree_context.records; sub<end; sub++) {
+            if (deal_record_operation(thread_ctx, sub,
+                        &ignore_errno) == 0)
+            {
+                success_count++;
+            }
+        }
+    }
+
+    //the root maybe removed before the batch
+    is_error = check_data_version(thread_ctx, record,
+            result, ENOENT, success_count > 0);
+    if (result == 0 && record->data_version > 0 &&
+            record->subtree.op_type == FDIR_SUBTREE_OP_REMOVE)
+    {
+        if ((result=subtree_ops_trash_removed_files(
+                        thread_ctx, record)) != 0)
+        {
+            is_error = true;
+        }
+    }
+
+    if (record->notify.func != NULL) {
+        record->notify.func(record, result, is_error);
+    }
+}
+
+static int deal_binlog_one_record(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
+{
+    const bool need_version = true;
+    int result;
+    int ignore_errno;
+    bool is_error;
+
+    if (record->operation == BINLOG_OP_BATCH_DENTRY_INT) {
+        deal_binlog_batch_records(thread_ctx, record);
+        return 0;
+    }
+
+    if (record->operation == BINLOG_OP_SUBTREE_DENTRY_INT) {
+        deal_subtree_record(thread_ctx, record);
+        return 0;
+    }
+
+    if (record->operation == BINLOG_OP_SYNC_USAGE_INT) {
+        dentry_usage_sync_notified(thread_ctx);
+        return 0;
+    }
+
+    if (record->operation == BINLOG_OP_LOAD_DENTRY_INT) {
+        result = dentry_store_check_load(thread_ctx, record->me.dentry);
+        record->notify.func(record, result, result != 0);
+        return result;
+    }
+
+    result = deal_record_operation(thread_ctx, record, &ignore_errno);
+    is_error = check_data_version(thread_ctx, record,
+            result, ignore_errno, need_version);
     if (record->notify.func != NULL) {
         record->notify.func(record, result, is_error);
     }
@@ -398,11 +664,14 @@ static void *data_thread_func(void *arg)
     FDIRBinlogRecord *record;
     FDIRBinlogRecord *current;
     FDIRDataThreadContext *thread_ctx;
+    SFTraceContext trace;
+    int64_t start_time;
 
     __sync_add_and_fetch(&DATA_THREAD_RUNNING_COUNT, 1);
     thread_ctx = (FDIRDataThreadContext *)arg;
     while (SF_G_CONTINUE_FLAG) {
-        record = (FDIRBinlogRecord *)fc_queue_pop_all(&thread_ctx->queue);
+        record = (FDIRBinlogRecord *)fc_mpsc_queue_pop_all(
+                &thread_ctx->queue);
         if (record == NULL) {
             continue;
         }
@@ -410,10 +679,21 @@ static void *data_thread_func(void *arg)
         do {
             current = record;
             record = record->next;
+            start_time = get_current_time_us();
+            trace = current->trace;  //the record maybe freed after deal
+            sf_metrics_record_stage_ex(&trace, FDIR_METRICS_STAGE_DATA_QUEUE,
+                    current->push_time_us, start_time -
+                    current->push_time_us);
             deal_binlog_one_record(thread_ctx, current);
+            sf_metrics_record_stage_ex(&trace, FDIR_METRICS_STAGE_DATA_DEAL,
+                    start_time, get_current_time_us() - start_time);
         } while (record != NULL);
 
+        dentry_usage_flush(thread_ctx);
         deal_delay_free_queque(thread_ctx);
+        if (STORAGE_ENABLED) {
+            dentry_store_check_evict(thread_ctx);
+        }
     }
     __sync_sub_and_fetch(&DATA_THREAD_RUNNING_COUNT, 1);
     return NULL;
@@ -18,8 +18,10 @@
 #ifndef _DATA_THREAD_H_
 #define _DATA_THREAD_H_
 
-#include "fastcommon/fc_queue.h"
+#include "fastcommon/fc_mpsc_queue.h"
+#include "fastcommon/shared_func.h"
 #include "fastcommon/server_id_func.h"
+#include "sf/sf_trace.h"
 #include "common/fdir_types.h"
 #include "binlog/binlog_types.h"
 
@@ -32,6 +34,13 @@ typedef struct fdir_dentry_counters {
     int64_t file;
 } FDIRDentryCounters;
 
+typedef struct fdir_dentry_memory_stat {
+    int64_t dentry;       //dentry objects
+    int64_t name;         //names and symlinks
+    int64_t children;     //children skiplists of the directories
+    int64_t inode_index;  //inode hashtable
+} FDIRDentryMemoryStat;
+
 struct fdir_data_thread_context;
 typedef struct fdir_dentry_context {
     UniqSkiplistFactory factory;
@@ -61,9 +70,92 @@ typedef struct server_delay_free_context {
     struct fast_mblock_man allocator;
 } ServerDelayFreeContext;
 
+typedef struct fdir_dentry_store_block {
+    int64_t inode;     //the evicted directory
+    int64_t offset;    //the offset in the store file, -1 for loaded
+    int length;
+    int loaded_time;
+    struct fdir_dentry_store_block *next;  //for hashtable
+} FDIRDentryStoreBlock;
+
+typedef struct fdir_dentry_store_compact_entry {
+    int64_t inode;
+    int64_t offset;
+    int64_t new_offset;    //the offset in the store file of next generation
+} FDIRDentryStoreCompactEntry;
+
+typedef struct fdir_dentry_store_context {
+    int fd;
+    int generation;        //the generation of the store file
+    int64_t file_size;     //the append offset
+    int64_t live_bytes;    //the bytes of the blocks not loaded
+    int64_t cold_inodes;   //the inodes in the store file
+    int64_t scan_bucket;   //the start bucket of the next eviction scan
+    time_t last_check_time;
+    struct {
+        int generation;        //the store generation of the checkpoint
+        int64_t data_version;  //the data version covered by the checkpoint
+        time_t last_time;
+    } checkpoint;
+    struct {
+        int64_t capacity;
+        FDIRDentryStoreBlock **buckets;
+        struct fast_mblock_man allocator;
+    } htable;  //the directory inode to the block location
+    struct {
+        bool in_progress;
+        int fd;                //the store file of the next generation
+        int64_t write_offset;  //the offset to copy the next block to
+        int index;             //the next entry to copy
+        int count;
+        int alloc;
+        FDIRDentryStoreCompactEntry *entries;  //order by offset
+    } compact;  //copy the live blocks to the store file of next generation
+    FastBuffer buffer;     //for block read and write
+} FDIRDentryStoreContext;
+
+typedef struct fdir_dentry_ptr_array {
+    struct fdir_server_dentry **dentries;
+    int alloc;
+    int count;
+} FDIRDentryPtrArray;
+
+typedef struct fdir_dentry_usage_context {
+    struct fast_mblock_man allocator;  //element: FDIRDentryUsage
+    struct fc_list_head dirty;  //the directories with pending usage
+    struct {
+        pthread_mutex_t lock;
+        bool notified;   //the sync record is in the queue
+        FDIRDentryPtrArray *current;  //pushed by the nio threads
+        FDIRDentryPtrArray *dealing;  //dealt by the data thread
+        FDIRDentryPtrArray holders[2];
+        FDIRBinlogRecord record;  //for wake up the data thread
+    } resized;  //the regular files which size or alloc changed
+} FDIRDentryUsageContext;
+
+typedef struct fdir_subtree_batch_context {
+    FDIRBinlogRecord *records;  //the sub records of one batch
+    FDIRSubtreeFile *files;     //the removed regular files of the batch
+    int file_count;
+    FDIRNamespaceEntry *ns_entry;
+    FDIRSubtreeOpContext output;  //for the binlog replay
+} FDIRSubtreeBatchContext;  //alloc when the first subtree batch comes
+
+//the stages of the latency metrics
+#define FDIR_METRICS_STAGE_DATA_QUEUE  0  //wait in the data thread queue
+#define FDIR_METRICS_STAGE_DATA_DEAL   1  //deal by the data thread
+#define FDIR_METRICS_STAGE_REPLICA_ACK 2  //wait the slaves for replication
+#define FDIR_METRICS_STAGE_COUNT       3
+
 typedef struct fdir_data_thread_context {
-    struct fc_queue queue;
+    int index;
+    int64_t applied_version;  //the max data version applied by this thread
+    struct fc_mpsc_queue queue;
     FDIRDentryContext dentry_context;
+    FDIRDentryStoreContext store_context;
+    FDIRDentryUsageContext usage_context;
+    FDIRSubtreeBatchContext subtree_context;
+    struct fast_mblock_man trash_allocator;  //element: FDIRTrashEntry
     ServerDelayFreeContext delay_free_context;
 } FDIRDataThreadContext;
 
@@ -90,6 +182,8 @@ extern "C" {
 
     void data_thread_sum_counters(FDIRDentryCounters *counters);
 
+    void data_thread_sum_memory_stat(FDIRDentryMemoryStat *mstat);
+
     int server_add_to_delay_free_queue(ServerDelayFreeContext *pContext,
             void *ptr, server_free_func free_func, const int delay_seconds);
 
@@ -98,12 +192,20 @@ extern "C" {
             const int delay_seconds);
 
 
+    static inline FDIRDataThreadContext *get_data_thread_context(
+            const unsigned int hash_code)
+    {
+        return g_data_thread_vars.thread_array.contexts +
+            hash_code % g_data_thread_vars.thread_array.count;
+    }
+
     static inline void push_to_data_thread_queue(FDIRBinlogRecord *record)
     {
         FDIRDataThreadContext *context;
-        context = g_data_thread_vars.thread_array.contexts +
-            record->hash_code % g_data_thread_vars.thread_array.count;
-        fc_queue_push(&context->queue, record);
+        context = get_data_thread_context(record->hash_code);
+        record->push_time_us = get_current_time_us();
+        record->trace = g_sf_trace_current;
+        fc_mpsc_queue_push(&context->queue, record);
     }
 
 #ifdef __cplusplus
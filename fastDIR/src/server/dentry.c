@@ -29,6 +29,9 @@
 #include "service_handler.h"
 #include "inode_generator.h"
 #include "inode_index.h"
+#include "dentry_store.h"
+#include "dentry_usage.h"
+#include "dentry_trash.h"
 #include "dentry.h"
 
 #define INIT_LEVEL_COUNT 2
@@ -49,7 +52,10 @@ typedef struct {
     string_t *ptr;
 } StringHolderPtrPair;
 
-const int max_level_count = 20;
+/* the skiplist grows one level when the element count doubles,
+ * 24 levels keep the lookup of directories with ten million of
+ * children in logarithmic time */
+const int max_level_count = 24;
 //const int delay_free_seconds = 3600;
 const int delay_free_seconds = 60;
 static FDIRManager fdir_manager;
@@ -131,21 +137,25 @@ static int dentry_compare(const void *p1, const void *p2)
 static void dentry_do_free(void *ptr)
 {
     FDIRServerDentry *dentry;
-    dentry = (FDIRServerDentry *)ptr;
+    FDIRDentryContext *context;
 
-    if (dentry->children != NULL) {
-        uniq_skiplist_free(dentry->children);
+    dentry = (FDIRServerDentry *)ptr;
+    context = dentry->ns_entry->context;
+    if (S_ISDIR(dentry->stat.mode)) {
+        if (dentry->children != NULL) {
+            uniq_skiplist_free(dentry->children);
+        }
+        dentry_usage_free(context->db_context, dentry);
+        dentry_store_remove_dir(context->db_context, dentry->inode);
     }
 
-    fast_allocator_free(&dentry->context->name_acontext, dentry->name.str);
+    fast_allocator_free(&context->name_acontext, dentry->name.str);
     if ((!FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode) &&
             S_ISLNK(dentry->stat.mode)) && dentry->link.str != NULL)
     {
-        fast_allocator_free(&dentry->context->name_acontext,
-                dentry->link.str);
+        fast_allocator_free(&context->name_acontext, dentry->link.str);
     }
-    fast_mblock_free_object(&dentry->context->dentry_allocator,
-            (void *)dentry);
+    fast_mblock_free_object(&context->dentry_allocator, (void *)dentry);
 }
 
 static void dentry_free_func(void *ptr, const int delay_seconds)
@@ -154,21 +164,14 @@ static void dentry_free_func(void *ptr, const int delay_seconds)
     dentry = (FDIRServerDentry *)ptr;
 
     if (delay_seconds > 0) {
-        server_add_to_delay_free_queue(&dentry->context->db_context->
-                delay_free_context, ptr, dentry_do_free, delay_seconds);
+        server_add_to_delay_free_queue(&dentry->ns_entry->context->
+                db_context->delay_free_context, ptr, dentry_do_free,
+                delay_seconds);
     } else {
         dentry_do_free(ptr);
     }
 }
 
-int dentry_init_obj(void *element, void *init_args)
-{
-    FDIRServerDentry *dentry;
-    dentry = (FDIRServerDentry *)element;
-    dentry->context = (FDIRDentryContext *)init_args;
-    return 0;
-}
-
 int dentry_init_context(FDIRDataThreadContext *db_context)
 {
 #define NAME_REGION_COUNT 4
@@ -190,7 +193,7 @@ int dentry_init_context(FDIRDataThreadContext *db_context)
 
     if ((result=fast_mblock_init_ex1(&context->dentry_allocator,
                     "dentry", sizeof(FDIRServerDentry), 8 * 1024,
-                    0, dentry_init_obj, context, false)) != 0)
+                    0, NULL, NULL, false)) != 0)
     {
         return result;
     }
@@ -243,7 +246,12 @@ static FDIRNamespaceEntry *create_namespace(FDIRDentryContext *context,
             entry->name.len, entry->name.str);
             */
 
+    if ((*err_no=dentry_trash_init(entry)) != 0) {
+        return NULL;
+    }
+
     entry->dentry_root = NULL;
+    entry->context = context;
     entry->next = *bucket;
     *bucket = entry;
     *err_no = 0;
@@ -292,30 +300,75 @@ static FDIRNamespaceEntry *get_namespace(FDIRDentryContext *context,
     return entry;
 }
 
-static const FDIRServerDentry *do_find_ex(FDIRNamespaceEntry *ns_entry,
-        const string_t *paths, const int count)
+FDIRNamespaceEntry *dentry_get_namespace(FDIRDentryContext *context,
+        const string_t *ns, int *err_no)
+{
+    const bool create_ns = true;
+    return get_namespace(context, ns, create_ns, err_no);
+}
+
+FDIRNamespaceEntry *dentry_find_namespace(const string_t *ns)
+{
+    const bool create_ns = false;
+    int result;
+    return get_namespace(NULL, ns, create_ns, &result);
+}
+
+int dentry_scan_namespaces(FDIRDentryContext *context,
+        dentry_namespace_scan_func scan_func, void *args)
+{
+    FDIRNamespaceEntry **bucket;
+    FDIRNamespaceEntry **end;
+    FDIRNamespaceEntry *entry;
+    int result;
+
+    end = fdir_manager.hashtable.buckets +
+        g_server_global_vars.namespace_hashtable_capacity;
+    for (bucket=fdir_manager.hashtable.buckets; bucket<end; bucket++) {
+        for (entry=*bucket; entry!=NULL; entry=entry->next) {
+            if (entry->context != context) {
+                continue;
+            }
+            if ((result=scan_func(entry, args)) != 0) {
+                return result;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* return TASK_STATUS_DENTRY_COLD and set dentry to the cold directory
+ * when the children of the directory are in the dentry store */
+static int do_find_ex(FDIRNamespaceEntry *ns_entry, const string_t *paths,
+        const int count, FDIRServerDentry **dentry)
 {
     const string_t *p;
     const string_t *end;
-    FDIRServerDentry *current;
+    UniqSkiplist *children;
     FDIRServerDentry target;
 
-    current = ns_entry->dentry_root;
+    *dentry = ns_entry->dentry_root;
     end = paths + count;
     for (p=paths; p<end; p++) {
-        if (!S_ISDIR(current->stat.mode)) {
-            return NULL;
+        if (!S_ISDIR((*dentry)->stat.mode)) {
+            *dentry = NULL;
+            return ENOENT;
+        }
+
+        /* the children are set to NULL by the data thread when evicted */
+        if ((children=FC_ATOMIC_GET((*dentry)->children)) == NULL) {
+            return TASK_STATUS_DENTRY_COLD;
         }
 
         target.name = *p;
-        current = (FDIRServerDentry *)uniq_skiplist_find(
-                current->children, &target);
-        if (current == NULL) {
-            return NULL;
+        *dentry = (FDIRServerDentry *)uniq_skiplist_find(children, &target);
+        if (*dentry == NULL) {
+            return ENOENT;
         }
     }
 
-    return current;
+    return 0;
 }
 
 int64_t dentry_get_namespace_inode_count(const string_t *ns)
@@ -373,10 +426,10 @@ int dentry_find_parent(const FDIRDEntryFullName *fullname,
     if (path_info.count == 1) {
         *parent = ns_entry->dentry_root;
     } else {
-        *parent = (FDIRServerDentry *)do_find_ex(ns_entry,
-                path_info.paths, path_info.count - 1);
-        if (*parent == NULL) {
-            return ENOENT;
+        if ((result=do_find_ex(ns_entry, path_info.paths,
+                        path_info.count - 1, parent)) != 0)
+        {
+            return result;
         }
     }
 
@@ -395,6 +448,7 @@ static int dentry_find_parent_and_me(FDIRDentryContext *context,
         const bool create_ns)
 {
     FDIRServerDentry target;
+    UniqSkiplist *children;
     int result;
 
     if (fullname->path.len == 0 || fullname->path.str[0] != '/') {
@@ -429,11 +483,11 @@ static int dentry_find_parent_and_me(FDIRDentryContext *context,
     if (path_info->count == 1) {
         *parent = (*ns_entry)->dentry_root;
     } else {
-        *parent = (FDIRServerDentry *)do_find_ex(*ns_entry,
-                path_info->paths, path_info->count - 1);
-        if (*parent == NULL) {
-            *me = NULL;
-            return ENOENT;
+        if ((result=do_find_ex(*ns_entry, path_info->paths,
+                        path_info->count - 1, parent)) != 0)
+        {
+            *me = *parent;  //the cold directory for TASK_STATUS_DENTRY_COLD
+            return result;
         }
     }
 
@@ -443,8 +497,13 @@ static int dentry_find_parent_and_me(FDIRDentryContext *context,
         return ENOTDIR;
     }
 
+    if ((children=FC_ATOMIC_GET((*parent)->children)) == NULL) {
+        *me = *parent;
+        return TASK_STATUS_DENTRY_COLD;
+    }
+
     target.name = *my_name;
-    *me = (FDIRServerDentry *)uniq_skiplist_find((*parent)->children, &target);
+    *me = (FDIRServerDentry *)uniq_skiplist_find(children, &target);
     return 0;
 }
 
@@ -473,6 +532,11 @@ static int dentry_find_me(FDIRDentryContext *context, const string_t *ns,
         }
     } else {
         *ns_entry = rec_entry->parent->ns_entry;
+        if ((result=dentry_store_check_load(context->db_context,
+                        rec_entry->parent)) != 0)
+        {
+            return result;
+        }
     }
 
     target.name = rec_entry->pname.name;
@@ -525,6 +589,9 @@ int dentry_create(FDIRDataThreadContext *db_context, FDIRBinlogRecord *record)
         if (current->children == NULL) {
             return ENOMEM;
         }
+        if ((result=dentry_usage_alloc(db_context, current)) != 0) {
+            return result;
+        }
     } else {
         current->children = NULL;
     }
@@ -544,7 +611,7 @@ int dentry_create(FDIRDataThreadContext *db_context, FDIRBinlogRecord *record)
         {
             return result;
         }
-    } else {
+    } else if (!is_dir) {
         FC_SET_STRING_NULL(current->link);
     }
 
@@ -600,6 +667,7 @@ int dentry_create(FDIRDataThreadContext *db_context, FDIRBinlogRecord *record)
         return result;
     }
 
+    dentry_usage_create(db_context, current);
     record->me.dentry = current;
     if (record->inode == 0) {
         record->inode = current->inode;
@@ -700,6 +768,11 @@ int dentry_remove(FDIRDataThreadContext *db_context,
     }
 
     if (S_ISDIR(record->me.dentry->stat.mode)) {
+        if ((result=dentry_store_check_load(db_context,
+                        record->me.dentry)) != 0)
+        {
+            return result;
+        }
         if (!uniq_skiplist_empty(record->me.dentry->children)) {
             return ENOTEMPTY;
         }
@@ -722,6 +795,7 @@ int dentry_remove(FDIRDataThreadContext *db_context,
         return result;
     }
 
+    dentry_usage_remove(db_context, record->me.dentry, record->me.parent);
     return 0;
 }
 
@@ -740,6 +814,7 @@ static int rename_check(FDIRDataThreadContext *db_context,
         FDIRBinlogRecord *record)
 {
     FDIRServerDentry target;
+    int result;
 
     if (record->rename.src.parent == NULL ||
             record->rename.dest.parent == NULL)
@@ -747,6 +822,17 @@ static int rename_check(FDIRDataThreadContext *db_context,
         return EINVAL;
     }
 
+    if ((result=dentry_store_check_load(db_context,
+                    record->rename.src.parent)) != 0)
+    {
+        return result;
+    }
+    if ((result=dentry_store_check_load(db_context,
+                    record->rename.dest.parent)) != 0)
+    {
+        return result;
+    }
+
     target.name = record->rename.src.pname.name;
     if ((record->rename.src.dentry=(FDIRServerDentry *)uniq_skiplist_find(
                     record->rename.src.parent->children, &target)) == NULL)
@@ -785,6 +871,11 @@ static int rename_check(FDIRDataThreadContext *db_context,
     }
 
     if (S_ISDIR(record->rename.dest.dentry->stat.mode)) {
+        if ((result=dentry_store_check_load(db_context,
+                        record->rename.dest.dentry)) != 0)
+        {
+            return result;
+        }
         if (!uniq_skiplist_empty(record->rename.dest.dentry->children)) {
             return ENOTEMPTY;
         }
@@ -806,15 +897,15 @@ static inline void restore_dentry_name(FDIRServerDentry *dentry,
     name_to_free = dentry->name.str;
     dentry->name = *old_name;
 
-    server_add_to_delay_free_queue_ex(&dentry->context->db_context->
-            delay_free_context, name_to_free, &dentry->context->
+    server_add_to_delay_free_queue_ex(&dentry->ns_entry->context->db_context->
+            delay_free_context, name_to_free, &dentry->ns_entry->context->
             name_acontext, free_dentry_name, delay_free_seconds);
 }
 
 static inline void free_dname(FDIRServerDentry *dentry, string_t *old_name)
 {
-    server_add_to_delay_free_queue_ex(&dentry->context->db_context->
-            delay_free_context, old_name->str, &dentry->context->
+    server_add_to_delay_free_queue_ex(&dentry->ns_entry->context->db_context->
+            delay_free_context, old_name->str, &dentry->ns_entry->context->
             name_acontext, free_dentry_name, delay_free_seconds);
 }
 
@@ -830,7 +921,7 @@ static int set_and_store_dentry_name(FDIRDataThreadContext *db_context,
         return 0;
     }
 
-    if ((result=dentry_strdup(&dentry->context->db_context->
+    if ((result=dentry_strdup(&dentry->ns_entry->context->db_context->
                     dentry_context, &cloned_name, new_name)) != 0)
     {
         return result;
@@ -916,6 +1007,10 @@ static int exchange_dentry(FDIRDataThreadContext *db_context,
         record->rename.src.dentry->parent = record->rename.dest.parent;
         record->rename.dest.dentry->parent = record->rename.src.parent;
         record->inode = record->rename.src.dentry->inode;
+        dentry_usage_move(db_context, record->rename.src.dentry,
+                record->rename.src.parent, record->rename.dest.parent);
+        dentry_usage_move(db_context, record->rename.dest.dentry,
+                record->rename.dest.parent, record->rename.src.parent);
         if (name_changed) {
             free_dname(record->rename.src.dentry, old_src_pair.ptr);
             free_dname(record->rename.dest.dentry, old_dest_pair.ptr);
@@ -989,6 +1084,12 @@ static int move_dentry(FDIRDataThreadContext *db_context,
 
         record->rename.src.dentry->parent = record->rename.dest.parent;
         record->inode = record->rename.src.dentry->inode;
+        if (record->rename.dest.dentry != NULL) {
+            dentry_usage_remove(db_context, record->rename.dest.dentry,
+                    record->rename.dest.parent);
+        }
+        dentry_usage_move(db_context, record->rename.src.dentry,
+                record->rename.src.parent, record->rename.dest.parent);
         if (name_changed) {
             free_dname(record->rename.src.dentry, old_src_pair.ptr);
         }
@@ -1086,15 +1187,21 @@ int dentry_find_by_pname(FDIRServerDentry *parent, const string_t *name,
         FDIRServerDentry **dentry)
 {
     FDIRServerDentry target;
+    UniqSkiplist *children;
 
     if (!S_ISDIR(parent->stat.mode)) {
         *dentry = NULL;
         return ENOENT;
     }
 
+    if ((children=FC_ATOMIC_GET(parent->children)) == NULL) {
+        *dentry = parent;
+        return TASK_STATUS_DENTRY_COLD;
+    }
+
     target.name = *name;
     if ((*dentry=(FDIRServerDentry *)uniq_skiplist_find(
-                    parent->children, &target)) != NULL)
+                    children, &target)) != NULL)
     {
         SET_HARD_LINK_DENTRY(*dentry);
         return 0;
@@ -1103,69 +1210,27 @@ int dentry_find_by_pname(FDIRServerDentry *parent, const string_t *name,
     }
 }
 
-static int check_alloc_dentry_array(FDIRServerDentryArray *array, const int target_count)
-{
-    FDIRServerDentry **entries;
-    int new_alloc;
-    int bytes;
-
-    if (array->alloc >= target_count) {
-        return 0;
-    }
-
-    new_alloc = (array->alloc > 0) ? array->alloc : 4 * 1024;
-    while (new_alloc < target_count) {
-        new_alloc *= 2;
-    }
-
-    bytes = sizeof(FDIRServerDentry *) * new_alloc;
-    entries = (FDIRServerDentry **)fc_malloc(bytes);
-    if (entries == NULL) {
-        return ENOMEM;
-    }
-
-    if (array->entries != NULL) {
-        if (array->count > 0) {
-            memcpy(entries, array->entries,
-                    sizeof(FDIRServerDentry *) * array->count);
-        }
-        free(array->entries);
-    }
-
-    array->alloc = new_alloc;
-    array->entries = entries;
-    return 0;
-}
-
-int dentry_list(FDIRServerDentry *dentry, FDIRServerDentryArray *array)
+int dentry_list_iterator(FDIRServerDentry *dentry,
+        const string_t *last_name, UniqSkiplistIterator *iterator)
 {
-    FDIRServerDentry *current;
-    FDIRServerDentry **pp;
-    UniqSkiplistIterator iterator;
-    int result;
-    int count;
+    FDIRServerDentry target;
+    UniqSkiplist *children;
 
     if (!S_ISDIR(dentry->stat.mode)) {
-        count = 1;
-    } else {
-        count = uniq_skiplist_count(dentry->children);
+        return ENOTDIR;
     }
 
-    if ((result=check_alloc_dentry_array(array, count)) != 0) {
-        return result;
+    if ((children=FC_ATOMIC_GET(dentry->children)) == NULL) {
+        return TASK_STATUS_DENTRY_COLD;
     }
 
-    if (!S_ISDIR(dentry->stat.mode)) {
-        array->entries[array->count++] = dentry;
-    } else {
-        pp = array->entries;
-        uniq_skiplist_iterator(dentry->children, &iterator);
-        while ((current=(FDIRServerDentry *)uniq_skiplist_next(&iterator)) != NULL) {
-            *pp++ = current;
-        }
-        array->count = pp - array->entries;
+    if (last_name == NULL) {
+        uniq_skiplist_iterator(children, iterator);
+        return 0;
     }
 
+    target.name = *last_name;
+    uniq_skiplist_iterator_from(children, &target, false, iterator);
     return 0;
 }
 
@@ -24,6 +24,9 @@
     FDIR_IS_DENTRY_HARD_LINK((dentry)->stat.mode) ? \
     (dentry)->src_dentry : dentry
 
+typedef int (*dentry_namespace_scan_func)(FDIRNamespaceEntry *ns_entry,
+        void *args);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -35,6 +38,18 @@ extern "C" {
 
     int dentry_init_context(FDIRDataThreadContext *db_context);
 
+    /* get the namespace, create it when not exist */
+    FDIRNamespaceEntry *dentry_get_namespace(FDIRDentryContext *context,
+            const string_t *ns, int *err_no);
+
+    /* get the namespace, return NULL when not exist */
+    FDIRNamespaceEntry *dentry_find_namespace(const string_t *ns);
+
+    /* scan the namespaces of the data thread, stop when
+     * the scan function returns non-zero */
+    int dentry_scan_namespaces(FDIRDentryContext *context,
+            dentry_namespace_scan_func scan_func, void *args);
+
     int dentry_create(FDIRDataThreadContext *db_context,
             FDIRBinlogRecord *record);
 
@@ -44,6 +59,9 @@ extern "C" {
     int dentry_rename(FDIRDataThreadContext *db_context,
             FDIRBinlogRecord *record);
 
+    /* the find functions return TASK_STATUS_DENTRY_COLD and set the
+     * dentry to the cold directory when it's children are evicted to
+     * the dentry store, the caller should load it in the data thread */
     int dentry_find_parent(const FDIRDEntryFullName *fullname,
             FDIRServerDentry **parent, string_t *my_name);
 
@@ -63,31 +81,11 @@ extern "C" {
     int dentry_get_full_path(const FDIRServerDentry *dentry,
             BufferInfo *full_path, SFErrorInfo *error_info);
 
-    int dentry_list(FDIRServerDentry *dentry, FDIRServerDentryArray *array);
-
-    static inline int dentry_list_by_path(const FDIRDEntryFullName *fullname,
-            FDIRServerDentryArray *array)
-    {
-        const bool hdlink_follow = false;
-        int result;
-        FDIRServerDentry *dentry;
-
-        array->count = 0;
-        if ((result=dentry_find_ex(fullname, &dentry, hdlink_follow)) != 0) {
-            return result;
-        }
-
-        return dentry_list(dentry, array);
-    }
-
-    static inline void dentry_array_free(FDIRServerDentryArray *array)
-    {
-        if (array->entries != NULL) {
-            free(array->entries);
-            array->entries = NULL;
-            array->alloc = array->count = 0;
-        }
-    }
+    /* init the iterator for listing the children from the one next to
+     * the last name, NULL last name for the first child,
+     * return TASK_STATUS_DENTRY_COLD for the cold directory */
+    int dentry_list_iterator(FDIRServerDentry *dentry,
+            const string_t *last_name, UniqSkiplistIterator *iterator);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,2342 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <string.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/fc_checksum.h"
+#include "fastcommon/sched_thread.h"
+#include "server_global.h"
+#include "server_binlog.h"
+#include "inode_index.h"
+#include "dentry.h"
+#include "dentry_usage.h"
+#include "dentry_trash.h"
+#include "dentry_store.h"
+
+#define DENTRY_STORE_SUBDIR_NAME   "dentry_store"
+#define DENTRY_STORE_BLOCK_MAGIC   "FDSB"
+#define DENTRY_CHECKPOINT_MAGIC    "FDCP"
+
+#define DENTRY_CHECKPOINT_BUFFER_SIZE  (1024 * 1024)
+
+/* the section types of the checkpoint file */
+#define DENTRY_CHECKPOINT_SECTION_NAMESPACE  'N'
+#define DENTRY_CHECKPOINT_SECTION_CHILDREN   'D'
+#define DENTRY_CHECKPOINT_SECTION_DETACHED   'O'
+#define DENTRY_CHECKPOINT_SECTION_TRASH      'T'
+#define DENTRY_CHECKPOINT_SECTION_END        'E'
+
+#define DENTRY_STORE_MAX_CANDIDATES      256
+#define DENTRY_STORE_SCAN_BUCKETS_ONCE  4096
+#define DENTRY_STORE_MAX_SCAN_BUCKETS   (256 * 1024)  //for each check
+#define DENTRY_STORE_DELAY_FREE_SECONDS   60
+
+/* compact the store file when the live blocks less than the percent */
+#define DENTRY_STORE_COMPACT_LIVE_PERCENT   50
+#define DENTRY_STORE_COMPACT_MIN_FILE_SIZE  (16 * 1024 * 1024)
+#define DENTRY_STORE_COMPACT_BYTES_ONCE     (8 * 1024 * 1024)
+
+typedef struct {
+    char magic[4];
+    char inode[8];     //the inode of the directory
+    char count[4];     //the count of the children
+    char body_len[4];
+    char crc32[4];     //the CRC32C of the body
+} FDIRDentryStoreBlockHeader;
+
+typedef struct {
+    char inode[8];
+    char mode[4];
+    char uid[4];
+    char gid[4];
+    char btime[4];
+    char atime[4];
+    char ctime[4];
+    char mtime[4];
+    char nlink[4];
+    char size[8];
+    char alloc[8];
+    char space_end[8];
+    char link_len[2];
+    unsigned char name_len;
+    char padding[1];
+    char strings[0];   //the name followed by the link
+} FDIRDentryStoreRecord;
+
+/* the checkpoint file of the data thread:
+ *   header, the block table of the store file, then the sections of the
+ *   in-memory dentries and the trash of each namespace, and the end
+ *   section. the records of the checkpoint are followed by the extra
+ *   fields selected by the file type */
+typedef struct {
+    char magic[4];
+    char thread_count[4];
+    char thread_index[4];
+    char generation[4];    //the generation of the store file
+    char data_version[8];  //the data version covered by the checkpoint
+    char store_size[8];    //the valid size of the store file
+    char block_count[8];
+    char body_len[8];
+    char crc32[4];         //the CRC32C of the body
+    char padding[4];
+} FDIRDentryCheckpointHeader;
+
+typedef struct {
+    char inode[8];         //the inode of the cold directory
+    char offset[8];
+    char length[4];
+    char padding[4];
+} FDIRDentryCheckpointBlock;
+
+typedef struct {
+    char type;
+    char padding[3];
+    char count[4];  //the name length for namespace, the record count for
+                    //children and detached, the entry count for trash
+    char inode[8];  //the directory inode for children,
+                    //1 when the root record follows for namespace
+} FDIRDentryCheckpointSection;
+
+typedef struct {
+    char files[8];
+    char dirs[8];
+    char bytes[8];
+    char alloc[8];
+} FDIRDentryCheckpointUsage;   //the extra of the directory
+
+typedef struct {
+    char src_inode[8];
+} FDIRDentryCheckpointHdlink;  //the extra of the hard link
+
+typedef struct {
+    char data_version[8];
+    char inode[8];
+    char size[8];
+} FDIRDentryCheckpointTrash;  //the entry of the trash section
+
+typedef struct {
+    char size[8];
+    char alloc[8];
+} FDIRDentryCheckpointAccounted;  //the extra of the regular file
+
+typedef struct {
+    FDIRDataThreadContext *db_context;
+    int count;
+    FDIRServerDentry *dirs[DENTRY_STORE_MAX_CANDIDATES];
+} DentryStoreCandidates;
+
+typedef struct {
+    FDIRDataThreadContext *db_context;
+    int fd;
+    uint32_t crc32;
+    int64_t body_len;
+    FastBuffer buffer;
+    FDIRDentryPtrArray detached;  //the detached sources of the hard links
+} DentryCheckpointWriter;
+
+typedef struct {
+    int generation;
+    int64_t data_version;
+    int64_t store_size;
+    int64_t block_count;
+    int64_t body_len;
+    uint32_t crc32;
+} DentryCheckpointInfo;
+
+typedef struct {
+    int fd;
+    int64_t remain;   //the body bytes not read
+    char *current;    //the parse position of the buffer
+    FastBuffer buffer;
+    char filename[PATH_MAX];
+} DentryCheckpointReader;
+
+typedef struct {
+    FDIRServerDentry *dentry;
+    int64_t src_inode;
+} DentryHardLinkEntry;
+
+typedef struct {
+    DentryHardLinkEntry *entries;
+    int alloc;
+    int count;
+} DentryHardLinkArray;  //the hard links to resolve after restored
+
+static inline void get_store_path(char *path, const int size)
+{
+    snprintf(path, size, "%s/%s", DATA_PATH_STR, DENTRY_STORE_SUBDIR_NAME);
+}
+
+static inline void get_store_filename(const int thread_index,
+        const int generation, char *filename, const int size)
+{
+    snprintf(filename, size, "%s/%s/store-%02d-%d.dat", DATA_PATH_STR,
+            DENTRY_STORE_SUBDIR_NAME, thread_index, generation);
+}
+
+static inline void get_checkpoint_filename(const int thread_index,
+        char *filename, const int size)
+{
+    snprintf(filename, size, "%s/%s/checkpoint-%02d.dat", DATA_PATH_STR,
+            DENTRY_STORE_SUBDIR_NAME, thread_index);
+}
+
+static inline void remove_store_file(const int thread_index,
+        const int generation)
+{
+    char filename[PATH_MAX];
+
+    get_store_filename(thread_index, generation,
+            filename, sizeof(filename));
+    if (unlink(filename) != 0 && errno != ENOENT) {
+        logWarning("file: "__FILE__", line: %d, "
+                "unlink file %s fail, errno: %d, error info: %s",
+                __LINE__, filename, errno, STRERROR(errno));
+    }
+}
+
+static int open_store_file(FDIRDataThreadContext *db_context,
+        const int generation, const bool create)
+{
+    char filename[PATH_MAX];
+    int result;
+    int fd;
+
+    get_store_filename(db_context->index, generation,
+            filename, sizeof(filename));
+    if ((fd=open(filename, create ? (O_RDWR | O_CREAT | O_TRUNC |
+                        O_CLOEXEC) : (O_RDWR | O_CLOEXEC), 0644)) < 0)
+    {
+        result = errno != 0 ? errno : EACCES;
+        logError("file: "__FILE__", line: %d, "
+                "open file %s fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+        return -1 * result;
+    }
+
+    return fd;
+}
+
+int dentry_store_init_context(FDIRDataThreadContext *db_context)
+{
+    FDIRDentryStoreContext *store;
+    char path[PATH_MAX];
+    int64_t bytes;
+    int result;
+
+    store = &db_context->store_context;
+    store->fd = -1;
+    memset(&store->compact, 0, sizeof(store->compact));
+    store->compact.fd = -1;
+    if (!STORAGE_ENABLED) {
+        return 0;
+    }
+
+    /* the store file is opened by dentry_store_restore */
+    get_store_path(path, sizeof(path));
+    if ((result=fc_check_mkdir(path, 0755)) != 0) {
+        return result;
+    }
+
+    store->htable.capacity = (INODE_HASHTABLE_CAPACITY / 8) | 1;
+    bytes = sizeof(FDIRDentryStoreBlock *) * store->htable.capacity;
+    store->htable.buckets = (FDIRDentryStoreBlock **)fc_malloc(bytes);
+    if (store->htable.buckets == NULL) {
+        return ENOMEM;
+    }
+    memset(store->htable.buckets, 0, bytes);
+
+    if ((result=fast_mblock_init_ex1(&store->htable.allocator,
+                    "store_block", sizeof(FDIRDentryStoreBlock),
+                    4 * 1024, 0, NULL, NULL, false)) != 0)
+    {
+        return result;
+    }
+
+    return fast_buffer_init_ex(&store->buffer, 64 * 1024);
+}
+
+static FDIRDentryStoreBlock *get_block(FDIRDentryStoreContext *store,
+        const int64_t inode, const bool create)
+{
+    FDIRDentryStoreBlock **bucket;
+    FDIRDentryStoreBlock *block;
+
+    bucket = store->htable.buckets + ((uint64_t)inode) %
+        store->htable.capacity;
+    block = *bucket;
+    while (block != NULL && block->inode != inode) {
+        block = block->next;
+    }
+
+    if (block != NULL || !create) {
+        return block;
+    }
+
+    block = (FDIRDentryStoreBlock *)fast_mblock_alloc_object(
+            &store->htable.allocator);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->inode = inode;
+    block->offset = -1;
+    block->length = 0;
+    block->loaded_time = 0;
+    block->next = *bucket;
+    *bucket = block;
+    return block;
+}
+
+void dentry_store_remove_dir(FDIRDataThreadContext *db_context,
+        const int64_t inode)
+{
+    FDIRDentryStoreContext *store;
+    FDIRDentryStoreBlock **bucket;
+    FDIRDentryStoreBlock *previous;
+    FDIRDentryStoreBlock *block;
+
+    if (!STORAGE_ENABLED) {
+        return;
+    }
+
+    store = &db_context->store_context;
+    bucket = store->htable.buckets + ((uint64_t)inode) %
+        store->htable.capacity;
+    previous = NULL;
+    block = *bucket;
+    while (block != NULL && block->inode != inode) {
+        previous = block;
+        block = block->next;
+    }
+    if (block == NULL) {
+        return;
+    }
+
+    if (previous == NULL) {
+        *bucket = block->next;
+    } else {
+        previous->next = block->next;
+    }
+    fast_mblock_free_object(&store->htable.allocator, block);
+}
+
+static inline bool can_evict_child(FDIRServerDentry *dentry)
+{
+    /* the hard links and the locked dentries are referenced
+     * by pointers, so they must stay in memory */
+    return !(S_ISDIR(dentry->stat.mode) ||
+            FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode) ||
+            dentry->stat.nlink > 1 || dentry->flock_entry != NULL);
+}
+
+static inline int get_record_extra_size(const int mode)
+{
+    if (FDIR_IS_DENTRY_HARD_LINK(mode)) {
+        return sizeof(FDIRDentryCheckpointHdlink);
+    } else if (S_ISDIR(mode)) {
+        return sizeof(FDIRDentryCheckpointUsage);
+    } else if (S_ISREG(mode)) {
+        return sizeof(FDIRDentryCheckpointAccounted);
+    } else {
+        return 0;
+    }
+}
+
+static inline int get_record_link_len(FDIRServerDentry *dentry)
+{
+    return (S_ISLNK(dentry->stat.mode) && !FDIR_IS_DENTRY_HARD_LINK(
+                dentry->stat.mode)) ? dentry->link.len : 0;
+}
+
+static void pack_record_extra(FDIRServerDentry *dentry, char *extra)
+{
+    FDIRDentryCheckpointUsage *usage;
+    FDIRDentryCheckpointHdlink *hdlink;
+    FDIRDentryCheckpointAccounted *accounted;
+
+    if (FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode)) {
+        hdlink = (FDIRDentryCheckpointHdlink *)extra;
+        long2buff(dentry->src_dentry->inode, hdlink->src_inode);
+    } else if (S_ISDIR(dentry->stat.mode)) {
+        usage = (FDIRDentryCheckpointUsage *)extra;
+        long2buff(dentry->usage->total.files, usage->files);
+        long2buff(dentry->usage->total.dirs, usage->dirs);
+        long2buff(dentry->usage->total.bytes, usage->bytes);
+        long2buff(dentry->usage->total.alloc, usage->alloc);
+    } else if (S_ISREG(dentry->stat.mode)) {
+        accounted = (FDIRDentryCheckpointAccounted *)extra;
+        long2buff(dentry->accounted.size, accounted->size);
+        long2buff(dentry->accounted.alloc, accounted->alloc);
+    }
+}
+
+/* the records of the store blocks have no extra,
+ * the records of the checkpoint have */
+static int pack_record(FastBuffer *buffer, FDIRServerDentry *dentry,
+        const bool with_extra)
+{
+    FDIRDentryStoreRecord *record;
+    int link_len;
+    int extra_size;
+    int result;
+
+    link_len = get_record_link_len(dentry);
+    extra_size = with_extra ? get_record_extra_size(dentry->stat.mode) : 0;
+    if ((result=fast_buffer_check(buffer, sizeof(FDIRDentryStoreRecord) +
+                    dentry->name.len + link_len + extra_size)) != 0)
+    {
+        return result;
+    }
+
+    record = (FDIRDentryStoreRecord *)(buffer->data + buffer->length);
+    long2buff(dentry->inode, record->inode);
+    int2buff(dentry->stat.mode, record->mode);
+    int2buff(dentry->stat.uid, record->uid);
+    int2buff(dentry->stat.gid, record->gid);
+    int2buff(dentry->stat.btime, record->btime);
+    int2buff(dentry->stat.atime, record->atime);
+    int2buff(dentry->stat.ctime, record->ctime);
+    int2buff(dentry->stat.mtime, record->mtime);
+    int2buff(dentry->stat.nlink, record->nlink);
+    long2buff(dentry->stat.size, record->size);
+    long2buff(dentry->stat.alloc, record->alloc);
+    long2buff(dentry->stat.space_end, record->space_end);
+    short2buff(link_len, record->link_len);
+    record->name_len = dentry->name.len;
+    memcpy(record->strings, dentry->name.str, dentry->name.len);
+    if (link_len > 0) {
+        memcpy(record->strings + dentry->name.len,
+                dentry->link.str, link_len);
+    }
+    if (extra_size > 0) {
+        pack_record_extra(dentry, record->strings +
+                dentry->name.len + link_len);
+    }
+
+    buffer->length += sizeof(FDIRDentryStoreRecord) +
+        dentry->name.len + link_len + extra_size;
+    return 0;
+}
+
+static int pack_block(FDIRDentryStoreContext *store,
+        FDIRServerDentry *dir, int *count)
+{
+    const bool with_extra = false;
+    FDIRDentryStoreBlockHeader *header;
+    FDIRServerDentry *child;
+    UniqSkiplistIterator iterator;
+    int result;
+
+    *count = 0;
+    store->buffer.length = sizeof(FDIRDentryStoreBlockHeader);
+    uniq_skiplist_iterator(dir->children, &iterator);
+    while ((child=(FDIRServerDentry *)uniq_skiplist_next(
+                    &iterator)) != NULL)
+    {
+        if (!can_evict_child(child)) {
+            return EBUSY;
+        }
+
+        if ((result=pack_record(&store->buffer, child, with_extra)) != 0) {
+            return result;
+        }
+        (*count)++;
+    }
+
+    header = (FDIRDentryStoreBlockHeader *)store->buffer.data;
+    memcpy(header->magic, DENTRY_STORE_BLOCK_MAGIC, sizeof(header->magic));
+    long2buff(dir->inode, header->inode);
+    int2buff(*count, header->count);
+    int2buff(store->buffer.length - sizeof(FDIRDentryStoreBlockHeader),
+            header->body_len);
+    int2buff(fc_crc32c(0, header + 1, store->buffer.length -
+                sizeof(FDIRDentryStoreBlockHeader)), header->crc32);
+    return 0;
+}
+
+static void free_children_skiplist(void *ptr)
+{
+    uniq_skiplist_free((UniqSkiplist *)ptr);
+}
+
+static void rollback_evict(FDIRServerDentry *dir, FDIRServerDentry *last)
+{
+    FDIRServerDentry *child;
+    UniqSkiplistIterator iterator;
+
+    uniq_skiplist_iterator(dir->children, &iterator);
+    while ((child=(FDIRServerDentry *)uniq_skiplist_next(
+                    &iterator)) != NULL && child != last)
+    {
+        inode_index_add_dentry(child);
+        inode_index_del_cold(child->inode);
+    }
+}
+
+static int evict_directory(FDIRDataThreadContext *db_context,
+        FDIRServerDentry *dir, int *count)
+{
+    FDIRDentryStoreContext *store;
+    FDIRDentryStoreBlock *block;
+    FDIRServerDentry *child;
+    UniqSkiplist *children;
+    UniqSkiplistIterator iterator;
+    int result;
+
+    store = &db_context->store_context;
+    if ((block=get_block(store, dir->inode, false)) != NULL &&
+            g_current_time - block->loaded_time < STORAGE_COLD_SECONDS)
+    {
+        return EAGAIN;  //loaded recently
+    }
+
+    /* remove the children from the inode index before packing, so the
+     * nio threads can NOT modify the stat of them after packed */
+    uniq_skiplist_iterator(dir->children, &iterator);
+    while ((child=(FDIRServerDentry *)uniq_skiplist_next(
+                    &iterator)) != NULL)
+    {
+        if (!can_evict_child(child)) {
+            rollback_evict(dir, child);
+            return EBUSY;
+        }
+
+        if ((result=inode_index_add_cold(child->inode, dir->inode)) != 0) {
+            rollback_evict(dir, child);
+            return result;
+        }
+        if ((result=inode_index_evict_dentry(child)) != 0) {
+            inode_index_del_cold(child->inode);
+            rollback_evict(dir, child);
+            return result;
+        }
+    }
+
+    /* sync the size changes of the children to the usage of the directory,
+     * the reloaded dentries account from the packed stat */
+    dentry_usage_flush(db_context);
+
+    if ((result=pack_block(store, dir, count)) != 0) {
+        rollback_evict(dir, NULL);
+        return result;
+    }
+
+    if (block == NULL) {
+        if ((block=get_block(store, dir->inode, true)) == NULL) {
+            rollback_evict(dir, NULL);
+            return ENOMEM;
+        }
+    }
+
+    if (pwrite(store->fd, store->buffer.data, store->buffer.length,
+                store->file_size) != store->buffer.length)
+    {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "data thread #%d, write to dentry store fail, "
+                "offset: %"PRId64", length: %d, errno: %d, "
+                "error info: %s", __LINE__, db_context->index,
+                store->file_size, store->buffer.length,
+                result, STRERROR(result));
+        rollback_evict(dir, NULL);
+        return result;
+    }
+
+    block->offset = store->file_size;
+    block->length = store->buffer.length;
+    store->file_size += block->length;
+    store->live_bytes += block->length;
+    store->cold_inodes += *count;
+
+    children = dir->children;
+    __sync_bool_compare_and_swap(&dir->children, children, NULL);
+    server_add_to_delay_free_queue(&db_context->delay_free_context,
+            children, free_children_skiplist,
+            DENTRY_STORE_DELAY_FREE_SECONDS);
+    return 0;
+}
+
+static void free_loaded_dentry(FDIRDentryContext *context,
+        FDIRServerDentry *dentry)
+{
+    if (dentry->name.str != NULL) {
+        fast_allocator_free(&context->name_acontext, dentry->name.str);
+    }
+    if (S_ISLNK(dentry->stat.mode) && dentry->link.str != NULL) {
+        fast_allocator_free(&context->name_acontext, dentry->link.str);
+    }
+    fast_mblock_free_object(&context->dentry_allocator, dentry);
+}
+
+static int unpack_record(FDIRDentryContext *context,
+        FDIRNamespaceEntry *ns_entry, FDIRServerDentry *dir,
+        const FDIRDentryStoreRecord *record, FDIRServerDentry **dentry)
+{
+    int link_len;
+    int result;
+
+    *dentry = (FDIRServerDentry *)fast_mblock_alloc_object(
+            &context->dentry_allocator);
+    if (*dentry == NULL) {
+        return ENOMEM;
+    }
+
+    (*dentry)->inode = buff2long(record->inode);
+    (*dentry)->stat.mode = buff2int(record->mode);
+    (*dentry)->stat.uid = buff2int(record->uid);
+    (*dentry)->stat.gid = buff2int(record->gid);
+    (*dentry)->stat.btime = buff2int(record->btime);
+    (*dentry)->stat.atime = buff2int(record->atime);
+    (*dentry)->stat.ctime = buff2int(record->ctime);
+    (*dentry)->stat.mtime = buff2int(record->mtime);
+    (*dentry)->stat.nlink = buff2int(record->nlink);
+    (*dentry)->stat.size = buff2long(record->size);
+    (*dentry)->stat.alloc = buff2long(record->alloc);
+    (*dentry)->stat.space_end = buff2long(record->space_end);
+    (*dentry)->parent = dir;
+    (*dentry)->ns_entry = ns_entry;
+    (*dentry)->flock_entry = NULL;
+    (*dentry)->ht_next = NULL;
+    FC_SET_STRING_NULL((*dentry)->link);
+    FC_SET_STRING_NULL((*dentry)->name);
+
+    if ((result=fast_allocator_alloc_string_ex(&context->name_acontext,
+                    &(*dentry)->name, record->strings,
+                    record->name_len)) != 0)
+    {
+        free_loaded_dentry(context, *dentry);
+        return result;
+    }
+
+    link_len = buff2short(record->link_len);
+    if (link_len > 0) {
+        if ((result=fast_allocator_alloc_string_ex(&context->name_acontext,
+                        &(*dentry)->link, record->strings +
+                        record->name_len, link_len)) != 0)
+        {
+            free_loaded_dentry(context, *dentry);
+            return result;
+        }
+    }
+
+    if (FDIR_IS_USAGE_REGULAR_FILE((*dentry)->stat.mode)) {
+        (*dentry)->accounted.size = (*dentry)->stat.size;
+        (*dentry)->accounted.alloc = (*dentry)->stat.alloc;
+    }
+    return 0;
+}
+
+static int read_block(FDIRDataThreadContext *db_context,
+        FDIRServerDentry *dir, FDIRDentryStoreBlock *block, int *count)
+{
+    FDIRDentryStoreContext *store;
+    FDIRDentryStoreBlockHeader *header;
+    int body_len;
+    int result;
+
+    *count = 0;
+    store = &db_context->store_context;
+    if ((result=fast_buffer_check_capacity(&store->buffer,
+                    block->length)) != 0)
+    {
+        return result;
+    }
+
+    if (pread(store->fd, store->buffer.data, block->length,
+                block->offset) != block->length)
+    {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "data thread #%d, read from dentry store fail, "
+                "offset: %"PRId64", length: %d, errno: %d, "
+                "error info: %s", __LINE__, db_context->index,
+                block->offset, block->length, result, STRERROR(result));
+        return result;
+    }
+    store->buffer.length = block->length;
+
+    header = (FDIRDentryStoreBlockHeader *)store->buffer.data;
+    body_len = buff2int(header->body_len);
+    *count = buff2int(header->count);
+    if (memcmp(header->magic, DENTRY_STORE_BLOCK_MAGIC,
+                sizeof(header->magic)) != 0 ||
+            buff2long(header->inode) != dir->inode || body_len !=
+            block->length - (int)sizeof(FDIRDentryStoreBlockHeader) ||
+            buff2int(header->crc32) != fc_crc32c(0, header + 1, body_len))
+    {
+        logError("file: "__FILE__", line: %d, "
+                "data thread #%d, the block of directory %"PRId64" "
+                "is corrupted, offset: %"PRId64", length: %d",
+                __LINE__, db_context->index, dir->inode,
+                block->offset, block->length);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+static inline int get_children_level_count(FDIRDataThreadContext
+        *db_context, const int count)
+{
+    int level_count;
+
+    level_count = 2;
+    while ((1 << level_count) < count && level_count < db_context->
+            dentry_context.factory.max_level_count)
+    {
+        level_count++;
+    }
+    return level_count;
+}
+
+int dentry_store_load(FDIRDataThreadContext *db_context,
+        FDIRServerDentry *dir)
+{
+    FDIRDentryStoreContext *store;
+    FDIRDentryStoreBlock *block;
+    FDIRDentryStoreRecord *record;
+    FDIRServerDentry *dentry;
+    UniqSkiplist *children;
+    UniqSkiplistIterator iterator;
+    char *p;
+    char *end;
+    int count;
+    int result;
+
+    store = &db_context->store_context;
+    if ((block=get_block(store, dir->inode, false)) == NULL ||
+            block->offset < 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "data thread #%d, the block of directory %"PRId64" "
+                "not exist", __LINE__, db_context->index, dir->inode);
+        return ENOENT;
+    }
+
+    if ((result=read_block(db_context, dir, block, &count)) != 0) {
+        return result;
+    }
+
+    if ((children=uniq_skiplist_new(&db_context->dentry_context.factory,
+                    get_children_level_count(db_context, count))) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    p = store->buffer.data + sizeof(FDIRDentryStoreBlockHeader);
+    end = store->buffer.data + store->buffer.length;
+    while (p < end) {
+        record = (FDIRDentryStoreRecord *)p;
+        if ((result=unpack_record(&db_context->dentry_context,
+                        dir->ns_entry, dir, record, &dentry)) != 0)
+        {
+            uniq_skiplist_free(children);
+            return result;
+        }
+
+        if ((result=uniq_skiplist_insert(children, dentry)) != 0) {
+            free_loaded_dentry(&db_context->dentry_context, dentry);
+            uniq_skiplist_free(children);
+            return result;
+        }
+
+        p += sizeof(FDIRDentryStoreRecord) + record->name_len +
+            buff2short(record->link_len);
+    }
+
+    /* add to the inode index before removing from the cold index,
+     * so the readers always find the dentry in one of them */
+    uniq_skiplist_iterator(children, &iterator);
+    while ((dentry=(FDIRServerDentry *)uniq_skiplist_next(
+                    &iterator)) != NULL)
+    {
+        inode_index_add_dentry(dentry);
+        inode_index_del_cold(dentry->inode);
+    }
+    __sync_bool_compare_and_swap(&dir->children, NULL, children);
+
+    store->cold_inodes -= count;
+    store->live_bytes -= block->length;
+    /* the hole is kept because the checkpoint maybe refer to the block,
+     * the space is reclaimed by the compaction */
+    block->offset = -1;
+    block->loaded_time = g_current_time;
+    return 0;
+}
+
+FDIRServerDentry *dentry_store_get_cold_dir(const int64_t inode)
+{
+    int64_t dir_inode;
+
+    if ((dir_inode=inode_index_get_cold_dir(inode)) == 0) {
+        return NULL;
+    }
+    return inode_index_get_dentry(dir_inode);
+}
+
+int dentry_store_load_inode(FDIRDataThreadContext *db_context,
+        const int64_t inode)
+{
+    FDIRServerDentry *dir;
+
+    if ((dir=dentry_store_get_cold_dir(inode)) == NULL) {
+        return 0;
+    }
+    return dentry_store_check_load(db_context, dir);
+}
+
+static void collect_cold_dir(FDIRServerDentry *dentry, void *args)
+{
+    DentryStoreCandidates *candidates;
+
+    candidates = (DentryStoreCandidates *)args;
+    if (candidates->count >= DENTRY_STORE_MAX_CANDIDATES) {
+        return;
+    }
+
+    /* the dentries of other data threads are changed concurrently */
+    if (dentry->ns_entry->context != &candidates->
+            db_context->dentry_context)
+    {
+        return;
+    }
+
+    if (!S_ISDIR(dentry->stat.mode) || dentry->parent == NULL ||
+            dentry->children == NULL ||
+            uniq_skiplist_empty(dentry->children))
+    {
+        return;
+    }
+
+    if (g_current_time - dentry->stat.mtime < STORAGE_COLD_SECONDS) {
+        return;
+    }
+
+    candidates->dirs[candidates->count++] = dentry;
+}
+
+static int compare_compact_entry(const void *p1, const void *p2)
+{
+    return fc_compare_int64(((FDIRDentryStoreCompactEntry *)p1)->offset,
+            ((FDIRDentryStoreCompactEntry *)p2)->offset);
+}
+
+static int compact_add_entry(FDIRDentryStoreContext *store,
+        const FDIRDentryStoreBlock *block)
+{
+    FDIRDentryStoreCompactEntry *entries;
+    int alloc;
+
+    if (store->compact.count == store->compact.alloc) {
+        alloc = (store->compact.alloc == 0) ? 1024 :
+            store->compact.alloc * 2;
+        entries = (FDIRDentryStoreCompactEntry *)fc_malloc(
+                sizeof(FDIRDentryStoreCompactEntry) * alloc);
+        if (entries == NULL) {
+            return ENOMEM;
+        }
+
+        if (store->compact.entries != NULL) {
+            memcpy(entries, store->compact.entries,
+                    sizeof(FDIRDentryStoreCompactEntry) *
+                    store->compact.count);
+            free(store->compact.entries);
+        }
+        store->compact.entries = entries;
+        store->compact.alloc = alloc;
+    }
+
+    store->compact.entries[store->compact.count].inode = block->inode;
+    store->compact.entries[store->compact.count].offset = block->offset;
+    store->compact.count++;
+    return 0;
+}
+
+static int compact_start(FDIRDataThreadContext *db_context)
+{
+    FDIRDentryStoreContext *store;
+    FDIRDentryStoreBlock **bucket;
+    FDIRDentryStoreBlock **end;
+    FDIRDentryStoreBlock *block;
+    int result;
+
+    store = &db_context->store_context;
+    store->compact.count = 0;
+    end = store->htable.buckets + store->htable.capacity;
+    for (bucket=store->htable.buckets; bucket<end; bucket++) {
+        for (block=*bucket; block!=NULL; block=block->next) {
+            if (block->offset < 0) {
+                continue;
+            }
+            if ((result=compact_add_entry(store, block)) != 0) {
+                return result;
+            }
+        }
+    }
+
+    if ((store->compact.fd=open_store_file(db_context,
+                    store->generation + 1, true)) < 0)
+    {
+        return -1 * store->compact.fd;
+    }
+
+    qsort(store->compact.entries, store->compact.count,
+            sizeof(FDIRDentryStoreCompactEntry), compare_compact_entry);
+    store->compact.index = 0;
+    store->compact.write_offset = 0;
+    store->compact.in_progress = true;
+    return 0;
+}
+
+static void compact_abort(FDIRDataThreadContext *db_context)
+{
+    FDIRDentryStoreContext *store;
+
+    store = &db_context->store_context;
+    close(store->compact.fd);
+    store->compact.fd = -1;
+    remove_store_file(db_context->index, store->generation + 1);
+    store->compact.in_progress = false;
+}
+
+static int compact_copy_block(FDIRDataThreadContext *db_context,
+        FDIRDentryStoreBlock *block)
+{
+    FDIRDentryStoreContext *store;
+    int result;
+
+    store = &db_context->store_context;
+    if ((result=fast_buffer_check_capacity(&store->buffer,
+                    block->length)) != 0)
+    {
+        return result;
+    }
+
+    if (pread(store->fd, store->buffer.data, block->length,
+                block->offset) != block->length ||
+            pwrite(store->compact.fd, store->buffer.data, block->length,
+                store->compact.write_offset) != block->length)
+    {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "data thread #%d, copy the block of directory "
+                "%"PRId64" from offset %"PRId64" to %"PRId64" fail, "
+                "errno: %d, error info: %s", __LINE__, db_context->index,
+                block->inode, block->offset, store->compact.write_offset,
+                result, STRERROR(result));
+        return result;
+    }
+
+    return 0;
+}
+
+/* switch to the store file of next generation, the blocks loaded or
+ * removed during the copy are skipped */
+static void compact_switch(FDIRDataThreadContext *db_context)
+{
+    FDIRDentryStoreContext *store;
+    FDIRDentryStoreCompactEntry *entry;
+    FDIRDentryStoreCompactEntry *end;
+    FDIRDentryStoreBlock *block;
+    int64_t old_file_size;
+
+    store = &db_context->store_context;
+    end = store->compact.entries + store->compact.count;
+    for (entry=store->compact.entries; entry<end; entry++) {
+        if (entry->new_offset < 0) {
+            continue;
+        }
+        if ((block=get_block(store, entry->inode, false)) != NULL &&
+                block->offset == entry->offset)
+        {
+            block->offset = entry->new_offset;
+        }
+    }
+
+    close(store->fd);
+    if (store->generation != store->checkpoint.generation) {
+        //not referred by any checkpoint
+        remove_store_file(db_context->index, store->generation);
+    }
+
+    store->fd = store->compact.fd;
+    store->compact.fd = -1;
+    store->generation++;
+    old_file_size = store->file_size;
+    store->file_size = store->compact.write_offset;
+    store->compact.in_progress = false;
+    logInfo("file: "__FILE__", line: %d, "
+            "data thread #%d, compact dentry store done, file size "
+            "from %"PRId64" to %"PRId64", generation: %d", __LINE__,
+            db_context->index, old_file_size, store->file_size,
+            store->generation);
+}
+
+/* copy the live blocks to the store file of next generation in the offset
+ * order for limited bytes each time, the old store file is removed after
+ * the checkpoint refers to the new one */
+static int compact_store(FDIRDataThreadContext *db_context)
+{
+    FDIRDentryStoreContext *store;
+    FDIRDentryStoreCompactEntry *entry;
+    FDIRDentryStoreBlock *block;
+    int64_t copied_bytes;
+    int result;
+
+    store = &db_context->store_context;
+    if (!store->compact.in_progress) {
+        if ((result=compact_start(db_context)) != 0) {
+            return result;
+        }
+    }
+
+    copied_bytes = 0;
+    while (store->compact.index < store->compact.count &&
+            copied_bytes < DENTRY_STORE_COMPACT_BYTES_ONCE)
+    {
+        entry = store->compact.entries + store->compact.index++;
+        if ((block=get_block(store, entry->inode, false)) == NULL ||
+                block->offset != entry->offset)
+        {
+            entry->new_offset = -1;
+            continue;
+        }
+
+        if ((result=compact_copy_block(db_context, block)) != 0) {
+            compact_abort(db_context);
+            return result;
+        }
+        entry->new_offset = store->compact.write_offset;
+        store->compact.write_offset += block->length;
+        copied_bytes += block->length;
+    }
+
+    if (store->compact.index < store->compact.count) {
+        return 0;
+    }
+
+    if (fsync(store->compact.fd) != 0) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "data thread #%d, fsync dentry store fail, "
+                "errno: %d, error info: %s", __LINE__,
+                db_context->index, result, STRERROR(result));
+        compact_abort(db_context);
+        return result;
+    }
+
+    compact_switch(db_context);
+    return dentry_store_checkpoint(db_context);
+}
+
+static int checkpoint_flush(DentryCheckpointWriter *writer)
+{
+    int result;
+
+    if (writer->buffer.length == 0) {
+        return 0;
+    }
+
+    if (fc_safe_write(writer->fd, writer->buffer.data, writer->
+                buffer.length) != writer->buffer.length)
+    {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "data thread #%d, write checkpoint fail, "
+                "errno: %d, error info: %s", __LINE__, writer->
+                db_context->index, result, STRERROR(result));
+        return result;
+    }
+
+    writer->crc32 = fc_crc32c(writer->crc32, writer->buffer.data,
+            writer->buffer.length);
+    writer->body_len += writer->buffer.length;
+    writer->buffer.length = 0;
+    return 0;
+}
+
+static inline int checkpoint_check_flush(DentryCheckpointWriter *writer)
+{
+    if (writer->buffer.length >= DENTRY_CHECKPOINT_BUFFER_SIZE) {
+        return checkpoint_flush(writer);
+    }
+    return 0;
+}
+
+static int checkpoint_write_section(DentryCheckpointWriter *writer,
+        const char type, const int count, const int64_t inode)
+{
+    FDIRDentryCheckpointSection *section;
+    int result;
+
+    if ((result=fast_buffer_check(&writer->buffer,
+                    sizeof(FDIRDentryCheckpointSection))) != 0)
+    {
+        return result;
+    }
+
+    section = (FDIRDentryCheckpointSection *)(writer->buffer.data +
+            writer->buffer.length);
+    memset(section, 0, sizeof(*section));
+    section->type = type;
+    int2buff(count, section->count);
+    long2buff(inode, section->inode);
+    writer->buffer.length += sizeof(FDIRDentryCheckpointSection);
+    return 0;
+}
+
+static int checkpoint_write_blocks(DentryCheckpointWriter *writer,
+        int64_t *block_count)
+{
+    FDIRDentryStoreContext *store;
+    FDIRDentryStoreBlock **bucket;
+    FDIRDentryStoreBlock **end;
+    FDIRDentryStoreBlock *block;
+    FDIRDentryCheckpointBlock *entry;
+    int result;
+
+    *block_count = 0;
+    store = &writer->db_context->store_context;
+    end = store->htable.buckets + store->htable.capacity;
+    for (bucket=store->htable.buckets; bucket<end; bucket++) {
+        for (block=*bucket; block!=NULL; block=block->next) {
+            if (block->offset < 0) {
+                continue;
+            }
+
+            if ((result=fast_buffer_check(&writer->buffer,
+                            sizeof(FDIRDentryCheckpointBlock))) != 0)
+            {
+                return result;
+            }
+            entry = (FDIRDentryCheckpointBlock *)(writer->buffer.data +
+                    writer->buffer.length);
+            long2buff(block->inode, entry->inode);
+            long2buff(block->offset, entry->offset);
+            int2buff(block->length, entry->length);
+            memset(entry->padding, 0, sizeof(entry->padding));
+            writer->buffer.length += sizeof(FDIRDentryCheckpointBlock);
+            (*block_count)++;
+
+            if ((result=checkpoint_check_flush(writer)) != 0) {
+                return result;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int checkpoint_add_detached(DentryCheckpointWriter *writer,
+        FDIRServerDentry *hdlink)
+{
+    FDIRServerDentry *src;
+    FDIRServerDentry **dentries;
+    int alloc;
+
+    /* the regular file marks itself when detached from the tree, the
+     * others are written anyway and skipped by the restore when exist */
+    src = hdlink->src_dentry;
+    if (FDIR_IS_USAGE_REGULAR_FILE(src->stat.mode) &&
+            src->accounted.size >= 0)
+    {
+        return 0;
+    }
+
+    if (writer->detached.count == writer->detached.alloc) {
+        alloc = (writer->detached.alloc == 0) ? 64 :
+            writer->detached.alloc * 2;
+        dentries = (FDIRServerDentry **)fc_malloc(
+                sizeof(FDIRServerDentry *) * alloc);
+        if (dentries == NULL) {
+            return ENOMEM;
+        }
+
+        if (writer->detached.dentries != NULL) {
+            memcpy(dentries, writer->detached.dentries,
+                    sizeof(FDIRServerDentry *) * writer->detached.count);
+            free(writer->detached.dentries);
+        }
+        writer->detached.dentries = dentries;
+        writer->detached.alloc = alloc;
+    }
+
+    writer->detached.dentries[writer->detached.count++] = src;
+    return 0;
+}
+
+static int checkpoint_write_record(DentryCheckpointWriter *writer,
+        FDIRServerDentry *dentry)
+{
+    const bool with_extra = true;
+    int result;
+
+    if (FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode)) {
+        if ((result=checkpoint_add_detached(writer, dentry)) != 0) {
+            return result;
+        }
+    }
+
+    if ((result=pack_record(&writer->buffer, dentry, with_extra)) != 0) {
+        return result;
+    }
+    return checkpoint_check_flush(writer);
+}
+
+/* write the children in pre-order, so the restore meets
+ * the directory before it's children */
+static int checkpoint_write_children(DentryCheckpointWriter *writer,
+        FDIRServerDentry *dir)
+{
+    FDIRServerDentry *child;
+    UniqSkiplistIterator iterator;
+    int result;
+
+    if (dir->children == NULL || uniq_skiplist_empty(dir->children)) {
+        return 0;  //cold or empty
+    }
+
+    if ((result=checkpoint_write_section(writer,
+                    DENTRY_CHECKPOINT_SECTION_CHILDREN,
+                    uniq_skiplist_count(dir->children), dir->inode)) != 0)
+    {
+        return result;
+    }
+
+    uniq_skiplist_iterator(dir->children, &iterator);
+    while ((child=(FDIRServerDentry *)uniq_skiplist_next(
+                    &iterator)) != NULL)
+    {
+        if ((result=checkpoint_write_record(writer, child)) != 0) {
+            return result;
+        }
+    }
+
+    uniq_skiplist_iterator(dir->children, &iterator);
+    while ((child=(FDIRServerDentry *)uniq_skiplist_next(
+                    &iterator)) != NULL)
+    {
+        if (S_ISDIR(child->stat.mode)) {
+            if ((result=checkpoint_write_children(writer, child)) != 0) {
+                return result;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int checkpoint_write_tree(DentryCheckpointWriter *writer,
+        FDIRNamespaceEntry *ns_entry)
+{
+    FDIRServerDentry **dentry;
+    FDIRServerDentry **end;
+    int result;
+
+    if ((result=checkpoint_write_record(writer,
+                    ns_entry->dentry_root)) != 0)
+    {
+        return result;
+    }
+    if ((result=checkpoint_write_children(writer,
+                    ns_entry->dentry_root)) != 0)
+    {
+        return result;
+    }
+
+    /* the detached sources follow the tree of their namespace */
+    end = writer->detached.dentries + writer->detached.count;
+    for (dentry=writer->detached.dentries; dentry<end; dentry++) {
+        if ((result=checkpoint_write_section(writer,
+                        DENTRY_CHECKPOINT_SECTION_DETACHED, 1, 0)) != 0)
+        {
+            return result;
+        }
+        if ((result=checkpoint_write_record(writer, *dentry)) != 0) {
+            return result;
+        }
+    }
+    writer->detached.count = 0;
+    return 0;
+}
+
+/* the trash is changed by the data thread only, no lock needed */
+static int checkpoint_write_trash(DentryCheckpointWriter *writer,
+        FDIRNamespaceEntry *ns_entry)
+{
+    FDIRTrashEntry *entry;
+    FDIRDentryCheckpointTrash *te;
+    int result;
+
+    if (ns_entry->trash.count == 0) {
+        return 0;
+    }
+
+    if ((result=checkpoint_write_section(writer,
+                    DENTRY_CHECKPOINT_SECTION_TRASH,
+                    ns_entry->trash.count, 0)) != 0)
+    {
+        return result;
+    }
+
+    for (entry=ns_entry->trash.head; entry!=NULL; entry=entry->next) {
+        if ((result=fast_buffer_check(&writer->buffer,
+                        sizeof(FDIRDentryCheckpointTrash))) != 0)
+        {
+            return result;
+        }
+        te = (FDIRDentryCheckpointTrash *)(writer->buffer.data +
+                writer->buffer.length);
+        long2buff(entry->data_version, te->data_version);
+        long2buff(entry->inode, te->inode);
+        long2buff(entry->size, te->size);
+        writer->buffer.length += sizeof(FDIRDentryCheckpointTrash);
+
+        if ((result=checkpoint_check_flush(writer)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static int checkpoint_write_namespace(FDIRNamespaceEntry *ns_entry,
+        void *args)
+{
+    DentryCheckpointWriter *writer;
+    int result;
+
+    writer = (DentryCheckpointWriter *)args;
+    if ((result=checkpoint_write_section(writer,
+                    DENTRY_CHECKPOINT_SECTION_NAMESPACE, ns_entry->name.len,
+                    (ns_entry->dentry_root != NULL ? 1 : 0))) != 0)
+    {
+        return result;
+    }
+    if ((result=fast_buffer_append_buff(&writer->buffer,
+                    ns_entry->name.str, ns_entry->name.len)) != 0)
+    {
+        return result;
+    }
+
+    if (ns_entry->dentry_root != NULL) {
+        if ((result=checkpoint_write_tree(writer, ns_entry)) != 0) {
+            return result;
+        }
+    }
+    return checkpoint_write_trash(writer, ns_entry);
+}
+
+/* all the records of this thread not greater than the current data version
+ * are applied when the queue is empty, because the data version is assigned
+ * by the data thread, or the records are pushed in the data version order */
+static int64_t get_checkpoint_version(FDIRDataThreadContext *db_context)
+{
+    int64_t data_version;
+
+    data_version = __sync_add_and_fetch(&DATA_CURRENT_VERSION, 0);
+    if (fc_mpsc_queue_empty(&db_context->queue) &&
+            data_version > db_context->applied_version)
+    {
+        db_context->applied_version = data_version;
+    }
+    return db_context->applied_version;
+}
+
+static int checkpoint_write_file(DentryCheckpointWriter *writer,
+        const int64_t data_version)
+{
+    FDIRDentryStoreContext *store;
+    FDIRDentryCheckpointHeader header;
+    int64_t block_count;
+    int result;
+
+    store = &writer->db_context->store_context;
+    if (lseek(writer->fd, sizeof(header), SEEK_SET) < 0) {
+        return errno != 0 ? errno : EIO;
+    }
+
+    if ((result=checkpoint_write_blocks(writer, &block_count)) != 0) {
+        return result;
+    }
+    if ((result=dentry_scan_namespaces(&writer->db_context->dentry_context,
+                    checkpoint_write_namespace, writer)) != 0)
+    {
+        return result;
+    }
+    if ((result=checkpoint_write_section(writer,
+                    DENTRY_CHECKPOINT_SECTION_END, 0, 0)) != 0)
+    {
+        return result;
+    }
+    if ((result=checkpoint_flush(writer)) != 0) {
+        return result;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DENTRY_CHECKPOINT_MAGIC, sizeof(header.magic));
+    int2buff(DATA_THREAD_COUNT, header.thread_count);
+    int2buff(writer->db_context->index, header.thread_index);
+    int2buff(store->generation, header.generation);
+    long2buff(data_version, header.data_version);
+    long2buff(store->file_size, header.store_size);
+    long2buff(block_count, header.block_count);
+    long2buff(writer->body_len, header.body_len);
+    int2buff(writer->crc32, header.crc32);
+    if (pwrite(writer->fd, &header, sizeof(header), 0) != sizeof(header)) {
+        return errno != 0 ? errno : EIO;
+    }
+
+    return fsync(writer->fd) == 0 ? 0 : (errno != 0 ? errno : EIO);
+}
+
+int dentry_store_checkpoint(FDIRDataThreadContext *db_context)
+{
+    FDIRDentryStoreContext *store;
+    DentryCheckpointWriter writer;
+    char tmp_filename[PATH_MAX];
+    char filename[PATH_MAX];
+    int64_t data_version;
+    int64_t start_time;
+    int old_generation;
+    int result;
+
+    store = &db_context->store_context;
+    if (fsync(store->fd) != 0) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "data thread #%d, fsync dentry store fail, "
+                "errno: %d, error info: %s", __LINE__,
+                db_context->index, result, STRERROR(result));
+        return result;
+    }
+
+    start_time = get_current_time_ms();
+    dentry_usage_flush(db_context);
+    data_version = get_checkpoint_version(db_context);
+
+    get_checkpoint_filename(db_context->index, filename, sizeof(filename));
+    snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp", filename);
+    memset(&writer, 0, sizeof(writer));
+    writer.db_context = db_context;
+    if ((writer.fd=open(tmp_filename, O_WRONLY | O_CREAT |
+                    O_TRUNC | O_CLOEXEC, 0644)) < 0)
+    {
+        result = errno != 0 ? errno : EACCES;
+        logError("file: "__FILE__", line: %d, "
+                "open file %s fail, errno: %d, error info: %s",
+                __LINE__, tmp_filename, result, STRERROR(result));
+        return result;
+    }
+
+    if ((result=fast_buffer_init_ex(&writer.buffer,
+                    DENTRY_CHECKPOINT_BUFFER_SIZE + 64 * 1024)) == 0)
+    {
+        result = checkpoint_write_file(&writer, data_version);
+        fast_buffer_destroy(&writer.buffer);
+    }
+    if (writer.detached.dentries != NULL) {
+        free(writer.detached.dentries);
+    }
+    close(writer.fd);
+
+    if (result == 0 && rename(tmp_filename, filename) != 0) {
+        result = errno != 0 ? errno : EIO;
+    }
+    if (result != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "data thread #%d, write checkpoint file %s fail, "
+                "errno: %d, error info: %s", __LINE__, db_context->index,
+                filename, result, STRERROR(result));
+        unlink(tmp_filename);
+        return result;
+    }
+
+    old_generation = store->checkpoint.generation;
+    store->checkpoint.generation = store->generation;
+    store->checkpoint.data_version = data_version;
+    store->checkpoint.last_time = g_current_time;
+    if (old_generation != store->generation) {
+        remove_store_file(db_context->index, old_generation);
+    }
+
+    logInfo("file: "__FILE__", line: %d, "
+            "data thread #%d, checkpoint done, data version: %"PRId64", "
+            "store generation: %d, store file size: %"PRId64", "
+            "time used: %"PRId64" ms", __LINE__, db_context->index,
+            data_version, store->generation, store->file_size,
+            get_current_time_ms() - start_time);
+    return 0;
+}
+
+static void remove_store_files(const int thread_index,
+        const int keep_generation)
+{
+    char path[PATH_MAX];
+    char prefix[32];
+    char filename[PATH_MAX];
+    DIR *dir;
+    struct dirent *ent;
+    int prefix_len;
+
+    get_store_path(path, sizeof(path));
+    if ((dir=opendir(path)) == NULL) {
+        return;
+    }
+
+    prefix_len = sprintf(prefix, "store-%02d-", thread_index);
+    while ((ent=readdir(dir)) != NULL) {
+        if (strncmp(ent->d_name, prefix, prefix_len) != 0 ||
+                atoi(ent->d_name + prefix_len) == keep_generation)
+        {
+            continue;
+        }
+
+        snprintf(filename, sizeof(filename), "%s/%s", path, ent->d_name);
+        if (unlink(filename) != 0) {
+            logWarning("file: "__FILE__", line: %d, "
+                    "unlink file %s fail, errno: %d, error info: %s",
+                    __LINE__, filename, errno, STRERROR(errno));
+        }
+    }
+    closedir(dir);
+}
+
+static int checkpoint_read(DentryCheckpointReader *reader, const int size)
+{
+    int avail;
+    int bytes;
+
+    avail = (reader->buffer.data + reader->buffer.length) - reader->current;
+    if (avail >= size) {
+        return 0;
+    }
+    if (size > reader->buffer.alloc_size || reader->remain == 0) {
+        return EINVAL;
+    }
+
+    memmove(reader->buffer.data, reader->current, avail);
+    bytes = FC_MIN(reader->buffer.alloc_size - avail, reader->remain);
+    if (fc_safe_read(reader->fd, reader->buffer.data + avail,
+                bytes) != bytes)
+    {
+        return errno != 0 ? errno : EIO;
+    }
+
+    reader->remain -= bytes;
+    reader->buffer.length = avail + bytes;
+    reader->current = reader->buffer.data;
+    return reader->buffer.length >= size ? 0 : EINVAL;
+}
+
+static int checkpoint_open(DentryCheckpointReader *reader,
+        const int thread_index, DentryCheckpointInfo *info)
+{
+    FDIRDentryCheckpointHeader header;
+
+    get_checkpoint_filename(thread_index, reader->filename,
+            sizeof(reader->filename));
+    if ((reader->fd=open(reader->filename, O_RDONLY | O_CLOEXEC)) < 0) {
+        return errno != 0 ? errno : EACCES;
+    }
+
+    if (fc_safe_read(reader->fd, (char *)&header,
+                sizeof(header)) != sizeof(header) || memcmp(header.magic, DENTRY_CHECKPOINT_MAGIC,
+                sizeof(header.magic)) != 0 ||
+            buff2int(header.thread_count) != DATA_THREAD_COUNT ||
+            buff2int(header.thread_index) != thread_index)
+    {
+        return EINVAL;
+    }
+
+    info->generation = buff2int(header.generation);
+    info->data_version = buff2long(header.data_version);
+    info->store_size = buff2long(header.store_size);
+    info->block_count = buff2long(header.block_count);
+    info->body_len = buff2long(header.body_len);
+    info->crc32 = buff2int(header.crc32);
+    reader->remain = info->body_len;
+    reader->buffer.length = 0;
+    reader->current = reader->buffer.data;
+    return 0;
+}
+
+static inline void checkpoint_close(DentryCheckpointReader *reader)
+{
+    if (reader->fd >= 0) {
+        close(reader->fd);
+        reader->fd = -1;
+    }
+}
+
+/* check the checkpoint file and the store file it refers to */
+static int checkpoint_check(DentryCheckpointReader *reader,
+        const int thread_index, const int64_t binlog_version,
+        DentryCheckpointInfo *info)
+{
+    char filename[PATH_MAX];
+    struct stat st;
+    uint32_t crc32;
+    int bytes;
+    int result;
+
+    if ((result=checkpoint_open(reader, thread_index, info)) != 0) {
+        checkpoint_close(reader);
+        if (result == ENOENT) {
+            logInfo("file: "__FILE__", line: %d, "
+                    "checkpoint file %s not exist", __LINE__,
+                    reader->filename);
+        } else {
+            logWarning("file: "__FILE__", line: %d, "
+                    "invalid checkpoint file %s, errno: %d, "
+                    "error info: %s", __LINE__, reader->filename,
+                    result, STRERROR(result));
+        }
+        return result;
+    }
+
+    crc32 = 0;
+    while (reader->remain > 0) {
+        bytes = FC_MIN(reader->buffer.alloc_size, reader->remain);
+        if (fc_safe_read(reader->fd, reader->buffer.data, bytes) != bytes) {
+            break;
+        }
+        crc32 = fc_crc32c(crc32, reader->buffer.data, bytes);
+        reader->remain -= bytes;
+    }
+    checkpoint_close(reader);
+
+    if (reader->remain > 0 || crc32 != info->crc32) {
+        logWarning("file: "__FILE__", line: %d, "
+                "checkpoint file %s is corrupted",
+                __LINE__, reader->filename);
+        return EINVAL;
+    }
+
+    if (info->data_version > binlog_version) {
+        logWarning("file: "__FILE__", line: %d, "
+                "the data version: %"PRId64" of checkpoint file %s "
+                "> the max data version: %"PRId64" of the binlog",
+                __LINE__, info->data_version, reader->filename,
+                binlog_version);
+        return EINVAL;
+    }
+
+    get_store_filename(thread_index, info->generation,
+            filename, sizeof(filename));
+    if (stat(filename, &st) != 0 || st.st_size < info->store_size) {
+        logWarning("file: "__FILE__", line: %d, "
+                "the store file %s of checkpoint file %s not exist "
+                "or it's size < %"PRId64, __LINE__, filename,
+                reader->filename, info->store_size);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+static int add_hdlink_entry(DentryHardLinkArray *hdlinks,
+        FDIRServerDentry *dentry, const int64_t src_inode)
+{
+    DentryHardLinkEntry *entries;
+    int alloc;
+
+    if (hdlinks->count == hdlinks->alloc) {
+        alloc = (hdlinks->alloc == 0) ? 1024 : hdlinks->alloc * 2;
+        entries = (DentryHardLinkEntry *)fc_malloc(
+                sizeof(DentryHardLinkEntry) * alloc);
+        if (entries == NULL) {
+            return ENOMEM;
+        }
+
+        if (hdlinks->entries != NULL) {
+            memcpy(entries, hdlinks->entries, sizeof(
+                        DentryHardLinkEntry) * hdlinks->count);
+            free(hdlinks->entries);
+        }
+        hdlinks->entries = entries;
+        hdlinks->alloc = alloc;
+    }
+
+    hdlinks->entries[hdlinks->count].dentry = dentry;
+    hdlinks->entries[hdlinks->count].src_inode = src_inode;
+    hdlinks->count++;
+    return 0;
+}
+
+static int restore_directory(FDIRDataThreadContext *db_context,
+        FDIRServerDentry *dentry, const char *extra)
+{
+    const FDIRDentryCheckpointUsage *usage;
+    FDIRDentryStoreBlock *block;
+    int result;
+
+    if ((block=get_block(&db_context->store_context,
+                    dentry->inode, false)) != NULL && block->offset >= 0)
+    {
+        dentry->children = NULL;  //the children are in the store file
+    } else if ((dentry->children=uniq_skiplist_new(&db_context->
+                    dentry_context.factory, 2)) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    if ((result=dentry_usage_alloc(db_context, dentry)) != 0) {
+        return result;
+    }
+    usage = (const FDIRDentryCheckpointUsage *)extra;
+    dentry->usage->total.files = buff2long(usage->files);
+    dentry->usage->total.dirs = buff2long(usage->dirs);
+    dentry->usage->total.bytes = buff2long(usage->bytes);
+    dentry->usage->total.alloc = buff2long(usage->alloc);
+    return 0;
+}
+
+static int restore_dentry(FDIRDataThreadContext *db_context,
+        DentryCheckpointReader *reader, FDIRNamespaceEntry *ns_entry,
+        FDIRServerDentry *parent, const bool detached,
+        DentryHardLinkArray *hdlinks, FDIRServerDentry **dentry)
+{
+    FDIRDentryContext *context;
+    FDIRDentryStoreRecord *record;
+    const FDIRDentryCheckpointAccounted *accounted;
+    const FDIRDentryCheckpointHdlink *hdlink;
+    const char *extra;
+    int link_len;
+    int size;
+    int result;
+
+    *dentry = NULL;
+    if ((result=checkpoint_read(reader, sizeof(
+                        FDIRDentryStoreRecord))) != 0)
+    {
+        return result;
+    }
+    record = (FDIRDentryStoreRecord *)reader->current;
+    link_len = buff2short(record->link_len);
+    size = sizeof(FDIRDentryStoreRecord) + record->name_len + link_len +
+        get_record_extra_size(buff2int(record->mode));
+    if ((result=checkpoint_read(reader, size)) != 0) {
+        return result;
+    }
+    record = (FDIRDentryStoreRecord *)reader->current;
+    reader->current += size;
+
+    if (detached && inode_index_get_dentry(
+                buff2long(record->inode)) != NULL)
+    {
+        return 0;  //in the tree or restored already
+    }
+
+    context = &db_context->dentry_context;
+    if ((result=unpack_record(context, ns_entry, parent,
+                    record, dentry)) != 0)
+    {
+        return result;
+    }
+
+    extra = record->strings + record->name_len + link_len;
+    if (FDIR_IS_DENTRY_HARD_LINK((*dentry)->stat.mode)) {
+        hdlink = (const FDIRDentryCheckpointHdlink *)extra;
+        if ((result=add_hdlink_entry(hdlinks, *dentry, buff2long(
+                            hdlink->src_inode))) != 0)
+        {
+            return result;
+        }
+        context->counters.file++;
+    } else {
+        if (S_ISDIR((*dentry)->stat.mode)) {
+            if ((result=restore_directory(db_context,
+                            *dentry, extra)) != 0)
+            {
+                return result;
+            }
+            context->counters.dir++;
+        } else {
+            if (S_ISREG((*dentry)->stat.mode)) {
+                accounted = (const FDIRDentryCheckpointAccounted *)extra;
+                (*dentry)->accounted.size = buff2long(accounted->size);
+                (*dentry)->accounted.alloc = buff2long(accounted->alloc);
+            }
+            context->counters.file++;
+        }
+
+        if ((result=inode_index_add_dentry(*dentry)) != 0) {
+            return result;
+        }
+    }
+
+    if (parent != NULL) {
+        if ((result=uniq_skiplist_insert(parent->children, *dentry)) != 0) {
+            return result;
+        }
+    }
+    __sync_add_and_fetch(&ns_entry->dentry_count, 1);
+    return 0;
+}
+
+static int restore_children(FDIRDataThreadContext *db_context,
+        DentryCheckpointReader *reader, FDIRNamespaceEntry *ns_entry,
+        const FDIRDentryCheckpointSection *section,
+        DentryHardLinkArray *hdlinks)
+{
+    const bool detached = false;
+    FDIRServerDentry *dir;
+    FDIRServerDentry *dentry;
+    UniqSkiplist *children;
+    int count;
+    int i;
+    int result;
+
+    count = buff2int(section->count);
+    if ((dir=inode_index_get_dentry(buff2long(section->inode))) == NULL ||
+            !S_ISDIR(dir->stat.mode) || dir->children == NULL ||
+            dir->ns_entry != ns_entry)
+    {
+        return EINVAL;
+    }
+
+    if (uniq_skiplist_empty(dir->children)) {
+        if ((children=uniq_skiplist_new(&db_context->dentry_context.
+                        factory, get_children_level_count(
+                            db_context, count))) == NULL)
+        {
+            return ENOMEM;
+        }
+        uniq_skiplist_free(dir->children);
+        dir->children = children;
+    }
+
+    for (i=0; i<count; i++) {
+        if ((result=restore_dentry(db_context, reader, ns_entry,
+                        dir, detached, hdlinks, &dentry)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static int restore_trash(DentryCheckpointReader *reader,
+        FDIRNamespaceEntry *ns_entry,
+        const FDIRDentryCheckpointSection *section)
+{
+    FDIRDentryCheckpointTrash *te;
+    int count;
+    int i;
+    int result;
+
+    count = buff2int(section->count);
+    for (i=0; i<count; i++) {
+        if ((result=checkpoint_read(reader, sizeof(
+                            FDIRDentryCheckpointTrash))) != 0)
+        {
+            return result;
+        }
+        te = (FDIRDentryCheckpointTrash *)reader->current;
+        reader->current += sizeof(FDIRDentryCheckpointTrash);
+
+        if ((result=dentry_trash_add(ns_entry, buff2long(
+                            te->data_version), buff2long(te->inode),
+                        buff2long(te->size))) != 0)
+        {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static int restore_sections(FDIRDataThreadContext *db_context,
+        DentryCheckpointReader *reader, DentryHardLinkArray *hdlinks)
+{
+    const FDIRDentryCheckpointSection *section;
+    FDIRNamespaceEntry *ns_entry;
+    FDIRServerDentry *dentry;
+    string_t ns;
+    bool has_root;
+    int result;
+
+    ns_entry = NULL;
+    while (1) {
+        if ((result=checkpoint_read(reader, sizeof(
+                            FDIRDentryCheckpointSection))) != 0)
+        {
+            return result;
+        }
+        section = (const FDIRDentryCheckpointSection *)reader->current;
+        reader->current += sizeof(FDIRDentryCheckpointSection);
+
+        switch (section->type) {
+            case DENTRY_CHECKPOINT_SECTION_NAMESPACE:
+                has_root = (buff2long(section->inode) != 0);
+                ns.len = buff2int(section->count);
+                if ((result=checkpoint_read(reader, ns.len)) != 0) {
+                    return result;
+                }
+                ns.str = reader->current;
+                reader->current += ns.len;
+                if ((ns_entry=dentry_get_namespace(&db_context->
+                                dentry_context, &ns, &result)) == NULL)
+                {
+                    return result;
+                }
+                if (!has_root) {
+                    break;
+                }
+                if ((result=restore_dentry(db_context, reader, ns_entry,
+                                NULL, false, hdlinks, &dentry)) != 0)
+                {
+                    return result;
+                }
+                ns_entry->dentry_root = dentry;
+                break;
+            case DENTRY_CHECKPOINT_SECTION_CHILDREN:
+                if (ns_entry == NULL) {
+                    return EINVAL;
+                }
+                if ((result=restore_children(db_context, reader,
+                                ns_entry, section, hdlinks)) != 0)
+                {
+                    return result;
+                }
+                break;
+            case DENTRY_CHECKPOINT_SECTION_DETACHED:
+                if (ns_entry == NULL) {
+                    return EINVAL;
+                }
+                if ((result=restore_dentry(db_context, reader, ns_entry,
+                                NULL, true, hdlinks, &dentry)) != 0)
+                {
+                    return result;
+                }
+                break;
+            case DENTRY_CHECKPOINT_SECTION_TRASH:
+                if (ns_entry == NULL) {
+                    return EINVAL;
+                }
+                if ((result=restore_trash(reader, ns_entry, section)) != 0) {
+                    return result;
+                }
+                break;
+            case DENTRY_CHECKPOINT_SECTION_END:
+                return 0;
+            default:
+                return EINVAL;
+        }
+    }
+}
+
+static int restore_blocks(FDIRDataThreadContext *db_context,
+        DentryCheckpointReader *reader, const int64_t block_count)
+{
+    FDIRDentryStoreContext *store;
+    FDIRDentryCheckpointBlock *entry;
+    FDIRDentryStoreBlock *block;
+    int64_t i;
+    int result;
+
+    store = &db_context->store_context;
+    for (i=0; i<block_count; i++) {
+        if ((result=checkpoint_read(reader, sizeof(
+                            FDIRDentryCheckpointBlock))) != 0)
+        {
+            return result;
+        }
+        entry = (FDIRDentryCheckpointBlock *)reader->current;
+        reader->current += sizeof(FDIRDentryCheckpointBlock);
+
+        if ((block=get_block(store, buff2long(entry->inode),
+                        true)) == NULL)
+        {
+            return ENOMEM;
+        }
+        block->offset = buff2long(entry->offset);
+        block->length = buff2int(entry->length);
+    }
+
+    return 0;
+}
+
+/* add the children of the cold directories to the cold index */
+static int restore_cold_dentries(FDIRDataThreadContext *db_context)
+{
+    FDIRDentryStoreContext *store;
+    FDIRDentryStoreBlock **bucket;
+    FDIRDentryStoreBlock **end;
+    FDIRDentryStoreBlock *block;
+    FDIRDentryStoreRecord *record;
+    FDIRServerDentry *dir;
+    char *p;
+    char *rend;
+    int count;
+    int result;
+
+    store = &db_context->store_context;
+    end = store->htable.buckets + store->htable.capacity;
+    for (bucket=store->htable.buckets; bucket<end; bucket++) {
+        for (block=*bucket; block!=NULL; block=block->next) {
+            if ((dir=inode_index_get_dentry(block->inode)) == NULL ||
+                    !FDIR_IS_DENTRY_COLD(dir))
+            {
+                logError("file: "__FILE__", line: %d, "
+                        "data thread #%d, the cold directory %"PRId64" "
+                        "of the checkpoint not exist", __LINE__,
+                        db_context->index, block->inode);
+                return EINVAL;
+            }
+
+            if ((result=read_block(db_context, dir, block, &count)) != 0) {
+                return result;
+            }
+
+            p = store->buffer.data + sizeof(FDIRDentryStoreBlockHeader);
+            rend = store->buffer.data + store->buffer.length;
+            while (p < rend) {
+                record = (FDIRDentryStoreRecord *)p;
+                if ((result=inode_index_add_cold(buff2long(record->inode),
+                                dir->inode)) != 0)
+                {
+                    return result;
+                }
+                p += sizeof(FDIRDentryStoreRecord) + record->name_len +
+                    buff2short(record->link_len);
+            }
+
+            db_context->dentry_context.counters.file += count;
+            __sync_add_and_fetch(&dir->ns_entry->dentry_count, count);
+            store->cold_inodes += count;
+            store->live_bytes += block->length;
+        }
+    }
+
+    return 0;
+}
+
+static int restore_thread(FDIRDataThreadContext *db_context,
+        DentryCheckpointReader *reader, DentryCheckpointInfo *info,
+        DentryHardLinkArray *hdlinks)
+{
+    FDIRDentryStoreContext *store;
+    int result;
+
+    store = &db_context->store_context;
+    if ((store->fd=open_store_file(db_context,
+                    info->generation, false)) < 0)
+    {
+        return -1 * store->fd;
+    }
+
+    /* the blocks appended after the checkpoint are discarded */
+    if (ftruncate(store->fd, info->store_size) != 0) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "data thread #%d, truncate dentry store to %"PRId64" "
+                "fail, errno: %d, error info: %s", __LINE__,
+                db_context->index, info->store_size,
+                result, STRERROR(result));
+        return result;
+    }
+    store->generation = info->generation;
+    store->file_size = info->store_size;
+    remove_store_files(db_context->index, info->generation);
+
+    if ((result=checkpoint_open(reader, db_context->index, info)) == 0) {
+        if ((result=restore_blocks(db_context, reader,
+                        info->block_count)) == 0)
+        {
+            result = restore_sections(db_context, reader, hdlinks);
+        }
+    }
+    checkpoint_close(reader);
+    if (result != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "data thread #%d, restore checkpoint file %s fail, "
+                "errno: %d, error info: %s", __LINE__, db_context->index,
+                reader->filename, result, STRERROR(result));
+        return result;
+    }
+
+    if ((result=restore_cold_dentries(db_context)) != 0) {
+        return result;
+    }
+
+    store->checkpoint.generation = info->generation;
+    store->checkpoint.data_version = info->data_version;
+    store->checkpoint.last_time = g_current_time;
+    db_context->applied_version = info->data_version;
+    return 0;
+}
+
+static int resolve_hdlinks(DentryHardLinkArray *hdlinks)
+{
+    DentryHardLinkEntry *entry;
+    DentryHardLinkEntry *end;
+
+    end = hdlinks->entries + hdlinks->count;
+    for (entry=hdlinks->entries; entry<end; entry++) {
+        if ((entry->dentry->src_dentry=inode_index_get_dentry(
+                        entry->src_inode)) == NULL)
+        {
+            logError("file: "__FILE__", line: %d, "
+                    "the source inode %"PRId64" of the hard link "
+                    "%"PRId64" not exist", __LINE__, entry->src_inode,
+                    entry->dentry->inode);
+            return ENOENT;
+        }
+    }
+
+    return 0;
+}
+
+/* start with the empty stores and remove the checkpoints,
+ * the data is loaded from the binlog */
+static int discard_checkpoints()
+{
+    FDIRDataThreadContext *db_context;
+    FDIRDataThreadContext *end;
+    FDIRDentryStoreContext *store;
+    char filename[PATH_MAX];
+
+    end = g_data_thread_vars.thread_array.contexts + DATA_THREAD_COUNT;
+    for (db_context=g_data_thread_vars.thread_array.contexts;
+            db_context<end; db_context++)
+    {
+        get_checkpoint_filename(db_context->index,
+                filename, sizeof(filename));
+        if (unlink(filename) != 0 && errno != ENOENT) {
+            logError("file: "__FILE__", line: %d, "
+                    "unlink file %s fail, errno: %d, error info: %s",
+                    __LINE__, filename, errno, STRERROR(errno));
+            return errno != 0 ? errno : EPERM;
+        }
+
+        store = &db_context->store_context;
+        remove_store_files(db_context->index, 0);
+        if ((store->fd=open_store_file(db_context, 0, true)) < 0) {
+            return -1 * store->fd;
+        }
+        store->generation = 0;
+        store->file_size = 0;
+        store->checkpoint.generation = 0;
+        store->checkpoint.data_version = 0;
+        store->checkpoint.last_time = g_current_time;
+    }
+
+    return 0;
+}
+
+int dentry_store_restore(int64_t *min_version, int64_t *max_version)
+{
+    FDIRDataThreadContext *db_context;
+    DentryCheckpointReader reader;
+    DentryCheckpointInfo *infos;
+    DentryHardLinkArray hdlinks;
+    int64_t binlog_version;
+    int64_t start_time;
+    char time_buff[32];
+    int result;
+    int i;
+
+    *min_version = *max_version = 0;
+    if (!STORAGE_ENABLED) {
+        return 0;
+    }
+
+    start_time = get_current_time_ms();
+    if ((result=binlog_get_max_record_version(&binlog_version)) != 0) {
+        return result;
+    }
+
+    infos = (DentryCheckpointInfo *)fc_malloc(sizeof(
+                DentryCheckpointInfo) * DATA_THREAD_COUNT);
+    if (infos == NULL) {
+        return ENOMEM;
+    }
+    memset(&reader, 0, sizeof(reader));
+    reader.fd = -1;
+    if ((result=fast_buffer_init_ex(&reader.buffer,
+                    DENTRY_CHECKPOINT_BUFFER_SIZE)) != 0)
+    {
+        free(infos);
+        return result;
+    }
+
+    /* all or none of the checkpoints are restored */
+    for (i=0; i<DATA_THREAD_COUNT; i++) {
+        if ((result=checkpoint_check(&reader, i,
+                        binlog_version, infos + i)) != 0)
+        {
+            break;
+        }
+    }
+
+    if (result != 0) {
+        fast_buffer_destroy(&reader.buffer);
+        free(infos);
+        return discard_checkpoints();
+    }
+
+    memset(&hdlinks, 0, sizeof(hdlinks));
+    for (i=0; i<DATA_THREAD_COUNT; i++) {
+        db_context = g_data_thread_vars.thread_array.contexts + i;
+        if ((result=restore_thread(db_context, &reader,
+                        infos + i, &hdlinks)) != 0)
+        {
+            break;
+        }
+
+        if (i == 0 || infos[i].data_version < *min_version) {
+            *min_version = infos[i].data_version;
+        }
+        if (infos[i].data_version > *max_version) {
+            *max_version = infos[i].data_version;
+        }
+    }
+
+    if (result == 0) {
+        result = resolve_hdlinks(&hdlinks);
+    }
+    if (hdlinks.entries != NULL) {
+        free(hdlinks.entries);
+    }
+    fast_buffer_destroy(&reader.buffer);
+    free(infos);
+
+    if (result == 0) {
+        logInfo("file: "__FILE__", line: %d, "
+                "restore the dentry checkpoints done, data version "
+                "from %"PRId64" to %"PRId64", time used: %s ms", __LINE__,
+                *min_version, *max_version, long_to_comma_str(
+                    get_current_time_ms() - start_time, time_buff));
+    }
+    return result;
+}
+
+void dentry_store_terminate()
+{
+    FDIRDataThreadContext *db_context;
+    FDIRDataThreadContext *end;
+
+    if (!STORAGE_ENABLED || __sync_add_and_fetch(
+                &g_data_thread_vars.running_count, 0) != 0)
+    {
+        return;
+    }
+
+    end = g_data_thread_vars.thread_array.contexts + DATA_THREAD_COUNT;
+    for (db_context=g_data_thread_vars.thread_array.contexts;
+            db_context<end; db_context++)
+    {
+        if (db_context->store_context.fd >= 0) {
+            dentry_store_checkpoint(db_context);
+        }
+    }
+}
+
+static inline bool need_compact(FDIRDentryStoreContext *store)
+{
+    return store->compact.in_progress || (store->file_size >=
+            DENTRY_STORE_COMPACT_MIN_FILE_SIZE && store->live_bytes * 100 <
+            store->file_size * DENTRY_STORE_COMPACT_LIVE_PERCENT);
+}
+
+void dentry_store_check_evict(FDIRDataThreadContext *db_context)
+{
+    FDIRDentryStoreContext *store;
+    FDIRDentryCounters *counters;
+    DentryStoreCandidates candidates;
+    FDIRServerDentry **dir;
+    FDIRServerDentry **end;
+    int64_t memory_inodes;
+    int64_t target_count;
+    int64_t evict_count;
+    int64_t evict_dirs;
+    int scan_buckets;
+    int count;
+
+    store = &db_context->store_context;
+    if (store->last_check_time == g_current_time) {
+        return;
+    }
+    store->last_check_time = g_current_time;
+
+    /* the eviction appends blocks to the store file, so it waits for
+     * the compaction done, and goes on when the compaction fail */
+    if (need_compact(store) && compact_store(db_context) == 0) {
+        return;
+    }
+
+    if (g_current_time - store->checkpoint.last_time >=
+            STORAGE_CHECKPOINT_INTERVAL)
+    {
+        store->checkpoint.last_time = g_current_time;
+        if (get_checkpoint_version(db_context) !=
+                store->checkpoint.data_version)
+        {
+            dentry_store_checkpoint(db_context);
+            return;
+        }
+    }
+
+    counters = &db_context->dentry_context.counters;
+    memory_inodes = counters->dir + counters->file - store->cold_inodes;
+    if (memory_inodes <= STORAGE_INODE_LIMIT) {
+        return;
+    }
+
+    /* evict to 90% of the limit to avoid evicting every second */
+    target_count = memory_inodes - STORAGE_INODE_LIMIT * 9 / 10;
+    evict_count = evict_dirs = 0;
+    candidates.db_context = db_context;
+    for (scan_buckets=0; scan_buckets<DENTRY_STORE_MAX_SCAN_BUCKETS &&
+            evict_count < target_count; scan_buckets +=
+            DENTRY_STORE_SCAN_BUCKETS_ONCE)
+    {
+        candidates.count = 0;
+        store->scan_bucket = inode_index_scan(store->scan_bucket,
+                DENTRY_STORE_SCAN_BUCKETS_ONCE, collect_cold_dir,
+                &candidates);
+
+        end = candidates.dirs + candidates.count;
+        for (dir=candidates.dirs; dir<end &&
+                evict_count < target_count; dir++)
+        {
+            if (evict_directory(db_context, *dir, &count) == 0) {
+                evict_count += count;
+                evict_dirs++;
+            }
+        }
+    }
+
+    if (evict_dirs > 0) {
+        logInfo("file: "__FILE__", line: %d, "
+                "data thread #%d, in-memory inodes: %"PRId64", "
+                "evict %"PRId64" directories with %"PRId64" inodes, "
+                "cold inodes: %"PRId64", store file size: %"PRId64,
+                __LINE__, db_context->index, memory_inodes,
+                evict_dirs, evict_count, store->cold_inodes,
+                store->file_size);
+    }
+}
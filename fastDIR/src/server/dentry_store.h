@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//dentry_store.h
+
+/* the dentry store keeps the children of the cold leaf directories
+ * in a local file per data thread, one block per directory ordered
+ * by (parent inode, name). the evicted directory stays in memory
+ * with NULL children and its children are indexed by the cold inode
+ * hashtable of inode_index. the loaded blocks leave holes in the file,
+ * the live blocks are copied to the store file of next generation when
+ * they drop below half of the file.
+ *
+ * the checkpoint of the data thread saves the block table and the
+ * in-memory dentries with the data version they cover. the server
+ * restores the checkpoints and the store files on startup, then
+ * replays the binlog records after the checkpoints only.
+ *
+ * the store is accessed by the data thread only, the nio threads
+ * push a load record to the data thread when they meet a cold dentry */
+
+#ifndef _FDIR_DENTRY_STORE_H
+#define _FDIR_DENTRY_STORE_H
+
+#include "server_types.h"
+#include "data_thread.h"
+
+#define FDIR_IS_DENTRY_COLD(dentry) \
+    (S_ISDIR((dentry)->stat.mode) && (dentry)->children == NULL)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    int dentry_store_init_context(FDIRDataThreadContext *db_context);
+
+    /* restore the checkpoints of all data threads, or start with the empty
+     * stores when any checkpoint is invalid. the binlog records after
+     * min_version should be replayed, min_version is 0 for all records */
+    int dentry_store_restore(int64_t *min_version, int64_t *max_version);
+
+    /* checkpoint the dentries of the data thread,
+     * called by the data thread or after it stopped */
+    int dentry_store_checkpoint(FDIRDataThreadContext *db_context);
+
+    /* checkpoint all data threads when the server stops */
+    void dentry_store_terminate();
+
+    /* load the children of the evicted directory */
+    int dentry_store_load(FDIRDataThreadContext *db_context,
+            FDIRServerDentry *dir);
+
+    static inline int dentry_store_check_load(FDIRDataThreadContext
+            *db_context, FDIRServerDentry *dentry)
+    {
+        if (FDIR_IS_DENTRY_COLD(dentry)) {
+            return dentry_store_load(db_context, dentry);
+        }
+        return 0;
+    }
+
+    /* load the evicted directory which contains the inode,
+     * return 0 when the inode is not cold */
+    int dentry_store_load_inode(FDIRDataThreadContext *db_context,
+            const int64_t inode);
+
+    /* get the evicted directory which contains the inode,
+     * NULL for not cold, can be called by any thread */
+    FDIRServerDentry *dentry_store_get_cold_dir(const int64_t inode);
+
+    /* remove the block info when the directory is freed */
+    void dentry_store_remove_dir(FDIRDataThreadContext *db_context,
+            const int64_t inode);
+
+    /* compact the store file, checkpoint, or evict the cold leaf
+     * directories when the in-memory inodes exceed the limit,
+     * called by the data thread periodically */
+    void dentry_store_check_evict(FDIRDataThreadContext *db_context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
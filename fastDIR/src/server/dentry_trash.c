@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "dentry_trash.h"
+
+#define TRASH_ALLOCATOR(ns_entry) \
+    (ns_entry)->context->db_context->trash_allocator
+
+int dentry_trash_init_context(FDIRDataThreadContext *db_context)
+{
+    return fast_mblock_init_ex1(&db_context->trash_allocator,
+            "trash_entry", sizeof(FDIRTrashEntry), 4 * 1024,
+            0, NULL, NULL, false);
+}
+
+int dentry_trash_init(FDIRNamespaceEntry *ns_entry)
+{
+    ns_entry->trash.head = NULL;
+    ns_entry->trash.tail = NULL;
+    ns_entry->trash.count = 0;
+    return init_pthread_lock(&ns_entry->trash.lock);
+}
+
+int dentry_trash_add(FDIRNamespaceEntry *ns_entry,
+        const int64_t data_version, const int64_t inode,
+        const int64_t size)
+{
+    FDIRTrashEntry *entry;
+
+    entry = (FDIRTrashEntry *)fast_mblock_alloc_object(
+            &TRASH_ALLOCATOR(ns_entry));
+    if (entry == NULL) {
+        return ENOMEM;
+    }
+    entry->data_version = data_version;
+    entry->inode = inode;
+    entry->size = size;
+    entry->next = NULL;
+
+    PTHREAD_MUTEX_LOCK(&ns_entry->trash.lock);
+    if (ns_entry->trash.head == NULL) {
+        ns_entry->trash.head = entry;
+    } else {
+        ns_entry->trash.tail->next = entry;
+    }
+    ns_entry->trash.tail = entry;
+    ns_entry->trash.count++;
+    PTHREAD_MUTEX_UNLOCK(&ns_entry->trash.lock);
+    return 0;
+}
+
+int dentry_trash_purge(FDIRNamespaceEntry *ns_entry,
+        const int64_t data_version)
+{
+    FDIRTrashEntry *head;
+    FDIRTrashEntry *entry;
+    FDIRTrashEntry *last;
+    int count;
+
+    count = 0;
+    last = NULL;
+    PTHREAD_MUTEX_LOCK(&ns_entry->trash.lock);
+    head = ns_entry->trash.head;
+    entry = head;
+    while (entry != NULL && entry->data_version <= data_version) {
+        last = entry;
+        entry = entry->next;
+        count++;
+    }
+    if (count > 0) {
+        last->next = NULL;  //detach the purged entries
+        ns_entry->trash.head = entry;
+        if (entry == NULL) {
+            ns_entry->trash.tail = NULL;
+        }
+        ns_entry->trash.count -= count;
+    } else {
+        head = NULL;
+    }
+    PTHREAD_MUTEX_UNLOCK(&ns_entry->trash.lock);
+
+    /* free out of the lock because the nio threads
+     * copy the entries with the lock held */
+    while (head != NULL) {
+        entry = head;
+        head = head->next;
+        fast_mblock_free_object(&TRASH_ALLOCATOR(ns_entry), entry);
+    }
+    return count;
+}
+
+bool dentry_trash_need_purge(FDIRNamespaceEntry *ns_entry,
+        const int64_t data_version)
+{
+    bool need_purge;
+
+    PTHREAD_MUTEX_LOCK(&ns_entry->trash.lock);
+    need_purge = (ns_entry->trash.head != NULL &&
+            ns_entry->trash.head->data_version <= data_version);
+    PTHREAD_MUTEX_UNLOCK(&ns_entry->trash.lock);
+    return need_purge;
+}
+
+int dentry_trash_list(FDIRNamespaceEntry *ns_entry,
+        FDIRSubtreeFile *files, const int size, int *count,
+        int64_t *last_version)
+{
+    FDIRTrashEntry *entry;
+    FDIRTrashEntry *end;
+    FDIRSubtreeFile *file;
+    int version_count;
+    int result;
+
+    *count = 0;
+    *last_version = 0;
+    result = 0;
+    PTHREAD_MUTEX_LOCK(&ns_entry->trash.lock);
+    entry = ns_entry->trash.head;
+    while (entry != NULL) {
+        version_count = 1;
+        end = entry->next;
+        while (end != NULL && end->data_version == entry->data_version) {
+            version_count++;
+            end = end->next;
+        }
+        if (*count + version_count > size) {
+            if (*count == 0) {
+                result = EOVERFLOW;
+            }
+            break;
+        }
+
+        *last_version = entry->data_version;
+        file = files + *count;
+        *count += version_count;
+        for (; entry!=end; entry=entry->next, file++) {
+            file->inode = entry->inode;
+            file->size = entry->size;
+        }
+    }
+    PTHREAD_MUTEX_UNLOCK(&ns_entry->trash.lock);
+    return result;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//dentry_trash.h
+
+/* the trash of the namespace keeps the regular files freed by the subtree
+ * remove, the data of these files should be deleted by the client.
+ *
+ * the data thread appends the freed files with the data version of the
+ * subtree record which freed them, and purges the files not greater than
+ * the version reported by the client after their data deleted. both are
+ * driven by the binlog records, so the slaves and the binlog replay
+ * rebuild the same trash, and the dentry checkpoint keeps it */
+
+#ifndef _FDIR_DENTRY_TRASH_H
+#define _FDIR_DENTRY_TRASH_H
+
+#include "server_types.h"
+#include "data_thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    int dentry_trash_init_context(FDIRDataThreadContext *db_context);
+
+    int dentry_trash_init(FDIRNamespaceEntry *ns_entry);
+
+    /* append the freed file, called by the data thread */
+    int dentry_trash_add(FDIRNamespaceEntry *ns_entry,
+            const int64_t data_version, const int64_t inode,
+            const int64_t size);
+
+    /* purge the files not greater than the data version,
+     * called by the data thread, return the purged count */
+    int dentry_trash_purge(FDIRNamespaceEntry *ns_entry,
+            const int64_t data_version);
+
+    /* if the first file is not greater than the data version */
+    bool dentry_trash_need_purge(FDIRNamespaceEntry *ns_entry,
+            const int64_t data_version);
+
+    /* list the files from the beginning, the files of the same data
+     * version are listed as a whole, so the last version can be purged.
+     * return EOVERFLOW when the files of the first version exceed size */
+    int dentry_trash_list(FDIRNamespaceEntry *ns_entry,
+            FDIRSubtreeFile *files, const int size, int *count,
+            int64_t *last_version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "dentry.h"
+#include "dentry_usage.h"
+
+#define USAGE_CTX   db_context->usage_context
+#define RESIZED_CTX USAGE_CTX.resized
+
+static inline void usage_add(FDIRSubtreeSummary *dest,
+        const FDIRSubtreeSummary *src)
+{
+    dest->files += src->files;
+    dest->dirs += src->dirs;
+    dest->bytes += src->bytes;
+    dest->alloc += src->alloc;
+}
+
+static inline void usage_sub(FDIRSubtreeSummary *dest,
+        const FDIRSubtreeSummary *src)
+{
+    dest->files -= src->files;
+    dest->dirs -= src->dirs;
+    dest->bytes -= src->bytes;
+    dest->alloc -= src->alloc;
+}
+
+//the usage added to the parent by the dentry
+static void get_contribution(FDIRServerDentry *dentry,
+        FDIRSubtreeSummary *usage)
+{
+    if (S_ISDIR(dentry->stat.mode)) {
+        *usage = dentry->usage->total;
+        return;
+    }
+
+    usage->files = 1;
+    usage->dirs = 0;
+    if (FDIR_IS_USAGE_REGULAR_FILE(dentry->stat.mode) &&
+            dentry->accounted.size >= 0)
+    {
+        usage->bytes = dentry->accounted.size;
+        usage->alloc = dentry->accounted.alloc;
+    } else {  //the hard link shares the data with the source file
+        usage->bytes = 0;
+        usage->alloc = 0;
+    }
+}
+
+static void add_pending(FDIRDataThreadContext *db_context,
+        FDIRServerDentry *parent, const FDIRSubtreeSummary *delta,
+        const bool subtract)
+{
+    FDIRDentryUsage *usage;
+
+    if (parent == NULL) {  //the root of the namespace
+        return;
+    }
+
+    usage = parent->usage;
+    if (subtract) {
+        usage_sub(&usage->pending, delta);
+    } else {
+        usage_add(&usage->pending, delta);
+    }
+    if (fc_list_empty(&usage->dlink)) {
+        fc_list_add_tail(&usage->dlink, &USAGE_CTX.dirty);
+    }
+}
+
+static int init_ptr_array(FDIRDentryPtrArray *array)
+{
+    array->alloc = 1024;
+    array->count = 0;
+    array->dentries = (FDIRServerDentry **)fc_malloc(
+            sizeof(FDIRServerDentry *) * array->alloc);
+    return array->dentries != NULL ? 0 : ENOMEM;
+}
+
+int dentry_usage_init_context(FDIRDataThreadContext *db_context)
+{
+    int result;
+
+    if ((result=fast_mblock_init_ex1(&USAGE_CTX.allocator,
+                    "dentry_usage", sizeof(FDIRDentryUsage),
+                    4 * 1024, 0, NULL, NULL, false)) != 0)
+    {
+        return result;
+    }
+    FC_INIT_LIST_HEAD(&USAGE_CTX.dirty);
+
+    if ((result=init_pthread_lock(&RESIZED_CTX.lock)) != 0) {
+        return result;
+    }
+    if ((result=init_ptr_array(RESIZED_CTX.holders + 0)) != 0) {
+        return result;
+    }
+    if ((result=init_ptr_array(RESIZED_CTX.holders + 1)) != 0) {
+        return result;
+    }
+    RESIZED_CTX.current = RESIZED_CTX.holders + 0;
+    RESIZED_CTX.dealing = RESIZED_CTX.holders + 1;
+    RESIZED_CTX.notified = false;
+
+    memset(&RESIZED_CTX.record, 0, sizeof(RESIZED_CTX.record));
+    RESIZED_CTX.record.operation = BINLOG_OP_SYNC_USAGE_INT;
+    RESIZED_CTX.record.hash_code = db_context->index;
+    return 0;
+}
+
+int dentry_usage_alloc(FDIRDataThreadContext *db_context,
+        FDIRServerDentry *dentry)
+{
+    FDIRDentryUsage *usage;
+
+    usage = (FDIRDentryUsage *)fast_mblock_alloc_object(&USAGE_CTX.allocator);
+    if (usage == NULL) {
+        return ENOMEM;
+    }
+
+    memset(usage, 0, sizeof(*usage));
+    usage->total.dirs = 1;
+    usage->dentry = dentry;
+    FC_INIT_LIST_HEAD(&usage->dlink);
+    dentry->usage = usage;
+    return 0;
+}
+
+void dentry_usage_create(FDIRDataThreadContext *db_context,
+        FDIRServerDentry *dentry)
+{
+    FDIRSubtreeSummary usage;
+
+    if (FDIR_IS_USAGE_REGULAR_FILE(dentry->stat.mode)) {
+        dentry->accounted.size = dentry->stat.size;
+        dentry->accounted.alloc = dentry->stat.alloc;
+    }
+
+    get_contribution(dentry, &usage);
+    add_pending(db_context, dentry->parent, &usage, false);
+}
+
+void dentry_usage_remove(FDIRDataThreadContext *db_context,
+        FDIRServerDentry *dentry, FDIRServerDentry *parent)
+{
+    FDIRSubtreeSummary usage;
+
+    get_contribution(dentry, &usage);
+    add_pending(db_context, parent, &usage, true);
+
+    if (S_ISDIR(dentry->stat.mode)) {
+        //the directory is empty, the pending usage is useless
+        fc_list_del_init(&dentry->usage->dlink);
+    } else if (FDIR_IS_USAGE_REGULAR_FILE(dentry->stat.mode)) {
+        //keep alive when other hard links exist
+        dentry->accounted.size = -1;
+        dentry->accounted.alloc = 0;
+    }
+}
+
+void dentry_usage_move(FDIRDataThreadContext *db_context,
+        FDIRServerDentry *dentry, FDIRServerDentry *old_parent,
+        FDIRServerDentry *new_parent)
+{
+    FDIRSubtreeSummary usage;
+
+    if (old_parent == new_parent) {
+        return;
+    }
+
+    get_contribution(dentry, &usage);
+    add_pending(db_context, old_parent, &usage, true);
+    add_pending(db_context, new_parent, &usage, false);
+}
+
+void dentry_usage_free(FDIRDataThreadContext *db_context,
+        FDIRServerDentry *dentry)
+{
+    if (dentry->usage == NULL) {
+        return;
+    }
+
+    fc_list_del_init(&dentry->usage->dlink);
+    fast_mblock_free_object(&USAGE_CTX.allocator, dentry->usage);
+    dentry->usage = NULL;
+}
+
+static int check_alloc_ptr_array(FDIRDentryPtrArray *array)
+{
+    FDIRServerDentry **dentries;
+    int alloc;
+
+    if (array->count < array->alloc) {
+        return 0;
+    }
+
+    alloc = array->alloc * 2;
+    dentries = (FDIRServerDentry **)fc_malloc(
+            sizeof(FDIRServerDentry *) * alloc);
+    if (dentries == NULL) {
+        return ENOMEM;
+    }
+
+    memcpy(dentries, array->dentries, sizeof(FDIRServerDentry *) *
+            array->count);
+    free(array->dentries);
+    array->dentries = dentries;
+    array->alloc = alloc;
+    return 0;
+}
+
+void dentry_usage_resized(FDIRServerDentry *dentry)
+{
+    FDIRDataThreadContext *db_context;
+    FDIRDentryPtrArray *array;
+    bool notify;
+
+    db_context = dentry->ns_entry->context->db_context;
+    PTHREAD_MUTEX_LOCK(&RESIZED_CTX.lock);
+    array = RESIZED_CTX.current;
+    if (!(array->count > 0 && array->dentries[array->count - 1] == dentry)) {
+        if (check_alloc_ptr_array(array) == 0) {
+            array->dentries[array->count++] = dentry;
+        } else {
+            logError("file: "__FILE__", line: %d, "
+                    "inode: %"PRId64", add to the resized array fail, "
+                    "the usage of the parent maybe incorrect",
+                    __LINE__, dentry->inode);
+        }
+    }
+
+    if (RESIZED_CTX.notified) {
+        notify = false;
+    } else {
+        RESIZED_CTX.notified = notify = true;
+    }
+    PTHREAD_MUTEX_UNLOCK(&RESIZED_CTX.lock);
+
+    if (notify) {
+        push_to_data_thread_queue(&RESIZED_CTX.record);
+    }
+}
+
+void dentry_usage_sync_notified(FDIRDataThreadContext *db_context)
+{
+    PTHREAD_MUTEX_LOCK(&RESIZED_CTX.lock);
+    RESIZED_CTX.notified = false;
+    PTHREAD_MUTEX_UNLOCK(&RESIZED_CTX.lock);
+}
+
+static void sync_resized_file(FDIRDataThreadContext *db_context,
+        FDIRServerDentry *dentry)
+{
+    FDIRSubtreeSummary delta;
+    int64_t size;
+    int64_t alloc;
+
+    if (dentry->accounted.size < 0) {  //detached from the tree
+        return;
+    }
+
+    size = dentry->stat.size;
+    alloc = dentry->stat.alloc;
+    if (size == dentry->accounted.size && alloc == dentry->accounted.alloc) {
+        return;
+    }
+
+    delta.files = 0;
+    delta.dirs = 0;
+    delta.bytes = size - dentry->accounted.size;
+    delta.alloc = alloc - dentry->accounted.alloc;
+    dentry->accounted.size = size;
+    dentry->accounted.alloc = alloc;
+    add_pending(db_context, dentry->parent, &delta, false);
+}
+
+void dentry_usage_flush(FDIRDataThreadContext *db_context)
+{
+    FDIRDentryPtrArray *array;
+    FDIRServerDentry **pp;
+    FDIRServerDentry **end;
+    FDIRServerDentry *current;
+    FDIRDentryUsage *usage;
+
+    PTHREAD_MUTEX_LOCK(&RESIZED_CTX.lock);
+    if (RESIZED_CTX.current->count > 0) {
+        array = RESIZED_CTX.current;
+        RESIZED_CTX.current = RESIZED_CTX.dealing;
+        RESIZED_CTX.dealing = array;
+    } else {
+        array = NULL;
+    }
+    PTHREAD_MUTEX_UNLOCK(&RESIZED_CTX.lock);
+
+    if (array != NULL) {
+        end = array->dentries + array->count;
+        for (pp=array->dentries; pp<end; pp++) {
+            sync_resized_file(db_context, *pp);
+        }
+        array->count = 0;
+    }
+
+    while (!fc_list_empty(&USAGE_CTX.dirty)) {
+        usage = fc_list_first_entry(&USAGE_CTX.dirty, FDIRDentryUsage, dlink);
+        for (current=usage->dentry; current!=NULL; current=current->parent) {
+            usage_add(&current->usage->total, &usage->pending);
+        }
+        memset(&usage->pending, 0, sizeof(usage->pending));
+        fc_list_del_init(&usage->dlink);
+    }
+}
+
+void dentry_usage_get(FDIRServerDentry *dentry, FDIRSubtreeSummary *usage)
+{
+    if (S_ISDIR(dentry->stat.mode)) {
+        *usage = dentry->usage->total;
+        usage_add(usage, &dentry->usage->pending);
+        return;
+    }
+
+    usage->files = 1;
+    usage->dirs = 0;
+    if (FDIR_IS_USAGE_REGULAR_FILE(dentry->stat.mode)) {
+        usage->bytes = dentry->stat.size;
+        usage->alloc = dentry->stat.alloc;
+    } else {
+        usage->bytes = 0;
+        usage->alloc = 0;
+    }
+}
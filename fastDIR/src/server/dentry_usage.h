@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//dentry_usage.h
+
+/* the recursive usage (files, dirs, bytes and alloc) of the directories.
+ *
+ * create, remove and rename add the changes to the pending usage of the
+ * parent directory by the data thread. the size changes of the regular
+ * files by the nio threads are collected to the resized array of the data
+ * thread, the data thread syncs them to the pending usage of the parents.
+ * the pending usage is added to the ancestors once per data thread loop,
+ * so the parent chain is walked once per dirty directory instead of once
+ * per change, and the usage of the ancestors maybe a little stale */
+
+#ifndef _FDIR_DENTRY_USAGE_H
+#define _FDIR_DENTRY_USAGE_H
+
+#include "server_types.h"
+#include "data_thread.h"
+
+#define FDIR_IS_USAGE_REGULAR_FILE(mode) \
+    (S_ISREG(mode) && !FDIR_IS_DENTRY_HARD_LINK(mode))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    int dentry_usage_init_context(FDIRDataThreadContext *db_context);
+
+    /* alloc the usage of the new directory */
+    int dentry_usage_alloc(FDIRDataThreadContext *db_context,
+            FDIRServerDentry *dentry);
+
+    /* add the usage of the new dentry to the parent */
+    void dentry_usage_create(FDIRDataThreadContext *db_context,
+            FDIRServerDentry *dentry);
+
+    /* subtract the usage of the dentry from the parent
+     * when it is detached from the tree */
+    void dentry_usage_remove(FDIRDataThreadContext *db_context,
+            FDIRServerDentry *dentry, FDIRServerDentry *parent);
+
+    /* move the usage of the dentry from the old parent to the new parent */
+    void dentry_usage_move(FDIRDataThreadContext *db_context,
+            FDIRServerDentry *dentry, FDIRServerDentry *old_parent,
+            FDIRServerDentry *new_parent);
+
+    /* free the usage of the directory when the dentry is freed */
+    void dentry_usage_free(FDIRDataThreadContext *db_context,
+            FDIRServerDentry *dentry);
+
+    /* the size or alloc of the regular file changed,
+     * can be called by any thread with the inode lock held */
+    void dentry_usage_resized(FDIRServerDentry *dentry);
+
+    /* wake up by the sync record */
+    void dentry_usage_sync_notified(FDIRDataThreadContext *db_context);
+
+    /* sync the resized files and add the pending usage to the ancestors,
+     * called by the data thread every loop */
+    void dentry_usage_flush(FDIRDataThreadContext *db_context);
+
+    /* the usage of the directory or the file, can be called by any thread */
+    void dentry_usage_get(FDIRServerDentry *dentry,
+            FDIRSubtreeSummary *usage);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
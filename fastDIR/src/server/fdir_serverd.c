@@ -47,6 +47,7 @@
 #include "inode_generator.h"
 #include "server_binlog.h"
 #include "data_thread.h"
+#include "dentry_store.h"
 #include "data_loader.h"
 #include "cluster_info.h"
 #include "service_handler.h"
@@ -230,6 +231,8 @@ int main(int argc, char *argv[])
         }
     }
 
+    data_thread_terminate();
+    dentry_store_terminate();
     inode_generator_destroy();
     server_binlog_terminate();
     sf_service_destroy();
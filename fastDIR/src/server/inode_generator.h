@@ -40,6 +40,29 @@ static inline int64_t inode_generator_next()
     return INODE_CLUSTER_PART | __sync_add_and_fetch(&CURRENT_INODE_SN, 1);
 }
 
+//the next inode which inode % align == ref_inode % align
+static inline int64_t inode_generator_next_aligned(
+        const int64_t ref_inode, const int align)
+{
+    int64_t old_sn;
+    int64_t new_sn;
+    int remainder;
+
+    if (align <= 1) {
+        return inode_generator_next();
+    }
+
+    do {
+        old_sn = __sync_add_and_fetch(&CURRENT_INODE_SN, 0);
+        new_sn = old_sn + 1;
+        remainder = (uint64_t)(INODE_CLUSTER_PART | new_sn) % align;
+        new_sn += ((uint64_t)ref_inode % align - remainder + align) % align;
+    } while (!__sync_bool_compare_and_swap(&CURRENT_INODE_SN,
+                old_sn, new_sn));
+
+    return INODE_CLUSTER_PART | new_sn;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,6 +21,7 @@
 #include "sf/sf_global.h"
 #include "server_global.h"
 #include "dentry.h"
+#include "dentry_usage.h"
 #include "inode_index.h"
 
 typedef struct {
@@ -39,8 +40,22 @@ typedef struct {
     FDIRServerDentry **buckets;
 } InodeHashtable;
 
+/* the inodes evicted to the dentry store, share the capacity
+ * and the locks with the inode hashtable */
+typedef struct fdir_cold_inode_entry {
+    int64_t inode;
+    int64_t dir_inode;  //the evicted directory which contains this inode
+    struct fdir_cold_inode_entry *next;
+} FDIRColdInodeEntry;
+
+typedef struct {
+    FDIRColdInodeEntry **buckets;
+    struct fast_mblock_man allocator;
+} ColdInodeHashtable;
+
 static InodeSharedContextArray inode_shared_ctx_array = {0, NULL};
 static InodeHashtable inode_hashtable = {0, 0, NULL};
+static ColdInodeHashtable cold_hashtable;
 
 static int init_inode_shared_ctx_array()
 {
@@ -88,6 +103,28 @@ static int init_inode_hashtable()
     return 0;
 }
 
+static int init_cold_hashtable()
+{
+    int result;
+    int64_t bytes;
+
+    if ((result=fast_mblock_init_ex1(&cold_hashtable.allocator,
+                    "cold_inode", sizeof(FDIRColdInodeEntry), 16 * 1024,
+                    0, NULL, NULL, true)) != 0)
+    {
+        return result;
+    }
+
+    bytes = sizeof(FDIRColdInodeEntry *) * inode_hashtable.capacity;
+    cold_hashtable.buckets = (FDIRColdInodeEntry **)fc_malloc(bytes);
+    if (cold_hashtable.buckets == NULL) {
+        return ENOMEM;
+    }
+    memset(cold_hashtable.buckets, 0, bytes);
+
+    return 0;
+}
+
 int inode_index_init()
 {
     int result;
@@ -100,6 +137,12 @@ int inode_index_init()
         return result;
     }
 
+    if (STORAGE_ENABLED) {
+        if ((result=init_cold_hashtable()) != 0) {
+            return result;
+        }
+    }
+
     return 0;
 }
 
@@ -184,6 +227,19 @@ static FDIRServerDentry *find_inode_entry(FDIRServerDentry **bucket,
     } while (0)
 
 
+int64_t inode_index_memory_bytes()
+{
+    int64_t bytes;
+
+    bytes = sizeof(FDIRServerDentry *) * inode_hashtable.capacity;
+    if (STORAGE_ENABLED) {
+        bytes += sizeof(FDIRColdInodeEntry *) * inode_hashtable.capacity +
+            cold_hashtable.allocator.info.element_total_count *
+            GET_BLOCK_SIZE(cold_hashtable.allocator.info);
+    }
+    return bytes;
+}
+
 int inode_index_add_dentry(FDIRServerDentry *dentry)
 {
     int result;
@@ -231,6 +287,33 @@ int inode_index_del_dentry(FDIRServerDentry *dentry)
     return result;
 }
 
+int inode_index_evict_dentry(FDIRServerDentry *dentry)
+{
+    int result;
+    FDIRServerDentry *previous;
+    FDIRServerDentry *deleted;
+
+    SET_INODE_HT_BUCKET_AND_CTX(dentry->inode);
+    PTHREAD_MUTEX_LOCK(&ctx->lock);
+    if (dentry->flock_entry != NULL) {
+        result = EBUSY;
+    } else if ((deleted=find_dentry_for_update(bucket,
+                    dentry, &previous)) != NULL)
+    {
+        if (previous == NULL) {
+            *bucket = (*bucket)->ht_next;
+        } else {
+            previous->ht_next = deleted->ht_next;
+        }
+        result = 0;
+    } else {
+        result = ENOENT;
+    }
+    PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+
+    return result;
+}
+
 FDIRServerDentry *inode_index_get_dentry(const int64_t inode)
 {
     FDIRServerDentry *dentry;
@@ -243,18 +326,122 @@ FDIRServerDentry *inode_index_get_dentry(const int64_t inode)
     return dentry;
 }
 
-FDIRServerDentry *inode_index_get_dentry_by_pname(
-        const int64_t parent_inode, const string_t *name)
+int inode_index_get_dentry_by_pname(const int64_t parent_inode,
+        const string_t *name, FDIRServerDentry **dentry)
 {
     FDIRServerDentry *parent_dentry;
-    FDIRServerDentry *dentry;
 
     if ((parent_dentry=inode_index_get_dentry(parent_inode)) == NULL) {
-        return NULL;
+        *dentry = NULL;
+        return ENOENT;
     }
 
-    dentry_find_by_pname(parent_dentry, name, &dentry);
-    return dentry;
+    return dentry_find_by_pname(parent_dentry, name, dentry);
+}
+
+int inode_index_add_cold(const int64_t inode, const int64_t dir_inode)
+{
+    FDIRColdInodeEntry *entry;
+    FDIRColdInodeEntry **bucket;
+
+    entry = (FDIRColdInodeEntry *)fast_mblock_alloc_object(
+            &cold_hashtable.allocator);
+    if (entry == NULL) {
+        return ENOMEM;
+    }
+
+    entry->inode = inode;
+    entry->dir_inode = dir_inode;
+    SET_INODE_HASHTABLE_CTX(inode);
+    bucket = cold_hashtable.buckets + bucket_index;
+    PTHREAD_MUTEX_LOCK(&ctx->lock);
+    entry->next = *bucket;
+    *bucket = entry;
+    PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+
+    return 0;
+}
+
+int inode_index_del_cold(const int64_t inode)
+{
+    FDIRColdInodeEntry *previous;
+    FDIRColdInodeEntry *entry;
+    FDIRColdInodeEntry **bucket;
+
+    SET_INODE_HASHTABLE_CTX(inode);
+    bucket = cold_hashtable.buckets + bucket_index;
+    previous = NULL;
+    PTHREAD_MUTEX_LOCK(&ctx->lock);
+    entry = *bucket;
+    while (entry != NULL && entry->inode != inode) {
+        previous = entry;
+        entry = entry->next;
+    }
+    if (entry != NULL) {
+        if (previous == NULL) {
+            *bucket = entry->next;
+        } else {
+            previous->next = entry->next;
+        }
+    }
+    PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+
+    if (entry == NULL) {
+        return ENOENT;
+    }
+    fast_mblock_free_object(&cold_hashtable.allocator, entry);
+    return 0;
+}
+
+int64_t inode_index_get_cold_dir(const int64_t inode)
+{
+    FDIRColdInodeEntry *entry;
+    int64_t dir_inode;
+
+    if (!STORAGE_ENABLED) {
+        return 0;
+    }
+
+    SET_INODE_HASHTABLE_CTX(inode);
+    PTHREAD_MUTEX_LOCK(&ctx->lock);
+    entry = cold_hashtable.buckets[bucket_index];
+    while (entry != NULL && entry->inode != inode) {
+        entry = entry->next;
+    }
+    dir_inode = (entry != NULL) ? entry->dir_inode : 0;
+    PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+
+    return dir_inode;
+}
+
+int64_t inode_index_scan(const int64_t start_bucket, const int bucket_count,
+        inode_index_scan_func scan_func, void *args)
+{
+    FDIRServerDentry *dentry;
+    int64_t bucket_index;
+    int64_t end_bucket;
+    InodeSharedContext *ctx;
+
+    end_bucket = start_bucket + bucket_count;
+    if (end_bucket > inode_hashtable.capacity) {
+        end_bucket = inode_hashtable.capacity;
+    }
+
+    for (bucket_index=start_bucket; bucket_index<end_bucket;
+            bucket_index++)
+    {
+        ctx = inode_shared_ctx_array.contexts + bucket_index %
+            inode_shared_ctx_array.count;
+        PTHREAD_MUTEX_LOCK(&ctx->lock);
+        dentry = inode_hashtable.buckets[bucket_index];
+        while (dentry != NULL) {
+            scan_func(dentry, args);
+            dentry = dentry->ht_next;
+        }
+        PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+    }
+
+    return (end_bucket < inode_hashtable.capacity) ? end_bucket : 0;
 }
 
 FDIRServerDentry *inode_index_check_set_dentry_size(
@@ -304,6 +491,13 @@ FDIRServerDentry *inode_index_check_set_dentry_size(
             *modified_flags |= FDIR_DENTRY_FIELD_MODIFIED_FLAG_INC_ALLOC;
         }
 
+        if ((*modified_flags & (FDIR_DENTRY_FIELD_MODIFIED_FLAG_FILE_SIZE |
+                        FDIR_DENTRY_FIELD_MODIFIED_FLAG_INC_ALLOC)) &&
+                FDIR_IS_USAGE_REGULAR_FILE(dentry->stat.mode))
+        {
+            dentry_usage_resized(dentry);
+        }
+
         /*
         logInfo("old size: %"PRId64", new size: %"PRId64", "
                 "old mtime: %d, new mtime: %d, modified_flags: %d",
@@ -318,11 +512,47 @@ FDIRServerDentry *inode_index_check_set_dentry_size(
     return dentry;
 }
 
+FDIRServerDentry *inode_index_reserve_append(const int64_t inode,
+        const int64_t length, FDIRDEntryStatus *stat,
+        uint64_t *data_version, int *result)
+{
+    FDIRServerDentry *dentry;
+
+    SET_INODE_HT_BUCKET_AND_CTX(inode);
+    PTHREAD_MUTEX_LOCK(&ctx->lock);
+    if ((dentry=find_inode_entry(bucket, inode)) == NULL) {
+        *result = ENOENT;
+    } else if (S_ISDIR(dentry->stat.mode)) {
+        *result = EISDIR;
+    } else if (!S_ISREG(dentry->stat.mode)) {
+        *result = EINVAL;
+    } else {
+        dentry->stat.size += length;
+        if (dentry->stat.space_end < dentry->stat.size) {
+            dentry->stat.space_end = dentry->stat.size;
+        }
+        dentry->stat.mtime = g_current_time;
+        *stat = dentry->stat;
+        *data_version = __sync_add_and_fetch(&DATA_CURRENT_VERSION, 1);
+        *result = 0;
+        if (FDIR_IS_USAGE_REGULAR_FILE(dentry->stat.mode)) {
+            dentry_usage_resized(dentry);
+        }
+    }
+    PTHREAD_MUTEX_UNLOCK(&ctx->lock);
+
+    return dentry;
+}
+
 static void update_dentry(FDIRServerDentry *dentry,
         const FDIRBinlogRecord *record)
 {
     if (record->options.mode) {
-        dentry->stat.mode = record->stat.mode;
+        /* the file type MUST be kept because the union fields
+         * of the dentry depend on it */
+        dentry->stat.mode = (dentry->stat.mode & (S_IFMT |
+                    FDIR_DENTRY_MODE_FLAGS_HARD_LINK)) | (record->stat.mode &
+                    (~(S_IFMT | FDIR_DENTRY_MODE_FLAGS_HARD_LINK)));
     }
     if (record->options.atime) {
         dentry->stat.atime = record->stat.atime;
@@ -348,6 +578,12 @@ static void update_dentry(FDIRServerDentry *dentry,
     if (record->options.inc_alloc) {
         dentry->stat.alloc += record->stat.alloc;
     }
+
+    if ((record->options.size || record->options.inc_alloc) &&
+            FDIR_IS_USAGE_REGULAR_FILE(dentry->stat.mode))
+    {
+        dentry_usage_resized(dentry);
+    }
 }
 
 FDIRServerDentry *inode_index_update_dentry(
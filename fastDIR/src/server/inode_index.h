@@ -22,6 +22,8 @@
 #include "server_types.h"
 #include "flock.h"
 
+typedef void (*inode_index_scan_func)(FDIRServerDentry *dentry, void *args);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -29,19 +31,49 @@ extern "C" {
     int inode_index_init();
     void inode_index_destroy();
 
+    int64_t inode_index_memory_bytes();
+
     int inode_index_add_dentry(FDIRServerDentry *dentry);
 
     int inode_index_del_dentry(FDIRServerDentry *dentry);
 
+    /* delete the dentry for evicting to the dentry store,
+     * return EBUSY when the dentry is locked */
+    int inode_index_evict_dentry(FDIRServerDentry *dentry);
+
     FDIRServerDentry *inode_index_get_dentry(const int64_t inode);
 
-    FDIRServerDentry *inode_index_get_dentry_by_pname(
-            const int64_t parent_inode, const string_t *name);
+    /* return TASK_STATUS_DENTRY_COLD and set dentry to the parent
+     * when the children of the parent are in the dentry store */
+    int inode_index_get_dentry_by_pname(const int64_t parent_inode,
+            const string_t *name, FDIRServerDentry **dentry);
+
+    /* the cold inodes are the children of the evicted directories */
+    int inode_index_add_cold(const int64_t inode, const int64_t dir_inode);
+
+    int inode_index_del_cold(const int64_t inode);
+
+    /* return the inode of the evicted directory, 0 for not cold */
+    int64_t inode_index_get_cold_dir(const int64_t inode);
+
+    /* call scan_func with the bucket lock held,
+     * return the start bucket of the next scan */
+    int64_t inode_index_scan(const int64_t start_bucket,
+            const int bucket_count, inode_index_scan_func scan_func,
+            void *args);
 
     FDIRServerDentry *inode_index_check_set_dentry_size(
             const FDIRSetDEntrySizeInfo *dsize,
             const bool need_lock, int *modified_flags);
 
+    /* increase the file size by length atomically, the output stat
+     * is the snapshot after increased, the reserved offset is
+     * stat->size - length. the data version is generated under the
+     * same lock, so the later version always carries the larger size */
+    FDIRServerDentry *inode_index_reserve_append(const int64_t inode,
+            const int64_t length, FDIRDEntryStatus *stat,
+            uint64_t *data_version, int *result);
+
     FDIRServerDentry *inode_index_update_dentry(
             const FDIRBinlogRecord *record);
 
@@ -323,13 +323,53 @@ static int load_dentry_max_data_size(IniContext *ini_context,
     return 0;
 }
 
+static int load_storage_engine_config(IniContext *ini_context,
+        const char *filename)
+{
+#define STORAGE_SECTION_NAME "storage-engine"
+
+    STORAGE_ENABLED = iniGetBoolValue(STORAGE_SECTION_NAME,
+            "enabled", ini_context, false);
+    if (!STORAGE_ENABLED) {
+        return 0;
+    }
+
+    STORAGE_INODE_LIMIT = iniGetInt64Value(STORAGE_SECTION_NAME,
+            "inode_limit", ini_context,
+            FDIR_STORAGE_DEFAULT_INODE_LIMIT);
+    if (STORAGE_INODE_LIMIT <= 0) {
+        logError("file: "__FILE__", line: %d, "
+                "config file: %s, section: %s, inode_limit: %"PRId64" <= 0",
+                __LINE__, filename, STORAGE_SECTION_NAME,
+                STORAGE_INODE_LIMIT);
+        return EINVAL;
+    }
+
+    STORAGE_COLD_SECONDS = iniGetIntValue(STORAGE_SECTION_NAME,
+            "cold_seconds", ini_context,
+            FDIR_STORAGE_DEFAULT_COLD_SECONDS);
+    if (STORAGE_COLD_SECONDS < 0) {
+        STORAGE_COLD_SECONDS = FDIR_STORAGE_DEFAULT_COLD_SECONDS;
+    }
+
+    STORAGE_CHECKPOINT_INTERVAL = iniGetIntValue(STORAGE_SECTION_NAME,
+            "checkpoint_interval", ini_context,
+            FDIR_STORAGE_DEFAULT_CHECKPOINT_INTERVAL);
+    if (STORAGE_CHECKPOINT_INTERVAL <= 0) {
+        STORAGE_CHECKPOINT_INTERVAL = FDIR_STORAGE_DEFAULT_CHECKPOINT_INTERVAL;
+    }
+
+    return 0;
+}
+
 static void server_log_configs()
 {
     char sz_server_config[512];
-    char sz_global_config[512];
-    char sz_slowlog_config[256];
+    char sz_global_config[768];
+    char sz_slowlog_config[512];
     char sz_service_config[128];
     char sz_cluster_config[128];
+    char sz_storage_config[128];
 
     sf_global_config_to_string(sz_global_config, sizeof(sz_global_config));
     sf_slow_log_config_to_string(&SLOW_LOG_CFG, "slow_log",
@@ -364,11 +404,23 @@ static void server_log_configs()
             INODE_HASHTABLE_CAPACITY, INODE_SHARED_LOCKS_COUNT,
             FC_SID_SERVER_COUNT(CLUSTER_CONFIG_CTX));
 
-    logInfo("fastDIR V%d.%d.%d, %s, %s, service: {%s}, cluster: {%s}, %s",
-            g_fdir_global_vars.version.major, g_fdir_global_vars.version.minor,
+    if (STORAGE_ENABLED) {
+        snprintf(sz_storage_config, sizeof(sz_storage_config),
+                "storage-engine: {enabled: true, inode_limit: %"PRId64", "
+                "cold_seconds: %d, checkpoint_interval: %d}",
+                STORAGE_INODE_LIMIT, STORAGE_COLD_SECONDS,
+                STORAGE_CHECKPOINT_INTERVAL);
+    } else {
+        snprintf(sz_storage_config, sizeof(sz_storage_config),
+                "storage-engine: {enabled: false}");
+    }
+
+    logInfo("fastDIR V%d.%d.%d, %s, %s, service: {%s}, cluster: {%s}, "
+            "%s, %s", g_fdir_global_vars.version.major,
+            g_fdir_global_vars.version.minor,
             g_fdir_global_vars.version.patch,
             sz_global_config, sz_slowlog_config, sz_service_config,
-            sz_cluster_config, sz_server_config);
+            sz_cluster_config, sz_server_config, sz_storage_config);
     log_local_host_ip_addrs();
     log_cluster_server_config();
 }
@@ -499,6 +551,10 @@ int server_load_config(const char *filename)
         INODE_SHARED_LOCKS_COUNT = FDIR_INODE_SHARED_LOCKS_DEFAULT_COUNT;
     }
 
+    if ((result=load_storage_engine_config(&ini_context, filename)) != 0) {
+        return result;
+    }
+
     if ((result=load_cluster_config(&ini_context, filename)) != 0) {
         return result;
     }
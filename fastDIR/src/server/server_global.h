@@ -73,6 +73,13 @@ typedef struct server_global_vars {
         int thread_count;
     } data;
 
+    struct {
+        bool enabled;
+        int cold_seconds;     //the min idle seconds of the directory to evict
+        int64_t inode_limit;  //the max in-memory inodes per data thread
+        int checkpoint_interval;  //the interval seconds of the checkpoint
+    } storage_engine;
+
     SFSlowLogContext slow_log;
 
 } FDIRServerGlobalVars;
@@ -109,6 +116,12 @@ typedef struct server_global_vars {
 #define DATA_PATH_STR           DATA_PATH.str
 #define DATA_PATH_LEN           DATA_PATH.len
 
+#define STORAGE_ENABLED         g_server_global_vars.storage_engine.enabled
+#define STORAGE_COLD_SECONDS    g_server_global_vars.storage_engine.cold_seconds
+#define STORAGE_INODE_LIMIT     g_server_global_vars.storage_engine.inode_limit
+#define STORAGE_CHECKPOINT_INTERVAL  \
+    g_server_global_vars.storage_engine.checkpoint_interval
+
 #define SLOW_LOG_CFG            g_server_global_vars.slow_log.cfg
 #define SLOW_LOG_CTX            g_server_global_vars.slow_log.ctx
 
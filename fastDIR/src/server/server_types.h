@@ -17,6 +17,7 @@
 #define _FDIR_SERVER_TYPES_H
 
 #include <time.h>
+#include <limits.h>
 #include <pthread.h>
 #include "fastcommon/common_define.h"
 #include "fastcommon/fast_task_queue.h"
@@ -41,6 +42,9 @@
 #define FDIR_DEFAULT_DATA_THREAD_COUNT              1
 #define FDIR_MAX_SLAVE_BINLOG_CHECK_LAST_ROWS      64
 #define FDIR_DEFAULT_SLAVE_BINLOG_CHECK_LAST_ROWS   3
+#define FDIR_STORAGE_DEFAULT_INODE_LIMIT     (64 * 1024 * 1024)
+#define FDIR_STORAGE_DEFAULT_COLD_SECONDS         3600
+#define FDIR_STORAGE_DEFAULT_CHECKPOINT_INTERVAL   3600
 
 #define FDIR_SERVER_TASK_TYPE_RELATIONSHIP       1   //slave  -> master
 #define FDIR_SERVER_TASK_TYPE_REPLICA_MASTER     2   //[Master] -> slave
@@ -53,8 +57,12 @@
 #define FDIR_REPLICATION_STAGE_SYNC_FROM_QUEUE    4
 
 #define TASK_STATUS_CONTINUE           12345
+#define TASK_STATUS_DENTRY_COLD        12346  //should load from dentry store
 #define TASK_UPDATE_FLAG_OUTPUT_DENTRY     1
 
+/* the dentries of a batch request may be in different cold directories */
+#define FDIR_COLD_REDO_MAX_COUNT  FDIR_BATCH_SET_MAX_DENTRY_COUNT
+
 #define FDIR_BINLOG_SUBDIR_NAME      "binlog"
 
 #define TASK_ARG          ((FDIRServerTaskArg *)task->arg)
@@ -68,6 +76,9 @@
 #define SYS_LOCK_TASK     TASK_ARG->context.service.sys_lock_task
 #define WAITING_RPC_COUNT TASK_ARG->context.service.waiting_rpc_count
 #define DENTRY_LIST_CACHE TASK_ARG->context.service.dentry_list_cache
+#define COLD_DENTRY       TASK_ARG->context.service.cold.dentry
+#define COLD_REDO_COUNT   TASK_ARG->context.service.cold.redo_count
+#define UPDATE_DATA_VERSION TASK_ARG->context.service.data_version
 
 #define SERVER_TASK_TYPE  TASK_ARG->context.task_type
 #define CLUSTER_PEER      TASK_ARG->context.shared.cluster.peer
@@ -90,38 +101,65 @@ struct fdir_dentry_context;
 struct fdir_server_dentry;
 struct flock_entry;
 
+/* the recursive usage of the directory, include the directory itself */
+typedef struct fdir_dentry_usage {
+    FDIRSubtreeSummary total;    //already added to the ancestors
+    FDIRSubtreeSummary pending;  //the changes not added to the ancestors
+    struct fc_list_head dlink;   //for the dirty list of the data thread
+    struct fdir_server_dentry *dentry;
+} FDIRDentryUsage;
+
+typedef struct fdir_trash_entry {
+    int64_t data_version;  //the subtree remove which freed the file
+    int64_t inode;
+    int64_t size;
+    struct fdir_trash_entry *next;
+} FDIRTrashEntry;
+
+/* the freed files which data should be deleted, in the data version order.
+ * changed by the data thread and listed by the nio threads */
+typedef struct fdir_namespace_trash {
+    FDIRTrashEntry *head;
+    FDIRTrashEntry *tail;
+    int64_t count;
+    pthread_mutex_t lock;
+} FDIRNamespaceTrash;
+
 typedef struct fdir_namespace_entry {
     string_t name;
     struct fdir_server_dentry *dentry_root;
+    struct fdir_dentry_context *context; //the data thread of this namespace
     volatile int64_t dentry_count;
+    FDIRNamespaceTrash trash;
     struct fdir_namespace_entry *next;  //for hashtable
 } FDIRNamespaceEntry;
 
+/* keep this struct compact because one instance per inode,
+ * the dentry context is shared through the namespace entry */
 typedef struct fdir_server_dentry {
     int64_t inode;
-    unsigned int hash_code;   //data thread dispach & mutex lock
     string_t name;
     FDIRDEntryStatus stat;
 
-    union {
-        string_t link;    //for symlink
+    union {  //selected by the file type of stat.mode
+        struct {   //for directory
+            UniqSkiplist *children;
+            FDIRDentryUsage *usage;
+        };
+        string_t link;            //for symlink
         struct fdir_server_dentry *src_dentry;  //for hard link
+        struct {   //for regular file, size -1 for detached from the tree
+            int64_t size;
+            int64_t alloc;
+        } accounted;  //the size and alloc added to the usage of the parent
     };
 
-    struct fdir_dentry_context *context;
-    UniqSkiplist *children;
     struct fdir_server_dentry *parent;
     struct fdir_namespace_entry *ns_entry;
     struct flock_entry *flock_entry;
     struct fdir_server_dentry *ht_next;  //for inode hash table;
 } FDIRServerDentry;
 
-typedef struct fdir_server_dentry_array {
-    int alloc;
-    int count;
-    struct fdir_server_dentry **entries;
-} FDIRServerDentryArray;  //for list entry
-
 typedef struct fdir_cluster_server_info {
     FCServerInfo *server;
     char key[FDIR_REPLICA_KEY_SIZE];  //for slave server
@@ -246,15 +284,26 @@ typedef struct server_task_arg {
 
         struct {
             struct {
-                FDIRServerDentryArray array;
+                int64_t inode;   //the listing directory
                 int64_t token;
-                int offset;
+                int offset;      //the count of the returned dentries
                 time_t expires;  //expire time
+                string_t last_name;  //the last returned name as cursor
+                char name_buff[NAME_MAX];
             } dentry_list_cache; //for dentry_list
 
             struct fc_list_head ftasks;  //for flock
             struct sys_lock_task *sys_lock_task; //for append and ftruncate
 
+            struct {
+                struct fdir_server_dentry *dentry; //the directory to load
+                int redo_count;
+            } cold;  //for dentry store
+
+            /* the data version of the update for read-your-writes,
+             * -1 for the query request */
+            int64_t data_version;
+
             struct idempotency_request *idempotency_request;
             struct fdir_binlog_record *record;
             struct server_binlog_record_buffer *rbuffer;
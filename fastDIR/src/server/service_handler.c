@@ -38,6 +38,7 @@
 #include "sf/sf_nio.h"
 #include "sf/sf_service.h"
 #include "sf/sf_global.h"
+#include "sf/sf_metrics.h"
 #include "sf/idempotency/server/server_channel.h"
 #include "sf/idempotency/server/server_handler.h"
 #include "common/fdir_proto.h"
@@ -47,7 +48,12 @@
 #include "server_global.h"
 #include "server_func.h"
 #include "dentry.h"
+#include "dentry_store.h"
+#include "dentry_trash.h"
+#include "dentry_usage.h"
 #include "inode_index.h"
+#include "inode_generator.h"
+#include "version_waiter.h"
 #include "cluster_relationship.h"
 #include "common_handler.h"
 #include "service_handler.h"
@@ -59,7 +65,22 @@ typedef int (*deal_task_func)(struct fast_task_info *task);
 
 int service_handler_init()
 {
+    static const char *metrics_stage_names[FDIR_METRICS_STAGE_COUNT] = {
+        "data_queue", "data_deal", "replica_ack"};
+    /* the queries without the connection state can be pipelined,
+       excluding the dentry list which caches its cursor in the task */
+    static const unsigned char pipeline_cmds[] = {
+        FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PATH_REQ,
+        FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PNAME_REQ,
+        FDIR_SERVICE_PROTO_STAT_BY_PATH_REQ,
+        FDIR_SERVICE_PROTO_STAT_BY_INODE_REQ,
+        FDIR_SERVICE_PROTO_STAT_BY_PNAME_REQ,
+        FDIR_SERVICE_PROTO_READLINK_BY_PATH_REQ,
+        FDIR_SERVICE_PROTO_READLINK_BY_PNAME_REQ,
+        FDIR_SERVICE_PROTO_READLINK_BY_INODE_REQ};
     FDIRStatModifyFlags mask;
+    int result;
+    int i;
 
     mask.flags = 0;
     mask.mode = 1;
@@ -73,6 +94,22 @@ int service_handler_init()
 
     next_token = ((int64_t)g_current_time) << 32;
 
+    for (i=0; i<sizeof(pipeline_cmds) / sizeof(pipeline_cmds[0]); i++) {
+        if ((result=sf_enable_pipeline_cmd(pipeline_cmds[i])) != 0) {
+            return result;
+        }
+    }
+
+    if ((result=sf_metrics_init("fdir", fdir_get_cmd_caption,
+                    metrics_stage_names, FDIR_METRICS_STAGE_COUNT)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=version_waiter_init()) != 0) {
+        return result;
+    }
+
     return idempotency_channel_init(SF_IDEMPOTENCY_MAX_CHANNEL_ID,
             SF_IDEMPOTENCY_DEFAULT_REQUEST_HINT_CAPACITY,
             SF_IDEMPOTENCY_DEFAULT_CHANNEL_RESERVE_INTERVAL,
@@ -133,7 +170,6 @@ void service_task_finish_cleanup(struct fast_task_info *task)
         SYS_LOCK_TASK = NULL;
     }
 
-    dentry_array_free(&DENTRY_LIST_CACHE.array);
     sf_task_finish_clean_up(task);
 }
 
@@ -189,6 +225,7 @@ static int service_deal_service_stat(struct fast_task_info *task)
 {
     int result;
     FDIRDentryCounters counters;
+    FDIRDentryMemoryStat mstat;
     FDIRProtoServiceStatResp *stat_resp;
 
     if ((result=server_expect_body_length(task, 0)) != 0) {
@@ -196,6 +233,7 @@ static int service_deal_service_stat(struct fast_task_info *task)
     }
 
     data_thread_sum_counters(&counters);
+    data_thread_sum_memory_stat(&mstat);
     stat_resp = (FDIRProtoServiceStatResp *)REQUEST.body;
 
     stat_resp->is_master = (CLUSTER_MYSELF_PTR ==
@@ -210,6 +248,10 @@ static int service_deal_service_stat(struct fast_task_info *task)
     long2buff(counters.ns, stat_resp->dentry.counters.ns);
     long2buff(counters.dir, stat_resp->dentry.counters.dir);
     long2buff(counters.file, stat_resp->dentry.counters.file);
+    long2buff(mstat.dentry, stat_resp->memory.dentry);
+    long2buff(mstat.name, stat_resp->memory.name);
+    long2buff(mstat.children, stat_resp->memory.children);
+    long2buff(mstat.inode_index, stat_resp->memory.inode_index);
 
     RESPONSE.header.body_len = sizeof(FDIRProtoServiceStatResp);
     RESPONSE.header.cmd = FDIR_SERVICE_PROTO_SERVICE_STAT_RESP;
@@ -650,10 +692,33 @@ static void service_idempotency_request_finish(struct fast_task_info *task,
     }
 }
 
+static inline int service_check_cold_dentry(struct fast_task_info *task,
+        const int result, FDIRServerDentry *dentry)
+{
+    if (result == TASK_STATUS_DENTRY_COLD) {
+        COLD_DENTRY = dentry;
+    }
+    return result;
+}
+
+static int service_check_cold_inode(struct fast_task_info *task,
+        const int64_t inode)
+{
+    if ((COLD_DENTRY=dentry_store_get_cold_dir(inode)) == NULL) {
+        return ENOENT;
+    }
+    return TASK_STATUS_DENTRY_COLD;
+}
+
 static int handle_replica_done(struct fast_task_info *task)
 {
     int result;
 
+    if (task->continue_callback != NULL && RBUFFER != NULL) {
+        sf_metrics_record_stage_ex(&REQUEST.header.trace,
+                FDIR_METRICS_STAGE_REPLICA_ACK, RBUFFER->push_time_us,
+                get_current_time_us() - RBUFFER->push_time_us);
+    }
     task->continue_callback = NULL;
     service_idempotency_request_finish(task, 0);
 
@@ -673,7 +738,12 @@ static inline int do_binlog_produce(struct fast_task_info *task,
         ServerBinlogRecordBuffer *rbuffer)
 {
     rbuffer->args = task;
+    rbuffer->trace = REQUEST.header.trace;
+    rbuffer->push_time_us = get_current_time_us();
     RBUFFER = rbuffer;
+    if (UPDATE_DATA_VERSION >= 0) {  //output for the update request only
+        UPDATE_DATA_VERSION = rbuffer->data_version.last;
+    }
     if (SLAVE_SERVER_COUNT > 0) {
         task->continue_callback = handle_replica_done;
         binlog_push_to_producer_queue(rbuffer);
@@ -730,6 +800,21 @@ static inline void dentry_stat_output(struct fast_task_info *task,
     dstat_output(task, (*dentry)->inode, &(*dentry)->stat);
 }
 
+static inline void dentry_stat_usage_output(struct fast_task_info *task,
+        FDIRServerDentry *dentry)
+{
+    FDIRSubtreeSummary usage;
+
+    dentry_stat_output(task, &dentry);
+    if ((REQUEST.header.flags & FDIR_PROTO_FLAGS_WITH_USAGE)) {
+        dentry_usage_get(dentry, &usage);
+        fdir_proto_pack_subtree_summary(&usage, (FDIRProtoSubtreeSummary *)
+                (task->data + sizeof(FDIRProtoHeader) +
+                 RESPONSE.header.body_len));
+        RESPONSE.header.body_len += sizeof(FDIRProtoSubtreeSummary);
+    }
+}
+
 static inline void set_update_result_and_output(
         struct fast_task_info *task, FDIRServerDentry *dentry)
 {
@@ -913,7 +998,7 @@ static int server_parse_dentry_for_update(struct fast_task_info *task,
 
     if ((result=dentry_find_parent(&fullname, &parent_dentry, &name)) != 0) {
         if (!(result == ENOENT && is_create)) {
-            return result;
+            return service_check_cold_dentry(task, result, parent_dentry);
         }
         if (!FDIR_IS_ROOT_PATH(fullname.path)) {
             return result;
@@ -998,6 +1083,8 @@ static int service_update_prepare_and_check(struct fast_task_info *task,
         if (result != 0) {
             if (result == EEXIST) { //found
                 result = request->output.result;
+                UPDATE_DATA_VERSION = __sync_add_and_fetch(
+                        &DATA_CURRENT_VERSION, 0);
                 if ((result == 0) && (request->output.flags &
                             TASK_UPDATE_FLAG_OUTPUT_DENTRY))
                 {
@@ -1196,7 +1283,7 @@ static int service_deal_hdlink_dentry(struct fast_task_info *task)
     }
 
     if ((result=dentry_find(&src_fullname, &src_dentry)) != 0) {
-        return result;
+        return service_check_cold_dentry(task, result, src_dentry);
     }
 
     if ((result=server_parse_dentry_for_update(task,
@@ -1256,7 +1343,7 @@ static int service_deal_hdlink_by_pname(struct fast_task_info *task)
     }
 
     if ((src_dentry=inode_index_get_dentry(src_inode)) == NULL) {
-        return ENOENT;
+        return service_check_cold_inode(task, src_inode);
     }
 
     if ((result=server_parse_pname_for_update(task,
@@ -1269,6 +1356,48 @@ static int service_deal_hdlink_by_pname(struct fast_task_info *task)
             FDIR_SERVICE_PROTO_HDLINK_BY_PNAME_RESP);
 }
 
+static int service_deal_clone_dentry(struct fast_task_info *task)
+{
+    FDIRProtoCloneDEntryFront *front;
+    FDIRServerDentry *src_dentry;
+    int result;
+    int align;
+    int64_t src_inode;
+
+    if ((result=server_check_body_length(task,
+                    sizeof(FDIRProtoCloneDEntry) + 2,
+                    sizeof(FDIRProtoCloneDEntry) +
+                    NAME_MAX + PATH_MAX)) != 0)
+    {
+        return result;
+    }
+
+    front = (FDIRProtoCloneDEntryFront *)REQUEST.body;
+    src_inode = buff2long(front->src_inode);
+    align = buff2int(front->inode_align);
+    if ((src_dentry=inode_index_get_dentry(src_inode)) == NULL) {
+        return service_check_cold_inode(task, src_inode);
+    }
+
+    if (!S_ISREG(src_dentry->stat.mode)) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "src inode: %"PRId64" is not a regular file", src_inode);
+        return EINVAL;
+    }
+
+    if ((result=server_parse_dentry_for_update(task,
+                    sizeof(FDIRProtoCloneDEntryFront), true)) != 0)
+    {
+        return result;
+    }
+
+    init_record_for_create(task, S_IFREG | (buff2int(
+                    front->common.mode) & (~S_IFMT)));
+    RECORD->inode = inode_generator_next_aligned(src_inode, align);
+    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_CLONE_DENTRY_RESP;
+    return push_record_to_data_thread_queue(task);
+}
+
 static int service_deal_remove_dentry(struct fast_task_info *task)
 {
     int result;
@@ -1325,7 +1454,7 @@ static inline int set_rename_src_dentry(struct fast_task_info *task,
     FDIRServerDentry *dentry;
 
     if ((result=dentry_find(src_fullname, &dentry)) != 0) {
-        return result;
+        return service_check_cold_dentry(task, result, dentry);
     }
 
     return set_rename_src_by_dentry(task, dentry);
@@ -1338,7 +1467,7 @@ static inline int set_rename_src_pname(struct fast_task_info *task,
     FDIRServerDentry *dentry;
 
     if ((result=dentry_find_by_pname(parent, src_name, &dentry)) != 0) {
-        return result;
+        return service_check_cold_dentry(task, result, dentry);
     }
 
     return set_rename_src_by_dentry(task, dentry);
@@ -1467,11 +1596,11 @@ static int service_deal_stat_dentry_by_path(struct fast_task_info *task)
     }
 
     if ((result=dentry_find(&fullname, &dentry)) != 0) {
-        return result;
+        return service_check_cold_dentry(task, result, dentry);
     }
 
     RESPONSE.header.cmd = FDIR_SERVICE_PROTO_STAT_BY_PATH_RESP;
-    dentry_stat_output(task, &dentry);
+    dentry_stat_usage_output(task, dentry);
     return 0;
 }
 
@@ -1503,7 +1632,7 @@ static int service_deal_readlink_by_path(struct fast_task_info *task)
     }
 
     if ((result=dentry_find(&fullname, &dentry)) != 0) {
-        return result;
+        return service_check_cold_dentry(task, result, dentry);
     }
 
     return readlink_output(task, dentry,
@@ -1539,8 +1668,10 @@ static int service_deal_readlink_by_pname(struct fast_task_info *task)
     parent_inode = buff2long(req->parent_inode);
     name.str = req->name_str;
     name.len = req->name_len;
-    if ((dentry=inode_index_get_dentry_by_pname(parent_inode, &name)) == NULL) {
-        return ENOENT;
+    if ((result=inode_index_get_dentry_by_pname(parent_inode,
+                    &name, &dentry)) != 0)
+    {
+        return service_check_cold_dentry(task, result, dentry);
     }
 
     return readlink_output(task, dentry,
@@ -1571,7 +1702,7 @@ static int service_deal_readlink_by_inode(struct fast_task_info *task)
     }
 
     if ((dentry=inode_index_get_dentry(inode)) == NULL) {
-        return ENOENT;
+        return service_check_cold_inode(task, inode);
     }
 
     return readlink_output(task, dentry,
@@ -1592,7 +1723,7 @@ static int service_deal_lookup_inode_by_path(struct fast_task_info *task)
 
     RESPONSE.header.cmd = FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PATH_RESP;
     if ((result=dentry_find(&fullname, &dentry)) != 0) {
-        return result;
+        return service_check_cold_dentry(task, result, dentry);
     }
 
     resp = (FDIRProtoLookupInodeResp *)REQUEST.body;
@@ -1614,10 +1745,10 @@ static int service_deal_stat_dentry_by_inode(struct fast_task_info *task)
 
     RESPONSE.header.cmd = FDIR_SERVICE_PROTO_STAT_BY_INODE_RESP;
     if ((dentry=inode_index_get_dentry(inode)) == NULL) {
-        return ENOENT;
+        return service_check_cold_inode(task, inode);
     }
 
-    dentry_stat_output(task, &dentry);
+    dentry_stat_usage_output(task, dentry);
     return 0;
 }
 
@@ -1650,13 +1781,8 @@ static int get_dentry_by_pname(struct fast_task_info *task,
     parent_inode = buff2long(req->parent_inode);
     name.str = req->name_str;
     name.len = req->name_len;
-    if ((*dentry=inode_index_get_dentry_by_pname(
-                    parent_inode, &name)) == NULL)
-    {
-        return ENOENT;
-    }
-
-    return 0;
+    result = inode_index_get_dentry_by_pname(parent_inode, &name, dentry);
+    return service_check_cold_dentry(task, result, *dentry);
 }
 
 static int service_deal_stat_dentry_by_pname(struct fast_task_info *task)
@@ -1666,7 +1792,7 @@ static int service_deal_stat_dentry_by_pname(struct fast_task_info *task)
 
     if ((result=get_dentry_by_pname(task, &dentry)) == 0) {
         RESPONSE.header.cmd = FDIR_SERVICE_PROTO_STAT_BY_PNAME_RESP;
-        dentry_stat_output(task, &dentry);
+        dentry_stat_usage_output(task, dentry);
     }
     return result;
 }
@@ -1755,6 +1881,9 @@ static FDIRServerDentry *set_dentry_size(
             dsize, need_lock, result, &modified_flags);
     if (dentry == NULL || modified_flags == 0) {
         free_record_object(task);
+        if (dentry == NULL) {
+            *result = service_check_cold_inode(task, dsize->inode);
+        }
         return dentry;
     }
 
@@ -1814,6 +1943,84 @@ static int service_deal_set_dentry_size(struct fast_task_info *task)
     return result;
 }
 
+static int service_deal_reserve_append(struct fast_task_info *task)
+{
+    FDIRProtoReserveAppendReq *req;
+    FDIRServerDentry *dentry;
+    FDIRDEntryStatus stat;
+    int64_t inode;
+    int64_t length;
+    int result;
+
+    if ((result=server_check_body_length(task,
+                    sizeof(FDIRProtoReserveAppendReq) + 1,
+                    sizeof(FDIRProtoReserveAppendReq) + NAME_MAX)) != 0)
+    {
+        return result;
+    }
+
+    req = (FDIRProtoReserveAppendReq *)REQUEST.body;
+    if (sizeof(FDIRProtoReserveAppendReq) + req->ns_len !=
+            REQUEST.header.body_len)
+    {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "body length: %d != expected: %d",
+                REQUEST.header.body_len, (int)sizeof(
+                    FDIRProtoReserveAppendReq) + req->ns_len);
+        return EINVAL;
+    }
+
+    inode = buff2long(req->inode);
+    length = buff2long(req->length);
+    if (length <= 0) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "length: %"PRId64" is invalid which <= 0", length);
+        return EINVAL;
+    }
+
+    if ((result=alloc_record_object(task)) != 0) {
+        return result;
+    }
+
+    if ((dentry=inode_index_reserve_append(inode, length, &stat,
+                    &RECORD->data_version, &result)) == NULL)
+    {
+        free_record_object(task);
+        return service_check_cold_inode(task, inode);
+    } else if (result != 0) {
+        free_record_object(task);
+        return result;
+    }
+
+    RECORD->inode = inode;
+    RECORD->me.dentry = dentry;
+    RECORD->hash_code = simple_hash(req->ns_str, req->ns_len);
+    RECORD->options.flags = 0;
+    RECORD->options.size = 1;
+    RECORD->options.space_end = 1;
+    RECORD->options.mtime = 1;
+    RECORD->stat.size = stat.size;
+    RECORD->stat.space_end = stat.space_end;
+    RECORD->stat.mtime = stat.mtime;
+    RECORD->operation = BINLOG_OP_UPDATE_DENTRY_INT;
+
+    /* output the snapshot for the reserved offset */
+    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_RESERVE_APPEND_RESP;
+    dstat_output(task, inode, &stat);
+    if (IDEMPOTENCY_REQUEST != NULL) {
+        FDIRDEntryInfo *dinfo;
+
+        dinfo = (FDIRDEntryInfo *)IDEMPOTENCY_REQUEST->output.response;
+        IDEMPOTENCY_REQUEST->output.flags = TASK_UPDATE_FLAG_OUTPUT_DENTRY;
+        dinfo->inode = inode;
+        dinfo->stat = stat;
+    }
+
+    //the data version was generated under the inode lock
+    sf_hold_task(task);
+    return server_binlog_produce(task);
+}
+
 static int service_deal_batch_set_dentry_size(struct fast_task_info *task)
 {
     FDIRProtoBatchSetDentrySizeReqHeader *rheader;
@@ -1863,6 +2070,24 @@ static int service_deal_batch_set_dentry_size(struct fast_task_info *task)
         return EINVAL;
     }
 
+    rbody = (FDIRProtoBatchSetDentrySizeReqBody *)
+        (rheader->ns_str + rheader->ns_len);
+    rbend = rbody + count;
+    if (STORAGE_ENABLED) {
+        /* load the cold dentries before any change because
+         * the increased alloc can't be applied twice */
+        for (; rbody < rbend; rbody++) {
+            dsize.inode = buff2long(rbody->inode);
+            if (inode_index_get_dentry(dsize.inode) == NULL &&
+                    service_check_cold_inode(task, dsize.inode) ==
+                    TASK_STATUS_DENTRY_COLD)
+            {
+                return TASK_STATUS_DENTRY_COLD;
+            }
+        }
+        rbody = rbend - count;
+    }
+
     if ((rbuffer=server_binlog_alloc_hold_rbuffer()) == NULL) {
         free_record_object(task);
         return ENOMEM;
@@ -1872,9 +2097,6 @@ static int service_deal_batch_set_dentry_size(struct fast_task_info *task)
     record = records;
 
     RESPONSE.header.cmd = FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_RESP;
-    rbody = (FDIRProtoBatchSetDentrySizeReqBody *)
-        (rheader->ns_str + rheader->ns_len);
-    rbend = rbody + count;
     for (; rbody < rbend; rbody++) {
         SERVICE_UNPACK_DENTRY_SIZE_INFO(dsize, rbody);
 
@@ -1956,7 +2178,7 @@ static FDIRServerDentry *modify_dentry_stat(struct fast_task_info *task,
 
     if ((dentry=inode_index_update_dentry(RECORD)) == NULL) {
         free_record_object(task);
-        *result = ENOENT;
+        *result = service_check_cold_inode(task, inode);
         return NULL;
     }
 
@@ -2029,96 +2251,763 @@ static int service_deal_modify_dentry_stat(struct fast_task_info *task)
     return result;
 }
 
-static inline int service_check_master(struct fast_task_info *task)
+static void free_batch_records(struct fast_task_info *task)
 {
-    if (CLUSTER_MYSELF_PTR != CLUSTER_MASTER_ATOM_PTR) {
-        RESPONSE.error.length = sprintf(
-                RESPONSE.error.message,
-                "i am not master");
-        return SF_RETRIABLE_ERROR_NOT_MASTER;
+    FDIRBinlogRecord **record;
+    FDIRBinlogRecord **end;
+
+    end = RECORD->batch.records + RECORD->batch.count;
+    for (record=RECORD->batch.records; record<end; record++) {
+        fast_mblock_free_object(&SERVER_CTX->service.
+                record_allocator, *record);
     }
+    free(RECORD->batch.records);
+    free_record_object(task);
+}
 
-    return 0;
+static void batch_dentry_ops_output(struct fast_task_info *task)
+{
+    FDIRProtoBatchDEntryOpsRespHeader *rheader;
+    FDIRProtoBatchDEntryOpsRespBody *rbody;
+    FDIRBinlogRecord **record;
+    FDIRBinlogRecord **end;
+    FDIRServerDentry *dentry;
+    short *result;
+
+    rheader = (FDIRProtoBatchDEntryOpsRespHeader *)
+        (task->data + sizeof(FDIRProtoHeader));
+    int2buff(RECORD->batch.count, rheader->count);
+    int2buff(RECORD->batch.success_count, rheader->success_count);
+
+    rbody = (FDIRProtoBatchDEntryOpsRespBody *)(rheader + 1);
+    end = RECORD->batch.records + RECORD->batch.count;
+    for (record=RECORD->batch.records, result=RECORD->batch.results;
+            record<end; record++, result++, rbody++)
+    {
+        short2buff(*result, rbody->errno_);
+        if (*result == 0 && (dentry=(*record)->me.dentry) != NULL) {
+            if (FDIR_IS_DENTRY_HARD_LINK(dentry->stat.mode)) {
+                dentry = dentry->src_dentry;
+            }
+            long2buff(dentry->inode, rbody->inode);
+            fdir_proto_pack_dentry_stat_ex(&dentry->stat, &rbody->stat, true);
+        } else {
+            long2buff(0, rbody->inode);
+            memset(&rbody->stat, 0, sizeof(rbody->stat));
+        }
+    }
+
+    RESPONSE.header.body_len = (char *)rbody - (char *)rheader;
+    TASK_ARG->context.response_done = true;
 }
 
-static inline int service_check_readable(struct fast_task_info *task)
+static int batch_dentry_ops_pack_binlog(struct fast_task_info *task,
+        ServerBinlogRecordBuffer **rbuffer)
 {
-    if (__sync_fetch_and_add(&CLUSTER_MYSELF_PTR->status, 0) !=
-                FDIR_SERVER_STATUS_ACTIVE)
+    FDIRBinlogRecord **record;
+    FDIRBinlogRecord **end;
+    short *result;
+    bool first;
+    int r;
+
+    if ((*rbuffer=server_binlog_alloc_hold_rbuffer()) == NULL) {
+        return ENOMEM;
+    }
+
+    first = true;
+    end = RECORD->batch.records + RECORD->batch.count;
+    for (record=RECORD->batch.records, result=RECORD->batch.results;
+            record<end; record++, result++)
     {
-        RESPONSE.error.length = sprintf(
-                RESPONSE.error.message,
-                "i am not active");
-        return SF_RETRIABLE_ERROR_NOT_ACTIVE;
+        if (*result != 0 || (*record)->operation == BINLOG_OP_NONE_INT) {
+            continue;
+        }
+
+        if (first) {
+            (*rbuffer)->data_version.first = (*record)->data_version;
+            first = false;
+        }
+        (*rbuffer)->data_version.last = (*record)->data_version;
+        (*record)->timestamp = g_current_time;
+        if ((r=binlog_pack_record(*record, &(*rbuffer)->buffer)) != 0) {
+            server_binlog_free_rbuffer(*rbuffer);
+            *rbuffer = NULL;
+            return r;
+        }
     }
 
     return 0;
 }
 
-static int service_process_update(struct fast_task_info *task,
-        deal_task_func real_update_func, const int resp_cmd)
+static void batch_deal_done_notify(FDIRBinlogRecord *record,
+        const int result, const bool is_error)
+{
+    struct fast_task_info *task;
+
+    task = (struct fast_task_info *)record->notify.args;
+    RESPONSE_STATUS = result;
+    sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
+}
+
+static int handle_batch_deal_done(struct fast_task_info *task)
 {
+    ServerBinlogRecordBuffer *rbuffer;
     int result;
-    bool deal_done;
 
-    if ((result=service_check_master(task)) != 0) {
-        return result;
+    task->continue_callback = NULL;
+    if ((result=RESPONSE_STATUS) == 0 && RECORD->batch.success_count > 0) {
+        /* MUST pack binlog before output because the ns and names
+         * of the records refer to the request body */
+        result = batch_dentry_ops_pack_binlog(task, &rbuffer);
+    } else {
+        rbuffer = NULL;
     }
 
-    result = service_update_prepare_and_check(task, resp_cmd, &deal_done);
-    if (result != 0 || deal_done) {
-        return result;
+    if (result == 0) {
+        batch_dentry_ops_output(task);
     }
+    free_batch_records(task);
 
-    if ((result=real_update_func(task)) != TASK_STATUS_CONTINUE) {
-        service_idempotency_request_finish(task, result);
+    if (rbuffer != NULL) {
+        return do_binlog_produce(task, rbuffer);
     }
 
+    service_idempotency_request_finish(task, result);
+    sf_release_task(task);
     return result;
 }
 
-static int compare_flock_task(FLockTask *flck, const FlockOwner *owner,
-        const int64_t inode, const int64_t offset, const int64_t length)
+static int batch_dentry_ops_parse_one(struct fast_task_info *task,
+        const string_t *ns, FDIRProtoBatchDEntryOpsReqBody *rbody,
+        FDIRBinlogRecord *record)
 {
-    int sub;
-    if ((sub=fc_compare_int64(flck->owner.id, owner->id)) != 0) {
-        return sub;
-    }
+    int result;
+    int64_t flags;
 
-    if ((sub=fc_compare_int64(flck->dentry->inode, inode)) != 0) {
-        return sub;
+    record->ns = *ns;
+    record->hash_code = RECORD->hash_code;
+    record->data_version = 0;
+    record->inode = 0;
+    record->options.flags = 0;
+    record->me.pname.parent_inode = buff2long(rbody->inode);
+    record->me.pname.name.str = rbody->name_str;
+    record->me.pname.name.len = rbody->name_len;
+    record->me.parent = NULL;
+    record->me.dentry = NULL;
+    record->notify.func = NULL;
+
+    if (rbody->op_type == FDIR_BATCH_DENTRY_OP_MODIFY_STAT) {
+        flags = buff2long(rbody->mflags) & dstat_mflags_mask;
+        if (flags == 0) {
+            RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                    "invalid flags: %"PRId64, buff2long(rbody->mflags));
+            return EINVAL;
+        }
+        record->inode = record->me.pname.parent_inode;
+        record->me.pname.parent_inode = 0;
+        record->options.flags = flags;
+        fdir_proto_unpack_dentry_stat(&rbody->stat, &record->stat);
+        record->operation = BINLOG_OP_UPDATE_DENTRY_INT;
+        return 0;
     }
 
-    if ((sub=fc_compare_int64(flck->region->offset, offset)) != 0) {
-        return sub;
+    if ((result=check_name_length(task, rbody->name_len, "name")) != 0) {
+        return result;
     }
 
-    if ((sub=fc_compare_int64(flck->region->length, length)) != 0) {
-        return sub;
+    switch (rbody->op_type) {
+        case FDIR_BATCH_DENTRY_OP_CREATE:
+            record->stat.mode = FDIR_UNSET_DENTRY_HARD_LINK(
+                    buff2int(rbody->stat.mode));
+            record->stat.uid = buff2int(rbody->stat.uid);
+            record->stat.gid = buff2int(rbody->stat.gid);
+            record->stat.size = 0;
+            record->stat.atime = record->stat.btime = record->stat.ctime =
+                record->stat.mtime = g_current_time;
+            record->options.path_info.flags = BINLOG_OPTIONS_PATH_ENABLED;
+            record->options.atime = record->options.btime =
+                record->options.ctime = record->options.mtime = 1;
+            record->options.mode = 1;
+            record->options.uid = 1;
+            record->options.gid = 1;
+            record->operation = BINLOG_OP_CREATE_DENTRY_INT;
+            break;
+        case FDIR_BATCH_DENTRY_OP_REMOVE:
+            record->options.path_info.flags = BINLOG_OPTIONS_PATH_ENABLED;
+            record->operation = BINLOG_OP_REMOVE_DENTRY_INT;
+            break;
+        case FDIR_BATCH_DENTRY_OP_STAT:
+            record->operation = BINLOG_OP_NONE_INT;
+            break;
+        default:
+            RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                    "invalid operation type: %d", rbody->op_type);
+            return EINVAL;
     }
 
     return 0;
 }
 
-static int flock_unlock_dentry(struct fast_task_info *task,
-        const FlockOwner *owner, const int64_t inode, const int64_t offset,
-        const int64_t length)
+static int service_deal_batch_dentry_ops(struct fast_task_info *task)
 {
-    FLockTask *flck;
-    fc_list_for_each_entry(flck, FTASK_HEAD_PTR, clink) {
+    FDIRProtoBatchDEntryOpsReqHeader *rheader;
+    FDIRProtoBatchDEntryOpsReqBody *rbody;
+    FDIRBinlogRecord **record;
+    FDIRBinlogRecord **end;
+    string_t ns;
+    char *p;
+    char *body_end;
+    int result;
+    int count;
+    int resp_size;
 
-        /*
-        logInfo("==type: %d, which_queue: %d, inode: %"PRId64", "
-                "offset: %"PRId64", length: %"PRId64", "
-                "owner.id: %"PRId64", owner.pid: %d",
-                flck->type, flck->which_queue, flck->dentry->inode,
-                flck->region->offset, flck->region->length,
-                flck->owner.id, flck->owner.pid);
-                */
+    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_BATCH_DENTRY_OPS_RESP;
+    if ((result=server_check_min_body_length(task,
+                    sizeof(FDIRProtoBatchDEntryOpsReqHeader) + 1 +
+                    sizeof(FDIRProtoBatchDEntryOpsReqBody))) != 0)
+    {
+        return result;
+    }
 
-        if (flck->which_queue != FDIR_FLOCK_TASK_IN_LOCKED_QUEUE) {
-            continue;
-        }
+    rheader = (FDIRProtoBatchDEntryOpsReqHeader *)REQUEST.body;
+    if ((result=check_name_length(task, rheader->ns_len,
+                    "namespace")) != 0)
+    {
+        return result;
+    }
+    count = buff2int(rheader->count);
+    if (count <= 0 || count > FDIR_BATCH_DENTRY_OPS_MAX_COUNT) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "count: %d is invalid which <= 0 or > %d",
+                count, FDIR_BATCH_DENTRY_OPS_MAX_COUNT);
+        return EINVAL;
+    }
+
+    resp_size = sizeof(FDIRProtoHeader) +
+        sizeof(FDIRProtoBatchDEntryOpsRespHeader) +
+        sizeof(FDIRProtoBatchDEntryOpsRespBody) * count;
+    if (resp_size > task->size) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "response size: %d > task pkg size: %d",
+                resp_size, task->size);
+        return EOVERFLOW;
+    }
+
+    if ((result=alloc_record_object(task)) != 0) {
+        return result;
+    }
+
+    ns.str = rheader->ns_str;
+    ns.len = rheader->ns_len;
+    RECORD->ns = ns;
+    RECORD->hash_code = simple_hash(ns.str, ns.len);
+    RECORD->operation = BINLOG_OP_BATCH_DENTRY_INT;
+    RECORD->batch.success_count = 0;
+    RECORD->batch.count = 0;
+    RECORD->batch.records = (FDIRBinlogRecord **)fc_malloc(
+            (sizeof(FDIRBinlogRecord *) + sizeof(short)) * count);
+    if (RECORD->batch.records == NULL) {
+        free_record_object(task);
+        return ENOMEM;
+    }
+    RECORD->batch.results = (short *)(RECORD->batch.records + count);
+
+    p = rheader->ns_str + rheader->ns_len;
+    body_end = REQUEST.body + REQUEST.header.body_len;
+    end = RECORD->batch.records + count;
+    for (record=RECORD->batch.records; record<end; record++) {
+        rbody = (FDIRProtoBatchDEntryOpsReqBody *)p;
+        p += sizeof(FDIRProtoBatchDEntryOpsReqBody);
+        if (p > body_end || p + rbody->name_len > body_end) {
+            RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                    "body length: %d is too small, operation index: %d",
+                    REQUEST.header.body_len, (int)(record -
+                        RECORD->batch.records));
+            result = EINVAL;
+            break;
+        }
+        p += rbody->name_len;
+
+        if ((*record=(FDIRBinlogRecord *)fast_mblock_alloc_object(
+                        &SERVER_CTX->service.record_allocator)) == NULL)
+        {
+            RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                    "system busy, please try later");
+            result = EBUSY;
+            break;
+        }
+        RECORD->batch.count++;
+
+        if ((result=batch_dentry_ops_parse_one(task,
+                        &ns, rbody, *record)) != 0)
+        {
+            break;
+        }
+    }
+
+    if (result == 0 && p != body_end) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "body length: %d != expected: %d",
+                REQUEST.header.body_len, (int)(p - REQUEST.body));
+        result = EINVAL;
+    }
+    if (result != 0) {
+        free_batch_records(task);
+        return result;
+    }
+
+    /*
+    logInfo("file: "__FILE__", line: %d, "
+            "ns: %.*s, operation count: %d", __LINE__,
+            ns.len, ns.str, count);
+            */
+
+    RECORD->notify.func = batch_deal_done_notify; //call by data thread
+    RECORD->notify.args = task;
+    sf_hold_task(task);
+    task->continue_callback = handle_batch_deal_done;
+    push_to_data_thread_queue(RECORD);
+    return TASK_STATUS_CONTINUE;
+}
+
+static inline void free_subtree_record(struct fast_task_info *task)
+{
+    free(RECORD->subtree.context);
+    free_record_object(task);
+}
+
+static void subtree_ops_output(struct fast_task_info *task)
+{
+    FDIRSubtreeOpContext *context;
+    FDIRProtoSubtreeOpsResp *resp;
+
+    context = RECORD->subtree.context;
+    resp = (FDIRProtoSubtreeOpsResp *)(task->data + sizeof(FDIRProtoHeader));
+    int2buff(context->count, resp->count);
+    int2buff(context->file_count, resp->file_count);
+    short2buff(context->cursor.length, resp->cursor_len);
+    resp->finished = context->finished;
+    memset(resp->padding, 0, sizeof(resp->padding));
+    fdir_proto_pack_subtree_summary(&context->summary, &resp->summary);
+    memcpy(resp + 1, context->cursor.buff, context->cursor.length);
+
+    RESPONSE.header.body_len = sizeof(FDIRProtoSubtreeOpsResp) +
+        context->cursor.length;
+    TASK_ARG->context.response_done = true;
+}
+
+static int record_pack_binlog(struct fast_task_info *task,
+        ServerBinlogRecordBuffer **rbuffer)
+{
+    int result;
+
+    if ((*rbuffer=server_binlog_alloc_hold_rbuffer()) == NULL) {
+        return ENOMEM;
+    }
+
+    (*rbuffer)->data_version.first = RECORD->data_version;
+    (*rbuffer)->data_version.last = RECORD->data_version;
+    if ((result=binlog_pack_record(RECORD, &(*rbuffer)->buffer)) != 0) {
+        server_binlog_free_rbuffer(*rbuffer);
+        *rbuffer = NULL;
+    }
+    return result;
+}
+
+static int handle_subtree_deal_done(struct fast_task_info *task)
+{
+    ServerBinlogRecordBuffer *rbuffer;
+    int result;
+
+    task->continue_callback = NULL;
+    rbuffer = NULL;
+    if ((result=RESPONSE_STATUS) == 0) {
+        /* the whole batch is one binlog record, MUST pack before the output
+         * because the namespace and the cursor refer to the request */
+        if (RECORD->data_version > 0) {
+            result = record_pack_binlog(task, &rbuffer);
+        }
+        if (result == 0) {
+            subtree_ops_output(task);
+        }
+    }
+    free_subtree_record(task);
+
+    if (rbuffer != NULL) {
+        return do_binlog_produce(task, rbuffer);
+    }
+
+    service_idempotency_request_finish(task, result);
+    sf_release_task(task);
+    return result;
+}
+
+static int service_deal_subtree_ops(struct fast_task_info *task)
+{
+    FDIRProtoSubtreeOpsReq *req;
+    FDIRSubtreeOpContext *context;
+    FDIRStatModifyFlags mask;
+    int64_t mflags;
+    int result;
+    int limit;
+    int cursor_len;
+
+    RESPONSE.header.cmd = (REQUEST.header.cmd ==
+            FDIR_SERVICE_PROTO_SUBTREE_SUMMARY_REQ ?
+            FDIR_SERVICE_PROTO_SUBTREE_SUMMARY_RESP :
+            FDIR_SERVICE_PROTO_SUBTREE_OPS_RESP);
+    if ((result=server_check_min_body_length(task,
+                    sizeof(FDIRProtoSubtreeOpsReq) + 1)) != 0)
+    {
+        return result;
+    }
+
+    req = (FDIRProtoSubtreeOpsReq *)REQUEST.body;
+    //the summary is read only, MUST NOT be dealt as an update
+    if ((req->op_type == FDIR_SUBTREE_OP_SUMMARY) != (REQUEST.header.cmd ==
+                FDIR_SERVICE_PROTO_SUBTREE_SUMMARY_REQ))
+    {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "operation type: %c mismatch the command: %d",
+                req->op_type, REQUEST.header.cmd);
+        return EINVAL;
+    }
+    if ((result=check_name_length(task, req->ns_len, "namespace")) != 0) {
+        return result;
+    }
+
+    cursor_len = buff2short(req->cursor_len);
+    if (cursor_len < 0 || cursor_len >= PATH_MAX) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "cursor length: %d is invalid", cursor_len);
+        return EINVAL;
+    }
+    if (sizeof(FDIRProtoSubtreeOpsReq) + req->ns_len + cursor_len !=
+            REQUEST.header.body_len)
+    {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "body length: %d != expected: %d", REQUEST.header.body_len,
+                (int)sizeof(FDIRProtoSubtreeOpsReq) +
+                req->ns_len + cursor_len);
+        return EINVAL;
+    }
+
+    limit = buff2int(req->limit);
+    if (limit <= 0 || limit > FDIR_SUBTREE_OPS_MAX_LIMIT) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "limit: %d is invalid which <= 0 or > %d",
+                limit, FDIR_SUBTREE_OPS_MAX_LIMIT);
+        return EINVAL;
+    }
+
+    switch (req->op_type) {
+        case FDIR_SUBTREE_OP_SUMMARY:
+        case FDIR_SUBTREE_OP_REMOVE:
+            mflags = 0;
+            break;
+        case FDIR_SUBTREE_OP_MODIFY_STAT:
+            mask.flags = 0;
+            mask.mode = 1;
+            mask.uid = 1;
+            mask.gid = 1;
+            mask.ctime = 1;
+            mflags = buff2long(req->mflags) & mask.flags;
+            if (mflags == 0) {
+                RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                        "invalid flags: %"PRId64, buff2long(req->mflags));
+                return EINVAL;
+            }
+            break;
+        default:
+            RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                    "invalid operation type: %d", req->op_type);
+            return EINVAL;
+    }
+
+    context = (FDIRSubtreeOpContext *)fc_malloc(
+            sizeof(FDIRSubtreeOpContext) + PATH_MAX);
+    if (context == NULL) {
+        return ENOMEM;
+    }
+    context->cursor.buff = (char *)(context + 1);
+    context->cursor.alloc_size = PATH_MAX;
+
+    if ((result=alloc_record_object(task)) != 0) {
+        free(context);
+        return result;
+    }
+
+    RECORD->ns.str = req->ns_str;
+    RECORD->ns.len = req->ns_len;
+    RECORD->hash_code = simple_hash(RECORD->ns.str, RECORD->ns.len);
+    RECORD->operation = BINLOG_OP_SUBTREE_DENTRY_INT;
+    RECORD->data_version = 0;
+    RECORD->inode = buff2long(req->inode);
+    RECORD->options.flags = mflags;
+    if (mflags != 0) {
+        fdir_proto_unpack_dentry_stat(&req->stat, &RECORD->stat);
+    }
+    RECORD->subtree.op_type = req->op_type;
+    RECORD->subtree.limit = limit;
+    RECORD->subtree.start.str = req->ns_str + req->ns_len;
+    RECORD->subtree.start.len = cursor_len;
+    RECORD->subtree.context = context;
+    RECORD->timestamp = g_current_time;
+
+    RECORD->notify.func = batch_deal_done_notify; //call by data thread
+    RECORD->notify.args = task;
+    sf_hold_task(task);
+    task->continue_callback = handle_subtree_deal_done;
+    push_to_data_thread_queue(RECORD);
+    return TASK_STATUS_CONTINUE;
+}
+
+static int drain_trash_output(struct fast_task_info *task,
+        FDIRNamespaceEntry *ns_entry)
+{
+    FDIRProtoDrainTrashResp *resp;
+    FDIRProtoTrashFile *pf;
+    FDIRSubtreeFile *files;
+    FDIRSubtreeFile *file;
+    FDIRSubtreeFile *end;
+    int64_t last_version;
+    int size;
+    int count;
+    int result;
+
+    resp = (FDIRProtoDrainTrashResp *)(task->data + sizeof(FDIRProtoHeader));
+    count = 0;
+    last_version = 0;
+    if (ns_entry != NULL) {
+        size = (task->size - sizeof(FDIRProtoHeader) -
+                sizeof(FDIRProtoDrainTrashResp)) /
+            sizeof(FDIRProtoTrashFile);
+        if (size > FDIR_DRAIN_TRASH_MAX_COUNT) {
+            size = FDIR_DRAIN_TRASH_MAX_COUNT;
+        }
+        files = (FDIRSubtreeFile *)fc_malloc(sizeof(FDIRSubtreeFile) * size);
+        if (files == NULL) {
+            return ENOMEM;
+        }
+
+        if ((result=dentry_trash_list(ns_entry, files, size,
+                        &count, &last_version)) != 0)
+        {
+            RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                    "the freed files of one batch exceed %d", size);
+            free(files);
+            return result;
+        }
+
+        pf = (FDIRProtoTrashFile *)(resp + 1);
+        end = files + count;
+        for (file=files; file<end; file++, pf++) {
+            long2buff(file->inode, pf->inode);
+            long2buff(file->size, pf->size);
+        }
+        free(files);
+    }
+
+    long2buff(last_version, resp->last_version);
+    int2buff(count, resp->count);
+    memset(resp->padding, 0, sizeof(resp->padding));
+    RESPONSE.header.body_len = sizeof(FDIRProtoDrainTrashResp) +
+        sizeof(FDIRProtoTrashFile) * count;
+    TASK_ARG->context.response_done = true;
+    return 0;
+}
+
+static int handle_drain_trash_done(struct fast_task_info *task)
+{
+    ServerBinlogRecordBuffer *rbuffer;
+    FDIRNamespaceEntry *ns_entry;
+    int result;
+
+    task->continue_callback = NULL;
+    rbuffer = NULL;
+    result = RESPONSE_STATUS;
+    if (result == 0) {
+        result = record_pack_binlog(task, &rbuffer);
+    } else if (result == ENOENT) {  //nothing purged
+        result = 0;
+    }
+
+    if (result == 0) {
+        ns_entry = dentry_find_namespace(&RECORD->ns);
+        result = drain_trash_output(task, ns_entry);
+    }
+    free_record_object(task);
+
+    if (rbuffer != NULL) {
+        if (result == 0) {
+            return do_binlog_produce(task, rbuffer);
+        }
+        server_binlog_free_rbuffer(rbuffer);
+    }
+
+    sf_release_task(task);
+    return result;
+}
+
+/* purge the files not greater than the purge version which data deleted
+ * by the client, then list the files of the trash from the beginning.
+ * the purge is idempotent, so the request id is NOT needed */
+static int service_deal_drain_trash(struct fast_task_info *task)
+{
+    FDIRProtoDrainTrashReq *req;
+    FDIRNamespaceEntry *ns_entry;
+    string_t ns;
+    int64_t purge_version;
+    int result;
+
+    RESPONSE.header.cmd = FDIR_SERVICE_PROTO_DRAIN_TRASH_RESP;
+    if ((result=server_check_min_body_length(task,
+                    sizeof(FDIRProtoDrainTrashReq) + 1)) != 0)
+    {
+        return result;
+    }
+
+    req = (FDIRProtoDrainTrashReq *)REQUEST.body;
+    if ((result=check_name_length(task, req->ns_len, "namespace")) != 0) {
+        return result;
+    }
+    if (sizeof(FDIRProtoDrainTrashReq) + req->ns_len !=
+            REQUEST.header.body_len)
+    {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "body length: %d != expected: %d", REQUEST.header.body_len,
+                (int)sizeof(FDIRProtoDrainTrashReq) + req->ns_len);
+        return EINVAL;
+    }
+
+    ns.str = req->ns_str;
+    ns.len = req->ns_len;
+    purge_version = buff2long(req->purge_version);
+    ns_entry = dentry_find_namespace(&ns);
+    if (ns_entry == NULL || purge_version <= 0 ||
+            !dentry_trash_need_purge(ns_entry, purge_version))
+    {
+        return drain_trash_output(task, ns_entry);
+    }
+
+    if ((result=alloc_record_object(task)) != 0) {
+        return result;
+    }
+
+    RECORD->ns = ns;
+    RECORD->hash_code = simple_hash(ns.str, ns.len);
+    RECORD->operation = BINLOG_OP_PURGE_TRASH_INT;
+    RECORD->data_version = 0;
+    RECORD->inode = 0;
+    RECORD->options.flags = 0;
+    RECORD->trash.version = purge_version;
+    RECORD->timestamp = g_current_time;
+
+    RECORD->notify.func = batch_deal_done_notify; //call by data thread
+    RECORD->notify.args = task;
+    sf_hold_task(task);
+    task->continue_callback = handle_drain_trash_done;
+    push_to_data_thread_queue(RECORD);
+    return TASK_STATUS_CONTINUE;
+}
+
+static inline int service_check_master(struct fast_task_info *task)
+{
+    if (CLUSTER_MYSELF_PTR != CLUSTER_MASTER_ATOM_PTR) {
+        RESPONSE.error.length = sprintf(
+                RESPONSE.error.message,
+                "i am not master");
+        return SF_RETRIABLE_ERROR_NOT_MASTER;
+    }
+
+    return 0;
+}
+
+static inline int service_check_readable(struct fast_task_info *task)
+{
+    if (__sync_fetch_and_add(&CLUSTER_MYSELF_PTR->status, 0) !=
+                FDIR_SERVER_STATUS_ACTIVE)
+    {
+        RESPONSE.error.length = sprintf(
+                RESPONSE.error.message,
+                "i am not active");
+        return SF_RETRIABLE_ERROR_NOT_ACTIVE;
+    }
+
+    return 0;
+}
+
+static int service_process_update(struct fast_task_info *task,
+        deal_task_func real_update_func, const int resp_cmd)
+{
+    int result;
+    bool deal_done;
+
+    if ((result=service_check_master(task)) != 0) {
+        return result;
+    }
+
+    if (COLD_REDO_COUNT == 0) {  //the first time
+        UPDATE_DATA_VERSION = 0;
+        result = service_update_prepare_and_check(
+                task, resp_cmd, &deal_done);
+        if (result != 0 || deal_done) {
+            return result;
+        }
+    }
+
+    result = real_update_func(task);
+    if (!(result == TASK_STATUS_CONTINUE ||
+                result == TASK_STATUS_DENTRY_COLD))
+    {
+        service_idempotency_request_finish(task, result);
+    }
+
+    return result;
+}
+
+static int compare_flock_task(FLockTask *flck, const FlockOwner *owner,
+        const int64_t inode, const int64_t offset, const int64_t length)
+{
+    int sub;
+    if ((sub=fc_compare_int64(flck->owner.id, owner->id)) != 0) {
+        return sub;
+    }
+
+    if ((sub=fc_compare_int64(flck->dentry->inode, inode)) != 0) {
+        return sub;
+    }
+
+    if ((sub=fc_compare_int64(flck->region->offset, offset)) != 0) {
+        return sub;
+    }
+
+    if ((sub=fc_compare_int64(flck->region->length, length)) != 0) {
+        return sub;
+    }
+
+    return 0;
+}
+
+static int flock_unlock_dentry(struct fast_task_info *task,
+        const FlockOwner *owner, const int64_t inode, const int64_t offset,
+        const int64_t length)
+{
+    FLockTask *flck;
+    fc_list_for_each_entry(flck, FTASK_HEAD_PTR, clink) {
+
+        /*
+        logInfo("==type: %d, which_queue: %d, inode: %"PRId64", "
+                "offset: %"PRId64", length: %"PRId64", "
+                "owner.id: %"PRId64", owner.pid: %d",
+                flck->type, flck->which_queue, flck->dentry->inode,
+                flck->region->offset, flck->region->length,
+                flck->owner.id, flck->owner.pid);
+                */
+
+        if (flck->which_queue != FDIR_FLOCK_TASK_IN_LOCKED_QUEUE) {
+            continue;
+        }
 
         if (compare_flock_task(flck, owner, inode, offset, length) == 0) {
             release_flock_task(task, flck);
@@ -2188,6 +3077,8 @@ static int service_deal_flock_dentry(struct fast_task_info *task)
             RESPONSE.error.length = sprintf(RESPONSE.error.message,
                     "deadlock occur, inode: %"PRId64", operation: %d",
                     inode, operation);
+        } else if (result == ENOENT) {
+            result = service_check_cold_inode(task, inode);
         }
         return result;
     }
@@ -2354,6 +3245,8 @@ static int service_deal_sys_lock_dentry(struct fast_task_info *task)
         if (result == EDEADLK) {
             RESPONSE.error.length = sprintf(RESPONSE.error.message,
                     "deadlock occur, inode: %"PRId64, inode);
+        } else if (result == ENOENT) {
+            result = service_check_cold_inode(task, inode);
         }
         return result;
     }
@@ -2504,57 +3397,117 @@ static int service_deal_sys_unlock_dentry(struct fast_task_info *task)
     }
 }
 
-static int server_list_dentry_output(struct fast_task_info *task)
+static inline char *list_dentry_output_one(FDIRServerDentry *dentry,
+        char *p, const char *buf_end, const bool with_usage)
+{
+    FDIRServerDentry *src_dentry;
+    FDIRProtoListDEntryRespBodyPart *body_part;
+    FDIRSubtreeSummary usage;
+    char *next;
+
+    if (buf_end - p < sizeof(FDIRProtoListDEntryRespBodyPart) +
+            dentry->name.len + (with_usage ?
+                sizeof(FDIRProtoSubtreeSummary) : 0))
+    {
+        return NULL;
+    }
+
+    src_dentry = FDIR_GET_REAL_DENTRY(dentry);
+    body_part = (FDIRProtoListDEntryRespBodyPart *)p;
+    long2buff(src_dentry->inode, body_part->inode);
+    fdir_proto_pack_dentry_stat_ex(&src_dentry->stat,
+            &body_part->stat, true);
+    body_part->name_len = dentry->name.len;
+    memcpy(body_part->name_str, dentry->name.str, dentry->name.len);
+    next = p + sizeof(FDIRProtoListDEntryRespBodyPart) + dentry->name.len;
+    if (with_usage) {  //follows the name
+        dentry_usage_get(src_dentry, &usage);
+        fdir_proto_pack_subtree_summary(&usage,
+                (FDIRProtoSubtreeSummary *)next);
+        next += sizeof(FDIRProtoSubtreeSummary);
+    }
+    return next;
+}
+
+/* output the children from the cursor DENTRY_LIST_CACHE.last_name
+ * without snapshot, the cursor is updated for the next list */
+static int server_list_dentry_output(struct fast_task_info *task,
+        FDIRServerDentry *dentry, const string_t *last_name)
 {
     FDIRProtoListDEntryRespBodyHeader *body_header;
-    FDIRServerDentry *src_dentry;
-    FDIRServerDentry **dentry;
-    FDIRServerDentry **start;
-    FDIRServerDentry **end;
-    FDIRProtoListDEntryRespBodyPart *body_part;
+    FDIRServerDentry *current;
+    FDIRServerDentry *last;
+    UniqSkiplistIterator iterator;
     char *p;
+    char *next;
     char *buf_end;
-    int remain_count;
+    int result;
     int count;
+    bool is_last;
+    bool with_usage;
 
-    remain_count = DENTRY_LIST_CACHE.array.count -
-        DENTRY_LIST_CACHE.offset;
-
+    with_usage = (REQUEST.header.flags & FDIR_PROTO_FLAGS_WITH_USAGE) != 0;
     buf_end = task->data + task->size;
     p = REQUEST.body + sizeof(FDIRProtoListDEntryRespBodyHeader);
-    start = DENTRY_LIST_CACHE.array.entries +
-        DENTRY_LIST_CACHE.offset;
-    end = start + remain_count;
-    for (dentry=start; dentry<end; dentry++) {
-        src_dentry = FDIR_GET_REAL_DENTRY(*dentry);
-        if (buf_end - p < sizeof(FDIRProtoListDEntryRespBodyPart) +
-                (*dentry)->name.len)
+    count = 0;
+    last = NULL;
+    if (!S_ISDIR(dentry->stat.mode)) {
+        if ((next=list_dentry_output_one(dentry, p, buf_end,
+                        with_usage)) == NULL)
         {
-            break;
+            RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                    "task pkg size: %d is too small", task->size);
+            return EOVERFLOW;
+        }
+        p = next;
+        count = 1;
+        is_last = true;
+    } else {
+        if ((result=dentry_list_iterator(dentry, last_name,
+                        &iterator)) != 0)
+        {
+            return service_check_cold_dentry(task, result, dentry);
         }
-        body_part = (FDIRProtoListDEntryRespBodyPart *)p;
-        long2buff(src_dentry->inode, body_part->inode);
 
-        fdir_proto_pack_dentry_stat_ex(&src_dentry->stat,
-                &body_part->stat, true);
-        body_part->name_len = (*dentry)->name.len;
-        memcpy(body_part->name_str, (*dentry)->name.str, (*dentry)->name.len);
-        p += sizeof(FDIRProtoListDEntryRespBodyPart) + (*dentry)->name.len;
+        is_last = true;
+        while ((current=(FDIRServerDentry *)uniq_skiplist_next(
+                        &iterator)) != NULL)
+        {
+            if ((next=list_dentry_output_one(current, p,
+                            buf_end, with_usage)) == NULL)
+            {
+                if (last == NULL) {  //the first child can't be output
+                    RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                            "task pkg size: %d is too small", task->size);
+                    return EOVERFLOW;
+                }
+                is_last = false;
+                break;
+            }
+            p = next;
+            last = current;
+            count++;
+        }
     }
-    count = dentry - start;
+
     RESPONSE.header.body_len = p - REQUEST.body;
     RESPONSE.header.cmd = FDIR_SERVICE_PROTO_LIST_DENTRY_RESP;
 
     body_header = (FDIRProtoListDEntryRespBodyHeader *)REQUEST.body;
     int2buff(count, body_header->count);
-    if (count < remain_count) {
+    if (!is_last && last != NULL) {
+        DENTRY_LIST_CACHE.inode = dentry->inode;
         DENTRY_LIST_CACHE.offset += count;
         DENTRY_LIST_CACHE.expires = g_current_time + 60;
         DENTRY_LIST_CACHE.token = __sync_add_and_fetch(&next_token, 1);
+        DENTRY_LIST_CACHE.last_name.str = DENTRY_LIST_CACHE.name_buff;
+        DENTRY_LIST_CACHE.last_name.len = last->name.len;
+        memcpy(DENTRY_LIST_CACHE.name_buff, last->name.str, last->name.len);
 
         body_header->is_last = 0;
         long2buff(DENTRY_LIST_CACHE.token, body_header->token);
     } else {
+        DENTRY_LIST_CACHE.token = 0;
         body_header->is_last = 1;
         long2buff(0, body_header->token);
     }
@@ -2565,21 +3518,21 @@ static int server_list_dentry_output(struct fast_task_info *task)
 
 static int service_deal_list_dentry_by_path(struct fast_task_info *task)
 {
+    const bool hdlink_follow = false;
     int result;
     FDIRDEntryFullName fullname;
+    FDIRServerDentry *dentry;
 
     if ((result=server_check_and_parse_dentry(task, 0, &fullname)) != 0) {
         return result;
     }
 
-    if ((result=dentry_list_by_path(&fullname,
-                    &DENTRY_LIST_CACHE.array)) != 0)
-    {
-        return result;
+    if ((result=dentry_find_ex(&fullname, &dentry, hdlink_follow)) != 0) {
+        return service_check_cold_dentry(task, result, dentry);
     }
 
     DENTRY_LIST_CACHE.offset = 0;
-    return server_list_dentry_output(task);
+    return server_list_dentry_output(task, dentry, NULL);
 }
 
 static int service_deal_list_dentry_by_inode(struct fast_task_info *task)
@@ -2593,20 +3546,17 @@ static int service_deal_list_dentry_by_inode(struct fast_task_info *task)
     }
 
     if ((dentry=inode_index_get_dentry(inode)) == NULL) {
-        return ENOENT;
-    }
-
-    if ((result=dentry_list(dentry, &DENTRY_LIST_CACHE.array)) != 0) {
-        return result;
+        return service_check_cold_inode(task, inode);
     }
 
     DENTRY_LIST_CACHE.offset = 0;
-    return server_list_dentry_output(task);
+    return server_list_dentry_output(task, dentry, NULL);
 }
 
 static int service_deal_list_dentry_next(struct fast_task_info *task)
 {
     FDIRProtoListDEntryNextBody *next_body;
+    FDIRServerDentry *dentry;
     int result;
     int offset;
     int64_t token;
@@ -2640,7 +3590,398 @@ static int service_deal_list_dentry_next(struct fast_task_info *task)
                 offset, DENTRY_LIST_CACHE.offset);
         return EINVAL;
     }
-    return server_list_dentry_output(task);
+
+    if ((dentry=inode_index_get_dentry(DENTRY_LIST_CACHE.inode)) == NULL) {
+        return ENOENT;
+    }
+    return server_list_dentry_output(task, dentry,
+            &DENTRY_LIST_CACHE.last_name);
+}
+
+static int service_deal_request(struct fast_task_info *task)
+{
+    int result;
+
+    switch (REQUEST.header.cmd) {
+        case SF_PROTO_ACTIVE_TEST_REQ:
+            RESPONSE.header.cmd = SF_PROTO_ACTIVE_TEST_RESP;
+            result = sf_proto_deal_active_test(task, &REQUEST, &RESPONSE);
+            break;
+        case FDIR_SERVICE_PROTO_CLIENT_JOIN_REQ:
+            result = service_deal_client_join(task);
+            break;
+        case FDIR_SERVICE_PROTO_CREATE_DENTRY_REQ:
+            result = service_process_update(task,
+                    service_deal_create_dentry,
+                    FDIR_SERVICE_PROTO_CREATE_DENTRY_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_CREATE_BY_PNAME_REQ:
+            result = service_process_update(task,
+                    service_deal_create_by_pname,
+                    FDIR_SERVICE_PROTO_CREATE_BY_PNAME_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_SYMLINK_DENTRY_REQ:
+            result = service_process_update(task,
+                    service_deal_symlink_dentry,
+                    FDIR_SERVICE_PROTO_SYMLINK_DENTRY_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_SYMLINK_BY_PNAME_REQ:
+            result = service_process_update(task,
+                    service_deal_symlink_by_pname,
+                    FDIR_SERVICE_PROTO_SYMLINK_BY_PNAME_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_HDLINK_DENTRY_REQ:
+            result = service_process_update(task,
+                    service_deal_hdlink_dentry,
+                    FDIR_SERVICE_PROTO_HDLINK_DENTRY_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_HDLINK_BY_PNAME_REQ:
+            result = service_process_update(task,
+                    service_deal_hdlink_by_pname,
+                    FDIR_SERVICE_PROTO_HDLINK_BY_PNAME_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_CLONE_DENTRY_REQ:
+            result = service_process_update(task,
+                    service_deal_clone_dentry,
+                    FDIR_SERVICE_PROTO_CLONE_DENTRY_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_REMOVE_DENTRY_REQ:
+            result = service_process_update(task,
+                    service_deal_remove_dentry,
+                    FDIR_SERVICE_PROTO_REMOVE_DENTRY_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_REMOVE_BY_PNAME_REQ:
+            result = service_process_update(task,
+                    service_deal_remove_by_pname,
+                    FDIR_SERVICE_PROTO_REMOVE_BY_PNAME_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_RENAME_DENTRY_REQ:
+            result = service_process_update(task,
+                    service_deal_rename_dentry,
+                    FDIR_SERVICE_PROTO_RENAME_DENTRY_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_RENAME_BY_PNAME_REQ:
+            result = service_process_update(task,
+                    service_deal_rename_by_pname,
+                    FDIR_SERVICE_PROTO_RENAME_BY_PNAME_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_SET_DENTRY_SIZE_REQ:
+            result = service_process_update(task,
+                    service_deal_set_dentry_size,
+                    FDIR_SERVICE_PROTO_SET_DENTRY_SIZE_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_REQ:
+            result = service_process_update(task,
+                    service_deal_batch_set_dentry_size,
+                    FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_RESERVE_APPEND_REQ:
+            result = service_process_update(task,
+                    service_deal_reserve_append,
+                    FDIR_SERVICE_PROTO_RESERVE_APPEND_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_MODIFY_DENTRY_STAT_REQ:
+            result = service_process_update(task,
+                    service_deal_modify_dentry_stat,
+                    FDIR_SERVICE_PROTO_MODIFY_DENTRY_STAT_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_BATCH_DENTRY_OPS_REQ:
+            result = service_process_update(task,
+                    service_deal_batch_dentry_ops,
+                    FDIR_SERVICE_PROTO_BATCH_DENTRY_OPS_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_SUBTREE_OPS_REQ:
+            result = service_process_update(task,
+                    service_deal_subtree_ops,
+                    FDIR_SERVICE_PROTO_SUBTREE_OPS_RESP);
+            break;
+        case FDIR_SERVICE_PROTO_SUBTREE_SUMMARY_REQ:
+            if ((result=service_check_readable(task)) == 0) {
+                result = service_deal_subtree_ops(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_DRAIN_TRASH_REQ:
+            if ((result=service_check_master(task)) == 0) {
+                result = service_deal_drain_trash(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PATH_REQ:
+            if ((result=service_check_readable(task)) == 0) {
+                result = service_deal_lookup_inode_by_path(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PNAME_REQ:
+            if ((result=service_check_readable(task)) == 0) {
+                result = service_deal_lookup_inode_by_pname(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_STAT_BY_PATH_REQ:
+            if ((result=service_check_readable(task)) == 0) {
+                result = service_deal_stat_dentry_by_path(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_STAT_BY_INODE_REQ:
+            if ((result=service_check_readable(task)) == 0) {
+                result = service_deal_stat_dentry_by_inode(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_STAT_BY_PNAME_REQ:
+            if ((result=service_check_readable(task)) == 0) {
+                result = service_deal_stat_dentry_by_pname(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_READLINK_BY_PATH_REQ:
+            if ((result=service_check_readable(task)) == 0) {
+                result = service_deal_readlink_by_path(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_READLINK_BY_PNAME_REQ:
+            if ((result=service_check_readable(task)) == 0) {
+                result = service_deal_readlink_by_pname(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_READLINK_BY_INODE_REQ:
+            if ((result=service_check_readable(task)) == 0) {
+                result = service_deal_readlink_by_inode(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_LIST_DENTRY_BY_PATH_REQ:
+            if ((result=service_check_readable(task)) == 0) {
+                result = service_deal_list_dentry_by_path(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_LIST_DENTRY_BY_INODE_REQ:
+            if ((result=service_check_readable(task)) == 0) {
+                result = service_deal_list_dentry_by_inode(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_LIST_DENTRY_NEXT_REQ:
+            if ((result=service_check_readable(task)) == 0) {
+                result = service_deal_list_dentry_next(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_FLOCK_DENTRY_REQ:
+            if ((result=service_check_master(task)) == 0) {
+                result = service_deal_flock_dentry(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_GETLK_DENTRY_REQ:
+            if ((result=service_check_master(task)) == 0) {
+                result = service_deal_getlk_dentry(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_SYS_LOCK_DENTRY_REQ:
+            if ((result=service_check_master(task)) == 0) {
+                result = service_deal_sys_lock_dentry(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_SYS_UNLOCK_DENTRY_REQ:
+            if ((result=service_check_master(task)) == 0) {
+                result = service_deal_sys_unlock_dentry(task);
+            }
+            break;
+        case FDIR_SERVICE_PROTO_SERVICE_STAT_REQ:
+            result = service_deal_service_stat(task);
+            break;
+        case FDIR_SERVICE_PROTO_CLUSTER_STAT_REQ:
+            result = service_deal_cluster_stat(task);
+            break;
+        case SF_SERVICE_PROTO_GET_METRICS_REQ:
+            if ((result=sf_proto_deal_get_metrics(task,
+                            &REQUEST, &RESPONSE)) == 0)
+            {
+                TASK_ARG->context.response_done = true;
+            }
+            break;
+        case FDIR_SERVICE_PROTO_NAMESPACE_STAT_REQ:
+            result = service_deal_namespace_stat(task);
+            break;
+        case FDIR_SERVICE_PROTO_GET_MASTER_REQ:
+            result = service_deal_get_master(task);
+            break;
+        case FDIR_SERVICE_PROTO_GET_SLAVES_REQ:
+            result = service_deal_get_slaves(task);
+            break;
+        case FDIR_SERVICE_PROTO_GET_READABLE_SERVER_REQ:
+            result = service_deal_get_readable_server(task);
+            break;
+        case SF_SERVICE_PROTO_SETUP_CHANNEL_REQ:
+            if ((result=sf_server_deal_setup_channel(task,
+                            &SERVER_TASK_TYPE, &IDEMPOTENCY_CHANNEL,
+                            &RESPONSE)) == 0)
+            {
+                TASK_ARG->context.response_done = true;
+            }
+            break;
+        case SF_SERVICE_PROTO_CLOSE_CHANNEL_REQ:
+            result = sf_server_deal_close_channel(task,
+                    &SERVER_TASK_TYPE, &IDEMPOTENCY_CHANNEL, &RESPONSE);
+            break;
+        case SF_SERVICE_PROTO_REPORT_REQ_RECEIPT_REQ:
+            result = sf_server_deal_report_req_receipt(task,
+                    SERVER_TASK_TYPE, IDEMPOTENCY_CHANNEL, &RESPONSE);
+            break;
+        case SF_SERVICE_PROTO_REBIND_CHANNEL_REQ:
+            result = sf_server_deal_rebind_channel(task,
+                    &SERVER_TASK_TYPE, &IDEMPOTENCY_CHANNEL, &RESPONSE);
+            break;
+        default:
+            RESPONSE.error.length = sprintf(
+                    RESPONSE.error.message,
+                    "unkown cmd: %d", REQUEST.header.cmd);
+            result = -EINVAL;
+            break;
+    }
+
+    return result;
+}
+
+static void cold_dentry_loaded_notify(FDIRBinlogRecord *record,
+        const int result, const bool is_error)
+{
+    struct fast_task_info *task;
+
+    task = (struct fast_task_info *)record->notify.args;
+    RESPONSE_STATUS = result;
+    sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
+}
+
+static int handle_cold_dentry_loaded(struct fast_task_info *task)
+{
+    int result;
+
+    task->continue_callback = NULL;
+    free_record_object(task);
+    sf_release_task(task);
+
+    if ((result=RESPONSE_STATUS) != 0) {
+        service_idempotency_request_finish(task, result);
+        return result;
+    }
+
+    return service_deal_request(task);  //redo the request
+}
+
+/* push the cold dentry to the data thread for loading from
+ * the dentry store, and redo the request after loaded */
+static int service_load_cold_dentry(struct fast_task_info *task)
+{
+    int result;
+
+    if (COLD_DENTRY == NULL || ++COLD_REDO_COUNT > FDIR_COLD_REDO_MAX_COUNT) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "load cold dentry fail, redo count: %d", COLD_REDO_COUNT);
+        service_idempotency_request_finish(task, EBUSY);
+        return EBUSY;
+    }
+
+    if ((result=alloc_record_object(task)) != 0) {
+        service_idempotency_request_finish(task, result);
+        return result;
+    }
+
+    RECORD->operation = BINLOG_OP_LOAD_DENTRY_INT;
+    RECORD->inode = COLD_DENTRY->inode;
+    RECORD->me.dentry = COLD_DENTRY;
+    RECORD->notify.func = cold_dentry_loaded_notify; //call by data thread
+    RECORD->notify.args = task;
+
+    sf_hold_task(task);
+    task->continue_callback = handle_cold_dentry_loaded;
+    fc_mpsc_queue_push(&COLD_DENTRY->ns_entry->context->db_context->queue,
+            RECORD);
+    return TASK_STATUS_CONTINUE;
+}
+
+static int handle_data_version_applied(struct fast_task_info *task)
+{
+    int result;
+
+    task->continue_callback = NULL;
+    sf_release_task(task);
+    if ((result=RESPONSE_STATUS) != 0) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "wait for the data version applied timeout, "
+                "applied data version: %"PRId64,
+                version_waiter_get_applied());
+        return result;
+    }
+
+    return service_deal_request(task);
+}
+
+static inline bool service_is_query_cmd(const int cmd)
+{
+    switch (cmd) {
+        case FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PATH_REQ:
+        case FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PNAME_REQ:
+        case FDIR_SERVICE_PROTO_STAT_BY_PATH_REQ:
+        case FDIR_SERVICE_PROTO_STAT_BY_INODE_REQ:
+        case FDIR_SERVICE_PROTO_STAT_BY_PNAME_REQ:
+        case FDIR_SERVICE_PROTO_READLINK_BY_PATH_REQ:
+        case FDIR_SERVICE_PROTO_READLINK_BY_PNAME_REQ:
+        case FDIR_SERVICE_PROTO_READLINK_BY_INODE_REQ:
+        case FDIR_SERVICE_PROTO_LIST_DENTRY_BY_PATH_REQ:
+        case FDIR_SERVICE_PROTO_LIST_DENTRY_BY_INODE_REQ:
+        case FDIR_SERVICE_PROTO_SUBTREE_SUMMARY_REQ:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* the slave waits until the data version of the client's
+ * last update applied for read-your-writes */
+static int service_check_min_data_version(struct fast_task_info *task)
+{
+    FDIRProtoDataVersionTail *tail;
+    int64_t data_version;
+    int result;
+
+    if (!service_is_query_cmd(REQUEST.header.cmd) || (REQUEST.header.
+                flags & FDIR_PROTO_FLAGS_MIN_DATA_VERSION) == 0)
+    {
+        return 0;
+    }
+
+    if (REQUEST.header.body_len < sizeof(FDIRProtoDataVersionTail)) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "request body length: %d is too small",
+                REQUEST.header.body_len);
+        return EINVAL;
+    }
+    REQUEST.header.body_len -= sizeof(FDIRProtoDataVersionTail);
+    tail = (FDIRProtoDataVersionTail *)(REQUEST.body +
+            REQUEST.header.body_len);
+    data_version = buff2long(tail->data_version);
+    if (MYSELF_IS_MASTER || data_version <= version_waiter_get_applied()) {
+        return 0;
+    }
+
+    sf_hold_task(task);
+    task->continue_callback = handle_data_version_applied;
+    if ((result=version_waiter_add(task, data_version)) == 0) {
+        return TASK_STATUS_CONTINUE;
+    }
+
+    task->continue_callback = NULL;
+    sf_release_task(task);
+    return (result == EEXIST ? 0 : result);
+}
+
+static void service_output_data_version(struct fast_task_info *task)
+{
+    FDIRProtoDataVersionTail *tail;
+
+    if (!TASK_ARG->context.response_done) {
+        RESPONSE.header.body_len = 0;
+        TASK_ARG->context.response_done = true;
+    }
+
+    tail = (FDIRProtoDataVersionTail *)(REQUEST.body +
+            RESPONSE.header.body_len);
+    long2buff(UPDATE_DATA_VERSION, tail->data_version);
+    RESPONSE.header.body_len += sizeof(FDIRProtoDataVersionTail);
 }
 
 int service_deal_task(struct fast_task_info *task, const int stage)
@@ -2669,202 +4010,20 @@ int service_deal_task(struct fast_task_info *task, const int stage)
         }
     } else {
         handler_init_task_context(task);
-
-        switch (REQUEST.header.cmd) {
-            case SF_PROTO_ACTIVE_TEST_REQ:
-                RESPONSE.header.cmd = SF_PROTO_ACTIVE_TEST_RESP;
-                result = sf_proto_deal_active_test(task, &REQUEST, &RESPONSE);
-                break;
-            case FDIR_SERVICE_PROTO_CLIENT_JOIN_REQ:
-                result = service_deal_client_join(task);
-                break;
-            case FDIR_SERVICE_PROTO_CREATE_DENTRY_REQ:
-                result = service_process_update(task,
-                        service_deal_create_dentry,
-                        FDIR_SERVICE_PROTO_CREATE_DENTRY_RESP);
-                break;
-            case FDIR_SERVICE_PROTO_CREATE_BY_PNAME_REQ:
-                result = service_process_update(task,
-                        service_deal_create_by_pname,
-                        FDIR_SERVICE_PROTO_CREATE_BY_PNAME_RESP);
-                break;
-            case FDIR_SERVICE_PROTO_SYMLINK_DENTRY_REQ:
-                result = service_process_update(task,
-                        service_deal_symlink_dentry,
-                        FDIR_SERVICE_PROTO_SYMLINK_DENTRY_RESP);
-                break;
-            case FDIR_SERVICE_PROTO_SYMLINK_BY_PNAME_REQ:
-                result = service_process_update(task,
-                        service_deal_symlink_by_pname,
-                        FDIR_SERVICE_PROTO_SYMLINK_BY_PNAME_RESP);
-                break;
-            case FDIR_SERVICE_PROTO_HDLINK_DENTRY_REQ:
-                result = service_process_update(task,
-                        service_deal_hdlink_dentry,
-                        FDIR_SERVICE_PROTO_HDLINK_DENTRY_RESP);
-                break;
-            case FDIR_SERVICE_PROTO_HDLINK_BY_PNAME_REQ:
-                result = service_process_update(task,
-                        service_deal_hdlink_by_pname,
-                        FDIR_SERVICE_PROTO_HDLINK_BY_PNAME_RESP);
-                break;
-            case FDIR_SERVICE_PROTO_REMOVE_DENTRY_REQ:
-                result = service_process_update(task,
-                        service_deal_remove_dentry,
-                        FDIR_SERVICE_PROTO_REMOVE_DENTRY_RESP);
-                break;
-            case FDIR_SERVICE_PROTO_REMOVE_BY_PNAME_REQ:
-                result = service_process_update(task,
-                        service_deal_remove_by_pname,
-                        FDIR_SERVICE_PROTO_REMOVE_BY_PNAME_RESP);
-                break;
-            case FDIR_SERVICE_PROTO_RENAME_DENTRY_REQ:
-                result = service_process_update(task,
-                        service_deal_rename_dentry,
-                        FDIR_SERVICE_PROTO_RENAME_DENTRY_RESP);
-                break;
-            case FDIR_SERVICE_PROTO_RENAME_BY_PNAME_REQ:
-                result = service_process_update(task,
-                        service_deal_rename_by_pname,
-                        FDIR_SERVICE_PROTO_RENAME_BY_PNAME_RESP);
-                break;
-            case FDIR_SERVICE_PROTO_SET_DENTRY_SIZE_REQ:
-                result = service_process_update(task,
-                        service_deal_set_dentry_size,
-                        FDIR_SERVICE_PROTO_SET_DENTRY_SIZE_RESP);
-                break;
-            case FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_REQ:
-                result = service_process_update(task,
-                        service_deal_batch_set_dentry_size,
-                        FDIR_SERVICE_PROTO_BATCH_SET_DENTRY_SIZE_RESP);
-                break;
-            case FDIR_SERVICE_PROTO_MODIFY_DENTRY_STAT_REQ:
-                result = service_process_update(task,
-                        service_deal_modify_dentry_stat,
-                        FDIR_SERVICE_PROTO_MODIFY_DENTRY_STAT_RESP);
-                break;
-            case FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PATH_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_lookup_inode_by_path(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_LOOKUP_INODE_BY_PNAME_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_lookup_inode_by_pname(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_STAT_BY_PATH_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_stat_dentry_by_path(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_STAT_BY_INODE_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_stat_dentry_by_inode(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_STAT_BY_PNAME_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_stat_dentry_by_pname(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_READLINK_BY_PATH_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_readlink_by_path(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_READLINK_BY_PNAME_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_readlink_by_pname(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_READLINK_BY_INODE_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_readlink_by_inode(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_LIST_DENTRY_BY_PATH_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_list_dentry_by_path(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_LIST_DENTRY_BY_INODE_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_list_dentry_by_inode(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_LIST_DENTRY_NEXT_REQ:
-                if ((result=service_check_readable(task)) == 0) {
-                    result = service_deal_list_dentry_next(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_FLOCK_DENTRY_REQ:
-                if ((result=service_check_master(task)) == 0) {
-                    result = service_deal_flock_dentry(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_GETLK_DENTRY_REQ:
-                if ((result=service_check_master(task)) == 0) {
-                    result = service_deal_getlk_dentry(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_SYS_LOCK_DENTRY_REQ:
-                if ((result=service_check_master(task)) == 0) {
-                    result = service_deal_sys_lock_dentry(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_SYS_UNLOCK_DENTRY_REQ:
-                if ((result=service_check_master(task)) == 0) {
-                    result = service_deal_sys_unlock_dentry(task);
-                }
-                break;
-            case FDIR_SERVICE_PROTO_SERVICE_STAT_REQ:
-                result = service_deal_service_stat(task);
-                break;
-            case FDIR_SERVICE_PROTO_CLUSTER_STAT_REQ:
-                result = service_deal_cluster_stat(task);
-                break;
-            case FDIR_SERVICE_PROTO_NAMESPACE_STAT_REQ:
-                result = service_deal_namespace_stat(task);
-                break;
-            case FDIR_SERVICE_PROTO_GET_MASTER_REQ:
-                result = service_deal_get_master(task);
-                break;
-            case FDIR_SERVICE_PROTO_GET_SLAVES_REQ:
-                result = service_deal_get_slaves(task);
-                break;
-            case FDIR_SERVICE_PROTO_GET_READABLE_SERVER_REQ:
-                result = service_deal_get_readable_server(task);
-                break;
-            case SF_SERVICE_PROTO_SETUP_CHANNEL_REQ:
-                if ((result=sf_server_deal_setup_channel(task,
-                                &SERVER_TASK_TYPE, &IDEMPOTENCY_CHANNEL,
-                                &RESPONSE)) == 0)
-                {
-                    TASK_ARG->context.response_done = true;
-                }
-                break;
-            case SF_SERVICE_PROTO_CLOSE_CHANNEL_REQ:
-                result = sf_server_deal_close_channel(task,
-                        &SERVER_TASK_TYPE, &IDEMPOTENCY_CHANNEL, &RESPONSE);
-                break;
-            case SF_SERVICE_PROTO_REPORT_REQ_RECEIPT_REQ:
-                result = sf_server_deal_report_req_receipt(task,
-                        SERVER_TASK_TYPE, IDEMPOTENCY_CHANNEL, &RESPONSE);
-                break;
-            case SF_SERVICE_PROTO_REBIND_CHANNEL_REQ:
-                result = sf_server_deal_rebind_channel(task,
-                        &SERVER_TASK_TYPE, &IDEMPOTENCY_CHANNEL, &RESPONSE);
-                break;
-            default:
-                RESPONSE.error.length = sprintf(
-                        RESPONSE.error.message,
-                        "unkown cmd: %d", REQUEST.header.cmd);
-                result = -EINVAL;
-                break;
+        COLD_DENTRY = NULL;
+        COLD_REDO_COUNT = 0;
+        UPDATE_DATA_VERSION = -1;
+        if ((result=service_check_min_data_version(task)) == 0) {
+            result = service_deal_request(task);
         }
     }
 
+    if (result == TASK_STATUS_DENTRY_COLD) {
+        result = service_load_cold_dentry(task);
+    } else if (result == 0 && UPDATE_DATA_VERSION >= 0) {
+        service_output_data_version(task);
+    }
+
     if (result == TASK_STATUS_CONTINUE) {
         return 0;
     } else {
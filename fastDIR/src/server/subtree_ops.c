@@ -0,0 +1,411 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "dentry.h"
+#include "dentry_store.h"
+#include "inode_index.h"
+#include "dentry_trash.h"
+#include "subtree_ops.h"
+
+//the batch is full, stop the walk
+#define SUBTREE_WALK_STOP  -1
+
+typedef struct {
+    FDIRDataThreadContext *thread_ctx;
+    FDIRBinlogRecord *record;
+    FDIRSubtreeBatchContext *batch;
+    FDIRSubtreeOpContext *output;
+    FDIRServerDentry *root;
+    FDIRStatModifyFlags mflags;    //for modify stat
+    string_t names[FDIR_MAX_PATH_COUNT];  //the names of the start cursor
+    int name_count;
+} SubtreeWalkContext;
+
+static int walk_dentry(SubtreeWalkContext *ctx, FDIRServerDentry *dentry);
+
+static int parse_start_cursor(SubtreeWalkContext *ctx)
+{
+    const string_t *start;
+    char *p;
+    char *q;
+    char *end;
+
+    start = &ctx->record->subtree.start;
+    if (start->len == 0) {
+        ctx->name_count = -1;  //the root not visited
+        return 0;
+    }
+    if (*start->str != '/') {
+        return EINVAL;
+    }
+
+    ctx->name_count = 0;
+    p = start->str + 1;
+    end = start->str + start->len;
+    while (p < end) {
+        if ((q=(char *)memchr(p, '/', end - p)) == NULL) {
+            q = end;
+        }
+        if (q == p || ctx->name_count == FDIR_MAX_PATH_COUNT) {
+            return EINVAL;
+        }
+
+        ctx->names[ctx->name_count].str = p;
+        ctx->names[ctx->name_count].len = q - p;
+        ctx->name_count++;
+        p = q + 1;
+    }
+
+    return 0;
+}
+
+static int set_cursor(SubtreeWalkContext *ctx, FDIRServerDentry *dentry)
+{
+    FDIRServerDentry *current;
+    BufferInfo *cursor;
+    char *p;
+    int length;
+
+    cursor = &ctx->output->cursor;
+    length = 0;
+    for (current=dentry; current!=ctx->root; current=current->parent) {
+        length += current->name.len + 1;
+    }
+    if (length == 0) {
+        *cursor->buff = '/';
+        cursor->length = 1;
+        return 0;
+    }
+    if (length >= cursor->alloc_size) {
+        return ENAMETOOLONG;
+    }
+
+    p = cursor->buff + length;
+    for (current=dentry; current!=ctx->root; current=current->parent) {
+        p -= current->name.len;
+        memcpy(p, current->name.str, current->name.len);
+        *(--p) = '/';
+    }
+    cursor->length = length;
+    return 0;
+}
+
+static FDIRBinlogRecord *next_sub_record(SubtreeWalkContext *ctx)
+{
+    FDIRBinlogRecord *record;
+
+    record = ctx->batch->records + ctx->output->count;
+    record->ns = ctx->record->ns;
+    record->hash_code = ctx->record->hash_code;
+    record->timestamp = ctx->record->timestamp;
+    record->data_version = 0;
+    record->options.flags = 0;
+    record->me.parent = NULL;
+    record->me.dentry = NULL;
+    record->notify.func = NULL;
+    return record;
+}
+
+static int visit_dentry(SubtreeWalkContext *ctx, FDIRServerDentry *dentry)
+{
+    FDIRServerDentry *real;
+    FDIRBinlogRecord *record;
+
+    real = FDIR_GET_REAL_DENTRY(dentry);
+    if (ctx->record->subtree.op_type == FDIR_SUBTREE_OP_SUMMARY) {
+        if (S_ISDIR(dentry->stat.mode)) {
+            ctx->output->summary.dirs++;
+        } else {
+            ctx->output->summary.files++;
+            //the hard link shares the data with the source file
+            if (real == dentry && S_ISREG(dentry->stat.mode)) {
+                ctx->output->summary.bytes += dentry->stat.size;
+                ctx->output->summary.alloc += dentry->stat.alloc;
+            }
+        }
+    } else {
+        record = next_sub_record(ctx);
+        record->inode = real->inode;
+        record->me.pname.parent_inode = 0;
+        record->options = ctx->mflags;
+        record->stat = ctx->record->stat;
+        record->operation = BINLOG_OP_UPDATE_DENTRY_INT;
+    }
+
+    if (++(ctx->output->count) == ctx->record->subtree.limit) {
+        int result;
+        if ((result=set_cursor(ctx, dentry)) != 0) {
+            return result;
+        }
+        return SUBTREE_WALK_STOP;
+    }
+    return 0;
+}
+
+static int walk_children(SubtreeWalkContext *ctx, FDIRServerDentry *dentry,
+        const string_t *last_name)
+{
+    UniqSkiplistIterator iterator;
+    FDIRServerDentry *child;
+    int result;
+
+    if ((result=dentry_store_check_load(ctx->thread_ctx, dentry)) != 0) {
+        return result;
+    }
+    if ((result=dentry_list_iterator(dentry, last_name, &iterator)) != 0) {
+        return result;
+    }
+
+    while ((child=(FDIRServerDentry *)uniq_skiplist_next(
+                    &iterator)) != NULL)
+    {
+        if ((result=walk_dentry(ctx, child)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+//pre order for summary and modify stat
+static int walk_dentry(SubtreeWalkContext *ctx, FDIRServerDentry *dentry)
+{
+    int result;
+
+    if ((result=visit_dentry(ctx, dentry)) != 0) {
+        return result;
+    }
+
+    if (S_ISDIR(dentry->stat.mode)) {
+        return walk_children(ctx, dentry, NULL);
+    }
+    return 0;
+}
+
+//continue the walk from the entry next to the start cursor
+static int walk_from_cursor(SubtreeWalkContext *ctx,
+        FDIRServerDentry *dentry, const int level)
+{
+    FDIRServerDentry target;
+    FDIRServerDentry *child;
+    int result;
+
+    if (level == ctx->name_count) {
+        return walk_children(ctx, dentry, NULL);
+    }
+
+    if ((result=dentry_store_check_load(ctx->thread_ctx, dentry)) != 0) {
+        return result;
+    }
+
+    //the entry of the cursor maybe removed after the last batch
+    target.name = ctx->names[level];
+    child = (FDIRServerDentry *)uniq_skiplist_find(
+            dentry->children, &target);
+    if (child != NULL && S_ISDIR(child->stat.mode)) {
+        if ((result=walk_from_cursor(ctx, child, level + 1)) != 0) {
+            return result;
+        }
+    }
+
+    return walk_children(ctx, dentry, ctx->names + level);
+}
+
+static int add_remove_record(SubtreeWalkContext *ctx,
+        FDIRServerDentry *dentry)
+{
+    FDIRServerDentry *real;
+    FDIRSubtreeFile *file;
+    FDIRBinlogRecord *record;
+
+    if (ctx->output->count == ctx->record->subtree.limit) {
+        return SUBTREE_WALK_STOP;
+    }
+
+    record = next_sub_record(ctx);
+    record->inode = 0;
+    record->me.pname.parent_inode = dentry->parent->inode;
+    record->me.pname.name = dentry->name;
+    record->options.path_info.flags = BINLOG_OPTIONS_PATH_ENABLED;
+    record->operation = BINLOG_OP_REMOVE_DENTRY_INT;
+    ctx->output->count++;
+
+    //the data of the empty file need not be deleted
+    real = FDIR_GET_REAL_DENTRY(dentry);
+    if (S_ISREG(real->stat.mode) && real->stat.size > 0) {
+        file = ctx->batch->files + ctx->batch->file_count++;
+        file->inode = real->inode;
+        file->size = real->stat.size;
+    }
+    return 0;
+}
+
+//post order for remove
+static int collect_remove(SubtreeWalkContext *ctx, FDIRServerDentry *dentry)
+{
+    UniqSkiplistIterator iterator;
+    FDIRServerDentry *child;
+    int result;
+
+    if (S_ISDIR(dentry->stat.mode)) {
+        if ((result=dentry_store_check_load(ctx->thread_ctx,
+                        dentry)) != 0)
+        {
+            return result;
+        }
+        uniq_skiplist_iterator(dentry->children, &iterator);
+        while ((child=(FDIRServerDentry *)uniq_skiplist_next(
+                        &iterator)) != NULL)
+        {
+            if ((result=collect_remove(ctx, child)) != 0) {
+                return result;
+            }
+        }
+    }
+
+    if (dentry->parent == NULL) {  //the root of the namespace
+        return 0;
+    }
+    return add_remove_record(ctx, dentry);
+}
+
+static int check_alloc_batch(FDIRSubtreeBatchContext *batch)
+{
+    const int limit = FDIR_SUBTREE_OPS_MAX_LIMIT;
+    char *buff;
+    int records_size;
+    int files_size;
+
+    if (batch->records != NULL) {
+        return 0;
+    }
+
+    records_size = sizeof(FDIRBinlogRecord) * limit;
+    files_size = sizeof(FDIRSubtreeFile) * limit;
+    buff = (char *)fc_malloc(records_size + files_size + PATH_MAX);
+    if (buff == NULL) {
+        return ENOMEM;
+    }
+    memset(buff, 0, records_size);
+    batch->records = (FDIRBinlogRecord *)buff;
+    batch->files = (FDIRSubtreeFile *)(buff + records_size);
+    batch->output.cursor.buff = (char *)(batch->files + limit);
+    batch->output.cursor.alloc_size = PATH_MAX;
+    return 0;
+}
+
+int subtree_ops_collect(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
+{
+    SubtreeWalkContext ctx;
+    int result;
+
+    ctx.thread_ctx = thread_ctx;
+    ctx.record = record;
+    ctx.batch = &thread_ctx->subtree_context;
+    if (record->subtree.limit <= 0 || record->subtree.limit >
+            FDIR_SUBTREE_OPS_MAX_LIMIT)
+    {
+        return EINVAL;
+    }
+    if ((result=check_alloc_batch(ctx.batch)) != 0) {
+        return result;
+    }
+    if (record->subtree.context == NULL) {  //binlog replay
+        record->subtree.context = &ctx.batch->output;
+    }
+
+    ctx.output = record->subtree.context;
+    ctx.output->count = 0;
+    ctx.output->file_count = 0;
+    ctx.output->cursor.length = 0;
+    ctx.output->finished = false;
+    memset(&ctx.output->summary, 0, sizeof(ctx.output->summary));
+    ctx.batch->file_count = 0;
+    ctx.mflags = record->options;
+    ctx.mflags.path_info.flags = 0;
+
+    if ((result=dentry_store_load_inode(thread_ctx,
+                    record->inode)) != 0)
+    {
+        return result;
+    }
+    if ((ctx.root=inode_index_get_dentry(record->inode)) == NULL) {
+        return ENOENT;
+    }
+
+    //the dentries of other namespace belong to other data thread
+    if (!fc_string_equal(&ctx.root->ns_entry->name, &record->ns)) {
+        return EINVAL;
+    }
+    ctx.batch->ns_entry = ctx.root->ns_entry;
+
+    if (record->subtree.op_type == FDIR_SUBTREE_OP_REMOVE) {
+        result = collect_remove(&ctx, ctx.root);
+    } else {
+        if ((result=parse_start_cursor(&ctx)) != 0) {
+            return result;
+        }
+
+        if (ctx.name_count < 0) {
+            result = walk_dentry(&ctx, ctx.root);
+        } else if (S_ISDIR(ctx.root->stat.mode)) {
+            result = walk_from_cursor(&ctx, ctx.root, 0);
+        } else {
+            result = 0;
+        }
+    }
+
+    if (result == 0) {
+        ctx.output->finished = true;
+    } else if (result == SUBTREE_WALK_STOP) {
+        result = 0;
+    }
+    return result;
+}
+
+int subtree_ops_trash_removed_files(FDIRDataThreadContext *thread_ctx,
+        FDIRBinlogRecord *record)
+{
+    FDIRSubtreeBatchContext *batch;
+    FDIRSubtreeFile *file;
+    FDIRSubtreeFile *end;
+    int result;
+
+    batch = &thread_ctx->subtree_context;
+    end = batch->files + batch->file_count;
+    for (file=batch->files; file<end; file++) {
+        //the inode is kept when the remove failed or other hard links exist
+        if (inode_index_get_dentry(file->inode) != NULL) {
+            continue;
+        }
+
+        if ((result=dentry_trash_add(batch->ns_entry, record->data_version,
+                        file->inode, file->size)) != 0)
+        {
+            return result;
+        }
+        record->subtree.context->file_count++;
+    }
+
+    return 0;
+}
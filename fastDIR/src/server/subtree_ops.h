@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//subtree_ops.h
+
+/* the subtree operations are dealt by the data thread of the namespace
+ * in batches, at most limit entries per batch.
+ *
+ * remove walks the subtree in post order from the beginning every batch
+ * because the removed entries disappear. summary and modify stat walk in
+ * pre order from the cursor, which is the relative path of the last
+ * visited entry, so the entries created or removed between two batches
+ * maybe counted or not. summary is a query answered by any readable server.
+ *
+ * one batch of remove or modify stat is written to the binlog as one
+ * record with one data version, which carries the root, the cursor and
+ * the limit of the batch. the binlog replay walks the subtree at the same
+ * data version again, so the same entries are dealt. the regular files freed by the remove are moved to the trash
+ * of the namespace with the data version of the batch */
+
+#ifndef _FDIR_SUBTREE_OPS_H
+#define _FDIR_SUBTREE_OPS_H
+
+#include "binlog/binlog_types.h"
+#include "data_thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* walk the subtree of the record, collect the sub records for
+     * remove and modify stat, or sum the counters for summary */
+    int subtree_ops_collect(FDIRDataThreadContext *thread_ctx,
+            FDIRBinlogRecord *record);
+
+    /* move the removed files which inodes are freed after the sub
+     * records dealt to the trash, their data should be deleted */
+    int subtree_ops_trash_removed_files(FDIRDataThreadContext *thread_ctx,
+            FDIRBinlogRecord *record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/sched_thread.h"
+#include "fastcommon/fast_mblock.h"
+#include "fastcommon/fc_list.h"
+#include "sf/sf_nio.h"
+#include "server_global.h"
+#include "version_waiter.h"
+
+typedef struct fdir_version_waiting_entry {
+    int64_t data_version;
+    time_t expires;
+    struct fast_task_info *task;
+    struct fc_list_head vlink;  //sorted by data_version
+    struct fc_list_head tlink;  //sorted by expires (the adding order)
+} FDIRVersionWaitingEntry;
+
+typedef struct fdir_version_waiter_context {
+    volatile int64_t applied_version;
+    struct fc_list_head version_head;
+    struct fc_list_head timeout_head;
+    struct fast_mblock_man allocator;
+    pthread_mutex_t lock;
+} FDIRVersionWaiterContext;
+
+static FDIRVersionWaiterContext waiter_ctx;
+
+static inline void notify_waiting_task(FDIRVersionWaitingEntry *entry,
+        const int result)
+{
+    struct fast_task_info *task;
+
+    fc_list_del(&entry->vlink);
+    fc_list_del(&entry->tlink);
+    task = entry->task;
+    RESPONSE_STATUS = result;
+    sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
+    fast_mblock_free_object(&waiter_ctx.allocator, entry);
+}
+
+/* notify the applied tasks from the head of the version list,
+ * should be called with the lock held */
+static void notify_applied_tasks(const int64_t applied_version)
+{
+    FDIRVersionWaitingEntry *entry;
+
+    while ((entry=fc_list_first_entry(&waiter_ctx.version_head,
+                    FDIRVersionWaitingEntry, vlink)) != NULL &&
+            entry->data_version <= applied_version)
+    {
+        notify_waiting_task(entry, 0);
+    }
+}
+
+static int clear_timeouts_func(void *args)
+{
+    FDIRVersionWaitingEntry *entry;
+
+    PTHREAD_MUTEX_LOCK(&waiter_ctx.lock);
+    while ((entry=fc_list_first_entry(&waiter_ctx.timeout_head,
+                    FDIRVersionWaitingEntry, tlink)) != NULL &&
+            entry->expires < g_current_time)
+    {
+        notify_waiting_task(entry, EAGAIN);
+    }
+    PTHREAD_MUTEX_UNLOCK(&waiter_ctx.lock);
+    return 0;
+}
+
+static int setup_clear_timeouts_task()
+{
+    ScheduleEntry schedule_entry;
+    ScheduleArray schedule_array;
+
+    INIT_SCHEDULE_ENTRY(schedule_entry, sched_generate_next_id(),
+            0, 0, 0, 1, clear_timeouts_func, NULL);
+
+    schedule_array.count = 1;
+    schedule_array.entries = &schedule_entry;
+    return sched_add_entries(&schedule_array);
+}
+
+int version_waiter_init()
+{
+    int result;
+
+    waiter_ctx.applied_version = 0;
+    FC_INIT_LIST_HEAD(&waiter_ctx.version_head);
+    FC_INIT_LIST_HEAD(&waiter_ctx.timeout_head);
+    if ((result=init_pthread_lock(&waiter_ctx.lock)) != 0) {
+        return result;
+    }
+
+    if ((result=fast_mblock_init_ex1(&waiter_ctx.allocator,
+                    "version_waiting_entry", sizeof(FDIRVersionWaitingEntry),
+                    1024, 0, NULL, NULL, false)) != 0)
+    {
+        return result;
+    }
+
+    return setup_clear_timeouts_task();
+}
+
+int64_t version_waiter_get_applied()
+{
+    return __sync_add_and_fetch(&waiter_ctx.applied_version, 0);
+}
+
+void version_waiter_set_applied(const int64_t data_version)
+{
+    PTHREAD_MUTEX_LOCK(&waiter_ctx.lock);
+    if (data_version > waiter_ctx.applied_version) {
+        waiter_ctx.applied_version = data_version;
+    }
+    notify_applied_tasks(waiter_ctx.applied_version);
+    PTHREAD_MUTEX_UNLOCK(&waiter_ctx.lock);
+}
+
+int version_waiter_add(struct fast_task_info *task,
+        const int64_t data_version)
+{
+    FDIRVersionWaitingEntry *entry;
+    FDIRVersionWaitingEntry *previous;
+    struct fc_list_head *pos;
+    int result;
+
+    PTHREAD_MUTEX_LOCK(&waiter_ctx.lock);
+    do {
+        //check again to avoid missing the notify
+        if (data_version <= waiter_ctx.applied_version) {
+            result = EEXIST;
+            break;
+        }
+
+        entry = (FDIRVersionWaitingEntry *)fast_mblock_alloc_object(
+                &waiter_ctx.allocator);
+        if (entry == NULL) {
+            result = ENOMEM;
+            break;
+        }
+
+        entry->data_version = data_version;
+        entry->expires = g_current_time + FDIR_VERSION_WAITER_TIMEOUT;
+        entry->task = task;
+        fc_list_add_tail(&entry->tlink, &waiter_ctx.timeout_head);
+
+        /* search from the tail because the newer waiter
+         * usually waits for the larger version */
+        fc_list_for_each_prev(pos, &waiter_ctx.version_head) {
+            previous = fc_list_entry(pos, FDIRVersionWaitingEntry, vlink);
+            if (previous->data_version <= data_version) {
+                break;
+            }
+        }
+        fc_list_add(&entry->vlink, pos);
+        result = 0;
+    } while (0);
+    PTHREAD_MUTEX_UNLOCK(&waiter_ctx.lock);
+
+    return result;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//version_waiter.h
+
+/* the query tasks of the slave wait here until the data version
+ * of the client's last update is applied (read-your-writes) */
+
+#ifndef _FDIR_VERSION_WAITER_H
+#define _FDIR_VERSION_WAITER_H
+
+#include "fastcommon/fast_task_queue.h"
+#include "server_types.h"
+
+//the max seconds for waiting the data version
+#define FDIR_VERSION_WAITER_TIMEOUT  2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    int version_waiter_init();
+
+    int64_t version_waiter_get_applied();
+
+    /* set the data version applied to the memory and notify the waiting
+     * tasks, the notified task's RESPONSE_STATUS is 0 for applied or
+     * EAGAIN for timeout */
+    void version_waiter_set_applied(const int64_t data_version);
+
+    /* return 0 for the task waiting, EEXIST for already applied */
+    int version_waiter_add(struct fast_task_info *task,
+            const int64_t data_version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
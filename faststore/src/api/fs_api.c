@@ -327,10 +327,18 @@ int fs_api_slice_read(FSAPIOperationContext *op_ctx,
         char *buff, int *read_bytes)
 {
     FS_API_CHECK_CONFLICT_AND_WAIT(op_ctx, 'r');
-    return fs_client_slice_read(op_ctx->api_ctx->fs,
+    return fs_client_slice_sparse_read(op_ctx->api_ctx->fs,
             &op_ctx->bs_key, buff, read_bytes);
 }
 
+int fs_api_slice_seek(FSAPIOperationContext *op_ctx,
+        const int whence, int *offset)
+{
+    FS_API_CHECK_CONFLICT_AND_WAIT(op_ctx, 'r');
+    return fs_client_slice_seek(op_ctx->api_ctx->fs,
+            &op_ctx->bs_key, whence, offset);
+}
+
 int fs_api_slice_allocate_ex(FSAPIOperationContext *op_ctx,
         const int enoent_log_level, int *inc_alloc)
 {
@@ -355,6 +363,14 @@ int fs_api_block_delete_ex(FSAPIOperationContext *op_ctx,
             &op_ctx->bs_key.block, enoent_log_level, dec_alloc);
 }
 
+int fs_api_slice_clone(FSAPIOperationContext *op_ctx,
+        const FSBlockSliceKeyInfo *src_bs_key, int *inc_alloc)
+{
+    FS_API_CHECK_CONFLICT_AND_WAIT(op_ctx, 'c');
+    return fs_client_slice_clone(op_ctx->api_ctx->fs,
+            src_bs_key, &op_ctx->bs_key, inc_alloc);
+}
+
 int fs_api_unlink_file(FSAPIContext *api_ctx, const int64_t oid,
         const int64_t file_size, const uint64_t tid)
 {
@@ -396,3 +412,49 @@ int fs_api_unlink_file(FSAPIContext *api_ctx, const int64_t oid,
 
     return result;
 }
+
+int fs_api_flush_file(FSAPIContext *api_ctx, const int64_t oid,
+        const int64_t file_size, const uint64_t tid)
+{
+    FSAPIOperationContext op_ctx;
+    int64_t remain;
+    int conflict_count;
+
+    if (!api_ctx->write_combine.enabled || file_size <= 0) {
+        return 0;
+    }
+
+    /* push the combined slices of the whole block to write and wait done */
+    FS_API_SET_CTX_AND_TID_EX(op_ctx, api_ctx, tid);
+    op_ctx.op_type = 'f';
+    op_ctx.bs_key.slice.offset = 0;
+    op_ctx.bs_key.slice.length = FS_FILE_BLOCK_SIZE;
+    op_ctx.allocator_ctx = fs_api_allocator_get(tid);
+    fs_set_block_key(&op_ctx.bs_key.block, oid, 0);
+    remain = file_size;
+    while (1) {
+        op_ctx.bid = op_ctx.bs_key.block.offset;
+        obid_htable_check_conflict_and_wait(&op_ctx, &conflict_count);
+
+        remain -= FS_FILE_BLOCK_SIZE;
+        if (remain <= 0) {
+            break;
+        }
+
+        fs_next_block_key(&op_ctx.bs_key.block);
+    }
+
+    return 0;
+}
+
+int fs_api_commit_file(FSAPIContext *api_ctx, const int64_t oid,
+        const int64_t file_size, const uint64_t tid)
+{
+    int result;
+
+    if ((result=fs_api_flush_file(api_ctx, oid, file_size, tid)) != 0) {
+        return result;
+    }
+
+    return fs_client_commit(api_ctx->fs, oid, file_size);
+}
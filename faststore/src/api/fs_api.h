@@ -62,12 +62,24 @@ void fs_api_terminate_ex(FSAPIContext *api_ctx);
 int fs_api_unlink_file(FSAPIContext *api_ctx, const int64_t oid,
         const int64_t file_size, const uint64_t tid);
 
+/* write the combined slices of the file and wait for done */
+int fs_api_flush_file(FSAPIContext *api_ctx, const int64_t oid,
+        const int64_t file_size, const uint64_t tid);
+
+/* flush the file then persist the written data by the servers */
+int fs_api_commit_file(FSAPIContext *api_ctx, const int64_t oid,
+        const int64_t file_size, const uint64_t tid);
+
 int fs_api_slice_write(FSAPIOperationContext *op_ctx,
         FSAPIWriteBuffer *wbuffer, int *write_bytes, int *inc_alloc);
 
 int fs_api_slice_read(FSAPIOperationContext *op_ctx,
         char *buff, int *read_bytes);
 
+/* find the first data or hole offset within the block slice */
+int fs_api_slice_seek(FSAPIOperationContext *op_ctx,
+        const int whence, int *offset);
+
 int fs_api_slice_allocate_ex(FSAPIOperationContext *op_ctx,
         const int enoent_log_level, int *inc_alloc);
 
@@ -77,6 +89,11 @@ int fs_api_slice_delete_ex(FSAPIOperationContext *op_ctx,
 int fs_api_block_delete_ex(FSAPIOperationContext *op_ctx,
         const int enoent_log_level, int *dec_alloc);
 
+/* op_ctx->bs_key shares the space of src_bs_key, the caller should
+ * flush the source file first. return EXDEV when the data groups differ */
+int fs_api_slice_clone(FSAPIOperationContext *op_ctx,
+        const FSBlockSliceKeyInfo *src_bs_key, int *inc_alloc);
+
 #define fs_api_slice_allocate(op_ctx, inc_alloc) \
     fs_api_slice_allocate_ex(op_ctx, LOG_DEBUG, inc_alloc)
 
@@ -68,6 +68,18 @@ static int fs_client_do_init_ex(FSClientContext *client_ctx,
     }
 
     sf_load_read_rule_config(&client_ctx->read_rule, ini_ctx);
+    client_ctx->read_balance.latency_aware = iniGetBoolValueEx(
+            ini_ctx->section_name, "read_latency_aware",
+            ini_ctx->context, false, true);
+    client_ctx->read_balance.hedged_read = iniGetBoolValueEx(
+            ini_ctx->section_name, "hedged_read",
+            ini_ctx->context, false, true);
+    if (client_ctx->read_rule == sf_data_read_rule_master_only ||
+            !client_ctx->read_balance.latency_aware)
+    {
+        client_ctx->read_balance.latency_aware = false;
+        client_ctx->read_balance.hedged_read = false;
+    }
 
     if ((result=fs_cluster_cfg_load_from_ini_ex1(client_ctx->
                     cluster_cfg.ptr, ini_ctx)) != 0)
@@ -95,7 +107,8 @@ void fs_client_log_config_ex(FSClientContext *client_ctx,
             "base_path: %s, "
             "connect_timeout: %d, "
             "network_timeout: %d, "
-            "read_rule: %s, %s, "
+            "read_rule: %s, read_latency_aware: %d, "
+            "hedged_read: %d, %s, "
             "server group count: %d, "
             "data group count: %d%s%s",
             g_fs_global_vars.version.major,
@@ -105,6 +118,8 @@ void fs_client_log_config_ex(FSClientContext *client_ctx,
             client_ctx->connect_timeout,
             client_ctx->network_timeout,
             sf_get_read_rule_caption(client_ctx->read_rule),
+            client_ctx->read_balance.latency_aware,
+            client_ctx->read_balance.hedged_read,
             net_retry_output,
             FS_SERVER_GROUP_COUNT(*client_ctx->cluster_cfg.ptr),
             FS_DATA_GROUP_COUNT(*client_ctx->cluster_cfg.ptr),
@@ -17,9 +17,12 @@
 #ifndef _FS_CLIENT_FUNC_H
 #define _FS_CLIENT_FUNC_H
 
+#include "fastcommon/sched_thread.h"
 #include "fs_global.h"
 #include "client_types.h"
 
+#define FS_CLIENT_MIN_HEDGED_READ_DELAY_US  1000
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -85,6 +88,66 @@ int fs_alloc_group_servers(FSServerGroup *server_group,
 void fs_client_log_config_ex(FSClientContext *client_ctx,
         const char *extra_config);
 
+static inline FSClientServerStats *fs_client_read_stats_begin(
+        FSClientContext *client_ctx, ConnectionInfo *conn)
+{
+    FSClientServerStats *stats;
+
+    stats = client_ctx->conn_manager.get_connection_params(
+            client_ctx, conn)->stats;
+    if (stats != NULL) {
+        __sync_add_and_fetch(&stats->inflight, 1);
+    }
+    return stats;
+}
+
+/* update the latency as TCP RTT estimation (RFC 6298) with
+ * gain 1/8 for srtt and 1/4 for rttvar, time_used_us < 0 for no sample */
+static inline void fs_client_read_stats_end(FSClientServerStats *stats,
+        const int64_t time_used_us, const int result)
+{
+    int64_t srtt;
+    int64_t delta;
+
+    if (stats == NULL) {
+        return;
+    }
+
+    __sync_sub_and_fetch(&stats->inflight, 1);
+    if (!(result == 0 || result == ENODATA || result == ENOENT)) {
+        stats->fail_time = get_current_time();
+        return;
+    }
+    if (time_used_us < 0) {
+        return;
+    }
+
+    srtt = stats->srtt_us;
+    if (srtt == 0) {
+        stats->rttvar_us = time_used_us / 2;
+        stats->srtt_us = FC_MAX(time_used_us, 1);
+    } else {
+        delta = time_used_us - srtt;
+        if (delta < 0) {
+            delta = -delta;
+        }
+        stats->rttvar_us = (3 * stats->rttvar_us + delta) / 4;
+        stats->srtt_us = FC_MAX((7 * srtt + time_used_us) / 8, 1);
+    }
+}
+
+/* srtt + 2 * rttvar is about the p95 latency because the mean deviation
+ * is about 0.8 sigma for the normal distribution, return -1 for no sample */
+static inline int64_t fs_client_hedged_read_delay_us(
+        const FSClientServerStats *stats)
+{
+    if (stats->srtt_us == 0) {
+        return -1;
+    }
+    return FC_MAX(stats->srtt_us + 2 * stats->rttvar_us,
+            FS_CLIENT_MIN_HEDGED_READ_DELAY_US);
+}
+
 #ifdef __cplusplus
 }
 #endif
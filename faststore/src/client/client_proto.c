@@ -66,7 +66,7 @@ int fs_client_proto_slice_write(FSClientContext *client_ctx,
         int2buff(bs_key->slice.offset, req_header->bs.slice_size.offset);
         int2buff(bs_key->slice.length, req_header->bs.slice_size.length);
 
-        if ((result=tcpsenddata_nb(conn->sock, out_buff,
+        if ((result=sf_proto_send_request(conn, out_buff,
                         sizeof(FSProtoHeader) + body_front_len,
                         client_ctx->network_timeout)) != 0)
         {
@@ -97,42 +97,230 @@ int fs_client_proto_slice_write(FSClientContext *client_ctx,
     return result;
 }
 
-int fs_client_proto_slice_read_ex(FSClientContext *client_ctx,
-        ConnectionInfo *conn, const int slave_id, const int req_cmd,
-        const int resp_cmd, const FSBlockSliceKeyInfo *bs_key,
+#define FS_SPARSE_READ_FIXED_EXTENTS  64
+
+static inline int recv_sparse_read_header(FSClientContext *client_ctx,
+        ConnectionInfo *conn, SFResponseInfo *response,
+        const int slice_length, int *read_bytes, int *extent_count)
+{
+    FSProtoSliceSparseReadRespHeader resp_header;
+    int result;
+
+    if (response->header.body_len < sizeof(resp_header)) {
+        response->error.length = sprintf(response->error.message,
+                "response body length: %d < expected: %d",
+                response->header.body_len, (int)sizeof(resp_header));
+        return EINVAL;
+    }
+
+    if ((result=tcprecvdata_nb(conn->sock, &resp_header,
+                    sizeof(resp_header), client_ctx->
+                    network_timeout)) != 0)
+    {
+        response->error.length = snprintf(response->error.message,
+                sizeof(response->error.message),
+                "recv data fail, errno: %d, error info: %s",
+                result, STRERROR(result));
+        return result;
+    }
+
+    *read_bytes = buff2int(resp_header.read_bytes);
+    *extent_count = buff2int(resp_header.extent_count);
+    if (*read_bytes < 0 || *read_bytes > slice_length ||
+            *extent_count < 0 || sizeof(resp_header) + (int64_t)
+            *extent_count * sizeof(FSProtoSliceSize) >
+            response->header.body_len)
+    {
+        response->error.length = sprintf(response->error.message,
+                "invalid read bytes: %d or extent count: %d, "
+                "slice length: %d, response body length: %d",
+                *read_bytes, *extent_count, slice_length,
+                response->header.body_len);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+/* receive the data extents to their positions and zero fill the holes */
+static int recv_sparse_read_body(FSClientContext *client_ctx,
+        ConnectionInfo *conn, SFResponseInfo *response,
+        const int slice_offset, const int slice_length,
         char *buff, int *read_bytes)
 {
-    const FSConnectionParameters *connection_params;
-    char out_buff[sizeof(FSProtoHeader) + sizeof(FSProtoServiceSliceReadReq)
-        + sizeof(FSProtoReplicaSliceReadReq)];
+    FSProtoSliceSize fixed_extents[FS_SPARSE_READ_FIXED_EXTENTS];
+    FSProtoSliceSize *extents;
+    FSProtoSliceSize *proto_extent;
+    FSProtoSliceSize *end;
+    int extent_count;
+    int extents_bytes;
+    int data_bytes;
+    int offset;
+    int length;
+    int pos;
+    int result;
+
+    if ((result=recv_sparse_read_header(client_ctx, conn, response,
+                    slice_length, read_bytes, &extent_count)) != 0)
+    {
+        return result;
+    }
+
+    extents_bytes = extent_count * sizeof(FSProtoSliceSize);
+    if (extent_count <= FS_SPARSE_READ_FIXED_EXTENTS) {
+        extents = fixed_extents;
+    } else if ((extents=(FSProtoSliceSize *)fc_malloc(
+                    extents_bytes)) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    if ((result=tcprecvdata_nb(conn->sock, extents, extents_bytes,
+                    client_ctx->network_timeout)) != 0)
+    {
+        response->error.length = snprintf(response->error.message,
+                sizeof(response->error.message),
+                "recv data fail, errno: %d, error info: %s",
+                result, STRERROR(result));
+    }
+
+    data_bytes = response->header.body_len - (sizeof(
+                FSProtoSliceSparseReadRespHeader) + extents_bytes);
+    pos = 0;
+    end = extents + extent_count;
+    for (proto_extent=extents; result == 0 && proto_extent<end;
+            proto_extent++)
+    {
+        offset = buff2int(proto_extent->offset) - slice_offset;
+        length = buff2int(proto_extent->length);
+        if (offset < pos || length <= 0 || length > data_bytes ||
+                offset + length > *read_bytes)
+        {
+            response->error.length = sprintf(response->error.message,
+                    "invalid extent {offset: %d, length: %d}, "
+                    "slice offset: %d, read bytes: %d", offset +
+                    slice_offset, length, slice_offset, *read_bytes);
+            result = EINVAL;
+            break;
+        }
+
+        if (offset > pos) {
+            memset(buff + pos, 0, offset - pos);
+        }
+        if ((result=tcprecvdata_nb(conn->sock, buff + offset, length,
+                        client_ctx->network_timeout)) != 0)
+        {
+            response->error.length = snprintf(response->error.message,
+                    sizeof(response->error.message),
+                    "recv data fail, errno: %d, error info: %s",
+                    result, STRERROR(result));
+            break;
+        }
+        data_bytes -= length;
+        pos = offset + length;
+    }
+
+    if (extents != fixed_extents) {
+        free(extents);
+    }
+
+    if (result == 0) {
+        if (data_bytes != 0) {
+            response->error.length = sprintf(response->error.message,
+                    "response body length: %d, %d data bytes remain",
+                    response->header.body_len, data_bytes);
+            return EINVAL;
+        }
+
+        if (*read_bytes > pos) {
+            memset(buff + pos, 0, *read_bytes - pos);
+        }
+    }
+
+    return result;
+}
+
+static int pack_slice_read_request(char *out_buff, const int slave_id,
+        const int req_cmd, const FSBlockSliceKeyInfo *bs_key,
+        FSProtoBlockSlice **proto_bs)
+{
     FSProtoHeader *proto_header;
-    SFResponseInfo response;
     FSProtoServiceSliceReadReq *sreq;
+    FSProtoServiceSliceSparseReadReq *spreq;
     FSProtoReplicaSliceReadReq *rreq;
-    FSProtoBlockSlice *proto_bs;
     int body_len;
-    int hole_start;
-    int hole_len;
-    int buff_offet;
-    int remain;
-    int curr_len;
-    int bytes;
-    int result;
 
     proto_header = (FSProtoHeader *)out_buff;
     if (req_cmd == FS_SERVICE_PROTO_SLICE_READ_REQ) {
         body_len = sizeof(FSProtoServiceSliceReadReq);
         sreq = (FSProtoServiceSliceReadReq *)(proto_header + 1);
-        proto_bs = &sreq->bs;
+        *proto_bs = &sreq->bs;
+    } else if (req_cmd == FS_SERVICE_PROTO_SLICE_SPARSE_READ_REQ) {
+        body_len = sizeof(FSProtoServiceSliceSparseReadReq);
+        spreq = (FSProtoServiceSliceSparseReadReq *)(proto_header + 1);
+        memset(spreq, 0, sizeof(*spreq));
+        *proto_bs = &spreq->bs;
     } else {
         body_len = sizeof(FSProtoReplicaSliceReadReq);
         rreq = (FSProtoReplicaSliceReadReq *)(proto_header + 1);
         int2buff(slave_id, rreq->slave_id);
-        proto_bs = &rreq->bs;
+        *proto_bs = &rreq->bs;
     }
     SF_PROTO_SET_HEADER(proto_header, req_cmd, body_len);
-    proto_pack_block_key(&bs_key->block, &proto_bs->bkey);
+    proto_pack_block_key(&bs_key->block, &(*proto_bs)->bkey);
+    return sizeof(FSProtoHeader) + body_len;
+}
+
+static int recv_slice_read_body(FSClientContext *client_ctx,
+        ConnectionInfo *conn, SFResponseInfo *response,
+        const int resp_cmd, const int slice_offset,
+        const int slice_length, char *buff, int *bytes)
+{
+    int result;
+
+    if (resp_cmd == FS_SERVICE_PROTO_SLICE_SPARSE_READ_RESP) {
+        return recv_sparse_read_body(client_ctx, conn, response,
+                slice_offset, slice_length, buff, bytes);
+    }
+
+    if (response->header.body_len > slice_length) {
+        response->error.length = sprintf(response->error.message,
+                "response body length: %d > slice length: %d",
+                response->header.body_len, slice_length);
+        return EINVAL;
+    }
+
+    if ((result=tcprecvdata_nb_ex(conn->sock, buff, response->header.
+                    body_len, client_ctx->network_timeout, bytes)) != 0)
+    {
+        response->error.length = snprintf(response->error.message,
+                sizeof(response->error.message),
+                "recv data fail, errno: %d, error info: %s",
+                result, STRERROR(result));
+    }
+    return result;
+}
+
+int fs_client_proto_slice_read_ex(FSClientContext *client_ctx,
+        ConnectionInfo *conn, const int slave_id, const int req_cmd,
+        const int resp_cmd, const FSBlockSliceKeyInfo *bs_key,
+        char *buff, int *read_bytes)
+{
+    const FSConnectionParameters *connection_params;
+    char out_buff[FS_CLIENT_SLICE_READ_REQUEST_MAX_SIZE];
+    SFResponseInfo response;
+    FSProtoBlockSlice *proto_bs;
+    int out_len;
+    int hole_start;
+    int hole_len;
+    int buff_offet;
+    int remain;
+    int curr_len;
+    int bytes;
+    int result;
 
+    out_len = pack_slice_read_request(out_buff, slave_id,
+            req_cmd, bs_key, &proto_bs);
     connection_params = client_ctx->conn_manager.get_connection_params(
             client_ctx, conn);
 
@@ -151,9 +339,9 @@ int fs_client_proto_slice_read_ex(FSClientContext *client_ctx,
         int2buff(curr_len, proto_bs->slice_size.length);
 
         response.error.length = 0;
-        if ((result=sf_send_and_recv_response_header(conn,
-                        out_buff, sizeof(FSProtoHeader) + body_len,
-                        &response, client_ctx->network_timeout)) != 0)
+        if ((result=sf_send_and_recv_response_header(conn, out_buff,
+                        out_len, &response, client_ctx->
+                        network_timeout)) != 0)
         {
             break;
         }
@@ -168,22 +356,10 @@ int fs_client_proto_slice_read_ex(FSClientContext *client_ctx,
                 break;
             }
         } else {
-            if (response.header.body_len > curr_len) {
-                response.error.length = sprintf(response.error.message,
-                        "response body length: %d > slice length: %d",
-                        response.header.body_len, curr_len);
-                result = EINVAL;
-                break;
-            }
-
-            if ((result=tcprecvdata_nb_ex(conn->sock, buff + buff_offet,
-                            response.header.body_len, client_ctx->
-                            network_timeout, &bytes)) != 0)
+            if ((result=recv_slice_read_body(client_ctx, conn, &response,
+                            resp_cmd, bs_key->slice.offset + buff_offet,
+                            curr_len, buff + buff_offet, &bytes)) != 0)
             {
-                response.error.length = snprintf(response.error.message,
-                        sizeof(response.error.message),
-                        "recv data fail, errno: %d, error info: %s",
-                        result, STRERROR(result));
                 break;
             }
 
@@ -217,6 +393,204 @@ int fs_client_proto_slice_read_ex(FSClientContext *client_ctx,
     }
 }
 
+int fs_client_proto_slice_read_send(FSClientContext *client_ctx,
+        ConnectionInfo *conn, const int req_cmd,
+        const FSBlockSliceKeyInfo *bs_key)
+{
+    char out_buff[FS_CLIENT_SLICE_READ_REQUEST_MAX_SIZE];
+    FSProtoBlockSlice *proto_bs;
+    int out_len;
+    int result;
+
+    out_len = pack_slice_read_request(out_buff, 0,
+            req_cmd, bs_key, &proto_bs);
+    int2buff(bs_key->slice.offset, proto_bs->slice_size.offset);
+    int2buff(bs_key->slice.length, proto_bs->slice_size.length);
+    if ((result=sf_proto_send_request(conn, out_buff, out_len,
+                    client_ctx->network_timeout)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "send data to server %s:%u fail, "
+                "errno: %d, error info: %s", __LINE__,
+                conn->ip_addr, conn->port, result, STRERROR(result));
+    }
+    return result;
+}
+
+int fs_client_proto_slice_read_recv(FSClientContext *client_ctx,
+        ConnectionInfo *conn, const int resp_cmd,
+        const FSBlockSliceKeyInfo *bs_key,
+        char *buff, int *read_bytes)
+{
+    SFCommonProtoHeader header_proto;
+    SFResponseInfo response;
+    int result;
+
+    *read_bytes = 0;
+    response.error.length = 0;
+    if ((result=tcprecvdata_nb(conn->sock, &header_proto,
+                    sizeof(SFCommonProtoHeader), client_ctx->
+                    network_timeout)) != 0)
+    {
+        response.error.length = snprintf(response.error.message,
+                sizeof(response.error.message),
+                "recv data fail, errno: %d, error info: %s",
+                result, STRERROR(result));
+    } else {
+        sf_proto_extract_header(&header_proto, &response.header);
+        if ((result=sf_check_response(conn, &response, client_ctx->
+                        network_timeout, resp_cmd)) == 0)
+        {
+            result = recv_slice_read_body(client_ctx, conn, &response,
+                    resp_cmd, bs_key->slice.offset, bs_key->slice.length,
+                    buff, read_bytes);
+        } else if (result == ENOENT) {
+            return ENODATA;
+        }
+    }
+
+    if (result != 0) {
+        sf_log_network_error(&response, conn, result);
+        return result;
+    }
+    return *read_bytes > 0 ? 0 : ENODATA;
+}
+
+/* find the data or hole from the extents of the block slice, the next
+ * query starts from the end of the covered range when not found */
+static int seek_in_slice_extents(FSClientContext *client_ctx,
+        ConnectionInfo *conn, SFResponseInfo *response,
+        const int whence, const int range_end, int *pos, bool *found)
+{
+    FSProtoSliceSize extents[FS_SPARSE_READ_FIXED_EXTENTS];
+    FSProtoSliceSize *proto_extent;
+    FSProtoSliceSize *end;
+    int read_bytes;
+    int extent_count;
+    int count;
+    int start;
+    int offset;
+    int length;
+    int result;
+
+    if ((result=recv_sparse_read_header(client_ctx, conn, response,
+                    range_end - *pos, &read_bytes, &extent_count)) != 0)
+    {
+        return result;
+    }
+    if (read_bytes == 0) {  //avoid dead loop
+        read_bytes = range_end - *pos;
+    }
+
+    start = *pos;
+    *found = false;
+    while (extent_count > 0) {
+        count = FC_MIN(extent_count, FS_SPARSE_READ_FIXED_EXTENTS);
+        if ((result=tcprecvdata_nb(conn->sock, extents, count *
+                        sizeof(FSProtoSliceSize), client_ctx->
+                        network_timeout)) != 0)
+        {
+            response->error.length = snprintf(response->error.message,
+                    sizeof(response->error.message),
+                    "recv data fail, errno: %d, error info: %s",
+                    result, STRERROR(result));
+            return result;
+        }
+        extent_count -= count;
+
+        end = extents + count;
+        for (proto_extent=extents; !(*found) && proto_extent<end;
+                proto_extent++)
+        {
+            offset = buff2int(proto_extent->offset);
+            length = buff2int(proto_extent->length);
+            if (whence == SEEK_DATA) {
+                *pos = FC_MAX(offset, *pos);
+                *found = true;
+            } else if (offset > *pos) {  //the hole before this extent
+                *found = true;
+            } else {
+                *pos = FC_MAX(offset + length, *pos);
+            }
+        }
+    }
+
+    if (!(*found)) {
+        if (whence == SEEK_HOLE && *pos < start + read_bytes) {
+            *found = true;
+        } else {
+            *pos = start + read_bytes;
+        }
+    }
+
+    return 0;
+}
+
+int fs_client_proto_slice_seek(FSClientContext *client_ctx,
+        ConnectionInfo *conn, const FSBlockSliceKeyInfo *bs_key,
+        const int whence, int *offset)
+{
+    char out_buff[sizeof(FSProtoHeader) +
+        sizeof(FSProtoServiceSliceSparseReadReq)];
+    FSProtoHeader *proto_header;
+    FSProtoServiceSliceSparseReadReq *req;
+    SFResponseInfo response;
+    int range_end;
+    bool found;
+    int result;
+
+    proto_header = (FSProtoHeader *)out_buff;
+    req = (FSProtoServiceSliceSparseReadReq *)(proto_header + 1);
+    SF_PROTO_SET_HEADER(proto_header, FS_SERVICE_PROTO_SLICE_SPARSE_READ_REQ,
+            sizeof(FSProtoServiceSliceSparseReadReq));
+    memset(req, 0, sizeof(*req));
+    req->flags = FS_SPARSE_READ_FLAGS_EXTENTS_ONLY;
+    proto_pack_block_key(&bs_key->block, &req->bs.bkey);
+
+    *offset = bs_key->slice.offset;
+    range_end = bs_key->slice.offset + bs_key->slice.length;
+    found = false;
+    while (*offset < range_end) {
+        int2buff(*offset, req->bs.slice_size.offset);
+        int2buff(range_end - *offset, req->bs.slice_size.length);
+
+        response.error.length = 0;
+        if ((result=sf_send_and_recv_response_header(conn, out_buff,
+                        sizeof(out_buff), &response, client_ctx->
+                        network_timeout)) != 0)
+        {
+            break;
+        }
+
+        if ((result=sf_check_response(conn, &response, client_ctx->
+                        network_timeout, FS_SERVICE_PROTO_SLICE_SPARSE_READ_RESP))
+                != 0)
+        {
+            if (result == ENOENT) {  //the whole block is a hole
+                result = 0;
+                found = (whence == SEEK_HOLE);
+                if (!found) {
+                    *offset = range_end;
+                }
+            }
+        } else {
+            result = seek_in_slice_extents(client_ctx, conn,
+                    &response, whence, range_end, offset, &found);
+        }
+
+        if (result != 0 || found) {
+            break;
+        }
+    }
+
+    if (result != 0) {
+        sf_log_network_error(&response, conn, result);
+        return result;
+    }
+
+    return found ? 0 : ENXIO;
+}
+
 int fs_client_proto_bs_operate(FSClientContext *client_ctx,
         ConnectionInfo *conn, const uint64_t req_id, const void *key,
         const int req_cmd, const int resp_cmd,
@@ -320,6 +694,94 @@ int fs_client_proto_block_delete(FSClientContext *client_ctx,
     return result;
 }
 
+int fs_client_proto_slice_clone(FSClientContext *client_ctx,
+        ConnectionInfo *conn, const uint64_t req_id,
+        const FSBlockSliceKeyInfo *src_bs_key,
+        const FSBlockSliceKeyInfo *dest_bs_key, int *inc_alloc)
+{
+    char out_buff[sizeof(FSProtoHeader) +
+        sizeof(SFProtoIdempotencyAdditionalHeader) +
+        sizeof(FSProtoSliceCloneReq)];
+    FSProtoHeader *proto_header;
+    FSProtoSliceCloneReq *req;
+    SFResponseInfo response;
+    FSProtoSliceUpdateResp resp;
+    int result;
+    int body_len;
+
+    proto_header = (FSProtoHeader *)out_buff;
+    body_len = sizeof(FSProtoSliceCloneReq);
+    if (req_id > 0) {
+        long2buff(req_id, ((SFProtoIdempotencyAdditionalHeader *)
+                    (proto_header + 1))->req_id);
+        body_len += sizeof(SFProtoIdempotencyAdditionalHeader);
+        req = (FSProtoSliceCloneReq *)((char *)(proto_header
+                    + 1) + sizeof(SFProtoIdempotencyAdditionalHeader));
+    } else {
+        req = (FSProtoSliceCloneReq *)(proto_header + 1);
+    }
+
+    proto_pack_block_key(&dest_bs_key->block, &req->bs.bkey);
+    int2buff(dest_bs_key->slice.offset, req->bs.slice_size.offset);
+    int2buff(dest_bs_key->slice.length, req->bs.slice_size.length);
+    proto_pack_block_key(&src_bs_key->block, &req->src.bkey);
+    int2buff(src_bs_key->slice.offset, req->src.slice_size.offset);
+    int2buff(src_bs_key->slice.length, req->src.slice_size.length);
+    SF_PROTO_SET_HEADER(proto_header, FS_SERVICE_PROTO_SLICE_CLONE_REQ,
+            body_len);
+
+    response.error.length = 0;
+    if ((result=sf_send_and_recv_response(conn, out_buff,
+                    sizeof(FSProtoHeader) + body_len, &response,
+                    client_ctx->network_timeout,
+                    FS_SERVICE_PROTO_SLICE_CLONE_RESP, (char *)&resp,
+                    sizeof(FSProtoSliceUpdateResp))) == 0)
+    {
+        *inc_alloc = buff2int(resp.inc_alloc);
+    } else {
+        *inc_alloc = 0;
+        sf_log_network_error(&response, conn, result);
+    }
+
+    return result;
+}
+
+int fs_client_proto_send_commit(FSClientContext *client_ctx,
+        ConnectionInfo *conn)
+{
+    FSProtoHeader proto_header;
+    SFResponseInfo response;
+    int result;
+
+    SF_PROTO_SET_HEADER(&proto_header, FS_SERVICE_PROTO_COMMIT_REQ, 0);
+    if ((result=tcpsenddata_nb(conn->sock, &proto_header,
+                    sizeof(FSProtoHeader), client_ctx->
+                    network_timeout)) != 0)
+    {
+        response.error.length = 0;
+        sf_log_network_error(&response, conn, result);
+    }
+
+    return result;
+}
+
+int fs_client_proto_recv_commit(FSClientContext *client_ctx,
+        ConnectionInfo *conn)
+{
+    SFResponseInfo response;
+    int result;
+
+    response.error.length = 0;
+    if ((result=sf_recv_response(conn, &response, client_ctx->
+                    network_timeout, FS_SERVICE_PROTO_COMMIT_RESP,
+                    NULL, 0)) != 0)
+    {
+        sf_log_network_error(&response, conn, result);
+    }
+
+    return result;
+}
+
 int fs_client_proto_join_server(FSClientContext *client_ctx,
         ConnectionInfo *conn, FSConnectionParameters *conn_params)
 {
@@ -728,3 +1190,22 @@ int fs_client_proto_service_stat(FSClientContext *client_ctx,
 
     return 0;
 }
+
+int fs_client_proto_get_metrics(FSClientContext *client_ctx,
+        const ConnectionInfo *spec_conn, SFMetricsItemInfo *items,
+        const int size, int *count)
+{
+    ConnectionInfo *conn;
+    int result;
+
+    if ((conn=client_ctx->conn_manager.get_spec_connection(
+                    client_ctx, spec_conn, &result)) == NULL)
+    {
+        return result;
+    }
+
+    result = sf_proto_get_metrics(conn, client_ctx->network_timeout,
+            items, size, count);
+    SF_CLIENT_RELEASE_CONNECTION(client_ctx, conn, result);
+    return result;
+}
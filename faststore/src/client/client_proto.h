@@ -47,6 +47,11 @@ typedef struct fs_client_service_stat {
 extern "C" {
 #endif
 
+#define FS_CLIENT_SLICE_READ_REQUEST_MAX_SIZE  (sizeof(FSProtoHeader) + \
+        FC_MAX(FC_MAX(sizeof(FSProtoServiceSliceReadReq),  \
+                sizeof(FSProtoServiceSliceSparseReadReq)), \
+            sizeof(FSProtoReplicaSliceReadReq)))
+
 #define fs_client_proto_slice_read(client_ctx, conn, bs_key, buff, read_bytes) \
         fs_client_proto_slice_read_ex(client_ctx,     \
             conn, 0, FS_SERVICE_PROTO_SLICE_READ_REQ, \
@@ -63,6 +68,24 @@ extern "C" {
             const int resp_cmd, const FSBlockSliceKeyInfo *bs_key,
             char *buff, int *read_bytes);
 
+    /* send the slice read request without waiting for the response,
+     * the slice length must be less than or equal to the buffer size */
+    int fs_client_proto_slice_read_send(FSClientContext *client_ctx,
+            ConnectionInfo *conn, const int req_cmd,
+            const FSBlockSliceKeyInfo *bs_key);
+
+    /* recv the response of the request sent by the above function */
+    int fs_client_proto_slice_read_recv(FSClientContext *client_ctx,
+            ConnectionInfo *conn, const int resp_cmd,
+            const FSBlockSliceKeyInfo *bs_key,
+            char *buff, int *read_bytes);
+
+    /* find the first data (SEEK_DATA) or hole (SEEK_HOLE) offset in the
+     * block slice, return ENXIO when not found */
+    int fs_client_proto_slice_seek(FSClientContext *client_ctx,
+            ConnectionInfo *conn, const FSBlockSliceKeyInfo *bs_key,
+            const int whence, int *offset);
+
     int fs_client_proto_bs_operate(FSClientContext *client_ctx,
             ConnectionInfo *conn, const uint64_t req_id, const void *key,
             const int req_cmd, const int resp_cmd,
@@ -73,6 +96,19 @@ extern "C" {
             const FSBlockKey *bkey, const int enoent_log_level,
             int *dec_alloc);
 
+    int fs_client_proto_slice_clone(FSClientContext *client_ctx,
+            ConnectionInfo *conn, const uint64_t req_id,
+            const FSBlockSliceKeyInfo *src_bs_key,
+            const FSBlockSliceKeyInfo *dest_bs_key, int *inc_alloc);
+
+    /* send the commit request without waiting for the response,
+     * so the commit requests to multi servers run in parallel */
+    int fs_client_proto_send_commit(FSClientContext *client_ctx,
+            ConnectionInfo *conn);
+
+    int fs_client_proto_recv_commit(FSClientContext *client_ctx,
+            ConnectionInfo *conn);
+
     int fs_client_proto_join_server(FSClientContext *client_ctx,
             ConnectionInfo *conn, FSConnectionParameters *conn_params);
 
@@ -97,6 +133,10 @@ extern "C" {
             const ConnectionInfo *spec_conn, const int data_group_id,
             FSClientServiceStat *stat);
 
+    int fs_client_proto_get_metrics(FSClientContext *client_ctx,
+            const ConnectionInfo *spec_conn, SFMetricsItemInfo *items,
+            const int size, int *count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,6 +31,11 @@ typedef ConnectionInfo *(*fs_get_connection_func)(
         struct fs_client_context *client_ctx,
         const int data_group_index, int *err_no);
 
+typedef ConnectionInfo *(*fs_get_other_connection_func)(
+        struct fs_client_context *client_ctx,
+        const int data_group_index, const int exclude_server_id,
+        int *err_no);
+
 typedef ConnectionInfo *(*fs_get_server_connection_func)(
         struct fs_client_context *client_ctx,
         FCServerInfo *server, int *err_no);
@@ -47,9 +52,19 @@ typedef void (*fs_close_connection_func)(
 typedef const struct fs_connection_parameters * (*fs_get_connection_parameters)(
         struct fs_client_context *client_ctx, ConnectionInfo *conn);
 
+/* the read latency and load of the data server */
+typedef struct fs_client_server_stats {
+    int server_id;
+    volatile int inflight;    //the reading requests
+    volatile int fail_time;   //the last read fail time
+    volatile int64_t srtt_us; //the smoothed latency, 0 for no sample
+    volatile int64_t rttvar_us;  //the smoothed mean deviation
+} FSClientServerStats;
+
 typedef struct fs_connection_parameters {
     int buffer_size;
     int data_group_id;  //for master cache
+    FSClientServerStats *stats;  //set by latency aware read
     struct idempotency_client_channel *channel;
 } FSConnectionParameters;
 
@@ -59,6 +74,12 @@ typedef struct fs_client_server_entry {
     char status;
 } FSClientServerEntry;
 
+typedef struct fs_client_readable_server {
+    ConnectionInfo conn;
+    FSClientServerStats *stats;
+    bool is_master;
+} FSClientReadableServer;
+
 typedef struct fs_client_data_group_entry {
     /* master connection cache */
     struct {
@@ -66,6 +87,15 @@ typedef struct fs_client_data_group_entry {
         ConnectionInfo holder;
         pthread_mutex_t lock;
     } master_cache;
+
+    /* active servers cache for latency aware read */
+    struct {
+        FSClientReadableServer *servers;
+        int count;
+        volatile int expire_time;
+        volatile unsigned int counter;  //for probe
+        pthread_mutex_t lock;
+    } readable_cache;
 } FSClientDataGroupEntry;
 
 typedef struct fs_client_data_group_array {
@@ -73,6 +103,11 @@ typedef struct fs_client_data_group_array {
     int count;
 } FSClientDataGroupArray;
 
+typedef struct fs_client_server_stats_array {
+    FSClientServerStats *stats;  //index by server in the server config
+    int count;
+} FSClientServerStatsArray;
+
 typedef struct fs_client_cluster_stat_entry {
     int data_group_id;
     int server_id;
@@ -111,6 +146,9 @@ typedef struct fs_connection_manager {
     /* get one readable connection from the server */
     fs_get_connection_func get_readable_connection;
 
+    /* get one readable connection of other server for hedged read */
+    fs_get_other_connection_func get_other_readable_connection;
+
     /* get the leader connection from the server */
     fs_get_server_connection_func get_leader_connection;
 
@@ -123,6 +161,7 @@ typedef struct fs_connection_manager {
     fs_get_connection_parameters get_connection_params;
 
     FSClientDataGroupArray data_group_array;
+    FSClientServerStatsArray server_stats_array;
 
     void *args;   //extra data
 } FSConnectionManager;
@@ -138,6 +177,10 @@ typedef struct fs_client_context {
     bool is_simple_conn_mananger;
     bool idempotency_enabled;
     SFDataReadRule read_rule;  //the rule for read
+    struct {
+        bool latency_aware;  //select the replica by latency and load
+        bool hedged_read;    //read the second replica when the first slow
+    } read_balance;
     int connect_timeout;
     int network_timeout;
     SFNetRetryConfig net_retry_cfg;
@@ -14,6 +14,7 @@
  */
 
 #include <stdlib.h>
+#include <poll.h>
 #include "fastcommon/fc_list.h"
 #include "fastcommon/skiplist_set.h"
 #include "sf/idempotency/client/client_channel.h"
@@ -59,6 +60,223 @@ int fs_unlink_file(FSClientContext *client_ctx, const int64_t oid,
     return result;
 }
 
+#define FS_CLIENT_COMMIT_MAX_CONNECTIONS  64
+
+typedef struct {
+    ConnectionInfo *conns[FS_CLIENT_COMMIT_MAX_CONNECTIONS];
+    int count;
+} FSClientCommitConnArray;
+
+static bool commit_conn_exists(FSClientCommitConnArray *carray,
+        const ConnectionInfo *conn)
+{
+    ConnectionInfo **current;
+    ConnectionInfo **end;
+
+    end = carray->conns + carray->count;
+    for (current=carray->conns; current<end; current++) {
+        if ((*current)->port == conn->port &&
+                strcmp((*current)->ip_addr, conn->ip_addr) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int recv_commit_responses(FSClientContext *client_ctx,
+        FSClientCommitConnArray *carray)
+{
+    ConnectionInfo **conn;
+    ConnectionInfo **end;
+    int result;
+    int current;
+
+    result = 0;
+    end = carray->conns + carray->count;
+    for (conn=carray->conns; conn<end; conn++) {
+        current = fs_client_proto_recv_commit(client_ctx, *conn);
+        SF_CLIENT_RELEASE_CONNECTION(client_ctx, *conn, current);
+        if (result == 0) {
+            result = current;
+        }
+    }
+
+    carray->count = 0;
+    return result;
+}
+
+/* the active servers of the data group (include the master) by the
+ * cluster stat of the master, the master waits for the replication of
+ * these slaves before responding the write */
+static int get_active_servers(FSClientContext *client_ctx,
+        const int group_index, FSClientClusterStatEntryArray *cs_array)
+{
+    ConnectionInfo *conn;
+    FSClusterStatFilter filter;
+    FSIdArray gid_array;
+    int data_group_id;
+    int result;
+
+    if ((conn=client_ctx->conn_manager.get_master_connection(
+                    client_ctx, group_index, &result)) == NULL)
+    {
+        return SF_UNIX_ERRNO(result, EIO);
+    }
+
+    filter.filter_by = FS_CLUSTER_STAT_FILTER_BY_GROUP |
+        FS_CLUSTER_STAT_FILTER_BY_STATUS;
+    filter.op_type = '=';
+    filter.status = FS_DS_STATUS_ACTIVE;
+    filter.is_master = 0;
+    filter.data_group_id = group_index + 1;
+    gid_array.alloc = 1;
+    gid_array.ids = &data_group_id;
+    cs_array->count = 0;
+    result = fs_client_proto_cluster_stat(client_ctx,
+            conn, &filter, &gid_array, cs_array);
+    SF_CLIENT_RELEASE_CONNECTION(client_ctx, conn, result);
+    return result;
+}
+
+static int send_commit(FSClientContext *client_ctx,
+        FSClientCommitConnArray *carray,
+        const FSClientClusterStatEntry *stat)
+{
+    ConnectionInfo target;
+    ConnectionInfo *conn;
+    int result;
+
+    memset(&target, 0, sizeof(target));
+    conn_pool_set_server_info(&target, stat->ip_addr, stat->port);
+    if (commit_conn_exists(carray, &target)) {
+        return 0;
+    }
+
+    if ((conn=client_ctx->conn_manager.get_spec_connection(
+                    client_ctx, &target, &result)) == NULL)
+    {
+        return SF_UNIX_ERRNO(result, EIO);
+    }
+
+    if ((result=fs_client_proto_send_commit(client_ctx, conn)) != 0) {
+        SF_CLIENT_RELEASE_CONNECTION(client_ctx, conn, result);
+        return result;
+    }
+
+    carray->conns[carray->count++] = conn;
+    if (carray->count == FS_CLIENT_COMMIT_MAX_CONNECTIONS) {
+        return recv_commit_responses(client_ctx, carray);
+    }
+    return 0;
+}
+
+static int commit_data_groups(FSClientContext *client_ctx,
+        const char *group_flags, const int group_count)
+{
+    FSClientCommitConnArray carray;
+    FSClientClusterStatEntry stats[FS_MAX_GROUP_SERVERS];
+    FSClientClusterStatEntryArray cs_array;
+    FSClientClusterStatEntry *stat;
+    FSClientClusterStatEntry *end;
+    int group_index;
+    int result;
+    int current;
+
+    result = 0;
+    carray.count = 0;
+    cs_array.stats = stats;
+    cs_array.size = FS_MAX_GROUP_SERVERS;
+    for (group_index=0; group_index<group_count; group_index++) {
+        if (!group_flags[group_index]) {
+            continue;
+        }
+
+        if ((result=get_active_servers(client_ctx, group_index,
+                        &cs_array)) != 0)
+        {
+            break;
+        }
+
+        end = stats + cs_array.count;
+        for (stat=stats; stat<end; stat++) {
+            if ((result=send_commit(client_ctx, &carray, stat)) != 0) {
+                break;
+            }
+        }
+        if (result != 0) {
+            break;
+        }
+    }
+
+    if (carray.count > 0) {
+        current = recv_commit_responses(client_ctx, &carray);
+        if (result == 0) {
+            result = current;
+        }
+    }
+
+    return SF_UNIX_ERRNO(result, EIO);
+}
+
+int fs_client_commit(FSClientContext *client_ctx, const int64_t oid,
+        const int64_t file_size)
+{
+#define FIXED_GROUP_FLAGS_SIZE  1024
+    char fixed_flags[FIXED_GROUP_FLAGS_SIZE];
+    char *group_flags;
+    FSBlockKey bkey;
+    int64_t remain;
+    int data_group_count;
+    int group_index;
+    int found_count;
+    int result;
+
+    if (file_size <= 0) {
+        return 0;
+    }
+
+    data_group_count = FS_DATA_GROUP_COUNT(*client_ctx->cluster_cfg.ptr);
+    if (data_group_count <= FIXED_GROUP_FLAGS_SIZE) {
+        group_flags = fixed_flags;
+    } else {
+        group_flags = (char *)fc_malloc(data_group_count);
+        if (group_flags == NULL) {
+            return ENOMEM;
+        }
+    }
+    memset(group_flags, 0, data_group_count);
+
+    /* the data groups of the file blocks */
+    found_count = 0;
+    remain = file_size;
+    fs_set_block_key(&bkey, oid, 0);
+    while (1) {
+        group_index = FS_CLIENT_DATA_GROUP_INDEX(client_ctx, bkey.hash_code);
+        if (!group_flags[group_index]) {
+            group_flags[group_index] = 1;
+            if (++found_count == data_group_count) {
+                break;
+            }
+        }
+
+        remain -= FS_FILE_BLOCK_SIZE;
+        if (remain <= 0) {
+            break;
+        }
+
+        fs_next_block_key(&bkey);
+    }
+
+    result = commit_data_groups(client_ctx, group_flags, data_group_count);
+    if (group_flags != fixed_flags) {
+        free(group_flags);
+    }
+
+    return result;
+}
+
 static int stat_data_group_by_addresses(FSClientContext *client_ctx,
         const FSClusterStatFilter *filter, FCAddressPtrArray *addr_ptr_array,
         FSIdArray *gid_array, FSClientClusterStatEntryArray *cs_array)
@@ -385,6 +603,129 @@ int fs_client_slice_write(FSClientContext *client_ctx,
     return SF_UNIX_ERRNO(result, EIO);
 }
 
+static int wait_slice_read_response(FSClientContext *client_ctx,
+        ConnectionInfo *conn, FSClientServerStats *stats,
+        const int64_t start_time_us, const int resp_cmd,
+        const FSBlockSliceKeyInfo *bs_key, char *buff, int *read_bytes)
+{
+    int result;
+
+    result = fs_client_proto_slice_read_recv(client_ctx, conn,
+            resp_cmd, bs_key, buff, read_bytes);
+    fs_client_read_stats_end(stats, get_current_time_us() -
+            start_time_us, result);
+    return result;
+}
+
+/* send the request to another replica when the response of the first
+ * one is not returned within the p95 latency, use the faster response
+ * and close the connection of the slower one */
+static int hedged_slice_read(FSClientContext *client_ctx,
+        ConnectionInfo **conn, FSClientServerStats *stats,
+        const int64_t delay_us, const int req_cmd, const int resp_cmd,
+        const FSBlockSliceKeyInfo *bs_key, char *buff, int *read_bytes)
+{
+    struct pollfd pfds[2];
+    ConnectionInfo *conns[2];
+    FSClientServerStats *stats_pair[2];
+    int64_t start_times[2];
+    int winner;
+    int loser;
+    int count;
+    int result;
+
+    start_times[0] = get_current_time_us();
+    if ((result=fs_client_proto_slice_read_send(client_ctx,
+                    *conn, req_cmd, bs_key)) != 0)
+    {
+        fs_client_read_stats_end(stats, -1, result);
+        return result;
+    }
+
+    pfds[0].fd = (*conn)->sock;
+    pfds[0].events = POLLIN;
+    pfds[0].revents = 0;
+    if (poll(pfds, 1, (delay_us + 999) / 1000) != 0) {
+        return wait_slice_read_response(client_ctx, *conn, stats,
+                start_times[0], resp_cmd, bs_key, buff, read_bytes);
+    }
+
+    conns[0] = *conn;
+    if ((conns[1]=client_ctx->conn_manager.get_other_readable_connection(
+                    client_ctx, FS_CLIENT_DATA_GROUP_INDEX(client_ctx,
+                        bs_key->block.hash_code), stats->server_id,
+                    &result)) == NULL)
+    {
+        return wait_slice_read_response(client_ctx, *conn, stats,
+                start_times[0], resp_cmd, bs_key, buff, read_bytes);
+    }
+
+    stats_pair[0] = stats;
+    stats_pair[1] = fs_client_read_stats_begin(client_ctx, conns[1]);
+    start_times[1] = get_current_time_us();
+    if ((result=fs_client_proto_slice_read_send(client_ctx,
+                    conns[1], req_cmd, bs_key)) != 0)
+    {
+        fs_client_read_stats_end(stats_pair[1], -1, result);
+        SF_CLIENT_RELEASE_CONNECTION(client_ctx, conns[1], result);
+        return wait_slice_read_response(client_ctx, *conn, stats,
+                start_times[0], resp_cmd, bs_key, buff, read_bytes);
+    }
+
+    pfds[1].fd = conns[1]->sock;
+    pfds[1].events = POLLIN;
+    pfds[1].revents = 0;
+    count = poll(pfds, 2, client_ctx->network_timeout * 1000);
+    winner = (count > 0 && pfds[0].revents == 0) ? 1 : 0;
+    loser = 1 - winner;
+
+    result = wait_slice_read_response(client_ctx, conns[winner],
+            stats_pair[winner], start_times[winner], resp_cmd,
+            bs_key, buff, read_bytes);
+
+    /* the elapsed time of the slower one as a penalty sample */
+    fs_client_read_stats_end(stats_pair[loser], get_current_time_us() -
+            start_times[loser], 0);
+    client_ctx->conn_manager.close_connection(client_ctx, conns[loser]);
+    *conn = conns[winner];
+    return result;
+}
+
+static int do_slice_read(FSClientContext *client_ctx,
+        ConnectionInfo **conn, const int slave_id, const int req_cmd,
+        const int resp_cmd, const FSBlockSliceKeyInfo *bs_key,
+        char *buff, int *read_bytes)
+{
+    FSClientServerStats *stats;
+    int64_t start_time_us;
+    int64_t delay_us;
+    bool sampled;
+    int result;
+
+    if ((stats=fs_client_read_stats_begin(client_ctx, *conn)) == NULL) {
+        return fs_client_proto_slice_read_ex(client_ctx, *conn, slave_id,
+                req_cmd, resp_cmd, bs_key, buff, read_bytes);
+    }
+
+    /* the large slice is read by multiple requests */
+    sampled = bs_key->slice.length <= client_ctx->conn_manager.
+        get_connection_params(client_ctx, *conn)->buffer_size;
+    if (sampled && slave_id == 0 && client_ctx->read_balance.hedged_read &&
+            client_ctx->conn_manager.get_other_readable_connection != NULL &&
+            (delay_us=fs_client_hedged_read_delay_us(stats)) > 0)
+    {
+        return hedged_slice_read(client_ctx, conn, stats, delay_us,
+                req_cmd, resp_cmd, bs_key, buff, read_bytes);
+    }
+
+    start_time_us = get_current_time_us();
+    result = fs_client_proto_slice_read_ex(client_ctx, *conn, slave_id,
+            req_cmd, resp_cmd, bs_key, buff, read_bytes);
+    fs_client_read_stats_end(stats, sampled ? get_current_time_us() -
+            start_time_us : -1, result);
+    return result;
+}
+
 int fs_client_slice_read_ex(FSClientContext *client_ctx,
         const int slave_id, const int req_cmd, const int resp_cmd,
         const FSBlockSliceKeyInfo *bs_key, char *buff, int *read_bytes)
@@ -413,8 +754,8 @@ int fs_client_slice_read_ex(FSClientContext *client_ctx,
     remain = bs_key->slice.length;
     i = 0;
     while (remain > 0) {
-        if ((result=fs_client_proto_slice_read_ex(client_ctx, conn,
-                        slave_id, req_cmd, resp_cmd, &new_key,
+        if ((result=do_slice_read(client_ctx, &conn, slave_id,
+                        req_cmd, resp_cmd, &new_key,
                         buff + *read_bytes, &bytes)) == 0)
         {
             *read_bytes += bytes;
@@ -471,6 +812,18 @@ int fs_client_slice_read_ex(FSClientContext *client_ctx,
     client_ctx->conn_manager.get_leader_connection(client_ctx, \
             arg1, result)
 
+#define GET_READABLE_CONNECTION(client_ctx, arg1, result)        \
+    client_ctx->conn_manager.get_readable_connection(client_ctx, \
+            arg1, result)
+
+int fs_client_slice_seek(FSClientContext *client_ctx,
+        const FSBlockSliceKeyInfo *bs_key, const int whence, int *offset)
+{
+    SF_CLIENT_IDEMPOTENCY_QUERY_WRAPPER(client_ctx, GET_READABLE_CONNECTION,
+            FS_CLIENT_DATA_GROUP_INDEX(client_ctx, bs_key->block.hash_code),
+            fs_client_proto_slice_seek, bs_key, whence, offset);
+}
+
 int fs_client_bs_operate(FSClientContext *client_ctx,
         const void *key, const uint32_t hash_code,
         const int req_cmd, const int resp_cmd,
@@ -484,6 +837,19 @@ int fs_client_bs_operate(FSClientContext *client_ctx,
             enoent_log_level, inc_alloc);
 }
 
+int fs_client_slice_clone(FSClientContext *client_ctx,
+        const FSBlockSliceKeyInfo *src_bs_key,
+        const FSBlockSliceKeyInfo *dest_bs_key, int *inc_alloc)
+{
+    const FSConnectionParameters *connection_params;
+
+    SF_CLIENT_IDEMPOTENCY_UPDATE_WRAPPER(client_ctx, GET_MASTER_CONNECTION,
+            FS_CLIENT_DATA_GROUP_INDEX(client_ctx,
+                dest_bs_key->block.hash_code),
+            fs_client_proto_slice_clone, src_bs_key,
+            dest_bs_key, inc_alloc);
+}
+
 int fs_client_server_group_space_stat(FSClientContext *client_ctx,
         FCServerInfo *server, FSClientServerSpaceStat *stats,
         const int size, int *count)
@@ -78,6 +78,12 @@ static inline void fs_next_block_slice_key(FSBlockSliceKeyInfo *bs_key,
 int fs_unlink_file(FSClientContext *client_ctx, const int64_t oid,
         const int64_t file_size);
 
+/* persist the written data of the file: all active servers (the master
+ * and the slaves) of the data groups which the file blocks belong to
+ * fdatasync the dirty trunk files and the slice binlog before respond */
+int fs_client_commit(FSClientContext *client_ctx, const int64_t oid,
+        const int64_t file_size);
+
 int fs_cluster_stat(FSClientContext *client_ctx, const ConnectionInfo
         *spec_conn, const FSClusterStatFilter *filter,
         FSClientClusterStatEntry *stats, const int size, int *count);
@@ -90,11 +96,22 @@ int fs_client_slice_read_ex(FSClientContext *client_ctx,
         const int slave_id, const int req_cmd, const int resp_cmd,
         const FSBlockSliceKeyInfo *bs_key, char *buff, int *read_bytes);
 
+/* find the first data (SEEK_DATA) or hole (SEEK_HOLE) offset in the block
+ * slice by the object block index, return ENXIO when not found */
+int fs_client_slice_seek(FSClientContext *client_ctx,
+        const FSBlockSliceKeyInfo *bs_key, const int whence, int *offset);
+
 int fs_client_bs_operate(FSClientContext *client_ctx,
         const void *key, const uint32_t hash_code,
         const int req_cmd, const int resp_cmd,
         const int enoent_log_level, int *inc_alloc);
 
+/* the dest slice shares the space of the src slice without data copy,
+ * return EXDEV when the src and dest blocks in different data groups */
+int fs_client_slice_clone(FSClientContext *client_ctx,
+        const FSBlockSliceKeyInfo *src_bs_key,
+        const FSBlockSliceKeyInfo *dest_bs_key, int *inc_alloc);
+
 #define fs_client_slice_allocate_ex(client_ctx, bs_key, \
         enoent_log_level, inc_alloc) \
     fs_client_bs_operate(client_ctx, bs_key,       \
@@ -107,6 +124,13 @@ int fs_client_bs_operate(FSClientContext *client_ctx,
     fs_client_slice_read_ex(client_ctx, 0, FS_SERVICE_PROTO_SLICE_READ_REQ, \
             FS_SERVICE_PROTO_SLICE_READ_RESP, bs_key, buff, read_bytes)
 
+/* the holes are NOT transferred, the buffer content is same as slice read */
+#define fs_client_slice_sparse_read(client_ctx, bs_key, buff, read_bytes) \
+    fs_client_slice_read_ex(client_ctx, 0,     \
+            FS_SERVICE_PROTO_SLICE_SPARSE_READ_REQ,  \
+            FS_SERVICE_PROTO_SLICE_SPARSE_READ_RESP, \
+            bs_key, buff, read_bytes)
+
 #define fs_client_slice_read_by_slave(client_ctx, \
         slave_id, bs_key, buff, read_bytes) \
     fs_client_slice_read_ex(client_ctx, slave_id, \
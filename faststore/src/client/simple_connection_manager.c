@@ -23,6 +23,10 @@
 #include "client_proto.h"
 #include "simple_connection_manager.h"
 
+#define READABLE_CACHE_TTL          3  //seconds
+#define READ_FAIL_SUSPEND_TIME     10  //seconds
+#define READ_PROBE_INTERVAL        64  //probe one of every N reads
+
 static ConnectionInfo *get_spec_connection(FSClientContext *client_ctx,
         const ConnectionInfo *target, int *err_no)
 {
@@ -205,6 +209,246 @@ static ConnectionInfo *get_master_connection(FSClientContext *client_ctx,
     return NULL;
 }
 
+#define CM_READABLE_CACHE(client_ctx, data_group_index) \
+    (client_ctx->conn_manager.data_group_array.entries[data_group_index]. \
+     readable_cache)
+
+static inline FSClientServerStats *get_server_stats(
+        FSClientContext *client_ctx, const int server_id)
+{
+    FCServerInfo *server;
+
+    if ((server=fc_server_get_by_id(&client_ctx->cluster_cfg.ptr->
+                    server_cfg, server_id)) == NULL)
+    {
+        return NULL;
+    }
+    return client_ctx->conn_manager.server_stats_array.stats + (server -
+            FC_SID_SERVERS(client_ctx->cluster_cfg.ptr->server_cfg));
+}
+
+/* load the active servers of the data group by cluster stat */
+static int load_readable_servers(FSClientContext *client_ctx,
+        const int data_group_index)
+{
+    FCServerInfoPtrArray *server_ptr_array;
+    FCAddressPtrArray *addr_array;
+    FSClusterStatFilter filter;
+    FSIdArray gid_array;
+    FSClientClusterStatEntry stats[FS_MAX_GROUP_SERVERS];
+    FSClientClusterStatEntryArray cs_array;
+    FSClientClusterStatEntry *stat;
+    FSClientClusterStatEntry *end;
+    FSClientReadableServer *rs;
+    FSClientServerStats *server_stats;
+    int data_group_id;
+    int result;
+    int i;
+
+    server_ptr_array = &client_ctx->cluster_cfg.ptr->data_groups.mappings
+        [data_group_index].server_group->server_array;
+    filter.filter_by = FS_CLUSTER_STAT_FILTER_BY_GROUP |
+        FS_CLUSTER_STAT_FILTER_BY_STATUS;
+    filter.op_type = '=';
+    filter.status = FS_DS_STATUS_ACTIVE;
+    filter.is_master = 0;
+    filter.data_group_id = data_group_index + 1;
+    gid_array.alloc = 1;
+    gid_array.ids = &data_group_id;
+    cs_array.stats = stats;
+    cs_array.size = FS_MAX_GROUP_SERVERS;
+
+    result = ENOENT;
+    for (i=0; i<server_ptr_array->count; i++) {
+        addr_array = &FS_CFG_SERVICE_ADDRESS_ARRAY(client_ctx,
+                server_ptr_array->servers[i]);
+        if ((result=fs_client_proto_cluster_stat(client_ctx, &addr_array->
+                        addrs[addr_array->index]->conn, &filter,
+                        &gid_array, &cs_array)) == 0)
+        {
+            break;
+        }
+    }
+    if (result != 0) {
+        return result;
+    }
+
+    PTHREAD_MUTEX_LOCK(&CM_READABLE_CACHE(client_ctx,
+                data_group_index).lock);
+    rs = CM_READABLE_CACHE(client_ctx, data_group_index).servers;
+    end = stats + FC_MIN(cs_array.count, server_ptr_array->count);
+    for (stat=stats; stat<end; stat++) {
+        if ((server_stats=get_server_stats(client_ctx,
+                        stat->server_id)) == NULL)
+        {
+            continue;
+        }
+
+        rs->stats = server_stats;
+        rs->is_master = stat->is_master;
+        conn_pool_set_server_info(&rs->conn, stat->ip_addr, stat->port);
+        rs++;
+    }
+    CM_READABLE_CACHE(client_ctx, data_group_index).count = rs -
+        CM_READABLE_CACHE(client_ctx, data_group_index).servers;
+    PTHREAD_MUTEX_UNLOCK(&CM_READABLE_CACHE(client_ctx,
+                data_group_index).lock);
+    return 0;
+}
+
+static inline int64_t calc_server_score(FSClientServerStats *stats,
+        const int current_time)
+{
+    int64_t score;
+
+    /* the unsampled server first for probe */
+    score = stats->srtt_us * (FC_ATOMIC_GET(stats->inflight) + 1);
+    if (current_time - stats->fail_time < READ_FAIL_SUSPEND_TIME) {
+        score += INT64_MAX / 2;
+    }
+    return score;
+}
+
+/* select the server with the min latency * (inflight + 1),
+ * the other server is selected randomly for probe periodically */
+static FSClientReadableServer *select_readable_server(
+        FSClientContext *client_ctx, const int data_group_index,
+        const int exclude_server_id)
+{
+    FSClientReadableServer *candidates[FS_MAX_GROUP_SERVERS];
+    FSClientReadableServer *rs;
+    FSClientReadableServer *end;
+    FSClientReadableServer *selected;
+    int64_t score;
+    int64_t min_score;
+    int current_time;
+    int count;
+    int slave_count;
+    int start;
+    int i;
+
+    count = slave_count = 0;
+    end = CM_READABLE_CACHE(client_ctx, data_group_index).servers +
+        CM_READABLE_CACHE(client_ctx, data_group_index).count;
+    for (rs=CM_READABLE_CACHE(client_ctx, data_group_index).servers;
+            rs<end; rs++)
+    {
+        if (rs->stats->server_id == exclude_server_id) {
+            continue;
+        }
+        if (!rs->is_master) {
+            slave_count++;
+        }
+        candidates[count++] = rs;
+    }
+
+    if (client_ctx->read_rule == sf_data_read_rule_slave_first &&
+            slave_count > 0 && slave_count < count)
+    {
+        for (i=0, count=0; count<slave_count; i++) {
+            if (!candidates[i]->is_master) {
+                candidates[count++] = candidates[i];
+            }
+        }
+    }
+
+    if (count == 0) {
+        return NULL;
+    } else if (count == 1) {
+        return candidates[0];
+    }
+
+    current_time = get_current_time();
+    start = rand() % count;
+    if (__sync_add_and_fetch(&CM_READABLE_CACHE(client_ctx,
+                    data_group_index).counter, 1) %
+            READ_PROBE_INTERVAL == 0)
+    {
+        selected = candidates[start];
+        if (current_time - selected->stats->fail_time >=
+                READ_FAIL_SUSPEND_TIME)
+        {
+            return selected;
+        }
+    }
+
+    selected = NULL;
+    min_score = INT64_MAX;
+    for (i=0; i<count; i++) {
+        rs = candidates[(start + i) % count];
+        if ((score=calc_server_score(rs->stats, current_time)) < min_score) {
+            min_score = score;
+            selected = rs;
+        }
+    }
+
+    return selected;
+}
+
+static ConnectionInfo *get_fastest_readable_connection(
+        FSClientContext *client_ctx, const int data_group_index,
+        const int exclude_server_id, int *err_no)
+{
+    FSClientReadableServer *rs;
+    FSClientServerStats *stats;
+    ConnectionInfo target;
+    ConnectionInfo *conn;
+    int expire_time;
+    int current_time;
+
+    current_time = get_current_time();
+    expire_time = FC_ATOMIC_GET(CM_READABLE_CACHE(client_ctx,
+                data_group_index).expire_time);
+    if (current_time >= expire_time && __sync_bool_compare_and_swap(
+                &CM_READABLE_CACHE(client_ctx, data_group_index).
+                expire_time, expire_time, current_time +
+                READABLE_CACHE_TTL))
+    {
+        if ((*err_no=load_readable_servers(client_ctx,
+                        data_group_index)) != 0)
+        {
+            __sync_bool_compare_and_swap(&CM_READABLE_CACHE(client_ctx,
+                        data_group_index).expire_time, current_time +
+                    READABLE_CACHE_TTL, 0);
+            return NULL;
+        }
+    }
+
+    PTHREAD_MUTEX_LOCK(&CM_READABLE_CACHE(client_ctx,
+                data_group_index).lock);
+    if ((rs=select_readable_server(client_ctx, data_group_index,
+                    exclude_server_id)) != NULL)
+    {
+        target = rs->conn;
+        stats = rs->stats;
+    } else {
+        stats = NULL;
+    }
+    PTHREAD_MUTEX_UNLOCK(&CM_READABLE_CACHE(client_ctx,
+                data_group_index).lock);
+
+    if (stats == NULL) {
+        *err_no = SF_RETRIABLE_ERROR_NO_SERVER;
+        return NULL;
+    }
+
+    if ((conn=get_spec_connection(client_ctx, &target, err_no)) == NULL) {
+        stats->fail_time = get_current_time();
+        return NULL;
+    }
+
+    ((FSConnectionParameters *)conn->args)->stats = stats;
+    return conn;
+}
+
+static ConnectionInfo *get_other_readable_connection(
+        FSClientContext *client_ctx, const int data_group_index,
+        const int exclude_server_id, int *err_no)
+{
+    return get_fastest_readable_connection(client_ctx,
+            data_group_index, exclude_server_id, err_no);
+}
+
 static ConnectionInfo *get_readable_connection(FSClientContext *client_ctx,
         const int data_group_index, int *err_no)
 {
@@ -213,6 +457,14 @@ static ConnectionInfo *get_readable_connection(FSClientContext *client_ctx,
     SFNetRetryIntervalContext net_retry_ctx;
     int i;
 
+    if (client_ctx->read_balance.latency_aware) {
+        if ((conn=get_fastest_readable_connection(client_ctx,
+                        data_group_index, 0, err_no)) != NULL)
+        {
+            return conn;
+        }
+    }
+
     sf_init_net_retry_interval_context(&net_retry_ctx,
             &client_ctx->net_retry_cfg.interval_mm,
             &client_ctx->net_retry_cfg.connect);
@@ -345,6 +597,7 @@ static int connect_done_callback(ConnectionInfo *conn, void *args)
     int result;
 
     params = (FSConnectionParameters *)conn->args;
+    params->stats = NULL;
     if (((FSClientContext *)args)->idempotency_enabled) {
         params->channel = idempotency_client_channel_get(conn->ip_addr,
                 conn->port, ((FSClientContext *)args)->connect_timeout,
@@ -402,11 +655,48 @@ static int init_data_group_array(FSClientContext *client_ctx,
             return result;
         }
         entry->master_cache.conn = &entry->master_cache.holder;
+
+        if (!client_ctx->read_balance.latency_aware) {
+            continue;
+        }
+        if ((result=init_pthread_lock(&(entry->readable_cache.lock))) != 0) {
+            return result;
+        }
+        entry->readable_cache.servers = (FSClientReadableServer *)
+            fc_malloc(sizeof(FSClientReadableServer) * client_ctx->
+                    cluster_cfg.ptr->data_groups.mappings[entry -
+                    data_group_array->entries].server_group->
+                    server_array.count);
+        if (entry->readable_cache.servers == NULL) {
+            return ENOMEM;
+        }
     }
 
     return 0;
 }
 
+static int init_server_stats_array(FSClientContext *client_ctx,
+        FSClientServerStatsArray *stats_array)
+{
+    int bytes;
+    int i;
+
+    stats_array->count = FC_SID_SERVER_COUNT(client_ctx->
+            cluster_cfg.ptr->server_cfg);
+    bytes = sizeof(FSClientServerStats) * stats_array->count;
+    stats_array->stats = (FSClientServerStats *)fc_malloc(bytes);
+    if (stats_array->stats == NULL) {
+        return ENOMEM;
+    }
+    memset(stats_array->stats, 0, bytes);
+
+    for (i=0; i<stats_array->count; i++) {
+        stats_array->stats[i].server_id = FC_SID_SERVERS(client_ctx->
+                cluster_cfg.ptr->server_cfg)[i].id;
+    }
+    return 0;
+}
+
 int fs_simple_connection_manager_init_ex(FSClientContext *client_ctx,
         FSConnectionManager *conn_manager, const int max_count_per_entry,
         const int max_idle_time)
@@ -422,6 +712,12 @@ int fs_simple_connection_manager_init_ex(FSClientContext *client_ctx,
         return result;
     }
 
+    if ((result=init_server_stats_array(client_ctx, &conn_manager->
+                    server_stats_array)) != 0)
+    {
+        return result;
+    }
+
     cp = (ConnectionPool *)fc_malloc(sizeof(ConnectionPool));
     if (cp == NULL) {
         return ENOMEM;
@@ -447,6 +743,8 @@ int fs_simple_connection_manager_init_ex(FSClientContext *client_ctx,
     conn_manager->get_spec_connection = get_spec_connection;
     conn_manager->get_master_connection = get_master_connection;
     conn_manager->get_readable_connection = get_readable_connection;
+    conn_manager->get_other_readable_connection =
+        get_other_readable_connection;
     conn_manager->get_leader_connection = get_leader_connection;
     conn_manager->release_connection = release_connection;
     conn_manager->close_connection = close_connection;
@@ -0,0 +1,465 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//fs_bench.c
+
+/* the slice read / write load generator.
+ *
+ * closed-loop mode (the default): every thread issues the next request
+ * after the response of the previous one.
+ * open-loop mode (-R rate > 0): the requests are scheduled at the fixed
+ * rate, and the latency is measured from the scheduled time instead of
+ * the sending time, so the queueing delay of a slow server is counted */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/fc_memory.h"
+#include "sf/sf_metrics.h"
+#include "faststore/client/fs_client.h"
+
+#define FS_BENCH_OP_READ   0
+#define FS_BENCH_OP_WRITE  1
+#define FS_BENCH_OP_COUNT  2
+
+typedef struct {
+    int index;
+    unsigned int seed;
+    pthread_t tid;
+    int64_t op_count;   //the max op count, 0 for by duration
+    int64_t errors[FS_BENCH_OP_COUNT];
+    int64_t misses;     //read the slice which not exist
+    SFHistogram *histograms;
+    char *buff;
+} FSBenchThread;
+
+static struct {
+    int thread_count;
+    int block_size;
+    int read_percent;
+    int64_t total_ops;
+    int duration;
+    int64_t rate;  //the total request rate per second, 0 for closed-loop
+    int64_t oid_start;
+    int file_count;
+    int64_t file_size;
+    int slots_per_file;
+    bool prefill;
+    int64_t start_time_us;
+    int64_t end_time_us;
+    FSBenchThread *threads;
+} bench_ctx;
+
+static const char *op_captions[FS_BENCH_OP_COUNT] = {"read", "write"};
+
+static void usage(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [-c config_filename] [-t threads=16] "
+            "[-b block_size=4096] [-r read_percent=70] "
+            "[-n total_ops] [-d duration_seconds=10] "
+            "[-R total_rate=0 for closed-loop] [-i start_oid=1000000] "
+            "[-f file_count=16] [-s file_size=64MB] [-P prefill]\n",
+            argv[0]);
+}
+
+static void bench_random_bs_key(FSBenchThread *thread,
+        FSBlockSliceKeyInfo *bs_key)
+{
+    int64_t slot;
+    int64_t offset;
+
+    slot = rand_r(&thread->seed) % bench_ctx.slots_per_file;
+    offset = slot * bench_ctx.block_size;
+    bs_key->block.oid = bench_ctx.oid_start +
+        rand_r(&thread->seed) % bench_ctx.file_count;
+    bs_key->block.offset = FS_FILE_BLOCK_ALIGN(offset);
+    bs_key->slice.offset = offset - bs_key->block.offset;
+    bs_key->slice.length = bench_ctx.block_size;
+    fs_calc_block_hashcode(&bs_key->block);
+}
+
+static int bench_do_op(FSBenchThread *thread, const int op)
+{
+    FSBlockSliceKeyInfo bs_key;
+    int bytes;
+    int inc_alloc;
+    int result;
+
+    bench_random_bs_key(thread, &bs_key);
+    if (op == FS_BENCH_OP_WRITE) {
+        result = fs_client_slice_write(&g_fs_client_vars.client_ctx,
+                &bs_key, thread->buff, &bytes, &inc_alloc);
+    } else {
+        result = fs_client_slice_read(&g_fs_client_vars.client_ctx,
+                &bs_key, thread->buff, &bytes);
+        if (result == ENOENT || result == ENODATA) {
+            thread->misses++;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static int bench_prefill(FSBenchThread *thread)
+{
+    FSBlockSliceKeyInfo bs_key;
+    int64_t slot;
+    int64_t offset;
+    int file_index;
+    int bytes;
+    int inc_alloc;
+    int result;
+
+    //the files are divided by the threads
+    for (file_index=thread->index; file_index<bench_ctx.file_count;
+            file_index+=bench_ctx.thread_count)
+    {
+        bs_key.block.oid = bench_ctx.oid_start + file_index;
+        for (slot=0; slot<bench_ctx.slots_per_file; slot++) {
+            offset = slot * bench_ctx.block_size;
+            bs_key.block.offset = FS_FILE_BLOCK_ALIGN(offset);
+            bs_key.slice.offset = offset - bs_key.block.offset;
+            bs_key.slice.length = bench_ctx.block_size;
+            fs_calc_block_hashcode(&bs_key.block);
+            if ((result=fs_client_slice_write(&g_fs_client_vars.client_ctx,
+                            &bs_key, thread->buff, &bytes,
+                            &inc_alloc)) != 0)
+            {
+                return result;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void *bench_thread_func(void *arg)
+{
+    FSBenchThread *thread;
+    int64_t interval_us;
+    int64_t scheduled_time_us;
+    int64_t begin_time_us;
+    int64_t current_time_us;
+    int64_t count;
+    int op;
+
+    thread = (FSBenchThread *)arg;
+    if (bench_ctx.rate > 0) {
+        interval_us = (1000000LL * bench_ctx.thread_count) / bench_ctx.rate;
+    } else {
+        interval_us = 0;
+    }
+
+    //spread the first requests of the threads in the open-loop mode
+    scheduled_time_us = bench_ctx.start_time_us + (interval_us *
+            thread->index) / bench_ctx.thread_count;
+    for (count=0; thread->op_count == 0 || count < thread->op_count;
+            count++)
+    {
+        current_time_us = get_current_time_us();
+        if (thread->op_count == 0 && current_time_us >=
+                bench_ctx.end_time_us)
+        {
+            break;
+        }
+
+        if (interval_us > 0) {
+            if (scheduled_time_us > current_time_us) {
+                usleep(scheduled_time_us - current_time_us);
+            }
+            begin_time_us = scheduled_time_us;
+            scheduled_time_us += interval_us;
+        } else {
+            begin_time_us = current_time_us;
+        }
+
+        op = (rand_r(&thread->seed) % 100 < bench_ctx.read_percent) ?
+            FS_BENCH_OP_READ : FS_BENCH_OP_WRITE;
+        if (bench_do_op(thread, op) != 0) {
+            thread->errors[op]++;
+            continue;
+        }
+        sf_histogram_add(thread->histograms + op,
+                get_current_time_us() - begin_time_us);
+    }
+
+    return NULL;
+}
+
+static int bench_init_threads()
+{
+    FSBenchThread *thread;
+    FSBenchThread *end;
+    int bytes;
+
+    bytes = sizeof(FSBenchThread) * bench_ctx.thread_count;
+    if ((bench_ctx.threads=(FSBenchThread *)fc_malloc(bytes)) == NULL) {
+        return ENOMEM;
+    }
+    memset(bench_ctx.threads, 0, bytes);
+
+    end = bench_ctx.threads + bench_ctx.thread_count;
+    for (thread=bench_ctx.threads; thread<end; thread++) {
+        thread->index = thread - bench_ctx.threads;
+        thread->seed = getpid() ^ (thread->index * 7919) ^ time(NULL);
+        if (bench_ctx.total_ops > 0) {
+            thread->op_count = bench_ctx.total_ops / bench_ctx.thread_count;
+            if (thread->index < bench_ctx.total_ops %
+                    bench_ctx.thread_count)
+            {
+                thread->op_count++;
+            }
+            if (thread->op_count == 0) {
+                thread->op_count = -1;  //nothing to do
+            }
+        }
+
+        thread->histograms = (SFHistogram *)fc_calloc(
+                FS_BENCH_OP_COUNT, sizeof(SFHistogram));
+        if (thread->histograms == NULL) {
+            return ENOMEM;
+        }
+        if ((thread->buff=(char *)fc_malloc(bench_ctx.block_size)) == NULL) {
+            return ENOMEM;
+        }
+        memset(thread->buff, 'a' + thread->index % 26, bench_ctx.block_size);
+    }
+
+    return 0;
+}
+
+static int bench_run_threads(void *(*thread_func)(void *arg))
+{
+    FSBenchThread *thread;
+    FSBenchThread *end;
+    int result;
+
+    end = bench_ctx.threads + bench_ctx.thread_count;
+    for (thread=bench_ctx.threads; thread<end; thread++) {
+        if ((result=pthread_create(&thread->tid, NULL,
+                        thread_func, thread)) != 0)
+        {
+            logError("file: "__FILE__", line: %d, "
+                    "create thread fail, errno: %d, error info: %s",
+                    __LINE__, result, STRERROR(result));
+            bench_ctx.thread_count = thread - bench_ctx.threads;
+            end = thread;
+            break;
+        }
+    }
+
+    for (thread=bench_ctx.threads; thread<end; thread++) {
+        pthread_join(thread->tid, NULL);
+    }
+    return (end == bench_ctx.threads) ? EAGAIN : 0;
+}
+
+static void *prefill_thread_func(void *arg)
+{
+    FSBenchThread *thread;
+    int result;
+
+    thread = (FSBenchThread *)arg;
+    if ((result=bench_prefill(thread)) != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "thread #%d prefill fail, errno: %d, error info: %s",
+                __LINE__, thread->index, result, STRERROR(result));
+    }
+    return NULL;
+}
+
+static void bench_output(const int64_t time_used_us)
+{
+    SFHistogram *histogram;
+    SFMetricsSummary summary;
+    FSBenchThread *thread;
+    FSBenchThread *end;
+    int64_t errors;
+    int64_t misses;
+    double seconds;
+    int op;
+
+    if ((histogram=(SFHistogram *)fc_malloc(sizeof(SFHistogram))) == NULL) {
+        return;
+    }
+
+    seconds = time_used_us > 0 ? time_used_us / 1000000.00 : 1.00;
+    printf("mode: %s, threads: %d, block size: %d, read percent: %d%%, "
+            "time used: %.3f s\n\n", bench_ctx.rate > 0 ? "open-loop" :
+            "closed-loop", bench_ctx.thread_count, bench_ctx.block_size,
+            bench_ctx.read_percent, seconds);
+    printf("%-6s %10s %10s %10s %10s %10s %10s %10s %10s %8s\n",
+            "op", "count", "ops/s", "MB/s", "avg(us)", "p50(us)",
+            "p99(us)", "p999(us)", "max(us)", "errors");
+
+    end = bench_ctx.threads + bench_ctx.thread_count;
+    misses = 0;
+    for (op=0; op<FS_BENCH_OP_COUNT; op++) {
+        memset(histogram, 0, sizeof(SFHistogram));
+        errors = 0;
+        for (thread=bench_ctx.threads; thread<end; thread++) {
+            sf_histogram_merge(histogram, thread->histograms + op);
+            errors += thread->errors[op];
+            if (op == FS_BENCH_OP_READ) {
+                misses += thread->misses;
+            }
+        }
+
+        sf_histogram_summary(histogram, &summary);
+        printf("%-6s %10"PRId64" %10.0f %10.2f %10"PRId64" %10"PRId64
+                " %10"PRId64" %10"PRId64" %10"PRId64" %8"PRId64"\n",
+                op_captions[op], summary.count, summary.count / seconds,
+                (double)summary.count * bench_ctx.block_size /
+                (seconds * 1024 * 1024), summary.count > 0 ?
+                summary.sum / summary.count : 0, summary.p50,
+                summary.p99, summary.p999, summary.max, errors);
+    }
+
+    if (misses > 0) {
+        printf("\nread %"PRId64" slices which not exist, "
+                "use -P to prefill the files\n", misses);
+    }
+    free(histogram);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *config_filename = "/etc/fastcfs/fstore/client.conf";
+    int ch;
+    int result;
+    int64_t time_used_us;
+    int64_t bytes;
+    char *endptr;
+
+    bench_ctx.thread_count = 16;
+    bench_ctx.block_size = 4 * 1024;
+    bench_ctx.read_percent = 70;
+    bench_ctx.total_ops = 0;
+    bench_ctx.duration = 10;
+    bench_ctx.rate = 0;
+    bench_ctx.oid_start = 1000000;
+    bench_ctx.file_count = 16;
+    bench_ctx.file_size = 64 * 1024 * 1024;
+    bench_ctx.prefill = false;
+    while ((ch=getopt(argc, argv, "hc:t:b:r:n:d:R:i:f:s:P")) != -1) {
+        switch (ch) {
+            case 'h':
+                usage(argv);
+                return 0;
+            case 'c':
+                config_filename = optarg;
+                break;
+            case 't':
+                bench_ctx.thread_count = strtol(optarg, &endptr, 10);
+                break;
+            case 'b':
+                if (parse_bytes(optarg, 1, &bytes) != 0) {
+                    usage(argv);
+                    return EINVAL;
+                }
+                bench_ctx.block_size = bytes;
+                break;
+            case 'r':
+                bench_ctx.read_percent = strtol(optarg, &endptr, 10);
+                break;
+            case 'n':
+                bench_ctx.total_ops = strtoll(optarg, &endptr, 10);
+                break;
+            case 'd':
+                bench_ctx.duration = strtol(optarg, &endptr, 10);
+                break;
+            case 'R':
+                bench_ctx.rate = strtoll(optarg, &endptr, 10);
+                break;
+            case 'i':
+                bench_ctx.oid_start = strtoll(optarg, &endptr, 10);
+                break;
+            case 'f':
+                bench_ctx.file_count = strtol(optarg, &endptr, 10);
+                break;
+            case 's':
+                if (parse_bytes(optarg, 1, &bench_ctx.file_size) != 0) {
+                    usage(argv);
+                    return EINVAL;
+                }
+                break;
+            case 'P':
+                bench_ctx.prefill = true;
+                break;
+            default:
+                usage(argv);
+                return EINVAL;
+        }
+    }
+
+    if (bench_ctx.thread_count <= 0 || bench_ctx.file_count <= 0 ||
+            bench_ctx.read_percent < 0 || bench_ctx.read_percent > 100 ||
+            bench_ctx.duration <= 0 || bench_ctx.rate < 0)
+    {
+        usage(argv);
+        return EINVAL;
+    }
+
+    //the slice can't cross the blocks
+    if (bench_ctx.block_size <= 0 || bench_ctx.block_size >
+            FS_FILE_BLOCK_SIZE || FS_FILE_BLOCK_SIZE %
+            bench_ctx.block_size != 0)
+    {
+        fprintf(stderr, "invalid block size: %d, which must be a "
+                "divisor of %d\n", bench_ctx.block_size, FS_FILE_BLOCK_SIZE);
+        return EINVAL;
+    }
+    bench_ctx.slots_per_file = bench_ctx.file_size / bench_ctx.block_size;
+    if (bench_ctx.slots_per_file <= 0) {
+        bench_ctx.slots_per_file = 1;
+    }
+
+    log_init();
+    if ((result=fs_client_init(config_filename)) != 0) {
+        return result;
+    }
+
+    if ((result=bench_init_threads()) != 0) {
+        return result;
+    }
+
+    if (bench_ctx.prefill) {
+        time_used_us = get_current_time_us();
+        if ((result=bench_run_threads(prefill_thread_func)) != 0) {
+            return result;
+        }
+        printf("prefill %d files done, time used: %"PRId64" ms\n",
+                bench_ctx.file_count, (get_current_time_us() -
+                    time_used_us) / 1000);
+    }
+
+    bench_ctx.start_time_us = get_current_time_us();
+    bench_ctx.end_time_us = bench_ctx.start_time_us +
+        bench_ctx.duration * 1000000LL;
+    if ((result=bench_run_threads(bench_thread_func)) != 0) {
+        return result;
+    }
+    time_used_us = get_current_time_us() - bench_ctx.start_time_us;
+
+    bench_output(time_used_us);
+    return 0;
+}
@@ -22,13 +22,14 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include "fastcommon/logger.h"
+#include "sf/sf_metrics.h"
 #include "faststore/client/fs_client.h"
 
 static void usage(char *argv[])
 {
     fprintf(stderr, "Usage: %s [-c config_filename] "
             "[-s server_id] [-g data_group_id=0] "
-            "host[:port]\n", argv[0]);
+            "[-m for latency metrics] host[:port]\n", argv[0]);
 }
 
 static void output(FSClientServiceStat *stat)
@@ -62,17 +63,41 @@ static void output(FSClientServiceStat *stat)
             avg_slices);
 }
 
+static void output_metrics(const SFMetricsItemInfo *items, const int count)
+{
+    const SFMetricsItemInfo *item;
+    const SFMetricsItemInfo *end;
+
+    printf("\t%-5s %-32s %12s %10s %10s %10s %10s %10s\n",
+            "type", "name", "count", "avg(us)", "p50(us)",
+            "p99(us)", "p999(us)", "max(us)");
+    end = items + count;
+    for (item=items; item<end; item++) {
+        printf("\t%-5s %-32s %12"PRId64" %10"PRId64" %10"PRId64
+                " %10"PRId64" %10"PRId64" %10"PRId64"\n",
+                item->type == SF_METRICS_TYPE_CMD ? "cmd" : "stage",
+                item->name, item->summary.count, item->summary.count > 0 ?
+                item->summary.sum / item->summary.count : 0,
+                item->summary.p50, item->summary.p99,
+                item->summary.p999, item->summary.max);
+    }
+    printf("\n");
+}
+
 int main(int argc, char *argv[])
 {
     const char *config_filename = "/etc/fastcfs/fdir/client.conf";
 	int ch;
     int server_id;
     int data_group_id;
+    bool show_metrics;
     char *host;
     FCServerInfo *server;
     ConnectionInfo *spec_conn;
     ConnectionInfo conn;
     FSClientServiceStat stat;
+    SFMetricsItemInfo items[SF_METRICS_MAX_ITEMS];
+    int count;
 	int result;
 
     if (argc < 2) {
@@ -82,7 +107,8 @@ int main(int argc, char *argv[])
 
     server_id = 0;
     data_group_id = 0;
-    while ((ch=getopt(argc, argv, "hc:s:g:")) != -1) {
+    show_metrics = false;
+    while ((ch=getopt(argc, argv, "hc:s:g:m")) != -1) {
         switch (ch) {
             case 'h':
                 usage(argv);
@@ -96,6 +122,9 @@ int main(int argc, char *argv[])
             case 'g':
                 data_group_id = strtol(optarg, NULL, 10);
                 break;
+            case 'm':
+                show_metrics = true;
+                break;
             default:
                 usage(argv);
                 return 1;
@@ -143,6 +172,17 @@ int main(int argc, char *argv[])
         spec_conn = &addr_parray->addrs[0]->conn;
     }
 
+    if (show_metrics) {
+        if ((result=fs_client_proto_get_metrics(&g_fs_client_vars.
+                        client_ctx, spec_conn, items,
+                        SF_METRICS_MAX_ITEMS, &count)) != 0)
+        {
+            return result;
+        }
+        output_metrics(items, count);
+        return 0;
+    }
+
     if ((result=fs_client_proto_service_stat(&g_fs_client_vars.
                     client_ctx, spec_conn, data_group_id, &stat)) != 0)
     {
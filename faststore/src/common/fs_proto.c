@@ -84,6 +84,18 @@ const char *fs_get_cmd_caption(const int cmd)
             return "BLOCK_DELETE_REQ";
         case FS_SERVICE_PROTO_BLOCK_DELETE_RESP:
             return "BLOCK_DELETE_RESP";
+        case FS_SERVICE_PROTO_COMMIT_REQ:
+            return "COMMIT_REQ";
+        case FS_SERVICE_PROTO_COMMIT_RESP:
+            return "COMMIT_RESP";
+        case FS_SERVICE_PROTO_SLICE_SPARSE_READ_REQ:
+            return "SLICE_SPARSE_READ_REQ";
+        case FS_SERVICE_PROTO_SLICE_SPARSE_READ_RESP:
+            return "SLICE_SPARSE_READ_RESP";
+        case FS_SERVICE_PROTO_SLICE_CLONE_REQ:
+            return "SLICE_CLONE_REQ";
+        case FS_SERVICE_PROTO_SLICE_CLONE_RESP:
+            return "SLICE_CLONE_RESP";
         case FS_SERVICE_PROTO_GET_MASTER_REQ:
             return "GET_MASTER_REQ";
         case FS_SERVICE_PROTO_GET_MASTER_RESP:
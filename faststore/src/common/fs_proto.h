@@ -42,6 +42,12 @@
 #define FS_SERVICE_PROTO_SLICE_DELETE_RESP       32
 #define FS_SERVICE_PROTO_BLOCK_DELETE_REQ        33
 #define FS_SERVICE_PROTO_BLOCK_DELETE_RESP       34
+#define FS_SERVICE_PROTO_COMMIT_REQ              35  //persist written data
+#define FS_SERVICE_PROTO_COMMIT_RESP             36
+#define FS_SERVICE_PROTO_SLICE_SPARSE_READ_REQ   37  //read without holes
+#define FS_SERVICE_PROTO_SLICE_SPARSE_READ_RESP  38
+#define FS_SERVICE_PROTO_SLICE_CLONE_REQ         39  //share the src space
+#define FS_SERVICE_PROTO_SLICE_CLONE_RESP        40
 
 #define FS_SERVICE_PROTO_SERVICE_STAT_REQ        41
 #define FS_SERVICE_PROTO_SERVICE_STAT_RESP       42
@@ -143,10 +149,33 @@ typedef struct fs_proto_block_delete_req {
     FSProtoBlockKey bkey;
 } FSProtoBlockDeleteReq;
 
+typedef struct fs_proto_slice_clone_req {
+    FSProtoBlockSlice bs;   //the dest slice
+    FSProtoBlockSlice src;  //the same data group and length as the dest
+} FSProtoSliceCloneReq;  //response: FSProtoSliceUpdateResp
+
 typedef struct fs_proto_service_slice_read_req{
     FSProtoBlockSlice bs;
 } FSProtoServiceSliceReadReq;
 
+#define FS_SPARSE_READ_FLAGS_EXTENTS_ONLY  1  //query the data extents only
+
+typedef struct fs_proto_service_slice_sparse_read_req {
+    FSProtoBlockSlice bs;
+    char flags;
+    char padding[7];
+} FSProtoServiceSliceSparseReadReq;
+
+/* the response body: header + FSProtoSliceSize extents + data of extents.
+ * the extents are sorted by offset, the ranges between them are holes.
+ * read_bytes is the read length include the holes, same as SLICE_READ.
+ * for FS_SPARSE_READ_FLAGS_EXTENTS_ONLY, no data and read_bytes is the
+ * length covered by the extents when the extent list is truncated */
+typedef struct fs_proto_slice_sparse_read_resp_header {
+    char read_bytes[4];
+    char extent_count[4];
+} FSProtoSliceSparseReadRespHeader;
+
 typedef struct fs_proto_replica_slice_read_req {
     char slave_id[4];
     char padding[4];
@@ -379,7 +408,7 @@ typedef struct fs_proto_replica_rpc_req_body_part {
     char body_len[4];
     unsigned char cmd;
     char padding[3];
-    char body[0];
+    char body[0];  //follows SFProtoTraceExt when the RPC is traced
 } FSProtoReplicaRPCReqBodyPart;
 
 typedef struct fs_proto_replica_rpc_resp_body_header {
@@ -44,6 +44,7 @@ static inline void handler_init_task_context(struct fast_task_info *task)
     REQUEST.header.cmd = ((FSProtoHeader *)task->data)->cmd;
     REQUEST.header.body_len = task->length - sizeof(FSProtoHeader);
     REQUEST.header.status = buff2short(((FSProtoHeader *)task->data)->status);
+    REQUEST.header.trace = g_sf_trace_current;  //set by sf_deal_request
     REQUEST.body = task->data + sizeof(FSProtoHeader);
 }
 
@@ -32,6 +32,7 @@
 #include "fastcommon/pthread_func.h"
 #include "sf/sf_global.h"
 #include "sf/sf_func.h"
+#include "sf/sf_metrics.h"
 #include "server_global.h"
 #include "server_replication.h"
 #include "data_thread.h"
@@ -200,6 +201,8 @@ static void data_thread_rw_done_callback(
 static void deal_operation_finish(FSDataThreadContext *thread_ctx,
         FSDataOperation *op, const bool is_update)
 {
+    int64_t start_time;
+
     if (op->ctx->result != 0) {
         if (is_update && op->source == DATA_SOURCE_SLAVE_REPLICA) {
             logCrit("file: "__FILE__", line: %d, "
@@ -214,10 +217,14 @@ static void deal_operation_finish(FSDataThreadContext *thread_ctx,
                 log_data_update(op);  //log first
             }
 
+            start_time = get_current_time_us();
             if (replication_caller_push_to_slave_queues(op) ==
                     TASK_STATUS_CONTINUE)
             {
                 DATA_THREAD_COND_WAIT(thread_ctx);
+                sf_metrics_record_stage_ex(&op->trace,
+                        FS_METRICS_STAGE_REPLICA_ACK, start_time,
+                        get_current_time_us() - start_time);
             }
         }
         log_data_update(op);
@@ -245,6 +252,11 @@ static void deal_one_operation(FSDataThreadContext *thread_ctx,
 {
     bool is_update;
     int result;
+    int64_t start_time;
+
+    start_time = get_current_time_us();
+    sf_metrics_record_stage_ex(&op->trace, FS_METRICS_STAGE_DATA_QUEUE,
+            op->push_time_us, start_time - op->push_time_us);
 
     op->ctx->arg = thread_ctx;
     switch (op->operation) {
@@ -253,6 +265,9 @@ static void deal_one_operation(FSDataThreadContext *thread_ctx,
             op->ctx->rw_done_callback = data_thread_rw_done_callback;
             if ((op->ctx->result=fs_slice_read(op->ctx)) == 0) {
                 DATA_THREAD_COND_WAIT(thread_ctx);
+                sf_metrics_record_stage_ex(&op->trace,
+                        FS_METRICS_STAGE_DISK_IO, start_time,
+                        get_current_time_us() - start_time);
             }
             break;
         case DATA_OPERATION_SLICE_WRITE:
@@ -260,6 +275,9 @@ static void deal_one_operation(FSDataThreadContext *thread_ctx,
             op->ctx->rw_done_callback = data_thread_rw_done_callback;
             if ((result=fs_slice_write(op->ctx)) == 0) {
                 DATA_THREAD_COND_WAIT(thread_ctx);
+                sf_metrics_record_stage_ex(&op->trace,
+                        FS_METRICS_STAGE_DISK_IO, start_time,
+                        get_current_time_us() - start_time);
             } else {
                 op->ctx->result = result;
             }
@@ -279,6 +297,10 @@ static void deal_one_operation(FSDataThreadContext *thread_ctx,
             is_update = true;
             op->ctx->result = fs_delete_block(op->ctx);
             break;
+        case DATA_OPERATION_SLICE_CLONE:
+            is_update = true;
+            op->ctx->result = fs_clone_slices(op->ctx);
+            break;
         default:
             is_update = false;
             op->ctx->result = EINVAL;
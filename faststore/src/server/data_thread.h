@@ -19,6 +19,7 @@
 #define _DATA_THREAD_H_
 
 #include "fastcommon/fc_queue.h"
+#include "sf/sf_trace.h"
 #include "storage/slice_op.h"
 
 #define DATA_OPERATION_NONE           '\0'
@@ -27,15 +28,24 @@
 #define DATA_OPERATION_SLICE_ALLOCATE 'a'
 #define DATA_OPERATION_SLICE_DELETE   'd'
 #define DATA_OPERATION_BLOCK_DELETE   'D'
+#define DATA_OPERATION_SLICE_CLONE    'c'
 
 #define DATA_SOURCE_MASTER_SERVICE     1
 #define DATA_SOURCE_SLAVE_REPLICA      2
 #define DATA_SOURCE_SLAVE_RECOVERY     3
 
+//the stages of the latency metrics
+#define FS_METRICS_STAGE_DATA_QUEUE   0  //wait in the data thread queue
+#define FS_METRICS_STAGE_DISK_IO      1  //slice read or write
+#define FS_METRICS_STAGE_REPLICA_ACK  2  //wait the slaves for replication
+#define FS_METRICS_STAGE_COUNT        3
+
 typedef struct fs_data_operation {
     short operation;
     char source;
     bool binlog_write_done;
+    int64_t push_time_us;  //for the queue wait time
+    SFTraceContext trace;  //the trace of the pushing thread
     FSSliceOpContext *ctx;
     void *arg;
     struct fs_data_operation *next;  //for queue
@@ -97,6 +107,8 @@ extern "C" {
         op->source = source;
         op->arg = arg;
         op->ctx = op_ctx;
+        op->push_time_us = get_current_time_us();
+        op->trace = g_sf_trace_current;
         fc_queue_push(&context->queue, op);
         return 0;
     }
@@ -122,6 +134,8 @@ extern "C" {
                 return "slice delete";
             case DATA_OPERATION_BLOCK_DELETE:
                 return "block delete";
+            case DATA_OPERATION_SLICE_CLONE:
+                return "slice clone";
             default:
                 return "unkown";
         }
@@ -143,6 +157,8 @@ extern "C" {
                 return fs_log_delete_slices(op->ctx);
             case DATA_OPERATION_BLOCK_DELETE:
                 return fs_log_delete_block(op->ctx);
+            case DATA_OPERATION_SLICE_CLONE:
+                return fs_log_clone_slices(op->ctx);
             default:
                 logError("file: "__FILE__", line: %d, "
                         "invalid operation: %d",
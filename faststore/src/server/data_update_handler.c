@@ -235,6 +235,138 @@ void du_handler_idempotency_request_finish(struct fast_task_info *task,
     }
 }
 
+static int pack_slice_extents(FSProtoSliceSize *proto_extent,
+        const FSSliceSize *extents, const int count)
+{
+    const FSSliceSize *extent;
+    const FSSliceSize *end;
+
+    end = extents + count;
+    for (extent=extents; extent<end; extent++, proto_extent++) {
+        int2buff(extent->offset, proto_extent->offset);
+        int2buff(extent->length, proto_extent->length);
+    }
+
+    return count * sizeof(FSProtoSliceSize);
+}
+
+static int pack_extents_only_response(struct fast_task_info *task,
+        FSSliceOpContext *op_ctx)
+{
+    FSProtoSliceSparseReadRespHeader *resp_header;
+    FSSliceSize *last;
+    int max_count;
+    int count;
+    int read_bytes;
+
+    resp_header = (FSProtoSliceSparseReadRespHeader *)
+        (task->data + sizeof(FSProtoHeader));
+    max_count = (task->size - sizeof(FSProtoHeader) -
+            sizeof(FSProtoSliceSparseReadRespHeader)) /
+        sizeof(FSProtoSliceSize);
+    if (op_ctx->sparse.extents.count > max_count) {
+        /* truncated, the client continue from the last extent */
+        count = max_count;
+        last = op_ctx->sparse.extents.ssizes + (count - 1);
+        read_bytes = (last->offset + last->length) -
+            op_ctx->info.bs_key.slice.offset;
+    } else {
+        count = op_ctx->sparse.extents.count;
+        read_bytes = op_ctx->info.bs_key.slice.length;
+    }
+
+    int2buff(read_bytes, resp_header->read_bytes);
+    int2buff(count, resp_header->extent_count);
+    return sizeof(FSProtoSliceSparseReadRespHeader) + pack_slice_extents(
+            (FSProtoSliceSize *)(resp_header + 1),
+            op_ctx->sparse.extents.ssizes, count);
+}
+
+/* the data are read to their natural positions after the front
+ * space of one extent. pack them as header + extents + data extents
+ * when the holes are more than the extents, otherwise zero fill the
+ * holes and respond as one extent */
+static int pack_sparse_read_response(struct fast_task_info *task,
+        FSSliceOpContext *op_ctx)
+{
+    FSProtoSliceSparseReadRespHeader *resp_header;
+    FSProtoSliceSize *proto_extent;
+    FSSliceSize single;
+    FSSliceSize *extent;
+    FSSliceSize *end;
+    char *data;
+    char *dest;
+    char *src;
+    int start;
+    int offset;
+    int count;
+    int data_bytes;
+    int hole_len;
+
+    resp_header = (FSProtoSliceSparseReadRespHeader *)
+        (task->data + sizeof(FSProtoHeader));
+    proto_extent = (FSProtoSliceSize *)(resp_header + 1);
+    data = op_ctx->info.buff;
+    start = op_ctx->info.bs_key.slice.offset;
+    count = op_ctx->sparse.extents.count;
+    end = op_ctx->sparse.extents.ssizes + count;
+    data_bytes = 0;
+    for (extent=op_ctx->sparse.extents.ssizes; extent<end; extent++) {
+        data_bytes += extent->length;
+    }
+
+    if (count * sizeof(FSProtoSliceSize) + data_bytes <
+            sizeof(FSProtoSliceSize) + op_ctx->done_bytes)
+    {
+        /* the destination offset minus the source offset is descending,
+         * so the tail extents move to lower address in ascending order
+         * and the head extents move to higher address in descending order */
+        dest = (char *)(proto_extent + count);
+        for (extent=op_ctx->sparse.extents.ssizes; extent<end; extent++) {
+            src = data + (extent->offset - start);
+            if (dest <= src) {
+                memmove(dest, src, extent->length);
+            }
+            dest += extent->length;
+        }
+        for (extent=end-1; extent>=op_ctx->sparse.extents.ssizes; extent--) {
+            dest -= extent->length;
+            src = data + (extent->offset - start);
+            if (dest > src) {
+                memmove(dest, src, extent->length);
+            }
+        }
+
+        pack_slice_extents(proto_extent, op_ctx->sparse.extents.ssizes, count);
+    } else {
+        offset = start;
+        for (extent=op_ctx->sparse.extents.ssizes; extent<end; extent++) {
+            if ((hole_len=extent->offset - offset) > 0) {
+                memset(data + (offset - start), 0, hole_len);
+            }
+            offset = extent->offset + extent->length;
+        }
+        if ((hole_len=(start + op_ctx->done_bytes) - offset) > 0) {
+            memset(data + (offset - start), 0, hole_len);
+        }
+
+        if (op_ctx->done_bytes > 0) {
+            count = 1;
+            data_bytes = op_ctx->done_bytes;
+            single.offset = start;
+            single.length = op_ctx->done_bytes;
+            pack_slice_extents(proto_extent, &single, count);
+        } else {
+            count = data_bytes = 0;
+        }
+    }
+
+    int2buff(op_ctx->done_bytes, resp_header->read_bytes);
+    int2buff(count, resp_header->extent_count);
+    return sizeof(FSProtoSliceSparseReadRespHeader) +
+        count * sizeof(FSProtoSliceSize) + data_bytes;
+}
+
 void du_handler_slice_read_done_callback(FSSliceOpContext *op_ctx,
         struct fast_task_info *task)
 {
@@ -260,7 +392,15 @@ void du_handler_slice_read_done_callback(FSSliceOpContext *op_ctx,
                 op_ctx->result, STRERROR(op_ctx->result));
         TASK_ARG->context.log_level = LOG_NOTHING;
     } else {
-        RESPONSE.header.body_len = op_ctx->done_bytes;
+        if (!op_ctx->sparse.enabled) {
+            RESPONSE.header.body_len = op_ctx->done_bytes;
+        } else if (op_ctx->sparse.extents_only) {
+            RESPONSE.header.body_len = pack_extents_only_response(
+                    task, op_ctx);
+        } else {
+            RESPONSE.header.body_len = pack_sparse_read_response(
+                    task, op_ctx);
+        }
         TASK_ARG->context.response_done = true;
     }
 
@@ -328,6 +468,9 @@ static void master_data_update_done_notify(FSDataOperation *op)
             case DATA_OPERATION_BLOCK_DELETE:
                 RESPONSE.header.cmd = FS_SERVICE_PROTO_BLOCK_DELETE_RESP;
                 break;
+            case DATA_OPERATION_SLICE_CLONE:
+                RESPONSE.header.cmd = FS_SERVICE_PROTO_SLICE_CLONE_RESP;
+                break;
         }
         du_handler_fill_slice_update_response(task,
                 SLICE_OP_CTX.update.space_changed);
@@ -574,6 +717,72 @@ int du_handler_deal_block_delete(struct fast_task_info *task,
     return du_push_to_data_queue(task, op_ctx, DATA_OPERATION_BLOCK_DELETE);
 }
 
+static int parse_check_clone_src(struct fast_task_info *task,
+        FSSliceOpContext *op_ctx, const FSProtoBlockSlice *src)
+{
+    FSBlockSliceKeyInfo *src_bs_key;
+
+    src_bs_key = &op_ctx->info.src_bs_key;
+    src_bs_key->block.oid = buff2long(src->bkey.oid);
+    src_bs_key->block.offset = buff2long(src->bkey.offset);
+    src_bs_key->slice.offset = buff2int(src->slice_size.offset);
+    src_bs_key->slice.length = buff2int(src->slice_size.length);
+    if (src_bs_key->block.offset % FS_FILE_BLOCK_SIZE != 0) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "src block offset: %"PRId64" NOT the multiple of "
+                "the block size %d", src_bs_key->block.offset,
+                FS_FILE_BLOCK_SIZE);
+        return EINVAL;
+    }
+    if (src_bs_key->slice.offset < 0 || src_bs_key->slice.length !=
+            op_ctx->info.bs_key.slice.length || src_bs_key->slice.offset +
+            src_bs_key->slice.length > FS_FILE_BLOCK_SIZE)
+    {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "src slice offset: %d, length: %d is invalid, "
+                "dest slice length: %d", src_bs_key->slice.offset,
+                src_bs_key->slice.length, op_ctx->info.bs_key.slice.length);
+        return EINVAL;
+    }
+
+    fs_calc_block_hashcode(&src_bs_key->block);
+    if (FS_DATA_GROUP_ID(src_bs_key->block) != op_ctx->info.data_group_id) {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "src data group id: %d != dest data group id: %d",
+                (int)FS_DATA_GROUP_ID(src_bs_key->block),
+                op_ctx->info.data_group_id);
+        return EXDEV;
+    }
+
+    return 0;
+}
+
+int du_handler_deal_slice_clone(struct fast_task_info *task,
+        FSSliceOpContext *op_ctx)
+{
+    int result;
+    FSProtoSliceCloneReq *req;
+
+    if ((result=sf_server_expect_body_length(&RESPONSE, op_ctx->info.body_len,
+                    sizeof(FSProtoSliceCloneReq))) != 0)
+    {
+        return result;
+    }
+
+    req = (FSProtoSliceCloneReq *)op_ctx->info.body;
+    if ((result=du_handler_parse_check_block_slice(task, op_ctx, &req->bs,
+                    TASK_CTX.which_side == FS_WHICH_SIDE_MASTER)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=parse_check_clone_src(task, op_ctx, &req->src)) != 0) {
+        return result;
+    }
+
+    return du_push_to_data_queue(task, op_ctx, DATA_OPERATION_SLICE_CLONE);
+}
+
 FSServerContext *du_handler_alloc_server_context()
 {
     FSServerContext *server_context;
@@ -61,6 +61,9 @@ int du_handler_deal_slice_delete(struct fast_task_info *task,
 int du_handler_deal_block_delete(struct fast_task_info *task,
         FSSliceOpContext *op_ctx);
 
+int du_handler_deal_slice_clone(struct fast_task_info *task,
+        FSSliceOpContext *op_ctx);
+
 int du_handler_deal_client_join(struct fast_task_info *task);
 
 int du_handler_deal_get_readable_server(struct fast_task_info *task,
@@ -23,6 +23,7 @@
 #include "../server_global.h"
 #include "../binlog/trunk_binlog.h"
 #include "trunk_fd_cache.h"
+#include "trunk_sync_thread.h"
 #include "trunk_io_thread.h"
 
 #define IO_THREAD_ROLE_WRITER   'W'
@@ -38,6 +39,7 @@ typedef struct trunk_io_thread_context {
         TrunkFDCacheContext context;
         TrunkIdFDPair pair;
     } fd_cache;
+    TrunkSyncDirtyMark dirty_mark;  //for writer
     int role;
 } TrunkIOThreadContext;
 
@@ -266,14 +268,6 @@ int trunk_io_thread_push(const int type, const int path_index,
     return 0;
 }
 
-static inline void get_trunk_filename(FSTrunkSpaceInfo *space,
-        char *trunk_filename, const int size)
-{
-    snprintf(trunk_filename, size, "%s/%04"PRId64"/%06"PRId64,
-            space->store->path.str, space->id_info.subdir,
-            space->id_info.id);
-}
-
 static inline void clear_write_fd(TrunkIOThreadContext *ctx)
 {
     if (ctx->fd_cache.pair.fd >= 0) {
@@ -294,7 +288,7 @@ static int get_write_fd(TrunkIOThreadContext *ctx,
         return 0;
     }
 
-    get_trunk_filename(space, trunk_filename, sizeof(trunk_filename));
+    dio_get_trunk_filename(space, trunk_filename, sizeof(trunk_filename));
     *fd = open(trunk_filename, O_WRONLY, 0644);
     if (*fd < 0) {
         result = errno != 0 ? errno : EACCES;
@@ -325,7 +319,7 @@ static int get_read_fd(TrunkIOThreadContext *ctx,
         return 0;
     }
 
-    get_trunk_filename(space, trunk_filename, sizeof(trunk_filename));
+    dio_get_trunk_filename(space, trunk_filename, sizeof(trunk_filename));
     *fd = open(trunk_filename, O_RDONLY);
     if (*fd < 0) {
         result = errno != 0 ? errno : EACCES;
@@ -345,7 +339,8 @@ static int do_create_trunk(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
     int fd;
     int result;
 
-    get_trunk_filename(&iob->space, trunk_filename, sizeof(trunk_filename));
+    dio_get_trunk_filename(&iob->space, trunk_filename,
+            sizeof(trunk_filename));
     fd = open(trunk_filename, O_WRONLY | O_CREAT, 0644);
     if (fd < 0) {
         if (errno == ENOENT) {
@@ -398,7 +393,8 @@ static int do_delete_trunk(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
     char trunk_filename[PATH_MAX];
     int result;
 
-    get_trunk_filename(&iob->space, trunk_filename, sizeof(trunk_filename));
+    dio_get_trunk_filename(&iob->space, trunk_filename,
+            sizeof(trunk_filename));
     if (unlink(trunk_filename) == 0) {
         result = trunk_binlog_write(FS_IO_TYPE_DELETE_TRUNK,
                 iob->space.store->index, &iob->space.id_info,
@@ -438,7 +434,7 @@ static int do_write_slice(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
 
             clear_write_fd(ctx);
 
-            get_trunk_filename(&iob->slice->space, trunk_filename,
+            dio_get_trunk_filename(&iob->slice->space, trunk_filename,
                     sizeof(trunk_filename));
             logError("file: "__FILE__", line: %d, "
                     "write to trunk file: %s fail, offset: %"PRId64", "
@@ -452,7 +448,7 @@ static int do_write_slice(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
         remain -= bytes;
     }
 
-    return 0;
+    return trunk_sync_mark_dirty(&ctx->dirty_mark, &iob->slice->space);
 }
 
 static int do_read_slice(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
@@ -481,7 +477,7 @@ static int do_read_slice(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
             trunk_fd_cache_delete(&ctx->fd_cache.context,
                     iob->slice->space.id_info.id);
 
-            get_trunk_filename(&iob->slice->space, trunk_filename,
+            dio_get_trunk_filename(&iob->slice->space, trunk_filename,
                     sizeof(trunk_filename));
             logError("file: "__FILE__", line: %d, "
                     "read trunk file: %s fail, offset: %"PRId64", "
@@ -59,6 +59,14 @@ extern "C" {
             const uint64_t hash_code, void *entry, char *buff,
             trunk_io_notify_func notify_func, void *notify_arg);
 
+    static inline void dio_get_trunk_filename(const FSTrunkSpaceInfo *space,
+            char *trunk_filename, const int size)
+    {
+        snprintf(trunk_filename, size, "%s/%04"PRId64"/%06"PRId64,
+                space->store->path.str, space->id_info.subdir,
+                space->id_info.id);
+    }
+
     static inline int io_thread_push_trunk_op(const int type,
             const FSTrunkSpaceInfo *space, trunk_io_notify_func
             notify_func, void *notify_arg)
@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/fast_mblock.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/fc_atomic.h"
+#include "sf/sf_global.h"
+#include "sf/sf_binlog_writer.h"
+#include "../server_global.h"
+#include "../binlog/slice_binlog.h"
+#include "../storage/storage_allocator.h"
+#include "trunk_io_thread.h"
+#include "trunk_sync_thread.h"
+
+typedef struct trunk_sync_request {
+    trunk_sync_notify_func notify_func;
+    void *arg;
+    struct trunk_sync_request *next;
+} TrunkSyncRequest;
+
+typedef struct trunk_sync_space_array {
+    FSTrunkSpaceInfo *spaces;
+    int count;
+    int alloc;
+} TrunkSyncSpaceArray;
+
+typedef struct trunk_sync_thread_context {
+    pthread_lock_cond_pair_t lcp;
+    struct fast_mblock_man allocator;  //element: TrunkSyncRequest
+    struct {
+        TrunkSyncRequest *head;
+        TrunkSyncRequest *tail;
+    } waitings;
+    TrunkSyncSpaceArray arrays[2];
+    TrunkSyncSpaceArray *dirty;   //the dirty trunks of current round
+    int sync_errno;  //the error of the background sync, for the next commit
+    volatile bool continue_flag;
+    volatile int running;
+} TrunkSyncThreadContext;
+
+static TrunkSyncThreadContext sync_thread_ctx;
+TrunkSyncContext g_trunk_sync_ctx = {0};
+
+static inline int check_alloc_spaces(TrunkSyncSpaceArray *array)
+{
+    FSTrunkSpaceInfo *spaces;
+    int alloc;
+
+    if (array->count < array->alloc) {
+        return 0;
+    }
+
+    alloc = (array->alloc == 0) ? 256 : array->alloc * 2;
+    spaces = (FSTrunkSpaceInfo *)fc_malloc(sizeof(FSTrunkSpaceInfo) * alloc);
+    if (spaces == NULL) {
+        return ENOMEM;
+    }
+
+    if (array->spaces != NULL) {
+        memcpy(spaces, array->spaces, sizeof(FSTrunkSpaceInfo) *
+                array->count);
+        free(array->spaces);
+    }
+    array->spaces = spaces;
+    array->alloc = alloc;
+    return 0;
+}
+
+int trunk_sync_add_dirty(TrunkSyncDirtyMark *mark,
+        const FSTrunkSpaceInfo *space)
+{
+    FSTrunkAllocator *allocator;
+    int64_t round;
+    int result;
+
+    allocator = g_allocator_mgr->allocator_ptr_array.
+        allocators[space->store->index];
+    PTHREAD_MUTEX_LOCK(&sync_thread_ctx.lcp.lock);
+    round = g_trunk_sync_ctx.round;
+
+    /* each trunk is added once per round, the write threads
+     * switch between the trunks frequently */
+    if (trunk_allocator_set_sync_round(allocator,
+                space->id_info.id, round) == round)
+    {
+        result = 0;
+    } else if ((result=check_alloc_spaces(sync_thread_ctx.dirty)) == 0) {
+        sync_thread_ctx.dirty->spaces[sync_thread_ctx.
+            dirty->count++] = *space;
+    } else {
+        trunk_allocator_set_sync_round(allocator, space->id_info.id, -1);
+    }
+
+    if (result == 0) {
+        mark->trunk_id = space->id_info.id;
+        mark->round = round;
+    }
+    PTHREAD_MUTEX_UNLOCK(&sync_thread_ctx.lcp.lock);
+
+    return result;
+}
+
+int trunk_sync_commit(trunk_sync_notify_func notify_func, void *arg)
+{
+    TrunkSyncRequest *request;
+
+    request = (TrunkSyncRequest *)fast_mblock_alloc_object(
+            &sync_thread_ctx.allocator);
+    if (request == NULL) {
+        return ENOMEM;
+    }
+    request->notify_func = notify_func;
+    request->arg = arg;
+    request->next = NULL;
+
+    PTHREAD_MUTEX_LOCK(&sync_thread_ctx.lcp.lock);
+    if (!sync_thread_ctx.running) {
+        PTHREAD_MUTEX_UNLOCK(&sync_thread_ctx.lcp.lock);
+        fast_mblock_free_object(&sync_thread_ctx.allocator, request);
+        return EINTR;
+    }
+
+    if (sync_thread_ctx.waitings.head == NULL) {
+        sync_thread_ctx.waitings.head = request;
+        pthread_cond_signal(&sync_thread_ctx.lcp.cond);
+    } else {
+        sync_thread_ctx.waitings.tail->next = request;
+    }
+    sync_thread_ctx.waitings.tail = request;
+    PTHREAD_MUTEX_UNLOCK(&sync_thread_ctx.lcp.lock);
+
+    return 0;
+}
+
+static int compare_trunk_space(const FSTrunkSpaceInfo *space1,
+        const FSTrunkSpaceInfo *space2)
+{
+    int sub;
+
+    if ((sub=space1->store->index - space2->store->index) != 0) {
+        return sub;
+    }
+
+    return fc_compare_int64(space1->id_info.id, space2->id_info.id);
+}
+
+static int sync_trunk_file(const FSTrunkSpaceInfo *space)
+{
+    char trunk_filename[PATH_MAX];
+    int fd;
+    int result;
+
+    dio_get_trunk_filename(space, trunk_filename, sizeof(trunk_filename));
+    if ((fd=open(trunk_filename, O_WRONLY)) < 0) {
+        result = errno != 0 ? errno : EACCES;
+        if (result == ENOENT) {  //the trunk file deleted by reclaim
+            return 0;
+        }
+
+        logError("file: "__FILE__", line: %d, "
+                "open file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, trunk_filename, result, STRERROR(result));
+        return result;
+    }
+
+    if (fdatasync(fd) != 0) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "fdatasync file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, trunk_filename, result, STRERROR(result));
+    } else {
+        result = 0;
+    }
+
+    close(fd);
+    return result;
+}
+
+static int sync_dirty_trunks(TrunkSyncSpaceArray *array)
+{
+    FSTrunkSpaceInfo *space;
+    FSTrunkSpaceInfo *previous;
+    FSTrunkSpaceInfo *end;
+    int result;
+
+    if (array->count > 1) {
+        qsort(array->spaces, array->count, sizeof(FSTrunkSpaceInfo),
+                (int (*)(const void *, const void *))compare_trunk_space);
+    }
+
+    result = 0;
+    previous = NULL;
+    end = array->spaces + array->count;
+    for (space=array->spaces; space<end; space++) {
+        if (previous != NULL && compare_trunk_space(space, previous) == 0) {
+            continue;
+        }
+
+        if ((result=sync_trunk_file(space)) != 0) {
+            break;
+        }
+        previous = space;
+    }
+
+    array->count = 0;
+    return result;
+}
+
+static void notify_requests(TrunkSyncRequest *head, const int result)
+{
+    TrunkSyncRequest *request;
+
+    while (head != NULL) {
+        request = head;
+        head = head->next;
+
+        request->notify_func(request->arg, result);
+        fast_mblock_free_object(&sync_thread_ctx.allocator, request);
+    }
+}
+
+static void *trunk_sync_thread_func(void *arg)
+{
+    TrunkSyncRequest *head;
+    TrunkSyncSpaceArray *array;
+    struct timespec ts;
+    int64_t slice_binlog_sn;
+    int result;
+
+    while (SF_G_CONTINUE_FLAG && sync_thread_ctx.continue_flag) {
+        PTHREAD_MUTEX_LOCK(&sync_thread_ctx.lcp.lock);
+        if (sync_thread_ctx.waitings.head == NULL &&
+                sync_thread_ctx.continue_flag)
+        {
+            ts.tv_sec = get_current_time() + 1;
+            ts.tv_nsec = 0;
+            pthread_cond_timedwait(&sync_thread_ctx.lcp.cond,
+                    &sync_thread_ctx.lcp.lock, &ts);
+        }
+
+        head = sync_thread_ctx.waitings.head;
+        if (head == NULL && sync_thread_ctx.dirty->count == 0) {
+            PTHREAD_MUTEX_UNLOCK(&sync_thread_ctx.lcp.lock);
+            continue;
+        }
+
+        /* take all waiting requests and the dirty trunks marked before,
+         * the dirty trunks are synced every second without waiting
+         * requests too, so the dirty array keeps small */
+        sync_thread_ctx.waitings.head = sync_thread_ctx.waitings.tail = NULL;
+        array = sync_thread_ctx.dirty;
+        sync_thread_ctx.dirty = (array == sync_thread_ctx.arrays) ?
+            sync_thread_ctx.arrays + 1 : sync_thread_ctx.arrays;
+        __sync_add_and_fetch(&g_trunk_sync_ctx.round, 1);
+        PTHREAD_MUTEX_UNLOCK(&sync_thread_ctx.lcp.lock);
+
+        if (head == NULL) {
+            if ((result=sync_dirty_trunks(array)) != 0) {
+                sync_thread_ctx.sync_errno = result;
+            }
+            continue;
+        }
+
+        slice_binlog_sn = FC_ATOMIC_GET(SLICE_BINLOG_SN);
+        if ((result=sync_dirty_trunks(array)) == 0 &&
+                (result=sync_thread_ctx.sync_errno) == 0)
+        {
+            if ((result=sf_binlog_writer_wait_flushed(
+                            slice_binlog_get_writer(), slice_binlog_sn,
+                            SF_G_NETWORK_TIMEOUT * 1000)) != 0)
+            {
+                logError("file: "__FILE__", line: %d, "
+                        "wait slice binlog flushed fail, sn: %"PRId64", "
+                        "errno: %d, error info: %s", __LINE__,
+                        slice_binlog_sn, result, STRERROR(result));
+            }
+        }
+
+        notify_requests(head, result);
+        sync_thread_ctx.sync_errno = 0;  //reported to the waiters
+    }
+
+    /* fail the waiting requests, then the commit requests are rejected */
+    PTHREAD_MUTEX_LOCK(&sync_thread_ctx.lcp.lock);
+    head = sync_thread_ctx.waitings.head;
+    sync_thread_ctx.waitings.head = sync_thread_ctx.waitings.tail = NULL;
+    sync_thread_ctx.running = false;
+    PTHREAD_MUTEX_UNLOCK(&sync_thread_ctx.lcp.lock);
+
+    notify_requests(head, EINTR);
+    return NULL;
+}
+
+int trunk_sync_thread_init()
+{
+    int result;
+    pthread_t tid;
+
+    if ((result=init_pthread_lock_cond_pair(&sync_thread_ctx.lcp)) != 0) {
+        return result;
+    }
+
+    if ((result=fast_mblock_init_ex1(&sync_thread_ctx.allocator,
+                    "trunk_sync_request", sizeof(TrunkSyncRequest),
+                    1024, 0, NULL, NULL, true)) != 0)
+    {
+        return result;
+    }
+
+    sync_thread_ctx.dirty = sync_thread_ctx.arrays;
+    sync_thread_ctx.continue_flag = true;
+    sync_thread_ctx.running = true;
+    if ((result=fc_create_thread(&tid, trunk_sync_thread_func,
+                    NULL, SF_G_THREAD_STACK_SIZE)) != 0)
+    {
+        sync_thread_ctx.running = false;
+    }
+    return result;
+}
+
+void trunk_sync_thread_terminate()
+{
+    int count;
+
+    PTHREAD_MUTEX_LOCK(&sync_thread_ctx.lcp.lock);
+    sync_thread_ctx.continue_flag = false;
+    pthread_cond_broadcast(&sync_thread_ctx.lcp.cond);
+    PTHREAD_MUTEX_UNLOCK(&sync_thread_ctx.lcp.lock);
+
+    count = 0;
+    while (FC_ATOMIC_GET(sync_thread_ctx.running) && count++ < 3000) {
+        fc_sleep_ms(10);
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* the group commit of the trunk files: the write threads mark the trunk
+ * files dirty after written (once per trunk per round), the sync thread
+ * fdatasyncs all dirty trunk files for all waiting commit requests in one
+ * round, and every second in the background without commit requests */
+
+#ifndef _TRUNK_SYNC_THREAD_H
+#define _TRUNK_SYNC_THREAD_H
+
+#include "../../common/fs_types.h"
+#include "../storage/storage_types.h"
+
+typedef void (*trunk_sync_notify_func)(void *arg, const int result);
+
+typedef struct trunk_sync_dirty_mark {
+    int64_t trunk_id;  //the last marked trunk id
+    int64_t round;     //the sync round when marked
+} TrunkSyncDirtyMark;
+
+typedef struct trunk_sync_context {
+    volatile int64_t round;  //increase when the dirty trunks taken
+} TrunkSyncContext;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    extern TrunkSyncContext g_trunk_sync_ctx;
+
+    int trunk_sync_thread_init();
+    void trunk_sync_thread_terminate();
+
+    int trunk_sync_add_dirty(TrunkSyncDirtyMark *mark,
+            const FSTrunkSpaceInfo *space);
+
+    /* called by the write thread after the slice written */
+    static inline int trunk_sync_mark_dirty(TrunkSyncDirtyMark *mark,
+            const FSTrunkSpaceInfo *space)
+    {
+        if (mark->trunk_id == space->id_info.id && mark->round ==
+                __sync_add_and_fetch(&g_trunk_sync_ctx.round, 0))
+        {
+            return 0;  //already in the dirty trunks of current round
+        }
+
+        return trunk_sync_add_dirty(mark, space);
+    }
+
+    /* the notify func will be called after the trunk files written before
+     * this call and the slice binlog are persisted */
+    int trunk_sync_commit(trunk_sync_notify_func notify_func, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -54,6 +54,7 @@
 #include "server_recovery.h"
 #include "storage/slice_op.h"
 #include "dio/trunk_io_thread.h"
+#include "dio/trunk_sync_thread.h"
 #include "shared_thread_pool.h"
 
 static bool daemon_mode = true;
@@ -176,6 +177,10 @@ int main(int argc, char *argv[])
             break;
         }
 
+        if ((result=trunk_sync_thread_init()) != 0) {
+            break;
+        }
+
         if ((result=data_thread_init()) != 0) {
             break;
         }
@@ -276,6 +281,7 @@ int main(int argc, char *argv[])
     }
 
     trunk_io_thread_terminate();
+    trunk_sync_thread_terminate();
     server_binlog_terminate();
     server_replication_terminate();
     server_recovery_terminate();
@@ -656,13 +656,17 @@ static int handle_rpc_req(struct fast_task_info *task,
     FSProtoReplicaRPCReqBodyPart *body_part;
     FSSliceOpBufferContext *op_buffer_ctx;
     FSSliceOpContext *op_ctx;
+    SFTraceContext trace;
     int result;
+    int ext_size;
     int current_len;
     int last_index;
     int blen;
     int i;
 
     TASK_CTX.which_side = FS_WHICH_SIDE_SLAVE;
+    ext_size = SF_TRACE_SAMPLED(&REQUEST.header.trace) ?
+        sizeof(SFProtoTraceExt) : 0;
     last_index = count - 1;
     current_len = sizeof(FSProtoReplicaRPCReqBodyHeader);
     for (i=0; i<count; i++) {
@@ -674,7 +678,7 @@ static int handle_rpc_req(struct fast_task_info *task,
                     "rpc body length: %d <= 0", blen);
             return EINVAL;
         }
-        current_len += sizeof(*body_part) + blen;
+        current_len += sizeof(*body_part) + ext_size + blen;
         if (i < last_index) {
             if (REQUEST.header.body_len < current_len) {
                 RESPONSE.error.length = sprintf(RESPONSE.error.message,
@@ -713,8 +717,15 @@ static int handle_rpc_req(struct fast_task_info *task,
             return EINVAL;
         }
 
-        op_ctx->info.body = (char *)(body_part + 1);
+        op_ctx->info.body = body_part->body + ext_size;
         op_ctx->info.body_len = blen;
+        if (ext_size > 0) {
+            SF_PROTO_GET_TRACE((SFProtoTraceExt *)body_part->body, &trace);
+        } else {
+            trace.trace_id = 0;
+            trace.flags = 0;
+        }
+        sf_trace_set_current(&trace);  //for the data thread
         switch (body_part->cmd) {
             case FS_SERVICE_PROTO_SLICE_WRITE_REQ:
                 result = du_handler_deal_slice_write(task, op_ctx);
@@ -728,12 +739,16 @@ static int handle_rpc_req(struct fast_task_info *task,
             case FS_SERVICE_PROTO_BLOCK_DELETE_REQ:
                 result = du_handler_deal_block_delete(task, op_ctx);
                 break;
+            case FS_SERVICE_PROTO_SLICE_CLONE_REQ:
+                result = du_handler_deal_slice_clone(task, op_ctx);
+                break;
             default:
                 RESPONSE.error.length = sprintf(RESPONSE.error.message,
                         "unkown cmd: %d", body_part->cmd);
                 result = EINVAL;
                 break;
         }
+        sf_trace_set_current(&REQUEST.header.trace);
 
         if (result != TASK_STATUS_CONTINUE) {
             int r;
@@ -792,6 +807,9 @@ static int replica_deal_rpc_req(struct fast_task_info *task)
 
     min_body_len = sizeof(FSProtoReplicaRPCReqBodyHeader) +
         sizeof(FSProtoReplicaRPCReqBodyPart) * count;
+    if (SF_TRACE_SAMPLED(&REQUEST.header.trace)) {
+        min_body_len += sizeof(SFProtoTraceExt) * count;
+    }
     if (REQUEST.header.body_len < min_body_len) {
         RESPONSE.error.length = sprintf(RESPONSE.error.message,
                 "body length: %d < min length: %d, rpc count: %d",
@@ -900,13 +918,17 @@ static int replica_deal_slice_read(struct fast_task_info *task)
         return result;
     }
 
-    if (OP_CTX_INFO.bs_key.slice.length > task->size - sizeof(FSProtoHeader)) {
+    if ((result=sf_task_reserve_buffer(task, sizeof(FSProtoHeader) +
+                    OP_CTX_INFO.bs_key.slice.length)) != 0)
+    {
         RESPONSE.error.length = sprintf(RESPONSE.error.message,
                 "read slice length: %d > task buffer size: %d",
                 OP_CTX_INFO.bs_key.slice.length, (int)(
                     task->size - sizeof(FSProtoHeader)));
-        return EOVERFLOW;
+        return result;
     }
+    REQUEST.body = task->data + sizeof(FSProtoHeader);
+    req = (FSProtoReplicaSliceReadReq *)REQUEST.body;
 
     slave_id = buff2int(req->slave_id);
     if (slave_id == 0) {
@@ -931,6 +953,8 @@ static int replica_deal_slice_read(struct fast_task_info *task)
     sf_hold_task(task);
     OP_CTX_INFO.source = BINLOG_SOURCE_RPC_MASTER;
     OP_CTX_INFO.buff = REQUEST.body;
+    SLICE_OP_CTX.sparse.enabled = false;
+    SLICE_OP_CTX.sparse.extents_only = false;
     if (direct_read) {
         SLICE_OP_CTX.rw_done_callback = (fs_rw_done_callback_func)
             du_handler_slice_read_done_callback;
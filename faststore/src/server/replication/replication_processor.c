@@ -44,6 +44,9 @@
 #include "replication_callee.h"
 #include "replication_processor.h"
 
+#define RPC_ENTRY_TRACE(rb) \
+    ((FSServerTaskArg *)(rb)->task->arg)->context.request.header.trace
+
 static void replication_queue_discard_all(FSReplication *replication);
 
 static int alloc_replication_ptr_array(FSReplicationPtrArray *array)
@@ -458,8 +461,10 @@ static int replication_rpc_from_queue(FSReplication *replication)
     struct fast_task_info *task;
     FSProtoReplicaRPCReqBodyHeader *body_header;
     FSProtoReplicaRPCReqBodyPart *body_part;
+    SFTraceContext trace;
     uint64_t data_version;
     int data_group_id;
+    int ext_size;
     int count;
     int body_len;
     int pkg_len;
@@ -470,15 +475,30 @@ static int replication_rpc_from_queue(FSReplication *replication)
         return 0;
     }
 
+    /* the RPC carries the first sampled trace, and every part of
+     * the traced RPC is followed by the trace of its request */
+    trace.trace_id = 0;
+    trace.flags = 0;
+    rb = (ReplicationRPCEntry *)qinfo.head;
+    while (rb != NULL) {
+        if (SF_TRACE_SAMPLED(&RPC_ENTRY_TRACE(rb))) {
+            trace = RPC_ENTRY_TRACE(rb);
+            break;
+        }
+        rb = rb->nexts[replication->peer->link_index];
+    }
+    ext_size = SF_TRACE_SAMPLED(&trace) ? sizeof(SFProtoTraceExt) : 0;
+
     rb = (ReplicationRPCEntry *)qinfo.head;
     count = 0;
     task = replication->task;
-    task->length = sizeof(FSProtoHeader) +
+    task->length = sizeof(FSProtoHeader) + ext_size +
         sizeof(FSProtoReplicaRPCReqBodyHeader);
     do {
         body_part = (FSProtoReplicaRPCReqBodyPart *)(task->data +
                 task->length);
-        pkg_len = task->length + sizeof(*body_part) + rb->body_length;
+        pkg_len = task->length + sizeof(*body_part) +
+            ext_size + rb->body_length;
         if (pkg_len > task->size) {
             bool notify;
 
@@ -489,11 +509,15 @@ static int replication_rpc_from_queue(FSReplication *replication)
         }
 
         body_part->cmd = ((FSProtoHeader *)rb->task->data)->cmd;
+        if (ext_size > 0) {
+            sf_proto_set_trace_ext((SFProtoTraceExt *)(body_part + 1),
+                    &RPC_ENTRY_TRACE(rb));
+        }
         data_group_id = ((FSServerTaskArg *)rb->task->arg)->
             context.slice_op_ctx.info.data_group_id;
         data_version = ((FSServerTaskArg *)rb->task->arg)->
             context.slice_op_ctx.info.data_version;
-        memcpy(body_part->body, rb->task->data +
+        memcpy(body_part->body + ext_size, rb->task->data +
                 rb->body_offset, rb->body_length);
 
         ++count;
@@ -519,12 +543,17 @@ static int replication_rpc_from_queue(FSReplication *replication)
     }
 
     body_header = (FSProtoReplicaRPCReqBodyHeader *)
-        (task->data + sizeof(FSProtoHeader));
+        (task->data + sizeof(FSProtoHeader) + ext_size);
     body_len = task->length - sizeof(FSProtoHeader);
     int2buff(count, body_header->count);
 
     SF_PROTO_SET_HEADER((FSProtoHeader *)task->data,
             FS_REPLICA_PROTO_RPC_REQ, body_len);
+    if (ext_size > 0) {
+        sf_proto_set_trace_ext((SFProtoTraceExt *)(task->data +
+                    sizeof(FSProtoHeader)), &trace);
+        SF_PROTO_SET_TRACED_MAGIC(((FSProtoHeader *)task->data)->magic);
+    }
     sf_send_add_event(task);
 
     if (replication->last_net_comm_time != g_current_time) {
@@ -271,8 +271,8 @@ static int load_data_path_config(IniContext *ini_context, const char *filename)
 static void server_log_configs()
 {
     char sz_server_config[512];
-    char sz_global_config[512];
-    char sz_slowlog_config[256];
+    char sz_global_config[768];
+    char sz_slowlog_config[512];
     char sz_service_config[128];
     char sz_cluster_config[128];
     char sz_replica_config[128];
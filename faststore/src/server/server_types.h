@@ -119,9 +119,11 @@
 #define FS_EVENT_SOURCE_MASTER_OFFLINE  'm'
 #define FS_EVENT_SOURCE_CS_LEADER       'L'
 
+//including the trace extensions of the request, the RPC and the RPC part
 #define FS_TASK_BUFFER_FRONT_PADDING_SIZE  (sizeof(FSProtoHeader) + \
         4 * sizeof(FSProtoSliceWriteReqHeader) +  \
-        sizeof(FSProtoReplicaRPCReqBodyPart))
+        sizeof(FSProtoReplicaRPCReqBodyPart) + \
+        3 * sizeof(SFProtoTraceExt))
 
 #define TASK_ARG          ((FSServerTaskArg *)task->arg)
 #define TASK_CTX          TASK_ARG->context
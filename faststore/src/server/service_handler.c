@@ -37,6 +37,7 @@
 #include "sf/sf_nio.h"
 #include "sf/sf_service.h"
 #include "sf/sf_global.h"
+#include "sf/sf_metrics.h"
 #include "sf/sf_configs.h"
 #include "sf/idempotency/server/server_channel.h"
 #include "sf/idempotency/server/server_handler.h"
@@ -50,12 +51,35 @@
 #include "server_storage.h"
 #include "server_binlog.h"
 #include "data_thread.h"
+#include "dio/trunk_sync_thread.h"
 #include "common_handler.h"
 #include "data_update_handler.h"
 #include "service_handler.h"
 
 int service_handler_init()
 {
+    static const char *metrics_stage_names[FS_METRICS_STAGE_COUNT] = {
+        "data_queue", "disk_io", "replica_ack"};
+    int result;
+
+    //the slice read does NOT depend on the connection state
+    if ((result=sf_enable_pipeline_cmd(
+                    FS_SERVICE_PROTO_SLICE_READ_REQ)) != 0)
+    {
+        return result;
+    }
+    if ((result=sf_enable_pipeline_cmd(
+                    FS_SERVICE_PROTO_SLICE_SPARSE_READ_REQ)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=sf_metrics_init("fs", fs_get_cmd_caption,
+                    metrics_stage_names, FS_METRICS_STAGE_COUNT)) != 0)
+    {
+        return result;
+    }
+
     return idempotency_channel_init(SF_IDEMPOTENCY_MAX_CHANNEL_ID,
             SF_IDEMPOTENCY_DEFAULT_REQUEST_HINT_CAPACITY,
             SF_IDEMPOTENCY_DEFAULT_CHANNEL_RESERVE_INTERVAL,
@@ -156,38 +180,34 @@ static int service_deal_service_stat(struct fast_task_info *task)
     return 0;
 }
 
-static int service_deal_slice_read(struct fast_task_info *task)
+static int service_push_slice_read(struct fast_task_info *task,
+        const FSProtoBlockSlice *bs, const int front_size)
 {
     int result;
-    FSProtoServiceSliceReadReq *req;
-
-    OP_CTX_INFO.deal_done = false;
-    OP_CTX_INFO.is_update = false;
-    RESPONSE.header.cmd = FS_SERVICE_PROTO_SLICE_READ_RESP;
-    if ((result=server_expect_body_length(task,
-                    sizeof(FSProtoServiceSliceReadReq))) != 0)
-    {
-        return result;
-    }
+    int data_size;
 
-    req = (FSProtoServiceSliceReadReq *)REQUEST.body;
     if ((result=du_handler_parse_check_readable_block_slice(
-                    task, &req->bs)) != 0)
+                    task, bs)) != 0)
     {
         return result;
     }
 
-    if (OP_CTX_INFO.bs_key.slice.length > task->size - sizeof(FSProtoHeader)) {
+    data_size = SLICE_OP_CTX.sparse.extents_only ? 0 :
+        OP_CTX_INFO.bs_key.slice.length;
+    if ((result=sf_task_reserve_buffer(task, sizeof(FSProtoHeader) +
+                    front_size + data_size)) != 0)
+    {
         RESPONSE.error.length = sprintf(RESPONSE.error.message,
                 "read slice length: %d > task buffer size: %d",
-                OP_CTX_INFO.bs_key.slice.length, (int)(
-                    task->size - sizeof(FSProtoHeader)));
-        return EOVERFLOW;
+                data_size, (int)(task->size - sizeof(FSProtoHeader) -
+                    front_size));
+        return result;
     }
+    REQUEST.body = task->data + sizeof(FSProtoHeader);
 
     sf_hold_task(task);
     OP_CTX_INFO.source = BINLOG_SOURCE_RPC_MASTER;
-    OP_CTX_INFO.buff = REQUEST.body;
+    OP_CTX_INFO.buff = REQUEST.body + front_size;
     OP_CTX_NOTIFY_FUNC = du_handler_slice_read_done_notify;
     if ((result=push_to_data_thread_queue(DATA_OPERATION_SLICE_READ,
                     DATA_SOURCE_MASTER_SERVICE, task, &SLICE_OP_CTX)) != 0)
@@ -201,6 +221,52 @@ static int service_deal_slice_read(struct fast_task_info *task)
     return TASK_STATUS_CONTINUE;
 }
 
+static int service_deal_slice_read(struct fast_task_info *task)
+{
+    int result;
+    FSProtoServiceSliceReadReq *req;
+
+    OP_CTX_INFO.deal_done = false;
+    OP_CTX_INFO.is_update = false;
+    RESPONSE.header.cmd = FS_SERVICE_PROTO_SLICE_READ_RESP;
+    if ((result=server_expect_body_length(task,
+                    sizeof(FSProtoServiceSliceReadReq))) != 0)
+    {
+        return result;
+    }
+
+    req = (FSProtoServiceSliceReadReq *)REQUEST.body;
+    SLICE_OP_CTX.sparse.enabled = false;
+    SLICE_OP_CTX.sparse.extents_only = false;
+    return service_push_slice_read(task, &req->bs, 0);
+}
+
+static int service_deal_slice_sparse_read(struct fast_task_info *task)
+{
+    int result;
+    int front_size;
+    FSProtoServiceSliceSparseReadReq *req;
+
+    OP_CTX_INFO.deal_done = false;
+    OP_CTX_INFO.is_update = false;
+    RESPONSE.header.cmd = FS_SERVICE_PROTO_SLICE_SPARSE_READ_RESP;
+    if ((result=server_expect_body_length(task,
+                    sizeof(FSProtoServiceSliceSparseReadReq))) != 0)
+    {
+        return result;
+    }
+
+    req = (FSProtoServiceSliceSparseReadReq *)REQUEST.body;
+    SLICE_OP_CTX.sparse.enabled = true;
+    SLICE_OP_CTX.sparse.extents_only = (req->flags &
+            FS_SPARSE_READ_FLAGS_EXTENTS_ONLY) != 0;
+    front_size = sizeof(FSProtoSliceSparseReadRespHeader);
+    if (!SLICE_OP_CTX.sparse.extents_only) {
+        front_size += sizeof(FSProtoSliceSize);  //for dense response
+    }
+    return service_push_slice_read(task, &req->bs, front_size);
+}
+
 static int service_deal_get_master(struct fast_task_info *task)
 {
     int result;
@@ -416,6 +482,40 @@ static int service_deal_disk_space_stat(struct fast_task_info *task)
     return 0;
 }
 
+static void service_commit_done_notify(void *arg, const int result)
+{
+    struct fast_task_info *task;
+
+    task = (struct fast_task_info *)arg;
+    if (result != 0) {
+        RESPONSE.error.length = snprintf(RESPONSE.error.message,
+                sizeof(RESPONSE.error.message), "commit fail, "
+                "error info: %s", STRERROR(result));
+    }
+
+    RESPONSE_STATUS = result;
+    sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
+    sf_release_task(task);
+}
+
+static int service_deal_commit(struct fast_task_info *task)
+{
+    int result;
+
+    RESPONSE.header.cmd = FS_SERVICE_PROTO_COMMIT_RESP;
+    if ((result=server_expect_body_length(task, 0)) != 0) {
+        return result;
+    }
+
+    sf_hold_task(task);
+    if ((result=trunk_sync_commit(service_commit_done_notify, task)) != 0) {
+        sf_release_task(task);
+        return result;
+    }
+
+    return TASK_STATUS_CONTINUE;
+}
+
 static int service_update_prepare_and_check(struct fast_task_info *task,
         const int resp_cmd)
 {
@@ -547,6 +647,24 @@ static inline int service_deal_block_delete(struct fast_task_info *task)
     return result;
 }
 
+static inline int service_deal_slice_clone(struct fast_task_info *task)
+{
+    int result;
+
+    result = service_update_prepare_and_check(task,
+            FS_SERVICE_PROTO_SLICE_CLONE_RESP);
+    if (result != 0 || OP_CTX_INFO.deal_done) {
+        return result;
+    }
+
+    if ((result=du_handler_deal_slice_clone(task, &SLICE_OP_CTX)) !=
+            TASK_STATUS_CONTINUE)
+    {
+        du_handler_idempotency_request_finish(task, result);
+    }
+    return result;
+}
+
 int service_deal_task(struct fast_task_info *task, const int stage)
 {
     int result;
@@ -582,6 +700,13 @@ int service_deal_task(struct fast_task_info *task, const int stage)
             case FS_SERVICE_PROTO_SERVICE_STAT_REQ:
                 result = service_deal_service_stat(task);
                 break;
+            case SF_SERVICE_PROTO_GET_METRICS_REQ:
+                if ((result=sf_proto_deal_get_metrics(task,
+                                &REQUEST, &RESPONSE)) == 0)
+                {
+                    TASK_ARG->context.response_done = true;
+                }
+                break;
             case FS_SERVICE_PROTO_SLICE_WRITE_REQ:
                 result = service_deal_slice_write(task);
                 break;
@@ -594,9 +719,18 @@ int service_deal_task(struct fast_task_info *task, const int stage)
             case FS_SERVICE_PROTO_BLOCK_DELETE_REQ:
                 result = service_deal_block_delete(task);
                 break;
+            case FS_SERVICE_PROTO_SLICE_CLONE_REQ:
+                result = service_deal_slice_clone(task);
+                break;
             case FS_SERVICE_PROTO_SLICE_READ_REQ:
                 result = service_deal_slice_read(task);
                 break;
+            case FS_SERVICE_PROTO_SLICE_SPARSE_READ_REQ:
+                result = service_deal_slice_sparse_read(task);
+                break;
+            case FS_SERVICE_PROTO_COMMIT_REQ:
+                result = service_deal_commit(task);
+                break;
             case FS_SERVICE_PROTO_GET_MASTER_REQ:
                 result = service_deal_get_master(task);
                 break;
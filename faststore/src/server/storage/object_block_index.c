@@ -1066,6 +1066,215 @@ int ob_index_get_slices_ex(OBHashtable *htable,
     return result;
 }
 
+static inline void get_bucket_and_ctx(OBHashtable *htable,
+        const FSBlockKey *bkey, OBEntry ***bucket, OBSharedContext **ctx)
+{
+    int64_t bucket_index;
+
+    bucket_index = FS_BLOCK_HASH_CODE(*bkey) % htable->capacity;
+    *bucket = htable->buckets + bucket_index;
+    *ctx = ob_shared_ctx_array.contexts + bucket_index %
+        ob_shared_ctx_array.count;
+}
+
+static void unaccount_slices(OBHashtable *htable,
+        OBSlicePtrArray *sarray, const int count)
+{
+    int i;
+
+    if (htable->modify_sallocator) {
+        for (i=0; i<count; i++) {
+            storage_allocator_delete_slice(sarray->slices[i],
+                    htable->modify_used_space);
+        }
+    }
+    free_slices(sarray);
+}
+
+static int clone_slices(OBHashtable *htable, OBSharedContext *src_ctx,
+        OBEntry *src_ob, const FSBlockSliceKeyInfo *src_bs_key,
+        OBSharedContext *dest_ctx, OBEntry *dest_ob,
+        const FSBlockSliceKeyInfo *dest_bs_key, OBSlicePtrArray *sarray,
+        uint64_t *del_sn, uint64_t *add_sn, int *inc_alloc)
+{
+    OBSlicePtrArray src_sarray;
+    OBSliceEntry **pp;
+    OBSliceEntry **end;
+    OBSliceEntry *slice;
+    int result;
+    int accounted;
+    int count;
+    int dec_alloc;
+
+    ob_index_init_slice_ptr_array(&src_sarray);
+    if (src_ob != NULL) {
+        if ((result=get_slices(src_ctx, src_ob, src_bs_key,
+                        &src_sarray)) != 0 && result != ENOENT)
+        {
+            free_slices(&src_sarray);
+            ob_index_free_slice_ptr_array(&src_sarray);
+            return result;
+        }
+    }
+
+    /* account the shared space first for rollback */
+    result = 0;
+    accounted = 0;
+    end = src_sarray.slices + src_sarray.count;
+    for (pp=src_sarray.slices; pp<end; pp++) {
+        slice = (OBSliceEntry *)fast_mblock_alloc_object(
+                &dest_ctx->slice_allocator);
+        if (slice == NULL) {
+            result = ENOMEM;
+            break;
+        }
+
+        slice->ob = dest_ob;
+        slice->type = (*pp)->type;
+        slice->space = (*pp)->space;
+        slice->ssize.offset = dest_bs_key->slice.offset +
+            ((*pp)->ssize.offset - src_bs_key->slice.offset);
+        slice->ssize.length = (*pp)->ssize.length;
+        slice->space.size = slice->ssize.length;
+        __sync_add_and_fetch(&slice->ref_count, 1);
+        if ((result=add_to_slice_ptr_array(sarray, slice)) != 0) {
+            ob_index_free_slice(slice);
+            break;
+        }
+
+        if (htable->modify_sallocator) {
+            if ((result=storage_allocator_add_shared_slice(slice,
+                            htable->modify_used_space)) != 0)
+            {
+                break;
+            }
+        }
+        accounted++;
+    }
+
+    free_slices(&src_sarray);
+    ob_index_free_slice_ptr_array(&src_sarray);
+    if (result != 0) {
+        unaccount_slices(htable, sarray, accounted);
+        return result;
+    }
+
+    *inc_alloc = 0;
+    if ((result=delete_slices(htable, dest_ctx, dest_ob, dest_bs_key,
+                    &count, &dec_alloc)) == 0)
+    {
+        *del_sn = __sync_add_and_fetch(&SLICE_BINLOG_SN, 1);
+        *inc_alloc -= dec_alloc;
+    } else if (result == ENOENT) {
+        *del_sn = 0;
+    } else {
+        unaccount_slices(htable, sarray, accounted);
+        return result;
+    }
+
+    end = sarray->slices + sarray->count;
+    for (pp=sarray->slices; pp<end; pp++) {
+        if ((result=uniq_skiplist_insert(dest_ob->slices, *pp)) != 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "add slice to skiplist fail, errno: %d, "
+                    "error info: %s", __LINE__, result, STRERROR(result));
+
+            /* rollback the inserted slices, the free func of
+             * the skiplist releases the references of them */
+            while (pp > sarray->slices) {
+                --pp;
+                *inc_alloc -= (*pp)->ssize.length;
+                uniq_skiplist_delete(dest_ob->slices, *pp);
+            }
+            unaccount_slices(htable, sarray, accounted);
+            return result;
+        }
+        __sync_add_and_fetch(&(*pp)->ref_count, 1);
+        *inc_alloc += (*pp)->ssize.length;
+    }
+
+    if (sarray->count > 0) {
+        *add_sn = __sync_add_and_fetch(&SLICE_BINLOG_SN,
+                sarray->count) - sarray->count + 1;
+    } else {
+        *add_sn = 0;
+    }
+    return 0;
+}
+
+int ob_index_clone_slices_ex(OBHashtable *htable,
+        const FSBlockSliceKeyInfo *src_bs_key,
+        const FSBlockSliceKeyInfo *dest_bs_key, OBSlicePtrArray *sarray,
+        uint64_t *del_sn, uint64_t *add_sn, int *inc_alloc)
+{
+    OBEntry **src_bucket;
+    OBEntry **dest_bucket;
+    OBSharedContext *src_ctx;
+    OBSharedContext *dest_ctx;
+    OBSharedContext *first_ctx;
+    OBSharedContext *second_ctx;
+    OBEntry *src_ob;
+    OBEntry *dest_ob;
+    OBEntry *previous;
+    int result;
+
+    sarray->count = 0;
+    *del_sn = *add_sn = 0;
+    *inc_alloc = 0;
+    get_bucket_and_ctx(htable, &src_bs_key->block, &src_bucket, &src_ctx);
+    get_bucket_and_ctx(htable, &dest_bs_key->block, &dest_bucket, &dest_ctx);
+
+    //lock by address order to avoid deadlock
+    if (src_ctx == dest_ctx) {
+        first_ctx = src_ctx;
+        second_ctx = NULL;
+    } else if (src_ctx < dest_ctx) {
+        first_ctx = src_ctx;
+        second_ctx = dest_ctx;
+    } else {
+        first_ctx = dest_ctx;
+        second_ctx = src_ctx;
+    }
+
+    PTHREAD_MUTEX_LOCK(&first_ctx->lcp.lock);
+    if (second_ctx != NULL) {
+        PTHREAD_MUTEX_LOCK(&second_ctx->lcp.lock);
+    }
+
+    do {
+        src_ob = get_ob_entry(src_ctx, src_bucket, &src_bs_key->block, false);
+        dest_ob = get_ob_entry_ex(dest_ctx, dest_bucket,
+                &dest_bs_key->block, true, &previous);
+        if (dest_ob == NULL) {
+            result = ENOMEM;
+            break;
+        }
+
+        /* can't wait the condition with two locks held, the caller retries */
+        if ((src_ob != NULL && src_ob->reclaiming_count > 0) ||
+                dest_ob->reclaiming_count > 0)
+        {
+            result = EBUSY;
+        } else {
+            result = clone_slices(htable, src_ctx, src_ob, src_bs_key,
+                    dest_ctx, dest_ob, dest_bs_key, sarray,
+                    del_sn, add_sn, inc_alloc);
+        }
+
+        if (uniq_skiplist_empty(dest_ob->slices)) {
+            OB_INDEX_DELETE_OB_ENTRY(dest_ctx, dest_bucket,
+                    dest_ob, previous);
+        }
+    } while (0);
+
+    if (second_ctx != NULL) {
+        PTHREAD_MUTEX_UNLOCK(&second_ctx->lcp.lock);
+    }
+    PTHREAD_MUTEX_UNLOCK(&first_ctx->lcp.lock);
+
+    return result;
+}
+
 void ob_index_get_ob_and_slice_counts(int64_t *ob_count, int64_t *slice_count)
 {
     OBSharedContext *ctx;
@@ -40,6 +40,11 @@ extern "C" {
 #define ob_index_get_ob_entry(bkey) \
     ob_index_get_ob_entry_ex(&g_ob_hashtable, bkey)
 
+#define ob_index_clone_slices(src_bs_key, dest_bs_key, \
+        sarray, del_sn, add_sn, inc_alloc) \
+    ob_index_clone_slices_ex(&g_ob_hashtable, src_bs_key, \
+            dest_bs_key, sarray, del_sn, add_sn, inc_alloc)
+
 #define ob_index_alloc_slice(bkey) \
     ob_index_alloc_slice_ex(&g_ob_hashtable, bkey, 1)
 
@@ -77,6 +82,15 @@ extern "C" {
             const FSBlockSliceKeyInfo *bs_key,
             OBSlicePtrArray *sarray, const bool is_reclaim);
 
+    /* make the slices of the dest range share the space of the src range,
+     * the new slices with one reference are returned by sarray, del_sn is
+     * 0 when no slice deleted and the sn of sarray->slices[i] is add_sn + i.
+     * return EBUSY when the block or the space is in reclaiming */
+    int ob_index_clone_slices_ex(OBHashtable *htable,
+            const FSBlockSliceKeyInfo *src_bs_key,
+            const FSBlockSliceKeyInfo *dest_bs_key, OBSlicePtrArray *sarray,
+            uint64_t *del_sn, uint64_t *add_sn, int *inc_alloc);
+
     static inline void ob_index_init_slice_ptr_array(OBSlicePtrArray *sarray)
     {
         sarray->slices = NULL;
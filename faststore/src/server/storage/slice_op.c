@@ -44,6 +44,46 @@ static int realloc_slice_sn_pairs(FSSliceSNPairArray *parray,
     return 0;
 }
 
+static int realloc_slice_extents(FSSliceSizeArray *array,
+        const int capacity)
+{
+    FSSliceSize *ssizes;
+    int alloc;
+
+    alloc = (array->alloc > 0) ? array->alloc : 16;
+    while (alloc < capacity) {
+        alloc *= 2;
+    }
+
+    ssizes = (FSSliceSize *)fc_malloc(sizeof(FSSliceSize) * alloc);
+    if (ssizes == NULL) {
+        return ENOMEM;
+    }
+
+    if (array->ssizes != NULL) {
+        free(array->ssizes);
+    }
+    array->alloc = alloc;
+    array->ssizes = ssizes;
+    return 0;
+}
+
+static inline void add_slice_extent(FSSliceSizeArray *array,
+        const FSSliceSize *ssize)
+{
+    FSSliceSize *last;
+
+    if (array->count > 0) {
+        last = array->ssizes + (array->count - 1);
+        if (last->offset + last->length == ssize->offset) {
+            last->length += ssize->length;
+            return;
+        }
+    }
+
+    array->ssizes[array->count++] = *ssize;
+}
+
 static inline void set_data_version(FSSliceOpContext *op_ctx)
 {
     uint64_t old_version;
@@ -583,16 +623,31 @@ int fs_slice_read(FSSliceOpContext *op_ctx)
             op_ctx->info.bs_key.slice.length);
             */
 
+    end = op_ctx->slice_ptr_array.slices + op_ctx->slice_ptr_array.count;
+    if (op_ctx->sparse.enabled) {
+        op_ctx->sparse.extents.count = 0;
+        if (op_ctx->sparse.extents.alloc < op_ctx->slice_ptr_array.count &&
+                (result=realloc_slice_extents(&op_ctx->sparse.extents,
+                    op_ctx->slice_ptr_array.count)) != 0)
+        {
+            for (pp=op_ctx->slice_ptr_array.slices; pp<end; pp++) {
+                ob_index_free_slice(*pp);
+            }
+            return result;
+        }
+    }
+
     op_ctx->result = 0;
     op_ctx->done_bytes = 0;
     op_ctx->counter = op_ctx->slice_ptr_array.count;
     ps = op_ctx->info.buff;
     offset = op_ctx->info.bs_key.slice.offset;
-    end = op_ctx->slice_ptr_array.slices + op_ctx->slice_ptr_array.count;
     for (pp=op_ctx->slice_ptr_array.slices; pp<end; pp++) {
         hole_len = (*pp)->ssize.offset - offset;
         if (hole_len > 0) {
-            memset(ps, 0, hole_len);
+            if (!op_ctx->sparse.enabled) {
+                memset(ps, 0, hole_len);
+            }
             ps += hole_len;
             op_ctx->done_bytes += hole_len;
 
@@ -607,13 +662,23 @@ int fs_slice_read(FSSliceOpContext *op_ctx)
 
         ssize = (*pp)->ssize;
         if ((*pp)->type == OB_SLICE_TYPE_ALLOC) {
-            memset(ps, 0, (*pp)->ssize.length);
+            if (!op_ctx->sparse.enabled) {
+                memset(ps, 0, (*pp)->ssize.length);
+            }
             do_read_done(*pp, op_ctx, 0);
-        } else if ((result=io_thread_push_slice_op(FS_IO_TYPE_READ_SLICE,
-                        *pp, ps, slice_read_done, op_ctx)) != 0)
-        {
-            ob_index_free_slice(*pp);
-            break;
+        } else {
+            if (op_ctx->sparse.enabled) {
+                add_slice_extent(&op_ctx->sparse.extents, &ssize);
+            }
+
+            if (op_ctx->sparse.extents_only) {
+                do_read_done(*pp, op_ctx, 0);
+            } else if ((result=io_thread_push_slice_op(FS_IO_TYPE_READ_SLICE,
+                            *pp, ps, slice_read_done, op_ctx)) != 0)
+            {
+                ob_index_free_slice(*pp);
+                break;
+            }
         }
 
         ps += ssize.length;
@@ -694,3 +759,71 @@ int fs_log_delete_block(FSSliceOpContext *op_ctx)
 
     return 0;
 }
+
+int fs_clone_slices(FSSliceOpContext *op_ctx)
+{
+    int result;
+
+    /* the update of the slave can't fail, so wait the reclaiming done */
+    while ((result=ob_index_clone_slices(&op_ctx->info.src_bs_key,
+                    &op_ctx->info.bs_key, &op_ctx->slice_ptr_array,
+                    &op_ctx->info.sn, &op_ctx->update.clone_sn,
+                    &op_ctx->update.space_changed)) == EBUSY &&
+            SF_G_CONTINUE_FLAG)
+    {
+        fc_sleep_ms(10);
+    }
+
+    if (result == 0) {
+        set_data_version(op_ctx);
+    } else if (op_ctx->info.sn > 0) {
+        /* the dest slices are deleted before the clone fails,
+         * log the deletion with the reserved SN */
+        slice_binlog_log_del_slice(&op_ctx->info.bs_key, g_current_time,
+                op_ctx->info.sn, op_ctx->info.data_version,
+                op_ctx->info.source);
+    }
+    return result;
+}
+
+int fs_log_clone_slices(FSSliceOpContext *op_ctx)
+{
+    OBSliceEntry **pp;
+    OBSliceEntry **end;
+    time_t current_time;
+    uint64_t sn;
+    int result;
+    int r;
+
+    result = 0;
+    current_time = g_current_time;
+    if (op_ctx->info.sn > 0) {
+        result = slice_binlog_log_del_slice(&op_ctx->info.bs_key,
+                current_time, op_ctx->info.sn, op_ctx->info.
+                data_version, op_ctx->info.source);
+    }
+
+    sn = op_ctx->update.clone_sn;
+    end = op_ctx->slice_ptr_array.slices + op_ctx->slice_ptr_array.count;
+    for (pp=op_ctx->slice_ptr_array.slices; pp<end; pp++) {
+        /* log all slices even if fail to keep the reserved SNs */
+        if ((r=slice_binlog_log_add_slice(*pp, current_time,
+                        sn++, op_ctx->info.data_version,
+                        op_ctx->info.source)) != 0 && result == 0)
+        {
+            result = r;
+        }
+        ob_index_free_slice(*pp);
+    }
+    op_ctx->slice_ptr_array.count = 0;
+
+    /* the replicas to recover fetch the data as a normal write */
+    if (result == 0 && op_ctx->info.write_binlog.log_replica) {
+        result = replica_binlog_log_write_slice(current_time,
+                op_ctx->info.data_group_id, op_ctx->info.
+                data_version, &op_ctx->info.bs_key,
+                op_ctx->info.source);
+    }
+
+    return result;
+}
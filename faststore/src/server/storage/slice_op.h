@@ -55,10 +55,14 @@ extern "C" {
     int fs_delete_slices(FSSliceOpContext *op_ctx);
     int fs_delete_block(FSSliceOpContext *op_ctx);
 
+    /* the slices of bs_key share the space of src_bs_key */
+    int fs_clone_slices(FSSliceOpContext *op_ctx);
+
     int fs_log_slice_write(FSSliceOpContext *op_ctx);
     int fs_log_slice_allocate(FSSliceOpContext *op_ctx);
     int fs_log_delete_slices(FSSliceOpContext *op_ctx);
     int fs_log_delete_block(FSSliceOpContext *op_ctx);
+    int fs_log_clone_slices(FSSliceOpContext *op_ctx);
 
 #ifdef __cplusplus
 }
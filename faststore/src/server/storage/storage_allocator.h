@@ -149,6 +149,28 @@ extern "C" {
         return trunk_allocator_add_slice(allocator, slice);
     }
 
+    /* add the slice which shares the space of another slice,
+     * return EBUSY when the trunk is reclaiming */
+    static inline int storage_allocator_add_shared_slice(
+            OBSliceEntry *slice, const bool modify_used_space)
+    {
+        FSTrunkAllocator *allocator;
+        int result;
+
+        allocator = g_allocator_mgr->allocator_ptr_array.
+            allocators[slice->space.store->index];
+        if ((result=trunk_allocator_add_slice_ex(allocator,
+                        slice, true)) != 0)
+        {
+            return result;
+        }
+        if (modify_used_space) {
+            __sync_add_and_fetch(&allocator->path_info->
+                    trunk_stat.used, slice->space.size);
+        }
+        return 0;
+    }
+
     static inline int storage_allocator_delete_slice(OBSliceEntry *slice,
             const bool modify_used_space)
     {
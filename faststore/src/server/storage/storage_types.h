@@ -62,6 +62,12 @@ typedef struct {
     FSSliceSNPair *slice_sn_pairs;
 } FSSliceSNPairArray;
 
+typedef struct {
+    int count;
+    int alloc;
+    FSSliceSize *ssizes;
+} FSSliceSizeArray;
+
 typedef enum ob_slice_type {
     OB_SLICE_TYPE_FILE  = 'F', /* in file slice */
     OB_SLICE_TYPE_ALLOC = 'A'  /* allocate slice (index and space allocate only) */
@@ -126,6 +132,7 @@ typedef struct fs_slice_op_context {
         uint64_t data_version;  //for replica binlog
         uint64_t sn;            //for slice binlog
         FSBlockSliceKeyInfo bs_key;
+        FSBlockSliceKeyInfo src_bs_key;  //for slice clone
         struct fs_cluster_data_server_info *myself;
         int body_len;
         char *body;
@@ -135,8 +142,15 @@ typedef struct fs_slice_op_context {
     struct {
         int space_changed;  //increase /decrease space in bytes for slice operate
         FSSliceSNPairArray sarray;
+        uint64_t clone_sn;  //the slice binlog sn of the first cloned slice
     } update;  //for slice update
 
+    struct {
+        bool enabled;       //skip the holes instead of zero filling
+        bool extents_only;  //get the data extents without reading
+        FSSliceSizeArray extents;  //the data extents, ALLOC slices exclusive
+    } sparse;  //for slice read
+
     struct ob_slice_ptr_array slice_ptr_array;
 
 } FSSliceOpContext;
@@ -157,6 +171,7 @@ typedef struct fs_trunk_file_info {
     } used;
     int64_t size;        //file size
     int64_t free_start;  //free space offset
+    int64_t sync_round;  //the round of the trunk sync when marked dirty
 
     struct {
         struct fs_trunk_file_info *next;
@@ -167,6 +167,7 @@ int trunk_allocator_add(FSTrunkAllocator *allocator,
     trunk_info->used.bytes = 0;
     trunk_info->used.count = 0;
     trunk_info->free_start = 0;
+    trunk_info->sync_round = -1;
     PTHREAD_MUTEX_UNLOCK(&allocator->freelist.lcp.lock);
 
     PTHREAD_MUTEX_LOCK(&allocator->trunks.lock);
@@ -201,6 +202,28 @@ int trunk_allocator_delete(FSTrunkAllocator *allocator, const int64_t id)
     return result;
 }
 
+int64_t trunk_allocator_set_sync_round(FSTrunkAllocator *allocator,
+        const int64_t id, const int64_t round)
+{
+    FSTrunkFileInfo target;
+    FSTrunkFileInfo *trunk_info;
+    int64_t old_round;
+
+    target.id_info.id = id;
+    PTHREAD_MUTEX_LOCK(&allocator->trunks.lock);
+    if ((trunk_info=(FSTrunkFileInfo *)uniq_skiplist_find(
+                    allocator->trunks.by_id, &target)) != NULL)
+    {
+        old_round = trunk_info->sync_round;
+        trunk_info->sync_round = round;
+    } else {
+        old_round = -1;
+    }
+    PTHREAD_MUTEX_UNLOCK(&allocator->trunks.lock);
+
+    return old_round;
+}
+
 FSTrunkFreelistType trunk_allocator_add_to_freelist(
         FSTrunkAllocator *allocator, FSTrunkFileInfo *trunk_info)
 {
@@ -221,7 +244,8 @@ FSTrunkFreelistType trunk_allocator_add_to_freelist(
         fs_freelist_type_reclaim;
 }
 
-int trunk_allocator_add_slice(FSTrunkAllocator *allocator, OBSliceEntry *slice)
+int trunk_allocator_add_slice_ex(FSTrunkAllocator *allocator,
+        OBSliceEntry *slice, const bool check_reclaiming)
 {
     int result;
     FSTrunkFileInfo target;
@@ -237,6 +261,11 @@ int trunk_allocator_add_slice(FSTrunkAllocator *allocator, OBSliceEntry *slice)
                 __LINE__, allocator->path_info->store.index,
                 slice->space.id_info.id);
         result = ENOENT;
+    } else if (check_reclaiming && __sync_add_and_fetch(&trunk_info->
+                status, 0) == FS_TRUNK_STATUS_RECLAIMING)
+    {
+        /* the slice list of the reclaiming trunk maybe taken already */
+        result = EBUSY;
     } else {
         /* for loading slice binlog */
         if (!g_trunk_allocator_vars.data_load_done &&
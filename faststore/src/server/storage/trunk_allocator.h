@@ -105,11 +105,20 @@ extern "C" {
 
     int trunk_allocator_delete(FSTrunkAllocator *allocator, const int64_t id);
 
+    /* set the sync round of the trunk for the dirty trunk dedup,
+     * return the old round, -1 when the trunk not exist */
+    int64_t trunk_allocator_set_sync_round(FSTrunkAllocator *allocator,
+            const int64_t id, const int64_t round);
+
     int trunk_allocator_free(FSTrunkAllocator *allocator,
             const int id, const int size);
 
-    int trunk_allocator_add_slice(FSTrunkAllocator *allocator,
-            OBSliceEntry *slice);
+    /* return EBUSY when check_reclaiming and the trunk is reclaiming */
+    int trunk_allocator_add_slice_ex(FSTrunkAllocator *allocator,
+            OBSliceEntry *slice, const bool check_reclaiming);
+
+#define trunk_allocator_add_slice(allocator, slice) \
+    trunk_allocator_add_slice_ex(allocator, slice, false)
 
     int trunk_allocator_delete_slice(FSTrunkAllocator *allocator,
             OBSliceEntry *slice);
@@ -50,6 +50,8 @@ int trunk_reclaim_init_ctx(TrunkReclaimContext *rctx)
     rctx->op_ctx.info.write_binlog.log_replica = false;
     rctx->op_ctx.info.data_version = 0;
     rctx->op_ctx.info.myself = NULL;
+    rctx->op_ctx.sparse.enabled = false;
+    rctx->op_ctx.sparse.extents_only = false;
     rctx->buffer_size = 256 * 1024;
     rctx->op_ctx.info.buff = (char *)fc_malloc(rctx->buffer_size);
     if (rctx->op_ctx.info.buff == NULL) {
@@ -37,6 +37,33 @@ struct _fast_mblock_manager
 
 static struct _fast_mblock_manager mblock_manager = {false, 0};
 
+/* the thread local free node cache of the mblock */
+struct fast_mblock_magazine
+{
+    struct fast_mblock_man *mblock;
+    int64_t version;   //the magazine version of the mblock
+    struct fast_mblock_node *head;  //the cached free nodes
+    volatile int count;             //the cached node count
+    struct fast_mblock_magazine *next;  //for the magazine list of the mblock
+};
+
+struct _fast_mblock_magazine_context
+{
+    pthread_once_t once;
+    pthread_key_t key;   //for flushing the magazines when the thread exits
+    int key_result;
+    int64_t current_version;
+    struct fast_mblock_man *mblocks[FAST_MBLOCK_MAX_MAGAZINE_SLOTS];
+    pthread_mutex_t lock;
+};
+
+static struct _fast_mblock_magazine_context magazine_ctx = {
+    PTHREAD_ONCE_INIT, 0, 0, 0, {NULL}, PTHREAD_MUTEX_INITIALIZER
+};
+
+static __thread struct fast_mblock_magazine
+    *tls_magazines[FAST_MBLOCK_MAX_MAGAZINE_SLOTS];
+
 #define fast_mblock_get_trunk_size(mblock, block_size, element_count) \
     (sizeof(struct fast_mblock_malloc) + block_size * element_count)
 
@@ -117,6 +144,30 @@ static void delete_from_mblock_list(struct fast_mblock_man *mblock)
     INIT_HEAD(mblock);
 }
 
+static int64_t fast_mblock_get_used_count(struct fast_mblock_man *mblock)
+{
+    struct fast_mblock_magazine *magazine;
+    int64_t used_count;
+
+    if (mblock->magazine.slot < 0)
+    {
+        return mblock->info.element_used_count;
+    }
+
+    /* the elements cached by the magazines are free for the user */
+    pthread_mutex_lock(&mblock->lcp.lock);
+    used_count = mblock->info.element_used_count;
+    magazine = mblock->magazine.head;
+    while (magazine != NULL)
+    {
+        used_count -= magazine->count;
+        magazine = magazine->next;
+    }
+    pthread_mutex_unlock(&mblock->lcp.lock);
+
+    return used_count;
+}
+
 #define STAT_DUP(pStat, current, copy_name) \
     do { \
         if (copy_name) { \
@@ -125,7 +176,7 @@ static void delete_from_mblock_list(struct fast_mblock_man *mblock)
             pStat->element_size = current->info.element_size; \
         } \
         pStat->element_total_count += current->info.element_total_count;  \
-        pStat->element_used_count += current->info.element_used_count;    \
+        pStat->element_used_count += fast_mblock_get_used_count(current); \
         pStat->delay_free_elements += current->info.delay_free_elements;  \
         pStat->trunk_total_count += current->info.trunk_total_count;  \
         pStat->trunk_used_count += current->info.trunk_used_count;    \
@@ -430,6 +481,11 @@ int fast_mblock_init_ex2(struct fast_mblock_man *mblock, const char *name,
     mblock->malloc_trunk_callback.check_func = malloc_trunk_check;
     mblock->malloc_trunk_callback.notify_func = malloc_trunk_notify;
     mblock->malloc_trunk_callback.args = malloc_trunk_args;
+    mblock->magazine.slot = -1;
+    mblock->magazine.version = 0;
+    mblock->magazine.capacity = 0;
+    mblock->magazine.batch = 0;
+    mblock->magazine.head = NULL;
 
     if (name != NULL)
     {
@@ -596,6 +652,16 @@ void fast_mblock_destroy(struct fast_mblock_man *mblock)
 	struct fast_mblock_malloc *pMallocNode;
 	struct fast_mblock_malloc *pMallocTmp;
 
+    if (mblock->magazine.slot >= 0)
+    {
+        /* the magazines are freed by their threads */
+        pthread_mutex_lock(&magazine_ctx.lock);
+        magazine_ctx.mblocks[mblock->magazine.slot] = NULL;
+        pthread_mutex_unlock(&magazine_ctx.lock);
+        mblock->magazine.slot = -1;
+        mblock->magazine.head = NULL;
+    }
+
 	if (IS_EMPTY(&mblock->trunks.head))
 	{
         delete_from_mblock_list(mblock);
@@ -623,11 +689,288 @@ void fast_mblock_destroy(struct fast_mblock_man *mblock)
     delete_from_mblock_list(mblock);
 }
 
+/* take a node from the free chain or the delay free chain,
+   should be called with the lock held */
+static struct fast_mblock_node *fast_mblock_take_node(
+        struct fast_mblock_man *mblock)
+{
+	struct fast_mblock_node *pNode;
+
+    if (mblock->free_chain_head != NULL)
+    {
+        pNode = mblock->free_chain_head;
+        mblock->free_chain_head = pNode->next;
+        return pNode;
+    }
+
+    if (mblock->delay_free_chain.head != NULL &&
+            mblock->delay_free_chain.head->
+            recycle_timestamp <= get_current_time())
+    {
+        pNode = mblock->delay_free_chain.head;
+        mblock->delay_free_chain.head = pNode->next;
+        if (mblock->delay_free_chain.tail == pNode)
+        {
+            mblock->delay_free_chain.tail = NULL;
+        }
+
+        mblock->info.delay_free_elements--;
+        return pNode;
+    }
+
+    if (fast_mblock_prealloc(mblock) == 0)
+    {
+        pNode = mblock->free_chain_head;
+        mblock->free_chain_head = pNode->next;
+        return pNode;
+    }
+
+    return NULL;
+}
+
+static void magazine_key_destroy(void *ptr);
+
+static void magazine_key_init()
+{
+    magazine_ctx.key_result = pthread_key_create(
+            &magazine_ctx.key, magazine_key_destroy);
+}
+
+int fast_mblock_enable_magazine(struct fast_mblock_man *mblock,
+        const int capacity)
+{
+    int slot;
+
+    if (!mblock->need_lock || mblock->alloc_elements.limit > 0 ||
+            capacity <= 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "need_lock: %d != 1 or alloc_elements.limit: %"PRId64" > 0 "
+                "or capacity: %d <= 0", __LINE__, mblock->need_lock,
+                mblock->alloc_elements.limit, capacity);
+        return EINVAL;
+    }
+
+    pthread_once(&magazine_ctx.once, magazine_key_init);
+    if (magazine_ctx.key_result != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "call pthread_key_create fail, "
+                "errno: %d, error info: %s", __LINE__,
+                magazine_ctx.key_result, STRERROR(magazine_ctx.key_result));
+        return magazine_ctx.key_result;
+    }
+
+    if (mblock->magazine.slot < 0)
+    {
+        pthread_mutex_lock(&magazine_ctx.lock);
+        for (slot=0; slot<FAST_MBLOCK_MAX_MAGAZINE_SLOTS; slot++)
+        {
+            if (magazine_ctx.mblocks[slot] == NULL)
+            {
+                magazine_ctx.mblocks[slot] = mblock;
+                break;
+            }
+        }
+        if (slot < FAST_MBLOCK_MAX_MAGAZINE_SLOTS)
+        {
+            mblock->magazine.version = ++magazine_ctx.current_version;
+        }
+        pthread_mutex_unlock(&magazine_ctx.lock);
+
+        if (slot == FAST_MBLOCK_MAX_MAGAZINE_SLOTS)
+        {
+            logError("file: "__FILE__", line: %d, "
+                    "mblock %s, the magazine slots exceed %d", __LINE__,
+                    mblock->info.name, FAST_MBLOCK_MAX_MAGAZINE_SLOTS);
+            return ENOSPC;
+        }
+    }
+    else
+    {
+        slot = mblock->magazine.slot;
+    }
+
+    mblock->magazine.capacity = capacity;
+    mblock->magazine.batch = (capacity + 1) / 2;
+    mblock->magazine.slot = slot;
+    return 0;
+}
+
+/* return the cached nodes to the free chain,
+   should be called with the lock held */
+static void magazine_flush(struct fast_mblock_magazine *magazine,
+        const int count)
+{
+    struct fast_mblock_man *mblock;
+	struct fast_mblock_node *pNode;
+    int i;
+
+    mblock = magazine->mblock;
+    for (i=0; i<count && magazine->head != NULL; i++)
+    {
+        pNode = magazine->head;
+        magazine->head = pNode->next;
+        pNode->next = mblock->free_chain_head;
+        mblock->free_chain_head = pNode;
+        mblock->info.element_used_count--;
+        fast_mblock_ref_counter_dec(mblock, pNode);
+    }
+    magazine->count -= i;
+}
+
+static void magazine_key_destroy(void *ptr)
+{
+    struct fast_mblock_magazine *magazine;
+    struct fast_mblock_magazine **pp;
+    struct fast_mblock_man *mblock;
+    int slot;
+
+    for (slot=0; slot<FAST_MBLOCK_MAX_MAGAZINE_SLOTS; slot++)
+    {
+        if ((magazine=tls_magazines[slot]) == NULL)
+        {
+            continue;
+        }
+        tls_magazines[slot] = NULL;
+
+        pthread_mutex_lock(&magazine_ctx.lock);
+        mblock = magazine_ctx.mblocks[slot];
+        if (mblock != NULL && mblock->magazine.version == magazine->version)
+        {
+            pthread_mutex_lock(&mblock->lcp.lock);
+            magazine_flush(magazine, magazine->count);
+            pp = &mblock->magazine.head;
+            while (*pp != NULL && *pp != magazine)
+            {
+                pp = &(*pp)->next;
+            }
+            if (*pp != NULL)
+            {
+                *pp = magazine->next;
+            }
+            pthread_mutex_unlock(&mblock->lcp.lock);
+        }
+        pthread_mutex_unlock(&magazine_ctx.lock);
+
+        free(magazine);
+    }
+}
+
+static struct fast_mblock_magazine *magazine_get(
+        struct fast_mblock_man *mblock)
+{
+    struct fast_mblock_magazine *magazine;
+
+    magazine = tls_magazines[mblock->magazine.slot];
+    if (magazine != NULL)
+    {
+        if (magazine->version == mblock->magazine.version)
+        {
+            return magazine;
+        }
+
+        /* the mblock of the magazine destroyed */
+        free(magazine);
+        tls_magazines[mblock->magazine.slot] = NULL;
+    }
+
+    magazine = (struct fast_mblock_magazine *)fc_malloc(
+            sizeof(struct fast_mblock_magazine));
+    if (magazine == NULL)
+    {
+        return NULL;
+    }
+
+    magazine->mblock = mblock;
+    magazine->version = mblock->magazine.version;
+    magazine->head = NULL;
+    magazine->count = 0;
+    pthread_mutex_lock(&mblock->lcp.lock);
+    magazine->next = mblock->magazine.head;
+    mblock->magazine.head = magazine;
+    pthread_mutex_unlock(&mblock->lcp.lock);
+
+    tls_magazines[mblock->magazine.slot] = magazine;
+    pthread_setspecific(magazine_ctx.key, tls_magazines);
+    return magazine;
+}
+
+static struct fast_mblock_node *magazine_alloc(
+        struct fast_mblock_man *mblock)
+{
+    struct fast_mblock_magazine *magazine;
+	struct fast_mblock_node *pNode;
+    int i;
+
+    if ((magazine=magazine_get(mblock)) == NULL)
+    {
+        return NULL;
+    }
+
+    if (magazine->head == NULL)
+    {
+        /* refill in batch */
+        pthread_mutex_lock(&mblock->lcp.lock);
+        for (i=0; i<mblock->magazine.batch; i++)
+        {
+            if ((pNode=fast_mblock_take_node(mblock)) == NULL)
+            {
+                break;
+            }
+            mblock->info.element_used_count++;
+            fast_mblock_ref_counter_inc(mblock, pNode);
+            pNode->next = magazine->head;
+            magazine->head = pNode;
+        }
+        magazine->count += i;
+        pthread_mutex_unlock(&mblock->lcp.lock);
+
+        if (magazine->head == NULL)
+        {
+            return NULL;
+        }
+    }
+
+    pNode = magazine->head;
+    magazine->head = pNode->next;
+    magazine->count--;
+    return pNode;
+}
+
+static int magazine_free(struct fast_mblock_man *mblock,
+        struct fast_mblock_node *pNode)
+{
+    struct fast_mblock_magazine *magazine;
+
+    if ((magazine=magazine_get(mblock)) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    if (magazine->count >= mblock->magazine.capacity)
+    {
+        pthread_mutex_lock(&mblock->lcp.lock);
+        magazine_flush(magazine, mblock->magazine.batch);
+        pthread_mutex_unlock(&mblock->lcp.lock);
+    }
+
+    pNode->next = magazine->head;
+    magazine->head = pNode;
+    magazine->count++;
+    return 0;
+}
+
 struct fast_mblock_node *fast_mblock_alloc(struct fast_mblock_man *mblock)
 {
 	struct fast_mblock_node *pNode;
 	int result;
 
+    if (mblock->magazine.slot >= 0)
+    {
+        return magazine_alloc(mblock);
+    }
+
 	if (mblock->need_lock && (result=pthread_mutex_lock(
                     &mblock->lcp.lock)) != 0)
 	{
@@ -640,38 +983,13 @@ struct fast_mblock_node *fast_mblock_alloc(struct fast_mblock_man *mblock)
 
     while (1)
     {
-        if (mblock->free_chain_head != NULL)
+        if ((pNode=fast_mblock_take_node(mblock)) != NULL)
         {
-            pNode = mblock->free_chain_head;
-            mblock->free_chain_head = pNode->next;
-            break;
-        }
-
-        if (mblock->delay_free_chain.head != NULL &&
-                mblock->delay_free_chain.head->
-                recycle_timestamp <= get_current_time())
-        {
-            pNode = mblock->delay_free_chain.head;
-            mblock->delay_free_chain.head = pNode->next;
-            if (mblock->delay_free_chain.tail == pNode)
-            {
-                mblock->delay_free_chain.tail = NULL;
-            }
-
-            mblock->info.delay_free_elements--;
-            break;
-        }
-
-        if ((result=fast_mblock_prealloc(mblock)) == 0)
-        {
-            pNode = mblock->free_chain_head;
-            mblock->free_chain_head = pNode->next;
             break;
         }
 
         if (!mblock->alloc_elements.need_wait)
         {
-            pNode = NULL;
             break;
         }
 
@@ -706,6 +1024,11 @@ int fast_mblock_free(struct fast_mblock_man *mblock, \
 	int result;
     bool notify;
 
+    if (mblock->magazine.slot >= 0)
+    {
+        return magazine_free(mblock, pNode);
+    }
+
 	if (mblock->need_lock && (result=pthread_mutex_lock(
                     &mblock->lcp.lock)) != 0)
 	{
@@ -32,6 +32,8 @@
 #define FAST_MBLOCK_ORDER_BY_ALLOC_BYTES    1
 #define FAST_MBLOCK_ORDER_BY_ELEMENT_SIZE   2
 
+#define FAST_MBLOCK_MAX_MAGAZINE_SLOTS    64
+
 /* free node chain */ 
 struct fast_mblock_node
 {
@@ -89,6 +91,8 @@ struct fast_mblock_malloc_trunk_callback
     void *args;
 };
 
+struct fast_mblock_magazine;
+
 struct fast_mblock_man
 {
     struct fast_mblock_info info;
@@ -106,6 +110,14 @@ struct fast_mblock_man
     fast_mblock_alloc_init_func alloc_init_func;
     struct fast_mblock_malloc_trunk_callback malloc_trunk_callback;
 
+    struct {
+        int slot;      //the slot of the thread local magazines, -1 for disabled
+        int64_t version;  //for checking the magazine of the destroyed mblock
+        int capacity;  //the max cached elements per thread
+        int batch;     //the elements per refill / flush
+        struct fast_mblock_magazine *head;  //the magazines of the threads
+    } magazine;
+
     bool need_lock;         //if need mutex lock
     pthread_lock_cond_pair_t lcp;  //for read / write free node chain
     struct fast_mblock_man *prev;  //for stat manager
@@ -225,6 +237,21 @@ static inline int fast_mblock_set_need_wait(struct fast_mblock_man *mblock,
     return 0;
 }
 
+/**
+enable the thread local magazines (the per-thread free node caches) of the
+mblock, the element alloc and free take the cache without lock, and the
+cache refills from / flushes to the shared free chain in batches.
+the delay free elements always go to the shared delay free chain.
+the mblock MUST need lock and NOT limit the element count, and it should
+live until the threads using it exit.
+parameters:
+	mblock: the mblock pointer
+	capacity: the max cached elements per thread
+return error no, 0 for success, != 0 fail
+*/
+int fast_mblock_enable_magazine(struct fast_mblock_man *mblock,
+        const int capacity);
+
 /**
 alloc a node from the mblock
 parameters:
@@ -59,11 +59,16 @@ struct nio_thread_data
 	ThreadLoopCallback thread_loop_callback;
 	void *arg;   //extra argument pointer
     struct {
-        struct fast_task_info *head;
-        struct fast_task_info *tail;
-        pthread_mutex_t lock;
+        /* the lock-free stack pushed by the notify threads,
+         * and all tasks are taken at once by the nio thread */
+        struct fast_task_info *volatile head;
     } waiting_queue;  //task queue
 
+    struct {
+        volatile int64_t notifies; //the task count pushed to waiting_queue
+        int64_t wakeups;  //the times of the nio thread woken up for them
+    } notify_stat;
+
     struct {
         bool enabled;
         volatile int64_t counter;
@@ -88,6 +93,21 @@ struct fast_task_info
 	int size;   //alloc size
 	int length; //data length
 	int offset; //current offset
+    struct {
+        void *buffer; //the pooled buffer borrowed, NULL for none
+        char *data;   //the own buffer of the task while borrowing
+        int size;     //the own buffer size
+    } borrowed;
+    struct {
+        struct fast_task_info *parent; //the connection of the request
+        struct fast_task_info *head;   //the responses to send in order
+        struct fast_task_info *tail;
+        struct fast_task_info *next;   //for the response queue
+        int inflight;  //the pipelined requests in process
+        short events;  //the ioevent events of the connection
+        uint16_t tag;  //the request tag
+        bool pooled;   //allocated by the pipeline task pool
+    } pipeline;  //for request pipelining of libserverframe
     uint16_t port; //peer port
     struct {
         uint8_t current;
@@ -0,0 +1,409 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//fc_checksum.c
+
+#include <pthread.h>
+#include "fc_checksum.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define FC_CRC32C_X86_HW  1
+#include <nmmintrin.h>
+#endif
+
+#define CRC32C_POLY  0x82F63B78   //reversed polynomial of Castagnoli
+
+typedef uint32_t (*fc_crc32c_func)(uint32_t crc,
+        const void *buff, const size_t len);
+
+static uint32_t crc32c_dispatch(uint32_t crc,
+        const void *buff, const size_t len);
+
+static void checksum_init();
+
+static struct {
+    pthread_once_t once;
+    bool hw_enabled;
+    fc_crc32c_func crc32c;
+    uint32_t tables[8][256];
+} checksum_ctx = {PTHREAD_ONCE_INIT, false, crc32c_dispatch};
+
+static inline uint64_t read_uint64(const unsigned char *p)
+{
+    uint64_t n;
+    memcpy(&n, p, sizeof(n));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    n = __builtin_bswap64(n);
+#endif
+    return n;
+}
+
+static inline uint32_t read_uint32(const unsigned char *p)
+{
+    uint32_t n;
+    memcpy(&n, p, sizeof(n));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    n = __builtin_bswap32(n);
+#endif
+    return n;
+}
+
+uint32_t fc_crc32c_sw(uint32_t crc, const void *buff, const size_t len)
+{
+    const unsigned char *p;
+    const unsigned char *end;
+    uint64_t word;
+
+    pthread_once(&checksum_ctx.once, checksum_init);
+    p = (const unsigned char *)buff;
+    end = p + len;
+    crc = ~crc;
+    while (p < end && ((unsigned long)p & 7) != 0) {
+        crc = checksum_ctx.tables[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+
+    while (end - p >= 8) {
+        word = read_uint64(p) ^ crc;
+        crc = checksum_ctx.tables[7][word & 0xFF] ^
+            checksum_ctx.tables[6][(word >> 8) & 0xFF] ^
+            checksum_ctx.tables[5][(word >> 16) & 0xFF] ^
+            checksum_ctx.tables[4][(word >> 24) & 0xFF] ^
+            checksum_ctx.tables[3][(word >> 32) & 0xFF] ^
+            checksum_ctx.tables[2][(word >> 40) & 0xFF] ^
+            checksum_ctx.tables[1][(word >> 48) & 0xFF] ^
+            checksum_ctx.tables[0][word >> 56];
+        p += 8;
+    }
+
+    while (p < end) {
+        crc = checksum_ctx.tables[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#ifdef FC_CRC32C_X86_HW
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const void *buff, const size_t len)
+{
+    const unsigned char *p;
+    const unsigned char *end;
+    uint64_t crc64;
+
+    p = (const unsigned char *)buff;
+    end = p + len;
+    crc = ~crc;
+    while (p < end && ((unsigned long)p & 7) != 0) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+
+    crc64 = crc;
+    while (end - p >= 32) {
+        crc64 = _mm_crc32_u64(crc64, read_uint64(p));
+        crc64 = _mm_crc32_u64(crc64, read_uint64(p + 8));
+        crc64 = _mm_crc32_u64(crc64, read_uint64(p + 16));
+        crc64 = _mm_crc32_u64(crc64, read_uint64(p + 24));
+        p += 32;
+    }
+    while (end - p >= 8) {
+        crc64 = _mm_crc32_u64(crc64, read_uint64(p));
+        p += 8;
+    }
+
+    crc = (uint32_t)crc64;
+    while (p < end) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return ~crc;
+}
+#endif
+
+static void checksum_init()
+{
+    uint32_t crc;
+    int i;
+    int j;
+
+    for (i=0; i<256; i++) {
+        crc = i;
+        for (j=0; j<8; j++) {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : (crc >> 1);
+        }
+        checksum_ctx.tables[0][i] = crc;
+    }
+
+    for (i=0; i<256; i++) {
+        crc = checksum_ctx.tables[0][i];
+        for (j=1; j<8; j++) {
+            crc = checksum_ctx.tables[0][crc & 0xFF] ^ (crc >> 8);
+            checksum_ctx.tables[j][i] = crc;
+        }
+    }
+
+#ifdef FC_CRC32C_X86_HW
+    __builtin_cpu_init();
+    checksum_ctx.hw_enabled = __builtin_cpu_supports("sse4.2");
+    checksum_ctx.crc32c = checksum_ctx.hw_enabled ? crc32c_hw : fc_crc32c_sw;
+#else
+    checksum_ctx.crc32c = fc_crc32c_sw;
+#endif
+}
+
+static uint32_t crc32c_dispatch(uint32_t crc,
+        const void *buff, const size_t len)
+{
+    pthread_once(&checksum_ctx.once, checksum_init);
+    return checksum_ctx.crc32c(crc, buff, len);
+}
+
+uint32_t fc_crc32c(uint32_t crc, const void *buff, const size_t len)
+{
+    return checksum_ctx.crc32c(crc, buff, len);
+}
+
+bool fc_crc32c_hw_enabled()
+{
+    pthread_once(&checksum_ctx.once, checksum_init);
+    return checksum_ctx.hw_enabled;
+}
+
+/* the combine is the same as crc32_combine of zlib */
+static uint32_t gf2_matrix_times(const uint32_t *mat, uint32_t vec)
+{
+    uint32_t sum;
+
+    sum = 0;
+    while (vec) {
+        if (vec & 1) {
+            sum ^= *mat;
+        }
+        vec >>= 1;
+        mat++;
+    }
+    return sum;
+}
+
+static void gf2_matrix_square(uint32_t *square, const uint32_t *mat)
+{
+    int n;
+
+    for (n=0; n<32; n++) {
+        square[n] = gf2_matrix_times(mat, mat[n]);
+    }
+}
+
+uint32_t fc_crc32c_combine(uint32_t crc1, uint32_t crc2, const int64_t len2)
+{
+    uint32_t even[32];  //even-power-of-two zeros operator
+    uint32_t odd[32];   //odd-power-of-two zeros operator
+    uint32_t row;
+    int64_t len;
+    int n;
+
+    if (len2 <= 0) {
+        return crc1;
+    }
+
+    //put operator for one zero bit in odd
+    odd[0] = CRC32C_POLY;
+    row = 1;
+    for (n=1; n<32; n++) {
+        odd[n] = row;
+        row <<= 1;
+    }
+
+    gf2_matrix_square(even, odd);  //two zero bits
+    gf2_matrix_square(odd, even);  //four zero bits
+
+    //apply len2 zeros to crc1 (first square will put eight zero bits)
+    len = len2;
+    do {
+        gf2_matrix_square(even, odd);
+        if (len & 1) {
+            crc1 = gf2_matrix_times(even, crc1);
+        }
+        len >>= 1;
+        if (len == 0) {
+            break;
+        }
+
+        gf2_matrix_square(odd, even);
+        if (len & 1) {
+            crc1 = gf2_matrix_times(odd, crc1);
+        }
+        len >>= 1;
+    } while (len != 0);
+
+    return crc1 ^ crc2;
+}
+
+
+#define HASH64_PRIME1  0x9E3779B185EBCA87ULL
+#define HASH64_PRIME2  0xC2B2AE3D27D4EB4FULL
+#define HASH64_PRIME3  0x165667B19E3779F9ULL
+#define HASH64_PRIME4  0x85EBCA77C2B2AE63ULL
+#define HASH64_PRIME5  0x27D4EB2F165667C5ULL
+
+#define HASH64_ROTL(x, r)  (((x) << (r)) | ((x) >> (64 - (r))))
+
+static inline uint64_t hash64_round(uint64_t acc, const uint64_t input)
+{
+    acc += input * HASH64_PRIME2;
+    acc = HASH64_ROTL(acc, 31);
+    return acc * HASH64_PRIME1;
+}
+
+static inline uint64_t hash64_merge_round(uint64_t acc, const uint64_t val)
+{
+    acc ^= hash64_round(0, val);
+    return acc * HASH64_PRIME1 + HASH64_PRIME4;
+}
+
+static inline void hash64_init_accs(uint64_t *v, const uint64_t seed)
+{
+    v[0] = seed + HASH64_PRIME1 + HASH64_PRIME2;
+    v[1] = seed + HASH64_PRIME2;
+    v[2] = seed;
+    v[3] = seed - HASH64_PRIME1;
+}
+
+static inline const unsigned char *hash64_stripes(uint64_t *v,
+        const unsigned char *p, const unsigned char *limit)
+{
+    do {
+        v[0] = hash64_round(v[0], read_uint64(p));
+        v[1] = hash64_round(v[1], read_uint64(p + 8));
+        v[2] = hash64_round(v[2], read_uint64(p + 16));
+        v[3] = hash64_round(v[3], read_uint64(p + 24));
+        p += 32;
+    } while (p <= limit);
+    return p;
+}
+
+static inline uint64_t hash64_merge_accs(const uint64_t *v)
+{
+    uint64_t h;
+
+    h = HASH64_ROTL(v[0], 1) + HASH64_ROTL(v[1], 7) +
+        HASH64_ROTL(v[2], 12) + HASH64_ROTL(v[3], 18);
+    h = hash64_merge_round(h, v[0]);
+    h = hash64_merge_round(h, v[1]);
+    h = hash64_merge_round(h, v[2]);
+    return hash64_merge_round(h, v[3]);
+}
+
+static inline uint64_t hash64_finalize(uint64_t h,
+        const unsigned char *p, const unsigned char *end)
+{
+    while (end - p >= 8) {
+        h ^= hash64_round(0, read_uint64(p));
+        h = HASH64_ROTL(h, 27) * HASH64_PRIME1 + HASH64_PRIME4;
+        p += 8;
+    }
+
+    if (end - p >= 4) {
+        h ^= (uint64_t)read_uint32(p) * HASH64_PRIME1;
+        h = HASH64_ROTL(h, 23) * HASH64_PRIME2 + HASH64_PRIME3;
+        p += 4;
+    }
+
+    while (p < end) {
+        h ^= (*p++) * HASH64_PRIME5;
+        h = HASH64_ROTL(h, 11) * HASH64_PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= HASH64_PRIME2;
+    h ^= h >> 29;
+    h *= HASH64_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t fc_hash64(const void *buff, const size_t len, const uint64_t seed)
+{
+    const unsigned char *p;
+    const unsigned char *end;
+    uint64_t v[4];
+    uint64_t h;
+
+    p = (const unsigned char *)buff;
+    end = p + len;
+    if (len >= 32) {
+        hash64_init_accs(v, seed);
+        p = hash64_stripes(v, p, end - 32);
+        h = hash64_merge_accs(v);
+    } else {
+        h = seed + HASH64_PRIME5;
+    }
+
+    h += (uint64_t)len;
+    return hash64_finalize(h, p, end);
+}
+
+void fc_hash64_init(FCHash64State *state, const uint64_t seed)
+{
+    state->total_len = 0;
+    state->seed = seed;
+    hash64_init_accs(state->v, seed);
+    state->mem_size = 0;
+}
+
+void fc_hash64_update(FCHash64State *state,
+        const void *buff, const size_t len)
+{
+    const unsigned char *p;
+    const unsigned char *end;
+    int fill_bytes;
+
+    p = (const unsigned char *)buff;
+    end = p + len;
+    state->total_len += len;
+    if (state->mem_size + len < 32) {
+        memcpy(state->mem + state->mem_size, p, len);
+        state->mem_size += len;
+        return;
+    }
+
+    if (state->mem_size > 0) {
+        fill_bytes = 32 - state->mem_size;
+        memcpy(state->mem + state->mem_size, p, fill_bytes);
+        hash64_stripes(state->v, state->mem, state->mem);
+        p += fill_bytes;
+        state->mem_size = 0;
+    }
+
+    if (end - p >= 32) {
+        p = hash64_stripes(state->v, p, end - 32);
+    }
+
+    if (p < end) {
+        state->mem_size = end - p;
+        memcpy(state->mem, p, state->mem_size);
+    }
+}
+
+uint64_t fc_hash64_final(const FCHash64State *state)
+{
+    uint64_t h;
+
+    if (state->total_len >= 32) {
+        h = hash64_merge_accs(state->v);
+    } else {
+        h = state->seed + HASH64_PRIME5;
+    }
+
+    h += state->total_len;
+    return hash64_finalize(h, state->mem, state->mem + state->mem_size);
+}
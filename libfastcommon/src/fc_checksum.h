@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//fc_checksum.h
+
+/* CRC32C (Castagnoli) and the 64-bit hash (xxHash64 algorithm).
+ *
+ * CRC32C uses the SSE 4.2 crc32 instruction when the CPU supports it
+ * (detected at runtime), otherwise the slicing-by-8 tables.
+ * the crc argument of fc_crc32c is the result of the previous part,
+ * 0 for the first part, like crc32 of zlib */
+
+#ifndef _FC_CHECKSUM_H
+#define _FC_CHECKSUM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common_define.h"
+
+typedef struct fc_hash64_state {
+    uint64_t total_len;
+    uint64_t seed;
+    uint64_t v[4];
+    unsigned char mem[32];  //the bytes less than a stripe
+    int mem_size;
+} FCHash64State;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* the CRC32C of the buffer, continued from crc */
+    uint32_t fc_crc32c(uint32_t crc, const void *buff, const size_t len);
+
+    /* the software implementation (slicing-by-8) */
+    uint32_t fc_crc32c_sw(uint32_t crc, const void *buff, const size_t len);
+
+    /* the CRC32C of the two parts joined, len2 is the length of part 2 */
+    uint32_t fc_crc32c_combine(uint32_t crc1, uint32_t crc2,
+            const int64_t len2);
+
+    /* if the CRC32C computed by the CPU instruction */
+    bool fc_crc32c_hw_enabled();
+
+
+    uint64_t fc_hash64(const void *buff, const size_t len,
+            const uint64_t seed);
+
+    void fc_hash64_init(FCHash64State *state, const uint64_t seed);
+
+    void fc_hash64_update(FCHash64State *state,
+            const void *buff, const size_t len);
+
+    uint64_t fc_hash64_final(const FCHash64State *state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
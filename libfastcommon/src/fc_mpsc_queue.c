@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//fc_mpsc_queue.c
+
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include "logger.h"
+#include "shared_func.h"
+#include "pthread_func.h"
+#include "fc_mpsc_queue.h"
+
+#ifdef OS_LINUX
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#define FC_MPSC_QUEUE_NEXT_PTR(queue, data) \
+    *((void **)(((char *)data) + queue->next_ptr_offset))
+
+#ifdef OS_LINUX
+static inline void futex_wait(volatile int *addr, const int val,
+        const struct timespec *timeout)
+{
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, timeout, NULL, 0);
+}
+
+static inline void futex_wake(volatile int *addr)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+#endif
+
+int fc_mpsc_queue_init_ex(struct fc_mpsc_queue *queue,
+        const int next_ptr_offset, const int spin_count)
+{
+#ifndef OS_LINUX
+	int result;
+
+	if ((result=init_pthread_lock_cond_pair(&queue->lc_pair)) != 0)
+	{
+		return result;
+	}
+#endif
+
+    queue->head = NULL;
+    queue->local.head = NULL;
+    queue->local.tail = NULL;
+    queue->waiting = 0;
+    queue->spin_count = spin_count;
+    queue->next_ptr_offset = next_ptr_offset;
+    return 0;
+}
+
+void fc_mpsc_queue_destroy(struct fc_mpsc_queue *queue)
+{
+#ifndef OS_LINUX
+    destroy_pthread_lock_cond_pair(&queue->lc_pair);
+#endif
+}
+
+void fc_mpsc_queue_wakeup(struct fc_mpsc_queue *queue)
+{
+    if (!__sync_bool_compare_and_swap(&queue->waiting, 1, 0)) {
+        return;  //the consumer is running
+    }
+
+#ifdef OS_LINUX
+    futex_wake(&queue->waiting);
+#else
+    PTHREAD_MUTEX_LOCK(&queue->lc_pair.lock);
+    pthread_cond_signal(&queue->lc_pair.cond);
+    PTHREAD_MUTEX_UNLOCK(&queue->lc_pair.lock);
+#endif
+}
+
+void fc_mpsc_queue_push_ex(struct fc_mpsc_queue *queue,
+        void *data, bool *notify)
+{
+    void *old_head;
+
+    do {
+        old_head = queue->head;
+        FC_MPSC_QUEUE_NEXT_PTR(queue, data) = old_head;
+    } while (!__sync_bool_compare_and_swap(&queue->head, old_head, data));
+
+    /* the full barrier of the CAS above pairs with the consumer
+       which sets waiting before checking the head again */
+    *notify = (__sync_add_and_fetch(&queue->waiting, 0) != 0);
+}
+
+/* move the stack of the producers to the tail of the local FIFO list */
+static bool fetch_producer_stack(struct fc_mpsc_queue *queue)
+{
+    void *node;
+    void *next;
+    void *reversed;
+    void *tail;
+
+    if (queue->head == NULL) {
+        return false;
+    }
+
+    node = __sync_lock_test_and_set(&queue->head, NULL);
+    if (node == NULL) {
+        return false;
+    }
+
+    tail = node;
+    reversed = NULL;
+    while (node != NULL) {
+        next = FC_MPSC_QUEUE_NEXT_PTR(queue, node);
+        FC_MPSC_QUEUE_NEXT_PTR(queue, node) = reversed;
+        reversed = node;
+        node = next;
+    }
+
+    if (queue->local.tail == NULL) {
+        queue->local.head = reversed;
+    } else {
+        FC_MPSC_QUEUE_NEXT_PTR(queue, queue->local.tail) = reversed;
+    }
+    queue->local.tail = tail;
+    return true;
+}
+
+static inline int timeout_to_timespec(const int timeout,
+        const int time_unit, struct timespec *ts)
+{
+    switch (time_unit) {
+        case FC_TIME_UNIT_SECOND:
+            ts->tv_sec = timeout;
+            ts->tv_nsec = 0;
+            break;
+        case FC_TIME_UNIT_MSECOND:
+            ts->tv_sec = timeout / 1000;
+            ts->tv_nsec = (timeout % 1000) * (1000 * 1000);
+            break;
+        case FC_TIME_UNIT_USECOND:
+            ts->tv_sec = timeout / (1000 * 1000);
+            ts->tv_nsec = (timeout % (1000 * 1000)) * 1000;
+            break;
+        case FC_TIME_UNIT_NSECOND:
+            ts->tv_sec = timeout / (1000 * 1000 * 1000);
+            ts->tv_nsec  = timeout % (1000 * 1000 * 1000);
+            break;
+        default:
+            logError("file: "__FILE__", line: %d, "
+                    "invalid time unit: %d", __LINE__, time_unit);
+            return EINVAL;
+    }
+
+    return 0;
+}
+
+/* spin then park until the producers push or the timeout,
+ * timeout is relative, NULL for infinite */
+static void wait_for_data(struct fc_mpsc_queue *queue,
+        const struct timespec *timeout)
+{
+    int i;
+
+    for (i=0; i<queue->spin_count; i++) {
+        if (queue->head != NULL) {
+            return;
+        }
+        __sync_synchronize();
+    }
+
+#ifdef OS_LINUX
+    __sync_fetch_and_or(&queue->waiting, 1);  //full barrier
+    if (queue->head == NULL) {
+        futex_wait(&queue->waiting, 1, timeout);
+    }
+#else
+    PTHREAD_MUTEX_LOCK(&queue->lc_pair.lock);
+    __sync_fetch_and_or(&queue->waiting, 1);  //full barrier
+    if (queue->head == NULL) {
+        if (timeout == NULL) {
+            pthread_cond_wait(&queue->lc_pair.cond, &queue->lc_pair.lock);
+        } else {
+            struct timespec ts;
+            ts.tv_sec = get_current_time() + timeout->tv_sec;
+            ts.tv_nsec = timeout->tv_nsec;
+            pthread_cond_timedwait(&queue->lc_pair.cond,
+                    &queue->lc_pair.lock, &ts);
+        }
+    }
+    PTHREAD_MUTEX_UNLOCK(&queue->lc_pair.lock);
+#endif
+
+    __sync_bool_compare_and_swap(&queue->waiting, 1, 0);
+}
+
+static inline void *local_pop(struct fc_mpsc_queue *queue)
+{
+	void *data;
+
+    if ((data=queue->local.head) != NULL) {
+        queue->local.head = FC_MPSC_QUEUE_NEXT_PTR(queue, data);
+        if (queue->local.head == NULL) {
+            queue->local.tail = NULL;
+        }
+    }
+    return data;
+}
+
+static inline void *local_pop_all(struct fc_mpsc_queue *queue)
+{
+	void *data;
+
+    data = queue->local.head;
+    queue->local.head = queue->local.tail = NULL;
+    return data;
+}
+
+void *fc_mpsc_queue_pop_ex(struct fc_mpsc_queue *queue, const bool blocked)
+{
+    if (queue->local.head == NULL && !fetch_producer_stack(queue)) {
+        if (!blocked) {
+            return NULL;
+        }
+
+        wait_for_data(queue, NULL);
+        fetch_producer_stack(queue);
+    }
+
+    return local_pop(queue);
+}
+
+void *fc_mpsc_queue_pop_all_ex(struct fc_mpsc_queue *queue,
+        const bool blocked)
+{
+    if (!fetch_producer_stack(queue) && queue->local.head == NULL) {
+        if (!blocked) {
+            return NULL;
+        }
+
+        wait_for_data(queue, NULL);
+        fetch_producer_stack(queue);
+    }
+
+    return local_pop_all(queue);
+}
+
+void fc_mpsc_queue_push_queue_to_head(struct fc_mpsc_queue *queue,
+        struct fc_queue_info *qinfo)
+{
+    if (qinfo->head == NULL) {
+        return;
+    }
+
+    FC_MPSC_QUEUE_NEXT_PTR(queue, qinfo->tail) = queue->local.head;
+    queue->local.head = qinfo->head;
+    if (queue->local.tail == NULL) {
+        queue->local.tail = qinfo->tail;
+    }
+}
+
+void fc_mpsc_queue_pop_to_queue(struct fc_mpsc_queue *queue,
+        struct fc_queue_info *qinfo)
+{
+    fetch_producer_stack(queue);
+    *qinfo = queue->local;
+    queue->local.head = queue->local.tail = NULL;
+}
+
+void *fc_mpsc_queue_timedpop(struct fc_mpsc_queue *queue,
+        const int timeout, const int time_unit)
+{
+    struct timespec ts;
+
+    if (queue->local.head == NULL && !fetch_producer_stack(queue)) {
+        if (timeout_to_timespec(timeout, time_unit, &ts) != 0) {
+            return NULL;
+        }
+
+        wait_for_data(queue, &ts);
+        fetch_producer_stack(queue);
+    }
+
+    return local_pop(queue);
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//fc_mpsc_queue.h
+
+/* the lock-free multi-producer single-consumer variant of fc_queue.
+ *
+ * the producers push to a LIFO stack with CAS, the consumer takes the whole
+ * stack with one atomic exchange and reverses it into its private FIFO list,
+ * so the pop functions MUST be called by ONE consumer thread only.
+ *
+ * the consumer spins a while before parking on a futex (a condition
+ * variable for the other OS), the producer wakes it only when it parked */
+
+#ifndef _FC_MPSC_QUEUE_H
+#define _FC_MPSC_QUEUE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "common_define.h"
+#include "fc_queue.h"
+
+#define FC_MPSC_QUEUE_DEFAULT_SPIN_COUNT  256
+
+struct fc_mpsc_queue
+{
+    void *volatile head;  //the stack of the producers
+    struct fc_queue_info local;  //the FIFO list of the consumer
+    volatile int waiting;
+    int spin_count;
+    int next_ptr_offset;
+#ifndef OS_LINUX
+    pthread_lock_cond_pair_t lc_pair;
+#endif
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int fc_mpsc_queue_init_ex(struct fc_mpsc_queue *queue,
+        const int next_ptr_offset, const int spin_count);
+
+#define fc_mpsc_queue_init(queue, next_ptr_offset) \
+    fc_mpsc_queue_init_ex(queue, next_ptr_offset, \
+            FC_MPSC_QUEUE_DEFAULT_SPIN_COUNT)
+
+void fc_mpsc_queue_destroy(struct fc_mpsc_queue *queue);
+
+//wakeup the consumer
+void fc_mpsc_queue_wakeup(struct fc_mpsc_queue *queue);
+
+#define fc_mpsc_queue_terminate(queue) fc_mpsc_queue_wakeup(queue)
+
+//notify by the caller
+void fc_mpsc_queue_push_ex(struct fc_mpsc_queue *queue,
+        void *data, bool *notify);
+
+static inline void fc_mpsc_queue_push(struct fc_mpsc_queue *queue, void *data)
+{
+    bool notify;
+
+    fc_mpsc_queue_push_ex(queue, data, &notify);
+    if (notify) {
+        fc_mpsc_queue_wakeup(queue);
+    }
+}
+
+static inline void fc_mpsc_queue_push_silence(
+        struct fc_mpsc_queue *queue, void *data)
+{
+    bool notify;
+    fc_mpsc_queue_push_ex(queue, data, &notify);
+}
+
+//the following functions MUST be called by the consumer thread
+
+//push back to the head of the consumer's list
+void fc_mpsc_queue_push_queue_to_head(struct fc_mpsc_queue *queue,
+        struct fc_queue_info *qinfo);
+
+void *fc_mpsc_queue_pop_ex(struct fc_mpsc_queue *queue, const bool blocked);
+#define fc_mpsc_queue_pop(queue) fc_mpsc_queue_pop_ex(queue, true)
+#define fc_mpsc_queue_try_pop(queue) fc_mpsc_queue_pop_ex(queue, false)
+
+void *fc_mpsc_queue_pop_all_ex(struct fc_mpsc_queue *queue,
+        const bool blocked);
+#define fc_mpsc_queue_pop_all(queue) fc_mpsc_queue_pop_all_ex(queue, true)
+#define fc_mpsc_queue_try_pop_all(queue) \
+    fc_mpsc_queue_pop_all_ex(queue, false)
+
+void fc_mpsc_queue_pop_to_queue(struct fc_mpsc_queue *queue,
+        struct fc_queue_info *qinfo);
+
+static inline bool fc_mpsc_queue_empty(struct fc_mpsc_queue *queue)
+{
+    return (queue->local.head == NULL && queue->head == NULL);
+}
+
+void *fc_mpsc_queue_timedpop(struct fc_mpsc_queue *queue,
+        const int timeout, const int time_unit);
+
+#define fc_mpsc_queue_timedpop_sec(queue, timeout) \
+    fc_mpsc_queue_timedpop(queue, timeout, FC_TIME_UNIT_SECOND)
+
+#define fc_mpsc_queue_timedpop_ms(queue, timeout_ms) \
+    fc_mpsc_queue_timedpop(queue, timeout_ms, FC_TIME_UNIT_MSECOND)
+
+#define fc_mpsc_queue_timedpop_us(queue, timeout_us) \
+    fc_mpsc_queue_timedpop(queue, timeout_us, FC_TIME_UNIT_USECOND)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
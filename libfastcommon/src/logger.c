@@ -26,10 +26,14 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/file.h>
+#include <sys/uio.h>
+#include <sys/time.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include "shared_func.h"
 #include "pthread_func.h"
 #include "sched_thread.h"
+#include "fc_atomic.h"
 #include "logger.h"
 
 #ifndef LINE_MAX
@@ -47,6 +51,7 @@
 LogContext g_log_context = {LOG_INFO, STDERR_FILENO, NULL};
 
 static int log_fsync(LogContext *pContext, const bool bNeedLock);
+static void log_async_destroy(LogContext *pContext);
 
 static int check_and_mk_log_dir(const char *base_path)
 {
@@ -327,6 +332,11 @@ void log_set_fd_flags(LogContext *pContext, const int flags)
 
 void log_destroy_ex(LogContext *pContext)
 {
+	if (pContext->async_ctx != NULL)
+	{
+		log_async_destroy(pContext);
+	}
+
 	if (pContext->log_fd >= 0 && pContext->log_fd != STDERR_FILENO)
 	{
 		log_fsync(pContext, true);
@@ -959,83 +969,541 @@ static int log_fsync(LogContext *pContext, const bool bNeedLock)
 	return result;
 }
 
-static void doLogEx(LogContext *pContext, struct timeval *tv, \
-		const char *caption, const char *text, const int text_len, \
-		const bool bNeedSync, const bool bNeedLock)
+static int log_format_prefix(LogContext *pContext, struct timeval *tv,
+		const char *caption, char *buff)
 {
 	struct tm tm;
 	int time_fragment;
-	int buff_len;
-	int result;
+	char *p;
 
-	if ((pContext->time_precision == LOG_TIME_PRECISION_SECOND)
-            || (pContext->time_precision == LOG_TIME_PRECISION_NONE))
+	p = buff;
+    if (pContext->time_precision != LOG_TIME_PRECISION_NONE)
+    {
+        localtime_r(&tv->tv_sec, &tm);
+        if (pContext->time_precision == LOG_TIME_PRECISION_SECOND)
+        {
+            p += sprintf(p, "[%04d-%02d-%02d %02d:%02d:%02d] ",
+                    tm.tm_year+1900, tm.tm_mon+1, tm.tm_mday,
+                    tm.tm_hour, tm.tm_min, tm.tm_sec);
+        }
+        else
+        {
+            if (pContext->time_precision == LOG_TIME_PRECISION_MSECOND)
+            {
+                time_fragment = tv->tv_usec / 1000;
+            }
+            else
+            {
+                time_fragment = tv->tv_usec;
+            }
+            p += sprintf(p, "[%04d-%02d-%02d %02d:%02d:%02d.%03d] ",
+                    tm.tm_year+1900, tm.tm_mon+1, tm.tm_mday,
+                    tm.tm_hour, tm.tm_min, tm.tm_sec, time_fragment);
+        }
+    }
+
+	if (caption != NULL)
 	{
-		time_fragment = 0;
+		p += sprintf(p, "%s - ", caption);
+	}
+
+	return p - buff;
+}
+
+#define LOG_ASYNC_MIN_BUFFER_SIZE    (16 * 1024)
+#define LOG_ASYNC_IOV_BATCH          256
+
+typedef struct log_ring_buffer
+{
+	char *buff;
+	int size;  //power of 2
+	volatile int64_t head;  //advanced by the owner thread only
+	volatile int64_t tail;  //advanced by the flusher holding the lock of lcp
+	volatile int64_t dropped;
+	volatile bool orphan;   //the owner thread exited
+	struct log_ring_buffer *next;
+} LogRingBuffer;
+
+typedef struct log_async_batch
+{
+	int iov_count;
+	int ring_count;
+	int64_t bytes;
+	struct iovec iovs[LOG_ASYNC_IOV_BATCH];
+	struct {
+		LogRingBuffer *ring;
+		int64_t head;
+	} rings[LOG_ASYNC_IOV_BATCH / 2];
+} LogAsyncBatch;
+
+typedef struct log_async_context
+{
+	LogContext *log_ctx;
+	int buffer_size;
+	int flush_interval_ms;
+	volatile bool running;
+	pthread_key_t key;
+	pthread_t tid;
+	pthread_lock_cond_pair_t lcp;  //for the ring list and the wakeup
+	LogRingBuffer *rings;
+	LogAsyncBatch *batch;  //protected by the lock of lcp
+	volatile int64_t dropped;  //of the freed rings and the alloc failures
+	int64_t reported_dropped;
+	time_t last_report_time;
+} LogAsyncContext;
+
+static void log_ring_thread_exit(void *arg)
+{
+	((LogRingBuffer *)arg)->orphan = true;
+}
+
+static LogRingBuffer *log_async_alloc_ring(LogAsyncContext *async_ctx)
+{
+	LogRingBuffer *ring;
+
+	ring = (LogRingBuffer *)malloc(sizeof(LogRingBuffer) +
+            async_ctx->buffer_size);
+	if (ring == NULL)
+	{
+		return NULL;
+	}
+
+	memset(ring, 0, sizeof(LogRingBuffer));
+	ring->buff = (char *)(ring + 1);
+	ring->size = async_ctx->buffer_size;
+	if (pthread_setspecific(async_ctx->key, ring) != 0)
+	{
+		free(ring);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&async_ctx->lcp.lock);
+	ring->next = async_ctx->rings;
+	async_ctx->rings = ring;
+	pthread_mutex_unlock(&async_ctx->lcp.lock);
+	return ring;
+}
+
+static inline void log_ring_copy(LogRingBuffer *ring, const int64_t pos,
+        const char *data, const int len)
+{
+	int offset;
+	int first;
+
+	offset = pos & (ring->size - 1);
+	first = ring->size - offset;
+	if (len <= first)
+	{
+		memcpy(ring->buff + offset, data, len);
 	}
 	else
 	{
-		if (pContext->time_precision == LOG_TIME_PRECISION_MSECOND)
+		memcpy(ring->buff + offset, data, first);
+		memcpy(ring->buff, data + first, len - first);
+	}
+}
+
+static void log_async_write(LogAsyncContext *async_ctx, struct timeval *tv,
+		const char *caption, const char *text, const int text_len)
+{
+	LogRingBuffer *ring;
+	char prefix[128];
+	int prefix_len;
+	int total_len;
+	int64_t head;
+	int64_t used;
+
+	if ((ring=(LogRingBuffer *)pthread_getspecific(
+                    async_ctx->key)) == NULL)
+	{
+		if ((ring=log_async_alloc_ring(async_ctx)) == NULL)
 		{
-			time_fragment = tv->tv_usec / 1000;
+			__sync_add_and_fetch(&async_ctx->dropped, 1);
+			return;
 		}
-		else
+	}
+
+	prefix_len = log_format_prefix(async_ctx->log_ctx, tv, caption, prefix);
+	total_len = prefix_len + text_len + 1;
+	head = ring->head;
+	used = head - FC_ATOMIC_GET(ring->tail);
+	if (used + total_len > ring->size)
+	{
+		__sync_add_and_fetch(&ring->dropped, 1);
+		return;
+	}
+
+	log_ring_copy(ring, head, prefix, prefix_len);
+	log_ring_copy(ring, head + prefix_len, text, text_len);
+	log_ring_copy(ring, head + prefix_len + text_len, "\n", 1);
+
+	//publish the line after its content
+	__sync_synchronize();
+	ring->head = head + total_len;
+
+	/* wake up the flush thread without lock when the buffer is filling,
+	 * it wakes up by timeout when the notify is lost */
+	if (used < ring->size / 2 && used + total_len >= ring->size / 2)
+	{
+		pthread_cond_signal(&async_ctx->lcp.cond);
+	}
+}
+
+static void log_async_write_batch(LogAsyncContext *async_ctx,
+        LogAsyncBatch *batch)
+{
+	LogContext *pContext;
+	ssize_t written;
+	int i;
+
+	if (batch->iov_count == 0)
+	{
+		return;
+	}
+
+	pContext = async_ctx->log_ctx;
+	pthread_mutex_lock(&pContext->log_thread_lock);
+
+	//the lines written in synchronous mode such as the header
+	if (pContext->pcurrent_buff != pContext->log_buff)
+	{
+		log_fsync(pContext, false);
+	}
+
+	pContext->current_size += batch->bytes;
+	if (pContext->rotate_size > 0 && pContext->current_size >
+            pContext->rotate_size)
+	{
+		pContext->rotate_immediately = true;
+		log_check_rotate(pContext);
+	}
+
+	written = writev(pContext->log_fd, batch->iovs, batch->iov_count);
+	if (written != batch->bytes)
+	{
+		fprintf(stderr, "file: "__FILE__", line: %d, "
+			"call writev fail, bytes: %"PRId64", written: %d, "
+			"errno: %d, error info: %s\n", __LINE__, batch->bytes,
+			(int)written, errno, STRERROR(errno));
+	}
+
+	if (pContext->rotate_immediately)
+	{
+		log_check_rotate(pContext);
+	}
+	pthread_mutex_unlock(&pContext->log_thread_lock);
+
+	__sync_synchronize();
+	for (i=0; i<batch->ring_count; i++)
+	{
+		batch->rings[i].ring->tail = batch->rings[i].head;
+	}
+
+	batch->iov_count = 0;
+	batch->ring_count = 0;
+	batch->bytes = 0;
+}
+
+static void log_async_batch_add(LogAsyncContext *async_ctx,
+        LogAsyncBatch *batch, LogRingBuffer *ring,
+        const int64_t head, const int64_t tail)
+{
+	int offset;
+	int len;
+
+	if (batch->iov_count + 2 > LOG_ASYNC_IOV_BATCH)
+	{
+		log_async_write_batch(async_ctx, batch);
+	}
+
+	offset = tail & (ring->size - 1);
+	len = head - tail;
+	if (offset + len <= ring->size)
+	{
+		batch->iovs[batch->iov_count].iov_base = ring->buff + offset;
+		batch->iovs[batch->iov_count++].iov_len = len;
+	}
+	else
+	{
+		batch->iovs[batch->iov_count].iov_base = ring->buff + offset;
+		batch->iovs[batch->iov_count++].iov_len = ring->size - offset;
+		batch->iovs[batch->iov_count].iov_base = ring->buff;
+		batch->iovs[batch->iov_count++].iov_len =
+            len - (ring->size - offset);
+	}
+
+	batch->rings[batch->ring_count].ring = ring;
+	batch->rings[batch->ring_count++].head = head;
+	batch->bytes += len;
+}
+
+/* the caller should hold the lock of lcp */
+static int64_t log_async_flush(LogAsyncContext *async_ctx,
+        LogAsyncBatch *batch)
+{
+	LogRingBuffer **pp;
+	LogRingBuffer *ring;
+	int64_t head;
+	int64_t dropped;
+	bool orphan;
+
+	dropped = FC_ATOMIC_GET(async_ctx->dropped);
+	pp = &async_ctx->rings;
+	while ((ring=*pp) != NULL)
+	{
+		//the owner thread set orphan after its last line published
+		orphan = ring->orphan;
+		head = FC_ATOMIC_GET(ring->head);
+		if (head != ring->tail)
 		{
-			time_fragment = tv->tv_usec;
+			log_async_batch_add(async_ctx, batch, ring, head, ring->tail);
 		}
+		else if (orphan)
+		{
+			*pp = ring->next;
+			__sync_add_and_fetch(&async_ctx->dropped, ring->dropped);
+			dropped += ring->dropped;
+			free(ring);
+			continue;
+		}
+
+		dropped += FC_ATOMIC_GET(ring->dropped);
+		pp = &ring->next;
 	}
 
-	if (bNeedLock && (result=pthread_mutex_lock(&pContext->log_thread_lock)) != 0)
+	log_async_write_batch(async_ctx, batch);
+	return dropped;
+}
+
+/* the deadline of fc_cond_timedwait_ms is based on the cached seconds,
+ * it is in the past for the short interval, so calc by the real time */
+static void log_async_timedwait(LogAsyncContext *async_ctx)
+{
+	struct timeval tv;
+	struct timespec ts;
+	int64_t nsec;
+
+	gettimeofday(&tv, NULL);
+	nsec = (int64_t)tv.tv_usec * 1000 +
+        (int64_t)async_ctx->flush_interval_ms * 1000 * 1000;
+	ts.tv_sec = tv.tv_sec + nsec / (1000 * 1000 * 1000);
+	ts.tv_nsec = nsec % (1000 * 1000 * 1000);
+	pthread_cond_timedwait(&async_ctx->lcp.cond,
+            &async_ctx->lcp.lock, &ts);
+}
+
+static void *log_async_flush_entrance(void *arg)
+{
+	LogAsyncContext *async_ctx;
+	int64_t dropped;
+	time_t current_time;
+
+	async_ctx = (LogAsyncContext *)arg;
+	pthread_mutex_lock(&async_ctx->lcp.lock);
+	while (async_ctx->running)
 	{
-		fprintf(stderr, "file: "__FILE__", line: %d, " \
-			"call pthread_mutex_lock fail, " \
-			"errno: %d, error info: %s\n", \
-			__LINE__, result, STRERROR(result));
+		log_async_timedwait(async_ctx);
+		dropped = log_async_flush(async_ctx, async_ctx->batch);
+		if (dropped > async_ctx->reported_dropped)
+		{
+			current_time = get_current_time();
+			if (current_time != async_ctx->last_report_time)
+			{
+				fprintf(stderr, "file: "__FILE__", line: %d, "
+					"the log buffer is full, %"PRId64" log lines "
+					"dropped, total: %"PRId64"\n", __LINE__,
+					dropped - async_ctx->reported_dropped, dropped);
+				async_ctx->reported_dropped = dropped;
+				async_ctx->last_report_time = current_time;
+			}
+		}
+	}
+
+	//the last flush when exit
+	log_async_flush(async_ctx, async_ctx->batch);
+	pthread_mutex_unlock(&async_ctx->lcp.lock);
+	return NULL;
+}
+
+int log_set_async_ex(LogContext *pContext, const int buffer_size,
+        const int flush_interval_ms)
+{
+	LogAsyncContext *async_ctx;
+	int result;
+
+	if (pContext->async_ctx != NULL)
+	{
+		return 0;
+	}
+
+	async_ctx = (LogAsyncContext *)malloc(sizeof(LogAsyncContext));
+	if (async_ctx == NULL)
+	{
+		return ENOMEM;
+	}
+	memset(async_ctx, 0, sizeof(LogAsyncContext));
+
+	async_ctx->batch = (LogAsyncBatch *)malloc(sizeof(LogAsyncBatch));
+	if (async_ctx->batch == NULL)
+	{
+		free(async_ctx);
+		return ENOMEM;
+	}
+	memset(async_ctx->batch, 0, sizeof(LogAsyncBatch));
+
+	async_ctx->log_ctx = pContext;
+	async_ctx->buffer_size = LOG_ASYNC_MIN_BUFFER_SIZE;
+	while (async_ctx->buffer_size < buffer_size)
+	{
+		async_ctx->buffer_size *= 2;
+	}
+	async_ctx->flush_interval_ms = flush_interval_ms > 0 ?
+        flush_interval_ms : LOG_ASYNC_DEF_FLUSH_INTERVAL_MS;
+
+	if ((result=init_pthread_lock_cond_pair(&async_ctx->lcp)) != 0)
+	{
+		free(async_ctx->batch);
+		free(async_ctx);
+		return result;
+	}
+	if ((result=pthread_key_create(&async_ctx->key,
+                    log_ring_thread_exit)) != 0)
+	{
+		destroy_pthread_lock_cond_pair(&async_ctx->lcp);
+		free(async_ctx->batch);
+		free(async_ctx);
+		return result;
+	}
+
+	async_ctx->running = true;
+	//joinable for the last flush when destroy
+	if ((result=pthread_create(&async_ctx->tid, NULL,
+                    log_async_flush_entrance, async_ctx)) != 0)
+	{
+		pthread_key_delete(async_ctx->key);
+		destroy_pthread_lock_cond_pair(&async_ctx->lcp);
+		free(async_ctx->batch);
+		free(async_ctx);
+		return result;
+	}
+
+	pContext->async_ctx = async_ctx;
+	return 0;
+}
+
+static void log_async_destroy(LogContext *pContext)
+{
+	LogAsyncContext *async_ctx;
+	LogRingBuffer *ring;
+
+	async_ctx = pContext->async_ctx;
+	pthread_mutex_lock(&async_ctx->lcp.lock);
+	async_ctx->running = false;
+	pthread_cond_signal(&async_ctx->lcp.cond);
+	pthread_mutex_unlock(&async_ctx->lcp.lock);
+	pthread_join(async_ctx->tid, NULL);
+
+	pContext->async_ctx = NULL;
+	while (async_ctx->rings != NULL)
+	{
+		ring = async_ctx->rings;
+		async_ctx->rings = ring->next;
+		free(ring);
+	}
+	pthread_key_delete(async_ctx->key);
+	destroy_pthread_lock_cond_pair(&async_ctx->lcp);
+	free(async_ctx->batch);
+	free(async_ctx);
+}
+
+int64_t log_get_dropped_count_ex(LogContext *pContext)
+{
+	LogAsyncContext *async_ctx;
+	LogRingBuffer *ring;
+	int64_t dropped;
+
+	if ((async_ctx=pContext->async_ctx) == NULL)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&async_ctx->lcp.lock);
+	dropped = FC_ATOMIC_GET(async_ctx->dropped);
+	for (ring=async_ctx->rings; ring!=NULL; ring=ring->next)
+	{
+		dropped += FC_ATOMIC_GET(ring->dropped);
+	}
+	pthread_mutex_unlock(&async_ctx->lcp.lock);
+	return dropped;
+}
+
+bool log_rate_limit_check(LogRateLimiter *limiter,
+        const int interval, int *suppressed)
+{
+	time_t current_time;
+	time_t last_time;
+
+	current_time = get_current_time();
+	last_time = limiter->last_time;
+	if (current_time - last_time >= interval &&
+            __sync_bool_compare_and_swap(&limiter->last_time,
+                last_time, current_time))
+	{
+		*suppressed = __sync_lock_test_and_set(&limiter->suppressed, 0);
+		return true;
 	}
 
+	__sync_add_and_fetch(&limiter->suppressed, 1);
+	return false;
+}
+
+static void doLogEx(LogContext *pContext, struct timeval *tv, \
+		const char *caption, const char *text, const int text_len, \
+		const bool bNeedSync, const bool bAsyncSync, const bool bNeedLock)
+{
+	LogAsyncContext *async_ctx;
+	int result;
+
 	if (text_len + 64 > LOG_BUFF_SIZE)
 	{
 		fprintf(stderr, "file: "__FILE__", line: %d, " \
 			"log buff size: %d < log text length: %d\n", \
 			__LINE__, LOG_BUFF_SIZE, text_len + 64);
-        if (bNeedLock)
-        {
-		    pthread_mutex_unlock(&(pContext->log_thread_lock));
-        }
 		return;
 	}
 
-	if ((pContext->pcurrent_buff - pContext->log_buff) + text_len + 64 \
-			> LOG_BUFF_SIZE)
+	/* the caller holds the lock when bNeedLock is false,
+	 * such as the header line when rotating, so write it directly */
+	if ((async_ctx=pContext->async_ctx) != NULL && bNeedLock)
 	{
-		log_fsync(pContext, false);
+		if (!bAsyncSync)
+		{
+			log_async_write(async_ctx, tv, caption, text, text_len);
+			return;
+		}
+
+		/* the critical line: flush the queued lines first for the
+		 * order, then write it synchronously so it survives the crash */
+		pthread_mutex_lock(&async_ctx->lcp.lock);
+		log_async_flush(async_ctx, async_ctx->batch);
 	}
 
-    if (pContext->time_precision != LOG_TIME_PRECISION_NONE)
-    {
-        localtime_r(&tv->tv_sec, &tm);
-        if (pContext->time_precision == LOG_TIME_PRECISION_SECOND)
-        {
-            buff_len = sprintf(pContext->pcurrent_buff, \
-                    "[%04d-%02d-%02d %02d:%02d:%02d] ", \
-                    tm.tm_year+1900, tm.tm_mon+1, tm.tm_mday, \
-                    tm.tm_hour, tm.tm_min, tm.tm_sec);
-        }
-        else
-        {
-            buff_len = sprintf(pContext->pcurrent_buff, \
-                    "[%04d-%02d-%02d %02d:%02d:%02d.%03d] ", \
-                    tm.tm_year+1900, tm.tm_mon+1, tm.tm_mday, \
-                    tm.tm_hour, tm.tm_min, tm.tm_sec, time_fragment);
-        }
-        pContext->pcurrent_buff += buff_len;
-    }
+	if (bNeedLock && (result=pthread_mutex_lock(&pContext->log_thread_lock)) != 0)
+	{
+		fprintf(stderr, "file: "__FILE__", line: %d, " \
+			"call pthread_mutex_lock fail, " \
+			"errno: %d, error info: %s\n", \
+			__LINE__, result, STRERROR(result));
+	}
 
-	if (caption != NULL)
+	if ((pContext->pcurrent_buff - pContext->log_buff) + text_len + 64 \
+			> LOG_BUFF_SIZE)
 	{
-		buff_len = sprintf(pContext->pcurrent_buff, "%s - ", caption);
-		pContext->pcurrent_buff += buff_len;
+		log_fsync(pContext, false);
 	}
+
+	pContext->pcurrent_buff += log_format_prefix(pContext,
+            tv, caption, pContext->pcurrent_buff);
 	memcpy(pContext->pcurrent_buff, text, text_len);
 	pContext->pcurrent_buff += text_len;
 	*pContext->pcurrent_buff++ = '\n';
@@ -1052,25 +1520,48 @@ static void doLogEx(LogContext *pContext, struct timeval *tv, \
 			"errno: %d, error info: %s\n", \
 			__LINE__, result, STRERROR(result));
 	}
+
+	if (async_ctx != NULL && bNeedLock)
+	{
+		pthread_mutex_unlock(&async_ctx->lcp.lock);
+	}
 }
 
-void log_it_ex2(LogContext *pContext, const char *caption, \
-		const char *text, const int text_len, \
-        const bool bNeedSync, const bool bNeedLock)
+static inline void log_get_time(LogContext *pContext, struct timeval *tv)
 {
-	struct timeval tv;
-
 	if (pContext->time_precision == LOG_TIME_PRECISION_SECOND)
 	{
-		tv.tv_sec = get_current_time();
-		tv.tv_usec = 0;
+		tv->tv_sec = get_current_time();
+		tv->tv_usec = 0;
 	}
 	else if (pContext->time_precision != LOG_TIME_PRECISION_NONE)
 	{
-		gettimeofday(&tv, NULL);
+		gettimeofday(tv, NULL);
 	}
+}
+
+void log_it_ex2(LogContext *pContext, const char *caption, \
+		const char *text, const int text_len, \
+        const bool bNeedSync, const bool bNeedLock)
+{
+	struct timeval tv;
+
+	log_get_time(pContext, &tv);
+	doLogEx(pContext, &tv, caption, text, text_len,
+            bNeedSync, bNeedSync, bNeedLock);
+}
+
+/* in the asynchronous mode, only the lines of LOG_CRIT and
+ * the higher priorities are written synchronously */
+static void log_it_by_priority(LogContext *pContext, const int priority,
+		const char *caption, const char *text, const int text_len,
+		const bool bNeedSync)
+{
+	struct timeval tv;
 
-	doLogEx(pContext, &tv, caption, text, text_len, bNeedSync, bNeedLock);
+	log_get_time(pContext, &tv);
+	doLogEx(pContext, &tv, caption, text, text_len,
+            bNeedSync, priority <= LOG_CRIT, true);
 }
 
 void log_it_ex1(LogContext *pContext, const int priority, \
@@ -1124,7 +1615,8 @@ void log_it_ex1(LogContext *pContext, const int priority, \
 			break;
 	}
 
-	log_it_ex2(pContext, caption, text, text_len, bNeedSync, true);
+	log_it_by_priority(pContext, priority, caption,
+            text, text_len, bNeedSync);
 }
 
 void log_it_ex(LogContext *pContext, const int priority, const char *format, ...)
@@ -1188,7 +1680,7 @@ void log_it_ex(LogContext *pContext, const int priority, const char *format, ...
 			break;
 	}
 
-	log_it_ex2(pContext, caption, text, len, bNeedSync, true);
+	log_it_by_priority(pContext, priority, caption, text, len, bNeedSync);
 }
 
 
@@ -1212,7 +1704,7 @@ void log_it_ex(LogContext *pContext, const int priority, const char *format, ...
     } \
 	} \
 \
-	log_it_ex2(pContext, caption, text, len, bNeedSync, true);
+	log_it_by_priority(pContext, priority, caption, text, len, bNeedSync);
 
 
 void logEmergEx(LogContext *pContext, const char *format, ...)
@@ -1269,7 +1761,7 @@ void logAccess(LogContext *pContext, struct timeval *tvStart, \
     {
         len = sizeof(text) - 1;
     }
-	doLogEx(pContext, tvStart, NULL, text, len, false, true);
+	doLogEx(pContext, tvStart, NULL, text, len, false, false, true);
 }
 
 const char *log_get_level_caption_ex(LogContext *pContext)
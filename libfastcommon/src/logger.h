@@ -38,7 +38,12 @@ extern "C" {
 
 #define LOG_NOTHING    (LOG_DEBUG + 10)
 
+//the asynchronous mode
+#define LOG_ASYNC_DEF_BUFFER_SIZE        (256 * 1024)
+#define LOG_ASYNC_DEF_FLUSH_INTERVAL_MS  50
+
 struct log_context;
+struct log_async_context;
 
 //log header line callback
 typedef void (*LogHeaderCallback)(struct log_context *pContext);
@@ -118,8 +123,19 @@ typedef struct log_context
      * compress the log files before N days
      * */
     int compress_log_days_before;
+
+    /*
+     * the asynchronous mode context, NULL for synchronous mode
+     * */
+    struct log_async_context *async_ctx;
 } LogContext;
 
+typedef struct log_rate_limiter
+{
+    volatile time_t last_time;
+    volatile int suppressed;  //the suppressed count since last output
+} LogRateLimiter;
+
 extern LogContext g_log_context;
 
 /** init function using global log context
@@ -297,6 +313,51 @@ void log_set_compress_log_days_before_ex(LogContext *pContext, const int days_be
 */
 void log_set_fd_flags(LogContext *pContext, const int flags);
 
+/** switch to the asynchronous mode: the log lines are formatted by the caller
+ *  into its own ring buffer (one per thread) without any lock, a background
+ *  thread writes the ring buffers to the log file by writev in batch.
+ *  the log line is dropped and counted when the ring buffer is full.
+ *  the lines of logEmerg, logAlert and logCrit (and log_it_ex2 with
+ *  bNeedSync) are written synchronously after the queued lines flushed,
+ *  never dropped. the other lines, including logInfo and logDebug, are
+ *  queued as usual.
+ *
+ *  NOTE: the background thread does NOT survive fork, so call this function
+ *        after daemon_init. the log lines of different threads in one batch
+ *        are NOT ordered by time strictly.
+ *
+ *  parameters:
+ *           pContext: the log context
+ *           buffer_size: the ring buffer size of each thread
+ *           flush_interval_ms: flush interval in milliseconds
+ *  return: error no, 0 for success, != 0 fail
+*/
+int log_set_async_ex(LogContext *pContext, const int buffer_size,
+        const int flush_interval_ms);
+
+#define log_set_async(buffer_size) \
+    log_set_async_ex(&g_log_context, buffer_size, \
+            LOG_ASYNC_DEF_FLUSH_INTERVAL_MS)
+
+/** get the dropped log lines count of the asynchronous mode
+ *  parameters:
+ *           pContext: the log context
+ *  return: the dropped count
+*/
+int64_t log_get_dropped_count_ex(LogContext *pContext);
+
+#define log_get_dropped_count() log_get_dropped_count_ex(&g_log_context)
+
+/** check if the log can output by the rate limiter
+ *  parameters:
+ *           limiter: the rate limiter
+ *           interval: the min interval in seconds
+ *           suppressed: return the suppressed count since last output
+ *  return: true for output, false for suppressed
+*/
+bool log_rate_limit_check(LogRateLimiter *limiter,
+        const int interval, int *suppressed);
+
 /** destroy function
  *  parameters:
  *           pContext: the log context
@@ -448,6 +509,44 @@ void logDebug(const char *format, ...)
 
 #endif
 
+/* the rate limited log macros, output at most one log every interval
+ * seconds for each call place. the format MUST be a string literal */
+#define FC_LOG_RATE_LIMITED(priority, log_func, interval, format, ...) \
+    do { \
+        static LogRateLimiter _limiter = {0, 0}; \
+        int _suppressed; \
+        if (FC_LOG_BY_LEVEL(priority) && log_rate_limit_check( \
+                    &_limiter, interval, &_suppressed)) \
+        { \
+            if (_suppressed > 0) { \
+                log_func(format ", %d similar logs suppressed", \
+                        ##__VA_ARGS__, _suppressed); \
+            } else { \
+                log_func(format, ##__VA_ARGS__); \
+            } \
+        } \
+    } while (0)
+
+#define logCritRL(interval, format, ...) \
+    FC_LOG_RATE_LIMITED(LOG_CRIT, logCrit, interval, format, ##__VA_ARGS__)
+
+#define logErrorRL(interval, format, ...) \
+    FC_LOG_RATE_LIMITED(LOG_ERR, logError, interval, format, ##__VA_ARGS__)
+
+#define logWarningRL(interval, format, ...) \
+    FC_LOG_RATE_LIMITED(LOG_WARNING, logWarning, \
+            interval, format, ##__VA_ARGS__)
+
+#define logNoticeRL(interval, format, ...) \
+    FC_LOG_RATE_LIMITED(LOG_NOTICE, logNotice, \
+            interval, format, ##__VA_ARGS__)
+
+#define logInfoRL(interval, format, ...) \
+    FC_LOG_RATE_LIMITED(LOG_INFO, logInfo, interval, format, ##__VA_ARGS__)
+
+#define logDebugRL(interval, format, ...) \
+    FC_LOG_RATE_LIMITED(LOG_DEBUG, logDebug, interval, format, ##__VA_ARGS__)
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//the check and benchmark of the asynchronous logger
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+
+#define THREAD_COUNT   8
+#define LOOP_COUNT     100000
+
+static void *log_thread_entrance(void *arg)
+{
+    long thread_index;
+    int i;
+
+    thread_index = (long)arg;
+    for (i=0; i<LOOP_COUNT; i++) {
+        //logInfo is queued in the asynchronous mode
+        logInfo("file: "__FILE__", line: %d, "
+                "thread: %ld, index: %d", __LINE__, thread_index, i);
+    }
+    return NULL;
+}
+
+static int64_t run_threads()
+{
+    pthread_t tids[THREAD_COUNT];
+    int64_t start_time;
+    long i;
+
+    start_time = get_current_time_us();
+    for (i=0; i<THREAD_COUNT; i++) {
+        pthread_create(tids + i, NULL, log_thread_entrance, (void *)i);
+    }
+    for (i=0; i<THREAD_COUNT; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    return get_current_time_us() - start_time;
+}
+
+static int64_t count_lines(const char *filename)
+{
+    char *content;
+    int64_t file_size;
+    int64_t count;
+    char *p;
+    char *end;
+
+    if (getFileContent(filename, &content, &file_size) != 0) {
+        return -1;
+    }
+
+    count = 0;
+    end = content + file_size;
+    for (p=content; p<end; p++) {
+        if (*p == '\n') {
+            count++;
+        }
+    }
+    free(content);
+    return count;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *filename = "/tmp/test_async_logger.log";
+    int64_t sync_time;
+    int64_t async_time;
+    int64_t lines;
+    int64_t dropped;
+    int result;
+    int i;
+
+    unlink(filename);
+    log_init();
+    if ((result=log_set_filename(filename)) != 0) {
+        return result;
+    }
+    log_set_cache(true);
+
+    sync_time = run_threads();
+    log_destroy();
+
+    unlink(filename);
+    log_init();
+    log_set_filename(filename);
+    if ((result=log_set_async(64 * 1024)) != 0) {
+        return result;
+    }
+    async_time = run_threads();
+
+    for (i=0; i<1000; i++) {
+        logWarningRL(60, "file: "__FILE__", line: %d, "
+                "rate limited, index: %d", __LINE__, i);
+    }
+
+    for (i=0; i<100; i++) {
+        logWarning("file: "__FILE__", line: %d, "
+                "before the sync line, index: %d", __LINE__, i);
+    }
+
+    /* the crit line is written synchronously after the queued lines,
+     * so all lines are in the file before the destroy */
+    logCrit("file: "__FILE__", line: %d, the sync line", __LINE__);
+    lines = count_lines(filename);
+    dropped = log_get_dropped_count();
+    if (lines + dropped != THREAD_COUNT * LOOP_COUNT + 102) {
+        fprintf(stderr, "after the sync line, lines: %"PRId64" + dropped: "
+                "%"PRId64" != %d\n", lines, dropped,
+                THREAD_COUNT * LOOP_COUNT + 102);
+        return EINVAL;
+    }
+
+    log_destroy();
+
+    lines = count_lines(filename);
+    printf("sync time used: %"PRId64" ms, async time used: %"PRId64" ms, "
+            "lines: %"PRId64", dropped: %"PRId64"\n", sync_time / 1000,
+            async_time / 1000, lines, dropped);
+
+    if (lines + dropped != THREAD_COUNT * LOOP_COUNT + 102) {
+        fprintf(stderr, "lines: %"PRId64" + dropped: %"PRId64" != %d\n",
+                lines, dropped, THREAD_COUNT * LOOP_COUNT + 102);
+        return EINVAL;
+    }
+
+    unlink(filename);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//the check and benchmark of CRC32, CRC32C and hash64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/hash.h"
+#include "fastcommon/fc_checksum.h"
+
+#define BUFFER_SIZE  (1024 * 1024)
+#define LOOP_COUNT   1024
+
+static uint32_t crc32_wrapper(uint32_t crc, const void *buff, const size_t len)
+{
+    return CRC32(buff, len);
+}
+
+static uint32_t hash64_wrapper(uint32_t crc, const void *buff, const size_t len)
+{
+    return (uint32_t)fc_hash64(buff, len, 0);
+}
+
+static uint32_t simple_hash_wrapper(uint32_t crc,
+        const void *buff, const size_t len)
+{
+    return simple_hash(buff, len);
+}
+
+static void benchmark(const char *caption, uint32_t (*func)(uint32_t crc,
+            const void *buff, const size_t len), const char *buff,
+        const int len, const int loop_count)
+{
+    int64_t start_time;
+    int64_t time_used;
+    uint32_t result;
+    int i;
+
+    result = 0;
+    start_time = get_current_time_us();
+    for (i=0; i<loop_count; i++) {
+        result = func(0, buff, len);
+    }
+    time_used = get_current_time_us() - start_time;
+    if (time_used <= 0) {
+        time_used = 1;
+    }
+
+    printf("%-12s buffer size: %7d, %7.2f MB/s, result: %08x\n", caption,
+            len, (double)len * loop_count / time_used, result);
+}
+
+static int check_results(const char *buff)
+{
+    const char *digits = "123456789";
+    FCHash64State state;
+    uint32_t crc;
+    uint32_t crc1;
+    uint32_t crc2;
+    uint64_t hash;
+    int len;
+    int i;
+
+    if ((crc=fc_crc32c(0, digits, strlen(digits))) != 0xE3069283) {
+        fprintf(stderr, "crc32c check value: %08x != e3069283\n", crc);
+        return EINVAL;
+    }
+    if ((hash=fc_hash64("", 0, 0)) != 0xEF46DB3751D8E999ULL) {
+        fprintf(stderr, "hash64 of empty: %"PRIx64" != "
+                "ef46db3751d8e999\n", hash);
+        return EINVAL;
+    }
+    if ((hash=fc_hash64("abc", 3, 0)) != 0x44BC2CF5AD770999ULL) {
+        fprintf(stderr, "hash64 of abc: %"PRIx64" != "
+                "44bc2cf5ad770999\n", hash);
+        return EINVAL;
+    }
+
+    for (len=0; len<=1024; len+=(len < 100 ? 1 : 97)) {
+        for (i=0; i<8; i++) {
+            crc = fc_crc32c(0, buff + i, len);
+            if (crc != fc_crc32c_sw(0, buff + i, len)) {
+                fprintf(stderr, "length: %d, offset: %d, crc32c "
+                        "hardware != software\n", len, i);
+                return EINVAL;
+            }
+
+            crc1 = fc_crc32c(0, buff + i, len / 3);
+            crc2 = fc_crc32c(0, buff + i + len / 3, len - len / 3);
+            if (fc_crc32c(crc1, buff + i + len / 3, len - len / 3) != crc ||
+                    fc_crc32c_combine(crc1, crc2, len - len / 3) != crc)
+            {
+                fprintf(stderr, "length: %d, offset: %d, crc32c "
+                        "stream or combine fail\n", len, i);
+                return EINVAL;
+            }
+
+            hash = fc_hash64(buff + i, len, i);
+            fc_hash64_init(&state, i);
+            fc_hash64_update(&state, buff + i, len / 3);
+            fc_hash64_update(&state, buff + i + len / 3, len / 3);
+            fc_hash64_update(&state, buff + i + 2 * (len / 3),
+                    len - 2 * (len / 3));
+            if (fc_hash64_final(&state) != hash) {
+                fprintf(stderr, "length: %d, offset: %d, hash64 "
+                        "stream fail\n", len, i);
+                return EINVAL;
+            }
+        }
+    }
+
+    printf("check OK, crc32c by CPU instruction: %d\n",
+            fc_crc32c_hw_enabled());
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char *buff;
+    int sizes[] = {16, 64, 4096, BUFFER_SIZE};
+    int result;
+    int i;
+
+    log_init();
+    if ((buff=(char *)malloc(BUFFER_SIZE + 8)) == NULL) {
+        return ENOMEM;
+    }
+    for (i=0; i<BUFFER_SIZE + 8; i++) {
+        buff[i] = (char)(i * 31 + (i >> 8));
+    }
+
+    if ((result=check_results(buff)) != 0) {
+        return result;
+    }
+
+    for (i=0; i<sizeof(sizes) / sizeof(sizes[0]); i++) {
+        benchmark("crc32", crc32_wrapper, buff, sizes[i],
+                (int64_t)LOOP_COUNT * BUFFER_SIZE / sizes[i] / 8);
+        benchmark("simple_hash", simple_hash_wrapper, buff, sizes[i],
+                (int64_t)LOOP_COUNT * BUFFER_SIZE / sizes[i] / 8);
+        benchmark("crc32c_sw", fc_crc32c_sw, buff, sizes[i],
+                (int64_t)LOOP_COUNT * BUFFER_SIZE / sizes[i]);
+        benchmark("crc32c", fc_crc32c, buff, sizes[i],
+                (int64_t)LOOP_COUNT * BUFFER_SIZE / sizes[i]);
+        benchmark("hash64", hash64_wrapper, buff, sizes[i],
+                (int64_t)LOOP_COUNT * BUFFER_SIZE / sizes[i]);
+    }
+
+    free(buff);
+    return 0;
+}
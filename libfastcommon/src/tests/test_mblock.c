@@ -31,11 +31,76 @@
 #include "fastcommon/system_info.h"
 #include "fastcommon/local_ip_func.h"
 
+#define BENCH_THREAD_COUNT   8
+#define BENCH_LOOP_COUNT     200000
+#define BENCH_BATCH_SIZE     16
+
 struct my_struct {
     struct fast_mblock_man *mblock;
     void *obj;
 };
 
+static struct fast_mblock_man bench_mblock;
+
+static void *bench_thread_func(void *arg)
+{
+    void *objs[BENCH_BATCH_SIZE];
+    int i;
+    int k;
+
+    for (i=0; i<BENCH_LOOP_COUNT; i++) {
+        for (k=0; k<BENCH_BATCH_SIZE; k++) {
+            if ((objs[k]=fast_mblock_alloc_object(&bench_mblock)) == NULL) {
+                fprintf(stderr, "alloc object fail\n");
+                return NULL;
+            }
+        }
+        for (k=0; k<BENCH_BATCH_SIZE; k++) {
+            fast_mblock_free_object(&bench_mblock, objs[k]);
+        }
+    }
+
+    return NULL;
+}
+
+static void test_multi_threads(const int magazine_capacity)
+{
+    pthread_t tids[BENCH_THREAD_COUNT];
+    struct fast_mblock_info stats[8];
+    int64_t start_time;
+    int64_t time_used;
+    int i;
+    int count;
+
+    fast_mblock_init_ex1(&bench_mblock, "bench", 64, 0, 0, NULL, NULL, true);
+    if (magazine_capacity > 0) {
+        fast_mblock_enable_magazine(&bench_mblock, magazine_capacity);
+    }
+
+    start_time = get_current_time_us();
+    for (i=0; i<BENCH_THREAD_COUNT; i++) {
+        pthread_create(tids + i, NULL, bench_thread_func, NULL);
+    }
+    for (i=0; i<BENCH_THREAD_COUNT; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    time_used = get_current_time_us() - start_time;
+
+    fast_mblock_manager_stat(stats, sizeof(stats) / sizeof(stats[0]), &count);
+    for (i=0; i<count; i++) {
+        if (strcmp(stats[i].name, "bench") == 0) {
+            break;
+        }
+    }
+    printf("threads: %d, magazine capacity: %d, alloc+free: %"PRId64", "
+            "time used: %"PRId64" ms, used count: %"PRId64"\n",
+            BENCH_THREAD_COUNT, magazine_capacity, (int64_t)
+            BENCH_THREAD_COUNT * BENCH_LOOP_COUNT * BENCH_BATCH_SIZE,
+            time_used / 1000, i < count ? stats[i].element_used_count : -1);
+
+    fast_mblock_destroy(&bench_mblock);
+}
+
 static int test_delay(void *args)
 {
     struct my_struct *my;
@@ -180,6 +245,9 @@ int main(int argc, char *argv[])
 
     fast_mblock_manager_init();
 
+    test_multi_threads(0);
+    test_multi_threads(64);
+
     fast_mblock_init_ex1(&mblock1, "mblock1", 1024, 128, 0, NULL, NULL, false);
     fast_mblock_init_ex1(&mblock2, "mblock2", 1024, 100, 0, NULL, NULL, false);
    
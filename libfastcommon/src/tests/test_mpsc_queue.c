@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the Lesser GNU General Public License, version 3
+ * or later ("LGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the Lesser GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//the contention benchmark of fc_queue vs. fc_mpsc_queue
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/fc_memory.h"
+#include "fastcommon/fc_queue.h"
+#include "fastcommon/fc_mpsc_queue.h"
+
+#define DEFAULT_PRODUCER_COUNT   4
+#define DEFAULT_ITEMS_PER_THREAD (1000 * 1000)
+
+typedef struct test_node {
+    int producer;
+    int64_t seq;
+    struct test_node *next;
+} TestNode;
+
+typedef struct {
+    int index;
+    TestNode *nodes;
+} ProducerArg;
+
+static int producer_count = DEFAULT_PRODUCER_COUNT;
+static int64_t items_per_thread = DEFAULT_ITEMS_PER_THREAD;
+static bool use_mpsc;
+static struct fc_queue queue;
+static struct fc_mpsc_queue mpsc_queue;
+
+static void *producer_thread(void *arg)
+{
+    ProducerArg *parg;
+    TestNode *node;
+    TestNode *end;
+
+    parg = (ProducerArg *)arg;
+    end = parg->nodes + items_per_thread;
+    for (node=parg->nodes; node<end; node++) {
+        if (use_mpsc) {
+            fc_mpsc_queue_push(&mpsc_queue, node);
+        } else {
+            fc_queue_push(&queue, node);
+        }
+    }
+
+    return NULL;
+}
+
+static int run_test(const char *caption, const bool mpsc)
+{
+    pthread_t *tids;
+    ProducerArg *args;
+    TestNode *nodes;
+    TestNode *node;
+    int64_t *last_seqs;
+    int64_t total;
+    int64_t count;
+    int64_t start_time;
+    int64_t time_used;
+    int i;
+    int result;
+
+    use_mpsc = mpsc;
+    total = producer_count * items_per_thread;
+    nodes = (TestNode *)fc_malloc(sizeof(TestNode) * total);
+    tids = (pthread_t *)fc_malloc(sizeof(pthread_t) * producer_count);
+    args = (ProducerArg *)fc_malloc(sizeof(ProducerArg) * producer_count);
+    last_seqs = (int64_t *)fc_malloc(sizeof(int64_t) * producer_count);
+    if (nodes == NULL || tids == NULL || args == NULL || last_seqs == NULL) {
+        return ENOMEM;
+    }
+
+    for (i=0; i<producer_count; i++) {
+        args[i].index = i;
+        args[i].nodes = nodes + i * items_per_thread;
+        last_seqs[i] = -1;
+    }
+    for (count=0; count<total; count++) {
+        nodes[count].producer = count / items_per_thread;
+        nodes[count].seq = count % items_per_thread;
+    }
+
+    if (mpsc) {
+        result = fc_mpsc_queue_init(&mpsc_queue,
+                (long)(&((TestNode *)NULL)->next));
+    } else {
+        result = fc_queue_init(&queue, (long)(&((TestNode *)NULL)->next));
+    }
+    if (result != 0) {
+        return result;
+    }
+
+    start_time = get_current_time_us();
+    for (i=0; i<producer_count; i++) {
+        if ((result=pthread_create(tids + i, NULL,
+                        producer_thread, args + i)) != 0)
+        {
+            return result;
+        }
+    }
+
+    count = 0;
+    while (count < total) {
+        if (mpsc) {
+            node = (TestNode *)fc_mpsc_queue_pop_all(&mpsc_queue);
+        } else {
+            node = (TestNode *)fc_queue_pop_all(&queue);
+        }
+
+        while (node != NULL) {
+            if (node->seq != last_seqs[node->producer] + 1) {
+                fprintf(stderr, "producer: %d, seq: %"PRId64" != "
+                        "expected: %"PRId64"\n", node->producer,
+                        node->seq, last_seqs[node->producer] + 1);
+                return EINVAL;
+            }
+            last_seqs[node->producer] = node->seq;
+            count++;
+            node = node->next;
+        }
+    }
+    time_used = get_current_time_us() - start_time;
+
+    for (i=0; i<producer_count; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    printf("%s: producers: %d, items: %"PRId64", time used: %"PRId64" ms, "
+            "QPS: %"PRId64"\n", caption, producer_count, total,
+            time_used / 1000, time_used > 0 ?
+            total * 1000 * 1000 / time_used : 0);
+
+    if (mpsc) {
+        fc_mpsc_queue_destroy(&mpsc_queue);
+    } else {
+        fc_queue_destroy(&queue);
+    }
+    free(nodes);
+    free(tids);
+    free(args);
+    free(last_seqs);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int result;
+
+    if (argc > 1) {
+        producer_count = strtol(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        items_per_thread = strtoll(argv[2], NULL, 10);
+    }
+    if (producer_count <= 0 || items_per_thread <= 0) {
+        fprintf(stderr, "Usage: %s [producer_count] [items_per_thread]\n",
+                argv[0]);
+        return EINVAL;
+    }
+
+    log_init();
+    if ((result=run_test("fc_queue", false)) != 0) {
+        return result;
+    }
+    return run_test("fc_mpsc_queue", true);
+}
@@ -239,6 +239,39 @@ static void test_find_range()
     printf("count: %d\n\n", i);
 }
 
+static void test_iterator_from()
+{
+    int v;
+    int result;
+    int count;
+    int *value;
+    UniqSkiplistIterator iterator;
+
+    v = 101;
+    result = uniq_skiplist_iterator_from(sl, &v, true, &iterator);
+    assert(result == 0);
+    value = (int *)uniq_skiplist_next(&iterator);
+    assert(value != NULL && *value == 101);
+    count = uniq_skiplist_iterator_count(&iterator);
+    assert(count == COUNT - 51);
+
+    result = uniq_skiplist_iterator_from(sl, &v, false, &iterator);
+    assert(result == 0);
+    value = (int *)uniq_skiplist_next(&iterator);
+    assert(value != NULL && *value == 103);
+
+    v = 100;
+    result = uniq_skiplist_iterator_from(sl, &v, false, &iterator);
+    assert(result == 0);
+    count = uniq_skiplist_iterator_count(&iterator);
+    assert(count == COUNT - 50);
+
+    v = 2 * COUNT - 1;
+    result = uniq_skiplist_iterator_from(sl, &v, false, &iterator);
+    assert(result == ENOENT);
+    assert(uniq_skiplist_next(&iterator) == NULL);
+}
+
 static void test_reverse_iterator()
 {
     UniqSkiplistNode *node;
@@ -293,6 +326,8 @@ int main(int argc, char *argv[])
 
     test_find_range();
 
+    test_iterator_from();
+
     test_reverse_iterator();
 
     test_delete();
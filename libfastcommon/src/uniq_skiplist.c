@@ -591,6 +591,19 @@ UniqSkiplistNode *uniq_skiplist_find_ge_node(UniqSkiplist *sl, void *data)
     return node;
 }
 
+int uniq_skiplist_iterator_from(UniqSkiplist *sl, void *start_data,
+        const bool inclusive, UniqSkiplistIterator *iterator)
+{
+    if (inclusive) {
+        iterator->current = uniq_skiplist_get_first_larger_or_equal(
+                sl, start_data);
+    } else {
+        iterator->current = uniq_skiplist_get_first_larger(sl, start_data);
+    }
+    iterator->tail = sl->factory->tail;
+    return iterator->current != iterator->tail ? 0 : ENOENT;
+}
+
 int uniq_skiplist_find_range(UniqSkiplist *sl, void *start_data,
         void *end_data, UniqSkiplistIterator *iterator)
 {
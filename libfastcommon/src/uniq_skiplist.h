@@ -122,6 +122,13 @@ void uniq_skiplist_delete_node_ex(UniqSkiplist *sl,
 
 UniqSkiplistNode *uniq_skiplist_find_ge_node(UniqSkiplist *sl, void *data);
 
+/* init the iterator from the first node larger than the start data,
+ * include the node equal to the start data when inclusive is true
+ * return 0 for found, ENOENT for not found
+*/
+int uniq_skiplist_iterator_from(UniqSkiplist *sl, void *start_data,
+        const bool inclusive, UniqSkiplistIterator *iterator);
+
 static inline void *uniq_skiplist_find_ge(UniqSkiplist *sl, void *data)
 {
     UniqSkiplistNode *node;
@@ -256,6 +256,22 @@ static inline void binlog_writer_set_next_version(SFBinlogWriterInfo *writer,
         const uint64_t next_version)
 {
     writer->version_ctx.next = next_version;
+    writer->flushed.version = next_version - 1;
+}
+
+static inline void binlog_writer_notify_flushed(SFBinlogWriterInfo *writer)
+{
+    if (writer->flushed.version == writer->version_ctx.next - 1) {
+        return;
+    }
+
+    writer->flushed.version = writer->version_ctx.next - 1;
+    __sync_synchronize();
+    if (writer->flushed.waiting_count > 0) {
+        PTHREAD_MUTEX_LOCK(&writer->flushed.lcp.lock);
+        pthread_cond_broadcast(&writer->flushed.lcp.cond);
+        PTHREAD_MUTEX_UNLOCK(&writer->flushed.lcp.lock);
+    }
 }
 
 static inline int deal_binlog_one_record(SFBinlogWriterBuffer *wb)
@@ -411,6 +427,9 @@ static inline int flush_writer_files(SFBinlogWriterThread *thread)
             return result;
         }
 
+        if (thread->order_by == SF_BINLOG_THREAD_TYPE_ORDER_BY_VERSION) {
+            binlog_writer_notify_flushed(writer);
+        }
         writer->flush.in_queue = false;
         writer = writer->flush.next;
     }
@@ -584,6 +603,10 @@ int sf_binlog_writer_init_normal(SFBinlogWriterInfo *writer,
 
     writer->total_count = 0;
     writer->flush.in_queue = false;
+    writer->flushed.waiting_count = 0;
+    if ((result=init_pthread_lock_cond_pair(&writer->flushed.lcp)) != 0) {
+        return result;
+    }
     if ((result=sf_binlog_buffer_init(&writer->binlog_buffer,
                     buffer_size)) != 0)
     {
@@ -736,6 +759,40 @@ int sf_binlog_writer_change_next_version(SFBinlogWriterInfo *writer,
     return 0;
 }
 
+int sf_binlog_writer_wait_flushed(SFBinlogWriterInfo *writer,
+        const int64_t version, const int timeout_ms)
+{
+    struct timespec ts;
+    int64_t expires;
+    int64_t remain;
+    int result;
+
+    if (__sync_add_and_fetch(&writer->flushed.version, 0) >= version) {
+        return 0;
+    }
+
+    result = 0;
+    expires = get_current_time_ms() + timeout_ms;
+    __sync_add_and_fetch(&writer->flushed.waiting_count, 1);
+    PTHREAD_MUTEX_LOCK(&writer->flushed.lcp.lock);
+    while (__sync_add_and_fetch(&writer->flushed.version, 0) < version) {
+        remain = expires - get_current_time_ms();
+        if (remain <= 0 || !SF_G_CONTINUE_FLAG) {
+            result = ETIMEDOUT;
+            break;
+        }
+        remain = get_current_time_ms() + FC_MIN(remain, 1000);
+        ts.tv_sec = remain / 1000;
+        ts.tv_nsec = (remain % 1000) * 1000 * 1000;
+        pthread_cond_timedwait(&writer->flushed.lcp.cond,
+                &writer->flushed.lcp.lock, &ts);
+    }
+    PTHREAD_MUTEX_UNLOCK(&writer->flushed.lcp.lock);
+    __sync_sub_and_fetch(&writer->flushed.waiting_count, 1);
+
+    return result;
+}
+
 int sf_binlog_writer_set_binlog_index(SFBinlogWriterInfo *writer,
         const int binlog_index)
 {
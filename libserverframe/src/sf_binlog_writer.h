@@ -106,6 +106,11 @@ typedef struct sf_binlog_writer_info {
         bool in_queue;
         struct sf_binlog_writer_info *next;
     } flush;
+    struct {
+        volatile int64_t version;  //the last version written to file
+        volatile int waiting_count;
+        pthread_lock_cond_pair_t lcp;  //for wait flushed
+    } flushed;
 } SFBinlogWriterInfo;
 
 typedef struct sf_binlog_writer_context {
@@ -162,6 +167,12 @@ void sf_binlog_writer_finish(SFBinlogWriterInfo *writer);
 
 int sf_binlog_get_current_write_index(SFBinlogWriterInfo *writer);
 
+/* wait until the records of version <= the specify version written
+ * to file and fsynced, for the writer ordered by version only.
+ * return 0 for success, ETIMEDOUT for timeout */
+int sf_binlog_writer_wait_flushed(SFBinlogWriterInfo *writer,
+        const int64_t version, const int timeout_ms);
+
 void sf_binlog_get_current_write_position(SFBinlogWriterInfo *writer,
         SFBinlogFilePosition *position);
 
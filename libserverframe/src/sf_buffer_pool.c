@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//sf_buffer_pool.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/sched_thread.h"
+#include "sf_buffer_pool.h"
+
+#define SF_BUFFER_POOL_TRUNK_SIZE  (1024 * 1024)
+
+SFBufferPool g_sf_buffer_pool = {0};
+
+static int pooled_buffer_alloc_init(SFPooledBuffer *buffer,
+        SFBufferSizeClass *size_class)
+{
+    buffer->size = size_class->size;
+    buffer->allocator = &size_class->allocator;
+    return 0;
+}
+
+int sf_buffer_pool_init(SFBufferPool *pool,
+        const int min_size, const int max_size)
+{
+    int result;
+    int size;
+    int element_size;
+    int alloc_elements_once;
+    char name[FAST_MBLOCK_NAME_SIZE];
+    SFBufferSizeClass *size_class;
+
+    if (min_size <= 0 || max_size < min_size) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid buffer size range: [%d, %d]",
+                __LINE__, min_size, max_size);
+        return EINVAL;
+    }
+
+    pool->count = 0;
+    size = MEM_ALIGN(min_size);
+    while (1) {
+        if (size > max_size || pool->count ==
+                SF_BUFFER_POOL_MAX_CLASSES - 1)
+        {
+            size = MEM_ALIGN(max_size);
+        }
+
+        size_class = pool->classes + pool->count;
+        size_class->size = size;
+        element_size = sizeof(SFPooledBuffer) + size;
+        alloc_elements_once = SF_BUFFER_POOL_TRUNK_SIZE / element_size;
+        if (alloc_elements_once == 0) {
+            alloc_elements_once = 1;
+        }
+        if (size < 1024 * 1024) {
+            sprintf(name, "sf-buffer-%dK", size / 1024);
+        } else {
+            sprintf(name, "sf-buffer-%dM", size / (1024 * 1024));
+        }
+        if ((result=fast_mblock_init_ex1(&size_class->allocator, name,
+                        element_size, alloc_elements_once, 0,
+                        (fast_mblock_alloc_init_func)
+                        pooled_buffer_alloc_init,
+                        size_class, true)) != 0)
+        {
+            sf_buffer_pool_destroy(pool);
+            return result;
+        }
+        pool->count++;
+
+        if (size >= max_size) {
+            break;
+        }
+        size *= 2;
+    }
+
+    logDebug("file: "__FILE__", line: %d, "
+            "buffer pool size classes: %d, min size: %d, max size: %d",
+            __LINE__, pool->count, pool->classes[0].size,
+            pool->classes[pool->count - 1].size);
+    return 0;
+}
+
+void sf_buffer_pool_destroy(SFBufferPool *pool)
+{
+    SFBufferSizeClass *size_class;
+    SFBufferSizeClass *end;
+
+    end = pool->classes + pool->count;
+    for (size_class=pool->classes; size_class<end; size_class++) {
+        fast_mblock_destroy(&size_class->allocator);
+    }
+    pool->count = 0;
+}
+
+SFPooledBuffer *sf_buffer_pool_alloc(SFBufferPool *pool, const int size)
+{
+    SFBufferSizeClass *size_class;
+    SFBufferSizeClass *end;
+
+    end = pool->classes + pool->count;
+    for (size_class=pool->classes; size_class<end; size_class++) {
+        if (size <= size_class->size) {
+            break;
+        }
+    }
+    if (size_class == end) {
+        return NULL;
+    }
+
+    return (SFPooledBuffer *)fast_mblock_alloc_object(
+            &size_class->allocator);
+}
+
+int sf_buffer_pool_reclaim(SFBufferPool *pool)
+{
+    SFBufferSizeClass *size_class;
+    SFBufferSizeClass *end;
+    int reclaim_count;
+    int total_count;
+
+    total_count = 0;
+    end = pool->classes + pool->count;
+    for (size_class=pool->classes; size_class<end; size_class++) {
+        if (fast_mblock_reclaim(&size_class->allocator, 0,
+                    &reclaim_count, NULL) == 0)
+        {
+            total_count += reclaim_count;
+        }
+    }
+
+    if (total_count > 0) {
+        logDebug("file: "__FILE__", line: %d, "
+                "buffer pool reclaimed trunks: %d",
+                __LINE__, total_count);
+    }
+    return 0;
+}
+
+int sf_task_reserve_buffer(struct fast_task_info *task,
+        const int expect_size)
+{
+    SFPooledBuffer *buffer;
+    int copy_bytes;
+
+    if (expect_size <= task->size) {
+        return 0;
+    }
+    if (!sf_buffer_pool_enabled()) {
+        return EOVERFLOW;
+    }
+
+    if ((buffer=sf_buffer_pool_alloc(&g_sf_buffer_pool,
+                    expect_size)) == NULL)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "alloc pooled buffer fail, expect size: %d, "
+                "max size: %d", __LINE__, expect_size,
+                g_sf_buffer_pool.classes[g_sf_buffer_pool.count - 1].size);
+        return expect_size > g_sf_buffer_pool.classes[
+            g_sf_buffer_pool.count - 1].size ? EOVERFLOW : ENOMEM;
+    }
+
+    //task->length > task->size when the body is being received
+    copy_bytes = (task->length <= task->size) ? task->length : task->offset;
+    if (copy_bytes > 0) {
+        memcpy(buffer->data, task->data, copy_bytes);
+    }
+
+    if (task->borrowed.buffer != NULL) {
+        sf_buffer_pool_free((SFPooledBuffer *)task->borrowed.buffer);
+    } else {
+        task->borrowed.data = task->data;
+        task->borrowed.size = task->size;
+    }
+    task->borrowed.buffer = buffer;
+    task->data = buffer->data;
+    task->size = buffer->size;
+    return 0;
+}
+
+static int buffer_pool_reclaim_func(void *args)
+{
+    return sf_buffer_pool_reclaim((SFBufferPool *)args);
+}
+
+int sf_buffer_pool_add_reclaim_schedule(SFBufferPool *pool)
+{
+    ScheduleEntry schedule_entry;
+    ScheduleArray schedule_array;
+
+    INIT_SCHEDULE_ENTRY(schedule_entry, sched_generate_next_id(),
+            0, 0, 0, SF_BUFFER_POOL_RECLAIM_INTERVAL,
+            buffer_pool_reclaim_func, pool);
+
+    schedule_array.count = 1;
+    schedule_array.entries = &schedule_entry;
+    return sched_add_entries(&schedule_array);
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//sf_buffer_pool.h
+
+/* the size-classed buffer pool shared by the tasks.
+ *
+ * when min_buff_size < max_buff_size, the task keeps its small buffer
+ * (min_buff_size) while idle, and borrows a large buffer from this pool
+ * only while a request or response exceeding it is in flight */
+
+#ifndef _SF_BUFFER_POOL_H
+#define _SF_BUFFER_POOL_H
+
+#include "fastcommon/common_define.h"
+#include "fastcommon/fast_mblock.h"
+#include "fastcommon/fast_task_queue.h"
+
+#define SF_BUFFER_POOL_MAX_CLASSES        24
+#define SF_BUFFER_POOL_RECLAIM_INTERVAL   60
+
+typedef struct sf_pooled_buffer {
+    int size;   //the buffer capacity
+    struct fast_mblock_man *allocator;
+    char data[0];
+} SFPooledBuffer;
+
+typedef struct sf_buffer_size_class {
+    int size;
+    struct fast_mblock_man allocator;
+} SFBufferSizeClass;
+
+typedef struct sf_buffer_pool {
+    int count;  //the size class count, 0 for disabled
+    SFBufferSizeClass classes[SF_BUFFER_POOL_MAX_CLASSES];
+} SFBufferPool;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    extern SFBufferPool g_sf_buffer_pool;
+
+    /* the size classes double from min_size to max_size */
+    int sf_buffer_pool_init(SFBufferPool *pool,
+            const int min_size, const int max_size);
+
+    void sf_buffer_pool_destroy(SFBufferPool *pool);
+
+    /* return NULL when size > the max size or out of memory */
+    SFPooledBuffer *sf_buffer_pool_alloc(SFBufferPool *pool, const int size);
+
+    /* free the idle memory trunks to the system */
+    int sf_buffer_pool_reclaim(SFBufferPool *pool);
+
+    /* reclaim the pool periodically by the schedule thread */
+    int sf_buffer_pool_add_reclaim_schedule(SFBufferPool *pool);
+
+    static inline void sf_buffer_pool_free(SFPooledBuffer *buffer)
+    {
+        fast_mblock_free_object(buffer->allocator, buffer);
+    }
+
+#define sf_buffer_pool_enabled() (g_sf_buffer_pool.count > 0)
+
+    /* make sure the task buffer size >= expect_size, borrow a shared buffer
+     * when the own buffer is too small. the received bytes (during recv)
+     * or the request package (during deal) are copied to the new buffer,
+     * so the pointers to the old task->data MUST be reset by the caller.
+     * return error no, 0 for success, EOVERFLOW when the pool disabled */
+    int sf_task_reserve_buffer(struct fast_task_info *task,
+            const int expect_size);
+
+    /* give back the borrowed buffer and restore the own buffer */
+    static inline void sf_task_return_buffer(struct fast_task_info *task)
+    {
+        if (task->borrowed.buffer != NULL) {
+            sf_buffer_pool_free((SFPooledBuffer *)task->borrowed.buffer);
+            task->data = task->borrowed.data;
+            task->size = task->borrowed.size;
+            task->borrowed.buffer = NULL;
+        }
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -27,6 +27,15 @@
 #define SF_DEF_MIN_BUFF_SIZE      (64 * 1024)
 #define SF_DEF_MAX_BUFF_SIZE      (64 * 1024)
 #define SF_MAX_NETWORK_BUFF_SIZE  (2 * 1024 * 1024 * 1024LL)
+#define SF_DEF_PIPELINE_MAX_INFLIGHT  64
+#define SF_DEF_PIPELINE_MAX_TASKS    256
+
+#define SF_METRICS_TYPE_CMD       'c'
+#define SF_METRICS_TYPE_STAGE     's'
+#define SF_DEF_METRICS_DUMP_INTERVAL  60
+
+#define SF_TRACE_FLAG_SAMPLED     1
+#define SF_DEF_TRACE_SPAN_COUNT   8192
 
 #define SF_NIO_STAGE_NONE        0
 #define SF_NIO_STAGE_INIT        1  //set ioevent
@@ -37,6 +37,7 @@ SFGlobalVariables g_sf_global_vars = {
     {'/', 't', 'm', 'p', '\0'}, true, true, DEFAULT_MAX_CONNECTONS,
     SF_DEF_MAX_PACKAGE_SIZE, SF_DEF_MIN_BUFF_SIZE,
     SF_DEF_MAX_BUFF_SIZE, 0, SF_DEF_THREAD_STACK_SIZE,
+    SF_DEF_METRICS_DUMP_INTERVAL, SF_DEF_TRACE_SPAN_COUNT,
     0, 0, 0, {'\0'}, {'\0'}, {SYNC_LOG_BUFF_DEF_INTERVAL, false}, {0, 0}
 };
 
@@ -185,6 +186,12 @@ int sf_load_log_config(IniFullContext *ini_ctx, LogContext *log_ctx,
             "log_file_rotate_on_size", 0, 1, 0,
             64 * 1024 * 1024 * 1024LL, true);
     sf_set_log_rotate_size(log_ctx, log_cfg->rotate_on_size);
+
+    log_cfg->async.enabled = iniGetBoolValueEx(ini_ctx->section_name,
+            "async_log", ini_ctx->context, false, true);
+    log_cfg->async.buffer_size = iniGetByteCorrectValueEx(ini_ctx,
+            "async_log_buffer_size", LOG_ASYNC_DEF_BUFFER_SIZE, 1,
+            16 * 1024, 64 * 1024 * 1024, true);
     return 0;
 }
 
@@ -329,6 +336,13 @@ int sf_load_global_config_ex(const char *server_name,
             "thread_stack_size", SF_DEF_THREAD_STACK_SIZE, 1,
             SF_MIN_THREAD_STACK_SIZE, SF_MAX_THREAD_STACK_SIZE, true);
 
+    g_sf_global_vars.metrics_dump_interval = iniGetIntValueEx(
+            ini_ctx->section_name, "metrics_dump_interval", ini_ctx->context,
+            SF_DEF_METRICS_DUMP_INTERVAL, true);
+    g_sf_global_vars.trace_span_count = iniGetIntValueEx(
+            ini_ctx->section_name, "trace_span_count", ini_ctx->context,
+            SF_DEF_TRACE_SPAN_COUNT, true);
+
     old_section_name = ini_ctx->section_name;
     ini_ctx->section_name = "error_log";
     if ((result=sf_load_log_config(ini_ctx, &g_log_context,
@@ -473,14 +487,16 @@ void sf_log_config_to_string_ex(SFLogConfig *log_cfg, const char *caption,
             "%s: {%s%ssync_log_buff_interval=%d, rotate_everyday=%d, "
             "rotate_time=%02d:%02d, rotate_on_size=%"PRId64", "
             "compress_old=%d, compress_days_before=%d, keep_days=%d, "
-            "delete_old_time=%02d:%02d}", caption,
+            "delete_old_time=%02d:%02d, async_log=%d, "
+            "async_log_buffer_size=%d KB}", caption,
             other_config != NULL ? other_config : "",
             other_config != NULL ? ", " : "",
             log_cfg->sync_log_buff_interval, log_cfg->rotate_everyday,
             log_cfg->rotate_time.hour, log_cfg->rotate_time.minute,
             log_cfg->rotate_on_size, log_cfg->compress_old,
             log_cfg->compress_days_before, log_cfg->keep_days,
-            log_cfg->delete_old_time.hour, log_cfg->delete_old_time.minute);
+            log_cfg->delete_old_time.hour, log_cfg->delete_old_time.minute,
+            log_cfg->async.enabled, log_cfg->async.buffer_size / 1024);
 }
 
 void sf_slow_log_config_to_string(SFSlowLogConfig *slow_log_cfg,
@@ -518,7 +534,8 @@ void sf_global_config_to_string(char *output, const int size)
             "base_path=%s, max_connections=%d, connect_timeout=%d, "
             "network_timeout=%d, thread_stack_size=%s, max_pkg_size=%s, "
             "min_buff_size=%s, max_buff_size=%s, task_buffer_extra_size=%d, "
-            "tcp_quick_ack=%d, log_level=%s, "
+            "tcp_quick_ack=%d, metrics_dump_interval=%d, "
+            "trace_span_count=%d, log_level=%s, "
             "run_by_group=%s, run_by_user=%s, ",
             g_sf_global_vars.base_path,
             g_sf_global_vars.max_connections,
@@ -531,6 +548,8 @@ void sf_global_config_to_string(char *output, const int size)
             int_to_comma_str(g_sf_global_vars.max_buff_size, sz_max_buff_size),
             g_sf_global_vars.task_buffer_extra_size,
             g_sf_global_vars.tcp_quick_ack,
+            g_sf_global_vars.metrics_dump_interval,
+            g_sf_global_vars.trace_span_count,
             log_get_level_caption(),
             g_sf_global_vars.run_by_group,
             g_sf_global_vars.run_by_user
@@ -542,7 +561,7 @@ void sf_global_config_to_string(char *output, const int size)
 
 void sf_log_config_ex(const char *other_config)
 {
-    char sz_global_config[512];
+    char sz_global_config[768];
     char sz_context_config[128];
 
     sf_global_config_to_string(sz_global_config, sizeof(sz_global_config));
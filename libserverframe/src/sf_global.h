@@ -42,6 +42,8 @@ typedef struct sf_global_variables {
     int max_buff_size;
     int task_buffer_extra_size;
     int thread_stack_size;
+    int metrics_dump_interval;  //in seconds, 0 for never dump
+    int trace_span_count;       //the span ring size, 0 for disable trace
 
     time_t up_time;
     gid_t run_by_gid;
@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//sf_metrics.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/sched_thread.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/fast_buffer.h"
+#include "fastcommon/fc_memory.h"
+#include "sf_global.h"
+#include "sf_service.h"
+#include "sf_metrics.h"
+
+SFMetricsRegistry g_sf_metrics = {{'\0'}, NULL, 0};
+
+static __thread SFMetricsThreadContext *metrics_thread_ctx = NULL;
+
+static inline int histogram_bucket_index(const int64_t value)
+{
+    int shift;
+    int group;
+
+    if (value < SF_METRICS_SUB_BUCKET_COUNT) {
+        return value > 0 ? value : 0;
+    }
+
+    shift = (63 - __builtin_clzll(value)) - SF_METRICS_SUB_BUCKET_BITS;
+    group = shift + 1;
+    if (group >= SF_METRICS_GROUP_COUNT) {
+        return SF_METRICS_BUCKET_COUNT - 1;
+    }
+    return group * SF_METRICS_SUB_BUCKET_COUNT + ((value >> shift) &
+            (SF_METRICS_SUB_BUCKET_COUNT - 1));
+}
+
+//the max value of the bucket
+static inline int64_t histogram_bucket_value(const int index)
+{
+    int group;
+    int sub;
+
+    group = index / SF_METRICS_SUB_BUCKET_COUNT;
+    if (group == 0) {
+        return index;
+    }
+
+    sub = index % SF_METRICS_SUB_BUCKET_COUNT;
+    return ((int64_t)(SF_METRICS_SUB_BUCKET_COUNT + sub + 1) <<
+            (group - 1)) - 1;
+}
+
+static int metrics_dump_func(void *args)
+{
+    return sf_metrics_dump_prometheus(g_sf_metrics.dump_filename);
+}
+
+static int metrics_add_dump_schedule()
+{
+    ScheduleEntry schedule_entry;
+    ScheduleArray schedule_array;
+
+    INIT_SCHEDULE_ENTRY(schedule_entry, sched_generate_next_id(),
+            0, 0, 0, g_sf_global_vars.metrics_dump_interval,
+            metrics_dump_func, NULL);
+
+    schedule_array.count = 1;
+    schedule_array.entries = &schedule_entry;
+    return sched_add_entries(&schedule_array);
+}
+
+int sf_metrics_init(const char *prefix,
+        sf_metrics_cmd_caption_func cmd_caption,
+        const char **stage_names, const int stage_count)
+{
+    int result;
+    int i;
+
+    if (stage_count > SF_METRICS_MAX_STAGES) {
+        logError("file: "__FILE__", line: %d, "
+                "stage count: %d exceeds %d", __LINE__,
+                stage_count, SF_METRICS_MAX_STAGES);
+        return EOVERFLOW;
+    }
+
+    if ((result=init_pthread_lock(&g_sf_metrics.lock)) != 0) {
+        return result;
+    }
+
+    snprintf(g_sf_metrics.prefix, sizeof(g_sf_metrics.prefix),
+            "%s", prefix);
+    g_sf_metrics.cmd_caption = cmd_caption;
+    for (i=0; i<stage_count; i++) {
+        snprintf(g_sf_metrics.stage_names[i], SF_METRICS_NAME_SIZE,
+                "%s", stage_names[i]);
+    }
+    g_sf_metrics.stage_count = stage_count;
+
+    if (g_sf_global_vars.metrics_dump_interval <= 0) {
+        return 0;
+    }
+
+    snprintf(g_sf_metrics.dump_filename, sizeof(g_sf_metrics.dump_filename),
+            "%s/logs/%s_metrics.prom", SF_G_BASE_PATH, prefix);
+    return metrics_add_dump_schedule();
+}
+
+static SFMetricsThreadContext *metrics_alloc_thread_context()
+{
+    SFMetricsThreadContext *ctx;
+
+    if ((ctx=(SFMetricsThreadContext *)fc_calloc(1,
+                    sizeof(SFMetricsThreadContext))) == NULL)
+    {
+        return NULL;
+    }
+
+    //the context is kept after the thread exits for the accumulated values
+    PTHREAD_MUTEX_LOCK(&g_sf_metrics.lock);
+    ctx->next = g_sf_metrics.head;
+    g_sf_metrics.head = ctx;
+    PTHREAD_MUTEX_UNLOCK(&g_sf_metrics.lock);
+    return ctx;
+}
+
+void sf_metrics_record(const int item, const int64_t time_used_us)
+{
+    SFHistogram *histogram;
+
+    if (item < 0 || item >= SF_METRICS_MAX_ITEMS) {
+        return;
+    }
+
+    if (metrics_thread_ctx == NULL) {
+        if ((metrics_thread_ctx=metrics_alloc_thread_context()) == NULL) {
+            return;
+        }
+    }
+
+    if ((histogram=metrics_thread_ctx->items[item]) == NULL) {
+        if ((histogram=(SFHistogram *)fc_calloc(1,
+                        sizeof(SFHistogram))) == NULL)
+        {
+            return;
+        }
+        metrics_thread_ctx->items[item] = histogram;
+    }
+
+    sf_histogram_add(histogram, time_used_us);
+}
+
+void sf_histogram_add(SFHistogram *histogram, const int64_t value)
+{
+    histogram->count++;
+    histogram->sum += value;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+    histogram->buckets[histogram_bucket_index(value)]++;
+}
+
+void sf_histogram_merge(SFHistogram *dest, const SFHistogram *src)
+{
+    int i;
+
+    dest->count += src->count;
+    dest->sum += src->sum;
+    if (src->max > dest->max) {
+        dest->max = src->max;
+    }
+    for (i=0; i<SF_METRICS_BUCKET_COUNT; i++) {
+        dest->buckets[i] += src->buckets[i];
+    }
+}
+
+void sf_metrics_collect(const int item, SFHistogram *histogram)
+{
+    SFMetricsThreadContext *ctx;
+    SFHistogram *src;
+
+    memset(histogram, 0, sizeof(SFHistogram));
+    PTHREAD_MUTEX_LOCK(&g_sf_metrics.lock);
+    for (ctx=g_sf_metrics.head; ctx!=NULL; ctx=ctx->next) {
+        if ((src=ctx->items[item]) == NULL) {
+            continue;
+        }
+
+        sf_histogram_merge(histogram, src);
+    }
+    PTHREAD_MUTEX_UNLOCK(&g_sf_metrics.lock);
+}
+
+static int64_t histogram_percentile(const SFHistogram *histogram,
+        const int64_t total, const double quantile)
+{
+    int64_t target;
+    int64_t count;
+    int64_t value;
+    int i;
+
+    target = (int64_t)(total * quantile + 0.999999);
+    if (target <= 0) {
+        target = 1;
+    }
+
+    count = 0;
+    for (i=0; i<SF_METRICS_BUCKET_COUNT; i++) {
+        count += histogram->buckets[i];
+        if (count >= target) {
+            value = histogram_bucket_value(i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+
+    return histogram->max;
+}
+
+void sf_histogram_summary(const SFHistogram *histogram,
+        SFMetricsSummary *summary)
+{
+    int64_t total;
+    int i;
+
+    /* the count may be a little less than the sum of the buckets
+     * since the recording threads run without lock */
+    total = 0;
+    for (i=0; i<SF_METRICS_BUCKET_COUNT; i++) {
+        total += histogram->buckets[i];
+    }
+
+    summary->count = histogram->count;
+    summary->sum = histogram->sum;
+    summary->max = histogram->max;
+    if (total == 0) {
+        summary->p50 = summary->p99 = summary->p999 = 0;
+        return;
+    }
+
+    summary->p50 = histogram_percentile(histogram, total, 0.5);
+    summary->p99 = histogram_percentile(histogram, total, 0.99);
+    summary->p999 = histogram_percentile(histogram, total, 0.999);
+}
+
+static void metrics_get_item_name(const int item,
+        char *type, char *name)
+{
+    const char *caption;
+
+    if (item < SF_METRICS_MAX_CMDS) {
+        *type = SF_METRICS_TYPE_CMD;
+        caption = (g_sf_metrics.cmd_caption != NULL) ?
+            g_sf_metrics.cmd_caption(item) : NULL;
+        if (caption != NULL) {
+            snprintf(name, SF_METRICS_NAME_SIZE, "%s", caption);
+        } else {
+            snprintf(name, SF_METRICS_NAME_SIZE, "%d", item);
+        }
+    } else {
+        *type = SF_METRICS_TYPE_STAGE;
+        if (item - SF_METRICS_MAX_CMDS < g_sf_metrics.stage_count) {
+            strcpy(name, g_sf_metrics.stage_names[
+                    item - SF_METRICS_MAX_CMDS]);
+        } else {
+            snprintf(name, SF_METRICS_NAME_SIZE, "stage%d",
+                    item - SF_METRICS_MAX_CMDS);
+        }
+    }
+}
+
+int sf_metrics_get_items(SFMetricsItemInfo *items, const int size)
+{
+    SFHistogram *histogram;
+    SFMetricsItemInfo *info;
+    SFMetricsItemInfo *end;
+    int item;
+
+    if ((histogram=(SFHistogram *)fc_malloc(sizeof(SFHistogram))) == NULL) {
+        return 0;
+    }
+
+    info = items;
+    end = items + size;
+    for (item=0; item<SF_METRICS_MAX_ITEMS && info<end; item++) {
+        sf_metrics_collect(item, histogram);
+        if (histogram->count == 0) {
+            continue;
+        }
+
+        metrics_get_item_name(item, &info->type, info->name);
+        sf_histogram_summary(histogram, &info->summary);
+        info++;
+    }
+
+    free(histogram);
+    return info - items;
+}
+
+static int metrics_output_prometheus(FastBuffer *buffer,
+        const char *metric, const char *label,
+        SFMetricsItemInfo *items, const int count, const char type)
+{
+    SFMetricsItemInfo *info;
+    SFMetricsItemInfo *end;
+    int result;
+
+    if ((result=fast_buffer_append(buffer,
+                    "# TYPE %s_%s summary\n",
+                    g_sf_metrics.prefix, metric)) != 0)
+    {
+        return result;
+    }
+
+    end = items + count;
+    for (info=items; info<end; info++) {
+        if (info->type != type) {
+            continue;
+        }
+
+        if ((result=fast_buffer_append(buffer,
+                        "%s_%s{%s=\"%s\",quantile=\"0.5\"} %"PRId64"\n"
+                        "%s_%s{%s=\"%s\",quantile=\"0.99\"} %"PRId64"\n"
+                        "%s_%s{%s=\"%s\",quantile=\"0.999\"} %"PRId64"\n"
+                        "%s_%s_sum{%s=\"%s\"} %"PRId64"\n"
+                        "%s_%s_count{%s=\"%s\"} %"PRId64"\n",
+                        g_sf_metrics.prefix, metric, label, info->name,
+                        info->summary.p50,
+                        g_sf_metrics.prefix, metric, label, info->name,
+                        info->summary.p99,
+                        g_sf_metrics.prefix, metric, label, info->name,
+                        info->summary.p999,
+                        g_sf_metrics.prefix, metric, label, info->name,
+                        info->summary.sum,
+                        g_sf_metrics.prefix, metric, label, info->name,
+                        info->summary.count)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static int metrics_output_notify_stat(FastBuffer *buffer)
+{
+    int64_t notifies;
+    int64_t wakeups;
+
+    sf_get_notify_stat(&notifies, &wakeups);
+    return fast_buffer_append(buffer,
+            "# HELP %s_nio_notifies_total the tasks notified "
+            "to the nio threads\n"
+            "# TYPE %s_nio_notifies_total counter\n"
+            "%s_nio_notifies_total %"PRId64"\n"
+            "# HELP %s_nio_wakeups_total the wakeups of the nio "
+            "threads for the notified tasks\n"
+            "# TYPE %s_nio_wakeups_total counter\n"
+            "%s_nio_wakeups_total %"PRId64"\n",
+            g_sf_metrics.prefix, g_sf_metrics.prefix,
+            g_sf_metrics.prefix, notifies, g_sf_metrics.prefix,
+            g_sf_metrics.prefix, g_sf_metrics.prefix, wakeups);
+}
+
+int sf_metrics_dump_prometheus(const char *filename)
+{
+    SFMetricsItemInfo *items;
+    FastBuffer buffer;
+    int count;
+    int result;
+
+    if ((items=(SFMetricsItemInfo *)fc_malloc(sizeof(SFMetricsItemInfo) *
+                    SF_METRICS_MAX_ITEMS)) == NULL)
+    {
+        return ENOMEM;
+    }
+    if ((result=fast_buffer_init_ex(&buffer, 16 * 1024)) != 0) {
+        free(items);
+        return result;
+    }
+
+    count = sf_metrics_get_items(items, SF_METRICS_MAX_ITEMS);
+    if ((result=fast_buffer_append(&buffer, "# HELP %s_cmd_latency_us "
+                    "the request latency in microseconds by command\n",
+                    g_sf_metrics.prefix)) == 0 &&
+            (result=metrics_output_prometheus(&buffer, "cmd_latency_us",
+                    "cmd", items, count, SF_METRICS_TYPE_CMD)) == 0 &&
+            (result=fast_buffer_append(&buffer, "# HELP %s_stage_latency_us "
+                    "the latency in microseconds by processing stage\n",
+                    g_sf_metrics.prefix)) == 0 &&
+            (result=metrics_output_prometheus(&buffer, "stage_latency_us",
+                    "stage", items, count, SF_METRICS_TYPE_STAGE)) == 0 &&
+            (result=metrics_output_notify_stat(&buffer)) == 0)
+    {
+        if ((result=safeWriteToFile(filename, buffer.data,
+                        buffer.length)) != 0)
+        {
+            logError("file: "__FILE__", line: %d, "
+                    "write metrics to file %s fail, "
+                    "errno: %d, error info: %s", __LINE__,
+                    filename, result, STRERROR(result));
+        }
+    }
+
+    fast_buffer_destroy(&buffer);
+    free(items);
+    return result;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//sf_metrics.h
+
+/* the latency histograms by command and by stage.
+ *
+ * the histogram is log-linear (HDR style): 16 sub-buckets for every power
+ * of 2, so the relative error of the percentile is less than 6.25%.
+ * each thread records to its own histograms without lock or atomic
+ * operation, the reader sums the histograms of all threads */
+
+#ifndef _SF_METRICS_H
+#define _SF_METRICS_H
+
+#include "fastcommon/common_define.h"
+#include "sf_define.h"
+#include "sf_types.h"
+#include "sf_trace.h"
+
+#define SF_METRICS_SUB_BUCKET_BITS   4
+#define SF_METRICS_SUB_BUCKET_COUNT  (1 << SF_METRICS_SUB_BUCKET_BITS)
+#define SF_METRICS_GROUP_COUNT       40   //the max value is about 2^43 us
+#define SF_METRICS_BUCKET_COUNT      (SF_METRICS_GROUP_COUNT * \
+        SF_METRICS_SUB_BUCKET_COUNT)
+
+#define SF_METRICS_MAX_CMDS     256
+#define SF_METRICS_MAX_STAGES   16
+#define SF_METRICS_MAX_ITEMS    (SF_METRICS_MAX_CMDS + SF_METRICS_MAX_STAGES)
+
+typedef const char *(*sf_metrics_cmd_caption_func)(const int cmd);
+
+typedef struct sf_histogram {
+    int64_t count;
+    int64_t sum;
+    int64_t max;
+    int64_t buckets[SF_METRICS_BUCKET_COUNT];
+} SFHistogram;
+
+typedef struct sf_metrics_thread_context {
+    SFHistogram *items[SF_METRICS_MAX_ITEMS];  //alloc when first record
+    struct sf_metrics_thread_context *next;
+} SFMetricsThreadContext;
+
+typedef struct sf_metrics_registry {
+    char prefix[32];   //the name prefix of prometheus metrics
+    sf_metrics_cmd_caption_func cmd_caption;
+    int stage_count;
+    char stage_names[SF_METRICS_MAX_STAGES][SF_METRICS_NAME_SIZE];
+    char dump_filename[MAX_PATH_SIZE];
+    pthread_mutex_t lock;   //for the thread context list
+    SFMetricsThreadContext *head;
+} SFMetricsRegistry;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    extern SFMetricsRegistry g_sf_metrics;
+
+    /* init the registry and add the prometheus dump schedule when
+     * metrics_dump_interval > 0, the dump file is
+     * ${base_path}/logs/${prefix}_metrics.prom */
+    int sf_metrics_init(const char *prefix,
+            sf_metrics_cmd_caption_func cmd_caption,
+            const char **stage_names, const int stage_count);
+
+    /* record the latency of the item by the current thread */
+    void sf_metrics_record(const int item, const int64_t time_used_us);
+
+#define sf_metrics_record_cmd(cmd, time_used_us) \
+    sf_metrics_record(cmd, time_used_us)
+
+#define sf_metrics_record_stage(stage, time_used_us) \
+    sf_metrics_record(SF_METRICS_MAX_CMDS + stage, time_used_us)
+
+    /* record the stage latency and the trace span of the sampled request */
+    static inline void sf_metrics_record_stage_ex(const SFTraceContext *trace,
+            const int stage, const int64_t start_time_us,
+            const int64_t time_used_us)
+    {
+        sf_metrics_record_stage(stage, time_used_us);
+        sf_trace_add_span_ex(trace, g_sf_metrics.stage_names[stage],
+                start_time_us, time_used_us);
+    }
+
+    /* sum the histograms of all threads */
+    void sf_metrics_collect(const int item, SFHistogram *histogram);
+
+    /* add a value to the histogram owned by the caller */
+    void sf_histogram_add(SFHistogram *histogram, const int64_t value);
+
+    void sf_histogram_merge(SFHistogram *dest, const SFHistogram *src);
+
+    void sf_histogram_summary(const SFHistogram *histogram,
+            SFMetricsSummary *summary);
+
+    /* get the summaries of the items with count > 0,
+     * return the item count */
+    int sf_metrics_get_items(SFMetricsItemInfo *items, const int size);
+
+    int sf_metrics_dump_prometheus(const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
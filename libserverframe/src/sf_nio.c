@@ -38,6 +38,8 @@
 #include "fastcommon/ioevent_loop.h"
 #include "sf_global.h"
 #include "sf_service.h"
+#include "sf_buffer_pool.h"
+#include "sf_proto.h"
 #include "sf_nio.h"
 
 #define SF_CTX  ((SFContext *)(task->ctx))
@@ -76,6 +78,225 @@ void sf_task_switch_thread(struct fast_task_info *task,
     task->thread_data = SF_CTX->thread_data + new_thread_index;
 }
 
+static int sf_pipeline_update_events(struct fast_task_info *task)
+{
+    int result;
+    short events;
+
+    events = 0;
+    if (task->nio_stages.current == SF_NIO_STAGE_RECV &&
+            task->pipeline.inflight < SF_CTX->pipeline.max_inflight)
+    {
+        events |= IOEVENT_READ;
+    }
+    if (task->pipeline.head != NULL) {
+        events |= IOEVENT_WRITE;
+    }
+
+    if (events == task->pipeline.events) {
+        return 0;
+    }
+
+    if (ioevent_modify(&task->thread_data->ev_puller,
+                task->event.fd, events, task) != 0)
+    {
+        result = errno != 0 ? errno : ENOENT;
+        ioevent_add_to_deleted_list(task);
+
+        logError("file: "__FILE__", line: %d, "
+                "ioevent_modify fail, "
+                "errno: %d, error info: %s",
+                __LINE__, result, strerror(result));
+        return result;
+    }
+
+    task->pipeline.events = events;
+    return 0;
+}
+
+/* the pipelined request done (response sent or discarded) */
+static void sf_pipeline_finish(struct fast_task_info *task)
+{
+    struct fast_task_info *conn;
+
+    conn = task->pipeline.parent;
+    task->pipeline.parent = NULL;
+    if (conn->pipeline.inflight-- == SF_CTX->pipeline.max_inflight &&
+            !conn->canceled)
+    {
+        sf_pipeline_update_events(conn);
+    }
+
+    sf_release_task(task);
+    sf_release_task(conn);
+}
+
+static void sf_pipeline_clear(struct fast_task_info *task)
+{
+    struct fast_task_info *current;
+    struct fast_task_info *deleted;
+
+    current = task->pipeline.head;
+    task->pipeline.head = task->pipeline.tail = NULL;
+    while (current != NULL) {
+        deleted = current;
+        current = current->pipeline.next;
+        if (deleted != task) {
+            sf_pipeline_finish(deleted);
+        }
+    }
+    task->pipeline.events = 0;
+}
+
+/* send the responses in the queue, return -1 when fatal error */
+static int sf_pipeline_send(struct fast_task_info *task)
+{
+    struct fast_task_info *current;
+    int bytes;
+
+    while ((current=task->pipeline.head) != NULL) {
+        bytes = write(task->event.fd, current->data + current->offset,
+                current->length - current->offset);
+        if (bytes < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            } else if (errno == EINTR) {  //should retry
+                continue;
+            } else {
+                logWarning("file: "__FILE__", line: %d, "
+                        "client ip: %s, send fail, "
+                        "errno: %d, error info: %s",
+                        __LINE__, task->client_ip,
+                        errno, strerror(errno));
+
+                ioevent_add_to_deleted_list(task);
+                return -1;
+            }
+        } else if (bytes == 0) {
+            logWarning("file: "__FILE__", line: %d, "
+                    "client ip: %s, sock: %d, send failed, "
+                    "connection disconnected",
+                    __LINE__, task->client_ip, task->event.fd);
+
+            ioevent_add_to_deleted_list(task);
+            return -1;
+        }
+
+        fast_timer_modify(&task->thread_data->timer,
+                &task->event.timer, g_current_time +
+                task->network_timeout);
+        current->offset += bytes;
+        if (current->offset < current->length) {
+            continue;
+        }
+
+        task->pipeline.head = current->pipeline.next;
+        if (task->pipeline.head == NULL) {
+            task->pipeline.tail = NULL;
+        }
+        if (current == task) {  //the response of the connection itself
+            task->offset = task->length = 0;
+            task->nio_stages.current = SF_NIO_STAGE_RECV;
+            sf_task_return_buffer(task);
+        } else {
+            sf_pipeline_finish(current);
+        }
+    }
+
+    return sf_pipeline_update_events(task) == 0 ? 0 : -1;
+}
+
+/* push the response to the queue of the connection */
+static int sf_pipeline_push_response(struct fast_task_info *conn,
+        struct fast_task_info *task)
+{
+    task->offset = 0;
+    task->pipeline.next = NULL;
+    if (conn->pipeline.tail == NULL) {
+        conn->pipeline.head = task;
+    } else {
+        conn->pipeline.tail->pipeline.next = task;
+    }
+    conn->pipeline.tail = task;
+    return sf_pipeline_send(conn);
+}
+
+static int sf_pipeline_deliver(struct fast_task_info *task)
+{
+    struct fast_task_info *conn;
+
+    conn = task->pipeline.parent;
+    if (conn->canceled || task->length == 0) {
+        sf_pipeline_finish(task);
+        return 0;
+    }
+
+    SF_PROTO_SET_TAG((SFCommonProtoHeader *)task->data, task->pipeline.tag);
+    sf_pipeline_push_response(conn, task);
+    return 0;
+}
+
+/* deal the received request with the trace context of the request,
+ * so the requests sent by this thread during dealing carry the same trace */
+static inline int sf_deal_request(struct fast_task_info *task)
+{
+    SFTraceContext trace;
+    int result;
+
+    if ((result=sf_proto_extract_trace(task, &trace)) != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "client ip: %s, the trace extension is incomplete, "
+                "request length: %d", __LINE__, task->client_ip,
+                task->length);
+        return -result;
+    }
+
+    sf_trace_set_current(&trace);
+    result = SF_CTX->deal_task(task, SF_NIO_STAGE_SEND);
+    sf_trace_clear_current();
+    return result;
+}
+
+/* deal the request by a pipeline task, and the connection goes on,
+ * return EAGAIN when the pipeline task pool is used up */
+static int sf_pipeline_dispatch(struct fast_task_info *task)
+{
+    struct fast_task_info *ptask;
+    int result;
+
+    if ((ptask=sf_pipeline_alloc_task(SF_CTX)) == NULL) {
+        return EAGAIN;
+    }
+
+    if ((result=sf_task_reserve_buffer(ptask, task->length)) != 0) {
+        sf_release_task(ptask);
+        return result;
+    }
+    memcpy(ptask->data, task->data, task->length);
+    ptask->length = task->length;
+    ptask->offset = task->offset;
+    ptask->thread_data = task->thread_data;
+    strcpy(ptask->client_ip, task->client_ip);
+    ptask->port = task->port;
+    ptask->network_timeout = task->network_timeout;
+    ptask->req_count = task->req_count;
+    ptask->nio_stages.current = SF_NIO_STAGE_SEND;
+    ptask->pipeline.tag = SF_PROTO_GET_TAG((SFCommonProtoHeader *)task->data);
+    ptask->pipeline.parent = task;
+    sf_hold_task(task);
+    task->pipeline.inflight++;
+
+    task->offset = task->length = 0;
+    sf_task_return_buffer(task);
+
+    sf_hold_task(ptask);
+    if (sf_deal_request(ptask) < 0) {
+        ioevent_add_to_deleted_list(ptask);
+    }
+    sf_release_task(ptask);
+    return 0;
+}
+
 void sf_task_finish_clean_up(struct fast_task_info *task)
 {
     /*
@@ -93,6 +314,18 @@ void sf_task_finish_clean_up(struct fast_task_info *task)
         task->finish_callback = NULL;
     }
 
+    if (task->pipeline.parent != NULL) {
+        //close the connection as the fatal error of the request
+        if (!task->pipeline.parent->canceled) {
+            ioevent_add_to_deleted_list(task->pipeline.parent);
+        }
+        sf_pipeline_finish(task);
+        return;
+    }
+    if (task->pipeline.head != NULL) {
+        sf_pipeline_clear(task);
+    }
+
     sf_task_detach_thread(task);
     close(task->event.fd);
     task->event.fd = -1;
@@ -130,6 +363,16 @@ int sf_set_read_event(struct fast_task_info *task)
     int result;
 
     task->nio_stages.current = SF_NIO_STAGE_RECV;
+    if (task->borrowed.buffer != NULL && sf_nio_task_is_idle(task)) {
+        sf_task_return_buffer(task);
+    }
+    if (task->pipeline.parent != NULL) {  //without response
+        sf_pipeline_finish(task);
+        return 0;
+    }
+    if (SF_CTX->pipeline.enabled) {
+        return sf_pipeline_update_events(task);
+    }
     if (task->event.callback == (IOEventCallback)sf_client_sock_read) {
         return 0;
     }
@@ -171,6 +414,7 @@ static inline int sf_nio_init(struct fast_task_info *task)
         g_sf_global_vars.connection_stat.max_count = current_connections;
     }
 
+    task->pipeline.events = IOEVENT_READ;
     return sf_ioevent_add(task, (IOEventCallback)sf_client_sock_read,
             task->network_timeout);
 }
@@ -249,7 +493,11 @@ static int sf_nio_deal_task(struct fast_task_info *task)
 {
     int result;
     int stage;
+    struct fast_task_info *conn;
 
+    if ((conn=task->pipeline.parent) != NULL) {
+        sf_hold_task(task);
+    }
     stage = __sync_add_and_fetch(&task->nio_stages.notify, 0);
     switch (stage) {
         case SF_NIO_STAGE_INIT:
@@ -277,7 +525,7 @@ static int sf_nio_deal_task(struct fast_task_info *task)
                             sf_client_sock_read,
                             task->network_timeout)) == 0)
             {
-                result = SF_CTX->deal_task(task, SF_NIO_STAGE_SEND);
+                result = sf_deal_request(task);
             }
             break;
         case SF_NIO_STAGE_CLOSE:
@@ -297,6 +545,9 @@ static int sf_nio_deal_task(struct fast_task_info *task)
 
     __sync_bool_compare_and_swap(&task->nio_stages.notify,
             stage, SF_NIO_STAGE_NONE);
+    if (conn != NULL) {
+        sf_release_task(task);
+    }
     return result;
 }
 
@@ -305,7 +556,7 @@ int sf_nio_notify(struct fast_task_info *task, const int stage)
     int64_t n;
     int result;
     int old_stage;
-    bool notify;
+    struct fast_task_info *head;
 
     if (__sync_add_and_fetch(&task->canceled, 0)) {
         if (stage == SF_NIO_STAGE_CONTINUE) {
@@ -339,20 +590,15 @@ int sf_nio_notify(struct fast_task_info *task, const int stage)
         }
     }
 
-    PTHREAD_MUTEX_LOCK(&task->thread_data->waiting_queue.lock);
-    task->next = NULL;
-
-    if (task->thread_data->waiting_queue.tail == NULL) {
-        task->thread_data->waiting_queue.head = task;
-        notify = true;
-    } else {
-        task->thread_data->waiting_queue.tail->next = task;
-        notify = false;
-    }
-    task->thread_data->waiting_queue.tail = task;
-    PTHREAD_MUTEX_UNLOCK(&task->thread_data->waiting_queue.lock);
-
-    if (notify) {
+    /* only the pusher which makes the queue non-empty wakes up the
+     * nio thread, so the notifications in a burst share one wakeup */
+    __sync_add_and_fetch(&task->thread_data->notify_stat.notifies, 1);
+    do {
+        head = task->thread_data->waiting_queue.head;
+        task->next = head;
+    } while (!__sync_bool_compare_and_swap(&task->thread_data->
+                waiting_queue.head, head, task));
+    if (head == NULL) {
         n = 1;
         if (write(FC_NOTIFY_WRITE_FD(task->thread_data),
                     &n, sizeof(n)) != sizeof(n))
@@ -376,6 +622,7 @@ void sf_recv_notify_read(int sock, short event, void *arg)
     struct nio_thread_data *thread_data;
     struct fast_task_info *task;
     struct fast_task_info *current;
+    struct fast_task_info *head;
 
     thread_data = ((struct ioevent_notify_entry *)arg)->thread_data;
     if (read(sock, &n, sizeof(n)) < 0) {
@@ -384,10 +631,20 @@ void sf_recv_notify_read(int sock, short event, void *arg)
                 __LINE__, sock, errno, STRERROR(errno));
     }
 
-    PTHREAD_MUTEX_LOCK(&thread_data->waiting_queue.lock);
-    current = thread_data->waiting_queue.head;
-    thread_data->waiting_queue.head = thread_data->waiting_queue.tail = NULL;
-    PTHREAD_MUTEX_UNLOCK(&thread_data->waiting_queue.lock);
+    thread_data->notify_stat.wakeups++;
+
+    /* must take the tasks after reading the eventfd, otherwise the
+     * notification of the task pushed between them would be lost */
+    head = __sync_lock_test_and_set(&thread_data->waiting_queue.head, NULL);
+
+    //reverse the stack to deal the tasks in the notified order
+    current = NULL;
+    while (head != NULL) {
+        task = head;
+        head = head->next;
+        task->next = current;
+        current = task;
+    }
 
     while (current != NULL) {
         task = current;
@@ -412,6 +669,19 @@ void sf_recv_notify_read(int sock, short event, void *arg)
 
 int sf_send_add_event(struct fast_task_info *task)
 {
+    if (task->pipeline.parent != NULL) {
+        return sf_pipeline_deliver(task);
+    }
+    if (SF_CTX->pipeline.enabled) {
+        if (task->length > 0 && !task->canceled) {
+            task->nio_stages.current = SF_NIO_STAGE_SEND;
+            if (sf_pipeline_push_response(task, task) != 0) {
+                return EIO;
+            }
+        }
+        return 0;
+    }
+
     task->offset = 0;
     if (task->length > 0) {
         /* direct send */
@@ -453,6 +723,21 @@ int sf_client_sock_read(int sock, short event, void *arg)
     struct fast_task_info *task;
 
     task = (struct fast_task_info *)arg;
+    if ((event & IOEVENT_WRITE) && SF_CTX->pipeline.enabled) {
+        //send the pipelined responses
+        if ((result=check_task(task, event, task->
+                        nio_stages.current)) != 0)
+        {
+            return result >= 0 ? 0 : -1;
+        }
+        if (sf_pipeline_send(task) != 0) {
+            return -1;
+        }
+        if ((event & IOEVENT_READ) == 0) {
+            return 0;
+        }
+    }
+
     if ((result=check_task(task, event, SF_NIO_STAGE_RECV)) != 0) {
         return result >= 0 ? 0 : -1;
     }
@@ -596,9 +881,9 @@ int sf_client_sock_read(int sock, short event, void *arg)
                 }
 
                 old_size = task->size;
-                if (free_queue_realloc_buffer(task, task->length) != 0) {
+                if (sf_task_reserve_buffer(task, task->length) != 0) {
                     logError("file: "__FILE__", line: %d, "
-                            "client ip: %s, realloc buffer size "
+                            "client ip: %s, borrow buffer size "
                             "from %d to %d fail", __LINE__,
                             task->client_ip, task->size, task->length);
 
@@ -607,7 +892,7 @@ int sf_client_sock_read(int sock, short event, void *arg)
                 }
 
                 logDebug("file: "__FILE__", line: %d, "
-                        "client ip: %s, task length: %d, realloc buffer size "
+                        "client ip: %s, task length: %d, borrow buffer size "
                         "from %d to %d", __LINE__, task->client_ip,
                         task->length, old_size, task->size);
             }
@@ -615,8 +900,43 @@ int sf_client_sock_read(int sock, short event, void *arg)
 
         if (task->offset >= task->length) { //recv done
             task->req_count++;
+            if (SF_CTX->pipeline.enabled) {
+                if (SF_CTX->pipeline.cmds[((SFCommonProtoHeader *)
+                            task->data)->cmd] && (result=
+                            sf_pipeline_dispatch(task)) != EAGAIN)
+                {
+                    if (result != 0) {
+                        logError("file: "__FILE__", line: %d, "
+                                "client ip: %s, dispatch to pipeline task "
+                                "fail, errno: %d, error info: %s", __LINE__,
+                                task->client_ip, result, strerror(result));
+                        ioevent_add_to_deleted_list(task);
+                        return -1;
+                    }
+                    if (task->canceled) {
+                        return -1;
+                    }
+                    if (task->pipeline.inflight < SF_CTX->
+                            pipeline.max_inflight)
+                    {
+                        continue;
+                    }
+                    if (sf_pipeline_update_events(task) != 0) {
+                        return -1;
+                    }
+                    break;
+                }
+
+                /* stop receiving until the response sent, also as the
+                 * backpressure when the pipeline task pool used up */
+                task->nio_stages.current = SF_NIO_STAGE_SEND;
+                if (sf_pipeline_update_events(task) != 0) {
+                    return -1;
+                }
+            }
+
             task->nio_stages.current = SF_NIO_STAGE_SEND;
-            if (SF_CTX->deal_task(task, SF_NIO_STAGE_SEND) < 0) {  //fatal error
+            if (sf_deal_request(task) < 0) {  //fatal error
                 ioevent_add_to_deleted_list(task);
                 return -1;
             }
@@ -67,6 +67,60 @@ static inline TaskCleanUpCallback sf_get_task_cleanup_func_ex(
 #define sf_get_task_cleanup_func() \
     sf_get_task_cleanup_func_ex(&g_sf_context)
 
+/* the request of the cmd is dealt by a pipeline task (allocated from the
+ * pipeline task pool) while the connection goes on receiving the next
+ * requests, and the responses are sent in completion order with the
+ * request tag. when the pool is used up, the request is dealt by the
+ * connection itself which stops receiving until the response sent.
+ * the cmd handler MUST NOT depend on the connection state (such as the
+ * idempotency channel), and the proto header MUST be SFCommonProtoHeader */
+static inline int sf_enable_pipeline_cmd_ex(SFContext *sf_context,
+        const unsigned char cmd)
+{
+    int result;
+
+    if (!sf_context->pipeline.enabled) {
+        if ((result=task_queue_init(&sf_context->
+                        pipeline.free_tasks)) != 0)
+        {
+            return result;
+        }
+    }
+
+    if (sf_context->pipeline.max_inflight <= 0) {
+        sf_context->pipeline.max_inflight = SF_DEF_PIPELINE_MAX_INFLIGHT;
+    }
+    if (sf_context->pipeline.max_tasks <= 0) {
+        sf_context->pipeline.max_tasks = SF_DEF_PIPELINE_MAX_TASKS;
+    }
+    sf_context->pipeline.cmds[cmd] = true;
+    sf_context->pipeline.enabled = true;
+    return 0;
+}
+
+#define sf_enable_pipeline_cmd(cmd) \
+    sf_enable_pipeline_cmd_ex(&g_sf_context, cmd)
+
+static inline void sf_set_pipeline_max_inflight_ex(SFContext *sf_context,
+        const int max_inflight)
+{
+    sf_context->pipeline.max_inflight = max_inflight;
+}
+
+#define sf_set_pipeline_max_inflight(max_inflight) \
+    sf_set_pipeline_max_inflight_ex(&g_sf_context, max_inflight)
+
+/* the pipeline tasks are taken from the free queue on demand and kept in
+ * the pool after used, so the connections take max_tasks at most */
+static inline void sf_set_pipeline_max_tasks_ex(SFContext *sf_context,
+        const int max_tasks)
+{
+    sf_context->pipeline.max_tasks = max_tasks;
+}
+
+#define sf_set_pipeline_max_tasks(max_tasks) \
+    sf_set_pipeline_max_tasks_ex(&g_sf_context, max_tasks)
+
 #define sf_nio_task_is_idle(task) \
     (task->offset == 0 && task->length == 0)
 
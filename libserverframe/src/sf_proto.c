@@ -16,7 +16,9 @@
 
 #include <errno.h>
 #include "fastcommon/shared_func.h"
+#include "fastcommon/fc_memory.h"
 #include "sf_util.h"
+#include "sf_metrics.h"
 #include "sf_proto.h"
 
 int sf_proto_set_body_length(struct fast_task_info *task)
@@ -24,7 +26,9 @@ int sf_proto_set_body_length(struct fast_task_info *task)
     SFCommonProtoHeader *header;
 
     header = (SFCommonProtoHeader *)task->data;
-    if (!SF_PROTO_CHECK_MAGIC(header->magic)) {
+    if (!(SF_PROTO_CHECK_MAGIC(header->magic) ||
+                SF_PROTO_CHECK_TRACED_MAGIC(header->magic)))
+    {
         logError("file: "__FILE__", line: %d, "
                 "peer %s:%u, magic "SF_PROTO_MAGIC_FORMAT
                 " is invalid, expect: "SF_PROTO_MAGIC_FORMAT,
@@ -85,13 +89,48 @@ int sf_check_response(ConnectionInfo *conn, SFResponseInfo *response,
     return response->header.status;
 }
 
+int sf_proto_send_request(ConnectionInfo *conn, char *data,
+        const int len, const int network_timeout)
+{
+    SFCommonProtoHeader *header;
+    SFProtoTraceExt ext;
+    int body_len;
+    int result;
+
+    if (!SF_TRACE_SAMPLED(&g_sf_trace_current)) {
+        return tcpsenddata_nb(conn->sock, data, len, network_timeout);
+    }
+
+    header = (SFCommonProtoHeader *)data;
+    body_len = buff2int(header->body_len);
+    SF_PROTO_SET_TRACED_MAGIC(header->magic);
+    int2buff(body_len + sizeof(SFProtoTraceExt), header->body_len);
+    sf_proto_set_trace_ext(&ext, &g_sf_trace_current);
+    if ((result=tcpsenddata_nb(conn->sock, data, sizeof(
+                        SFCommonProtoHeader), network_timeout)) == 0 &&
+            (result=tcpsenddata_nb(conn->sock, &ext, sizeof(ext),
+                                   network_timeout)) == 0)
+    {
+        result = tcpsenddata_nb(conn->sock, data + sizeof(
+                    SFCommonProtoHeader), len - sizeof(
+                        SFCommonProtoHeader), network_timeout);
+    }
+
+    //restore the header for resending
+    SF_PROTO_SET_MAGIC(header->magic);
+    int2buff(body_len, header->body_len);
+    return result;
+}
+
 int sf_send_and_recv_response_header(ConnectionInfo *conn, char *data,
         const int len, SFResponseInfo *response, const int network_timeout)
 {
     int result;
     SFCommonProtoHeader header_proto;
 
-    if ((result=tcpsenddata_nb(conn->sock, data, len, network_timeout)) != 0) {
+    if ((result=sf_proto_send_request(conn, data,
+                    len, network_timeout)) != 0)
+    {
         response->error.length = snprintf(response->error.message,
                 sizeof(response->error.message),
                 "send data fail, errno: %d, error info: %s",
@@ -296,6 +335,10 @@ const char *sf_get_cmd_caption(const int cmd)
             return "REPORT_REQ_RECEIPT_REQ";
         case SF_SERVICE_PROTO_REPORT_REQ_RECEIPT_RESP:
             return "REPORT_REQ_RECEIPT_RESP";
+        case SF_SERVICE_PROTO_GET_METRICS_REQ:
+            return "GET_METRICS_REQ";
+        case SF_SERVICE_PROTO_GET_METRICS_RESP:
+            return "GET_METRICS_RESP";
         default:
             return "UNKOWN";
     }
@@ -338,6 +381,127 @@ int sf_proto_deal_ack(struct fast_task_info *task,
     return 0;
 }
 
+int sf_proto_deal_get_metrics(struct fast_task_info *task,
+        SFRequestInfo *request, SFResponseInfo *response)
+{
+    SFMetricsItemInfo *items;
+    SFMetricsItemInfo *info;
+    SFMetricsItemInfo *end;
+    SFProtoGetMetricsRespHeader *body_header;
+    SFProtoGetMetricsRespBodyPart *body_part;
+    int size;
+    int count;
+    int result;
+
+    if ((result=sf_server_expect_body_length(response,
+                    request->header.body_len, 0)) != 0)
+    {
+        return result;
+    }
+
+    size = (task->size - sizeof(SFCommonProtoHeader) -
+            sizeof(SFProtoGetMetricsRespHeader)) /
+        sizeof(SFProtoGetMetricsRespBodyPart);
+    if (size > SF_METRICS_MAX_ITEMS) {
+        size = SF_METRICS_MAX_ITEMS;
+    }
+    if ((items=(SFMetricsItemInfo *)fc_malloc(sizeof(
+                        SFMetricsItemInfo) * size)) == NULL)
+    {
+        return ENOMEM;
+    }
+    count = sf_metrics_get_items(items, size);
+
+    body_header = (SFProtoGetMetricsRespHeader *)
+        (task->data + sizeof(SFCommonProtoHeader));
+    body_part = (SFProtoGetMetricsRespBodyPart *)(body_header + 1);
+    int2buff(count, body_header->count);
+    end = items + count;
+    for (info=items; info<end; info++, body_part++) {
+        memset(body_part, 0, sizeof(*body_part));
+        body_part->type = info->type;
+        long2buff(info->summary.count, body_part->count);
+        long2buff(info->summary.sum, body_part->sum);
+        long2buff(info->summary.max, body_part->max);
+        long2buff(info->summary.p50, body_part->p50);
+        long2buff(info->summary.p99, body_part->p99);
+        long2buff(info->summary.p999, body_part->p999);
+        memcpy(body_part->name, info->name, SF_METRICS_NAME_SIZE);
+    }
+    free(items);
+
+    response->header.cmd = SF_SERVICE_PROTO_GET_METRICS_RESP;
+    response->header.body_len = sizeof(SFProtoGetMetricsRespHeader) +
+        sizeof(SFProtoGetMetricsRespBodyPart) * count;
+    return 0;
+}
+
+int sf_proto_get_metrics(ConnectionInfo *conn, const int network_timeout,
+        SFMetricsItemInfo *items, const int size, int *count)
+{
+    SFCommonProtoHeader header;
+    SFProtoGetMetricsRespHeader *body_header;
+    SFProtoGetMetricsRespBodyPart *body_part;
+    SFMetricsItemInfo *info;
+    SFMetricsItemInfo *end;
+    SFResponseInfo response;
+    char *in_buff;
+    int buff_size;
+    int body_len;
+    int result;
+
+    buff_size = sizeof(SFProtoGetMetricsRespHeader) +
+        sizeof(SFProtoGetMetricsRespBodyPart) * SF_METRICS_MAX_ITEMS;
+    if ((in_buff=(char *)fc_malloc(buff_size)) == NULL) {
+        return ENOMEM;
+    }
+
+    SF_PROTO_SET_HEADER(&header, SF_SERVICE_PROTO_GET_METRICS_REQ, 0);
+    response.error.length = 0;
+    if ((result=sf_send_and_recv_response_ex1(conn, (char *)&header,
+                    sizeof(header), &response, network_timeout,
+                    SF_SERVICE_PROTO_GET_METRICS_RESP, in_buff,
+                    buff_size, &body_len)) == 0)
+    {
+        body_header = (SFProtoGetMetricsRespHeader *)in_buff;
+        *count = buff2int(body_header->count);
+        if (body_len != sizeof(SFProtoGetMetricsRespHeader) +
+                sizeof(SFProtoGetMetricsRespBodyPart) * (*count))
+        {
+            response.error.length = sprintf(response.error.message,
+                    "response body length: %d is invalid, item count: %d",
+                    body_len, *count);
+            result = EINVAL;
+        }
+    }
+
+    if (result != 0) {
+        sf_log_network_error(&response, conn, result);
+        free(in_buff);
+        return result;
+    }
+
+    if (*count > size) {
+        *count = size;
+    }
+    body_part = (SFProtoGetMetricsRespBodyPart *)(body_header + 1);
+    end = items + (*count);
+    for (info=items; info<end; info++, body_part++) {
+        info->type = body_part->type;
+        info->summary.count = buff2long(body_part->count);
+        info->summary.sum = buff2long(body_part->sum);
+        info->summary.max = buff2long(body_part->max);
+        info->summary.p50 = buff2long(body_part->p50);
+        info->summary.p99 = buff2long(body_part->p99);
+        info->summary.p999 = buff2long(body_part->p999);
+        memcpy(info->name, body_part->name, SF_METRICS_NAME_SIZE);
+        info->name[SF_METRICS_NAME_SIZE - 1] = '\0';
+    }
+
+    free(in_buff);
+    return 0;
+}
+
 int sf_proto_rebind_idempotency_channel(ConnectionInfo *conn,
         const uint32_t channel_id, const int key, const int network_timeout)
 {
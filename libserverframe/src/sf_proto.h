@@ -26,6 +26,7 @@
 #include "sf_define.h"
 #include "sf_types.h"
 #include "sf_util.h"
+#include "sf_trace.h"
 
 #define SF_PROTO_ACK                    116
 
@@ -42,6 +43,10 @@
 #define SF_SERVICE_PROTO_REPORT_REQ_RECEIPT_REQ   125
 #define SF_SERVICE_PROTO_REPORT_REQ_RECEIPT_RESP  126
 
+//for latency metrics
+#define SF_SERVICE_PROTO_GET_METRICS_REQ          127
+#define SF_SERVICE_PROTO_GET_METRICS_RESP         128
+
 #define SF_PROTO_MAGIC_CHAR        '@'
 #define SF_PROTO_SET_MAGIC(m)   \
     m[0] = m[1] = m[2] = m[3] = SF_PROTO_MAGIC_CHAR
@@ -50,6 +55,21 @@
     (m[0] == SF_PROTO_MAGIC_CHAR && m[1] == SF_PROTO_MAGIC_CHAR && \
      m[2] == SF_PROTO_MAGIC_CHAR && m[3] == SF_PROTO_MAGIC_CHAR)
 
+/* the magic of the request followed by the trace extension (SFProtoTraceExt)
+ * which is counted in the body length. only the sampled requests are sent
+ * with this magic, so the peers which don't know it (the versions before
+ * the request tracing) reject the sampled requests only */
+#define SF_PROTO_TRACED_MAGIC_CHAR  'T'
+#define SF_PROTO_SET_TRACED_MAGIC(m)   \
+    do {  \
+        m[0] = m[1] = m[2] = SF_PROTO_MAGIC_CHAR; \
+        m[3] = SF_PROTO_TRACED_MAGIC_CHAR;  \
+    } while (0)
+
+#define SF_PROTO_CHECK_TRACED_MAGIC(m) \
+    (m[0] == SF_PROTO_MAGIC_CHAR && m[1] == SF_PROTO_MAGIC_CHAR && \
+     m[2] == SF_PROTO_MAGIC_CHAR && m[3] == SF_PROTO_TRACED_MAGIC_CHAR)
+
 #define SF_PROTO_MAGIC_FORMAT "0x%02X%02X%02X%02X"
 #define SF_PROTO_MAGIC_EXPECT_PARAMS \
     SF_PROTO_MAGIC_CHAR, SF_PROTO_MAGIC_CHAR, \
@@ -72,6 +92,21 @@
         short2buff(_flags, (header)->flags); \
     } while (0)
 
+#define SF_PROTO_SET_TAG(header, _tag) short2buff(_tag, (header)->tag)
+#define SF_PROTO_GET_TAG(header) ((uint16_t)buff2short((header)->tag))
+
+#define SF_PROTO_SET_TRACE(header, trace) \
+    do {  \
+        (header)->trace_flags = (trace)->flags;  \
+        long2buff((trace)->trace_id, (header)->trace_id); \
+    } while (0)
+
+#define SF_PROTO_GET_TRACE(header, trace) \
+    do {  \
+        (trace)->flags = (header)->trace_flags;  \
+        (trace)->trace_id = buff2long((header)->trace_id); \
+    } while (0)
+
 #define SF_PROTO_SET_RESPONSE_HEADER(proto_header, resp_header) \
     do {  \
         (proto_header)->cmd = (resp_header).cmd;       \
@@ -86,9 +121,16 @@ typedef struct sf_common_proto_header {
     char status[2];         //status to store errno
     char flags[2];
     unsigned char cmd;      //the command code
-    char padding[3];
+    char padding;
+    char tag[2];            //the request tag echoed by the response
 } SFCommonProtoHeader;
 
+typedef struct sf_proto_trace_ext {
+    char trace_id[8];
+    char trace_flags;       //SF_TRACE_FLAG_xxx
+    char padding[7];
+} SFProtoTraceExt;
+
 typedef struct sf_proto_idempotency_additional_header {
     char req_id[8];
 } SFProtoIdempotencyAdditionalHeader;
@@ -119,6 +161,23 @@ typedef struct sf_proto_report_req_receipt_body {
     char req_id[8];
 } SFProtoReportReqReceiptBody;
 
+typedef struct sf_proto_get_metrics_resp_header {
+    char count[4];
+    char padding[4];
+} SFProtoGetMetricsRespHeader;
+
+typedef struct sf_proto_get_metrics_resp_body_part {
+    char type;       //SF_METRICS_TYPE_CMD or SF_METRICS_TYPE_STAGE
+    char padding[7];
+    char count[8];
+    char sum[8];     //in microseconds
+    char max[8];
+    char p50[8];
+    char p99[8];
+    char p999[8];
+    char name[SF_METRICS_NAME_SIZE];
+} SFProtoGetMetricsRespBodyPart;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -229,6 +288,72 @@ int sf_recv_response(ConnectionInfo *conn, SFResponseInfo *response,
         const int network_timeout, const unsigned char expect_cmd,
         char *recv_data, const int expect_body_len);
 
+static inline void sf_proto_set_trace_ext(SFProtoTraceExt *ext,
+        const SFTraceContext *trace)
+{
+    SF_PROTO_SET_TRACE(ext, trace);
+    memset(ext->padding, 0, sizeof(ext->padding));
+}
+
+/* insert the trace extension after the header of the request in the buffer,
+ * return ENOSPC when the buffer has not enough space */
+static inline int sf_proto_insert_trace_ext(char *data, int *length,
+        const int size, const SFTraceContext *trace)
+{
+    SFCommonProtoHeader *header;
+    SFProtoTraceExt *ext;
+
+    if (*length + (int)sizeof(SFProtoTraceExt) > size) {
+        return ENOSPC;
+    }
+
+    header = (SFCommonProtoHeader *)data;
+    ext = (SFProtoTraceExt *)(header + 1);
+    memmove(ext + 1, ext, *length - sizeof(SFCommonProtoHeader));
+    sf_proto_set_trace_ext(ext, trace);
+    SF_PROTO_SET_TRACED_MAGIC(header->magic);
+    int2buff(buff2int(header->body_len) + sizeof(SFProtoTraceExt),
+            header->body_len);
+    *length += sizeof(SFProtoTraceExt);
+    return 0;
+}
+
+/* take the trace extension out of the received request, so the body
+ * follows the header as usual. return error no, 0 for success */
+static inline int sf_proto_extract_trace(struct fast_task_info *task,
+        SFTraceContext *trace)
+{
+    SFCommonProtoHeader *header;
+    SFProtoTraceExt *ext;
+    int body_len;
+
+    header = (SFCommonProtoHeader *)task->data;
+    if (!SF_PROTO_CHECK_TRACED_MAGIC(header->magic)) {
+        trace->trace_id = 0;
+        trace->flags = 0;
+        return 0;
+    }
+
+    body_len = task->length - (int)(sizeof(SFCommonProtoHeader) +
+            sizeof(SFProtoTraceExt));
+    if (body_len < 0) {
+        return EINVAL;
+    }
+
+    ext = (SFProtoTraceExt *)(header + 1);
+    SF_PROTO_GET_TRACE(ext, trace);
+    memmove(ext, ext + 1, body_len);
+    SF_PROTO_SET_MAGIC(header->magic);
+    int2buff(body_len, header->body_len);
+    task->length -= sizeof(SFProtoTraceExt);
+    return 0;
+}
+
+/* send the request with the trace extension when the trace of
+ * the current thread is sampled */
+int sf_proto_send_request(ConnectionInfo *conn, char *data,
+        const int len, const int network_timeout);
+
 int sf_send_and_recv_response_header(ConnectionInfo *conn, char *data,
         const int len, SFResponseInfo *response, const int network_timeout);
 
@@ -317,6 +442,15 @@ static inline int sf_proto_deal_active_test(struct fast_task_info *task,
 int sf_proto_deal_ack(struct fast_task_info *task,
         SFRequestInfo *request, SFResponseInfo *response);
 
+/* the response body is written to the task buffer,
+ * the caller should set response_done to true */
+int sf_proto_deal_get_metrics(struct fast_task_info *task,
+        SFRequestInfo *request, SFResponseInfo *response);
+
+/* get the latency summaries by command and stage from the server */
+int sf_proto_get_metrics(ConnectionInfo *conn, const int network_timeout,
+        SFMetricsItemInfo *items, const int size, int *count);
+
 int sf_proto_rebind_idempotency_channel(ConnectionInfo *conn,
         const uint32_t channel_id, const int key, const int network_timeout);
 
@@ -35,6 +35,8 @@
 #include "sf_nio.h"
 #include "sf_util.h"
 #include "sf_global.h"
+#include "sf_buffer_pool.h"
+#include "sf_trace.h"
 #include "sf_service.h"
 
 #if defined(OS_LINUX)
@@ -70,6 +72,44 @@ int sf_init_task(struct fast_task_info *task)
     return 0;
 }
 
+struct fast_task_info *sf_pipeline_alloc_task(SFContext *sf_context)
+{
+    struct fast_task_info *task;
+
+    if ((task=task_queue_pop(&sf_context->pipeline.free_tasks)) == NULL) {
+        if (__sync_add_and_fetch(&sf_context->pipeline.task_count, 1) >
+                sf_context->pipeline.max_tasks)
+        {
+            __sync_sub_and_fetch(&sf_context->pipeline.task_count, 1);
+            return NULL;
+        }
+
+        if ((task=free_queue_pop()) == NULL) {
+            __sync_sub_and_fetch(&sf_context->pipeline.task_count, 1);
+            return NULL;
+        }
+        task->pipeline.pooled = true;
+    }
+
+    __sync_add_and_fetch(&task->reffer_count, 1);
+    __sync_bool_compare_and_swap(&task->canceled, 1, 0);
+    task->ctx = sf_context;
+    task->event.fd = -1;
+    return task;
+}
+
+void sf_pipeline_free_task(struct fast_task_info *task)
+{
+    *(task->client_ip) = '\0';
+    task->length = 0;
+    task->offset = 0;
+    task->req_count = 0;
+    if (task->size > g_sf_global_vars.min_buff_size) {  //need shrink
+        free_queue_set_buffer_size(task, g_sf_global_vars.min_buff_size);
+    }
+    task_queue_push(&((SFContext *)task->ctx)->pipeline.free_tasks, task);
+}
+
 static void *worker_thread_entrance(void *arg);
 
 static int sf_init_free_queues(const int task_arg_size,
@@ -112,7 +152,21 @@ static int sf_init_free_queues(const int task_arg_size,
         return result;
     }
 
-    return 0;
+    if (g_sf_global_vars.min_buff_size < g_sf_global_vars.max_buff_size) {
+        if ((result=sf_buffer_pool_init(&g_sf_buffer_pool, 2 *
+                        g_sf_global_vars.min_buff_size,
+                        g_sf_global_vars.max_buff_size)) != 0)
+        {
+            return result;
+        }
+        if ((result=sf_buffer_pool_add_reclaim_schedule(
+                        &g_sf_buffer_pool)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return sf_trace_init(g_sf_global_vars.trace_span_count);
 }
 
 int sf_service_init_ex2(SFContext *sf_context,
@@ -201,9 +255,6 @@ int sf_service_init_ex2(SFContext *sf_context,
             return result;
         }
 
-        if ((result=init_pthread_lock(&thread_data->waiting_queue.lock)) != 0) {
-            return result;
-        }
 #if defined(OS_LINUX)
         FC_NOTIFY_READ_FD(thread_data) = eventfd(0, EFD_NONBLOCK);
         if (FC_NOTIFY_READ_FD(thread_data) < 0) {
@@ -254,6 +305,7 @@ int sf_service_destroy_ex(SFContext *sf_context)
     struct nio_thread_data *data_end, *thread_data;
 
     free_queue_destroy();
+    sf_buffer_pool_destroy(&g_sf_buffer_pool);
     data_end = sf_context->thread_data + sf_context->work_threads;
     for (thread_data=sf_context->thread_data; thread_data<data_end;
             thread_data++)
@@ -503,6 +555,23 @@ void sf_accept_loop_ex(SFContext *sf_context, const bool block)
 }
 
 #if defined(DEBUG_FLAG)
+static void sf_dump_notify_stat_to_file(const char *filename)
+{
+    FILE *fp;
+    int64_t notifies;
+    int64_t wakeups;
+
+    if ((fp=fopen(filename, "a")) == NULL) {
+        return;
+    }
+
+    sf_get_notify_stat(&notifies, &wakeups);
+    fprintf(fp, "\n[nio notify] notifies: %"PRId64", wakeups: %"PRId64
+            ", notifies per wakeup: %.2f\n", notifies, wakeups,
+            wakeups > 0 ? (double)notifies / wakeups : 0.00);
+    fclose(fp);
+}
+
 static void sigDumpHandler(int sig)
 {
     static bool bDumpFlag = false;
@@ -517,6 +586,8 @@ static void sigDumpHandler(int sig)
     snprintf(filename, sizeof(filename), 
         "%s/logs/sf_dump.log", g_sf_global_vars.base_path);
     //manager_dump_global_vars_to_file(filename);
+    sf_dump_notify_stat_to_file(filename);
+    sf_trace_dump_to_file(filename);
 
     bDumpFlag = false;
 }
@@ -617,9 +688,16 @@ int sf_setup_signal_handler()
 
 int sf_startup_schedule(pthread_t *schedule_tid)
 {
+    int result;
     ScheduleArray scheduleArray;
     ScheduleEntry scheduleEntries[LOG_SCHEDULE_ENTRIES_COUNT];
 
+    if ((result=sf_logger_setup_async(&g_log_context,
+                    &g_sf_global_vars.error_log)) != 0)
+    {
+        return result;
+    }
+
     scheduleArray.entries = scheduleEntries;
     sf_setup_schedule(&g_log_context, &g_sf_global_vars.error_log,
             &scheduleArray);
@@ -644,6 +722,12 @@ int sf_add_slow_log_schedule(SFSlowLogContext *slowlog_ctx)
         return result;
     }
 
+    if ((result=sf_logger_setup_async(&slowlog_ctx->ctx,
+                    &slowlog_ctx->cfg.log_cfg)) != 0)
+    {
+        return result;
+    }
+
     scheduleArray.entries = scheduleEntries;
     sf_setup_schedule(&slowlog_ctx->ctx, &slowlog_ctx->cfg.log_cfg,
             &scheduleArray);
@@ -670,6 +754,27 @@ void sf_enable_thread_notify_ex(SFContext *sf_context, const bool enabled)
     }
 }
 
+void sf_get_notify_stat_ex(SFContext *sf_context,
+        int64_t *notifies, int64_t *wakeups)
+{
+    struct nio_thread_data *thread_data;
+    struct nio_thread_data *pDataEnd;
+
+    *notifies = *wakeups = 0;
+    if (sf_context->thread_data == NULL) {
+        return;
+    }
+
+    pDataEnd = sf_context->thread_data + sf_context->work_threads;
+    for (thread_data=sf_context->thread_data; thread_data<pDataEnd;
+            thread_data++)
+    {
+        *notifies += __sync_add_and_fetch(&thread_data->
+                notify_stat.notifies, 0);
+        *wakeups += thread_data->notify_stat.wakeups;
+    }
+}
+
 struct nio_thread_data *sf_get_random_thread_data_ex(SFContext *sf_context)
 {
     uint32_t index;
@@ -25,6 +25,7 @@
 #include "fastcommon/ioevent.h"
 #include "fastcommon/fast_task_queue.h"
 #include "sf_types.h"
+#include "sf_buffer_pool.h"
 
 typedef void* (*sf_alloc_thread_extra_data_callback)(const int thread_index);
 typedef void (*sf_sig_quit_handler)(int sig);
@@ -100,6 +101,14 @@ static inline void sf_enable_realloc_task_buffer_ex(SFContext *sf_context,
 #define sf_enable_realloc_task_buffer(enabled)  \
     sf_enable_realloc_task_buffer_ex(&g_sf_context, enabled)
 
+/* the task notifications to the nio threads and the wakeups of them,
+ * the notifications in a burst are coalesced into one wakeup */
+void sf_get_notify_stat_ex(SFContext *sf_context,
+        int64_t *notifies, int64_t *wakeups);
+
+#define sf_get_notify_stat(notifies, wakeups)  \
+    sf_get_notify_stat_ex(&g_sf_context, notifies, wakeups)
+
 struct nio_thread_data *sf_get_random_thread_data_ex(SFContext *sf_context);
 
 #define sf_get_random_thread_data()  \
@@ -109,6 +118,12 @@ void sf_set_sig_quit_handler(sf_sig_quit_handler quit_handler);
 
 int sf_init_task(struct fast_task_info *task);
 
+/* alloc from the pipeline task pool, return NULL when used up */
+struct fast_task_info *sf_pipeline_alloc_task(SFContext *sf_context);
+
+/* give back to the pipeline task pool */
+void sf_pipeline_free_task(struct fast_task_info *task);
+
 static inline struct fast_task_info *sf_alloc_init_task(
         SFContext *sf_context, const int sock)
 {
@@ -145,7 +160,12 @@ static inline void sf_release_task(struct fast_task_info *task)
                 alloc_count, alloc_count - free_count, free_count);
                 */
 
-        free_queue_push(task);
+        sf_task_return_buffer(task);
+        if (task->pipeline.pooled) {
+            sf_pipeline_free_task(task);
+        } else {
+            free_queue_push(task);
+        }
     } else {
         /*
         logInfo("file: "__FILE__", line: %d, "
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//sf_trace.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <inttypes.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/fc_memory.h"
+#include "sf_trace.h"
+
+SFTraceRing g_sf_trace_ring = {NULL, 0, 0};
+__thread SFTraceContext g_sf_trace_current = {0, 0};
+
+static volatile int64_t trace_id_counter = 0;
+static int64_t trace_id_prefix = 0;
+
+int sf_trace_init(const int span_count)
+{
+    int result;
+
+    if (g_sf_trace_ring.spans != NULL || span_count <= 0) {
+        return 0;
+    }
+
+    if ((result=init_pthread_lock(&g_sf_trace_ring.lock)) != 0) {
+        return result;
+    }
+
+    g_sf_trace_ring.spans = (SFTraceSpan *)fc_calloc(
+            span_count, sizeof(SFTraceSpan));
+    if (g_sf_trace_ring.spans == NULL) {
+        return ENOMEM;
+    }
+    g_sf_trace_ring.size = span_count;
+    g_sf_trace_ring.count = 0;
+
+    //the high 16 bits distinguish the processes
+    trace_id_prefix = ((int64_t)((getpid() ^ rand()) & 0xFFFF)) << 48;
+    return 0;
+}
+
+void sf_trace_destroy()
+{
+    if (g_sf_trace_ring.spans != NULL) {
+        free(g_sf_trace_ring.spans);
+        g_sf_trace_ring.spans = NULL;
+        g_sf_trace_ring.size = 0;
+        pthread_mutex_destroy(&g_sf_trace_ring.lock);
+    }
+}
+
+int64_t sf_trace_generate_id()
+{
+    int64_t counter;
+
+    counter = __sync_add_and_fetch(&trace_id_counter, 1);
+    return trace_id_prefix | ((get_current_time_us() &
+                0xFFFFFFFFLL) << 16) | (counter & 0xFFFF);
+}
+
+void sf_trace_add_span(const int64_t trace_id, const char *name,
+        const int64_t start_time_us, const int time_used_us)
+{
+    SFTraceSpan *span;
+
+    if (g_sf_trace_ring.spans == NULL) {
+        return;
+    }
+
+    PTHREAD_MUTEX_LOCK(&g_sf_trace_ring.lock);
+    span = g_sf_trace_ring.spans + g_sf_trace_ring.count %
+        g_sf_trace_ring.size;
+    span->trace_id = trace_id;
+    span->start_time_us = start_time_us;
+    span->time_used_us = time_used_us;
+    snprintf(span->name, sizeof(span->name), "%s", name);
+    g_sf_trace_ring.count++;
+    PTHREAD_MUTEX_UNLOCK(&g_sf_trace_ring.lock);
+}
+
+/* without lock because it is called by the signal handler, so the span
+ * being written by other thread maybe incomplete */
+int sf_trace_dump_to_file(const char *filename)
+{
+    FILE *fp;
+    SFTraceSpan *span;
+    int64_t count;
+    int64_t i;
+    char time_buff[32];
+
+    if (g_sf_trace_ring.spans == NULL) {
+        return 0;
+    }
+
+    if ((fp=fopen(filename, "a")) == NULL) {
+        return errno != 0 ? errno : EPERM;
+    }
+
+    count = g_sf_trace_ring.count;
+    i = (count > g_sf_trace_ring.size) ? count - g_sf_trace_ring.size : 0;
+    fprintf(fp, "\n[trace spans] total count: %"PRId64", "
+            "dump count: %"PRId64"\n", count, count - i);
+    for (; i<count; i++) {
+        span = g_sf_trace_ring.spans + i % g_sf_trace_ring.size;
+        formatDatetime(span->start_time_us / 1000000,
+                "%Y-%m-%d %H:%M:%S", time_buff, sizeof(time_buff));
+        fprintf(fp, "trace_id: %016"PRIx64", span: %s, "
+                "start: %s.%06d, time used: %d us\n",
+                span->trace_id, span->name, time_buff,
+                (int)(span->start_time_us % 1000000),
+                span->time_used_us);
+    }
+
+    fclose(fp);
+    return 0;
+}
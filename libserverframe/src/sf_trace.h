@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//sf_trace.h
+
+/* the sampled request tracing.
+ *
+ * the trace context (trace id and flags) of the sampled request is carried
+ * by the trace extension (SFProtoTraceExt) which follows the proto header
+ * with the traced magic, sent by sf_proto_send_request, and it is
+ * attached to the dealing thread when the request received. every hop
+ * records the span timings of the sampled requests to the span ring which
+ * is dumped by the signal SIGUSR1 or SIGUSR2 (DEBUG_FLAG only) */
+
+#ifndef _SF_TRACE_H
+#define _SF_TRACE_H
+
+#include "fastcommon/common_define.h"
+#include "sf_define.h"
+#include "sf_types.h"
+
+#define SF_TRACE_SPAN_NAME_SIZE   32
+
+typedef struct sf_trace_span {
+    int64_t trace_id;
+    int64_t start_time_us;
+    int time_used_us;
+    char name[SF_TRACE_SPAN_NAME_SIZE];
+} SFTraceSpan;
+
+typedef struct sf_trace_ring {
+    SFTraceSpan *spans;
+    int size;
+    int64_t count;  //the total span count added
+    pthread_mutex_t lock;
+} SFTraceRing;
+
+#define SF_TRACE_SAMPLED(trace) (((trace)->flags & SF_TRACE_FLAG_SAMPLED) != 0)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    extern SFTraceRing g_sf_trace_ring;
+    extern __thread SFTraceContext g_sf_trace_current;
+
+    /* alloc the span ring, span_count <= 0 for disable */
+    int sf_trace_init(const int span_count);
+
+    void sf_trace_destroy();
+
+    int64_t sf_trace_generate_id();
+
+    void sf_trace_add_span(const int64_t trace_id, const char *name,
+            const int64_t start_time_us, const int time_used_us);
+
+    /* dump the spans from the oldest to the newest */
+    int sf_trace_dump_to_file(const char *filename);
+
+    static inline void sf_trace_add_span_ex(const SFTraceContext *trace,
+            const char *name, const int64_t start_time_us,
+            const int64_t time_used_us)
+    {
+        if (SF_TRACE_SAMPLED(trace)) {
+            sf_trace_add_span(trace->trace_id, name,
+                    start_time_us, time_used_us);
+        }
+    }
+
+    /* start a new sampled trace in the current thread */
+    static inline void sf_trace_begin()
+    {
+        g_sf_trace_current.trace_id = sf_trace_generate_id();
+        g_sf_trace_current.flags = SF_TRACE_FLAG_SAMPLED;
+    }
+
+    static inline void sf_trace_set_current(const SFTraceContext *trace)
+    {
+        g_sf_trace_current = *trace;
+    }
+
+    static inline void sf_trace_clear_current()
+    {
+        g_sf_trace_current.trace_id = 0;
+        g_sf_trace_current.flags = 0;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
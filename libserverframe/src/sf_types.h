@@ -27,6 +27,7 @@
 #include "fastcommon/fast_task_queue.h"
 
 #define SF_ERROR_INFO_SIZE   256
+#define SF_METRICS_NAME_SIZE  32
 
 #define SF_SERVER_TASK_TYPE_NONE                 0
 #define SF_SERVER_TASK_TYPE_CHANNEL_HOLDER     101   //for request idempotency
@@ -60,13 +61,28 @@ typedef struct sf_context {
     sf_accept_done_callback accept_done_func;
     TaskCleanUpCallback task_cleanup_func;
     sf_recv_timeout_callback timeout_callback;
+
+    struct {
+        bool enabled;
+        int max_inflight;  //the max pipelined requests per connection
+        int max_tasks;     //the max pipeline tasks of the context
+        volatile int task_count;  //the allocated pipeline tasks
+        struct fast_task_queue free_tasks;  //the pipeline task pool
+        bool cmds[256];    //the commands can be pipelined
+    } pipeline;
 } SFContext;
 
+typedef struct sf_trace_context {
+    int64_t trace_id;  //0 for not traced
+    int flags;         //SF_TRACE_FLAG_xxx
+} SFTraceContext;
+
 typedef struct {
     int body_len;      //body length
     short flags;
     short status;
     unsigned char cmd; //command
+    SFTraceContext trace;
 } SFHeaderInfo;
 
 typedef struct {
@@ -116,8 +132,27 @@ typedef struct sf_log_config {
     TimeInfo delete_old_time;
     int keep_days;
     int64_t rotate_on_size;
+    struct {
+        bool enabled;
+        int buffer_size;  //the ring buffer size of each thread
+    } async;
 } SFLogConfig;
 
+typedef struct sf_metrics_summary {
+    int64_t count;
+    int64_t sum;   //in microseconds
+    int64_t max;
+    int64_t p50;
+    int64_t p99;
+    int64_t p999;
+} SFMetricsSummary;
+
+typedef struct sf_metrics_item_info {
+    char type;   //SF_METRICS_TYPE_CMD or SF_METRICS_TYPE_STAGE
+    char name[SF_METRICS_NAME_SIZE];
+    SFMetricsSummary summary;
+} SFMetricsItemInfo;
+
 typedef struct sf_slow_log_config {
     bool enabled;
     int log_slower_than_ms;
@@ -139,6 +139,16 @@ int sf_logger_init(LogContext *pContext, const char *filename_prefix)
     return 0;
 }
 
+int sf_logger_setup_async(LogContext *pContext, SFLogConfig *log_cfg)
+{
+    if (!log_cfg->async.enabled) {
+        return 0;
+    }
+
+    return log_set_async_ex(pContext, log_cfg->async.buffer_size,
+            LOG_ASYNC_DEF_FLUSH_INTERVAL_MS);
+}
+
 ScheduleEntry *sf_logger_set_schedule_entry(struct log_context *pContext,
         SFLogConfig *log_cfg, ScheduleEntry *pScheduleEntry)
 {
@@ -78,6 +78,10 @@ void sf_parse_daemon_mode_and_action_ex(int argc, char *argv[],
 
 int sf_logger_init(LogContext *pContext, const char *filename_prefix);
 
+/* switch to the asynchronous mode when async_log is true,
+ * MUST be called after daemon_init */
+int sf_logger_setup_async(LogContext *pContext, SFLogConfig *log_cfg);
+
 ScheduleEntry *sf_logger_set_schedule_entry(struct log_context *pContext,
         SFLogConfig *log_cfg, ScheduleEntry *pScheduleEntry);
 
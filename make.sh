@@ -148,6 +148,10 @@ cd ../fuse
 replace_makefile
 make $1 $2
 
+cd ../preload
+replace_makefile
+make $1 $2
+
 
 if [ "$1" = "install" ]; then
   cd ..
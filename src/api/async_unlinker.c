@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "sf/sf_global.h"
+#include "async_unlinker.h"
+
+AsyncUnlinkerContext g_async_unlinker_ctx;
+
+//pushed by the notify and the terminate to wake up the thread
+static FCFSAPIAsyncUnlinkEvent notify_event;
+static FCFSAPIAsyncUnlinkEvent stop_event;
+
+static int drain_trash(FCFSAPIContext *ctx, bool *stopped)
+{
+    FDIRSubtreeFile *file;
+    FDIRSubtreeFile *end;
+    int64_t purge_version;
+    int64_t last_version;
+    int64_t tid;
+    int count;
+    int result;
+
+    tid = getpid();
+    purge_version = 0;
+    while (1) {
+        if ((result=fdir_client_drain_trash(ctx->contexts.fdir, &ctx->ns,
+                        purge_version, g_async_unlinker_ctx.files,
+                        &count, &last_version)) != 0)
+        {
+            return result;
+        }
+        if (count == 0) {
+            return 0;
+        }
+
+        end = g_async_unlinker_ctx.files + count;
+        for (file=g_async_unlinker_ctx.files; file<end; file++) {
+            if ((result=fs_api_unlink_file(ctx->contexts.fsapi, file->inode,
+                            file->size, tid)) != 0)
+            {
+                //keep the files in the trash for the next drain
+                logError("file: "__FILE__", line: %d, "
+                        "unlink file data fail, oid: %"PRId64", size: %"
+                        PRId64", errno: %d, error info: %s", __LINE__,
+                        file->inode, file->size, result, STRERROR(result));
+                return result;
+            }
+        }
+
+        if (!async_unlinker_running()) {
+            *stopped = true;
+            return 0;
+        }
+        purge_version = last_version;
+    }
+}
+
+static void drain_all(bool *stopped)
+{
+    FCFSAPIAsyncUnlinkContext *uctx;
+    int result;
+
+    for (uctx=(FCFSAPIAsyncUnlinkContext *)__sync_add_and_fetch(
+                &g_async_unlinker_ctx.head, 0); uctx != NULL &&
+            !*stopped; uctx=uctx->next)
+    {
+        if ((result=drain_trash(uctx->ctx, stopped)) != 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "drain the trash of namespace: %.*s fail, "
+                    "errno: %d, error info: %s", __LINE__,
+                    uctx->ctx->ns.len, uctx->ctx->ns.str,
+                    result, STRERROR(result));
+        }
+    }
+}
+
+static void *async_unlinker_thread_func(void *arg)
+{
+    FCFSAPIAsyncUnlinkEvent *event;
+    bool stopped;
+
+    stopped = false;
+    drain_all(&stopped);  //the files remain by the last run
+    while (!stopped) {
+        event = (FCFSAPIAsyncUnlinkEvent *)fc_queue_timedpop_sec(
+                &g_async_unlinker_ctx.queue,
+                FCFS_API_ASYNC_UNLINK_DRAIN_INTERVAL);
+        if (event == &stop_event) {
+            break;
+        }
+        if (event == &notify_event) {
+            //popped, so the notify event can be pushed again
+            __sync_bool_compare_and_swap(&g_async_unlinker_ctx.
+                    notified, 1, 0);
+        }
+        drain_all(&stopped);
+    }
+
+    __sync_bool_compare_and_swap(&g_async_unlinker_ctx.
+            thread_running, 1, 0);
+    return NULL;
+}
+
+static int add_context(FCFSAPIContext *ctx)
+{
+    FCFSAPIAsyncUnlinkContext *uctx;
+
+    PTHREAD_MUTEX_LOCK(&g_async_unlinker_ctx.lock);
+    for (uctx=g_async_unlinker_ctx.head; uctx!=NULL; uctx=uctx->next) {
+        if (uctx->ctx == ctx) {
+            break;
+        }
+    }
+
+    if (uctx == NULL) {
+        uctx = (FCFSAPIAsyncUnlinkContext *)fc_malloc(
+                sizeof(FCFSAPIAsyncUnlinkContext));
+        if (uctx != NULL) {
+            uctx->ctx = ctx;
+            uctx->next = g_async_unlinker_ctx.head;
+            __sync_synchronize();
+            g_async_unlinker_ctx.head = uctx;
+        }
+    }
+    PTHREAD_MUTEX_UNLOCK(&g_async_unlinker_ctx.lock);
+
+    return (uctx != NULL ? 0 : ENOMEM);
+}
+
+int async_unlinker_init(FCFSAPIContext *ctx)
+{
+    int result;
+
+    if (async_unlinker_running()) {  //shared by the api contexts
+        if ((result=add_context(ctx)) == 0) {
+            async_unlinker_notify();
+        }
+        return result;
+    }
+
+    if ((result=init_pthread_lock(&g_async_unlinker_ctx.lock)) != 0) {
+        return result;
+    }
+
+    g_async_unlinker_ctx.files = (FDIRSubtreeFile *)fc_malloc(
+            sizeof(FDIRSubtreeFile) * FDIR_DRAIN_TRASH_MAX_COUNT);
+    if (g_async_unlinker_ctx.files == NULL) {
+        return ENOMEM;
+    }
+
+    if ((result=fc_queue_init(&g_async_unlinker_ctx.queue, (long)
+                    (&((FCFSAPIAsyncUnlinkEvent *)NULL)->next))) != 0)
+    {
+        return result;
+    }
+
+    if ((result=add_context(ctx)) != 0) {
+        return result;
+    }
+
+    //set before the thread created, so the terminate never misses it
+    __sync_bool_compare_and_swap(&g_async_unlinker_ctx.running, 0, 1);
+    __sync_bool_compare_and_swap(&g_async_unlinker_ctx.thread_running, 0, 1);
+    if ((result=fc_create_thread(&g_async_unlinker_ctx.tid,
+                    async_unlinker_thread_func, NULL,
+                    SF_G_THREAD_STACK_SIZE)) != 0)
+    {
+        __sync_bool_compare_and_swap(&g_async_unlinker_ctx.
+                thread_running, 1, 0);
+        __sync_bool_compare_and_swap(&g_async_unlinker_ctx.running, 1, 0);
+        return result;
+    }
+
+    return 0;
+}
+
+void async_unlinker_terminate()
+{
+    if (!__sync_bool_compare_and_swap(&g_async_unlinker_ctx.running, 1, 0)) {
+        return;
+    }
+
+    fc_queue_push(&g_async_unlinker_ctx.queue, &stop_event);
+
+    //the thread is detached, so wait for its exit instead of join
+    while (__sync_add_and_fetch(&g_async_unlinker_ctx.thread_running, 0)) {
+        fc_sleep_ms(10);
+    }
+
+    logInfo("file: "__FILE__", line: %d, "
+            "async_unlinker_terminate", __LINE__);
+}
+
+void async_unlinker_notify()
+{
+    if (!async_unlinker_running()) {
+        return;
+    }
+
+    //at most one notify event in the queue
+    if (__sync_bool_compare_and_swap(&g_async_unlinker_ctx.notified, 0, 1)) {
+        fc_queue_push(&g_async_unlinker_ctx.queue, &notify_event);
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* delete the data of the files freed by the subtree remove of FastDIR in
+ * the background. the freed files are kept in the namespace trash of
+ * FastDIR, the thread drains the trash and deletes their data from
+ * faststore, then purges them from the trash by the next drain. the trash
+ * survives the client crash, so the remain files are deleted after the
+ * next start */
+
+#ifndef _FCFS_API_ASYNC_UNLINKER_H
+#define _FCFS_API_ASYNC_UNLINKER_H
+
+#include "fastcommon/fc_queue.h"
+#include "fcfs_api_types.h"
+
+//drain the trash periodically for the files freed by the other clients
+#define FCFS_API_ASYNC_UNLINK_DRAIN_INTERVAL  60
+
+typedef struct fcfs_api_async_unlink_event {
+    struct fcfs_api_async_unlink_event *next;  //for queue
+} FCFSAPIAsyncUnlinkEvent;
+
+typedef struct fcfs_api_async_unlink_context {
+    FCFSAPIContext *ctx;
+    struct fcfs_api_async_unlink_context *next;
+} FCFSAPIAsyncUnlinkContext;
+
+typedef struct {
+    FCFSAPIAsyncUnlinkContext *head;  //the started api contexts
+    FDIRSubtreeFile *files;  //FDIR_DRAIN_TRASH_MAX_COUNT entries
+    struct fc_queue queue;
+    pthread_mutex_t lock;
+    volatile int notified;
+    volatile int running;
+    volatile int thread_running;
+    pthread_t tid;
+} AsyncUnlinkerContext;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    extern AsyncUnlinkerContext g_async_unlinker_ctx;
+
+    /* start the thread for the first time, and add the api context
+     * which namespace trash to drain */
+    int async_unlinker_init(FCFSAPIContext *ctx);
+
+    /* stop and wait for the thread exit, the remain files are deleted
+     * after the next start. MUST be called before the terminate of fs_api */
+    void async_unlinker_terminate();
+
+    static inline bool async_unlinker_running()
+    {
+        return __sync_add_and_fetch(&g_async_unlinker_ctx.running, 0) != 0;
+    }
+
+    //wake up the thread to drain the trash, such as after the subtree remove
+    void async_unlinker_notify();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,7 +17,11 @@
 #include <limits.h>
 #include "fastcommon/shared_func.h"
 #include "fastcommon/logger.h"
+#include "sf/sf_global.h"
+#include "sf/sf_trace.h"
 #include "async_reporter.h"
+#include "async_unlinker.h"
+#include "write_behind.h"
 #include "fcfs_api.h"
 
 #define FCFS_API_MIN_SHARED_ALLOCATOR_COUNT           1
@@ -32,6 +36,21 @@
 #define FCFS_API_MAX_HASHTABLE_TOTAL_CAPACITY      100000000
 #define FCFS_API_DEFAULT_HASHTABLE_TOTAL_CAPACITY    1403641
 
+#define FCFS_API_MIN_WRITE_BEHIND_SLICE_SIZE      (64 * 1024)
+#define FCFS_API_MAX_WRITE_BEHIND_SLICE_SIZE      FS_FILE_BLOCK_SIZE
+#define FCFS_API_DEFAULT_WRITE_BEHIND_SLICE_SIZE  (1024 * 1024)
+
+#define FCFS_API_MIN_WRITE_BEHIND_FLUSH_THREADS       1
+#define FCFS_API_MAX_WRITE_BEHIND_FLUSH_THREADS     256
+#define FCFS_API_DEFAULT_WRITE_BEHIND_FLUSH_THREADS   8
+
+#define FCFS_API_MIN_WRITE_BEHIND_DIRTY_EXPIRE_MS        10
+#define FCFS_API_MAX_WRITE_BEHIND_DIRTY_EXPIRE_MS     60000
+#define FCFS_API_DEFAULT_WRITE_BEHIND_DIRTY_EXPIRE_MS  1000
+
+#define FCFS_API_DEFAULT_WRITE_BEHIND_FILE_DIRTY_LIMIT  (64 * 1024 * 1024)
+#define FCFS_API_DEFAULT_WRITE_BEHIND_MAX_DIRTY_MEMORY  (256 * 1024 * 1024)
+
 FCFSAPIContext g_fcfs_api_ctx;
 
 static int opendir_session_alloc_init(void *element, void *args)
@@ -50,6 +69,50 @@ static int opendir_session_alloc_init(void *element, void *args)
     return 0;
 }
 
+static int write_behind_config_load(FCFSAPIContext *ctx,
+        IniFullContext *ini_ctx)
+{
+    ini_ctx->section_name = FCFS_API_DEFAULT_WRITE_BEHIND_SECTION_NAME;
+    ctx->write_behind.enabled = iniGetBoolValue(ini_ctx->section_name,
+            "enabled", ini_ctx->context, false);
+    if (!ctx->write_behind.enabled) {
+        return 0;
+    }
+
+    ctx->write_behind.slice_size = iniGetByteCorrectValue(ini_ctx,
+            "slice_size", FCFS_API_DEFAULT_WRITE_BEHIND_SLICE_SIZE,
+            FCFS_API_MIN_WRITE_BEHIND_SLICE_SIZE,
+            FCFS_API_MAX_WRITE_BEHIND_SLICE_SIZE);
+    if ((ctx->write_behind.slice_size & (ctx->write_behind.
+                    slice_size - 1)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "config file: %s, section: %s, slice_size: %d "
+                "must be power of 2", __LINE__, ini_ctx->filename,
+                ini_ctx->section_name, ctx->write_behind.slice_size);
+        return EINVAL;
+    }
+
+    ctx->write_behind.flush_threads = iniGetIntCorrectValue(ini_ctx,
+            "flush_threads", FCFS_API_DEFAULT_WRITE_BEHIND_FLUSH_THREADS,
+            FCFS_API_MIN_WRITE_BEHIND_FLUSH_THREADS,
+            FCFS_API_MAX_WRITE_BEHIND_FLUSH_THREADS);
+
+    ctx->write_behind.dirty_expire_ms = iniGetIntCorrectValue(ini_ctx,
+            "dirty_expire_ms", FCFS_API_DEFAULT_WRITE_BEHIND_DIRTY_EXPIRE_MS,
+            FCFS_API_MIN_WRITE_BEHIND_DIRTY_EXPIRE_MS,
+            FCFS_API_MAX_WRITE_BEHIND_DIRTY_EXPIRE_MS);
+
+    ctx->write_behind.file_dirty_limit = iniGetByteCorrectValue(ini_ctx,
+            "file_dirty_limit", FCFS_API_DEFAULT_WRITE_BEHIND_FILE_DIRTY_LIMIT,
+            ctx->write_behind.slice_size, INT64_MAX);
+
+    ctx->write_behind.max_dirty_memory = iniGetByteCorrectValue(ini_ctx,
+            "max_dirty_memory", FCFS_API_DEFAULT_WRITE_BEHIND_MAX_DIRTY_MEMORY,
+            ctx->write_behind.file_dirty_limit, INT64_MAX);
+    return 0;
+}
+
 static int fcfs_api_common_init(FCFSAPIContext *ctx, FDIRClientContext *fdir,
         FSAPIContext *fsapi, const char *ns, IniFullContext *ini_ctx,
         const char *fdir_section_name, const char *fsapi_section_name,
@@ -62,10 +125,17 @@ static int fcfs_api_common_init(FCFSAPIContext *ctx, FDIRClientContext *fdir,
 
     ctx->use_sys_lock_for_append = iniGetBoolValue(fdir_section_name,
             "use_sys_lock_for_append", ini_ctx->context, false);
+    ctx->append_reserve.enabled = iniGetBoolValue(fdir_section_name,
+            "append_reserve_enabled", ini_ctx->context, false);
+    ctx->append_reserve.batch = iniGetBoolValue(fdir_section_name,
+            "append_reserve_batch", ini_ctx->context, false);
     ctx->async_report.enabled = iniGetBoolValue(fdir_section_name,
             "async_report_enabled", ini_ctx->context, true);
     ctx->async_report.interval_ms = iniGetIntValue(fdir_section_name,
             "async_report_interval_ms", ini_ctx->context, 10);
+    ctx->trace.sample_interval = iniGetIntValue(fdir_section_name,
+            "trace_sample_interval", ini_ctx->context, 0);
+    ctx->trace.counter = 0;
 
     ini_ctx->section_name = fdir_section_name;
     ctx->async_report.shared_allocator_count = iniGetIntCorrectValueEx(
@@ -101,6 +171,18 @@ static int fcfs_api_common_init(FCFSAPIContext *ctx, FDIRClientContext *fdir,
         }
     }
 
+    if ((result=write_behind_config_load(ctx, ini_ctx)) != 0) {
+        return result;
+    }
+
+    if (ctx->trace.sample_interval > 0) {
+        if ((result=sf_trace_init(g_sf_global_vars.
+                        trace_span_count)) != 0)
+        {
+            return result;
+        }
+    }
+
     ini_ctx->section_name = fsapi_section_name;
     if ((result=fs_api_init_ex(fsapi, ini_ctx,
                     fcfs_api_file_write_done_callback,
@@ -255,8 +337,18 @@ int fcfs_api_start_ex(FCFSAPIContext *ctx)
         return result;
     }
 
+    if ((result=async_unlinker_init(ctx)) != 0) {
+        return result;
+    }
+
     if (ctx->async_report.enabled) {
-        return async_reporter_init(ctx);
+        if ((result=async_reporter_init(ctx)) != 0) {
+            return result;
+        }
+    }
+
+    if (ctx->write_behind.enabled) {
+        return write_behind_init(ctx);
     } else {
         return 0;
     }
@@ -264,6 +356,8 @@ int fcfs_api_start_ex(FCFSAPIContext *ctx)
 
 void fcfs_api_terminate_ex(FCFSAPIContext *ctx)
 {
+    write_behind_terminate();
+    async_unlinker_terminate();
     fs_api_terminate_ex(ctx->contexts.fsapi);
     async_reporter_terminate();
 }
@@ -274,7 +368,9 @@ void fcfs_api_async_report_config_to_string_ex(FCFSAPIContext *ctx,
     int len;
 
     len = snprintf(output, size, "use_sys_lock_for_append: %d, "
+            "append_reserve { enabled: %d, batch: %d }, "
             "async_report { enabled: %d", ctx->use_sys_lock_for_append,
+            ctx->append_reserve.enabled, ctx->append_reserve.batch,
             ctx->async_report.enabled);
     if (ctx->async_report.enabled) {
         len += snprintf(output + len, size - len, ", "
@@ -292,3 +388,27 @@ void fcfs_api_async_report_config_to_string_ex(FCFSAPIContext *ctx,
     }
     snprintf(output + len, size - len, " } ");
 }
+
+void fcfs_api_write_behind_config_to_string_ex(FCFSAPIContext *ctx,
+        char *output, const int size)
+{
+    int len;
+
+    len = snprintf(output, size, "write_behind { enabled: %d",
+            ctx->write_behind.enabled);
+    if (ctx->write_behind.enabled) {
+        len += snprintf(output + len, size - len, ", "
+                "slice_size: %d KB, flush_threads: %d, "
+                "dirty_expire_ms: %d, file_dirty_limit: %"PRId64" MB, "
+                "max_dirty_memory: %"PRId64" MB",
+                ctx->write_behind.slice_size / 1024,
+                ctx->write_behind.flush_threads,
+                ctx->write_behind.dirty_expire_ms,
+                ctx->write_behind.file_dirty_limit / (1024 * 1024),
+                ctx->write_behind.max_dirty_memory / (1024 * 1024));
+        if (len > size) {
+            len = size;
+        }
+    }
+    snprintf(output + len, size - len, " } ");
+}
@@ -25,6 +25,7 @@
 #define FCFS_API_DEFAULT_FASTDIR_SECTION_NAME    "FastDIR"
 #define FCFS_API_DEFAULT_FASTSTORE_SECTION_NAME  "FastStore"
 #define FCFS_API_DEFAULT_FSAPI_SECTION_NAME      "write_combine"
+#define FCFS_API_DEFAULT_WRITE_BEHIND_SECTION_NAME  "write_behind"
 
 #define fcfs_api_set_contexts(ns)  fcfs_api_set_contexts_ex(&g_fcfs_api_ctx, ns)
 
@@ -54,6 +55,9 @@
 #define fcfs_api_async_report_config_to_string(output, size) \
     fcfs_api_async_report_config_to_string_ex(&g_fcfs_api_ctx, output, size)
 
+#define fcfs_api_write_behind_config_to_string(output, size) \
+    fcfs_api_write_behind_config_to_string_ex(&g_fcfs_api_ctx, output, size)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -120,6 +124,9 @@ extern "C" {
     void fcfs_api_async_report_config_to_string_ex(FCFSAPIContext *ctx,
             char *output, const int size);
 
+    void fcfs_api_write_behind_config_to_string_ex(FCFSAPIContext *ctx,
+            char *output, const int size);
+
 #ifdef __cplusplus
 }
 #endif
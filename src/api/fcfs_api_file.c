@@ -19,8 +19,10 @@
 #include "fastcommon/logger.h"
 #include "fastcommon/sockopt.h"
 #include "fastcommon/sched_thread.h"
+#include "sf/sf_trace.h"
 #include "fcfs_api_util.h"
 #include "async_reporter.h"
+#include "write_behind.h"
 #include "fcfs_api_file.h"
 
 #define FCFS_API_MAGIC_NUMBER    1588076578
@@ -28,6 +30,33 @@
 static int file_truncate(FCFSAPIContext *ctx, const int64_t oid,
         const int64_t new_size, const int64_t tid);
 
+/* the append with reservation does NOT need the system lock */
+#define FCFS_API_USE_SYS_LOCK_FOR_APPEND(fi) \
+    ((fi)->ctx->use_sys_lock_for_append && !(fi)->ctx->append_reserve. \
+     enabled && !(fi)->ctx->async_report.enabled && ((fi)->flags & O_APPEND))
+
+static FCFSAPIAppendReserver *append_reserver_create()
+{
+    FCFSAPIAppendReserver *reserver;
+
+    if ((reserver=fc_malloc(sizeof(FCFSAPIAppendReserver))) == NULL) {
+        return NULL;
+    }
+    if (init_pthread_lock_cond_pair(&reserver->lcp) != 0) {
+        free(reserver);
+        return NULL;
+    }
+    reserver->in_progress = false;
+    reserver->head = reserver->tail = NULL;
+    return reserver;
+}
+
+static void append_reserver_destroy(FCFSAPIAppendReserver *reserver)
+{
+    destroy_pthread_lock_cond_pair(&reserver->lcp);
+    free(reserver);
+}
+
 static int deal_open_flags(FCFSAPIFileInfo *fi, FDIRDEntryFullName *fullname,
         const FDIRClientOwnerModePair *omp, const int64_t tid, int result)
 {
@@ -95,6 +124,25 @@ static int deal_open_flags(FCFSAPIFileInfo *fi, FDIRDEntryFullName *fullname,
     } else {
         fi->offset = 0;
     }
+
+    if ((fi->flags & O_APPEND) && fi->ctx->append_reserve.enabled &&
+            fi->ctx->append_reserve.batch)
+    {
+        if ((fi->reserver=append_reserver_create()) == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    /* the append with system lock and the sync writes are write through */
+    if (fi->ctx->write_behind.enabled && !(fi->flags & (O_DIRECT |
+                    O_SYNC | O_DSYNC)) && !FCFS_API_USE_SYS_LOCK_FOR_APPEND(fi))
+    {
+        if ((fi->wbehind=write_behind_create(fi->ctx,
+                        &fi->dentry, tid)) == NULL)
+        {
+            return ENOMEM;
+        }
+    }
     return 0;
 }
 
@@ -117,6 +165,8 @@ int fcfs_api_open_ex(FCFSAPIContext *ctx, FCFSAPIFileInfo *fi,
     fi->ctx = ctx;
     fi->flags = flags;
     fi->sessions.flock.mconn = NULL;
+    fi->wbehind = NULL;
+    fi->reserver = NULL;
     fullname.ns = ctx->ns;
     FC_SET_STRING(fullname.path, (char *)path);
     result = fcfs_api_stat_dentry_by_fullname_ex(ctx,
@@ -141,6 +191,8 @@ int fcfs_api_open_by_dentry_ex(FCFSAPIContext *ctx, FCFSAPIFileInfo *fi,
     fi->ctx = ctx;
     fi->flags = flags;
     fi->sessions.flock.mconn = NULL;
+    fi->wbehind = NULL;
+    fi->reserver = NULL;
     result = 0;
     if ((result=deal_open_flags(fi, NULL, &fctx->omp,
                     fctx->tid, result)) != 0)
@@ -167,6 +219,8 @@ int fcfs_api_open_by_inode_ex(FCFSAPIContext *ctx, FCFSAPIFileInfo *fi,
     fi->ctx = ctx;
     fi->flags = flags;
     fi->sessions.flock.mconn = NULL;
+    fi->wbehind = NULL;
+    fi->reserver = NULL;
     if ((result=deal_open_flags(fi, NULL, &fctx->omp,
                     fctx->tid, result)) != 0)
     {
@@ -179,10 +233,25 @@ int fcfs_api_open_by_inode_ex(FCFSAPIContext *ctx, FCFSAPIFileInfo *fi,
 
 int fcfs_api_close(FCFSAPIFileInfo *fi)
 {
+    int result;
+
     if (fi->magic != FCFS_API_MAGIC_NUMBER) {
         return EBADF;
     }
 
+    if (fi->wbehind != NULL) {
+        /* report the flush error as close(2) */
+        result = write_behind_destroy(fi->wbehind);
+        fi->wbehind = NULL;
+    } else {
+        result = 0;
+    }
+
+    if (fi->reserver != NULL) {
+        append_reserver_destroy(fi->reserver);
+        fi->reserver = NULL;
+    }
+
     if (fi->sessions.flock.mconn != NULL) {
         /* force close connection to unlock */
         fdir_client_close_session(&fi->sessions.flock, true);
@@ -190,7 +259,7 @@ int fcfs_api_close(FCFSAPIFileInfo *fi)
 
     fi->ctx = NULL;
     fi->magic = 0;
-    return 0;
+    return result;
 }
 
 static int report_size_and_time(FCFSAPIContext *ctx,
@@ -276,6 +345,28 @@ static inline void print_block_slice_key(FSBlockSliceKeyInfo *bs_key)
 }
 */
 
+static inline bool trace_sample_begin(FCFSAPIContext *ctx,
+        int64_t *start_time)
+{
+    if (ctx->trace.sample_interval <= 0 || __sync_add_and_fetch(
+                &ctx->trace.counter, 1) % ctx->trace.sample_interval != 0)
+    {
+        return false;
+    }
+
+    sf_trace_begin();
+    *start_time = get_current_time_us();
+    return true;
+}
+
+static inline void trace_sample_end(const char *name,
+        const int64_t start_time)
+{
+    sf_trace_add_span(g_sf_trace_current.trace_id, name, start_time,
+            get_current_time_us() - start_time);
+    sf_trace_clear_current();
+}
+
 static int do_pwrite(FCFSAPIFileInfo *fi, const char *buff,
         const int size, const int64_t offset, int *written_bytes,
         int *total_inc_alloc, const bool need_report_modified,
@@ -288,11 +379,25 @@ static int do_pwrite(FCFSAPIFileInfo *fi, const char *buff,
     int result;
     int remain;
 
+    *total_inc_alloc = *written_bytes = 0;
+    if (fi->wbehind != NULL) {
+        if ((result=write_behind_write(fi->wbehind, buff,
+                        size, offset)) != 0)
+        {
+            return result;
+        }
+
+        *written_bytes = size;
+        if (offset + size > fi->dentry.stat.size) {
+            fi->dentry.stat.size = offset + size;
+        }
+        return 0;
+    }
+
     FS_API_SET_CTX_AND_TID_EX(op_ctx, fi->ctx->contexts.fsapi, tid);
     wbuffer.extra_data = &callback_arg.extra;
     callback_arg.extra.ctx = fi->ctx;
 
-    *total_inc_alloc = *written_bytes = 0;
     new_offset = offset;
     fs_set_block_slice(&op_ctx.bs_key, fi->dentry.inode, offset, size);
     while (1) {
@@ -353,6 +458,9 @@ int fcfs_api_pwrite_ex(FCFSAPIFileInfo *fi, const char *buff,
         const int64_t tid)
 {
     int total_inc_alloc;
+    int result;
+    bool traced;
+    int64_t start_time;
 
     if (size == 0) {
         return 0;
@@ -366,8 +474,105 @@ int fcfs_api_pwrite_ex(FCFSAPIFileInfo *fi, const char *buff,
         return EBADF;
     }
 
-    return do_pwrite(fi, buff, size, offset, written_bytes,
+    traced = trace_sample_begin(fi->ctx, &start_time);
+    result = do_pwrite(fi, buff, size, offset, written_bytes,
             &total_inc_alloc, true, tid);
+    if (traced) {
+        trace_sample_end("api_pwrite", start_time);
+    }
+    return result;
+}
+
+static inline int reserve_append_range(FCFSAPIFileInfo *fi,
+        const int64_t length, int64_t *offset)
+{
+    return fdir_client_reserve_append(fi->ctx->contexts.fdir,
+            &fi->ctx->ns, fi->dentry.inode, length, offset);
+}
+
+/* the first waiter becomes the leader when no reservation in progress,
+ * it reserves the total length of the pending waiters by one request */
+static int batch_reserve_append_range(FCFSAPIAppendReserver *reserver,
+        FCFSAPIFileInfo *fi, const int64_t length, int64_t *offset)
+{
+    FCFSAPIAppendReserveWaiter me;
+    FCFSAPIAppendReserveWaiter *batch;
+    FCFSAPIAppendReserveWaiter *waiter;
+    int64_t total;
+    int64_t base;
+    int result;
+
+    me.length = length;
+    me.done = false;
+    me.next = NULL;
+
+    PTHREAD_MUTEX_LOCK(&reserver->lcp.lock);
+    if (reserver->tail == NULL) {
+        reserver->head = &me;
+    } else {
+        reserver->tail->next = &me;
+    }
+    reserver->tail = &me;
+
+    while (!me.done) {
+        if (reserver->in_progress) {
+            pthread_cond_wait(&reserver->lcp.cond, &reserver->lcp.lock);
+            continue;
+        }
+
+        batch = reserver->head;
+        reserver->head = reserver->tail = NULL;
+        reserver->in_progress = true;
+        PTHREAD_MUTEX_UNLOCK(&reserver->lcp.lock);
+
+        total = 0;
+        for (waiter=batch; waiter!=NULL; waiter=waiter->next) {
+            total += waiter->length;
+        }
+        result = reserve_append_range(fi, total, &base);
+
+        PTHREAD_MUTEX_LOCK(&reserver->lcp.lock);
+        for (waiter=batch; waiter!=NULL; waiter=waiter->next) {
+            waiter->result = result;
+            waiter->offset = base;
+            base += waiter->length;
+            waiter->done = true;
+        }
+        reserver->in_progress = false;
+        pthread_cond_broadcast(&reserver->lcp.cond);
+    }
+    PTHREAD_MUTEX_UNLOCK(&reserver->lcp.lock);
+
+    *offset = me.offset;
+    return me.result;
+}
+
+/* write to the range reserved by FastDIR, so the concurrent appenders
+ * write to FastStore in parallel */
+static int reserve_and_write(FCFSAPIFileInfo *fi, const char *buff,
+        const int size, int *written_bytes, const int64_t tid)
+{
+    int64_t offset;
+    int total_inc_alloc;
+    int result;
+
+    if (fi->reserver != NULL) {
+        result = batch_reserve_append_range(fi->reserver,
+                fi, size, &offset);
+    } else {
+        result = reserve_append_range(fi, size, &offset);
+    }
+    if (result != 0) {
+        *written_bytes = 0;
+        return result;
+    }
+
+    if ((result=do_pwrite(fi, buff, size, offset, written_bytes,
+                    &total_inc_alloc, true, tid)) == 0)
+    {
+        fi->offset = offset + *written_bytes;
+    }
+    return result;
 }
 
 int fcfs_api_write_ex(FCFSAPIFileInfo *fi, const char *buff,
@@ -393,8 +598,11 @@ int fcfs_api_write_ex(FCFSAPIFileInfo *fi, const char *buff,
         return EBADF;
     }
 
-    use_sys_lock = fi->ctx->use_sys_lock_for_append &&
-        !fi->ctx->async_report.enabled && (fi->flags & O_APPEND);
+    if ((fi->flags & O_APPEND) && fi->ctx->append_reserve.enabled) {
+        return reserve_and_write(fi, buff, size, written_bytes, tid);
+    }
+
+    use_sys_lock = FCFS_API_USE_SYS_LOCK_FOR_APPEND(fi);
     if (use_sys_lock) {
         if ((result=fcfs_api_dentry_sys_lock(&session, fi->dentry.inode,
                         0, &old_size, &space_end)) != 0)
@@ -433,7 +641,7 @@ int fcfs_api_write_ex(FCFSAPIFileInfo *fi, const char *buff,
     return result;
 }
 
-int fcfs_api_pread_ex(FCFSAPIFileInfo *fi, char *buff, const int size,
+static int do_pread(FCFSAPIFileInfo *fi, char *buff, const int size,
         const int64_t offset, int *read_bytes, const int64_t tid)
 {
     FSAPIOperationContext op_ctx;
@@ -455,6 +663,10 @@ int fcfs_api_pread_ex(FCFSAPIFileInfo *fi, char *buff, const int size,
         return EBADF;
     }
 
+    if (fi->wbehind != NULL) {
+        write_behind_flush_range(fi->wbehind, offset, size);
+    }
+
     FS_API_SET_CTX_AND_TID_EX(op_ctx, fi->ctx->contexts.fsapi, tid);
     fs_set_block_slice(&op_ctx.bs_key, fi->dentry.inode, offset, size);
     while (1) {
@@ -525,6 +737,21 @@ int fcfs_api_pread_ex(FCFSAPIFileInfo *fi, char *buff, const int size,
     return result;
 }
 
+int fcfs_api_pread_ex(FCFSAPIFileInfo *fi, char *buff, const int size,
+        const int64_t offset, int *read_bytes, const int64_t tid)
+{
+    int result;
+    bool traced;
+    int64_t start_time;
+
+    traced = trace_sample_begin(fi->ctx, &start_time);
+    result = do_pread(fi, buff, size, offset, read_bytes, tid);
+    if (traced) {
+        trace_sample_end("api_pread", start_time);
+    }
+    return result;
+}
+
 int fcfs_api_read_ex(FCFSAPIFileInfo *fi, char *buff, const int size,
         int *read_bytes, const int64_t tid)
 {
@@ -717,16 +944,88 @@ static int file_truncate(FCFSAPIContext *ctx, const int64_t oid,
     return check_and_sys_unlock(ctx, &session, old_size, &dsize, result);
 }
 
+int fcfs_api_flush_ex(FCFSAPIFileInfo *fi, const int64_t tid)
+{
+    int result;
+
+    if (fi->magic != FCFS_API_MAGIC_NUMBER) {
+        return EBADF;
+    }
+
+    if (!((fi->flags & O_WRONLY) || (fi->flags & O_RDWR))) {
+        return 0;
+    }
+
+    if (fi->wbehind != NULL) {
+        if ((result=write_behind_sync(fi->wbehind)) != 0) {
+            return result;
+        }
+    }
+
+    return fs_api_flush_file(fi->ctx->contexts.fsapi, fi->dentry.inode,
+            fi->dentry.stat.size, tid);
+}
+
+int fcfs_api_fsync_ex(FCFSAPIFileInfo *fi, const int64_t tid)
+{
+    FDIRDEntryInfo dentry;
+    int64_t file_size;
+    int result;
+
+    if (fi->magic != FCFS_API_MAGIC_NUMBER) {
+        return EBADF;
+    }
+
+    if (fi->wbehind != NULL) {
+        if ((result=write_behind_sync(fi->wbehind)) != 0) {
+            return result;
+        }
+    }
+
+    /* the file maybe extended by other handles */
+    if ((result=fcfs_api_stat_dentry_by_inode_ex(fi->ctx,
+                    fi->dentry.inode, &dentry)) != 0)
+    {
+        return result;
+    }
+    file_size = FC_MAX(dentry.stat.size, fi->dentry.stat.size);
+
+    if ((result=fs_api_commit_file(fi->ctx->contexts.fsapi,
+                    fi->dentry.inode, file_size, tid)) != 0)
+    {
+        return result;
+    }
+
+    if (fi->ctx->async_report.enabled) {
+        /* the size reported by the combined slices just written */
+        inode_htable_check_conflict_and_wait(fi->dentry.inode);
+    }
+    return 0;
+}
+
 int fcfs_api_ftruncate_ex(FCFSAPIFileInfo *fi, const int64_t new_size,
         const int64_t tid)
 {
+    int result;
+
     if (fi->magic != FCFS_API_MAGIC_NUMBER || !((fi->flags & O_WRONLY) ||
                 (fi->flags & O_RDWR)))
     {
         return EBADF;
     }
 
-    return file_truncate(fi->ctx, fi->dentry.inode, new_size, tid);
+    if (fi->wbehind == NULL) {
+        return file_truncate(fi->ctx, fi->dentry.inode, new_size, tid);
+    }
+
+    write_behind_flush_range(fi->wbehind, 0, INT64_MAX);
+    if ((result=file_truncate(fi->ctx, fi->dentry.inode,
+                    new_size, tid)) == 0)
+    {
+        write_behind_set_file_size(fi->wbehind, new_size);
+        fi->dentry.stat.size = new_size;
+    }
+    return result;
 }
 
 static int get_regular_file_inode(FCFSAPIContext *ctx, const char *path,
@@ -821,6 +1120,10 @@ static inline int calc_file_offset_ex(FCFSAPIFileInfo *fi,
                 {
                     return result;
                 }
+                if (fi->wbehind != NULL) {
+                    fi->dentry.stat.size = FC_MAX(fi->dentry.stat.size,
+                            write_behind_file_size(fi->wbehind));
+                }
             }
 
             *new_offset = fi->dentry.stat.size + offset;
@@ -837,6 +1140,70 @@ static inline int calc_file_offset_ex(FCFSAPIFileInfo *fi,
     return 0;
 }
 
+static inline int block_slice_size(const int64_t offset, const int64_t size)
+{
+    int64_t remain;
+
+    remain = FS_FILE_BLOCK_SIZE - offset % FS_FILE_BLOCK_SIZE;
+    return (size < remain) ? size : remain;
+}
+
+/* find the data or hole by the object block index of the data servers,
+ * the end of file is a hole as linux */
+static int seek_data_or_hole(FCFSAPIFileInfo *fi, const int64_t offset,
+        const int whence, int64_t *new_offset)
+{
+    FSAPIOperationContext op_ctx;
+    int64_t file_size;
+    int64_t remain;
+    int slice_offset;
+    int result;
+
+    if (fi->wbehind != NULL) {
+        write_behind_flush_range(fi->wbehind, 0, INT64_MAX);
+    }
+
+    if ((result=fcfs_api_stat_dentry_by_inode_ex(fi->ctx,
+                    fi->dentry.inode, &fi->dentry)) != 0)
+    {
+        return result;
+    }
+
+    file_size = fi->dentry.stat.size;
+    if (offset < 0 || offset >= file_size) {
+        return ENXIO;
+    }
+
+    FS_API_SET_CTX_AND_TID_EX(op_ctx, fi->ctx->contexts.fsapi, fi->tid);
+    fs_set_block_slice(&op_ctx.bs_key, fi->dentry.inode, offset,
+            block_slice_size(offset, file_size - offset));
+    while (1) {
+        if ((result=fs_api_slice_seek(&op_ctx, whence,
+                        &slice_offset)) == 0)
+        {
+            *new_offset = op_ctx.bs_key.block.offset + slice_offset;
+            return 0;
+        } else if (result != ENXIO) {
+            return result;
+        }
+
+        remain = file_size - (op_ctx.bs_key.block.offset +
+                FS_FILE_BLOCK_SIZE);
+        if (remain <= 0) {
+            break;
+        }
+        fs_next_block_slice_key(&op_ctx.bs_key,
+                block_slice_size(0, remain));
+    }
+
+    if (whence == SEEK_HOLE) {
+        *new_offset = file_size;
+        return 0;
+    } else {
+        return ENXIO;
+    }
+}
+
 int fcfs_api_lseek(FCFSAPIFileInfo *fi, const int64_t offset, const int whence)
 {
     int64_t new_offset;
@@ -846,9 +1213,12 @@ int fcfs_api_lseek(FCFSAPIFileInfo *fi, const int64_t offset, const int whence)
         return EBADF;
     }
 
-    if ((result=calc_file_offset_ex(fi, offset, whence,
-                    true, &new_offset)) != 0)
-    {
+    if (whence == SEEK_DATA || whence == SEEK_HOLE) {
+        result = seek_data_or_hole(fi, offset, whence, &new_offset);
+    } else {
+        result = calc_file_offset_ex(fi, offset, whence, true, &new_offset);
+    }
+    if (result != 0) {
         return result;
     }
 
@@ -862,8 +1232,18 @@ static void fill_stat(const FDIRDEntryInfo *dentry, struct stat *buf)
     buf->st_ino = dentry->inode;
     buf->st_mode = dentry->stat.mode;
     buf->st_size = dentry->stat.size;
+    buf->st_atime = dentry->stat.atime;
     buf->st_mtime = dentry->stat.mtime;
     buf->st_ctime = dentry->stat.ctime;
+    buf->st_uid = dentry->stat.uid;
+    buf->st_gid = dentry->stat.gid;
+    buf->st_nlink = dentry->stat.nlink;
+
+    buf->st_blksize = 512;
+    if (dentry->stat.alloc > 0) {
+        buf->st_blocks = (dentry->stat.alloc + buf->st_blksize - 1) /
+            buf->st_blksize;
+    }
 }
 
 int fcfs_api_fstat(FCFSAPIFileInfo *fi, struct stat *buf)
@@ -880,6 +1260,10 @@ int fcfs_api_fstat(FCFSAPIFileInfo *fi, struct stat *buf)
         return result;
     }
 
+    if (fi->wbehind != NULL) {
+        fi->dentry.stat.size = FC_MAX(fi->dentry.stat.size,
+                write_behind_file_size(fi->wbehind));
+    }
     fill_stat(&fi->dentry, buf);
     return 0;
 }
@@ -1138,6 +1522,10 @@ int fcfs_api_fallocate_ex(FCFSAPIFileInfo *fi, const int mode,
         return 0;
     }
 
+    if (fi->wbehind != NULL) {
+        write_behind_flush_range(fi->wbehind, 0, INT64_MAX);
+    }
+
     if (fi->ctx->use_sys_lock_for_append && !fi->ctx->async_report.enabled) {
         if ((result=fcfs_api_dentry_sys_lock(&session, fi->dentry.
                         inode, 0, &old_size, &space_end)) != 0)
@@ -1185,7 +1573,251 @@ int fcfs_api_fallocate_ex(FCFSAPIFileInfo *fi, const int mode,
     if (dsize.inc_alloc != 0)  {
         dsize.flags |= FDIR_DENTRY_FIELD_MODIFIED_FLAG_INC_ALLOC;
     }
-    return check_and_sys_unlock(fi->ctx, &session, old_size, &dsize, result);
+
+    result = check_and_sys_unlock(fi->ctx, &session,
+            old_size, &dsize, result);
+    if (result == 0 && fi->wbehind != NULL && (dsize.flags &
+                FDIR_DENTRY_FIELD_MODIFIED_FLAG_FILE_SIZE))
+    {
+        write_behind_set_file_size(fi->wbehind, dsize.file_size);
+    }
+    return result;
+}
+
+static int copy_piece(FCFSAPIFileInfo *fi_in, const int64_t off_in,
+        FCFSAPIFileInfo *fi_out, const int64_t off_out, const int length,
+        char **buff, int *inc_alloc, const int64_t tid)
+{
+    FSAPIOperationContext op_ctx;
+    FSBlockSliceKeyInfo src_bs_key;
+    FSClientContext *fs;
+    int read_bytes;
+    int written_bytes;
+    int result;
+
+    FS_API_SET_CTX_AND_TID_EX(op_ctx, fi_out->ctx->contexts.fsapi, tid);
+    fs_set_block_slice(&src_bs_key, fi_in->dentry.inode, off_in, length);
+    fs_set_block_slice(&op_ctx.bs_key, fi_out->dentry.inode,
+            off_out, length);
+
+    /* share the trunk space when both blocks in the same data group */
+    fs = fi_out->ctx->contexts.fsapi->fs;
+    if (FS_CLIENT_DATA_GROUP_INDEX(fs, src_bs_key.block.hash_code) ==
+            FS_CLIENT_DATA_GROUP_INDEX(fs, op_ctx.bs_key.block.hash_code))
+    {
+        if ((result=fs_api_slice_clone(&op_ctx, &src_bs_key,
+                        inc_alloc)) != EXDEV)
+        {
+            return result;
+        }
+    }
+
+    if (*buff == NULL) {
+        if ((*buff=(char *)fc_malloc(FS_FILE_BLOCK_SIZE)) == NULL) {
+            return ENOMEM;
+        }
+    }
+
+    if ((result=do_pread(fi_in, *buff, length, off_in,
+                    &read_bytes, tid)) != 0)
+    {
+        return result;
+    }
+    if (read_bytes < length) {
+        memset(*buff + read_bytes, 0, length - read_bytes);
+    }
+
+    if ((result=do_pwrite(fi_out, *buff, length, off_out, &written_bytes,
+                    inc_alloc, false, tid)) != 0)
+    {
+        return result;
+    }
+    return (written_bytes == length) ? 0 : EIO;
+}
+
+int fcfs_api_copy_file_range_ex(FCFSAPIFileInfo *fi_in,
+        const int64_t off_in, FCFSAPIFileInfo *fi_out,
+        const int64_t off_out, const int64_t length,
+        int64_t *copied_bytes, const int64_t tid)
+{
+    FDIRClientSession session;
+    FDIRSetDEntrySizeInfo dsize;
+    char *buff;
+    int64_t old_size;
+    int64_t space_end;
+    int64_t remain;
+    int64_t in_offset;
+    int64_t out_offset;
+    int piece;
+    int in_left;
+    int out_left;
+    int inc_alloc;
+    int result;
+
+    *copied_bytes = 0;
+    if (off_in < 0 || off_out < 0 || length < 0) {
+        return EINVAL;
+    }
+
+    if (fi_in->magic != FCFS_API_MAGIC_NUMBER ||
+            fi_out->magic != FCFS_API_MAGIC_NUMBER ||
+            (fi_in->flags & O_WRONLY) || (fi_out->flags & O_APPEND) ||
+            (fi_out->flags & (O_WRONLY | O_RDWR)) == 0)
+    {
+        return EBADF;
+    }
+
+    if (fi_in->dentry.inode == fi_out->dentry.inode &&
+            off_in < off_out + length && off_out < off_in + length)
+    {
+        return EINVAL;
+    }
+
+    if (length == 0) {
+        return 0;
+    }
+
+    /* the servers must see all data written by the handles */
+    if (fi_in->wbehind != NULL) {
+        write_behind_flush_range(fi_in->wbehind, 0, INT64_MAX);
+    }
+    if (fi_out->wbehind != NULL) {
+        write_behind_flush_range(fi_out->wbehind, 0, INT64_MAX);
+    }
+    if ((result=fs_api_flush_file(fi_in->ctx->contexts.fsapi, fi_in->
+                    dentry.inode, fi_in->dentry.stat.size, tid)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=fcfs_api_stat_dentry_by_inode_ex(fi_in->ctx,
+                    fi_in->dentry.inode, &fi_in->dentry)) != 0)
+    {
+        return result;
+    }
+    if (off_in >= fi_in->dentry.stat.size) {
+        return 0;
+    }
+    remain = FC_MIN(length, fi_in->dentry.stat.size - off_in);
+
+    if ((result=check_and_sys_lock(fi_out->ctx, &session, fi_out->
+                    dentry.inode, &old_size, &space_end)) != 0)
+    {
+        return result;
+    }
+
+    buff = NULL;
+    dsize.inc_alloc = 0;
+    in_offset = off_in;
+    out_offset = off_out;
+    while (remain > 0) {
+        /* the piece must be within one block of both files */
+        in_left = FS_FILE_BLOCK_SIZE - in_offset % FS_FILE_BLOCK_SIZE;
+        out_left = FS_FILE_BLOCK_SIZE - out_offset % FS_FILE_BLOCK_SIZE;
+        piece = FC_MIN(in_left, out_left);
+        if (piece > remain) {
+            piece = remain;
+        }
+
+        inc_alloc = 0;
+        if ((result=copy_piece(fi_in, in_offset, fi_out, out_offset,
+                        piece, &buff, &inc_alloc, tid)) != 0)
+        {
+            break;
+        }
+
+        dsize.inc_alloc += inc_alloc;
+        *copied_bytes += piece;
+        in_offset += piece;
+        out_offset += piece;
+        remain -= piece;
+    }
+
+    if (buff != NULL) {
+        free(buff);
+    }
+    if (fi_out->wbehind != NULL) {
+        write_behind_flush_range(fi_out->wbehind, off_out, *copied_bytes);
+    }
+
+    /* report the copied part even if the rest failed */
+    if (*copied_bytes > 0) {
+        result = 0;
+    }
+    dsize.inode = fi_out->dentry.inode;
+    dsize.file_size = off_out + *copied_bytes;
+    dsize.force = true;
+    dsize.flags = FDIR_DENTRY_FIELD_MODIFIED_FLAG_MTIME;
+    if (dsize.file_size > old_size) {
+        dsize.flags |= FDIR_DENTRY_FIELD_MODIFIED_FLAG_FILE_SIZE;
+    } else {
+        dsize.file_size = old_size;
+    }
+    if (off_out + *copied_bytes > space_end) {
+        dsize.flags |= FDIR_DENTRY_FIELD_MODIFIED_FLAG_SPACE_END;
+    }
+    if (dsize.inc_alloc != 0)  {
+        dsize.flags |= FDIR_DENTRY_FIELD_MODIFIED_FLAG_INC_ALLOC;
+    }
+
+    result = check_and_sys_unlock(fi_out->ctx, &session,
+            old_size, &dsize, result);
+    if (result == 0 && (dsize.flags &
+                FDIR_DENTRY_FIELD_MODIFIED_FLAG_FILE_SIZE))
+    {
+        fi_out->dentry.stat.size = dsize.file_size;
+        if (fi_out->wbehind != NULL) {
+            write_behind_set_file_size(fi_out->wbehind, dsize.file_size);
+        }
+    }
+    return result;
+}
+
+int fcfs_api_clone_file_ex(FCFSAPIContext *ctx, const char *src_path,
+        const char *dest_path, const FCFSAPIFileContext *fctx)
+{
+    FCFSAPIFileInfo fi_in;
+    FCFSAPIFileInfo fi_out;
+    FDIRDEntryFullName fullname;
+    FDIRDEntryInfo dentry;
+    int64_t copied_bytes;
+    int inode_align;
+    int result;
+
+    if ((result=fcfs_api_open_ex(ctx, &fi_in, src_path,
+                    O_RDONLY, fctx)) != 0)
+    {
+        return result;
+    }
+
+    if (!S_ISREG(fi_in.dentry.stat.mode)) {
+        fcfs_api_close(&fi_in);
+        return EINVAL;
+    }
+
+    /* the blocks of the same offset in the same data group */
+    inode_align = FS_DATA_GROUP_COUNT(*ctx->contexts.fsapi->
+            fs->cluster_cfg.ptr);
+    fullname.ns = ctx->ns;
+    FC_SET_STRING(fullname.path, (char *)dest_path);
+    if ((result=fdir_client_clone_dentry(ctx->contexts.fdir,
+                    fi_in.dentry.inode, inode_align, &fullname,
+                    &fctx->omp, &dentry)) != 0)
+    {
+        fcfs_api_close(&fi_in);
+        return result;
+    }
+
+    if ((result=fcfs_api_open_by_dentry_ex(ctx, &fi_out,
+                    &dentry, O_WRONLY, fctx)) == 0)
+    {
+        result = fcfs_api_copy_file_range_ex(&fi_in, 0, &fi_out, 0,
+                INT64_MAX, &copied_bytes, fctx->tid);
+        fcfs_api_close(&fi_out);
+    }
+
+    fcfs_api_close(&fi_in);
+    return result;
 }
 
 int fcfs_api_rename_ex(FCFSAPIContext *ctx, const char *old_path,
@@ -59,6 +59,10 @@ extern "C" {
 #define fcfs_api_pread(fi, buff, size, offset, read_bytes)  \
     fcfs_api_pread_ex(fi, buff, size, offset, read_bytes, (fi)->tid)
 
+#define fcfs_api_flush(fi)  fcfs_api_flush_ex(fi, (fi)->tid)
+
+#define fcfs_api_fsync(fi)  fcfs_api_fsync_ex(fi, (fi)->tid)
+
 #define fcfs_api_ftruncate(fi, new_size) \
     fcfs_api_ftruncate_ex(fi, new_size, getpid())
 
@@ -74,6 +78,9 @@ extern "C" {
 #define fcfs_api_rename(old_path, new_path, fctx)  \
     fcfs_api_rename_ex(&g_fcfs_api_ctx, old_path, new_path, 0, fctx)
 
+#define fcfs_api_clone_file(src_path, dest_path, fctx)  \
+    fcfs_api_clone_file_ex(&g_fcfs_api_ctx, src_path, dest_path, fctx)
+
 #define fcfs_api_statvfs(path, stbuf)  \
     fcfs_api_statvfs_ex(&g_fcfs_api_ctx, path, stbuf)
 
@@ -114,6 +121,12 @@ extern "C" {
     int fcfs_api_read_ex(FCFSAPIFileInfo *fi, char *buff,
             const int size, int *read_bytes, const int64_t tid);
 
+    /* write the combined slices written by this file handle */
+    int fcfs_api_flush_ex(FCFSAPIFileInfo *fi, const int64_t tid);
+
+    /* persist the written data of the file by all handles */
+    int fcfs_api_fsync_ex(FCFSAPIFileInfo *fi, const int64_t tid);
+
     int fcfs_api_ftruncate_ex(FCFSAPIFileInfo *fi, const int64_t new_size,
             const int64_t tid);
 
@@ -123,9 +136,23 @@ extern "C" {
     int fcfs_api_fallocate_ex(FCFSAPIFileInfo *fi, const int mode,
             const int64_t offset, const int64_t len, const int64_t tid);
 
+    /* copy the range without data transfer when the blocks of the source
+     * and the dest in the same data group, the slices share the space.
+     * copied_bytes is less than length when reach the end of fi_in */
+    int fcfs_api_copy_file_range_ex(FCFSAPIFileInfo *fi_in,
+            const int64_t off_in, FCFSAPIFileInfo *fi_out,
+            const int64_t off_out, const int64_t length,
+            int64_t *copied_bytes, const int64_t tid);
+
+    /* create dest_path which shares all data space of src_path */
+    int fcfs_api_clone_file_ex(FCFSAPIContext *ctx, const char *src_path,
+            const char *dest_path, const FCFSAPIFileContext *fctx);
+
     int fcfs_api_unlink_ex(FCFSAPIContext *ctx, const char *path,
             const FCFSAPIFileContext *fctx);
 
+    /* whence: SEEK_SET, SEEK_CUR, SEEK_END, SEEK_DATA or SEEK_HOLE,
+     * return ENXIO when no data / hole after the offset */
     int fcfs_api_lseek(FCFSAPIFileInfo *fi, const int64_t offset, const int whence);
 
     int fcfs_api_fstat(FCFSAPIFileInfo *fi, struct stat *buf);
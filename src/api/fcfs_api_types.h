@@ -32,6 +32,10 @@ typedef struct fcfs_api_opendir_session {
 
 typedef struct fcfs_api_context {
     bool use_sys_lock_for_append;
+    struct {
+        bool enabled;  //reserve the append range by FastDIR
+        bool batch;    //combine the reservations of the concurrent writers
+    } append_reserve;
     struct {
         bool enabled;
         int interval_ms;
@@ -39,6 +43,18 @@ typedef struct fcfs_api_context {
         int hashtable_sharding_count;
         int64_t hashtable_total_capacity;
     } async_report;
+    struct {
+        bool enabled;
+        int slice_size;       //the chunk size for flush
+        int flush_threads;
+        int dirty_expire_ms;
+        int64_t file_dirty_limit;
+        int64_t max_dirty_memory;
+    } write_behind;
+    struct {
+        int sample_interval;  //trace one of every N reads / writes
+        volatile int64_t counter;
+    } trace;
     string_t ns;  //namespace
     char ns_holder[NAME_MAX];
     struct {
@@ -49,6 +65,25 @@ typedef struct fcfs_api_context {
     struct fast_mblock_man opendir_session_pool;
 } FCFSAPIContext;
 
+struct fcfs_api_write_behind;
+
+typedef struct fcfs_api_append_reserve_waiter {
+    int64_t length;
+    int64_t offset;
+    int result;
+    bool done;
+    struct fcfs_api_append_reserve_waiter *next;
+} FCFSAPIAppendReserveWaiter;
+
+/* the waiters arrived during the reservation in progress are
+ * combined into one request by the next leader */
+typedef struct fcfs_api_append_reserver {
+    pthread_lock_cond_pair_t lcp;
+    bool in_progress;
+    FCFSAPIAppendReserveWaiter *head;
+    FCFSAPIAppendReserveWaiter *tail;
+} FCFSAPIAppendReserver;
+
 typedef struct fcfs_api_file_info {
     FCFSAPIContext *ctx;
     int64_t tid;
@@ -56,6 +91,8 @@ typedef struct fcfs_api_file_info {
         FDIRClientSession flock;
         FCFSAPIOpendirSession *opendir;
     } sessions;
+    struct fcfs_api_write_behind *wbehind;  //NULL for write through
+    FCFSAPIAppendReserver *reserver;  //for batch append reserve
     FDIRDEntryInfo dentry;
     int flags;
     int magic;
@@ -19,6 +19,7 @@
 #include "fastcommon/logger.h"
 #include "fastcommon/sockopt.h"
 #include "fastcommon/sched_thread.h"
+#include "async_unlinker.h"
 #include "fcfs_api_util.h"
 
 int fcfs_api_remove_dentry_by_pname_ex(FCFSAPIContext *ctx,
@@ -77,3 +78,109 @@ int fcfs_api_rename_dentry_by_pname_ex(FCFSAPIContext *ctx,
     }
     return result;
 }
+
+int fcfs_api_subtree_ops_ex(FCFSAPIContext *ctx, FDIRClientSubtreeOp *op,
+        fcfs_api_subtree_progress_callback callback, void *args)
+{
+    int result;
+
+    if (op->limit <= 0) {
+        op->limit = FDIR_SUBTREE_OPS_DEFAULT_LIMIT;
+    }
+
+    op->cursor_len = 0;
+    do {
+        if ((result=fdir_client_subtree_ops(ctx->contexts.fdir,
+                        &ctx->ns, op)) != 0)
+        {
+            break;
+        }
+
+        //the freed files are moved to the trash of FastDIR
+        if (op->op_type == FDIR_SUBTREE_OP_REMOVE && op->file_count > 0) {
+            async_unlinker_notify();
+        }
+        if (callback != NULL && (result=callback(op, args)) != 0) {
+            break;
+        }
+    } while (!op->finished);
+
+    return result;
+}
+
+int fcfs_api_remove_subtree_ex(FCFSAPIContext *ctx, const char *path,
+        fcfs_api_subtree_progress_callback callback, void *args,
+        const FCFSAPIFileContext *fctx)
+{
+    FDIRClientSubtreeOp op;
+    int result;
+
+    memset(&op, 0, sizeof(op));
+    if ((result=fcfs_api_lookup_inode_by_path_ex(ctx,
+                    path, LOG_DEBUG, &op.inode)) != 0)
+    {
+        return result;
+    }
+
+    op.op_type = FDIR_SUBTREE_OP_REMOVE;
+    return fcfs_api_subtree_ops_ex(ctx, &op, callback, args);
+}
+
+static int sum_subtree_callback(const FDIRClientSubtreeOp *op, void *args)
+{
+    FDIRSubtreeSummary *summary;
+
+    summary = (FDIRSubtreeSummary *)args;
+    summary->files += op->summary.files;
+    summary->dirs += op->summary.dirs;
+    summary->bytes += op->summary.bytes;
+    summary->alloc += op->summary.alloc;
+    return 0;
+}
+
+int fcfs_api_summarize_subtree_ex(FCFSAPIContext *ctx,
+        const char *path, FDIRSubtreeSummary *summary)
+{
+    FDIRClientSubtreeOp op;
+    int result;
+
+    memset(summary, 0, sizeof(*summary));
+    memset(&op, 0, sizeof(op));
+    if ((result=fcfs_api_lookup_inode_by_path_ex(ctx,
+                    path, LOG_DEBUG, &op.inode)) != 0)
+    {
+        return result;
+    }
+
+    op.op_type = FDIR_SUBTREE_OP_SUMMARY;
+    return fcfs_api_subtree_ops_ex(ctx, &op,
+            sum_subtree_callback, summary);
+}
+
+int fcfs_api_modify_subtree_stat_ex(FCFSAPIContext *ctx, const char *path,
+        const FDIRDEntryStatus *stat, const int64_t flags,
+        fcfs_api_subtree_progress_callback callback, void *args)
+{
+    FDIRClientSubtreeOp op;
+    FDIRStatModifyFlags mflags;
+    int result;
+
+    mflags.flags = flags;
+    if (!(mflags.mode || mflags.uid || mflags.gid)) {
+        return EINVAL;
+    }
+
+    memset(&op, 0, sizeof(op));
+    if ((result=fcfs_api_lookup_inode_by_path_ex(ctx,
+                    path, LOG_DEBUG, &op.inode)) != 0)
+    {
+        return result;
+    }
+
+    mflags.ctime = 1;
+    op.op_type = FDIR_SUBTREE_OP_MODIFY_STAT;
+    op.flags = mflags.flags;
+    op.stat = *stat;
+    op.stat.ctime = get_current_time();
+    return fcfs_api_subtree_ops_ex(ctx, &op, callback, args);
+}
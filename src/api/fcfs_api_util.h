@@ -21,6 +21,11 @@
 #include "fcfs_api_types.h"
 #include "inode_htable.h"
 
+/* called after every batch of the subtree operation for the progress,
+ * return non-zero to abort the remain batches */
+typedef int (*fcfs_api_subtree_progress_callback)(
+        const FDIRClientSubtreeOp *op, void *args);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -49,6 +54,11 @@ extern "C" {
     fcfs_api_create_dentry_by_pname_ex(&g_fcfs_api_ctx, \
             parent_inode, name, omp, dentry)
 
+#define fcfs_api_batch_create_dentry_by_pname(pnames, omps, \
+        count, dentries, results)  \
+    fcfs_api_batch_create_dentry_by_pname_ex(&g_fcfs_api_ctx, \
+            pnames, omps, count, dentries, results)
+
 #define fcfs_api_symlink_dentry_by_pname(link, parent_inode, name, omp, dentry) \
     fcfs_api_symlink_dentry_by_pname_ex(&g_fcfs_api_ctx, link, \
             parent_inode, name, omp, dentry)
@@ -74,6 +84,16 @@ extern "C" {
     fcfs_api_rename_dentry_by_pname_ex(&g_fcfs_api_ctx, src_parent_inode, \
             src_name, dest_parent_inode, dest_name, flags, fctx)
 
+#define fcfs_api_remove_subtree(path, callback, args, fctx)  \
+    fcfs_api_remove_subtree_ex(&g_fcfs_api_ctx, path, callback, args, fctx)
+
+#define fcfs_api_summarize_subtree(path, summary)  \
+    fcfs_api_summarize_subtree_ex(&g_fcfs_api_ctx, path, summary)
+
+#define fcfs_api_modify_subtree_stat(path, stat, flags, callback, args)  \
+    fcfs_api_modify_subtree_stat_ex(&g_fcfs_api_ctx, path, \
+            stat, flags, callback, args)
+
 #define fcfs_api_modify_dentry_stat(inode, attr, flags, dentry)  \
     fcfs_api_modify_dentry_stat_ex(&g_fcfs_api_ctx, inode, attr, flags, dentry)
 
@@ -179,6 +199,15 @@ static inline int fcfs_api_create_dentry_by_pname_ex(FCFSAPIContext *ctx,
             &ctx->ns, &pname, omp, dentry);
 }
 
+static inline int fcfs_api_batch_create_dentry_by_pname_ex(
+        FCFSAPIContext *ctx, const FDIRDEntryPName *pnames,
+        const FDIRClientOwnerModePair *omps, const int count,
+        FDIRDEntryInfo *dentries, int *results)
+{
+    return fdir_client_batch_create_dentry_by_pname(ctx->contexts.fdir,
+            &ctx->ns, pnames, omps, count, dentries, results);
+}
+
 static inline int fcfs_api_symlink_dentry_by_pname_ex(FCFSAPIContext *ctx,
         const string_t *link, const int64_t parent_inode,
         const string_t *name, const FDIRClientOwnerModePair *omp,
@@ -216,6 +245,28 @@ int fcfs_api_rename_dentry_by_pname_ex(FCFSAPIContext *ctx,
         const int64_t dest_parent_inode, const string_t *dest_name,
         const int flags, const FCFSAPIFileContext *fctx);
 
+/* the subtree is dealt by FastDIR in batches of op->limit entries,
+ * the callback can be NULL */
+int fcfs_api_subtree_ops_ex(FCFSAPIContext *ctx, FDIRClientSubtreeOp *op,
+        fcfs_api_subtree_progress_callback callback, void *args);
+
+/* remove the path and all of its descendants like rm -rf, the removed
+ * files are moved to the trash of FastDIR, and their data is deleted
+ * from faststore asynchronously by the async unlinker */
+int fcfs_api_remove_subtree_ex(FCFSAPIContext *ctx, const char *path,
+        fcfs_api_subtree_progress_callback callback, void *args,
+        const FCFSAPIFileContext *fctx);
+
+/* the file, directory and space usage of the path like du */
+int fcfs_api_summarize_subtree_ex(FCFSAPIContext *ctx,
+        const char *path, FDIRSubtreeSummary *summary);
+
+/* modify mode, uid and / or gid of the path and all of its descendants
+ * like chmod -R or chown -R, flags: FDIRStatModifyFlags */
+int fcfs_api_modify_subtree_stat_ex(FCFSAPIContext *ctx, const char *path,
+        const FDIRDEntryStatus *stat, const int64_t flags,
+        fcfs_api_subtree_progress_callback callback, void *args);
+
 static inline int fcfs_api_modify_dentry_stat_ex(FCFSAPIContext *ctx,
         const int64_t inode, const struct stat *attr, const int64_t flags,
         FDIRDEntryInfo *dentry)
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "fastcommon/logger.h"
+#include "fastcfs/fcfs_api.h"
+
+#define MAX_NAME_COUNT  1024
+
+static FDIRDEntryPName pnames[MAX_NAME_COUNT];
+static FDIRClientOwnerModePair omps[MAX_NAME_COUNT];
+static FDIRDEntryInfo dentries[MAX_NAME_COUNT];
+static int results[MAX_NAME_COUNT];
+static char names[MAX_NAME_COUNT][32];
+
+static void usage(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [-c config_filename] "
+            "[-n namespace=fs] [-C count=300] <dir path>\n\n"
+            "create the files in the empty directory in batch twice, "
+            "the second batch MUST fail\nwith EEXIST for the existing "
+            "names and ENOTDIR for the file parent\n\n", argv[0]);
+}
+
+static void set_pname(const int index, const int64_t parent_inode,
+        const char *prefix, const int n)
+{
+    string_t name;
+
+    name.str = names[index];
+    name.len = sprintf(names[index], "%s%d", prefix, n);
+    FDIR_SET_DENTRY_PNAME_PTR(pnames + index, parent_inode, &name);
+    omps[index].mode = S_IFREG | 0644;
+    omps[index].uid = geteuid();
+    omps[index].gid = getegid();
+}
+
+static int check_results(const char *caption, const int count,
+        const int *expects)
+{
+    int i;
+    int fail_count;
+
+    fail_count = 0;
+    for (i=0; i<count; i++) {
+        if (results[i] != expects[i]) {
+            fprintf(stderr, "%s, name: %s, errno: %d != expected: %d\n",
+                    caption, names[i], results[i], expects[i]);
+            fail_count++;
+        } else if (results[i] == 0 && dentries[i].inode == 0) {
+            fprintf(stderr, "%s, name: %s, the inode is 0\n",
+                    caption, names[i]);
+            fail_count++;
+        }
+    }
+
+    printf("%s, operation count: %d, fail count: %d\n",
+            caption, count, fail_count);
+    return fail_count == 0 ? 0 : EINVAL;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *config_filename = "/etc/fastcfs/fcfs/fuse.conf";
+    char *ns = "fs";
+    char *path;
+    int expects[MAX_NAME_COUNT];
+    int64_t dir_inode;
+    int64_t file_inode;
+    int count = 300;
+    int ch;
+    int i;
+    int index;
+    int result;
+
+    if (argc < 2) {
+        usage(argv);
+        return 1;
+    }
+
+    while ((ch=getopt(argc, argv, "hc:n:C:")) != -1) {
+        switch (ch) {
+            case 'h':
+                usage(argv);
+                return 0;
+            case 'c':
+                config_filename = optarg;
+                break;
+            case 'n':
+                ns = optarg;
+                break;
+            case 'C':
+                count = strtol(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv);
+                return 1;
+        }
+    }
+
+    if (optind >= argc) {
+        usage(argv);
+        return 1;
+    }
+    if (count <= 0 || count + 2 > MAX_NAME_COUNT) {
+        fprintf(stderr, "invalid count: %d, which <= 0 or > %d\n",
+                count, MAX_NAME_COUNT - 2);
+        return 1;
+    }
+
+    log_init();
+    path = argv[optind];
+    if ((result=fcfs_api_pooled_init(ns, config_filename)) != 0) {
+        return result;
+    }
+    if ((result=fcfs_api_start()) != 0) {
+        return result;
+    }
+
+    if ((result=fcfs_api_lookup_inode_by_path(path, &dir_inode)) != 0) {
+        fprintf(stderr, "lookup path %s fail, errno: %d, error info: %s\n",
+                path, result, STRERROR(result));
+        return result;
+    }
+
+    /* larger than one request for count > 256 */
+    for (i=0; i<count; i++) {
+        set_pname(i, dir_inode, "file-", i);
+        expects[i] = 0;
+    }
+    if ((result=fcfs_api_batch_create_dentry_by_pname(pnames, omps,
+                    count, dentries, results)) != 0)
+    {
+        fprintf(stderr, "batch create fail, errno: %d, error info: %s\n",
+                result, STRERROR(result));
+        return result;
+    }
+    if ((result=check_results("first batch", count, expects)) != 0) {
+        return result;
+    }
+    file_inode = dentries[0].inode;
+
+    /* the partial failure: the existing names and the parent which is
+     * not a directory fail, the others are created */
+    index = 0;
+    set_pname(index, dir_inode, "file-", 0);
+    expects[index++] = EEXIST;
+    set_pname(index, dir_inode, "new-", 0);
+    expects[index++] = 0;
+    set_pname(index, file_inode, "child-", 0);
+    expects[index++] = ENOTDIR;
+    set_pname(index, dir_inode, "file-", count - 1);
+    expects[index++] = EEXIST;
+    set_pname(index, dir_inode, "new-", 1);
+    expects[index++] = 0;
+    if ((result=fcfs_api_batch_create_dentry_by_pname(pnames, omps,
+                    index, dentries, results)) != 0)
+    {
+        fprintf(stderr, "batch create fail, errno: %d, error info: %s\n",
+                result, STRERROR(result));
+        return result;
+    }
+
+    return check_results("second batch", index, expects);
+}
@@ -0,0 +1,534 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "sf/sf_global.h"
+#include "fcfs_api_file.h"
+#include "write_behind.h"
+
+#define WB_CONFIG  g_write_behind_ctx.fcfs_api_ctx->write_behind
+
+WriteBehindContext g_write_behind_ctx;
+
+static inline FCFSAPIWBChunk *find_chunk(FCFSAPIWriteBehind *wb,
+        const int64_t offset)
+{
+    FCFSAPIWBChunk *chunk;
+
+    if (wb->current != NULL && wb->current->offset == offset) {
+        return wb->current;
+    }
+
+    fc_list_for_each_entry(chunk, &wb->chunks, dlink) {
+        if (chunk->offset == offset) {
+            return chunk;
+        }
+    }
+
+    return NULL;
+}
+
+static inline void push_to_flush(FCFSAPIWBChunk *chunk)
+{
+    chunk->flushing = true;
+    chunk->wb->flushing_count++;
+    if (chunk->wb->current == chunk) {
+        chunk->wb->current = NULL;
+    }
+    fc_queue_push(&g_write_behind_ctx.queue, chunk);
+}
+
+static void push_idle_to_flush(FCFSAPIWriteBehind *wb,
+        const int64_t expire_time_ms)
+{
+    FCFSAPIWBChunk *chunk;
+
+    if (wb->flushing_count == wb->chunk_count) {
+        return;
+    }
+
+    fc_list_for_each_entry(chunk, &wb->chunks, dlink) {
+        if (!chunk->flushing && chunk->create_time_ms <= expire_time_ms) {
+            push_to_flush(chunk);
+        }
+    }
+}
+
+#define push_all_to_flush(wb) push_idle_to_flush(wb, INT64_MAX)
+
+static inline bool reserve_dirty_memory()
+{
+    if (__sync_add_and_fetch(&g_write_behind_ctx.dirty_bytes,
+                WB_CONFIG.slice_size) <= WB_CONFIG.max_dirty_memory)
+    {
+        return true;
+    }
+
+    __sync_sub_and_fetch(&g_write_behind_ctx.dirty_bytes,
+            WB_CONFIG.slice_size);
+    return false;
+}
+
+static inline void release_dirty_memory()
+{
+    __sync_sub_and_fetch(&g_write_behind_ctx.dirty_bytes,
+            WB_CONFIG.slice_size);
+    if (__sync_add_and_fetch(&g_write_behind_ctx.waiting_count, 0) > 0) {
+        PTHREAD_MUTEX_LOCK(&g_write_behind_ctx.memory_lcp.lock);
+        pthread_cond_broadcast(&g_write_behind_ctx.memory_lcp.cond);
+        PTHREAD_MUTEX_UNLOCK(&g_write_behind_ctx.memory_lcp.lock);
+    }
+}
+
+static void wait_dirty_memory()
+{
+    struct timespec ts;
+    int64_t expire_ms;
+
+    __sync_add_and_fetch(&g_write_behind_ctx.waiting_count, 1);
+
+    /* notify the scanner to flush the dirty chunks of all files */
+    pthread_cond_signal(&g_write_behind_ctx.files.lcp.cond);
+
+    PTHREAD_MUTEX_LOCK(&g_write_behind_ctx.memory_lcp.lock);
+    if (__sync_add_and_fetch(&g_write_behind_ctx.dirty_bytes, 0) +
+            WB_CONFIG.slice_size > WB_CONFIG.max_dirty_memory)
+    {
+        expire_ms = get_current_time_ms() + 100;
+        ts.tv_sec = expire_ms / 1000;
+        ts.tv_nsec = (expire_ms % 1000) * 1000 * 1000;
+        pthread_cond_timedwait(&g_write_behind_ctx.memory_lcp.cond,
+                &g_write_behind_ctx.memory_lcp.lock, &ts);
+    }
+    PTHREAD_MUTEX_UNLOCK(&g_write_behind_ctx.memory_lcp.lock);
+
+    __sync_sub_and_fetch(&g_write_behind_ctx.waiting_count, 1);
+}
+
+static FCFSAPIWBChunk *alloc_chunk(FCFSAPIWriteBehind *wb,
+        const int64_t offset)
+{
+    FCFSAPIWBChunk *chunk;
+
+    chunk = (FCFSAPIWBChunk *)fast_mblock_alloc_object(
+            &g_write_behind_ctx.chunk_allocator);
+    if (chunk == NULL) {
+        return NULL;
+    }
+
+    chunk->wb = wb;
+    chunk->offset = offset;
+    chunk->flushing = false;
+    chunk->create_time_ms = get_current_time_ms();
+    fc_list_add_tail(&chunk->dlink, &wb->chunks);
+    wb->chunk_count++;
+    return chunk;
+}
+
+int write_behind_write(FCFSAPIWriteBehind *wb, const char *buff,
+        const int size, const int64_t offset)
+{
+    FCFSAPIWBChunk *chunk;
+    const char *src;
+    int64_t current_offset;
+    int64_t chunk_offset;
+    int remain;
+    int start;
+    int len;
+    int result;
+
+    result = 0;
+    src = buff;
+    current_offset = offset;
+    remain = size;
+    PTHREAD_MUTEX_LOCK(&wb->lcp.lock);
+    while (remain > 0) {
+        chunk_offset = current_offset & (~((int64_t)WB_CONFIG.slice_size - 1));
+        start = current_offset - chunk_offset;
+        len = FC_MIN(remain, WB_CONFIG.slice_size - start);
+        if ((chunk=find_chunk(wb, chunk_offset)) != NULL) {
+            if (chunk->flushing) {
+                pthread_cond_wait(&wb->lcp.cond, &wb->lcp.lock);
+                continue;
+            }
+
+            if (start > chunk->end || start + len < chunk->start) {
+                /* the dirty range of the chunk must be continuous */
+                push_to_flush(chunk);
+                pthread_cond_wait(&wb->lcp.cond, &wb->lcp.lock);
+                continue;
+            }
+
+            chunk->start = FC_MIN(chunk->start, start);
+            chunk->end = FC_MAX(chunk->end, start + len);
+        } else {
+            if ((int64_t)wb->chunk_count * WB_CONFIG.slice_size >=
+                    WB_CONFIG.file_dirty_limit)
+            {
+                push_all_to_flush(wb);
+                pthread_cond_wait(&wb->lcp.cond, &wb->lcp.lock);
+                continue;
+            }
+
+            if (!reserve_dirty_memory()) {
+                push_all_to_flush(wb);
+                PTHREAD_MUTEX_UNLOCK(&wb->lcp.lock);
+                wait_dirty_memory();
+                PTHREAD_MUTEX_LOCK(&wb->lcp.lock);
+                continue;
+            }
+
+            if ((chunk=alloc_chunk(wb, chunk_offset)) == NULL) {
+                release_dirty_memory();
+                result = ENOMEM;
+                break;
+            }
+            chunk->start = start;
+            chunk->end = start + len;
+        }
+
+        memcpy(chunk->buff + start, src, len);
+        wb->current = chunk;
+        if (chunk->start == 0 && chunk->end == WB_CONFIG.slice_size) {
+            push_to_flush(chunk);
+        }
+
+        src += len;
+        current_offset += len;
+        remain -= len;
+    }
+
+    if (current_offset > wb->file_size) {
+        wb->file_size = current_offset;
+    }
+    PTHREAD_MUTEX_UNLOCK(&wb->lcp.lock);
+
+    return result;
+}
+
+static inline bool chunk_overlapped(FCFSAPIWBChunk *chunk,
+        const int64_t offset, const int64_t end)
+{
+    return (chunk->offset + chunk->start < end) &&
+        (chunk->offset + chunk->end > offset);
+}
+
+void write_behind_flush_range(FCFSAPIWriteBehind *wb,
+        const int64_t offset, const int64_t length)
+{
+    FCFSAPIWBChunk *chunk;
+    int64_t end;
+    bool found;
+
+    end = (length > INT64_MAX - offset) ? INT64_MAX : offset + length;
+    PTHREAD_MUTEX_LOCK(&wb->lcp.lock);
+    while (wb->chunk_count > 0) {
+        found = false;
+        fc_list_for_each_entry(chunk, &wb->chunks, dlink) {
+            if (chunk_overlapped(chunk, offset, end)) {
+                found = true;
+                if (!chunk->flushing) {
+                    push_to_flush(chunk);
+                }
+            }
+        }
+
+        if (!found) {
+            break;
+        }
+        pthread_cond_wait(&wb->lcp.cond, &wb->lcp.lock);
+    }
+    PTHREAD_MUTEX_UNLOCK(&wb->lcp.lock);
+}
+
+int write_behind_sync(FCFSAPIWriteBehind *wb)
+{
+    int result;
+
+    write_behind_flush_range(wb, 0, INT64_MAX);
+
+    PTHREAD_MUTEX_LOCK(&wb->lcp.lock);
+    result = wb->error_no;
+    wb->error_no = 0;
+    PTHREAD_MUTEX_UNLOCK(&wb->lcp.lock);
+    return result;
+}
+
+void write_behind_set_file_size(FCFSAPIWriteBehind *wb,
+        const int64_t file_size)
+{
+    PTHREAD_MUTEX_LOCK(&wb->lcp.lock);
+    wb->file_size = file_size;
+    wb->reported.file_size = file_size;
+    if (wb->reported.space_end > file_size) {
+        wb->reported.space_end = file_size;
+    }
+    PTHREAD_MUTEX_UNLOCK(&wb->lcp.lock);
+}
+
+static int flush_chunk(FCFSAPIWBChunk *chunk)
+{
+    FCFSAPIWriteBehind *wb;
+    FSAPIOperationContext op_ctx;
+    FSAPIWriteBuffer wbuffer;
+    FCFSAPIWriteDoneCallbackArg callback_arg;
+    int64_t offset;
+    int64_t end;
+    int done;
+    int remain;
+    int result;
+
+    wb = chunk->wb;
+    FS_API_SET_CTX_AND_TID_EX(op_ctx, wb->ctx->contexts.fsapi, wb->tid);
+    wbuffer.extra_data = &callback_arg.extra;
+    callback_arg.extra.ctx = wb->ctx;
+
+    offset = chunk->offset + chunk->start;
+    remain = chunk->end - chunk->start;
+    done = 0;
+    fs_set_block_slice(&op_ctx.bs_key, wb->oid, offset, remain);
+    while (1) {
+        PTHREAD_MUTEX_LOCK(&wb->lcp.lock);
+        callback_arg.extra.file_size = wb->reported.file_size;
+        callback_arg.extra.space_end = wb->reported.space_end;
+        callback_arg.extra.last_modified_time =
+            wb->reported.last_modified_time;
+        PTHREAD_MUTEX_UNLOCK(&wb->lcp.lock);
+
+        callback_arg.arg.bs_key = &op_ctx.bs_key;
+        callback_arg.arg.write_bytes = 0;
+        wbuffer.buff = chunk->buff + chunk->start + done;
+        if ((result=fs_api_slice_write(&op_ctx, &wbuffer, &callback_arg.
+                        arg.write_bytes, &callback_arg.arg.inc_alloc)) != 0)
+        {
+            if (callback_arg.arg.write_bytes == 0) {
+                break;
+            }
+        } else if (callback_arg.arg.write_bytes == 0) {
+            result = EIO;
+            break;
+        }
+
+        fcfs_api_file_write_done_callback(&callback_arg.arg);
+
+        done += callback_arg.arg.write_bytes;
+        remain -= callback_arg.arg.write_bytes;
+        end = offset + done;
+        PTHREAD_MUTEX_LOCK(&wb->lcp.lock);
+        if (end > wb->reported.file_size) {
+            wb->reported.file_size = end;
+        }
+        if (end > wb->reported.space_end) {
+            wb->reported.space_end = end;
+        }
+        wb->reported.last_modified_time = get_current_time();
+        PTHREAD_MUTEX_UNLOCK(&wb->lcp.lock);
+
+        if (remain <= 0) {
+            result = 0;
+            break;
+        }
+        fs_set_slice_size(&op_ctx.bs_key, offset + done, remain);
+    }
+
+    if (result != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "write behind flush fail, inode: %"PRId64", "
+                "offset: %"PRId64", length: %d, errno: %d, error info: %s",
+                __LINE__, wb->oid, offset + done, remain,
+                result, STRERROR(result));
+    }
+    return result;
+}
+
+static void *flush_thread_func(void *arg)
+{
+    FCFSAPIWBChunk *chunk;
+    FCFSAPIWriteBehind *wb;
+    int result;
+
+    while (SF_G_CONTINUE_FLAG) {
+        chunk = (FCFSAPIWBChunk *)fc_queue_pop(&g_write_behind_ctx.queue);
+        if (chunk == NULL) {
+            continue;
+        }
+
+        result = flush_chunk(chunk);
+        wb = chunk->wb;
+        PTHREAD_MUTEX_LOCK(&wb->lcp.lock);
+        if (result != 0 && wb->error_no == 0) {
+            wb->error_no = result;
+        }
+        fc_list_del_init(&chunk->dlink);
+        wb->chunk_count--;
+        wb->flushing_count--;
+        pthread_cond_broadcast(&wb->lcp.cond);
+        PTHREAD_MUTEX_UNLOCK(&wb->lcp.lock);
+
+        fast_mblock_free_object(&g_write_behind_ctx.chunk_allocator, chunk);
+        release_dirty_memory();
+    }
+
+    return NULL;
+}
+
+static void *expire_scanner_thread_func(void *arg)
+{
+    FCFSAPIWriteBehind *wb;
+    struct timespec ts;
+    int64_t expire_ms;
+    int64_t expire_time_ms;
+    int interval_ms;
+
+    interval_ms = FC_MAX(WB_CONFIG.dirty_expire_ms / 4, 10);
+    while (SF_G_CONTINUE_FLAG) {
+        PTHREAD_MUTEX_LOCK(&g_write_behind_ctx.files.lcp.lock);
+        expire_ms = get_current_time_ms() + interval_ms;
+        ts.tv_sec = expire_ms / 1000;
+        ts.tv_nsec = (expire_ms % 1000) * 1000 * 1000;
+        pthread_cond_timedwait(&g_write_behind_ctx.files.lcp.cond,
+                &g_write_behind_ctx.files.lcp.lock, &ts);
+
+        /* flush all dirty chunks when the writers wait for memory */
+        if (__sync_add_and_fetch(&g_write_behind_ctx.waiting_count, 0) > 0) {
+            expire_time_ms = INT64_MAX;
+        } else {
+            expire_time_ms = get_current_time_ms() -
+                WB_CONFIG.dirty_expire_ms;
+        }
+        fc_list_for_each_entry(wb, &g_write_behind_ctx.files.head, dlink) {
+            PTHREAD_MUTEX_LOCK(&wb->lcp.lock);
+            push_idle_to_flush(wb, expire_time_ms);
+            PTHREAD_MUTEX_UNLOCK(&wb->lcp.lock);
+        }
+        PTHREAD_MUTEX_UNLOCK(&g_write_behind_ctx.files.lcp.lock);
+    }
+
+    return NULL;
+}
+
+FCFSAPIWriteBehind *write_behind_create(FCFSAPIContext *ctx,
+        const FDIRDEntryInfo *dentry, const int64_t tid)
+{
+    FCFSAPIWriteBehind *wb;
+
+    wb = (FCFSAPIWriteBehind *)fc_malloc(sizeof(FCFSAPIWriteBehind));
+    if (wb == NULL) {
+        return NULL;
+    }
+
+    if (init_pthread_lock_cond_pair(&wb->lcp) != 0) {
+        free(wb);
+        return NULL;
+    }
+
+    wb->ctx = ctx;
+    wb->oid = dentry->inode;
+    wb->tid = tid;
+    FC_INIT_LIST_HEAD(&wb->chunks);
+    wb->current = NULL;
+    wb->chunk_count = 0;
+    wb->flushing_count = 0;
+    wb->error_no = 0;
+    wb->file_size = dentry->stat.size;
+    wb->reported.file_size = dentry->stat.size;
+    wb->reported.space_end = dentry->stat.space_end;
+    wb->reported.last_modified_time = dentry->stat.mtime;
+
+    PTHREAD_MUTEX_LOCK(&g_write_behind_ctx.files.lcp.lock);
+    fc_list_add_tail(&wb->dlink, &g_write_behind_ctx.files.head);
+    PTHREAD_MUTEX_UNLOCK(&g_write_behind_ctx.files.lcp.lock);
+    return wb;
+}
+
+int write_behind_destroy(FCFSAPIWriteBehind *wb)
+{
+    int result;
+
+    PTHREAD_MUTEX_LOCK(&g_write_behind_ctx.files.lcp.lock);
+    fc_list_del_init(&wb->dlink);
+    PTHREAD_MUTEX_UNLOCK(&g_write_behind_ctx.files.lcp.lock);
+
+    result = write_behind_sync(wb);
+    destroy_pthread_lock_cond_pair(&wb->lcp);
+    free(wb);
+    return result;
+}
+
+static int chunk_alloc_init(void *element, void *args)
+{
+    ((FCFSAPIWBChunk *)element)->buff = (char *)element +
+        sizeof(FCFSAPIWBChunk);
+    return 0;
+}
+
+int write_behind_init(FCFSAPIContext *fcfs_api_ctx)
+{
+    int result;
+    int i;
+    pthread_t tid;
+
+    g_write_behind_ctx.fcfs_api_ctx = fcfs_api_ctx;
+    if ((result=fast_mblock_init_ex1(&g_write_behind_ctx.chunk_allocator,
+                    "wb_chunk", sizeof(FCFSAPIWBChunk) +
+                    WB_CONFIG.slice_size, 8, 0, chunk_alloc_init,
+                    NULL, true)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=fc_queue_init(&g_write_behind_ctx.queue, (long)
+                    (&((FCFSAPIWBChunk *)NULL)->next))) != 0)
+    {
+        return result;
+    }
+
+    if ((result=init_pthread_lock_cond_pair(&g_write_behind_ctx.
+                    memory_lcp)) != 0)
+    {
+        return result;
+    }
+    if ((result=init_pthread_lock_cond_pair(&g_write_behind_ctx.
+                    files.lcp)) != 0)
+    {
+        return result;
+    }
+    FC_INIT_LIST_HEAD(&g_write_behind_ctx.files.head);
+
+    g_write_behind_ctx.dirty_bytes = 0;
+    g_write_behind_ctx.waiting_count = 0;
+    for (i=0; i<WB_CONFIG.flush_threads; i++) {
+        if ((result=fc_create_thread(&tid, flush_thread_func, NULL,
+                        SF_G_THREAD_STACK_SIZE)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return fc_create_thread(&tid, expire_scanner_thread_func,
+            NULL, SF_G_THREAD_STACK_SIZE);
+}
+
+void write_behind_terminate()
+{
+    if (g_write_behind_ctx.fcfs_api_ctx == NULL) {
+        return;
+    }
+
+    fc_queue_terminate(&g_write_behind_ctx.queue);
+    pthread_cond_signal(&g_write_behind_ctx.files.lcp.cond);
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* the write behind cache of the open file.
+ *
+ * the written data is copied into the dirty chunks which aligned by the
+ * slice size, and the chunks are written to the data servers by the flush
+ * threads in parallel when the chunk full, the dirty limit reached or the
+ * chunk expired. the flush error is kept and returned by flush, fsync
+ * and close as the kernel writeback */
+
+#ifndef _FCFS_API_WRITE_BEHIND_H
+#define _FCFS_API_WRITE_BEHIND_H
+
+#include "fastcommon/fc_list.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/fc_queue.h"
+#include "fastcommon/fast_mblock.h"
+#include "fcfs_api_types.h"
+
+typedef struct fcfs_api_wb_chunk {
+    struct fcfs_api_write_behind *wb;
+    int64_t offset;   //aligned by the slice size
+    int start;        //dirty range: [start, end)
+    int end;
+    bool flushing;
+    int64_t create_time_ms;
+    char *buff;
+    struct fc_list_head dlink;       //for the chunks of write behind
+    struct fcfs_api_wb_chunk *next;  //for flush queue
+} FCFSAPIWBChunk;
+
+typedef struct fcfs_api_write_behind {
+    FCFSAPIContext *ctx;
+    int64_t oid;
+    int64_t tid;
+    pthread_lock_cond_pair_t lcp;  //for the chunks and notify
+    struct fc_list_head chunks;    //element: FCFSAPIWBChunk
+    FCFSAPIWBChunk *current;       //the last written chunk
+    int chunk_count;
+    int flushing_count;
+    int error_no;       //the first flush error
+    int64_t file_size;  //the max end offset written
+    struct {
+        int64_t file_size;
+        int64_t space_end;
+        int last_modified_time;
+    } reported;
+    struct fc_list_head dlink;  //for expire scanner
+} FCFSAPIWriteBehind;
+
+typedef struct {
+    FCFSAPIContext *fcfs_api_ctx;
+    struct fast_mblock_man chunk_allocator;
+    struct fc_queue queue;   //the chunks to flush
+    volatile int64_t dirty_bytes;
+    volatile int waiting_count;  //the writers wait for dirty memory
+    pthread_lock_cond_pair_t memory_lcp;  //for dirty memory notify
+    struct {
+        pthread_lock_cond_pair_t lcp;  //for the list and timed wait
+        struct fc_list_head head;      //element: FCFSAPIWriteBehind
+    } files;
+} WriteBehindContext;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    extern WriteBehindContext g_write_behind_ctx;
+
+    int write_behind_init(FCFSAPIContext *fcfs_api_ctx);
+
+    void write_behind_terminate();
+
+    FCFSAPIWriteBehind *write_behind_create(FCFSAPIContext *ctx,
+            const FDIRDEntryInfo *dentry, const int64_t tid);
+
+    /* flush all and free the write behind, return the flush error */
+    int write_behind_destroy(FCFSAPIWriteBehind *wb);
+
+    /* copy the data into the dirty chunks, only block for the dirty limits */
+    int write_behind_write(FCFSAPIWriteBehind *wb, const char *buff,
+            const int size, const int64_t offset);
+
+    /* flush the dirty chunks overlapped with the range and wait for done */
+    void write_behind_flush_range(FCFSAPIWriteBehind *wb,
+            const int64_t offset, const int64_t length);
+
+    /* flush all dirty chunks and wait for done,
+     * return and clear the flush error */
+    int write_behind_sync(FCFSAPIWriteBehind *wb);
+
+    /* reset the file size after truncate */
+    void write_behind_set_file_size(FCFSAPIWriteBehind *wb,
+            const int64_t file_size);
+
+    static inline int64_t write_behind_file_size(FCFSAPIWriteBehind *wb)
+    {
+        int64_t file_size;
+
+        PTHREAD_MUTEX_LOCK(&wb->lcp.lock);
+        file_size = wb->file_size;
+        PTHREAD_MUTEX_UNLOCK(&wb->lcp.lock);
+        return file_size;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
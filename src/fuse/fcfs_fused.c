@@ -231,7 +231,8 @@ static struct fuse_session *create_fuse_session(char *argv0,
         struct fuse_lowlevel_ops *ops)
 {
 	struct fuse_args args;
-    char *argv[8];
+    char *argv[12];
+    char max_read_opt[32];
     int argc;
 
     argc = 0;
@@ -254,6 +255,11 @@ static struct fuse_session *create_fuse_session(char *argv0,
         argv[argc++] = "allow_other";
     }
 
+    //the mount option max_read must equal to conn->max_read
+    sprintf(max_read_opt, "max_read=%d", g_fuse_global_vars.max_read);
+    argv[argc++] = "-o";
+    argv[argc++] = max_read_opt;
+
     args.argc = argc;
     args.argv = argv;
     args.allocated = 0;
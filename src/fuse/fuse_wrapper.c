@@ -28,7 +28,13 @@
 #define FS_READDIR_BUFFER_INIT_NORMAL      1
 #define FS_READDIR_BUFFER_INIT_PLUS        2
 
+typedef struct {
+    char *buff;
+    int size;
+} FUSEIOBuffer;
+
 static struct fast_mblock_man fh_allocator;
+static pthread_key_t io_buffer_key;
 
 static void fill_stat(const FDIRDEntryInfo *dentry, struct stat *stat)
 {
@@ -105,6 +111,45 @@ static void fs_do_getattr(fuse_req_t req, fuse_ino_t ino,
     }
 }
 
+static int do_truncate_by_inode(fuse_req_t req, fuse_ino_t ino,
+        const int64_t new_size, FDIRDEntryInfo *dentry)
+{
+    const struct fuse_ctx *fuse_ctx;
+    FCFSAPIFileContext fctx;
+    FCFSAPIFileInfo *fh;
+    int64_t new_inode;
+    int result;
+
+    if (fs_convert_inode(ino, &new_inode) != 0) {
+        return ENOENT;
+    }
+    if ((result=fcfs_api_stat_dentry_by_inode(new_inode, dentry)) != 0) {
+        return result;
+    }
+
+    fh = (FCFSAPIFileInfo *)fast_mblock_alloc_object(&fh_allocator);
+    if (fh == NULL) {
+        return ENOMEM;
+    }
+
+    fuse_ctx = fuse_req_ctx(req);
+    fctx.omp.mode = dentry->stat.mode;
+    fctx.omp.uid = dentry->stat.uid;
+    fctx.omp.gid = dentry->stat.gid;
+    fctx.tid = fuse_ctx->pid;
+    if ((result=fcfs_api_open_by_dentry(fh, dentry, O_WRONLY, &fctx)) == 0) {
+        if ((result=fcfs_api_ftruncate_ex(fh, new_size,
+                        fuse_ctx->pid)) == 0)
+        {
+            dentry->stat.size = new_size;
+        }
+        fcfs_api_close(fh);
+    }
+
+    fast_mblock_free_object(&fh_allocator, fh);
+    return result;
+}
+
 void fs_do_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr,
              int to_set, struct fuse_file_info *fi)
 {
@@ -138,8 +183,16 @@ void fs_do_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr,
         const struct fuse_ctx *fctx;
 
         if (fi == NULL) {
-            fuse_reply_err(req, EBADF);
-            return;
+            /* truncate by path, and the kernel flushes the size of the
+             * writeback cache without file handle also */
+            if ((result=do_truncate_by_inode(req, ino,
+                            attr->st_size, &dentry)) != 0)
+            {
+                fuse_reply_err(req, result);
+                return;
+            }
+            pe = &dentry;
+            goto set_times;
         }
 
         fh = (FCFSAPIFileInfo *)fi->fh;
@@ -169,20 +222,24 @@ void fs_do_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr,
         pe = NULL;
     }
 
+set_times:
     if ((to_set & FUSE_SET_ATTR_CTIME)) {
         options.ctime = 1;
     }
 
+    //the time of the *_NOW flags is not set by libfuse
     if ((to_set & FUSE_SET_ATTR_ATIME)) {
         options.atime = 1;
     } else if ((to_set & FUSE_SET_ATTR_ATIME_NOW)) {
         options.atime = 1;
+        attr->st_atime = get_current_time();
     }
 
     if ((to_set & FUSE_SET_ATTR_MTIME)) {
         options.mtime = 1;
     } else if ((to_set & FUSE_SET_ATTR_MTIME_NOW)) {
         options.mtime = 1;
+        attr->st_mtime = get_current_time();
     }
 
     if (fs_convert_inode(ino, &new_inode) != 0) {
@@ -400,6 +457,7 @@ static int do_open(fuse_req_t req, FDIRDEntryInfo *dentry,
         struct fuse_file_info *fi, const FCFSAPIFileContext *fctx)
 {
     int result;
+    int flags;
     FCFSAPIFileInfo *fh;
 
     fh = (FCFSAPIFileInfo *)fast_mblock_alloc_object(&fh_allocator);
@@ -407,7 +465,17 @@ static int do_open(fuse_req_t req, FDIRDEntryInfo *dentry,
         return ENOMEM;
     }
 
-    if ((result=fcfs_api_open_by_dentry(fh, dentry, fi->flags, fctx)) != 0) {
+    flags = fi->flags;
+    if (g_fuse_global_vars.writeback_cache) {
+        /* the kernel reads the pages for partial writes by the write-only
+         * file handle, and the kernel gives the offsets for appending */
+        if ((flags & O_ACCMODE) == O_WRONLY) {
+            flags = (flags & ~O_ACCMODE) | O_RDWR;
+        }
+        flags &= ~O_APPEND;
+    }
+
+    if ((result=fcfs_api_open_by_dentry(fh, dentry, flags, fctx)) != 0) {
         logError("file: "__FILE__", line: %d, func: %s, "
             "ino: %"PRId64", fh: %"PRId64", flags: %d, result: %d\n",
             __LINE__, __FUNCTION__, dentry->inode, fi->fh, fi->flags, result);
@@ -785,7 +853,8 @@ static void fs_do_flush(fuse_req_t req, fuse_ino_t ino,
             __LINE__, __FUNCTION__, ino, fi->fh);
             */
 
-    fuse_reply_err(req, 0);
+    fuse_reply_err(req, fcfs_api_flush_ex((FCFSAPIFileInfo *)fi->fh,
+                fuse_req_ctx(req)->pid));
 }
 
 static void fs_do_fsync(fuse_req_t req, fuse_ino_t ino,
@@ -796,7 +865,10 @@ static void fs_do_fsync(fuse_req_t req, fuse_ino_t ino,
             "ino: %"PRId64", fh: %"PRId64", datasync: %d",
             __LINE__, __FUNCTION__, ino, fi->fh, datasync);
             */
-    fuse_reply_err(req, 0);
+
+    /* the metadata is persisted by fastDIR, so datasync is the same */
+    fuse_reply_err(req, fcfs_api_fsync_ex((FCFSAPIFileInfo *)fi->fh,
+                fuse_req_ctx(req)->pid));
 }
 
 static void fs_do_release(fuse_req_t req, fuse_ino_t ino,
@@ -821,22 +893,76 @@ static void fs_do_release(fuse_req_t req, fuse_ino_t ino,
     fuse_reply_err(req, result);
 }
 
+static void io_buffer_thread_exit(void *arg)
+{
+    FUSEIOBuffer *io_buffer;
+
+    io_buffer = (FUSEIOBuffer *)arg;
+    if (io_buffer->buff != NULL) {
+        free(io_buffer->buff);
+    }
+    free(io_buffer);
+}
+
+/* the buffer of the current thread for the read data and the write data
+ * received by splice, the buffer is page aligned for vmsplice */
+static char *get_io_buffer(const int size)
+{
+    FUSEIOBuffer *io_buffer;
+    char *buff;
+    int alloc_size;
+    int result;
+
+    io_buffer = (FUSEIOBuffer *)pthread_getspecific(io_buffer_key);
+    if (io_buffer == NULL) {
+        io_buffer = (FUSEIOBuffer *)fc_calloc(1, sizeof(FUSEIOBuffer));
+        if (io_buffer == NULL) {
+            return NULL;
+        }
+        if ((result=pthread_setspecific(io_buffer_key, io_buffer)) != 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "pthread_setspecific fail, errno: %d, error info: %s",
+                    __LINE__, result, STRERROR(result));
+            free(io_buffer);
+            return NULL;
+        }
+    }
+
+    if (size <= io_buffer->size) {
+        return io_buffer->buff;
+    }
+
+    alloc_size = FC_MAX(g_fuse_global_vars.max_read,
+            g_fuse_global_vars.max_write);
+    if (alloc_size < size) {
+        alloc_size = size;
+    }
+    if ((result=posix_memalign((void **)&buff,
+                    getpagesize(), alloc_size)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "posix_memalign %d bytes fail, errno: %d, error info: %s",
+                __LINE__, alloc_size, result, STRERROR(result));
+        return NULL;
+    }
+
+    if (io_buffer->buff != NULL) {
+        free(io_buffer->buff);
+    }
+    io_buffer->buff = buff;
+    io_buffer->size = alloc_size;
+    return buff;
+}
+
 static void fs_do_read(fuse_req_t req, fuse_ino_t ino, size_t size,
 			  off_t offset, struct fuse_file_info *fi)
 {
     FCFSAPIFileInfo *fh;
     const struct fuse_ctx *fctx;
+    struct fuse_bufvec bufv;
     int result;
     int read_bytes;
-    char fixed_buff[256 * 1024];
     char *buff;
-    
-    if (size <= sizeof(fixed_buff)) {
-        buff = fixed_buff;
-    } else if ((buff=(char *)fc_malloc(size)) == NULL) {
-        fuse_reply_err(req, ENOMEM);
-        return;
-    }
 
     fh = (FCFSAPIFileInfo *)fi->fh;
     if (fh == NULL) {
@@ -844,6 +970,11 @@ static void fs_do_read(fuse_req_t req, fuse_ino_t ino, size_t size,
         return;
     }
 
+    if ((buff=get_io_buffer(size)) == NULL) {
+        fuse_reply_err(req, ENOMEM);
+        return;
+    }
+
     fctx = fuse_req_ctx(req);
     if ((result=fcfs_api_pread_ex(fh, buff, size, offset,
                     &read_bytes, fctx->pid)) != 0)
@@ -861,9 +992,14 @@ static void fs_do_read(fuse_req_t req, fuse_ino_t ino, size_t size,
             fh->flags & O_SYNC, fh->flags & O_DSYNC);
             */
 
-    fuse_reply_buf(req, buff, read_bytes);
-    if (buff != fixed_buff) {
-        free(buff);
+    if (g_fuse_global_vars.splice_write) {
+        /* libfuse sends the data by vmsplice and splice
+         * instead of copying to the reply buffer */
+        bufv = FUSE_BUFVEC_INIT(read_bytes);
+        bufv.buf[0].mem = buff;
+        fuse_reply_data(req, &bufv, FUSE_BUF_SPLICE_MOVE);
+    } else {
+        fuse_reply_buf(req, buff, read_bytes);
     }
 }
 
@@ -901,6 +1037,37 @@ void fs_do_write(fuse_req_t req, fuse_ino_t ino, const char *buff,
     fuse_reply_write(req, written_bytes);
 }
 
+static void fs_do_write_buf(fuse_req_t req, fuse_ino_t ino,
+        struct fuse_bufvec *bufv, off_t offset, struct fuse_file_info *fi)
+{
+    struct fuse_bufvec mem_bufv;
+    size_t size;
+    ssize_t bytes;
+    char *buff;
+
+    size = fuse_buf_size(bufv);
+    if (bufv->count == 1 && !(bufv->buf[0].flags & FUSE_BUF_IS_FD)) {
+        fs_do_write(req, ino, (char *)bufv->buf[0].mem + bufv->off,
+                size, offset, fi);
+        return;
+    }
+
+    //the write data in the pipe of splice
+    if ((buff=get_io_buffer(size)) == NULL) {
+        fuse_reply_err(req, ENOMEM);
+        return;
+    }
+
+    mem_bufv = FUSE_BUFVEC_INIT(size);
+    mem_bufv.buf[0].mem = buff;
+    if ((bytes=fuse_buf_copy(&mem_bufv, bufv, 0)) < 0) {
+        fuse_reply_err(req, -bytes);
+        return;
+    }
+
+    fs_do_write(req, ino, buff, bytes, offset, fi);
+}
+
 void fs_do_lseek(fuse_req_t req, fuse_ino_t ino, off_t offset,
         int whence, struct fuse_file_info *fi)
 {
@@ -1027,6 +1194,72 @@ static void fs_do_fallocate(fuse_req_t req, fuse_ino_t ino, int mode,
     fuse_reply_err(req, result);
 }
 
+static void fs_do_copy_file_range(fuse_req_t req, fuse_ino_t ino_in,
+        off_t off_in, struct fuse_file_info *fi_in, fuse_ino_t ino_out,
+        off_t off_out, struct fuse_file_info *fi_out,
+        size_t len, int flags)
+{
+    int result;
+    int64_t copied_bytes;
+    FCFSAPIFileInfo *fh_in;
+    FCFSAPIFileInfo *fh_out;
+    const struct fuse_ctx *fctx;
+
+    fh_in = (FCFSAPIFileInfo *)fi_in->fh;
+    fh_out = (FCFSAPIFileInfo *)fi_out->fh;
+    if (fh_in == NULL || fh_out == NULL) {
+        result = EBADF;
+    } else if (flags != 0) {
+        result = EINVAL;
+    } else {
+        fctx = fuse_req_ctx(req);
+        result = fcfs_api_copy_file_range_ex(fh_in, off_in, fh_out,
+                off_out, len, &copied_bytes, fctx->pid);
+    }
+
+    if (result == 0) {
+        fuse_reply_write(req, copied_bytes);
+    } else {
+        fuse_reply_err(req, result);
+    }
+}
+
+static void fs_do_init(void *userdata, struct fuse_conn_info *conn)
+{
+    if (g_fuse_global_vars.writeback_cache) {
+        if ((conn->capable & FUSE_CAP_WRITEBACK_CACHE)) {
+            conn->want |= FUSE_CAP_WRITEBACK_CACHE;
+        } else {
+            logWarning("file: "__FILE__", line: %d, "
+                    "the kernel not support writeback cache", __LINE__);
+        }
+    }
+
+    //libfuse enables splice read by default when write_buf is set
+    conn->want &= ~(FUSE_CAP_SPLICE_READ | FUSE_CAP_SPLICE_WRITE |
+            FUSE_CAP_SPLICE_MOVE);
+    if (g_fuse_global_vars.splice_read) {
+        conn->want |= (conn->capable & FUSE_CAP_SPLICE_READ);
+    }
+    if (g_fuse_global_vars.splice_write) {
+        conn->want |= (conn->capable & (FUSE_CAP_SPLICE_WRITE |
+                    FUSE_CAP_SPLICE_MOVE));
+    }
+
+    //libfuse limits the max_write by its buffer size
+    conn->max_write = g_fuse_global_vars.max_write;
+    conn->max_read = g_fuse_global_vars.max_read;
+    conn->max_readahead = g_fuse_global_vars.max_read;
+
+    logInfo("file: "__FILE__", line: %d, "
+            "FUSE connection, writeback cache: %d, splice read: %d, "
+            "splice write: %d, max_write: %u, max_readahead: %u",
+            __LINE__, (conn->want & FUSE_CAP_WRITEBACK_CACHE) != 0,
+            (conn->want & FUSE_CAP_SPLICE_READ) != 0,
+            (conn->want & FUSE_CAP_SPLICE_WRITE) != 0,
+            conn->max_write, conn->max_readahead);
+}
+
 int fs_fuse_wrapper_init(struct fuse_lowlevel_ops *ops)
 {
     int result;
@@ -1036,7 +1269,17 @@ int fs_fuse_wrapper_init(struct fuse_lowlevel_ops *ops)
         return result;
     }
 
+    if ((result=pthread_key_create(&io_buffer_key,
+                    io_buffer_thread_exit)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "pthread_key_create fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        return result;
+    }
+
     memset(ops, 0, sizeof(*ops));
+    ops->init    = fs_do_init;
     ops->lookup  = fs_do_lookup;
     ops->getattr = fs_do_getattr;
     ops->setattr = fs_do_setattr;
@@ -1052,6 +1295,7 @@ int fs_fuse_wrapper_init(struct fuse_lowlevel_ops *ops)
     ops->release = fs_do_release;
     ops->read    = fs_do_read;
     ops->write   = fs_do_write;
+    ops->write_buf = fs_do_write_buf;
     ops->mknod   = fs_do_mknod;
     ops->mkdir   = fs_do_mkdir;
     ops->rmdir   = fs_do_rmdir;
@@ -1068,6 +1312,7 @@ int fs_fuse_wrapper_init(struct fuse_lowlevel_ops *ops)
     ops->flock   = fs_do_flock;
     ops->statfs  = fs_do_statfs;
     ops->fallocate = fs_do_fallocate;
+    ops->copy_file_range = fs_do_copy_file_range;
 
     return 0;
 }
@@ -246,6 +246,23 @@ static int load_fuse_config(IniFullContext *ini_ctx)
             section_name, "entry_timeout", ini_ctx->context,
             FCFS_FUSE_DEFAULT_ENTRY_TIMEOUT);
 
+    g_fuse_global_vars.writeback_cache = iniGetBoolValue(ini_ctx->
+            section_name, "writeback_cache", ini_ctx->context, false);
+
+    g_fuse_global_vars.splice_read = iniGetBoolValue(ini_ctx->
+            section_name, "splice_read", ini_ctx->context, false);
+
+    g_fuse_global_vars.splice_write = iniGetBoolValue(ini_ctx->
+            section_name, "splice_write", ini_ctx->context, false);
+
+    g_fuse_global_vars.max_write = iniGetByteCorrectValue(ini_ctx,
+            "max_write", FCFS_FUSE_DEFAULT_MAX_IO_SIZE,
+            FCFS_FUSE_MIN_IO_SIZE, FCFS_FUSE_MAX_IO_SIZE);
+
+    g_fuse_global_vars.max_read = iniGetByteCorrectValue(ini_ctx,
+            "max_read", FCFS_FUSE_DEFAULT_MAX_IO_SIZE,
+            FCFS_FUSE_MIN_IO_SIZE, FCFS_FUSE_MAX_IO_SIZE);
+
     return load_owner_config(ini_ctx);
 }
 
@@ -279,6 +296,7 @@ int fcfs_fuse_global_init(const char *config_filename)
 {
 #define MIN_THREAD_STACK_SIZE  (320 * 1024)
     int result;
+    int len;
     string_t base_path;
     string_t mountpoint;
     IniContext iniContext;
@@ -365,8 +383,6 @@ int fcfs_fuse_global_init(const char *config_filename)
     if (g_fdir_client_vars.client_ctx.idempotency_enabled ||
             g_fs_client_vars.client_ctx.idempotency_enabled)
     {
-        int len;
-
         len = sprintf(sf_idempotency_config,
                 "%s idempotency_enabled=%d, "
                 "%s idempotency_enabled=%d, ",
@@ -403,6 +419,9 @@ int fcfs_fuse_global_init(const char *config_filename)
 
     fs_api_config_to_string(write_combine_config,
             sizeof(write_combine_config));
+    len = strlen(write_combine_config);
+    fcfs_api_write_behind_config_to_string(write_combine_config + len,
+            sizeof(write_combine_config) - len);
     fs_client_log_config_ex(g_fcfs_api_ctx.contexts.fsapi->fs,
             write_combine_config);
 
@@ -410,7 +429,9 @@ int fcfs_fuse_global_init(const char *config_filename)
             "FastDIR namespace: %s, %sFUSE mountpoint: %s, "
             "owner_type: %s%s, singlethread: %d, clone_fd: %d, "
             "max_idle_threads: %d, allow_others: %s, auto_unmount: %d, "
-            "attribute_timeout: %.1fs, entry_timeout: %.1fs",
+            "attribute_timeout: %.1fs, entry_timeout: %.1fs, "
+            "writeback_cache: %d, splice_read: %d, splice_write: %d, "
+            "max_write: %d KB, max_read: %d KB",
             g_fcfs_global_vars.version.major,
             g_fcfs_global_vars.version.minor,
             g_fcfs_global_vars.version.patch,
@@ -422,7 +443,12 @@ int fcfs_fuse_global_init(const char *config_filename)
             get_allow_others_caption(g_fuse_global_vars.allow_others),
             g_fuse_global_vars.auto_unmount,
             g_fuse_global_vars.attribute_timeout,
-            g_fuse_global_vars.entry_timeout);
+            g_fuse_global_vars.entry_timeout,
+            g_fuse_global_vars.writeback_cache,
+            g_fuse_global_vars.splice_read,
+            g_fuse_global_vars.splice_write,
+            g_fuse_global_vars.max_write / 1024,
+            g_fuse_global_vars.max_read / 1024);
 
     return 0;
 }
@@ -22,6 +22,9 @@
 
 #define FCFS_FUSE_DEFAULT_ATTRIBUTE_TIMEOUT 1.0
 #define FCFS_FUSE_DEFAULT_ENTRY_TIMEOUT     1.0
+#define FCFS_FUSE_DEFAULT_MAX_IO_SIZE       (1024 * 1024)
+#define FCFS_FUSE_MIN_IO_SIZE               (4 * 1024)
+#define FCFS_FUSE_MAX_IO_SIZE               (1024 * 1024)
 
 typedef enum {
     allow_none,
@@ -43,6 +46,11 @@ typedef struct {
     int max_idle_threads;
     double attribute_timeout;
     double entry_timeout;
+    bool writeback_cache;
+    bool splice_read;   //splice the requests from the fuse device
+    bool splice_write;  //splice the read replies to the fuse device
+    int max_write;
+    int max_read;
     FUSEAllowOthersMode allow_others;
     struct {
         FUSEOwnerType type;
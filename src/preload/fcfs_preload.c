@@ -0,0 +1,1215 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* the LD_PRELOAD library which routes the file IO under the mountpoint
+ * to fcfs_api directly, bypass the FUSE kernel module.
+ *
+ * usage: LD_PRELOAD=libfcfspreload.so your_program ...
+ *
+ * the environment variables:
+ *   FCFS_PRELOAD_CONFIG: the config filename, the format is same as
+ *     fcfs_fused, default is /etc/fastcfs/fcfs/fuse.conf
+ *   FCFS_PRELOAD_MOUNTPOINT: the path prefix to intercept, default is
+ *     the mountpoint of section [FUSE] in the config file
+ *
+ * only the absolute paths are intercepted, the directory operations and
+ * the unsupported calls such as mmap and statx fall through to libc,
+ * so they work when the FUSE mountpoint exists.
+ * the managed fd is a dup of /dev/null for unique fd number. the
+ * fcfs_api connection is not shared to the child process after fork:
+ * the child forgets the opened files and stops the interception, so it
+ * should exec or access the files through the FUSE mountpoint */
+
+/* define the libc functions by their own names, the 64-bit
+ * variants are same as the normal ones because LP64 only */
+#undef _FILE_OFFSET_BITS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/file.h>
+#include <sys/resource.h>
+#include "fastcommon/logger.h"
+#include "fastcommon/shared_func.h"
+#include "fastcommon/pthread_func.h"
+#include "fastcommon/ini_file_reader.h"
+#include "fastcfs/fcfs_api.h"
+
+#if __WORDSIZE != 64
+#error "fcfs preload supports 64-bit platform only"
+#endif
+
+#define FCFS_PRELOAD_DEFAULT_CONFIG   "/etc/fastcfs/fcfs/fuse.conf"
+#define FCFS_PRELOAD_FUSE_SECTION     "FUSE"
+#define FCFS_PRELOAD_MAX_IO_SIZE      (1 << 30)
+
+typedef struct fcfs_preload_file {
+    FCFSAPIFileInfo fi;
+    volatile int refer_count;  //shared by dup and the doing IO
+} FCFSPreloadFile;
+
+typedef struct fcfs_preload_context {
+    bool enabled;
+    int init_result;
+    pthread_once_t once;
+    char *ns;
+    char *config_filename;
+    string_t mountpoint;
+    int fd_limit;
+    pthread_mutex_t lock;     //for the file table
+    FCFSPreloadFile **files;  //indexed by fd
+} FCFSPreloadContext;
+
+static FCFSPreloadContext preload_ctx = {false, 0, PTHREAD_ONCE_INIT};
+
+static struct {
+    int (*open)(const char *path, int flags, ...);
+    int (*openat)(int dirfd, const char *path, int flags, ...);
+    int (*close)(int fd);
+    ssize_t (*read)(int fd, void *buf, size_t count);
+    ssize_t (*write)(int fd, const void *buf, size_t count);
+    ssize_t (*pread)(int fd, void *buf, size_t count, off_t offset);
+    ssize_t (*pwrite)(int fd, const void *buf, size_t count, off_t offset);
+    ssize_t (*readv)(int fd, const struct iovec *iov, int iovcnt);
+    ssize_t (*writev)(int fd, const struct iovec *iov, int iovcnt);
+    off_t (*lseek)(int fd, off_t offset, int whence);
+    int (*fsync)(int fd);
+    int (*fdatasync)(int fd);
+    int (*ftruncate)(int fd, off_t length);
+    int (*truncate)(const char *path, off_t length);
+    int (*fallocate)(int fd, int mode, off_t offset, off_t len);
+    int (*posix_fallocate)(int fd, off_t offset, off_t len);
+    int (*stat)(const char *path, struct stat *buf);
+    int (*lstat)(const char *path, struct stat *buf);
+    int (*fstat)(int fd, struct stat *buf);
+    int (*fstatat)(int dirfd, const char *path, struct stat *buf, int flags);
+    int (*__xstat)(int ver, const char *path, struct stat *buf);
+    int (*__lxstat)(int ver, const char *path, struct stat *buf);
+    int (*__fxstat)(int ver, int fd, struct stat *buf);
+    int (*access)(const char *path, int mode);
+    int (*unlink)(const char *path);
+    int (*rename)(const char *old_path, const char *new_path);
+    int (*dup)(int fd);
+    int (*dup2)(int old_fd, int new_fd);
+    int (*dup3)(int old_fd, int new_fd, int flags);
+    int (*fcntl)(int fd, int cmd, ...);
+    int (*flock)(int fd, int operation);
+} libc;
+
+#define LIBC_FUNC(name) (libc.name != NULL ? libc.name : \
+        (load_libc_funcs(), libc.name))
+
+#define LOAD_LIBC_FUNC(name) libc.name = dlsym(RTLD_NEXT, #name)
+
+#define PRELOAD_RETURN_ERRNO(result) \
+    do { \
+        errno = result;  \
+        return -1;  \
+    } while (0)
+
+/* may be called before the constructor by the other libraries */
+static void load_libc_funcs()
+{
+    LOAD_LIBC_FUNC(open);
+    LOAD_LIBC_FUNC(openat);
+    LOAD_LIBC_FUNC(close);
+    LOAD_LIBC_FUNC(read);
+    LOAD_LIBC_FUNC(write);
+    LOAD_LIBC_FUNC(pread);
+    LOAD_LIBC_FUNC(pwrite);
+    LOAD_LIBC_FUNC(readv);
+    LOAD_LIBC_FUNC(writev);
+    LOAD_LIBC_FUNC(lseek);
+    LOAD_LIBC_FUNC(fsync);
+    LOAD_LIBC_FUNC(fdatasync);
+    LOAD_LIBC_FUNC(ftruncate);
+    LOAD_LIBC_FUNC(truncate);
+    LOAD_LIBC_FUNC(fallocate);
+    LOAD_LIBC_FUNC(posix_fallocate);
+    LOAD_LIBC_FUNC(stat);
+    LOAD_LIBC_FUNC(lstat);
+    LOAD_LIBC_FUNC(fstat);
+    LOAD_LIBC_FUNC(fstatat);
+    LOAD_LIBC_FUNC(__xstat);
+    LOAD_LIBC_FUNC(__lxstat);
+    LOAD_LIBC_FUNC(__fxstat);
+    LOAD_LIBC_FUNC(access);
+    LOAD_LIBC_FUNC(unlink);
+    LOAD_LIBC_FUNC(rename);
+    LOAD_LIBC_FUNC(dup);
+    LOAD_LIBC_FUNC(dup2);
+    LOAD_LIBC_FUNC(dup3);
+    LOAD_LIBC_FUNC(fcntl);
+    LOAD_LIBC_FUNC(flock);
+}
+
+static void preload_do_init()
+{
+    int result;
+
+    if ((result=fcfs_api_pooled_init(preload_ctx.ns,
+                    preload_ctx.config_filename)) == 0)
+    {
+        result = fcfs_api_start();
+    }
+
+    if (result != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "init fcfs api fail, config file: %s, "
+                "errno: %d, error info: %s", __LINE__,
+                preload_ctx.config_filename, result, STRERROR(result));
+    }
+    preload_ctx.init_result = result;
+}
+
+static inline int preload_check_init()
+{
+    pthread_once(&preload_ctx.once, preload_do_init);
+    return preload_ctx.init_result;
+}
+
+/* return the path in the namespace, NULL for not under the mountpoint */
+static const char *get_fcfs_path(const char *path)
+{
+    const char *p;
+
+    if (!preload_ctx.enabled || path == NULL || *path != '/') {
+        return NULL;
+    }
+    if (strncmp(path, preload_ctx.mountpoint.str,
+                preload_ctx.mountpoint.len) != 0)
+    {
+        return NULL;
+    }
+
+    p = path + preload_ctx.mountpoint.len;
+    if (*p == '\0') {
+        return "/";
+    }
+    return (*p == '/') ? p : NULL;
+}
+
+static inline bool is_managed_fd(const int fd)
+{
+    return (preload_ctx.enabled && fd >= 0 && fd < preload_ctx.fd_limit);
+}
+
+/* get the file with a reference, call release_file after use */
+static FCFSPreloadFile *get_file(const int fd)
+{
+    FCFSPreloadFile *file;
+
+    if (!is_managed_fd(fd)) {
+        return NULL;
+    }
+
+    PTHREAD_MUTEX_LOCK(&preload_ctx.lock);
+    if ((file=preload_ctx.files[fd]) != NULL) {
+        __sync_add_and_fetch(&file->refer_count, 1);
+    }
+    PTHREAD_MUTEX_UNLOCK(&preload_ctx.lock);
+    return file;
+}
+
+static inline bool file_exists(const int fd)
+{
+    bool exists;
+
+    if (!is_managed_fd(fd)) {
+        return false;
+    }
+
+    PTHREAD_MUTEX_LOCK(&preload_ctx.lock);
+    exists = (preload_ctx.files[fd] != NULL);
+    PTHREAD_MUTEX_UNLOCK(&preload_ctx.lock);
+    return exists;
+}
+
+static inline void set_file_context(FCFSAPIFileContext *fctx,
+        const mode_t mode)
+{
+    mode_t mask;
+
+    mask = umask(0);
+    umask(mask);
+    fctx->omp.mode = mode & (~mask);
+    fctx->omp.uid = geteuid();
+    fctx->omp.gid = getegid();
+    fctx->tid = getpid();
+}
+
+static void release_file(FCFSPreloadFile *file)
+{
+    int old_errno;
+
+    if (__sync_sub_and_fetch(&file->refer_count, 1) == 0) {
+        old_errno = errno;
+        fcfs_api_close(&file->fi);
+        free(file);
+        errno = old_errno;
+    }
+}
+
+static int attach_file(const int fd, FCFSPreloadFile *file)
+{
+    FCFSPreloadFile *old;
+
+    if (fd >= preload_ctx.fd_limit) {
+        LIBC_FUNC(close)(fd);
+        release_file(file);
+        PRELOAD_RETURN_ERRNO(EMFILE);
+    }
+
+    PTHREAD_MUTEX_LOCK(&preload_ctx.lock);
+    old = preload_ctx.files[fd];
+    preload_ctx.files[fd] = file;
+    PTHREAD_MUTEX_UNLOCK(&preload_ctx.lock);
+    if (old != NULL) {  //the fd closed by the syscall directly
+        release_file(old);
+    }
+    return fd;
+}
+
+static FCFSPreloadFile *detach_file(const int fd)
+{
+    FCFSPreloadFile *file;
+
+    if (!is_managed_fd(fd)) {
+        return NULL;
+    }
+
+    PTHREAD_MUTEX_LOCK(&preload_ctx.lock);
+    file = preload_ctx.files[fd];
+    preload_ctx.files[fd] = NULL;
+    PTHREAD_MUTEX_UNLOCK(&preload_ctx.lock);
+    return file;
+}
+
+static int preload_open(const char *path, const char *fcfs_path,
+        const int flags, const mode_t mode)
+{
+    FCFSPreloadFile *file;
+    FCFSAPIFileContext fctx;
+    int result;
+    int fd;
+
+    if ((result=preload_check_init()) != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+
+    if ((flags & O_DIRECTORY) || (flags & O_PATH)) {
+        return LIBC_FUNC(open)(path, flags, mode);
+    }
+
+    if ((file=(FCFSPreloadFile *)fc_malloc(sizeof(
+                        FCFSPreloadFile))) == NULL)
+    {
+        PRELOAD_RETURN_ERRNO(ENOMEM);
+    }
+    memset(file, 0, sizeof(*file));
+
+    set_file_context(&fctx, mode);
+    if ((result=fcfs_api_open(&file->fi, fcfs_path, flags, &fctx)) != 0) {
+        free(file);
+        if (result == EISDIR) {
+            return LIBC_FUNC(open)(path, flags, mode);
+        }
+        PRELOAD_RETURN_ERRNO(result);
+    }
+
+    if ((fd=LIBC_FUNC(open)("/dev/null", O_RDONLY |
+                    (flags & O_CLOEXEC))) < 0)
+    {
+        result = errno;
+        fcfs_api_close(&file->fi);
+        free(file);
+        PRELOAD_RETURN_ERRNO(result);
+    }
+
+    file->refer_count = 1;
+    return attach_file(fd, file);
+}
+
+static inline mode_t get_open_mode(const int flags, va_list ap)
+{
+    if ((flags & O_CREAT) || (flags & O_TMPFILE) == O_TMPFILE) {
+        return va_arg(ap, int);
+    }
+    return 0;
+}
+
+int open(const char *path, int flags, ...)
+{
+    const char *fcfs_path;
+    va_list ap;
+    mode_t mode;
+
+    va_start(ap, flags);
+    mode = get_open_mode(flags, ap);
+    va_end(ap);
+
+    if ((fcfs_path=get_fcfs_path(path)) != NULL) {
+        return preload_open(path, fcfs_path, flags, mode);
+    }
+    return LIBC_FUNC(open)(path, flags, mode);
+}
+
+int open64(const char *path, int flags, ...)
+{
+    va_list ap;
+    mode_t mode;
+
+    va_start(ap, flags);
+    mode = get_open_mode(flags, ap);
+    va_end(ap);
+    return open(path, flags, mode);
+}
+
+int openat(int dirfd, const char *path, int flags, ...)
+{
+    const char *fcfs_path;
+    va_list ap;
+    mode_t mode;
+
+    va_start(ap, flags);
+    mode = get_open_mode(flags, ap);
+    va_end(ap);
+
+    if ((fcfs_path=get_fcfs_path(path)) != NULL) {
+        return preload_open(path, fcfs_path, flags, mode);
+    }
+    return LIBC_FUNC(openat)(dirfd, path, flags, mode);
+}
+
+int openat64(int dirfd, const char *path, int flags, ...)
+{
+    va_list ap;
+    mode_t mode;
+
+    va_start(ap, flags);
+    mode = get_open_mode(flags, ap);
+    va_end(ap);
+    return openat(dirfd, path, flags, mode);
+}
+
+int creat(const char *path, mode_t mode)
+{
+    return open(path, O_CREAT | O_WRONLY | O_TRUNC, mode);
+}
+
+int creat64(const char *path, mode_t mode)
+{
+    return open(path, O_CREAT | O_WRONLY | O_TRUNC, mode);
+}
+
+int close(int fd)
+{
+    FCFSPreloadFile *file;
+
+    if ((file=detach_file(fd)) == NULL) {
+        return LIBC_FUNC(close)(fd);
+    }
+
+    LIBC_FUNC(close)(fd);
+    release_file(file);
+    return 0;
+}
+
+ssize_t read(int fd, void *buf, size_t count)
+{
+    FCFSPreloadFile *file;
+    int read_bytes;
+    int result;
+
+    if ((file=get_file(fd)) == NULL) {
+        return LIBC_FUNC(read)(fd, buf, count);
+    }
+
+    result = fcfs_api_read(&file->fi, buf, FC_MIN(count,
+                FCFS_PRELOAD_MAX_IO_SIZE), &read_bytes);
+    release_file(file);
+    if (result != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return read_bytes;
+}
+
+ssize_t write(int fd, const void *buf, size_t count)
+{
+    FCFSPreloadFile *file;
+    int written_bytes;
+    int result;
+
+    if ((file=get_file(fd)) == NULL) {
+        return LIBC_FUNC(write)(fd, buf, count);
+    }
+
+    result = fcfs_api_write(&file->fi, buf, FC_MIN(count,
+                FCFS_PRELOAD_MAX_IO_SIZE), &written_bytes);
+    release_file(file);
+    if (result != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return written_bytes;
+}
+
+ssize_t pread(int fd, void *buf, size_t count, off_t offset)
+{
+    FCFSPreloadFile *file;
+    int read_bytes;
+    int result;
+
+    if ((file=get_file(fd)) == NULL) {
+        return LIBC_FUNC(pread)(fd, buf, count, offset);
+    }
+
+    result = fcfs_api_pread(&file->fi, buf, FC_MIN(count,
+                FCFS_PRELOAD_MAX_IO_SIZE), offset, &read_bytes);
+    release_file(file);
+    if (result != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return read_bytes;
+}
+
+ssize_t pread64(int fd, void *buf, size_t count, off64_t offset)
+{
+    return pread(fd, buf, count, offset);
+}
+
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset)
+{
+    FCFSPreloadFile *file;
+    int written_bytes;
+    int result;
+
+    if ((file=get_file(fd)) == NULL) {
+        return LIBC_FUNC(pwrite)(fd, buf, count, offset);
+    }
+
+    result = fcfs_api_pwrite(&file->fi, buf, FC_MIN(count,
+                FCFS_PRELOAD_MAX_IO_SIZE), offset, &written_bytes);
+    release_file(file);
+    if (result != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return written_bytes;
+}
+
+ssize_t pwrite64(int fd, const void *buf, size_t count, off64_t offset)
+{
+    return pwrite(fd, buf, count, offset);
+}
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    ssize_t total;
+    ssize_t bytes;
+    int i;
+
+    if (!file_exists(fd)) {
+        return LIBC_FUNC(readv)(fd, iov, iovcnt);
+    }
+
+    total = 0;
+    for (i=0; i<iovcnt; i++) {
+        if ((bytes=read(fd, iov[i].iov_base, iov[i].iov_len)) < 0) {
+            return total > 0 ? total : bytes;
+        }
+        total += bytes;
+        if (bytes < iov[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    ssize_t total;
+    ssize_t bytes;
+    int i;
+
+    if (!file_exists(fd)) {
+        return LIBC_FUNC(writev)(fd, iov, iovcnt);
+    }
+
+    total = 0;
+    for (i=0; i<iovcnt; i++) {
+        if ((bytes=write(fd, iov[i].iov_base, iov[i].iov_len)) < 0) {
+            return total > 0 ? total : bytes;
+        }
+        total += bytes;
+        if (bytes < iov[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
+off_t lseek(int fd, off_t offset, int whence)
+{
+    FCFSPreloadFile *file;
+    off_t new_offset;
+    int result;
+
+    if ((file=get_file(fd)) == NULL) {
+        return LIBC_FUNC(lseek)(fd, offset, whence);
+    }
+
+    if ((result=fcfs_api_lseek(&file->fi, offset, whence)) == 0) {
+        new_offset = file->fi.offset;
+    }
+    release_file(file);
+    if (result != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return new_offset;
+}
+
+off64_t lseek64(int fd, off64_t offset, int whence)
+{
+    return lseek(fd, offset, whence);
+}
+
+int fsync(int fd)
+{
+    FCFSPreloadFile *file;
+    int result;
+
+    if ((file=get_file(fd)) == NULL) {
+        return LIBC_FUNC(fsync)(fd);
+    }
+
+    result = fcfs_api_fsync(&file->fi);
+    release_file(file);
+    if (result != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return 0;
+}
+
+int fdatasync(int fd)
+{
+    if (!file_exists(fd)) {
+        return LIBC_FUNC(fdatasync)(fd);
+    }
+    return fsync(fd);
+}
+
+int ftruncate(int fd, off_t length)
+{
+    FCFSPreloadFile *file;
+    int result;
+
+    if ((file=get_file(fd)) == NULL) {
+        return LIBC_FUNC(ftruncate)(fd, length);
+    }
+
+    result = fcfs_api_ftruncate_ex(&file->fi, length, file->fi.tid);
+    release_file(file);
+    if (result != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return 0;
+}
+
+int ftruncate64(int fd, off64_t length)
+{
+    return ftruncate(fd, length);
+}
+
+int truncate(const char *path, off_t length)
+{
+    const char *fcfs_path;
+    FCFSAPIFileContext fctx;
+    int result;
+
+    if ((fcfs_path=get_fcfs_path(path)) == NULL) {
+        return LIBC_FUNC(truncate)(path, length);
+    }
+
+    if ((result=preload_check_init()) != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    set_file_context(&fctx, 0);
+    if ((result=fcfs_api_truncate(fcfs_path, length, &fctx)) != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return 0;
+}
+
+int truncate64(const char *path, off64_t length)
+{
+    return truncate(path, length);
+}
+
+int fallocate(int fd, int mode, off_t offset, off_t len)
+{
+    FCFSPreloadFile *file;
+    int result;
+
+    if ((file=get_file(fd)) == NULL) {
+        return LIBC_FUNC(fallocate)(fd, mode, offset, len);
+    }
+
+    result = fcfs_api_fallocate_ex(&file->fi, mode,
+            offset, len, file->fi.tid);
+    release_file(file);
+    if (result != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return 0;
+}
+
+int fallocate64(int fd, int mode, off64_t offset, off64_t len)
+{
+    return fallocate(fd, mode, offset, len);
+}
+
+int posix_fallocate(int fd, off_t offset, off_t len)
+{
+    FCFSPreloadFile *file;
+    int result;
+
+    if ((file=get_file(fd)) == NULL) {
+        return LIBC_FUNC(posix_fallocate)(fd, offset, len);
+    }
+    result = fcfs_api_fallocate_ex(&file->fi, 0, offset, len, file->fi.tid);
+    release_file(file);
+    return result;
+}
+
+int posix_fallocate64(int fd, off64_t offset, off64_t len)
+{
+    return posix_fallocate(fd, offset, len);
+}
+
+/* return 0 for success, -1 for fail, 1 for not under the mountpoint */
+static int preload_stat(const char *path, struct stat *buf)
+{
+    const char *fcfs_path;
+    int result;
+
+    if ((fcfs_path=get_fcfs_path(path)) == NULL) {
+        return 1;
+    }
+
+    if ((result=preload_check_init()) != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    if ((result=fcfs_api_stat(fcfs_path, buf)) != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return 0;
+}
+
+/* release the reference of the file */
+static int preload_fstat(FCFSPreloadFile *file, struct stat *buf)
+{
+    int result;
+
+    result = fcfs_api_fstat(&file->fi, buf);
+    release_file(file);
+    if (result != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return 0;
+}
+
+int stat(const char *path, struct stat *buf)
+{
+    int result;
+
+    if ((result=preload_stat(path, buf)) <= 0) {
+        return result;
+    }
+    return LIBC_FUNC(stat)(path, buf);
+}
+
+int stat64(const char *path, struct stat64 *buf)
+{
+    return stat(path, (struct stat *)buf);
+}
+
+int lstat(const char *path, struct stat *buf)
+{
+    int result;
+
+    if ((result=preload_stat(path, buf)) <= 0) {
+        return result;
+    }
+    return LIBC_FUNC(lstat)(path, buf);
+}
+
+int lstat64(const char *path, struct stat64 *buf)
+{
+    return lstat(path, (struct stat *)buf);
+}
+
+int fstat(int fd, struct stat *buf)
+{
+    FCFSPreloadFile *file;
+
+    if ((file=get_file(fd)) == NULL) {
+        return LIBC_FUNC(fstat)(fd, buf);
+    }
+    return preload_fstat(file, buf);
+}
+
+int fstat64(int fd, struct stat64 *buf)
+{
+    return fstat(fd, (struct stat *)buf);
+}
+
+int fstatat(int dirfd, const char *path, struct stat *buf, int flags)
+{
+    FCFSPreloadFile *file;
+    int result;
+
+    if ((flags & AT_EMPTY_PATH) && *path == '\0') {
+        if ((file=get_file(dirfd)) != NULL) {
+            return preload_fstat(file, buf);
+        }
+    } else if ((result=preload_stat(path, buf)) <= 0) {
+        return result;
+    }
+    return LIBC_FUNC(fstatat)(dirfd, path, buf, flags);
+}
+
+int fstatat64(int dirfd, const char *path, struct stat64 *buf, int flags)
+{
+    return fstatat(dirfd, path, (struct stat *)buf, flags);
+}
+
+/* for the programs built with glibc before 2.33 */
+int __xstat(int ver, const char *path, struct stat *buf)
+{
+    int result;
+
+    if ((result=preload_stat(path, buf)) <= 0) {
+        return result;
+    }
+    return LIBC_FUNC(__xstat)(ver, path, buf);
+}
+
+int __xstat64(int ver, const char *path, struct stat64 *buf)
+{
+    return __xstat(ver, path, (struct stat *)buf);
+}
+
+int __lxstat(int ver, const char *path, struct stat *buf)
+{
+    int result;
+
+    if ((result=preload_stat(path, buf)) <= 0) {
+        return result;
+    }
+    return LIBC_FUNC(__lxstat)(ver, path, buf);
+}
+
+int __lxstat64(int ver, const char *path, struct stat64 *buf)
+{
+    return __lxstat(ver, path, (struct stat *)buf);
+}
+
+int __fxstat(int ver, int fd, struct stat *buf)
+{
+    FCFSPreloadFile *file;
+
+    if ((file=get_file(fd)) == NULL) {
+        return LIBC_FUNC(__fxstat)(ver, fd, buf);
+    }
+    return preload_fstat(file, buf);
+}
+
+int __fxstat64(int ver, int fd, struct stat64 *buf)
+{
+    return __fxstat(ver, fd, (struct stat *)buf);
+}
+
+int access(const char *path, int mode)
+{
+    struct stat buf;
+    int result;
+    int shift;
+
+    if ((result=preload_stat(path, &buf)) < 0) {
+        return result;
+    } else if (result > 0) {
+        return LIBC_FUNC(access)(path, mode);
+    }
+
+    if (mode == F_OK || geteuid() == 0) {
+        return 0;
+    }
+
+    if (buf.st_uid == geteuid()) {
+        shift = 6;
+    } else if (buf.st_gid == getegid()) {
+        shift = 3;
+    } else {
+        shift = 0;
+    }
+    if ((((buf.st_mode >> shift) & mode) & 07) != (mode & 07)) {
+        PRELOAD_RETURN_ERRNO(EACCES);
+    }
+    return 0;
+}
+
+int unlink(const char *path)
+{
+    const char *fcfs_path;
+    FCFSAPIFileContext fctx;
+    int result;
+
+    if ((fcfs_path=get_fcfs_path(path)) == NULL) {
+        return LIBC_FUNC(unlink)(path);
+    }
+
+    if ((result=preload_check_init()) != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    set_file_context(&fctx, 0);
+    if ((result=fcfs_api_unlink(fcfs_path, &fctx)) != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return 0;
+}
+
+int rename(const char *old_path, const char *new_path)
+{
+    const char *old_fcfs_path;
+    const char *new_fcfs_path;
+    FCFSAPIFileContext fctx;
+    int result;
+
+    old_fcfs_path = get_fcfs_path(old_path);
+    new_fcfs_path = get_fcfs_path(new_path);
+    if (old_fcfs_path == NULL && new_fcfs_path == NULL) {
+        return LIBC_FUNC(rename)(old_path, new_path);
+    } else if (old_fcfs_path == NULL || new_fcfs_path == NULL) {
+        PRELOAD_RETURN_ERRNO(EXDEV);
+    }
+
+    if ((result=preload_check_init()) != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    set_file_context(&fctx, 0);
+    if ((result=fcfs_api_rename(old_fcfs_path,
+                    new_fcfs_path, &fctx)) != 0)
+    {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return 0;
+}
+
+/* the dup fds share the same file info as the kernel does */
+int dup(int fd)
+{
+    FCFSPreloadFile *file;
+    int new_fd;
+
+    if ((new_fd=LIBC_FUNC(dup)(fd)) < 0) {
+        return new_fd;
+    }
+    if ((file=get_file(fd)) == NULL) {
+        return new_fd;
+    }
+    return attach_file(new_fd, file);  //the reference moved to new_fd
+}
+
+int dup3(int old_fd, int new_fd, int flags)
+{
+    FCFSPreloadFile *file;
+    FCFSPreloadFile *old;
+    int result;
+
+    file = get_file(old_fd);
+    if (file != NULL && old_fd == new_fd) {
+        release_file(file);
+        return new_fd;
+    }
+
+    if (flags == 0) {
+        result = LIBC_FUNC(dup2)(old_fd, new_fd);
+    } else {
+        result = LIBC_FUNC(dup3)(old_fd, new_fd, flags);
+    }
+    if (result < 0) {
+        if (file != NULL) {
+            release_file(file);
+        }
+        return result;
+    }
+
+    if (file != NULL) {
+        return attach_file(new_fd, file);  //the reference moved to new_fd
+    }
+
+    if ((old=detach_file(new_fd)) != NULL) {
+        release_file(old);
+    }
+    return result;
+}
+
+int dup2(int old_fd, int new_fd)
+{
+    return dup3(old_fd, new_fd, 0);
+}
+
+static int preload_fcntl(FCFSPreloadFile *file, int fd, int cmd, void *arg)
+{
+    int64_t owner_id;
+    int new_fd;
+    int result;
+
+    switch (cmd) {
+        case F_DUPFD:
+        case F_DUPFD_CLOEXEC:
+            if ((new_fd=LIBC_FUNC(fcntl)(fd, cmd, (long)arg)) < 0) {
+                return new_fd;
+            }
+            __sync_add_and_fetch(&file->refer_count, 1);
+            return attach_file(new_fd, file);
+        case F_GETFL:
+            return file->fi.flags;
+        case F_GETLK:
+            result = fcfs_api_getlk(&file->fi,
+                    (struct flock *)arg, &owner_id);
+            break;
+        case F_SETLK:
+        case F_SETLKW:
+            result = fcfs_api_setlk(&file->fi, (struct flock *)
+                    arg, getpid());
+            break;
+        default:
+            return LIBC_FUNC(fcntl)(fd, cmd, arg);
+    }
+
+    if (result != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return 0;
+}
+
+int fcntl(int fd, int cmd, ...)
+{
+    FCFSPreloadFile *file;
+    va_list ap;
+    void *arg;
+    int result;
+
+    va_start(ap, cmd);
+    arg = va_arg(ap, void *);
+    va_end(ap);
+
+    if ((file=get_file(fd)) == NULL) {
+        return LIBC_FUNC(fcntl)(fd, cmd, arg);
+    }
+    result = preload_fcntl(file, fd, cmd, arg);
+    release_file(file);
+    return result;
+}
+
+int fcntl64(int fd, int cmd, ...)
+{
+    va_list ap;
+    void *arg;
+
+    va_start(ap, cmd);
+    arg = va_arg(ap, void *);
+    va_end(ap);
+    return fcntl(fd, cmd, arg);
+}
+
+int flock(int fd, int operation)
+{
+    FCFSPreloadFile *file;
+    int result;
+
+    if ((file=get_file(fd)) == NULL) {
+        return LIBC_FUNC(flock)(fd, operation);
+    }
+
+    /* the owner of flock is the open file description */
+    result = fcfs_api_flock_ex(&file->fi, operation, (long)file);
+    release_file(file);
+    if (result != 0) {
+        PRELOAD_RETURN_ERRNO(result);
+    }
+    return 0;
+}
+
+static int load_preload_config(const char *config_filename)
+{
+    IniContext ini_context;
+    char *ns;
+    char *mountpoint;
+    int result;
+
+    if ((result=iniLoadFromFile(config_filename, &ini_context)) != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "load conf file \"%s\" fail, ret code: %d",
+                __LINE__, config_filename, result);
+        return result;
+    }
+
+    do {
+        ns = iniGetStrValue(FCFS_API_DEFAULT_FASTDIR_SECTION_NAME,
+                "namespace", &ini_context);
+        if (ns == NULL || *ns == '\0') {
+            logError("file: "__FILE__", line: %d, "
+                    "config file: %s, section: %s, item: namespace "
+                    "not exist or is empty", __LINE__, config_filename,
+                    FCFS_API_DEFAULT_FASTDIR_SECTION_NAME);
+            result = ENOENT;
+            break;
+        }
+
+        mountpoint = getenv("FCFS_PRELOAD_MOUNTPOINT");
+        if (mountpoint == NULL || *mountpoint == '\0') {
+            mountpoint = iniGetStrValue(FCFS_PRELOAD_FUSE_SECTION,
+                    "mountpoint", &ini_context);
+        }
+        if (mountpoint == NULL || *mountpoint != '/') {
+            logError("file: "__FILE__", line: %d, "
+                    "config file: %s, section: %s, item: mountpoint "
+                    "not exist or is not an absolute path", __LINE__,
+                    config_filename, FCFS_PRELOAD_FUSE_SECTION);
+            result = EINVAL;
+            break;
+        }
+
+        preload_ctx.mountpoint.len = strlen(mountpoint);
+        while (preload_ctx.mountpoint.len > 1 && mountpoint[
+                preload_ctx.mountpoint.len - 1] == '/')
+        {
+            preload_ctx.mountpoint.len--;
+        }
+        if ((preload_ctx.mountpoint.str=fc_strdup1(mountpoint,
+                        preload_ctx.mountpoint.len)) == NULL ||
+                (preload_ctx.ns=fc_strdup(ns)) == NULL ||
+                (preload_ctx.config_filename=fc_strdup(
+                    config_filename)) == NULL)
+        {
+            result = ENOMEM;
+            break;
+        }
+    } while (0);
+
+    iniFreeContext(&ini_context);
+    return result;
+}
+
+static void preload_atfork_prepare()
+{
+    PTHREAD_MUTEX_LOCK(&preload_ctx.lock);
+}
+
+static void preload_atfork_parent()
+{
+    PTHREAD_MUTEX_UNLOCK(&preload_ctx.lock);
+}
+
+/* the fcfs_api connections and threads belong to the parent, so the child
+ * forgets the opened files without closing them (the parent's sessions
+ * and locks keep alive) and disables the interception */
+static void preload_atfork_child()
+{
+    int fd;
+
+    init_pthread_lock(&preload_ctx.lock);
+    preload_ctx.enabled = false;
+    for (fd=0; fd<preload_ctx.fd_limit; fd++) {
+        if (preload_ctx.files[fd] != NULL) {
+            if (__sync_sub_and_fetch(&preload_ctx.files[fd]->
+                        refer_count, 1) == 0)
+            {
+                free(preload_ctx.files[fd]);
+            }
+            preload_ctx.files[fd] = NULL;
+        }
+    }
+}
+
+static void __attribute__((constructor)) fcfs_preload_init()
+{
+    const char *config_filename;
+    struct rlimit limit;
+    int bytes;
+    int result;
+
+    log_init();
+    config_filename = getenv("FCFS_PRELOAD_CONFIG");
+    if (config_filename == NULL || *config_filename == '\0') {
+        config_filename = FCFS_PRELOAD_DEFAULT_CONFIG;
+    }
+    if (load_preload_config(config_filename) != 0) {
+        return;
+    }
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0 ||
+            limit.rlim_cur == RLIM_INFINITY)
+    {
+        preload_ctx.fd_limit = 65536;
+    } else {
+        preload_ctx.fd_limit = limit.rlim_cur;
+    }
+    bytes = sizeof(FCFSPreloadFile *) * preload_ctx.fd_limit;
+    if ((preload_ctx.files=(FCFSPreloadFile **)fc_malloc(bytes)) == NULL) {
+        return;
+    }
+    memset(preload_ctx.files, 0, bytes);
+
+    if (init_pthread_lock(&preload_ctx.lock) != 0) {
+        return;
+    }
+    if ((result=pthread_atfork(preload_atfork_prepare,
+                    preload_atfork_parent, preload_atfork_child)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "call pthread_atfork fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        return;
+    }
+    preload_ctx.enabled = true;
+}
+
+/* close the opened files for flushing the cached data */
+static void __attribute__((destructor)) fcfs_preload_destroy()
+{
+    FCFSPreloadFile *file;
+    int fd;
+
+    if (!preload_ctx.enabled) {
+        return;
+    }
+
+    for (fd=0; fd<preload_ctx.fd_limit; fd++) {
+        if ((file=detach_file(fd)) != NULL) {
+            release_file(file);
+        }
+    }
+}